@@ -137,6 +137,65 @@ private:
     size_t timeout_;
 };
 
+/// \brief Configuration for the maximum number of cached responses
+class ResponseCacheSizeConfig : public AuthConfigParser {
+public:
+    ResponseCacheSizeConfig(AuthSrv& server) : server_(server), size_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            size_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "response_cache_size must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setResponseCacheSize(size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t size_;
+};
+
+/// \brief Configuration for the number of query processing threads
+///
+/// Like \c ListenAddressConfig, this changes the setting in build, as
+/// doing so involves requesting the listening sockets again and can fail.
+/// If commit is not called, the old number of threads is restored on
+/// destruction.
+class WorkerThreadsConfig : public AuthConfigParser {
+public:
+    WorkerThreadsConfig(AuthSrv& server) :
+        server_(server), old_count_(0), rollback_(false)
+    {}
+    ~WorkerThreadsConfig() {
+        if (rollback_) {
+            server_.setWorkerThreads(old_count_);
+        }
+    }
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() < 0) {
+            bundy_throw(AuthConfigError, "worker_threads must be 0 or higher");
+        }
+        const size_t old_count = server_.getWorkerThreads();
+        server_.setWorkerThreads(config->intValue());
+        old_count_ = old_count;
+        rollback_ = true;
+    }
+
+    virtual void commit() {
+        rollback_ = false;
+    }
+private:
+    AuthSrv& server_;
+    size_t old_count_;
+    bool rollback_;
+};
+
 } // end of unnamed namespace
 
 AuthConfigParser*
@@ -170,6 +229,10 @@ createAuthConfigParser(AuthSrv& server, const std::string& config_id) {
         return (new VersionConfig());
     } else if (config_id == "tcp_recv_timeout") {
         return (new TCPRecvTimeoutConfig(server));
+    } else if (config_id == "response_cache_size") {
+        return (new ResponseCacheSizeConfig(server));
+    } else if (config_id == "worker_threads") {
+        return (new WorkerThreadsConfig(server));
     } else {
         bundy_throw(AuthConfigError, "Unknown configuration identifier: " <<
                     config_id);
@@ -51,11 +51,18 @@
 #include <auth/query.h>
 #include <auth/statistics.h>
 #include <auth/auth_log.h>
+#include <auth/auth_workers.h>
 #include <auth/datasrc_clients_mgr.h>
+#include <auth/response_cache.h>
+
+#include <util/threads/sync.h>
 
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <algorithm>
 #include <cassert>
@@ -84,6 +91,7 @@ using namespace bundy::asiodns;
 using namespace bundy::server_common::portconfig;
 using bundy::auth::statistics::Counters;
 using bundy::auth::statistics::MessageAttributes;
+using bundy::util::thread::Mutex;
 
 namespace {
 // A helper class for cleaning up message renderer.
@@ -229,6 +237,21 @@ private:
         }
     }
 };
+
+// A set of resources used for processing a single query at a time.
+//
+// The main thread and each worker thread (if any) have their own context,
+// so they can process queries in parallel without locking.  The only
+// exception is the statistics counters, which can be read by the main
+// thread at any time; counters_mutex_ protects them, and should be
+// uncontended in most cases.
+struct QueryContext : boost::noncopyable {
+    MessageRenderer renderer_;
+    auth::Query query_;
+    Counters counters_;
+    Mutex counters_mutex_;
+};
+typedef boost::shared_ptr<QueryContext> QueryContextPtr;
 }
 
 class AuthSrvImpl {
@@ -240,24 +263,61 @@ public:
     AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
                 BaseSocketSessionForwarder& ddns_forwarder);
 
+    /// Implementation of \c AuthSrv::processMessage(), using the given
+    /// context.  It can be called from multiple threads in parallel as long
+    /// as each thread uses a different context.
+    void processMessage(const IOMessage& io_message, Message& message,
+                        OutputBuffer& buffer, DNSServer* server,
+                        QueryContext& context);
+
     bool processNormalQuery(const IOMessage& io_message,
                             ConstEDNSPtr remote_edns, Message& message,
                             OutputBuffer& buffer,
                             auto_ptr<TSIGContext> tsig_context,
-                            MessageAttributes& stats_attrs);
+                            MessageAttributes& stats_attrs,
+                            QueryContext& context);
     bool processXfrQuery(const IOMessage& io_message, Message& message,
                          OutputBuffer& buffer,
                          auto_ptr<TSIGContext> tsig_context,
-                         MessageAttributes& stats_attrs);
+                         MessageAttributes& stats_attrs,
+                         QueryContext& context);
     bool processNotify(const IOMessage& io_message, Message& message,
                        OutputBuffer& buffer,
                        auto_ptr<TSIGContext> tsig_context,
-                       MessageAttributes& stats_attrs);
+                       MessageAttributes& stats_attrs,
+                       QueryContext& context);
+    /// Returns true if the request is forwarded; false if there's no
+    /// forwarder for it.
     bool processUpdate(const IOMessage& io_message);
 
+    /// Return the current TSIG keyring, copying it under the protection
+    /// of the keyring mutex, if any.
+    boost::shared_ptr<TSIGKeyRing> getKeyRing() const;
+
+    /// Create \c count worker threads (and their contexts), installed as
+    /// \c workers_.  There must be no workers at the time of the call.
+    void createWorkers(size_t count, DNSAnswer* answer);
+
+    /// Stop and destroy all worker threads, if any.  Statistics counters
+    /// of the workers are merged into the main context, so they won't be
+    /// lost.
+    void destroyWorkers();
+
+    /// Return the DNS service to be used for adding servers: the set of
+    /// worker threads if they exist; otherwise the main service, \c dnss.
+    DNSServiceBase& getActiveService(DNSServiceBase* dnss) {
+        if (workers_) {
+            return (*workers_);
+        }
+        assert(dnss != NULL);
+        return (*dnss);
+    }
+
     IOService io_service_;
 
-    MessageRenderer renderer_;
+    /// The context for queries processed in the main thread
+    QueryContext main_context_;
+
     /// Currently non-configurable, but will be.
     static const uint16_t DEFAULT_LOCAL_UDPSIZE = 4096;
 
@@ -265,18 +325,26 @@ public:
     ModuleCCSession* config_session_;
     AbstractSession* xfrin_session_;
 
-    /// Query counters for statistics
-    Counters counters_;
-
     /// Addresses we listen on
     AddressList listen_addresses_;
 
+    /// The timeout for incoming TCP connections, kept here so it can be
+    /// applied to new worker threads.  The initial value is the default
+    /// of \c DNSService.
+    size_t tcp_recv_timeout_;
+
     /// The TSIG keyring
     const boost::shared_ptr<TSIGKeyRing>* keyring_;
 
+    /// The mutex protecting the keyring, if any
+    Mutex* keyring_mutex_;
+
     /// The data source client list manager
     auth::DataSrcClientsMgr datasrc_clients_mgr_;
 
+    /// The cache of responses to normal queries, shared by all threads
+    auth::ResponseCache response_cache_;
+
     boost::scoped_ptr<SocketSessionForwarderHolder> xfrout_forwarder_;
 
     /// Socket session forwarder for dynamic update requests
@@ -287,6 +355,16 @@ public:
     /// bundy-ddns is not running
     boost::scoped_ptr<SocketSessionForwarderHolder> ddns_forwarder_;
 
+    /// Serializes the use of the forwarders and xfrin_session_, which
+    /// can be used from multiple worker threads.
+    Mutex forwarder_mutex_;
+
+    /// Per worker resources; the contexts and lookups must outlive
+    /// workers_ (so they are declared before it).
+    vector<QueryContextPtr> worker_contexts_;
+    vector<boost::shared_ptr<DNSLookup> > worker_lookups_;
+    boost::scoped_ptr<AuthWorkers> workers_;
+
     /// \brief Resume the server
     ///
     /// This is a wrapper call for DNSServer::resume(done). Query/Response
@@ -300,23 +378,24 @@ public:
     ///                    with statistics
     /// \param done If true, it indicates there is a response.
     ///             this value will be passed to server->resume(bool)
+    /// \param context The context the message was processed with
     void resumeServer(bundy::asiodns::DNSServer* server,
                       bundy::dns::Message& message,
                       MessageAttributes& stats_attrs,
-                      const bool done);
+                      const bool done,
+                      QueryContext& context);
 
     /// Are we currently subscribed to the SegmentReader group?
     bool readers_group_subscribed_;
-private:
-    auth::Query query_;
 };
 
 AuthSrvImpl::AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
                          BaseSocketSessionForwarder& ddns_forwarder) :
     config_session_(NULL),
     xfrin_session_(NULL),
-    counters_(),
+    tcp_recv_timeout_(5000),
     keyring_(NULL),
+    keyring_mutex_(NULL),
     datasrc_clients_mgr_(io_service_),
     xfrout_forwarder_(new SocketSessionForwarderHolder("xfrout",
                                                        xfrout_forwarder)),
@@ -327,10 +406,13 @@ AuthSrvImpl::AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
 
 // This is a derived class of \c DNSLookup, to serve as a
 // callback in the asiolink module.  It calls
-// AuthSrv::processMessage() on a single DNS message.
+// AuthSrvImpl::processMessage() on a single DNS message with the given
+// query context.
 class MessageLookup : public DNSLookup {
 public:
-    MessageLookup(AuthSrv* srv) : server_(srv) {}
+    MessageLookup(AuthSrvImpl* impl, QueryContext* context) :
+        impl_(impl), context_(context)
+    {}
     virtual void operator()(const IOMessage& io_message,
                             MessagePtr message,
                             MessagePtr, // Not used here
@@ -342,10 +424,12 @@ public:
         // This is not done in processMessage itself (which would be
         // equivalent), to allow tests to inspect the message handling.
         MessageHolder message_holder(*message);
-        server_->processMessage(io_message, *message, *buffer, server);
+        impl_->processMessage(io_message, *message, *buffer, server,
+                              *context_);
     }
 private:
-    AuthSrv* server_;
+    AuthSrvImpl* impl_;
+    QueryContext* context_;
 };
 
 // This is a derived class of \c DNSAnswer, to serve as a callback in the
@@ -369,7 +453,7 @@ AuthSrv::AuthSrv(bundy::util::io::BaseSocketSessionForwarder& xfrout_forwarder,
     dnss_(NULL)
 {
     impl_ = new AuthSrvImpl(xfrout_forwarder, ddns_forwarder);
-    dns_lookup_ = new MessageLookup(this);
+    dns_lookup_ = new MessageLookup(impl_, &impl_->main_context_);
     dns_answer_ = new MessageAnswer(this);
 }
 
@@ -379,6 +463,8 @@ AuthSrv::stop() {
 }
 
 AuthSrv::~AuthSrv() {
+    // Stop the worker threads first, as they use the lookup providers.
+    impl_->destroyWorkers();
     delete impl_;
     delete dns_lookup_;
     delete dns_answer_;
@@ -467,6 +553,15 @@ AuthSrv::getConfigSession() const {
 void
 AuthSrv::processMessage(const IOMessage& io_message, Message& message,
                         OutputBuffer& buffer, DNSServer* server)
+{
+    impl_->processMessage(io_message, message, buffer, server,
+                          impl_->main_context_);
+}
+
+void
+AuthSrvImpl::processMessage(const IOMessage& io_message, Message& message,
+                            OutputBuffer& buffer, DNSServer* server,
+                            QueryContext& context)
 {
     InputBuffer request_buffer(io_message.getData(), io_message.getDataSize());
     MessageAttributes stats_attrs;
@@ -484,13 +579,13 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
         // Ignore all responses.
         if (message.getHeaderFlag(Message::HEADERFLAG_QR)) {
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_RECEIVED);
-            impl_->resumeServer(server, message, stats_attrs, false);
+            resumeServer(server, message, stats_attrs, false, context);
             return;
         }
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_HEADER_PARSE_FAIL)
                   .arg(ex.what());
-        impl_->resumeServer(server, message, stats_attrs, false);
+        resumeServer(server, message, stats_attrs, false, context);
         return;
     }
 
@@ -502,26 +597,41 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
     stats_attrs.setRequestOpCode(opcode);
 
     try {
-        // Parse the message.
-        message.fromWire(request_buffer);
+        // Parse the message.  We don't need the RRsets of the sections
+        // other than the question (and EDNS and TSIG) for any type of
+        // request we handle, so they are only built if and when they're
+        // used, which is only for debug logging below.
+        message.fromWire(request_buffer, Message::PARSE_LAZY);
     } catch (const DNSProtocolError& error) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PROTOCOL_FAILURE)
                   .arg(error.getRcode().toText()).arg(error.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, error.getRcode(),
+        makeErrorMessage(context.renderer_, message, buffer, error.getRcode(),
                          stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, message, stats_attrs, true, context);
         return;
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PARSE_FAILED)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, message, stats_attrs, true, context);
         return;
     } // other exceptions will be handled at a higher layer.
 
-    LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_PACKET_RECEIVED)
-              .arg(message);
+    // Logging the message builds the RRsets whose parsing was deferred, and
+    // fails if some of them are malformed.  Such errors don't matter for
+    // handling the request, and they must not make the response depend on
+    // the log level, so they are only logged.
+    if (auth_logger.isDebugEnabled(DBG_AUTH_MESSAGES)) {
+        try {
+            const std::string text = message.toText();
+            LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_PACKET_RECEIVED)
+                      .arg(text);
+        } catch (const bundy::Exception& ex) {
+            LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES,
+                      AUTH_PACKET_RECEIVED_MALFORMED).arg(ex.what());
+        }
+    }
 
     // Perform further protocol-level validation.
     // TSIG first
@@ -532,20 +642,20 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
     // Do we do TSIG?
     // The keyring can be null if we're in test
-    if (impl_->keyring_ != NULL && tsig_record != NULL) {
+    if (keyring_ != NULL && tsig_record != NULL) {
         tsig_context.reset(new TSIGContext(tsig_record->getName(),
                                            tsig_record->getRdata().
                                                 getAlgorithm(),
-                                           **impl_->keyring_));
+                                           *getKeyRing()));
         tsig_error = tsig_context->verify(tsig_record, io_message.getData(),
                                           io_message.getDataSize());
         stats_attrs.setRequestTSIG(true, tsig_error != TSIGError::NOERROR());
     }
 
     if (tsig_error != TSIGError::NOERROR()) {
-        makeErrorMessage(impl_->renderer_, message, buffer,
+        makeErrorMessage(context.renderer_, message, buffer,
                          tsig_error.toRcode(), stats_attrs, tsig_context);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, message, stats_attrs, true, context);
         return;
     }
 
@@ -560,53 +670,54 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
         // note: This can only be reliable after TSIG check succeeds.
         if (opcode == Opcode::NOTIFY()) {
-            send_answer = impl_->processNotify(io_message, message, buffer,
-                                               tsig_context, stats_attrs);
+            send_answer = processNotify(io_message, message, buffer,
+                                        tsig_context, stats_attrs, context);
         } else if (opcode == Opcode::UPDATE()) {
-            if (impl_->ddns_forwarder_) {
-                send_answer = impl_->processUpdate(io_message);
+            if (processUpdate(io_message)) {
+                // On successful push, the request shouldn't be responded
+                // from bundy-auth.
+                send_answer = false;
             } else {
-                makeErrorMessage(impl_->renderer_, message, buffer,
+                makeErrorMessage(context.renderer_, message, buffer,
                                  Rcode::NOTIMP(), stats_attrs, tsig_context);
             }
         } else if (opcode != Opcode::QUERY()) {
             const IOEndpoint& remote_ep = io_message.getRemoteEndpoint();
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_UNSUPPORTED_OPCODE)
                 .arg(message.getOpcode().toText()).arg(remote_ep);
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(context.renderer_, message, buffer,
                              Rcode::NOTIMP(), stats_attrs, tsig_context);
         } else if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(context.renderer_, message, buffer,
                              Rcode::FORMERR(), stats_attrs, tsig_context);
         } else {
             ConstQuestionPtr question = *message.beginQuestion();
             const RRType& qtype = question->getType();
             if (qtype == RRType::AXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, tsig_context,
-                                                     stats_attrs);
+                send_answer = processXfrQuery(io_message, message, buffer,
+                                              tsig_context, stats_attrs,
+                                              context);
             } else if (qtype == RRType::IXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, tsig_context,
-                                                     stats_attrs);
+                send_answer = processXfrQuery(io_message, message, buffer,
+                                              tsig_context, stats_attrs,
+                                              context);
             } else {
-                send_answer = impl_->processNormalQuery(io_message, edns,
-                                                        message, buffer,
-                                                        tsig_context,
-                                                        stats_attrs);
+                send_answer = processNormalQuery(io_message, edns, message,
+                                                 buffer, tsig_context,
+                                                 stats_attrs, context);
             }
         }
     } catch (const std::exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
     } catch (...) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE_UNKNOWN);
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
     }
-    impl_->resumeServer(server, message, stats_attrs, send_answer);
+    resumeServer(server, message, stats_attrs, send_answer, context);
 }
 
 bool
@@ -614,11 +725,21 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
                                 ConstEDNSPtr remote_edns, Message& message,
                                 OutputBuffer& buffer,
                                 auto_ptr<TSIGContext> tsig_context,
-                                MessageAttributes& stats_attrs)
+                                MessageAttributes& stats_attrs,
+                                QueryContext& context)
 {
     const bool dnssec_ok = remote_edns && remote_edns->getDNSSECAwareness();
     const uint16_t remote_bufsize = remote_edns ? remote_edns->getUDPSize() :
         Message::DEFAULT_MAX_UDPSIZE;
+    const bool udp_buffer =
+        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
+    const uint16_t length_limit = udp_buffer ? remote_bufsize : 65535;
+
+    // The key must be built from the query, i.e., before makeResponse().
+    // Responses signed with TSIG depend on more than the key, so they are
+    // never cached.
+    auth::ResponseCache::Key cache_key(message, length_limit);
+    const bool use_cache = (tsig_context.get() == NULL);
 
     message.makeResponse();
     message.setHeaderFlag(Message::HEADERFLAG_AA);
@@ -631,6 +752,36 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
         message.setEDNS(local_edns);
     }
 
+    const size_t offset = buffer.getLength();
+    if (use_cache) {
+        switch (response_cache_.lookup(cache_key, message.getQid(), buffer)) {
+        case auth::ResponseCache::HIT:
+        {
+            // The response is already in the buffer.  The message is only
+            // used for the statistics, so we only copy the RCODE (and the
+            // number of answers, through stats_attrs) from the cached one.
+            const uint8_t* const data =
+                static_cast<const uint8_t*>(buffer.getData()) + offset;
+            message.setRcode(Rcode(data[3] & 0x0f));
+            stats_attrs.setResponseTruncated((data[2] & 0x02) != 0);
+            stats_attrs.setResponseCacheHit((data[6] << 8) | data[7]);
+            stats_attrs.setResponseTSIG(false);
+
+            LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES,
+                      AUTH_SEND_CACHED_RESPONSE)
+                .arg(buffer.getLength() - offset)
+                .arg((*message.beginQuestion())->getName())
+                .arg((*message.beginQuestion())->getType());
+            return (true);
+        }
+        case auth::ResponseCache::MISS:
+            stats_attrs.setResponseCacheMiss();
+            break;
+        case auth::ResponseCache::DISABLED:
+            break;
+        }
+    }
+
     // Get access to data source client list through the holder and keep
     // the holder until the processing and rendering is done to avoid
     // race with any other thread(s) such as the background loader.
@@ -638,54 +789,61 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
 
     try {
         const ConstQuestionPtr question = *message.beginQuestion();
-        const boost::shared_ptr<datasrc::ClientList>
+        const boost::shared_ptr<datasrc::ConfigurableClientList>&
             list(datasrc_holder.findClientList(question->getClass()));
         if (list) {
             const RRType& qtype = question->getType();
             const Name& qname = question->getName();
-            query_.process(*list, qname, qtype, message, dnssec_ok);
+            context.query_.process(*list, qname, qtype, message, dnssec_ok);
         } else {
-            makeErrorMessage(renderer_, message, buffer, Rcode::REFUSED(),
-                             stats_attrs);
+            makeErrorMessage(context.renderer_, message, buffer,
+                             Rcode::REFUSED(), stats_attrs);
             return (true);
         }
     } catch (const bundy::Exception& ex) {
         LOG_ERROR(auth_logger, AUTH_PROCESS_FAIL).arg(ex.what());
-        makeErrorMessage(renderer_, message, buffer, Rcode::SERVFAIL(),
-                         stats_attrs);
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
         return (true);
     }
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    const bool udp_buffer =
-        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
-    renderer_.setLengthLimit(udp_buffer ? remote_bufsize : 65535);
-    message.toWire(renderer_, tsig_context.get());
+    MessageRenderer& renderer = context.renderer_;
+    RendererHolder holder(renderer, &buffer, stats_attrs);
+    renderer.setLengthLimit(length_limit);
+    message.toWire(renderer, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
+    if (stats_attrs.responseIsCacheMiss()) {
+        response_cache_.insert(cache_key,
+                               static_cast<const uint8_t*>(buffer.getData()) +
+                               offset, buffer.getLength() - offset);
+    }
 
     LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_NORMAL_RESPONSE)
-              .arg(renderer_.getLength()).arg(message);
+              .arg(renderer.getLength()).arg(message);
     return (true);
-    // The message can contain some data from the locked resource. But outside
-    // this method, we touch only the RCode of it, so it should be safe.
+    // The message can contain some data from the protected resource. But
+    // outside this method, we touch only the RCode of it, so it should be
+    // safe.
 
-    // Lock on datasrc_clients_mgr_ acquired by datasrc_holder is
-    // released here upon its deletion.
+    // datasrc_holder stops being a reader of datasrc_clients_mgr_'s client
+    // lists here upon its deletion.
 }
 
 bool
 AuthSrvImpl::processXfrQuery(const IOMessage& io_message, Message& message,
                              OutputBuffer& buffer,
                              auto_ptr<TSIGContext> tsig_context,
-                             MessageAttributes& stats_attrs)
+                             MessageAttributes& stats_attrs,
+                             QueryContext& context)
 {
     if (io_message.getSocket().getProtocol() == IPPROTO_UDP) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_AXFR_UDP);
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::FORMERR(),
                          stats_attrs, tsig_context);
         return (true);
     }
 
+    const Mutex::Locker locker(forwarder_mutex_);
     xfrout_forwarder_->push(io_message);
     return (false);
 }
@@ -694,7 +852,8 @@ bool
 AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
                            OutputBuffer& buffer,
                            std::auto_ptr<TSIGContext> tsig_context,
-                           MessageAttributes& stats_attrs)
+                           MessageAttributes& stats_attrs,
+                           QueryContext& context)
 {
     const IOEndpoint& remote_ep = io_message.getRemoteEndpoint(); // for logs
 
@@ -703,7 +862,7 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_QUESTIONS)
                   .arg(message.getRRCount(Message::SECTION_QUESTION));
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::FORMERR(),
                          stats_attrs, tsig_context);
         return (true);
     }
@@ -711,7 +870,7 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (question->getType() != RRType::SOA()) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_RRTYPE)
                   .arg(question->getType().toText());
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::FORMERR(),
                          stats_attrs, tsig_context);
         return (true);
     }
@@ -725,15 +884,15 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     bool is_auth = false;
     {
         auth::DataSrcClientsMgr::Holder datasrc_holder(datasrc_clients_mgr_);
-        const boost::shared_ptr<datasrc::ClientList> dsrc_clients =
-            datasrc_holder.findClientList(question->getClass());
+        const boost::shared_ptr<datasrc::ConfigurableClientList>&
+            dsrc_clients = datasrc_holder.findClientList(question->getClass());
         is_auth = dsrc_clients &&
             dsrc_clients->find(question->getName(), true, false).exact_match_;
     }
     if (!is_auth) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RECEIVED_NOTIFY_NOTAUTH)
             .arg(question->getName()).arg(question->getClass()).arg(remote_ep);
-        makeErrorMessage(renderer_, message, buffer, Rcode::NOTAUTH(),
+        makeErrorMessage(context.renderer_, message, buffer, Rcode::NOTAUTH(),
                          stats_attrs, tsig_context);
         return (true);
     }
@@ -760,6 +919,9 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
                 command_template_master + remote_ip_address +
                 command_template_rrclass + question->getClass().toText() +
                 command_template_end);
+        // The session can't be shared by multiple threads at the same
+        // time; we need to hold the lock until we get the answer.
+        const Mutex::Locker locker(forwarder_mutex_);
         const unsigned int seq =
             xfrin_session_->group_sendmsg(notify_command, "Zonemgr",
                                           CC_INSTANCE_WILDCARD,
@@ -793,8 +955,8 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     message.setHeaderFlag(Message::HEADERFLAG_AA);
     message.setRcode(Rcode::NOERROR());
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    message.toWire(renderer_, tsig_context.get());
+    RendererHolder holder(context.renderer_, &buffer, stats_attrs);
+    message.toWire(context.renderer_, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
     return (true);
 }
@@ -802,18 +964,62 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
 bool
 AuthSrvImpl::processUpdate(const IOMessage& io_message)
 {
-    // Push the update request to a separate process via the forwarder.
-    // On successful push, the request shouldn't be responded from bundy-auth,
-    // so we return false.
+    // Push the update request to a separate process via the forwarder,
+    // if it's running.
+    const Mutex::Locker locker(forwarder_mutex_);
+    if (!ddns_forwarder_) {
+        return (false);
+    }
     ddns_forwarder_->push(io_message);
-    return (false);
+    return (true);
+}
+
+boost::shared_ptr<TSIGKeyRing>
+AuthSrvImpl::getKeyRing() const {
+    if (keyring_mutex_ != NULL) {
+        const Mutex::Locker locker(*keyring_mutex_);
+        return (*keyring_);
+    }
+    return (*keyring_);
+}
+
+void
+AuthSrvImpl::createWorkers(size_t count, DNSAnswer* answer) {
+    assert(!workers_);
+    vector<AuthWorkers::Providers> providers;
+    for (size_t i = 0; i < count; ++i) {
+        const QueryContextPtr context(new QueryContext);
+        worker_contexts_.push_back(context);
+        const boost::shared_ptr<DNSLookup> lookup(
+            new MessageLookup(this, context.get()));
+        worker_lookups_.push_back(lookup);
+        providers.push_back(AuthWorkers::Providers(lookup.get(), answer));
+    }
+    workers_.reset(new AuthWorkers(providers));
+    workers_->setTCPRecvTimeout(tcp_recv_timeout_);
+}
+
+void
+AuthSrvImpl::destroyWorkers() {
+    workers_.reset();
+    {
+        const Mutex::Locker locker(main_context_.counters_mutex_);
+        BOOST_FOREACH(const QueryContextPtr& context, worker_contexts_) {
+            main_context_.counters_.merge(context->counters_);
+        }
+    }
+    worker_lookups_.clear();
+    worker_contexts_.clear();
 }
 
 void
 AuthSrvImpl::resumeServer(DNSServer* server, Message& message,
                           MessageAttributes& stats_attrs,
-                          const bool done) {
-    counters_.inc(stats_attrs, message, done);
+                          const bool done, QueryContext& context) {
+    {
+        const Mutex::Locker locker(context.counters_mutex_);
+        context.counters_.inc(stats_attrs, message, done);
+    }
     server->resume(done);
 }
 
@@ -833,7 +1039,17 @@ AuthSrv::updateConfig(ConstElementPtr new_config) {
 }
 
 ConstElementPtr AuthSrv::getStatistics() const {
-    return (impl_->counters_.get());
+    // Sum up the counters of all contexts.
+    Counters counters;
+    {
+        const Mutex::Locker locker(impl_->main_context_.counters_mutex_);
+        counters.merge(impl_->main_context_.counters_);
+    }
+    BOOST_FOREACH(const QueryContextPtr& context, impl_->worker_contexts_) {
+        const Mutex::Locker locker(context->counters_mutex_);
+        counters.merge(context->counters_);
+    }
+    return (counters.get());
 }
 
 const AddressList&
@@ -844,9 +1060,13 @@ AuthSrv::getListenAddresses() const {
 void
 AuthSrv::setListenAddresses(const AddressList& addresses) {
     // For UDP servers we specify the "SYNC_OK" option because in our usage
-    // it can act in the synchronous mode.
-    installListenAddresses(addresses, impl_->listen_addresses_, *dnss_,
-                           DNSService::SERVER_SYNC_OK);
+    // it can act in the synchronous mode.  Since the lookup is synchronous
+    // we can also handle multiple queries at once ("BATCH_OK").
+    installListenAddresses(addresses, impl_->listen_addresses_,
+                           impl_->getActiveService(dnss_),
+                           static_cast<DNSService::ServerFlag>(
+                               DNSService::SERVER_SYNC_OK |
+                               DNSService::SERVER_BATCH_OK));
 }
 
 void
@@ -855,13 +1075,17 @@ AuthSrv::setDNSService(bundy::asiodns::DNSServiceBase& dnss) {
 }
 
 void
-AuthSrv::setTSIGKeyRing(const boost::shared_ptr<TSIGKeyRing>* keyring) {
+AuthSrv::setTSIGKeyRing(const boost::shared_ptr<TSIGKeyRing>* keyring,
+                        bundy::util::thread::Mutex* keyring_mutex)
+{
     impl_->keyring_ = keyring;
+    impl_->keyring_mutex_ = keyring_mutex;
 }
 
 void
 AuthSrv::createDDNSForwarder() {
     LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_START_DDNS_FORWARDER);
+    const Mutex::Locker locker(impl_->forwarder_mutex_);
     impl_->ddns_forwarder_.reset(
         new SocketSessionForwarderHolder("update",
                                          impl_->ddns_base_forwarder_));
@@ -869,6 +1093,7 @@ AuthSrv::createDDNSForwarder() {
 
 void
 AuthSrv::destroyDDNSForwarder() {
+    const Mutex::Locker locker(impl_->forwarder_mutex_);
     if (impl_->ddns_forwarder_) {
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_STOP_DDNS_FORWARDER);
         impl_->ddns_forwarder_.reset();
@@ -877,7 +1102,70 @@ AuthSrv::destroyDDNSForwarder() {
 
 void
 AuthSrv::setTCPRecvTimeout(size_t timeout) {
-    dnss_->setTCPRecvTimeout(timeout);
+    impl_->getActiveService(dnss_).setTCPRecvTimeout(timeout);
+    impl_->tcp_recv_timeout_ = timeout;
+}
+
+void
+AuthSrv::setWorkerThreads(size_t count) {
+    if (count == impl_->worker_contexts_.size()) {
+        return;
+    }
+
+    // The listening sockets need to be moved to the new set of services.
+    // We release them from the current one first and request them again
+    // later, so the new services get them from the socket creator.
+    const AddressList addresses(impl_->listen_addresses_);
+    if (!addresses.empty()) {
+        setListenAddresses(AddressList());
+    }
+
+    impl_->destroyWorkers();
+    if (count > 0) {
+        impl_->createWorkers(count, dns_answer_);
+    }
+
+    if (!addresses.empty()) {
+        setListenAddresses(addresses);
+    }
+    LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_WORKER_THREADS_SET).arg(count);
+}
+
+size_t
+AuthSrv::getWorkerThreads() const {
+    return (impl_->worker_contexts_.size());
+}
+
+void
+AuthSrv::setResponseCacheSize(size_t size) {
+    impl_->response_cache_.setMaxEntries(size);
+    LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_RESPONSE_CACHE_SIZE_SET).
+        arg(size);
+}
+
+size_t
+AuthSrv::getResponseCacheSize() const {
+    return (impl_->response_cache_.getMaxEntries());
+}
+
+void
+AuthSrv::invalidateResponseCache(const ConstElementPtr& zone) {
+    if (zone) {
+        try {
+            if (!zone->contains("origin")) {
+                bundy_throw(InvalidParameter, "missing origin");
+            }
+            const Name origin(zone->get("origin")->stringValue());
+            const RRClass rrclass(zone->contains("class") ?
+                                  zone->get("class")->stringValue() : "IN");
+            impl_->response_cache_.invalidate(origin, rrclass);
+            return;
+        } catch (const bundy::Exception&) {
+            // Should have been rejected on loading the zone; just fall
+            // back to the safe side below.
+        }
+    }
+    impl_->response_cache_.clear();
 }
 
 void
@@ -887,7 +1175,9 @@ AuthSrv::zoneUpdated(const std::string& event_name,
     if (event_name == "zone_updated") {
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_RECEIVED_ZONE_UPDATED);
         try {
-            impl_->datasrc_clients_mgr_.updateZone(params);
+            impl_->datasrc_clients_mgr_.updateZone(
+                params, boost::bind(&AuthSrv::invalidateResponseCache, this,
+                                    params));
         } catch (const bundy::Exception& ex) {
             // notify handler seems to assume exception free, so we catch
             // almost everything and log it.
@@ -900,6 +1190,9 @@ AuthSrv::zoneUpdated(const std::string& event_name,
 
 void
 AuthSrv::listsReconfigured(const bundy::data::ConstElementPtr& arg) {
+    // Any of the zones may have changed.
+    impl_->response_cache_.clear();
+
     const bool has_remote = arg->boolValue();
     if (has_remote && !impl_->readers_group_subscribed_) {
         impl_->config_session_->subscribe("SegmentReader");
@@ -924,16 +1217,21 @@ AuthSrv::sendCommandAck(const std::string& cmd, ConstElementPtr params) {
         groupSendMsg(bundy::config::createCommand(cmd, params), "Memmgr");
 }
 
+void
+AuthSrv::segmentUpdated(ConstElementPtr params) {
+    // The new segment may contain new versions of any zones in it.
+    impl_->response_cache_.clear();
+    sendCommandAck("segment_info_update_ack", params);
+}
+
 void
 AuthSrv::foreignCommand(const std::string& command, const std::string&,
                         const ConstElementPtr& params)
 {
     if (command == "segment_info_update") {
         impl_->datasrc_clients_mgr_.
-            segmentInfoUpdate(params, boost::bind(&AuthSrv::sendCommandAck,
-                                                  this,
-                                                  "segment_info_update_ack",
-                                                  params));
+            segmentInfoUpdate(params, boost::bind(&AuthSrv::segmentUpdated,
+                                                  this, params));
     } else if (command == "release_segments") {
         impl_->datasrc_clients_mgr_.releaseSegments(
             params, boost::bind(&AuthSrv::sendCommandAck, this,
@@ -238,8 +238,13 @@ public:
     /// reloading routines of tsig keys replace the actual keyring object.
     /// It is expected the pointer will point to some statically-allocated
     /// object, it doesn't take ownership of it.
+    ///
+    /// If \c keyring_mutex is non NULL, it's locked whenever the shared
+    /// pointer is copied, so the keyring can be safely replaced while
+    /// worker threads are processing queries (see \c setWorkerThreads()).
     void setTSIGKeyRing(const boost::shared_ptr<bundy::dns::TSIGKeyRing>*
-                        keyring);
+                        keyring,
+                        bundy::util::thread::Mutex* keyring_mutex = NULL);
 
     /// \brief Create the internal forwarder for DDNS update messages
     ///
@@ -270,6 +275,59 @@ public:
     /// open forever.
     void setTCPRecvTimeout(size_t timeout);
 
+    /// \brief Set the number of threads processing incoming queries.
+    ///
+    /// If \c count is 0 (which is the initial state), queries are processed
+    /// in the main thread, using the DNS service set by \c setDNSService().
+    /// Otherwise, \c count worker threads are created, each of which has
+    /// its own DNS service listening on the addresses set by
+    /// \c setListenAddresses(), and processes queries in parallel with the
+    /// others.  The main thread then only handles commands and
+    /// configuration updates.
+    ///
+    /// If the number changes, the listening sockets are released and
+    /// requested again for the new set of services.
+    ///
+    /// \throw bundy::server_common::SocketRequestor::NonFatalSocketError
+    /// the listening sockets couldn't be requested again.
+    void setWorkerThreads(size_t count);
+
+    /// \brief Return the number of threads processing incoming queries.
+    ///
+    /// 0 means there's no worker thread; see \c setWorkerThreads().
+    ///
+    /// \throw None
+    size_t getWorkerThreads() const;
+
+    /// \brief Set the maximum number of responses kept in the response
+    /// cache.
+    ///
+    /// If it's 0 (which is the initial state), the cache is disabled.
+    /// Otherwise, responses to normal queries (except those signed with
+    /// TSIG) are kept in the cache, and sent without looking up the data
+    /// sources when the same query is received again.  Cached responses
+    /// are removed when the corresponding zone or the data source
+    /// configuration is updated.
+    ///
+    /// \throw None
+    void setResponseCacheSize(size_t size);
+
+    /// \brief Return the maximum number of responses kept in the response
+    /// cache.
+    ///
+    /// \throw None
+    size_t getResponseCacheSize() const;
+
+    /// \brief Remove responses for a zone from the response cache.
+    ///
+    /// This is called when the update or reload of a zone completes.
+    ///
+    /// \param zone A map of the origin of the zone and its class (optional,
+    /// defaults to IN), as given to the \c loadzone command or the
+    /// \c zone_updated notification.  If it's null or invalid, all
+    /// responses are removed.
+    void invalidateResponseCache(const bundy::data::ConstElementPtr& zone);
+
     /// \brief Notify the authoritative server that the client lists were
     ///     reconfigured.
     ///
@@ -289,6 +347,7 @@ public:
 private:
     void sendCommandAck(const std::string& cmd,
                         bundy::data::ConstElementPtr request);
+    void segmentUpdated(bundy::data::ConstElementPtr params);
     void foreignCommand(const std::string& command, const std::string&,
                         const bundy::data::ConstElementPtr& params);
     AuthSrvImpl* impl_;
@@ -0,0 +1,212 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+
+#include <auth/auth_workers.h>
+#include <auth/auth_log.h>
+
+#include <exceptions/exceptions.h>
+
+#include <asiolink/io_error.h>
+#include <asiolink/io_service.h>
+#include <asiodns/dns_service.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+using namespace bundy::asiodns;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace auth {
+
+// A single worker: a DNS service with its own event loop, run in a
+// separate thread.
+class AuthWorkers::Worker : boost::noncopyable {
+public:
+    Worker(DNSLookup* lookup, DNSAnswer* answer) :
+        dns_service_(io_service_, lookup, answer)
+    {}
+
+    ~Worker() {
+        stop();
+    }
+
+    // Start running the event loop in a new thread.  If there's no server
+    // yet, the thread will soon terminate as there's nothing to do.
+    void start() {
+        // The event loop may have been stopped by a previous call to stop().
+        io_service_.get_io_service().reset();
+        thread_.reset(new Thread(boost::bind(&Worker::run, this)));
+    }
+
+    // Stop the event loop and wait for the thread to terminate.  It's
+    // no-op if the thread hasn't been started.
+    void stop() {
+        if (thread_) {
+            io_service_.stop();
+            thread_->wait();
+            thread_.reset();
+        }
+    }
+
+    // The order matters: dns_service_ must be destroyed first.
+    IOService io_service_;
+    DNSService dns_service_;
+
+private:
+    void run() {
+        // Exceptions from the servers or providers are a sign of serious
+        // problem, but the other workers can keep serving queries.  So we
+        // only log it and let this thread terminate.
+        try {
+            io_service_.run();
+        } catch (const std::exception& ex) {
+            LOG_ERROR(auth_logger, AUTH_WORKER_FAILED).arg(ex.what());
+        }
+    }
+
+    boost::scoped_ptr<Thread> thread_;
+};
+
+// A RAII-style helper to stop all worker threads while modifying the
+// services, and restart them on destruction.
+class AuthWorkers::Pauser : boost::noncopyable {
+public:
+    Pauser(std::vector<WorkerPtr>& workers) : workers_(workers) {
+        BOOST_FOREACH(const WorkerPtr& worker, workers_) {
+            worker->stop();
+        }
+    }
+    ~Pauser() {
+        try {
+            BOOST_FOREACH(const WorkerPtr& worker, workers_) {
+                worker->start();
+            }
+        } catch (const std::exception& ex) {
+            // This can only happen on a system level failure of thread
+            // creation; we can't throw from a destructor, so just log it.
+            LOG_ERROR(auth_logger, AUTH_WORKER_FAILED).arg(ex.what());
+        }
+    }
+private:
+    std::vector<WorkerPtr>& workers_;
+};
+
+AuthWorkers::AuthWorkers(const std::vector<Providers>& providers) {
+    if (providers.empty()) {
+        bundy_throw(InvalidParameter, "no providers for AuthWorkers");
+    }
+    BOOST_FOREACH(const Providers& p, providers) {
+        if (p.first == NULL) {
+            bundy_throw(InvalidParameter,
+                        "null lookup provider given to AuthWorkers");
+        }
+        workers_.push_back(WorkerPtr(new Worker(p.first, p.second)));
+    }
+}
+
+AuthWorkers::~AuthWorkers() {
+    // Explicitly stop all threads before destroying any of the workers,
+    // so no thread could still be using a shared socket.
+    BOOST_FOREACH(const WorkerPtr& worker, workers_) {
+        worker->stop();
+    }
+}
+
+void
+AuthWorkers::addServers(int fd,
+                        const boost::function<void(DNSService&, int)>& adder)
+{
+    const Pauser pauser(workers_);
+
+    // Duplicate the descriptor for all but the first worker beforehand,
+    // so we won't leave a half-configured set of servers on failure of dup.
+    std::vector<int> fds(1, fd);
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        const int new_fd = dup(fd);
+        if (new_fd < 0) {
+            const int error = errno;
+            for (size_t j = 1; j < fds.size(); ++j) {
+                close(fds[j]);
+            }
+            bundy_throw(IOError, "failed to duplicate socket " << fd <<
+                        ": " << std::strerror(error));
+        }
+        fds.push_back(new_fd);
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        try {
+            adder(workers_[i]->dns_service_, fds[i]);
+        } catch (...) {
+            // The original descriptor (fds[0]) is still owned by the caller
+            // in this case; we need to close all others that haven't been
+            // passed to a server.  Servers already added will be cleaned up
+            // with clearServers().
+            for (size_t j = std::max<size_t>(i, 1); j < fds.size(); ++j) {
+                close(fds[j]);
+            }
+            throw;
+        }
+    }
+}
+
+void
+AuthWorkers::addServerTCPFromFD(int fd, int af) {
+    addServers(fd, boost::bind(&DNSService::addServerTCPFromFD, _1, _2, af));
+}
+
+void
+AuthWorkers::addServerUDPFromFD(int fd, int af, ServerFlag options) {
+    addServers(fd, boost::bind(&DNSService::addServerUDPFromFD, _1, _2, af,
+                               options));
+}
+
+void
+AuthWorkers::clearServers() {
+    const Pauser pauser(workers_);
+    BOOST_FOREACH(const WorkerPtr& worker, workers_) {
+        worker->dns_service_.clearServers();
+    }
+}
+
+void
+AuthWorkers::setTCPRecvTimeout(size_t timeout) {
+    const Pauser pauser(workers_);
+    BOOST_FOREACH(const WorkerPtr& worker, workers_) {
+        worker->dns_service_.setTCPRecvTimeout(timeout);
+    }
+}
+
+IOService&
+AuthWorkers::getIOService() {
+    bundy_throw(InvalidOperation,
+                "AuthWorkers doesn't have a single IOService");
+}
+
+} // namespace auth
+} // namespace bundy
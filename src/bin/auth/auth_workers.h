@@ -0,0 +1,144 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_WORKERS_H
+#define AUTH_WORKERS_H 1
+
+#include <asiodns/dns_service.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace asiodns {
+class DNSLookup;
+class DNSAnswer;
+}
+
+namespace auth {
+
+/// \brief A set of threads serving DNS queries in parallel.
+///
+/// An \c AuthWorkers object manages a fixed number of worker threads.
+/// Each worker owns its own \c IOService and \c DNSService, and runs the
+/// event loop of that service in its own thread.  Each worker is given
+/// its own pair of lookup and answer providers on construction, so the
+/// providers can use per-thread resources (message renderer, query
+/// object, statistics counters, etc) without locking.
+///
+/// This class is a \c DNSServiceBase, so it can be passed to the server
+/// configuration routines (see \c installListenAddresses()) in place of
+/// a single \c DNSService.  When a server socket is added, every worker
+/// starts listening on it (for all but the first worker, on a duplicate
+/// of the given file descriptor).  Incoming UDP queries and TCP
+/// connections are therefore distributed over the workers by the kernel,
+/// whichever worker is ready first.
+///
+/// The sockets are shared rather than opened separately per worker with
+/// \c SO_REUSEPORT, because listening sockets are created by the
+/// privileged socket creator on behalf of the server, which only hands
+/// out one socket per address and port.
+///
+/// Adding or removing servers temporarily stops all worker threads, so
+/// it's expected to happen rarely, only on configuration changes.
+///
+/// The object must be created, configured and destroyed in a single
+/// (controlling) thread; the worker threads only run the event loops.
+class AuthWorkers : public bundy::asiodns::DNSServiceBase,
+                    boost::noncopyable
+{
+public:
+    /// \brief Lookup and answer providers for a single worker.
+    typedef std::pair<bundy::asiodns::DNSLookup*,
+                      bundy::asiodns::DNSAnswer*> Providers;
+
+    /// \brief Constructor.
+    ///
+    /// One worker is created for each element of \c providers.  The
+    /// worker threads don't start running until the first server is added.
+    /// The ownership of the providers isn't transferred; they must be
+    /// valid until this object is destroyed.
+    ///
+    /// \throw bundy::InvalidParameter \c providers is empty or contains
+    /// a NULL lookup provider.
+    /// \throw std::bad_alloc memory allocation failure.
+    explicit AuthWorkers(const std::vector<Providers>& providers);
+
+    /// \brief Destructor.
+    ///
+    /// It stops all worker threads and waits for them to terminate.
+    virtual ~AuthWorkers();
+
+    /// \brief Return the number of worker threads.
+    size_t getWorkerCount() const { return (workers_.size()); }
+
+    /// \brief Add a TCP server to each worker.
+    ///
+    /// See \c DNSService::addServerTCPFromFD().  The ownership of
+    /// \c fd is transferred to this object on success.
+    ///
+    /// \throw bundy::asiolink::IOError the file descriptor can't be
+    /// duplicated or used for the server.
+    virtual void addServerTCPFromFD(int fd, int af);
+
+    /// \brief Add a UDP server to each worker.
+    ///
+    /// See \c DNSService::addServerUDPFromFD().  The ownership of
+    /// \c fd is transferred to this object on success.
+    ///
+    /// \throw bundy::asiolink::IOError the file descriptor can't be
+    /// duplicated or used for the server.
+    virtual void addServerUDPFromFD(int fd, int af,
+                                    ServerFlag options = SERVER_DEFAULT);
+
+    /// \brief Remove all servers from all workers.
+    virtual void clearServers();
+
+    /// \brief Set the timeout for TCP DNS services of all workers.
+    virtual void setTCPRecvTimeout(size_t timeout);
+
+    /// \brief Not supported.
+    ///
+    /// There's no single \c IOService shared by the workers, so this
+    /// method always throws.
+    ///
+    /// \throw bundy::InvalidOperation always
+    virtual asiolink::IOService& getIOService();
+
+private:
+    class Worker;
+    class Pauser;
+    typedef boost::shared_ptr<Worker> WorkerPtr;
+
+    // Common part of addServerXXXFromFD.  adder is called for each worker
+    // with its DNS service and the file descriptor to be used for it.
+    void addServers(int fd,
+                    const boost::function<void(bundy::asiodns::DNSService&,
+                                               int)>& adder);
+
+    std::vector<WorkerPtr> workers_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_WORKERS_H
+
+// Local Variables:
+// mode: c++
+// End:
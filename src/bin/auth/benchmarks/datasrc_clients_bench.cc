@@ -0,0 +1,270 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// A benchmark of the contention on the data source client lists of the
+// auth server.  A number of reader threads repeatedly get the client list
+// through DataSrcClientsMgr::Holder and find a zone in it, as query
+// processing threads do, while the main thread periodically replaces the
+// client lists, as the builder thread does on reconfiguration.  It reports
+// the lookup rate of the readers and how long the replacements took.
+//
+// With -l, the readers also lock a single mutex for each lookup, which
+// emulates the holders before they became lock-free, for comparison.
+
+#include <config.h>
+
+#include <auth/datasrc_clients_mgr.h>
+#include <auth/datasrc_config.h>
+
+#include <asiolink/io_service.h>
+#include <cc/data.h>
+#include <datasrc/client_list.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <log/logger_support.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using namespace bundy;
+using namespace bundy::auth;
+using namespace bundy::data;
+using namespace bundy::dns;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace {
+
+const char* const DEFAULT_ZONE_FILE = "datasrc_clients_bench.zone";
+const int ZONE_COUNT = 100;
+
+void
+usage() {
+    std::cerr << "Usage: datasrc_clients_bench [-l] [-d duration] "
+              << "[-f zone_file] [-r interval] [-t threads]" << std::endl;
+    std::cerr << "  -l: lock a mutex for each lookup, as the holders used to"
+              << std::endl;
+    std::cerr << "  -d: seconds to run (default 5)" << std::endl;
+    std::cerr << "  -r: milliseconds between replacements of the client "
+              << "lists, 0 for none (default 10)" << std::endl;
+    std::cerr << "  -t: number of reader threads (default 4)" << std::endl;
+    exit(1);
+}
+
+double
+getTime() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+// Write a zone file that serves as the zones of the client list; all the
+// zones have the same content, which doesn't matter here.
+void
+createZoneFile(const string& filename) {
+    std::ofstream ofs(filename.c_str(), std::ios::trunc);
+    ofs << "@ 3600 IN SOA ns.example. admin.example. 1 3600 900 604800 3600"
+        << std::endl;
+    ofs << "@ 3600 IN NS ns.example." << std::endl;
+    ofs << "www 3600 IN A 192.0.2.1" << std::endl;
+    if (!ofs) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        exit(1);
+    }
+}
+
+Name
+getZoneName(int i) {
+    return (Name("zone" + boost::lexical_cast<string>(i) + ".example"));
+}
+
+datasrc::ClientListMapPtr
+createClientLists(const string& zone_file) {
+    string params;
+    for (int i = 0; i < ZONE_COUNT; ++i) {
+        params += string(i > 0 ? ", " : "") + "\"" +
+            getZoneName(i).toText() + "\": \"" + zone_file + "\"";
+    }
+    return (configureDataSource(
+                Element::fromJSON("{\"IN\": [{\"type\": \"MasterFiles\", "
+                                  "\"cache-enable\": true, "
+                                  "\"params\": {" + params + "}}]}")));
+}
+
+struct ReaderContext {
+    ReaderContext(DataSrcClientsMgr* mgr, Mutex* mutex, const bool* stop) :
+        mgr(mgr), mutex(mutex), stop(stop), lookups(0)
+    {}
+    DataSrcClientsMgr* mgr;
+    Mutex* mutex;               // lock this for each lookup unless NULL
+    const bool* stop;
+    size_t lookups;
+};
+
+void
+lookup(DataSrcClientsMgr& mgr, const vector<Name>& qnames, size_t i) {
+    DataSrcClientsMgr::Holder holder(mgr);
+    const boost::shared_ptr<datasrc::ConfigurableClientList>& list =
+        holder.findClientList(RRClass::IN());
+    if (!list || !list->find(qnames[i % qnames.size()], false, false).
+        exact_match_) {
+        std::cerr << "Lookup failed" << std::endl;
+        exit(1);
+    }
+}
+
+void
+runReader(ReaderContext* context) {
+    vector<Name> qnames;
+    for (int i = 0; i < ZONE_COUNT; ++i) {
+        qnames.push_back(getZoneName(i));
+    }
+    size_t i = 0;
+    while (!__atomic_load_n(context->stop, __ATOMIC_RELAXED)) {
+        if (context->mutex) {
+            Mutex::Locker locker(*context->mutex);
+            lookup(*context->mgr, qnames, i);
+        } else {
+            lookup(*context->mgr, qnames, i);
+        }
+        ++i;
+    }
+    context->lookups = i;
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    bool lock = false;
+    int duration = 5;
+    string zone_file = DEFAULT_ZONE_FILE;
+    int interval = 10;
+    int thread_count = 4;
+    while ((ch = getopt(argc, argv, "ld:f:r:t:")) != -1) {
+        switch (ch) {
+        case 'l':
+            lock = true;
+            break;
+        case 'd':
+            duration = atoi(optarg);
+            break;
+        case 'f':
+            zone_file = optarg;
+            break;
+        case 'r':
+            interval = atoi(optarg);
+            break;
+        case 't':
+            thread_count = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || duration <= 0 || interval < 0 || thread_count <= 0) {
+        usage();
+    }
+
+    bundy::log::initLogger("datasrc-clients-bench", bundy::log::WARN);
+
+    createZoneFile(zone_file);
+    asiolink::IOService io_service;
+    DataSrcClientsMgr mgr(io_service);
+    mgr.setDataSrcClientLists(createClientLists(zone_file));
+    // Prepare the lists beforehand, so we only measure replacing them.
+    vector<datasrc::ClientListMapPtr> client_lists;
+    const size_t max_replacements =
+        interval > 0 ? duration * 1000 / interval + 1 : 0;
+    for (size_t i = 0; i < std::min<size_t>(max_replacements, 100); ++i) {
+        client_lists.push_back(createClientLists(zone_file));
+    }
+
+    Mutex mutex;
+    bool stop = false;
+    vector<ReaderContext> contexts(thread_count,
+                                   ReaderContext(&mgr, lock ? &mutex : NULL,
+                                                 &stop));
+    vector<boost::shared_ptr<Thread> > threads;
+    const double start = getTime();
+    for (int i = 0; i < thread_count; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+                              new Thread(boost::bind(runReader,
+                                                     &contexts[i]))));
+    }
+
+    // Replace the lists periodically until the end; each list is swapped
+    // back in again and again, as setDataSrcClientLists() doesn't care.
+    size_t replacements = 0;
+    double replace_time = 0, max_replace_time = 0;
+    while (getTime() - start < duration) {
+        if (interval == 0) {
+            usleep(100000);
+            continue;
+        }
+        usleep(interval * 1000);
+        datasrc::ClientListMapPtr lists =
+            client_lists[replacements % client_lists.size()];
+        const double replace_start = getTime();
+        if (lock) {
+            Mutex::Locker locker(mutex);
+            mgr.setDataSrcClientLists(lists);
+        } else {
+            mgr.setDataSrcClientLists(lists);
+        }
+        const double elapsed = getTime() - replace_start;
+        replace_time += elapsed;
+        max_replace_time = std::max(max_replace_time, elapsed);
+        ++replacements;
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    size_t lookups = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        threads[i]->wait();
+        lookups += contexts[i].lookups;
+    }
+    const double elapsed = getTime() - start;
+    unlink(zone_file.c_str());
+
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << thread_count << " readers" << (lock ? " (locking)" : "")
+              << ": " << lookups / elapsed << " lookups/s, "
+              << lookups / elapsed / thread_count << " per reader"
+              << std::endl;
+    if (replacements > 0) {
+        std::cout << std::setprecision(1);
+        std::cout << replacements << " replacements: "
+                  << replace_time / replacements * 1000000 << "us average, "
+                  << max_replace_time * 1000000 << "us max" << std::endl;
+    }
+
+    return (0);
+}
@@ -25,6 +25,8 @@
 
 #include <string>
 
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -152,6 +154,50 @@ public:
     }
 };
 
+// Handle the "getcachestats" command.  It returns the memory used by each
+// zone in the in-memory cache and the time it took to load it, per data
+// source (whose cache segment is in use) and RR class:
+// {"IN": {"datasrc name": {"segment-type": "local", "memory": total size,
+//                          "zones": {"zone name": {"memory": size,
+//                                                  "load-time": usec}}}}}
+class GetCacheStatsCommand : public AuthCommand {
+public:
+    virtual ConstElementPtr exec(AuthSrv& server,
+                                 bundy::data::ConstElementPtr)
+    {
+        const ElementPtr stats = Element::createMap();
+        const DataSrcClientsMgr::Holder holder(server.getDataSrcClientsMgr());
+        BOOST_FOREACH(const RRClass& rrclass, holder.getClasses()) {
+            const ElementPtr class_stats = Element::createMap();
+            BOOST_FOREACH(const DataSourceStatus& status,
+                          holder.findClientList(rrclass)->getStatus(true)) {
+                if (status.getSegmentState() != SEGMENT_INUSE) {
+                    continue;
+                }
+                const ElementPtr zones = Element::createMap();
+                BOOST_FOREACH(const CachedZoneStatus& zone,
+                              status.getZoneStatus()) {
+                    const ElementPtr zone_stats = Element::createMap();
+                    zone_stats->set("memory", Element::create(
+                        static_cast<int64_t>(zone.getMemorySize())));
+                    zone_stats->set("load-time", Element::create(
+                        static_cast<int64_t>(zone.getLoadTime())));
+                    zones->set(zone.getName().toText(), zone_stats);
+                }
+                const ElementPtr dsrc_stats = Element::createMap();
+                dsrc_stats->set("segment-type",
+                                Element::create(status.getSegmentType()));
+                dsrc_stats->set("memory", Element::create(
+                    static_cast<int64_t>(status.getMemorySize())));
+                dsrc_stats->set("zones", zones);
+                class_stats->set(status.getName(), dsrc_stats);
+            }
+            stats->set(rrclass.toText(), class_stats);
+        }
+        return (createAnswer(0, stats));
+    }
+};
+
 class StartDDNSForwarderCommand : public AuthCommand {
 public:
     virtual ConstElementPtr exec(AuthSrv& server,
@@ -176,7 +222,11 @@ public:
     virtual ConstElementPtr exec(AuthSrv& server,
                                  bundy::data::ConstElementPtr args)
     {
-        server.getDataSrcClientsMgr().loadZone(args);
+        // Cached responses for the zone must be removed once the new
+        // version is available.
+        server.getDataSrcClientsMgr().loadZone(
+            args, boost::bind(&AuthSrv::invalidateResponseCache, &server,
+                              args));
         return (createAnswer());
     }
 };
@@ -190,6 +240,8 @@ createAuthCommand(const string& command_id) {
         return (new ShutdownCommand());
     } else if (command_id == "getstats") {
         return (new GetStatsCommand());
+    } else if (command_id == "getcachestats") {
+        return (new GetCacheStatsCommand());
     } else if (command_id == "loadzone") {
         return (new LoadZoneCommand());
     } else if (command_id == "start_ddns_forwarder") {
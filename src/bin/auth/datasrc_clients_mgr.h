@@ -17,6 +17,7 @@
 
 #include <util/threads/thread.h>
 #include <util/threads/sync.h>
+#include <util/threads/epoch.h>
 
 #include <log/logger_support.h>
 #include <log/log_dbglevels.h>
@@ -136,6 +137,60 @@ struct Command {
     FinishedCallback callback;
 };
 
+/// \brief The data source client lists as seen by the readers.
+///
+/// The readers of the client lists (query processing threads, through
+/// \c DataSrcClientsMgrBase::Holder) get the current clients map from
+/// this object without taking any lock.  The manager and the builder keep
+/// owning the map with their \c ClientListMapPtr, and publish it here
+/// whenever they replace it; they then call \c synchronize() before they
+/// release the old map.  Changes to the client lists of the published map
+/// (such as resetting a memory segment or installing a new version of a
+/// zone) are made within an \c util::thread::EpochDomain::Writer of
+/// \c getReaders().
+class PublishedClientLists : boost::noncopyable {
+public:
+    /// \brief The type of the published clients map.
+    typedef datasrc::ClientListMapPtr::element_type ClientListsMap;
+
+    /// \brief Constructor.
+    ///
+    /// \param clients_map The initial clients map to be published.
+    /// \throw std::bad_alloc memory allocation failure.
+    explicit PublishedClientLists(const datasrc::ClientListMapPtr&
+                                  clients_map) :
+        clients_map_(clients_map.get())
+    {}
+
+    /// \brief Return the reader domain of the published map.
+    util::thread::EpochDomain& getReaders() { return (readers_); }
+
+    /// \brief Return the currently published clients map.
+    ///
+    /// This must be called, and the returned map can be used, only within
+    /// a \c util::thread::EpochDomain::Reader of \c getReaders().
+    const ClientListsMap* getClientsMap() const {
+        return (util::thread::EpochDomain::load(clients_map_));
+    }
+
+    /// \brief Publish a new clients map.
+    ///
+    /// Readers that start after this see the new map.  The caller must
+    /// keep the previous map until \c synchronize() returns.
+    void publish(const datasrc::ClientListMapPtr& clients_map) {
+        const ClientListsMap* const map = clients_map.get();
+        util::thread::EpochDomain::publish(clients_map_, map);
+    }
+
+    /// \brief Wait until no reader can be using a map that is no longer
+    /// published.
+    void synchronize() { readers_.synchronize(); }
+
+private:
+    util::thread::EpochDomain readers_;
+    const ClientListsMap* clients_map_;
+};
+
 } // namespace datasrc_clientmgr_internal
 
 /// \brief Frontend to the manager object for data source clients.
@@ -192,15 +247,25 @@ public:
     /// causing a race condition with other threads that can possibly use
     /// the same manager throughout the lifetime of the holder object.
     ///
+    /// The holder doesn't acquire any lock (normally; see below), so any
+    /// number of threads can have holders of the same manager at the same
+    /// time without contending with each other.  It registers the
+    /// calling thread as a reader of the current client lists instead,
+    /// and the builder waits for such readers before it releases or
+    /// modifies the lists.  Only while the builder modifies the current
+    /// lists in place (resetting a memory segment or installing a new
+    /// version of a zone) the construction of a holder blocks.
+    ///
     /// This also means the holder object is expected to have a short lifetime.
     /// The application shouldn't try to keep it unnecessarily long.
     /// It's normally expected to create the holder object on the stack
     /// of a small scope and automatically let it be destroyed at the end
-    /// of the scope.
-    class Holder {
+    /// of the scope.  Holders must not be nested in a single thread.
+    class Holder : boost::noncopyable {
     public:
         Holder(DataSrcClientsMgrBase& mgr) :
-            mgr_(mgr), locker_(mgr_.map_mutex_)
+            reader_(mgr.published_lists_.getReaders()),
+            clients_map_(mgr.published_lists_.getClientsMap())
         {}
 
         /// \brief Find a data source client list of a specified RR class.
@@ -210,6 +275,10 @@ public:
         /// the pointed object.  Also, it's not safe to get access to the
         /// object beyond the scope of the holder object.
         ///
+        /// The returned pointer is a reference to the one stored in the
+        /// manager, so it's not copied (which would update the reference
+        /// counter shared by all threads) unless the caller copies it.
+        ///
         /// \note Since the ownership isn't transferred the return value
         /// could be a bare pointer (and it's probably better in several
         /// points).  Unfortunately, some unit tests currently don't work
@@ -218,13 +287,14 @@ public:
         /// for now.  We should eventually fix it and change the return value
         /// type (see Trac ticket #2395).  Other applications must not
         /// assume the ownership is actually shared.
-        boost::shared_ptr<datasrc::ConfigurableClientList> findClientList(
-            const dns::RRClass& rrclass)
-        {
+        const boost::shared_ptr<datasrc::ConfigurableClientList>&
+        findClientList(const dns::RRClass& rrclass) const {
+            static const boost::shared_ptr<datasrc::ConfigurableClientList>
+                null_list;
             const ClientListsMap::const_iterator
-                it = mgr_.clients_map_->find(rrclass);
-            if (it == mgr_.clients_map_->end()) {
-                return (boost::shared_ptr<datasrc::ConfigurableClientList>());
+                it = clients_map_->find(rrclass);
+            if (it == clients_map_->end()) {
+                return (null_list);
             } else {
                 return (it->second);
             }
@@ -240,16 +310,15 @@ public:
         /// \throw std::bad_alloc for problems allocating the result.
         std::vector<dns::RRClass> getClasses() const {
             std::vector<dns::RRClass> result;
-            for (ClientListsMap::const_iterator it =
-                 mgr_.clients_map_->begin(); it != mgr_.clients_map_->end();
-                 ++it) {
+            for (ClientListsMap::const_iterator it = clients_map_->begin();
+                 it != clients_map_->end(); ++it) {
                 result.push_back(it->first);
             }
             return (result);
         }
     private:
-        DataSrcClientsMgrBase& mgr_;
-        typename MutexType::Locker locker_;
+        const util::thread::EpochDomain::Reader reader_;
+        const ClientListsMap* const clients_map_;
     };
 
     /// \brief Constructor.
@@ -266,10 +335,11 @@ public:
     /// \throw bundy::Unexpected general unexpected system errors.
     DataSrcClientsMgrBase(asiolink::IOService& service) :
         clients_map_(new ClientListsMap),
+        published_lists_(clients_map_),
         fd_guard_(new FDGuard(this)),
         read_fd_(-1), write_fd_(-1),
         builder_(&command_queue_, &callback_queue_, &cond_, &queue_mutex_,
-                 &clients_map_, &map_mutex_, createFds()),
+                 &clients_map_, &map_mutex_, &published_lists_, createFds()),
         builder_thread_(boost::bind(&BuilderType::run, &builder_)),
         wakeup_socket_(service, read_fd_)
     {
@@ -351,9 +421,17 @@ public:
     /// This is provided only for some existing tests until we support a
     /// cleaner way to use faked data source clients.  Non test code or
     /// newer tests must not use this.
+    ///
+    /// This must not be called while the calling thread has a \c Holder.
     void setDataSrcClientLists(datasrc::ClientListMapPtr new_lists) {
-        typename MutexType::Locker locker(map_mutex_);
-        clients_map_ = new_lists;
+        {
+            typename MutexType::Locker locker(map_mutex_);
+            clients_map_.swap(new_lists);
+            published_lists_.publish(clients_map_);
+        }
+        // The old lists (now in new_lists) are released on return, after
+        // readers have stopped using them.
+        published_lists_.synchronize();
     }
 
     /// \brief Instruct internal thread to (re)load a zone
@@ -377,9 +455,20 @@ public:
                            callback);
     }
 
-    void updateZone(const data::ConstElementPtr& args) {
+    /// \brief Instruct internal thread to update a zone
+    ///
+    /// This is similar to \c loadZone(), but for the "zone_updated"
+    /// notification from other modules.
+    ///
+    /// \param args Same as for \c loadZone().
+    /// \param callback Called once the update completes, in the main thread.
+    ///     It should be exceptionless.
+    void updateZone(const data::ConstElementPtr& args,
+                    const datasrc_clientmgr_internal::FinishedCallback&
+                    callback = datasrc_clientmgr_internal::FinishedCallback())
+    {
         updateZoneInternal(datasrc_clientmgr_internal::UPDATEZONE, args,
-                           datasrc_clientmgr_internal::FinishedCallback());
+                           callback);
     }
 
     void segmentInfoUpdate(const data::ConstElementPtr& args,
@@ -565,9 +654,12 @@ private:
     MutexType queue_mutex_;     // mutex to protect the queue
     datasrc::ClientListMapPtr clients_map_;
                                 // map of actual data source client objects
+    // clients_map_ as seen by the holders
+    datasrc_clientmgr_internal::PublishedClientLists published_lists_;
     boost::scoped_ptr<FDGuard> fd_guard_; // A guard to close the fds.
     int read_fd_, write_fd_;    // Descriptors for wakeup
-    MutexType map_mutex_;       // mutex to protect the clients map
+    MutexType map_mutex_;       // mutex to serialize updates to the clients
+                                // map (holders don't use it)
 
     BuilderType builder_;
     ThreadType builder_thread_; // for safety this should be placed last
@@ -622,11 +714,13 @@ public:
                               CondVarType* cond, MutexType* queue_mutex,
                               datasrc::ClientListMapPtr* clients_map,
                               MutexType* map_mutex,
+                              PublishedClientLists* published_lists,
                               int wake_fd
         ) :
         command_queue_(command_queue), callback_queue_(callback_queue),
         cond_(cond), queue_mutex_(queue_mutex),
-        clients_map_(clients_map), map_mutex_(map_mutex), wake_fd_(wake_fd),
+        clients_map_(clients_map), map_mutex_(map_mutex),
+        published_lists_(published_lists), wake_fd_(wake_fd),
         gen_id_(-1)
     {}
 
@@ -682,14 +776,16 @@ private:
     // Swap pending clients map with the current when all waiting memory
     // segments are ready.
     void installClientsMap() {
-        // Define new_clients_map outside of the block that has the lock scope;
-        // this way, after the swap, the lock is guaranteed to be released
-        // before the old data is destroyed, minimizing the lock duration.
         {
             typename MutexType::Locker locker(*map_mutex_);
             pending_map_->clients_map_.swap(*clients_map_);
+            published_lists_->publish(*clients_map_);
         } // lock is released by leaving scope
-          // old clients_map_ data is released by leaving scope
+
+        // The old clients_map_ data (now in pending_map_) is released
+        // below; readers may still be using it until this returns.  They
+        // are not blocked meanwhile.
+        published_lists_->synchronize();
 
         if (pending_callback_) {
             callbacks_.push_back(FinishedCallbackPair(pending_callback_,
@@ -807,7 +903,16 @@ private:
             }
         }
 
+        // Readers may be using the segment of the current map, so they
+        // have to be excluded while it's reset.  A pending map isn't
+        // visible to them, and resetting a segment can take time, so we
+        // don't block them for that.
         typename MutexType::Locker locker(*map_mutex_);
+        boost::scoped_ptr<util::thread::EpochDomain::Writer> writer;
+        if (&clients_map == clients_map_->get()) {
+            writer.reset(new util::thread::EpochDomain::Writer(
+                             published_lists_->getReaders()));
+        }
         if (!list->resetMemorySegment(
                 dsrc_name, bundy::datasrc::memory::ZoneTableSegment::READ_ONLY,
                 segment_params)) {
@@ -888,6 +993,7 @@ private:
     MutexType* queue_mutex_;
     datasrc::ClientListMapPtr* clients_map_;
     MutexType* map_mutex_;
+    PublishedClientLists* published_lists_;
     int wake_fd_;
 
     // These are local to the builder thread:
@@ -1086,6 +1192,8 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::doUpdateZone(
         zwriter->load(); // this can take time but doesn't cause a race
         {   // install() can cause a race and must be in a critical section
             typename MutexType::Locker locker(*map_mutex_);
+            const util::thread::EpochDomain::Writer writer(
+                published_lists_->getReaders());
             zwriter->install();
         }
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS,
@@ -1123,6 +1231,8 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::getZoneWriter(
     datasrc::ConfigurableClientList::ZoneWriterPair writerpair;
     {
         typename MutexType::Locker locker(*map_mutex_);
+        const util::thread::EpochDomain::Writer writer(
+            published_lists_->getReaders());
         writerpair = client_list.getCachedZoneWriter(origin, false,
                                                      datasrc_name);
     }
@@ -0,0 +1,261 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/response_cache.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/edns.h>
+#include <dns/question.h>
+#include <dns/rrtype.h>
+
+#include <util/threads/sync.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <list>
+#include <vector>
+
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace auth {
+
+namespace {
+// Offset of the question section (i.e., the query name) in a message.
+const size_t QNAME_OFFSET = 12;
+
+// Bits of the flags in the key.
+const uint8_t KEY_EDNS = 0x01;
+const uint8_t KEY_DO = 0x02;
+const uint8_t KEY_RD = 0x04;
+const uint8_t KEY_CD = 0x08;
+
+// A cached response.
+struct Entry {
+    Entry(const std::string& key, const Name& qname, const RRClass& qclass,
+          const void* data, size_t length) :
+        key_(key), qname_(qname), qclass_(qclass),
+        data_(static_cast<const uint8_t*>(data),
+              static_cast<const uint8_t*>(data) + length)
+    {}
+    const std::string key_;
+    // Query name and class, used for invalidation.
+    const Name qname_;
+    const RRClass qclass_;
+    const std::vector<uint8_t> data_;
+};
+typedef std::list<Entry> EntryList;
+typedef boost::unordered_map<std::string, EntryList::iterator> EntryMap;
+}
+
+// A part of the cache protected by a single lock.  entries_ is ordered from
+// the most recently used one to the least recently used one, and map_
+// indexes them by the key.
+struct ResponseCache::Shard {
+    Shard() : max_entries_(0), generation_(0) {}
+
+    // Remove the least recently used entries until the number of entries
+    // is within the limit.  The mutex must be held.
+    void trim() {
+        while (map_.size() > max_entries_) {
+            map_.erase(entries_.back().key_);
+            entries_.pop_back();
+        }
+    }
+
+    Mutex mutex_;
+    EntryList entries_;
+    EntryMap map_;
+    size_t max_entries_;
+    // Incremented each time the shard is invalidated, to detect responses
+    // built from the data before the invalidation.
+    uint64_t generation_;
+};
+
+ResponseCache::Key::Key(const Message& query, uint16_t max_size) :
+    qname_((*query.beginQuestion())->getName()),
+    qclass_((*query.beginQuestion())->getClass()),
+    generation_(0)
+{
+    const ConstQuestionPtr& question = *query.beginQuestion();
+    const size_t name_length = qname_.getLength();
+    data_.reserve(name_length + 7);
+
+    // The query name in the lower case.  The labels in the wire format
+    // also contain the length octets, but those are 63 or less and are
+    // never changed by the conversion.
+    for (size_t i = 0; i < name_length; ++i) {
+        const uint8_t c = qname_.at(i);
+        data_.push_back((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+    }
+
+    const uint16_t qtype = question->getType().getCode();
+    const uint16_t qclass = qclass_.getCode();
+    data_.push_back(qtype >> 8);
+    data_.push_back(qtype & 0xff);
+    data_.push_back(qclass >> 8);
+    data_.push_back(qclass & 0xff);
+
+    uint8_t flags = 0;
+    const ConstEDNSPtr edns = query.getEDNS();
+    if (edns) {
+        flags |= KEY_EDNS;
+        if (edns->getDNSSECAwareness()) {
+            flags |= KEY_DO;
+        }
+    }
+    if (query.getHeaderFlag(Message::HEADERFLAG_RD)) {
+        flags |= KEY_RD;
+    }
+    if (query.getHeaderFlag(Message::HEADERFLAG_CD)) {
+        flags |= KEY_CD;
+    }
+    data_.push_back(flags);
+    data_.push_back(max_size >> 8);
+    data_.push_back(max_size & 0xff);
+
+    hash_ = boost::hash<std::string>()(data_);
+}
+
+ResponseCache::ResponseCache(size_t max_entries) :
+    shards_(new Shard[SHARD_COUNT]), max_entries_(0)
+{
+    setMaxEntries(max_entries);
+}
+
+ResponseCache::~ResponseCache() {
+}
+
+ResponseCache::Shard&
+ResponseCache::getShard(const Key& key) {
+    return (shards_[key.hash_ % SHARD_COUNT]);
+}
+
+ResponseCache::Result
+ResponseCache::lookup(Key& key, qid_t qid, OutputBuffer& buffer) {
+    Shard& shard = getShard(key);
+    const Mutex::Locker locker(shard.mutex_);
+    if (shard.max_entries_ == 0) {
+        return (DISABLED);
+    }
+    key.generation_ = shard.generation_;
+
+    const EntryMap::iterator found = shard.map_.find(key.data_);
+    if (found == shard.map_.end()) {
+        return (MISS);
+    }
+
+    // Make it the most recently used one.
+    const EntryList::iterator entry = found->second;
+    shard.entries_.splice(shard.entries_.begin(), shard.entries_, entry);
+
+    const size_t offset = buffer.getLength();
+    buffer.writeData(&entry->data_[0], entry->data_.size());
+    buffer.writeUint16At(qid, offset);
+    const size_t name_length = key.qname_.getLength();
+    for (size_t i = 0; i < name_length; ++i) {
+        buffer.writeUint8At(key.qname_.at(i), offset + QNAME_OFFSET + i);
+    }
+    return (HIT);
+}
+
+void
+ResponseCache::insert(const Key& key, const void* data, size_t length) {
+    if (length < QNAME_OFFSET + key.qname_.getLength()) {
+        bundy_throw(bundy::InvalidParameter,
+                    "Too short response for the cache: " << length);
+    }
+
+    Shard& shard = getShard(key);
+    const Mutex::Locker locker(shard.mutex_);
+    if (shard.max_entries_ == 0 || key.generation_ != shard.generation_) {
+        return;
+    }
+    const EntryMap::iterator found = shard.map_.find(key.data_);
+    if (found != shard.map_.end()) {
+        // Someone else has stored it in the meantime.  The data should be
+        // the same; just replace it.
+        shard.entries_.erase(found->second);
+        shard.map_.erase(found);
+    }
+    shard.entries_.push_front(Entry(key.data_, key.qname_, key.qclass_, data,
+                                    length));
+    shard.map_[key.data_] = shard.entries_.begin();
+    shard.trim();
+}
+
+void
+ResponseCache::invalidate(const Name& origin, const RRClass& rrclass) {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shards_[i];
+        const Mutex::Locker locker(shard.mutex_);
+        ++shard.generation_;
+        EntryList::iterator it = shard.entries_.begin();
+        while (it != shard.entries_.end()) {
+            const NameComparisonResult::NameRelation relation =
+                it->qname_.compare(origin).getRelation();
+            if (it->qclass_ == rrclass &&
+                (relation == NameComparisonResult::EQUAL ||
+                 relation == NameComparisonResult::SUBDOMAIN)) {
+                shard.map_.erase(it->key_);
+                it = shard.entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void
+ResponseCache::clear() {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shards_[i];
+        const Mutex::Locker locker(shard.mutex_);
+        ++shard.generation_;
+        shard.map_.clear();
+        shard.entries_.clear();
+    }
+}
+
+void
+ResponseCache::setMaxEntries(size_t max_entries) {
+    // Distribute the entries to the shards, rounding up so that a small
+    // non-zero limit doesn't disable the cache.
+    const size_t shard_max = (max_entries + SHARD_COUNT - 1) / SHARD_COUNT;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shards_[i];
+        const Mutex::Locker locker(shard.mutex_);
+        shard.max_entries_ = shard_max;
+        shard.trim();
+    }
+    max_entries_ = max_entries;
+}
+
+size_t
+ResponseCache::getSize() const {
+    size_t size = 0;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shards_[i];
+        const Mutex::Locker locker(shard.mutex_);
+        size += shard.map_.size();
+    }
+    return (size);
+}
+
+} // namespace auth
+} // namespace bundy
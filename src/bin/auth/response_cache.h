@@ -0,0 +1,174 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_RESPONSE_CACHE_H
+#define AUTH_RESPONSE_CACHE_H 1
+
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <util/buffer.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <string>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace auth {
+
+/// \brief A cache of rendered responses to normal queries.
+///
+/// This class keeps responses in the wire format, keyed on the parameters
+/// of a query that determine the content of the response: the query name
+/// (compared case-insensitively), type and class, whether the query has
+/// EDNS and its DO bit, the RD and CD bits of the header, and the maximum
+/// size of the response.  When the same query is received again, the
+/// cached response is copied to the output buffer, and only the query ID
+/// and the case of the query name are adjusted to the new query.
+///
+/// The cache is shared by all query processing threads, and all public
+/// methods are thread safe.  Internally, it's split into a fixed number of
+/// shards (selected by the hash of the key), each of which is protected by
+/// its own lock, so concurrent lookups for different names rarely contend.
+/// Each shard holds at most its share of the maximum number of entries,
+/// and when it's full the least recently used entry is removed.
+///
+/// It's the caller's responsibility to remove cached responses when the
+/// underlying data changes, using \c invalidate() or \c clear().  To avoid
+/// caching a response built from the older version of the data, a response
+/// isn't stored by \c insert() if the cache has been invalidated since the
+/// corresponding \c lookup().  So the data must be updated before the
+/// cache is invalidated.
+///
+/// Responses that depend on something other than the key (e.g., those
+/// signed with TSIG) must not be stored in this cache.
+class ResponseCache : boost::noncopyable {
+public:
+    /// \brief Parameters of a query to identify its response in the cache.
+    ///
+    /// This is a short term object, which must not outlive the query
+    /// message from which it's constructed.
+    class Key {
+    public:
+        /// \brief Constructor.
+        ///
+        /// \param query The parsed query message.  It must have exactly
+        ///     one question.  Note that \c Message::makeResponse() clears
+        ///     EDNS and some of the header flags, so it must be called
+        ///     after constructing the key.
+        /// \param max_size The maximum size of the response.
+        Key(const bundy::dns::Message& query, uint16_t max_size);
+
+    private:
+        friend class ResponseCache;
+
+        const bundy::dns::Name& qname_;
+        const bundy::dns::RRClass qclass_;
+        std::string data_;
+        size_t hash_;
+        // The generation of the shard at the time of lookup().
+        uint64_t generation_;
+    };
+
+    /// \brief Result of \c lookup().
+    enum Result {
+        HIT,                ///< The response is found in the cache
+        MISS,               ///< The response isn't found
+        DISABLED            ///< The cache is disabled (the maximum number of
+                            ///< entries is 0)
+    };
+
+    /// \brief Constructor.
+    ///
+    /// \param max_entries The maximum number of responses to keep.  If
+    ///     it's 0, the cache is disabled.
+    explicit ResponseCache(size_t max_entries = 0);
+
+    /// \brief Destructor.
+    ~ResponseCache();
+
+    /// \brief Find a response in the cache.
+    ///
+    /// If found, the response is appended to the given buffer, with the
+    /// query ID and the query name (in the question section) replaced with
+    /// the given ones.  The state of the cache at the time of lookup is
+    /// remembered in \c key for the subsequent call to \c insert().
+    ///
+    /// \param key The key of the query.
+    /// \param qid The ID of the query.
+    /// \param buffer The buffer to which the response is written.
+    /// \return The result of the lookup.
+    Result lookup(Key& key, bundy::dns::qid_t qid,
+                  bundy::util::OutputBuffer& buffer);
+
+    /// \brief Store a response in the cache.
+    ///
+    /// \c key must have been passed to \c lookup() beforehand, which returned
+    /// \c MISS.  If the cache has been invalidated or cleared since then,
+    /// the response is ignored, since it may have been built from outdated
+    /// data.
+    ///
+    /// \param key The key of the query.
+    /// \param data The response in the wire format.
+    /// \param length The length of data.
+    void insert(const Key& key, const void* data, size_t length);
+
+    /// \brief Remove all responses for names in a zone.
+    ///
+    /// All responses whose query name is equal to or a subdomain of the
+    /// origin of the zone (and whose query class is the zone's class) are
+    /// removed.  This can also remove responses from other zones under the
+    /// zone (i.e., its subzones), but that's harmless.
+    ///
+    /// \param origin The origin name of the zone.
+    /// \param rrclass The RR class of the zone.
+    void invalidate(const bundy::dns::Name& origin,
+                    const bundy::dns::RRClass& rrclass);
+
+    /// \brief Remove all responses.
+    void clear();
+
+    /// \brief Change the maximum number of responses to keep.
+    ///
+    /// If the cache contains more responses than the new limit, the least
+    /// recently used ones are removed.  If it's 0, the cache is disabled
+    /// and all responses are removed.
+    void setMaxEntries(size_t max_entries);
+
+    /// \brief Return the maximum number of responses to keep.
+    size_t getMaxEntries() const { return (max_entries_); }
+
+    /// \brief Return the number of responses currently in the cache.
+    size_t getSize() const;
+
+private:
+    struct Shard;
+    static const size_t SHARD_COUNT = 16;
+    Shard& getShard(const Key& key);
+    boost::scoped_array<Shard> shards_;
+    size_t max_entries_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_RESPONSE_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
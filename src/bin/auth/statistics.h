@@ -72,14 +72,20 @@ private:
         REQ_BADSIG,                 // request is signed but bad signature
         RES_IS_TRUNCATED,           // response is truncated
         RES_TSIG_SIGNED,            // response is signed with TSIG
+        RES_CACHE_HIT,              // response is found in the response cache
+        RES_CACHE_MISS,             // response isn't found in the response
+                                    // cache
         BIT_ATTRIBUTES_TYPES
     };
     std::bitset<BIT_ATTRIBUTES_TYPES> bit_attributes_;
+    // The number of answer RRs of a cached response
+    unsigned int res_cached_answer_count_;
 public:
     /// \brief The constructor.
     ///
     /// \throw None
-    MessageAttributes() : req_address_family_(0), req_transport_protocol_(0)
+    MessageAttributes() : req_address_family_(0), req_transport_protocol_(0),
+                          res_cached_answer_count_(0)
     {}
 
     /// \brief Return opcode of the request.
@@ -251,6 +257,54 @@ public:
     void setResponseTSIG(const bool signed_tsig) {
         bit_attributes_[RES_TSIG_SIGNED] = signed_tsig;
     }
+
+    /// \brief Return whether the response is found in the response cache.
+    ///
+    /// \return true if the response is found in the response cache
+    /// \throw None
+    bool responseIsCacheHit() const {
+        return (bit_attributes_[RES_CACHE_HIT]);
+    }
+
+    /// \brief Return whether the response is looked up in the response
+    /// cache but isn't found.
+    ///
+    /// \return true if the response isn't found in the response cache
+    /// \throw None
+    bool responseIsCacheMiss() const {
+        return (bit_attributes_[RES_CACHE_MISS]);
+    }
+
+    /// \brief Set that the response is found in the response cache.
+    ///
+    /// In this case the response message object doesn't have the RRs of
+    /// the response, so the number of answer RRs must be given here.
+    ///
+    /// \param answer_count The number of RRs in the answer section of the
+    ///                     cached response
+    /// \throw None
+    void setResponseCacheHit(const unsigned int answer_count) {
+        bit_attributes_[RES_CACHE_HIT] = true;
+        bit_attributes_[RES_CACHE_MISS] = false;
+        res_cached_answer_count_ = answer_count;
+    }
+
+    /// \brief Set that the response isn't found in the response cache.
+    ///
+    /// \throw None
+    void setResponseCacheMiss() {
+        bit_attributes_[RES_CACHE_HIT] = false;
+        bit_attributes_[RES_CACHE_MISS] = true;
+    }
+
+    /// \brief Return the number of answer RRs of the cached response.
+    ///
+    /// \return the number given to \c setResponseCacheHit(); it's
+    ///         meaningless if \c responseIsCacheHit() is false
+    /// \throw None
+    unsigned int getResponseCachedAnswerCount() const {
+        return (res_cached_answer_count_);
+    }
 };
 
 /// \brief Set of DNS message counters.
@@ -308,6 +362,20 @@ public:
     void inc(const MessageAttributes& msgattrs,
              const bundy::dns::Message& response, const bool done);
 
+    /// \brief Add the values of another set of counters to this one.
+    ///
+    /// This is used to aggregate counters that are maintained separately
+    /// for each query processing thread.
+    ///
+    /// Every \c Counters object holds the same fixed set of counter items
+    /// (they are all constructed with \c MSG_COUNTER_TYPES items), so the
+    /// underlying \c Counter::add() never finds a size mismatch and this
+    /// method doesn't throw.
+    ///
+    /// \param other Counters whose values are added to this object.
+    /// \throw None
+    void merge(const Counters& other);
+
     /// \brief Get statistics counters.
     ///
     /// This method is mostly exception free. But it may still throw a
@@ -33,6 +33,7 @@
 
 #include <datasrc/client_list.h>
 #include <auth/auth_srv.h>
+#include <auth/auth_log.h>
 #include <auth/command.h>
 #include <auth/common.h>
 #include <auth/statistics.h>
@@ -331,6 +332,46 @@ TEST_F(AuthSrvTest, noClientList) {
     checkStatisticsCounters(stats_after, expect);
 }
 
+// RRs of the answer, authority and additional sections are not used to
+// handle a query, so malformed RDATA in them is not an error.  They are
+// built for the debug log of the received packet, and this must not change
+// the result, so we check it with and without the log.
+TEST_F(AuthSrvTest, malformedAdditionalRdata) {
+    UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                       default_qid, Name("version.bind"),
+                                       RRClass::CH(), RRType::TXT());
+    RRsetPtr rrset(new RRset(Name("example.com"), RRClass::IN(), RRType::A(),
+                             RRTTL(3600)));
+    rrset->addRdata(in::A("192.0.2.1"));
+    request_message.addRRset(Message::SECTION_ADDITIONAL, rrset);
+    createRequestPacket(request_message, IPPROTO_UDP);
+
+    // Change the type of the A RR (the last one) to AAAA, whose RDATA must
+    // be 16 bytes long.  The type is 14 bytes before the end of the RR.
+    data.assign(static_cast<const uint8_t*>(request_renderer.getData()),
+                static_cast<const uint8_t*>(request_renderer.getData()) +
+                request_renderer.getLength());
+    data[data.size() - 13] = RRType::AAAA().getCode();
+    io_message.reset(new IOMessage(&data[0], data.size(), *io_sock,
+                                   *endpoint));
+
+    const bundy::log::Severity severities[] = {
+        bundy::log::INFO, bundy::log::DEBUG
+    };
+    for (size_t i = 0; i < sizeof(severities) / sizeof(severities[0]); ++i) {
+        SCOPED_TRACE("severity " + boost::lexical_cast<string>(i));
+        auth_logger.setSeverity(severities[i], DBG_AUTH_MESSAGES);
+        parse_message->clear(Message::PARSE);
+        response_obuffer->clear();
+        server.processMessage(*io_message, *parse_message, *response_obuffer,
+                              &dnsserv);
+        EXPECT_TRUE(dnsserv.hasAnswer());
+        headerCheck(*parse_message, default_qid, Rcode::REFUSED(),
+                    opcode.getCode(), QR_FLAG, 1, 0, 0, 0);
+    }
+    auth_logger.setSeverity(bundy::log::DEFAULT);
+}
+
 // Unsupported requests.  Should result in NOTIMP.
 TEST_F(AuthSrvTest, unsupportedRequest) {
     unsupportedRequest();
@@ -1102,6 +1143,99 @@ TEST_F(AuthSrvTest, builtInQuery) {
     checkAllRcodeCountersZeroExcept(Rcode::NOERROR(), 1);
 }
 
+// Similar to the previous test, but with the response cache enabled.
+TEST_F(AuthSrvTest, builtInQueryWithResponseCache) {
+    updateBuiltin(server);
+    server.setResponseCacheSize(10);
+    EXPECT_EQ(10, server.getResponseCacheSize());
+
+    // The first query isn't in the cache; the second one (with a different
+    // ID) will be answered from the cache, with the same data except the ID.
+    const qid_t qids[] = { default_qid, static_cast<qid_t>(default_qid + 1) };
+    for (size_t i = 0; i < sizeof(qids) / sizeof(qids[0]); ++i) {
+        UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                           qids[i], Name("VERSION.BIND."),
+                                           RRClass::CH(), RRType::TXT());
+        createRequestPacket(request_message, IPPROTO_UDP);
+        response_obuffer->clear();
+        server.processMessage(*io_message, *parse_message, *response_obuffer,
+                              &dnsserv);
+        createBuiltinVersionResponse(qids[i], response_data);
+        matchWireData(&response_data[0], response_data.size(),
+                      response_obuffer->getData(),
+                      response_obuffer->getLength());
+    }
+
+    // The query name is compared case-insensitively, and the case of the
+    // query is preserved in the response.
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("version.bind."), RRClass::CH());
+    parse_message->clear(Message::PARSE);
+    InputBuffer ib(response_obuffer->getData(), response_obuffer->getLength());
+    parse_message->fromWire(ib);
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 1, 0);
+    EXPECT_EQ("version.bind.",
+              (*parse_message->beginQuestion())->getName().toText());
+
+    ConstElementPtr stats_after = server.getStatistics()->
+        get("zones")->get("_SERVER_");
+    std::map<std::string, int> expect;
+    expect["request.v4"] = 3;
+    expect["request.udp"] = 3;
+    expect["opcode.query"] = 3;
+    expect["responses"] = 3;
+    expect["response.cachehit"] = 2;
+    expect["response.cachemiss"] = 1;
+    expect["qrysuccess"] = 3;
+    expect["qryauthans"] = 3;
+    expect["rcode.noerror"] = 3;
+    checkStatisticsCounters(stats_after, expect);
+}
+
+// Cached responses are removed when the zone or the data sources are
+// updated.
+TEST_F(AuthSrvTest, invalidateResponseCache) {
+    updateBuiltin(server);
+    server.setResponseCacheSize(10);
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+
+    // Other zones and classes don't matter.
+    ElementPtr zone(Element::createMap());
+    zone->set("origin", Element::create("bind"));
+    server.invalidateResponseCache(zone);
+    zone->set("class", Element::create("CH"));
+    server.invalidateResponseCache(zone);   // removed
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+    zone->set("origin", Element::create("example.com"));
+    server.invalidateResponseCache(zone);
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+
+    // Reconfiguration of the data sources removes everything.
+    server.listsReconfigured(Element::create(false));
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+
+    // So does an invalid argument.
+    server.invalidateResponseCache(ConstElementPtr());
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+
+    // Disabling the cache stops counting hits and misses.
+    server.setResponseCacheSize(0);
+    createAndSendRequest(RRType::TXT(), Opcode::QUERY(),
+                         Name("VERSION.BIND."), RRClass::CH());
+
+    ConstElementPtr stats_after = server.getStatistics()->
+        get("zones")->get("_SERVER_");
+    EXPECT_EQ(1, stats_after->get("response")->get("cachehit")->intValue());
+    EXPECT_EQ(4, stats_after->get("response")->get("cachemiss")->intValue());
+    EXPECT_EQ(6, stats_after->get("responses")->intValue());
+}
+
 // Same type of test as builtInQueryViaDNSServer but for an error response.
 TEST_F(AuthSrvTest, iqueryViaDNSServer) {
     updateBuiltin(server);
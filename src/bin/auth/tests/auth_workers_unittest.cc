@@ -0,0 +1,187 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <auth/auth_workers.h>
+
+#include <exceptions/exceptions.h>
+
+#include <asiodns/dns_lookup.h>
+#include <asiodns/dns_server.h>
+#include <asiolink/io_message.h>
+#include <util/buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace bundy::auth;
+using namespace bundy::asiodns;
+using namespace bundy::asiolink;
+using bundy::dns::MessagePtr;
+using bundy::util::OutputBufferPtr;
+
+namespace {
+
+const size_t WORKER_COUNT = 2;
+
+// A lookup provider that echoes back the request and counts the number of
+// requests it handled.  Each worker has its own instance, so the counter
+// is only updated by a single thread.
+class EchoLookup : public DNSLookup {
+public:
+    EchoLookup() : count_(0) {}
+    virtual void operator()(const IOMessage& io_message, MessagePtr,
+                            MessagePtr, OutputBufferPtr buffer,
+                            DNSServer* server) const
+    {
+        buffer->writeData(io_message.getData(), io_message.getDataSize());
+        ++count_;
+        server->resume(true);
+    }
+    mutable size_t count_;
+};
+
+// Open a UDP socket bound to an ephemeral port of 127.0.0.1.  If addr is
+// non NULL, the bound address is stored in it.
+int
+getUDPSocket(struct sockaddr_in* addr = NULL) {
+    const int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0) {
+        bundy_throw(bundy::Unexpected, "failed to open test socket");
+    }
+    struct sockaddr_in sin;
+    std::memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sin);
+    if (bind(s, reinterpret_cast<const struct sockaddr*>(&sin),
+             sizeof(sin)) != 0 ||
+        getsockname(s, reinterpret_cast<struct sockaddr*>(&sin), &len) != 0) {
+        close(s);
+        bundy_throw(bundy::Unexpected, "failed to bind test socket");
+    }
+    if (addr != NULL) {
+        *addr = sin;
+    }
+    return (s);
+}
+
+class AuthWorkersTest : public ::testing::Test {
+protected:
+    AuthWorkersTest() : client_(getUDPSocket()) {
+        for (size_t i = 0; i < WORKER_COUNT; ++i) {
+            providers_.push_back(AuthWorkers::Providers(&lookups_[i], NULL));
+        }
+        workers_.reset(new AuthWorkers(providers_));
+
+        // Don't let a test hang up forever due to a bug.
+        struct timeval tv = { 1, 0 };
+        setsockopt(client_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    ~AuthWorkersTest() {
+        close(client_);
+    }
+
+    // Add a UDP server to the workers and remember its address.
+    void addUDPServer() {
+        workers_->addServerUDPFromFD(getUDPSocket(&server_addr_), AF_INET,
+                                     DNSServiceBase::SERVER_SYNC_OK);
+    }
+
+    // Send a query with the given data to the server, and return true if
+    // the same data is echoed back.
+    bool query(uint8_t data) {
+        if (sendto(client_, &data, sizeof(data), 0,
+                   reinterpret_cast<const struct sockaddr*>(&server_addr_),
+                   sizeof(server_addr_)) != sizeof(data)) {
+            return (false);
+        }
+        uint8_t response = 0;
+        return (recv(client_, &response, sizeof(response), 0) ==
+                sizeof(response) && response == data);
+    }
+
+    EchoLookup lookups_[WORKER_COUNT];
+    std::vector<AuthWorkers::Providers> providers_;
+    boost::scoped_ptr<AuthWorkers> workers_;
+    const int client_;
+    struct sockaddr_in server_addr_;
+};
+
+TEST_F(AuthWorkersTest, construct) {
+    EXPECT_EQ(WORKER_COUNT, workers_->getWorkerCount());
+
+    // Empty providers or NULL lookup isn't allowed.
+    const std::vector<AuthWorkers::Providers> empty_providers;
+    EXPECT_THROW(AuthWorkers workers(empty_providers),
+                 bundy::InvalidParameter);
+    providers_.push_back(AuthWorkers::Providers(NULL, NULL));
+    EXPECT_THROW(AuthWorkers workers(providers_), bundy::InvalidParameter);
+}
+
+TEST_F(AuthWorkersTest, getIOService) {
+    EXPECT_THROW(workers_->getIOService(), bundy::InvalidOperation);
+}
+
+TEST_F(AuthWorkersTest, serveUDP) {
+    addUDPServer();
+    const size_t query_count = 20;
+    for (size_t i = 0; i < query_count; ++i) {
+        EXPECT_TRUE(query(i));
+    }
+
+    // Stop the workers, so we can safely see the counters.  All queries
+    // must have been handled by some of the workers.
+    workers_.reset();
+    size_t total = 0;
+    for (size_t i = 0; i < WORKER_COUNT; ++i) {
+        total += lookups_[i].count_;
+    }
+    EXPECT_EQ(query_count, total);
+}
+
+TEST_F(AuthWorkersTest, setTCPRecvTimeout) {
+    // This can be called (with no effect in practice) while the workers
+    // are serving.
+    addUDPServer();
+    workers_->setTCPRecvTimeout(1000);
+    EXPECT_TRUE(query(1));
+}
+
+TEST_F(AuthWorkersTest, clearServers) {
+    addUDPServer();
+    EXPECT_TRUE(query(1));
+
+    // Once cleared, the server socket will be closed and no one answers.
+    workers_->clearServers();
+    EXPECT_FALSE(query(2));
+
+    // The workers can start serving again.
+    addUDPServer();
+    EXPECT_TRUE(query(3));
+}
+
+}
@@ -174,4 +174,44 @@ TEST_F(AuthCommandTest, getStats) {
     // statistics are done in its own tests.
     EXPECT_EQ(0, rcode_);
 }
+
+TEST_F(AuthCommandTest, getCacheStats) {
+    // Without data sources there's nothing to report.
+    result_ = execAuthServerCommand(server_, "getcachestats",
+                                    ConstElementPtr());
+    ConstElementPtr stats = parseAnswer(rcode_, result_);
+    EXPECT_EQ(0, rcode_);
+    EXPECT_TRUE(stats->mapValue().empty());
+
+    // Cache a zone; the data source without a cache isn't reported.
+    const ConstElementPtr config(Element::fromJSON("{"
+        "\"IN\": [{"
+        "    \"type\": \"MasterFiles\","
+        "    \"params\": {\"example.\": \"" TEST_DATA_DIR
+        "/rfc5155-example.zone.signed\"},"
+        "    \"cache-enable\": true"
+        "}, {"
+        "    \"type\": \"sqlite3\","
+        "    \"params\": {\"database_file\": \"" TEST_DATA_DIR
+        "/example.sqlite3\"}"
+        "}]}"));
+    server_.getDataSrcClientsMgr().setDataSrcClientLists(
+        configureDataSource(config));
+    result_ = execAuthServerCommand(server_, "getcachestats",
+                                    ConstElementPtr());
+    stats = parseAnswer(rcode_, result_);
+    EXPECT_EQ(0, rcode_);
+    ASSERT_TRUE(stats->contains("IN"));
+    EXPECT_EQ(1, stats->get("IN")->mapValue().size());
+    const ConstElementPtr dsrc_stats = stats->get("IN")->get("MasterFiles");
+    ASSERT_TRUE(dsrc_stats);
+    EXPECT_EQ("local", dsrc_stats->get("segment-type")->stringValue());
+    const ConstElementPtr zone_stats =
+        dsrc_stats->get("zones")->get("example.");
+    ASSERT_TRUE(zone_stats);
+    EXPECT_LT(0, zone_stats->get("memory")->intValue());
+    EXPECT_LE(0, zone_stats->get("load-time")->intValue());
+    EXPECT_EQ(zone_stats->get("memory")->intValue(),
+              dsrc_stats->get("memory")->intValue());
+}
 }
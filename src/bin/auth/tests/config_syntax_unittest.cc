@@ -36,7 +36,8 @@ TEST_F(AuthConfigSyntaxTest, inmemoryDefaultFileType) {
     EXPECT_TRUE(
         mspec_.validateConfig(
             Element::fromJSON(
-                "{\"tcp_recv_timeout\": 1000,"
+                "{\"tcp_recv_timeout\": 1000, \"worker_threads\": 0,"
+                " \"response_cache_size\": 0,"
                 " \"listen_on\": [], \"datasources\": "
                 "  [{\"type\": \"memory\", \"class\": \"IN\", "
                 "    \"zones\": [{\"origin\": \"example.com\","
@@ -137,11 +137,14 @@ TEST_F(AuthConfigTest, listenAddressConfig) {
 
     // listenAddressConfig should have attempted to create 4 DNS server
     // objects: two IP addresses, TCP and UDP for each.  For UDP, the "SYNC_OK"
-    // option should have been specified.
+    // and "BATCH_OK" options should have been specified.
+    const DNSService::ServerFlag udp_options =
+        static_cast<DNSService::ServerFlag>(DNSService::SERVER_SYNC_OK |
+                                            DNSService::SERVER_BATCH_OK);
     EXPECT_EQ(2, dnss_.getTCPFdParams().size());
     EXPECT_EQ(2, dnss_.getUDPFdParams().size());
-    EXPECT_EQ(DNSService::SERVER_SYNC_OK, dnss_.getUDPFdParams().at(0).options);
-    EXPECT_EQ(DNSService::SERVER_SYNC_OK, dnss_.getUDPFdParams().at(1).options);
+    EXPECT_EQ(udp_options, dnss_.getUDPFdParams().at(0).options);
+    EXPECT_EQ(udp_options, dnss_.getUDPFdParams().at(1).options);
 }
 
 // Try setting tcp receive timeout through config
@@ -157,4 +160,49 @@ TEST_F(AuthConfigTest, tcpRecvTimeoutConfig) {
                  AuthConfigError);
 }
 
+// Try setting the size of the response cache through config
+TEST_F(AuthConfigTest, responseCacheSizeConfig) {
+    EXPECT_EQ(0, server.getResponseCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"response_cache_size\": 1000 }"));
+    EXPECT_EQ(1000, server.getResponseCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"response_cache_size\": 0 }"));
+    EXPECT_EQ(0, server.getResponseCacheSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"response_cache_size\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getResponseCacheSize());
+}
+
+// Try setting the number of worker threads through config
+TEST_F(AuthConfigTest, workerThreadsConfig) {
+    EXPECT_EQ(0, server.getWorkerThreads());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 2 }"));
+    EXPECT_EQ(2, server.getWorkerThreads());
+
+    // While the workers exist, the TCP timeout is set for them, not for
+    // the main DNS service.
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"tcp_recv_timeout\": 123 }"));
+    EXPECT_NE(123, dnss_.getTCPRecvTimeout());
+
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"worker_threads\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(2, server.getWorkerThreads());
+
+    // If a later item fails, the number of threads should be restored.
+    // (items are processed in the alphabetical order of their names)
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"worker_threads\": 3, \"zzz_unknown\": 1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(2, server.getWorkerThreads());
+
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 0 }"));
+    EXPECT_EQ(0, server.getWorkerThreads());
+}
+
 }
@@ -59,9 +59,11 @@ protected:
     DataSrcClientsBuilderTest() :
         clients_map(new std::map<RRClass,
                     boost::shared_ptr<ConfigurableClientList> >),
+        published_lists(clients_map),
         write_end(-1), read_end(-1),
         builder(&command_queue, &callback_queue, &cond, &queue_mutex,
-                &clients_map, &map_mutex, generateSockets()),
+                &clients_map, &map_mutex, &published_lists,
+                generateSockets()),
         cond(command_queue, delayed_command_queue), rrclass(RRClass::IN()),
         shutdown_cmd(SHUTDOWN, ConstElementPtr(), FinishedCallback()),
         noop_cmd(NOOP, ConstElementPtr(), FinishedCallback())
@@ -80,6 +82,7 @@ protected:
     ConstElementPtr createSegments() const;
 
     ClientListMapPtr clients_map; // configured clients
+    PublishedClientLists published_lists; // clients_map for the readers
     std::list<Command> command_queue; // test command queue
     std::list<Command> delayed_command_queue; // commands available after wait
     std::list<FinishedCallbackPair> callback_queue; // Callbacks from commands
@@ -249,6 +252,8 @@ TEST_F(DataSrcClientsBuilderTest, reconfigure) {
     EXPECT_FALSE(builder.getInternalCallbacks().front().second->boolValue());
     EXPECT_EQ(1, clients_map->size());
     EXPECT_EQ(1, map_mutex.lock_count);
+    // The new map is published to the readers
+    EXPECT_EQ(clients_map.get(), published_lists.getClientsMap());
 
     // Store the nonempty clients map we now have
     ClientListMapPtr working_config_clients(clients_map);
@@ -260,6 +265,7 @@ TEST_F(DataSrcClientsBuilderTest, reconfigure) {
         "{\"classes\": { \"foo\": \"bar\" }, \"_generation_id\": 2}");
     EXPECT_TRUE(builder.handleCommand(reconfig_cmd));
     EXPECT_EQ(working_config_clients, clients_map);
+    EXPECT_EQ(clients_map.get(), published_lists.getClientsMap());
     // Building failed, so map mutex should not have been locked again
     EXPECT_EQ(1, map_mutex.lock_count);
 
@@ -306,6 +312,7 @@ TEST_F(DataSrcClientsBuilderTest, reconfigure) {
     EXPECT_NE(working_config_clients, clients_map);
     EXPECT_EQ(1, clients_map->size());
     EXPECT_EQ(2, map_mutex.lock_count);
+    EXPECT_EQ(clients_map.get(), published_lists.getClientsMap());
 
     // And finally, try an empty config to disable all datasource clients
     reconfig_cmd.params =
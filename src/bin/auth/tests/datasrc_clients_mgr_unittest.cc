@@ -159,12 +159,10 @@ TEST(DataSrcClientsMgrTest, holder) {
         EXPECT_FALSE(holder.findClientList(RRClass::IN()));
         EXPECT_FALSE(holder.findClientList(RRClass::CH()));
         EXPECT_TRUE(holder.getClasses().empty());
-        // map should be protected here
-        EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->lock_count);
-        EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
+        // The holder doesn't lock the map; it's only a reader of the
+        // published map.
+        EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->lock_count);
     }
-    // map lock has been released
-    EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
 
     // Put something in, that should become visible.
     ConstElementPtr reconfigure_arg = Element::fromJSON(
@@ -195,10 +193,27 @@ TEST(DataSrcClientsMgrTest, holder) {
         EXPECT_EQ(RRClass::IN(), holder.getClasses()[0]);
     }
 
-    // Duplicate lock acquisition is prohibited (only test mgr can detect
-    // this reliably, so this test may not be that useful)
-    TestDataSrcClientsMgr::Holder holder1(mgr);
-    EXPECT_THROW(TestDataSrcClientsMgr::Holder holder2(mgr), bundy::Unexpected);
+    // Holders never lock the map
+    EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->lock_count);
+}
+
+TEST(DataSrcClientsMgrTest, setDataSrcClientLists) {
+    TestDataSrcClientsMgr mgr;
+
+    ClientListMapPtr new_lists(new std::map<RRClass,
+                               boost::shared_ptr<ConfigurableClientList> >);
+    (*new_lists)[RRClass::CH()].reset(new ConfigurableClientList(
+                                          RRClass::CH()));
+    mgr.setDataSrcClientLists(new_lists);
+    EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->lock_count);
+    EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
+    EXPECT_EQ(new_lists, *FakeDataSrcClientsBuilder::clients_map);
+
+    // The new lists are visible to new holders.
+    TestDataSrcClientsMgr::Holder holder(mgr);
+    EXPECT_EQ((*new_lists)[RRClass::CH()],
+              holder.findClientList(RRClass::CH()));
+    EXPECT_FALSE(holder.findClientList(RRClass::IN()));
 }
 
 namespace {
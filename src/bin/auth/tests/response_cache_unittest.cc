@@ -0,0 +1,283 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <auth/response_cache.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <util/buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstring>
+#include <string>
+
+using namespace bundy::auth;
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+using boost::lexical_cast;
+
+namespace {
+
+class ResponseCacheTest : public ::testing::Test {
+protected:
+    ResponseCacheTest() : cache_(100), query_(Message::RENDER), buffer_(0) {
+        setQuery(Name("www.example.com"), RRType::A());
+    }
+
+    // Reset the query message with the given question.
+    void setQuery(const Name& qname, const RRType& qtype,
+                  const RRClass& qclass = RRClass::IN())
+    {
+        query_.clear(Message::RENDER);
+        query_.setQid(0x1035);
+        query_.setOpcode(Opcode::QUERY());
+        query_.setRcode(Rcode::NOERROR());
+        query_.addQuestion(Question(qname, qclass, qtype));
+    }
+
+    // Render a response to the current query as the one to be cached.
+    // It's not necessarily a valid response; the cache doesn't care.
+    void renderResponse() {
+        Message response(Message::RENDER);
+        response.setQid(query_.getQid());
+        response.setOpcode(Opcode::QUERY());
+        response.setRcode(Rcode::NOERROR());
+        response.setHeaderFlag(Message::HEADERFLAG_QR);
+        response.setHeaderFlag(Message::HEADERFLAG_AA);
+        response.addQuestion(*query_.beginQuestion());
+        renderer_.clear();
+        response.toWire(renderer_);
+    }
+
+    // Look up the current query in the cache, and if it's not found,
+    // store the response to it.  Returns the result of the lookup.
+    ResponseCache::Result lookupAndInsert() {
+        ResponseCache::Key key(query_, 512);
+        const ResponseCache::Result result =
+            cache_.lookup(key, query_.getQid(), buffer_);
+        if (result == ResponseCache::MISS) {
+            renderResponse();
+            cache_.insert(key, renderer_.getData(), renderer_.getLength());
+        }
+        return (result);
+    }
+
+    ResponseCache cache_;
+    Message query_;
+    MessageRenderer renderer_;
+    OutputBuffer buffer_;
+};
+
+TEST_F(ResponseCacheTest, disabled) {
+    ResponseCache cache;
+    EXPECT_EQ(0, cache.getMaxEntries());
+    ResponseCache::Key key(query_, 512);
+    EXPECT_EQ(ResponseCache::DISABLED, cache.lookup(key, 0, buffer_));
+    renderResponse();
+    cache.insert(key, renderer_.getData(), renderer_.getLength());
+    EXPECT_EQ(0, cache.getSize());
+    EXPECT_EQ(0, buffer_.getLength());
+}
+
+TEST_F(ResponseCacheTest, hit) {
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    EXPECT_EQ(0, buffer_.getLength());
+    EXPECT_EQ(1, cache_.getSize());
+
+    // The same query will be found, with the same data.
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+    ASSERT_EQ(renderer_.getLength(), buffer_.getLength());
+    EXPECT_EQ(0, std::memcmp(renderer_.getData(), buffer_.getData(),
+                             buffer_.getLength()));
+    EXPECT_EQ(1, cache_.getSize());
+}
+
+TEST_F(ResponseCacheTest, appendToBuffer) {
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+
+    // The response is appended to the existing data in the buffer, and the
+    // query ID and name are adjusted relative to it.
+    buffer_.writeUint16(0xabcd);
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+    ASSERT_EQ(renderer_.getLength() + 2, buffer_.getLength());
+    EXPECT_EQ(0xab, buffer_[0]);
+    EXPECT_EQ(0xcd, buffer_[1]);
+    EXPECT_EQ(0, std::memcmp(renderer_.getData(),
+                             static_cast<const uint8_t*>(buffer_.getData()) + 2,
+                             renderer_.getLength()));
+}
+
+TEST_F(ResponseCacheTest, adjustQidAndCase) {
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+
+    // A query with a different ID and the name in a different case should
+    // hit, and the response should have the ID and name of the new query.
+    setQuery(Name("WwW.ExAmPlE.cOm"), RRType::A());
+    query_.setQid(0x4321);
+    ResponseCache::Key key(query_, 512);
+    ASSERT_EQ(ResponseCache::HIT, cache_.lookup(key, 0x4321, buffer_));
+
+    renderResponse();
+    ASSERT_EQ(renderer_.getLength(), buffer_.getLength());
+    EXPECT_EQ(0, std::memcmp(renderer_.getData(), buffer_.getData(),
+                             buffer_.getLength()));
+}
+
+TEST_F(ResponseCacheTest, differentKeys) {
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+
+    // Different names, types or classes are different keys.
+    setQuery(Name("www2.example.com"), RRType::A());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("www.example.com"), RRType::AAAA());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("www.example.com"), RRType::A(), RRClass::CH());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+
+    // Header flags that affect the response
+    setQuery(Name("www.example.com"), RRType::A());
+    query_.setHeaderFlag(Message::HEADERFLAG_RD);
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    query_.setHeaderFlag(Message::HEADERFLAG_CD);
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+
+    // With EDNS, and with the DO bit.
+    setQuery(Name("www.example.com"), RRType::A());
+    EDNSPtr edns(new EDNS());
+    query_.setEDNS(edns);
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    edns.reset(new EDNS());
+    edns->setDNSSECAwareness(true);
+    query_.setEDNS(edns);
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+
+    // Different maximum size of the response.
+    ResponseCache::Key key(query_, 4096);
+    EXPECT_EQ(ResponseCache::MISS, cache_.lookup(key, 0, buffer_));
+
+    EXPECT_EQ(8, cache_.getSize());
+}
+
+TEST_F(ResponseCacheTest, maxEntries) {
+    // The entries are distributed over the shards, so the limit is not
+    // strict, but the number of entries never exceeds it much.
+    for (size_t i = 0; i < 1000; ++i) {
+        setQuery(Name("www" + lexical_cast<std::string>(i) + ".example.com"),
+                 RRType::A());
+        EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    }
+    EXPECT_EQ(100, cache_.getMaxEntries());
+    EXPECT_GE(112, cache_.getSize());
+    EXPECT_LT(50, cache_.getSize());
+
+    // The most recently used one should be kept.
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+
+    // Reducing the limit removes the entries.
+    cache_.setMaxEntries(16);
+    EXPECT_GE(16, cache_.getSize());
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+
+    // Disabling the cache removes all.
+    cache_.setMaxEntries(0);
+    EXPECT_EQ(0, cache_.getSize());
+    EXPECT_EQ(ResponseCache::DISABLED, lookupAndInsert());
+}
+
+TEST_F(ResponseCacheTest, leastRecentlyUsed) {
+    // With a single entry per shard, each new entry replaces the existing
+    // one in the same shard.  After storing many other names, the first one
+    // should have been replaced.
+    cache_.setMaxEntries(1);
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    for (size_t i = 0; i < 1000; ++i) {
+        setQuery(Name("www" + lexical_cast<std::string>(i) + ".example.com"),
+                 RRType::A());
+        EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+        EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+    }
+    EXPECT_EQ(16, cache_.getSize());
+    setQuery(Name("www.example.com"), RRType::A());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+}
+
+TEST_F(ResponseCacheTest, invalidate) {
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("example.com"), RRType::SOA());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("www.example.org"), RRType::A());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("www.example.com"), RRType::A(), RRClass::CH());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    EXPECT_EQ(4, cache_.getSize());
+
+    // Names in the zone of the class are removed; the rest are kept.
+    cache_.invalidate(Name("EXAMPLE.COM"), RRClass::IN());
+    EXPECT_EQ(2, cache_.getSize());
+    setQuery(Name("www.example.com"), RRType::A());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("example.com"), RRType::SOA());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+    setQuery(Name("www.example.org"), RRType::A());
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+    setQuery(Name("www.example.com"), RRType::A(), RRClass::CH());
+    EXPECT_EQ(ResponseCache::HIT, lookupAndInsert());
+
+    cache_.clear();
+    EXPECT_EQ(0, cache_.getSize());
+    EXPECT_EQ(ResponseCache::MISS, lookupAndInsert());
+}
+
+TEST_F(ResponseCacheTest, insertAfterInvalidate) {
+    // If the cache is invalidated between lookup and insert, the response
+    // may be built from the old data, so it shouldn't be stored.
+    ResponseCache::Key key(query_, 512);
+    EXPECT_EQ(ResponseCache::MISS, cache_.lookup(key, 0, buffer_));
+    cache_.invalidate(Name("example.com"), RRClass::IN());
+    renderResponse();
+    cache_.insert(key, renderer_.getData(), renderer_.getLength());
+    EXPECT_EQ(0, cache_.getSize());
+
+    EXPECT_EQ(ResponseCache::MISS, cache_.lookup(key, 0, buffer_));
+    cache_.clear();
+    cache_.insert(key, renderer_.getData(), renderer_.getLength());
+    EXPECT_EQ(0, cache_.getSize());
+}
+
+TEST_F(ResponseCacheTest, insertTooShort) {
+    ResponseCache::Key key(query_, 512);
+    EXPECT_EQ(ResponseCache::MISS, cache_.lookup(key, 0, buffer_));
+    renderResponse();
+    EXPECT_THROW(cache_.insert(key, renderer_.getData(), 12),
+                 bundy::InvalidParameter);
+    EXPECT_EQ(0, cache_.getSize());
+}
+
+}
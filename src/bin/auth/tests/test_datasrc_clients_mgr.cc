@@ -37,6 +37,7 @@ TestMutex* FakeDataSrcClientsBuilder::queue_mutex = NULL;
 bundy::datasrc::ClientListMapPtr*
     FakeDataSrcClientsBuilder::clients_map = NULL;
 TestMutex* FakeDataSrcClientsBuilder::map_mutex = NULL;
+PublishedClientLists* FakeDataSrcClientsBuilder::published_lists = NULL;
 TestMutex FakeDataSrcClientsBuilder::queue_mutex_copy;
 bool FakeDataSrcClientsBuilder::thread_waited = false;
 FakeDataSrcClientsBuilder::ExceptionFromWait
@@ -92,10 +93,13 @@ void
 TestDataSrcClientsMgrBase::reconfigureHook() {
     using namespace datasrc_clientmgr_internal;
 
-    // Simply replace the local map, ignoring bogus config value.
+    // Simply replace the local map, ignoring bogus config value.  There
+    // are no other threads, so the replaced map can be released right
+    // away.
     assert(command_queue_.front().id == RECONFIGURE);
     try {
         clients_map_ = configureDataSource(command_queue_.front().params);
+        published_lists_.publish(clients_map_);
     } catch (...) {}
 }
 
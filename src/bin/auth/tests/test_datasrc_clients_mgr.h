@@ -133,7 +133,7 @@ public:
     // true iff a builder has started.
     static bool started;
 
-    // These five correspond to the resource shared with the manager.
+    // These eight correspond to the resource shared with the manager.
     // xxx_copy will be set in the manager's destructor to record the
     // final state of the manager.
     static std::list<Command>* command_queue;
@@ -143,6 +143,7 @@ public:
     static int wakeup_fd;
     static bundy::datasrc::ClientListMapPtr* clients_map;
     static TestMutex* map_mutex;
+    static PublishedClientLists* published_lists;
     static std::list<Command> command_queue_copy;
     static std::list<FinishedCallbackPair> callback_queue_copy;
     static TestCondVar cond_copy;
@@ -162,7 +163,8 @@ public:
         TestCondVar* cond,
         TestMutex* queue_mutex,
         bundy::datasrc::ClientListMapPtr* clients_map,
-        TestMutex* map_mutex, int wakeup_fd)
+        TestMutex* map_mutex, PublishedClientLists* published_lists,
+        int wakeup_fd)
     {
         FakeDataSrcClientsBuilder::started = false;
         FakeDataSrcClientsBuilder::command_queue = command_queue;
@@ -172,6 +174,7 @@ public:
         FakeDataSrcClientsBuilder::wakeup_fd = wakeup_fd;
         FakeDataSrcClientsBuilder::clients_map = clients_map;
         FakeDataSrcClientsBuilder::map_mutex = map_mutex;
+        FakeDataSrcClientsBuilder::published_lists = published_lists;
         FakeDataSrcClientsBuilder::thread_waited = false;
         FakeDataSrcClientsBuilder::thread_throw_on_wait = NOTHROW;
     }
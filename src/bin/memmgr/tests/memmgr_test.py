@@ -252,6 +252,40 @@ class TestMemmgr(unittest.TestCase):
         self.assertEqual(1, answer[0])
         self.assertIsNotNone(re.search('not a directory', answer[1]))
 
+    def test_configure_mapped_segment(self):
+        self.__mgr._setup_ccsession()
+        os.path.isdir = lambda x: True
+        os.access = lambda x, y: True
+
+        # By default, mapped segments are neither prefaulted nor advised.
+        self.assertEqual((0, None),
+                         parse_answer(self.__mgr._config_handler({})))
+        self.assertEqual('none',
+                         self.__mgr._config_params['mapped_segment_prefault'])
+        self.assertFalse(self.__mgr._config_params['mapped_segment_will_need'])
+        self.assertFalse(
+            self.__mgr._config_params['mapped_segment_huge_pages'])
+
+        user_cfg = {'mapped_segment_prefault': 'background',
+                    'mapped_segment_will_need': True,
+                    'mapped_segment_huge_pages': True}
+        self.assertEqual((0, None),
+                         parse_answer(self.__mgr._config_handler(user_cfg)))
+        self.assertEqual('background',
+                         self.__mgr._config_params['mapped_segment_prefault'])
+        self.assertTrue(self.__mgr._config_params['mapped_segment_will_need'])
+        self.assertTrue(self.__mgr._config_params['mapped_segment_huge_pages'])
+
+        # Bad update: unknown prefault mode.  Nothing is updated.
+        user_cfg = {'mapped_segment_prefault': 'always',
+                    'mapped_segment_huge_pages': False}
+        answer = parse_answer(self.__mgr._config_handler(user_cfg))
+        self.assertEqual(1, answer[0])
+        self.assertIsNotNone(re.search('mapped_segment_prefault', answer[1]))
+        self.assertEqual('background',
+                         self.__mgr._config_params['mapped_segment_prefault'])
+        self.assertTrue(self.__mgr._config_params['mapped_segment_huge_pages'])
+
     @unittest.skipIf(os.getuid() == 0, 'test cannot be run as root user')
     def test_configure_bad_permissions(self):
         self.__mgr._setup_ccsession()
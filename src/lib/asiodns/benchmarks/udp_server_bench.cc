@@ -0,0 +1,276 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <bench/benchmark.h>
+
+#include <exceptions/exceptions.h>
+
+#include <asio.hpp>
+#include <asiolink/asiolink.h>
+#include <asiodns/asiodns.h>
+#include <asiodns/sync_udp_server.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <log/logger_support.h>
+
+#include <util/buffer.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <iostream>
+#include <vector>
+
+#include <cstring>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using namespace bundy::asiolink;
+using namespace bundy::asiodns;
+using bundy::util::OutputBuffer;
+using bundy::util::OutputBufferPtr;
+using bundy::util::thread::Thread;
+
+namespace {
+
+// A lookup callback that simply echoes the query back.  This way the
+// benchmark measures the overhead of the server itself (system calls and
+// buffer handling) rather than the query processing.
+class EchoLookup : public DNSLookup {
+public:
+    virtual void operator()(const IOMessage& io_message, MessagePtr,
+                            MessagePtr, OutputBufferPtr buffer,
+                            DNSServer* server) const
+    {
+        buffer->writeData(io_message.getData(), io_message.getDataSize());
+        server->resume(true);
+    }
+};
+
+// This benchmark runs a SyncUDPServer with the given batch size in a
+// separate thread, bound to a loopback address.  Each run() sends a burst
+// of queries to the server from a single client socket, and then receives
+// all the responses.  The server thread is the only thread handling the
+// queries, so the server side CPU time measured in the thread gives the
+// number of packets handled per second per core.
+class UDPServerBenchMark {
+public:
+    UDPServerBenchMark(size_t batch_size, size_t burst,
+                       const vector<uint8_t>& query) :
+        burst_(burst), query_(query), response_(65535), cpu_time_(0)
+    {
+        struct sockaddr_in sin;
+        const int server_fd = openSocket(&sin);
+        client_fd_ = openSocket(NULL);
+        if (connect(client_fd_, reinterpret_cast<const struct sockaddr*>(&sin),
+                    sizeof(sin)) != 0) {
+            bundy_throw(bundy::Unexpected, "failed to connect client socket");
+        }
+        // Don't hang up forever if some of the packets are dropped.
+        struct timeval tv = { 1, 0 };
+        setsockopt(client_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        server_ = SyncUDPServer::create(io_service_.get_io_service(),
+                                        server_fd, AF_INET, &lookup_,
+                                        batch_size);
+        (*server_)();
+        thread_.reset(new Thread(boost::bind(&UDPServerBenchMark::serve,
+                                             this)));
+    }
+    ~UDPServerBenchMark() {
+        stop();
+        close(client_fd_);
+    }
+    unsigned int run() {
+        for (size_t i = 0; i < burst_; ++i) {
+            if (send(client_fd_, &query_[0], query_.size(), 0) < 0) {
+                bundy_throw(bundy::Unexpected, "failed to send query");
+            }
+        }
+        unsigned int received = 0;
+        for (; received < burst_; ++received) {
+            if (recv(client_fd_, &response_[0], response_.size(), 0) <= 0) {
+                break;          // lost or timed out; just count the rest
+            }
+        }
+        return (received);
+    }
+    // Stop the server thread.  It must be called before getServerCPUTime().
+    void stop() {
+        if (thread_) {
+            io_service_.stop();
+            thread_->wait();
+            thread_.reset();
+            server_->stop();
+        }
+    }
+    // Return the CPU time (in seconds) consumed by the server thread.
+    double getServerCPUTime() const { return (cpu_time_); }
+    size_t getBatchSize() const { return (server_->getBatchSize()); }
+
+private:
+    static int openSocket(struct sockaddr_in* addr) {
+        const int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        struct sockaddr_in sin;
+        std::memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(sin);
+        if (s < 0 ||
+            bind(s, reinterpret_cast<const struct sockaddr*>(&sin),
+                 sizeof(sin)) != 0 ||
+            getsockname(s, reinterpret_cast<struct sockaddr*>(&sin),
+                        &len) != 0) {
+            if (s >= 0) {
+                close(s);
+            }
+            bundy_throw(bundy::Unexpected, "failed to open a UDP socket");
+        }
+        if (addr != NULL) {
+            *addr = sin;
+        }
+        return (s);
+    }
+    void serve() {
+        struct timespec start, end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        io_service_.run();
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        cpu_time_ = (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+    }
+
+    const size_t burst_;
+    const vector<uint8_t>& query_;
+    vector<uint8_t> response_;
+    IOService io_service_;
+    EchoLookup lookup_;
+    SyncUDPServerPtr server_;
+    boost::scoped_ptr<Thread> thread_;
+    int client_fd_;
+    double cpu_time_;
+};
+
+void
+runBenchMark(int iteration, size_t batch_size, size_t burst,
+             const vector<uint8_t>& query)
+{
+    UDPServerBenchMark target(batch_size, burst, query);
+    cout << "Benchmark for SyncUDPServer, batch size " <<
+        target.getBatchSize() << endl;
+    BenchMark<UDPServerBenchMark> bench(iteration, target, true);
+    target.stop();
+
+    const unsigned int packets = bench.getIteration();
+    const double cpu_time = target.getServerCPUTime();
+    cout << "Server thread CPU time: " << cpu_time << "s";
+    if (cpu_time > 0) {
+        cout << " (" << (packets / cpu_time) << " packets per second per core)";
+    }
+    cout << endl;
+    if (packets < static_cast<unsigned int>(iteration) * burst) {
+        cout << "Note: " << (iteration * burst - packets) <<
+            " packets were lost" << endl;
+    }
+}
+
+void
+usage() {
+    cerr << "Usage: udp_server_bench [-n iterations] [-b burst] "
+        "[-k batch_size]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 10000;
+    size_t burst = 32;
+    size_t batch_size = SyncUDPServer::DEFAULT_BATCH_SIZE;
+    while ((ch = getopt(argc, argv, "n:b:k:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'b':
+            burst = atoi(optarg);
+            break;
+        case 'k':
+            batch_size = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || burst == 0 || batch_size == 0) {
+        usage();
+    }
+
+    // Disable logging to avoid unwanted noise.
+    bundy::log::initLogger("udp-server-bench", bundy::log::NONE,
+                           bundy::log::MAX_DEBUG_LEVEL, NULL);
+
+    // A typical query used as the test data.
+    Message message(Message::RENDER);
+    message.setQid(0x1035);
+    message.setOpcode(Opcode::QUERY());
+    message.setRcode(Rcode::NOERROR());
+    message.addQuestion(Question(Name("www.example.com"), RRClass::IN(),
+                                 RRType::A()));
+    MessageRenderer renderer;
+    message.toWire(renderer);
+    const uint8_t* const data =
+        static_cast<const uint8_t*>(renderer.getData());
+    const vector<uint8_t> query(data, data + renderer.getLength());
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Queries per iteration: " << burst << endl << endl;
+
+    try {
+        // The current (non batched) path first, then the batched one.
+        runBenchMark(iteration, 1, burst, query);
+        cout << endl;
+        runBenchMark(iteration, batch_size, burst, query);
+    } catch (const std::exception& ex) {
+        cout << "Test unexpectedly failed: " << ex.what() << endl;
+        return (1);
+    }
+
+    return (0);
+}
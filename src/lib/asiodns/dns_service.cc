@@ -62,10 +62,10 @@ public:
 
     // SyncUDPServer has different constructor signature so it cannot be
     // templated.
-    void addSyncUDPServerFromFD(int fd, int af) {
+    void addSyncUDPServerFromFD(int fd, int af, size_t batch_size) {
         SyncUDPServerPtr server(SyncUDPServer::create(
                                     io_service_.get_io_service(), fd, af,
-                                    lookup_));
+                                    lookup_, batch_size));
         startServer(server);
     }
 
@@ -108,7 +108,9 @@ void DNSService::addServerUDPFromFD(int fd, int af, ServerFlag options) {
                   << options);
     }
     if ((options & SERVER_SYNC_OK) != 0) {
-        impl_->addSyncUDPServerFromFD(fd, af);
+        impl_->addSyncUDPServerFromFD(
+            fd, af, (options & SERVER_BATCH_OK) != 0 ?
+            SyncUDPServer::DEFAULT_BATCH_SIZE : 1);
     } else {
         impl_->addServerFromFD<DNSServiceImpl::UDPServerPtr, UDPServer>(
             fd, af);
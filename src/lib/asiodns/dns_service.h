@@ -60,7 +60,7 @@ public:
     /// class.
     enum ServerFlag {
         SERVER_DEFAULT = 0, ///< The default flag (no particular property)
-        SERVER_SYNC_OK = 1 ///< The server can act in the "synchronous" mode.
+        SERVER_SYNC_OK = 1, ///< The server can act in the "synchronous" mode.
                            ///< In this mode, the client ensures that the
                            ///< lookup provider always completes the query
                            ///< process and it immediately releases the
@@ -73,6 +73,15 @@ public:
                            ///< synchronous mode; it's up to the server
                            ///< implementation whether it exploits the
                            ///< information given by the client.
+        SERVER_BATCH_OK = 2 ///< The server can receive and answer multiple
+                            ///< queries at once (e.g., via recvmmsg and
+                            ///< sendmmsg) where the system supports it.
+                            ///< This reduces the per-query system call
+                            ///< overhead at the cost of slightly delaying
+                            ///< answers in the same batch.  It's
+                            ///< currently only meaningful in combination
+                            ///< with \c SERVER_SYNC_OK, and is otherwise
+                            ///< ignored.
     };
 
 public:
@@ -124,7 +133,7 @@ private:
     // Bit or'ed all defined \c ServerFlag values.  Used internally for
     // compatibility check.  Note that this doesn't have to be used by
     // applications, and doesn't have to be defined in the "base" class.
-    static const unsigned int SERVER_DEFINED_FLAGS = 1;
+    static const unsigned int SERVER_DEFINED_FLAGS = 3;
 
 public:
     /// \brief The constructor without any servers.
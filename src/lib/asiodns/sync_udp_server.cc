@@ -27,32 +27,137 @@
 #include <boost/bind.hpp>
 
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <unistd.h>             // for some IPC/network system calls
 #include <errno.h>
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+#define BATCH_SUPPORTED 1
+#endif
+
 using namespace std;
 using namespace bundy::asiolink;
+using bundy::util::OutputBuffer;
+using bundy::util::OutputBufferPtr;
 
 namespace bundy {
 namespace asiodns {
 
+#ifdef BATCH_SUPPORTED
+// Buffers for batched receive and send.  Slot i of the receive arrays
+// holds the i-th received datagram and its sender; the send arrays are
+// filled with the answers to be sent, referring to the output buffers and
+// the sender addresses of the corresponding queries.
+struct SyncUDPServer::BatchBuffers {
+    explicit BatchBuffers(size_t batch_size) :
+        data(batch_size * MAX_LENGTH), addrs(batch_size),
+        recv_iovs(batch_size), recv_msgs(batch_size),
+        send_iovs(batch_size), send_msgs(batch_size)
+    {
+        for (size_t i = 0; i < batch_size; ++i) {
+            buffers.push_back(OutputBufferPtr(new OutputBuffer(0)));
+            recv_iovs[i].iov_base = &data[i * MAX_LENGTH];
+            recv_iovs[i].iov_len = MAX_LENGTH;
+        }
+    }
+
+    // Reset the receive message headers for the next recvmmsg call.
+    void prepareRecv() {
+        std::memset(&recv_msgs[0], 0, sizeof(recv_msgs[0]) * recv_msgs.size());
+        for (size_t i = 0; i < recv_msgs.size(); ++i) {
+            recv_msgs[i].msg_hdr.msg_name = &addrs[i];
+            recv_msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            recv_msgs[i].msg_hdr.msg_iov = &recv_iovs[i];
+            recv_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    // Set the n-th send message to send the content of the i-th output
+    // buffer to the sender of the i-th received datagram.
+    void prepareSend(size_t n, size_t i) {
+        send_iovs[n].iov_base = const_cast<void*>(buffers[i]->getData());
+        send_iovs[n].iov_len = buffers[i]->getLength();
+        std::memset(&send_msgs[n], 0, sizeof(send_msgs[n]));
+        send_msgs[n].msg_hdr.msg_name = &addrs[i];
+        send_msgs[n].msg_hdr.msg_namelen = recv_msgs[i].msg_hdr.msg_namelen;
+        send_msgs[n].msg_hdr.msg_iov = &send_iovs[n];
+        send_msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::vector<uint8_t> data;
+    std::vector<struct sockaddr_storage> addrs;
+    std::vector<struct iovec> recv_iovs;
+    std::vector<struct mmsghdr> recv_msgs;
+    std::vector<struct iovec> send_iovs;
+    std::vector<struct mmsghdr> send_msgs;
+    std::vector<OutputBufferPtr> buffers;
+};
+#else
+// Batched mode isn't supported; this is never instantiated.
+struct SyncUDPServer::BatchBuffers {};
+#endif
+
+#ifdef BATCH_SUPPORTED
+namespace internal {
+size_t
+sendMessages(const int fd, struct mmsghdr* msgs, const size_t count) {
+    size_t n_sent = 0;
+    while (n_sent < count) {
+        const int ret = sendmmsg(fd, msgs + n_sent, count - n_sent,
+                                 MSG_DONTWAIT);
+        if (ret > 0) {
+            n_sent += ret;
+            continue;
+        }
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // The socket buffer is full.  Wait until it has room, as the
+            // (blocking) send_to() of the non batched mode would do.
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, -1) >= 0 || errno == EINTR) {
+                continue;
+            }
+        } else if (ret == 0) {
+            // This shouldn't happen, but we must not loop forever.
+            errno = EIO;
+        }
+        break;
+    }
+    return (n_sent);
+}
+} // namespace internal
+#endif
+
+const size_t SyncUDPServer::DEFAULT_BATCH_SIZE;
+
 SyncUDPServerPtr
 SyncUDPServer::create(asio::io_service& io_service, const int fd,
-                      const int af, DNSLookup* lookup)
+                      const int af, DNSLookup* lookup,
+                      const size_t batch_size)
 {
-    return (SyncUDPServerPtr(new SyncUDPServer(io_service, fd, af, lookup)));
+    return (SyncUDPServerPtr(new SyncUDPServer(io_service, fd, af, lookup,
+                                               batch_size)));
 }
 
 SyncUDPServer::SyncUDPServer(asio::io_service& io_service, const int fd,
-                             const int af, DNSLookup* lookup) :
+                             const int af, DNSLookup* lookup,
+                             const size_t batch_size) :
     output_buffer_(new bundy::util::OutputBuffer(0)),
     query_(new bundy::dns::Message(bundy::dns::Message::PARSE)),
     udp_endpoint_(sender_), lookup_callback_(lookup),
-    resume_called_(false), done_(false), stopped_(false)
+    resume_called_(false), done_(false), stopped_(false),
+    batch_size_(1)
 {
     if (af != AF_INET && af != AF_INET6) {
         bundy_throw(InvalidParameter, "Address family must be either AF_INET "
@@ -62,6 +167,16 @@ SyncUDPServer::SyncUDPServer(asio::io_service& io_service, const int fd,
         bundy_throw(InvalidParameter, "null lookup callback given to "
                   "SyncUDPServer");
     }
+    if (batch_size == 0) {
+        bundy_throw(InvalidParameter, "batch size of SyncUDPServer must not "
+                    "be 0");
+    }
+#ifdef BATCH_SUPPORTED
+    if (batch_size > 1) {
+        batch_.reset(new BatchBuffers(batch_size));
+        batch_size_ = batch_size;
+    }
+#endif
     LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_FD_ADD_UDP).arg(fd);
     try {
         socket_.reset(new asio::ip::udp::socket(io_service));
@@ -75,63 +190,86 @@ SyncUDPServer::SyncUDPServer(asio::io_service& io_service, const int fd,
     udp_socket_.reset(new UDPSocket<DummyIOCallback>(*socket_));
 }
 
+SyncUDPServer::~SyncUDPServer() {
+}
+
 void
 SyncUDPServer::scheduleRead() {
+    if (batch_) {
+        // We only wait for the socket to be readable; the datagrams are
+        // read in handleBatchRead().
+        socket_->async_receive(
+            asio::null_buffers(),
+            boost::bind(&SyncUDPServer::handleBatchRead, shared_from_this(),
+                        _1));
+        return;
+    }
     socket_->async_receive_from(
         asio::mutable_buffers_1(data_, MAX_LENGTH), sender_,
         boost::bind(&SyncUDPServer::handleRead, shared_from_this(), _1, _2));
 }
 
-void
-SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
-    if (stopped_) {
-        // stopped_ can be set to true only after the socket object is closed.
-        // checking this would also detect premature destruction of 'this'
-        // object.
-        assert(socket_ && !socket_->is_open());
-        return;
-    }
-    if (ec) {
-        using namespace asio::error;
-        const asio::error_code::value_type err_val = ec.value();
+bool
+SyncUDPServer::checkReadError(const asio::error_code& ec) {
+    using namespace asio::error;
+    const asio::error_code::value_type err_val = ec.value();
 
-        // See TCPServer::operator() for details on error handling.
-        if (err_val == operation_aborted || err_val == bad_descriptor) {
-            return;
-        }
-        if (err_val != would_block && err_val != try_again &&
-            err_val != interrupted) {
-            LOG_ERROR(logger, ASIODNS_UDP_SYNC_RECEIVE_FAIL).arg(ec.message());
-        }
+    // See TCPServer::operator() for details on error handling.
+    if (err_val == operation_aborted || err_val == bad_descriptor) {
+        return (false);
     }
-    if (ec || length == 0) {
-        scheduleRead();
-        return;
+    if (err_val != would_block && err_val != try_again &&
+        err_val != interrupted) {
+        LOG_ERROR(logger, ASIODNS_UDP_SYNC_RECEIVE_FAIL).arg(ec.message());
     }
-    // OK, we have a real packet of data. Let's dig into it!
+    return (true);
+}
 
+bool
+SyncUDPServer::processQuery(const uint8_t* data, const size_t length,
+                            const OutputBufferPtr& buffer)
+{
     // Make sure the buffers are fresh.  Note that we don't touch query_
     // because it's supposed to be cleared in lookup_callback_.  We should
     // eventually even remove this member variable (and remove it from
     // the lookup_callback_ interface, but until then, any callback
     // implementation should be careful that it's the responsibility of
     // the callback implementation.  See also #2239).
-    output_buffer_->clear();
+    buffer->clear();
 
     // Mark that we don't have an answer yet.
     done_ = false;
     resume_called_ = false;
 
     // Call the actual lookup
-    const IOMessage message(data_, length, *udp_socket_, udp_endpoint_);
-    (*lookup_callback_)(message, query_, answer_, output_buffer_, this);
+    const IOMessage message(data, length, *udp_socket_, udp_endpoint_);
+    (*lookup_callback_)(message, query_, answer_, buffer, this);
 
     if (!resume_called_) {
         bundy_throw(bundy::Unexpected,
                   "No resume called from the lookup callback");
     }
+    return (done_);
+}
 
-    if (done_) {
+void
+SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
+    if (stopped_) {
+        // stopped_ can be set to true only after the socket object is closed.
+        // checking this would also detect premature destruction of 'this'
+        // object.
+        assert(socket_ && !socket_->is_open());
+        return;
+    }
+    if (ec && !checkReadError(ec)) {
+        return;
+    }
+    if (ec || length == 0) {
+        scheduleRead();
+        return;
+    }
+    // OK, we have a real packet of data. Let's dig into it!
+    if (processQuery(data_, length, output_buffer_)) {
         // Good, there's an answer.
         socket_->send_to(asio::const_buffers_1(output_buffer_->getData(),
                                                output_buffer_->getLength()),
@@ -146,6 +284,81 @@ SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
     scheduleRead();
 }
 
+void
+SyncUDPServer::handleBatchRead(const asio::error_code& ec) {
+    if (stopped_) {
+        // See handleRead().
+        assert(socket_ && !socket_->is_open());
+        return;
+    }
+    if (ec) {
+        if (checkReadError(ec)) {
+            scheduleRead();
+        }
+        return;
+    }
+#ifdef BATCH_SUPPORTED
+    const int fd = socket_->native();
+    BatchBuffers& batch = *batch_;
+
+    // Receive as many datagrams as available (up to the batch size) without
+    // blocking.
+    batch.prepareRecv();
+    const int n_recv = recvmmsg(fd, &batch.recv_msgs[0], batch_size_,
+                                MSG_DONTWAIT, NULL);
+    if (n_recv < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_ERROR(logger, ASIODNS_UDP_SYNC_RECEIVE_FAIL).
+                arg(strerror(errno));
+        }
+        scheduleRead();
+        return;
+    }
+
+    // Process all received queries, building the list of answers.
+    size_t n_answers = 0;
+    for (int i = 0; i < n_recv; ++i) {
+        const size_t length = batch.recv_msgs[i].msg_len;
+        const socklen_t addr_len = batch.recv_msgs[i].msg_hdr.msg_namelen;
+        if (length == 0 || addr_len > sender_.capacity()) {
+            continue;
+        }
+        std::memcpy(sender_.data(), &batch.addrs[i], addr_len);
+        sender_.resize(addr_len);
+        const bool done = processQuery(&batch.data[i * MAX_LENGTH], length,
+                                       batch.buffers[i]);
+        if (stopped_) {
+            // The lookup callback stopped the server; there's no socket
+            // to send the answers anymore.
+            return;
+        }
+        if (done) {
+            batch.prepareSend(n_answers++, i);
+        }
+    }
+
+    // Send all answers.  If sending one of them fails, we log it and skip
+    // it, and try the rest.
+    size_t n_sent = 0;
+    while (n_sent < n_answers) {
+        n_sent += internal::sendMessages(fd, &batch.send_msgs[n_sent],
+                                         n_answers - n_sent);
+        if (n_sent < n_answers) {
+            std::memcpy(sender_.data(),
+                        batch.send_msgs[n_sent].msg_hdr.msg_name,
+                        batch.send_msgs[n_sent].msg_hdr.msg_namelen);
+            sender_.resize(batch.send_msgs[n_sent].msg_hdr.msg_namelen);
+            LOG_ERROR(logger, ASIODNS_UDP_SYNC_SEND_FAIL).
+                arg(sender_.address().to_string()).arg(strerror(errno));
+            ++n_sent;
+        }
+    }
+#endif
+
+    // And wait for more queries.
+    scheduleRead();
+}
+
 void
 SyncUDPServer::operator()(asio::error_code, size_t) {
     // To start the server, we just schedule reading of data when they
@@ -37,6 +37,8 @@
 
 #include <stdint.h>
 
+struct mmsghdr;                 // defined in <sys/socket.h> if supported
+
 namespace bundy {
 namespace asiodns {
 
@@ -63,9 +65,16 @@ private:
     ///
     /// This is hidden as private (see the class description).
     SyncUDPServer(asio::io_service& io_service, const int fd, const int af,
-                  DNSLookup* lookup);
+                  DNSLookup* lookup, const size_t batch_size);
 
 public:
+    /// \brief The default number of datagrams handled at once in the
+    /// batched mode (see \c create()).
+    static const size_t DEFAULT_BATCH_SIZE = 32;
+
+    /// \brief The destructor.
+    virtual ~SyncUDPServer();
+
     /// \brief Factory of SyncUDPServer object in the form of shared_ptr.
     ///
     /// Due to the nature of this server, it's meaningless if the lookup
@@ -77,18 +86,32 @@ public:
     /// complete answer is built in the lookup callback (it's the user's
     /// responsibility to guarantee that condition).
     ///
+    /// If \c batch_size is larger than 1, the server works in the "batched"
+    /// mode: whenever the socket becomes readable, it receives up to
+    /// \c batch_size datagrams in a single \c recvmmsg(2) call, calls the
+    /// lookup callback for each of them, and sends all the answers in a
+    /// single \c sendmmsg(2) call.  This reduces the system call overhead
+    /// at high query rates.  Each query in a batch is given a separate
+    /// output buffer, so the lookup callback can't assume that the same
+    /// buffer is passed every time.  If the system doesn't support these
+    /// calls, \c batch_size is ignored and datagrams are handled one by one.
+    ///
     /// \param io_service the asio::io_service to work with
     /// \param fd the file descriptor of opened UDP socket
     /// \param af address family, either AF_INET or AF_INET6
     /// \param lookup the callbackprovider for DNS lookup events (must not be
     ///        NULL)
+    /// \param batch_size the maximum number of datagrams handled at once
+    ///        (must not be 0)
     ///
     /// \throw bundy::InvalidParameter if af is neither AF_INET nor AF_INET6
     /// \throw bundy::InvalidParameter lookup is NULL
+    /// \throw bundy::InvalidParameter batch_size is 0
     /// \throw bundy::asiolink::IOError when a low-level error happens, like the
     ///     fd is not a valid descriptor.
     static SyncUDPServerPtr create(asio::io_service& io_service, const int fd,
-                                   const int af, DNSLookup* lookup);
+                                   const int af, DNSLookup* lookup,
+                                   const size_t batch_size = 1);
 
     /// \brief Start the SyncUDPServer.
     ///
@@ -136,6 +159,12 @@ public:
     virtual DNSServer* clone() {
         bundy_throw(Unexpected, "SyncUDPServer can't be cloned.");
     }
+
+    /// \brief Return the number of datagrams handled at once.
+    ///
+    /// This is 1 unless the server works in the batched mode (see
+    /// \c create()).
+    size_t getBatchSize() const { return (batch_size_); }
 private:
     // Internal state & buffers. We don't use the PIMPL idiom, as this class
     // isn't usually used directly anyway.
@@ -176,17 +205,57 @@ private:
     // Placeholder for error code object.  It will be passed to ASIO library
     // to have it set in case of error.
     asio::error_code ec_;
+    // The maximum number of datagrams handled at once.
+    size_t batch_size_;
+    // Buffers used in the batched mode (only created in that mode).  The
+    // definition depends on system support, so it's hidden in the .cc file.
+    struct BatchBuffers;
+    boost::scoped_ptr<BatchBuffers> batch_;
 
     // Auxiliary functions
 
     // Schedule next read on the socket. Just a wrapper around
-    // socket_->async_read_from with the correct parameters.
+    // socket_->async_read_from with the correct parameters (or, in the
+    // batched mode, socket_->async_receive to wait for the socket to be
+    // readable).
     void scheduleRead();
+    // Log an error of receiving a packet, unless it's transient.  Returns
+    // true if the server should keep reading from the socket.
+    bool checkReadError(const asio::error_code& ec);
     // Callback from the socket's read call (called when there's an error or
     // when a new packet comes).
     void handleRead(const asio::error_code& ec, const size_t length);
+    // Callback in the batched mode, called when the socket is readable.
+    void handleBatchRead(const asio::error_code& ec);
+    // Call the lookup callback for a single query in data, rendering the
+    // answer (if any) in buffer.  Returns true if there's an answer to send.
+    // sender_ must be set to the sender of the query beforehand.
+    bool processQuery(const uint8_t* data, size_t length,
+                      const bundy::util::OutputBufferPtr& buffer);
 };
 
+namespace internal {
+/// \brief Send messages on a socket with \c sendmmsg(2).
+///
+/// This is an internal helper of \c SyncUDPServer in the batched mode,
+/// exposed only for tests.  It's only defined if the system supports
+/// \c sendmmsg(2).
+///
+/// It sends \c count messages starting at \c msgs in as many
+/// \c sendmmsg(2) calls as needed, as the system may send only some of
+/// them at once.  If the socket buffer is full (\c EAGAIN), it waits for
+/// the socket to become writable and retries, so no message is dropped just
+/// because the socket is non blocking.  It stops at the first message that
+/// fails to be sent for any other reason.
+///
+/// \param fd The socket to send the messages on.
+/// \param msgs The messages to send.
+/// \param count The number of messages in \c msgs.
+/// \return The number of messages sent.  If it's smaller than \c count,
+/// sending the next message failed, and \c errno indicates the reason.
+size_t sendMessages(int fd, struct mmsghdr* msgs, size_t count);
+} // namespace internal
+
 } // namespace asiodns
 } // namespace bundy
 #endif // SYNC_UDP_SERVER_H
@@ -23,7 +23,9 @@
 #include <asiodns/tcp_server.h>
 #include <asiodns/dns_answer.h>
 #include <asiodns/dns_lookup.h>
+#include <util/threads/thread.h>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <cerrno>
 #include <csignal>
@@ -462,7 +464,7 @@ class DNSServerTestBase : public::testing::Test {
 // Initialization (by the file descriptor)
 template<class UDPServerClass>
 class FdInit : public DNSServerTestBase<UDPServerClass> {
-private:
+protected:
     // Opens the file descriptor for us
     // It uses the low-level C api, as it seems to be the easiest way to get
     // a raw file descriptor. It also is what the socket creator does and this
@@ -756,6 +758,92 @@ TEST_F(SyncServerTest, nullLookupCallback) {
                  bundy::InvalidParameter);
 }
 
+// Batch size must be positive.
+TEST_F(SyncServerTest, zeroBatchSize) {
+    EXPECT_THROW(SyncUDPServer::create(service, 0, AF_INET, lookup_, 0),
+                 bundy::InvalidParameter);
+}
+
+// The same as stopUDPServerAfterOneQuery, but in the batched mode.  If the
+// system doesn't support batching, it should silently fall back to the
+// non batched mode and the test should still pass.
+TEST_F(SyncServerTest, batchedQuery) {
+    EXPECT_EQ(1, udp_server_->getBatchSize());
+
+    // Replace the server with a batched one.
+    udp_server_->stop();
+    const int fd(getFd(SOCK_DGRAM));
+    ASSERT_NE(-1, fd) << strerror(errno);
+    udp_server_ = SyncUDPServer::create(service, fd, AF_INET6, lookup_,
+                                        SyncUDPServer::DEFAULT_BATCH_SIZE);
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+    EXPECT_EQ(SyncUDPServer::DEFAULT_BATCH_SIZE, udp_server_->getBatchSize());
+#else
+    EXPECT_EQ(1, udp_server_->getBatchSize());
+#endif
+
+    testStopServerByStopper(*udp_server_, udp_client_, udp_client_);
+    EXPECT_EQ(query_message, udp_client_->getReceivedData());
+    EXPECT_TRUE(serverStopSucceed());
+}
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+// Receive count datagrams on fd after a short delay (so the sender fills
+// the socket buffer first), checking each contains its index.
+void
+receiveMessages(int fd, size_t count, size_t* received) {
+    usleep(100000);
+    for (*received = 0; *received < count; ++*received) {
+        uint8_t data[sizeof(size_t)];
+        if (recv(fd, data, sizeof(data), 0) != sizeof(data)) {
+            return;
+        }
+        size_t index;
+        std::memcpy(&index, data, sizeof(index));
+        if (index != *received) {
+            return;
+        }
+    }
+}
+
+// The batched mode sends the answers with sendmmsg on a non blocking
+// socket.  When the socket buffer is full, the system sends only some of
+// the messages and then none; the rest must be sent once the socket becomes
+// writable, not dropped.  An AF_UNIX datagram socket allows only a few
+// unread datagrams, which lets us test it easily.
+TEST(SyncUDPServerSendTest, partialSend) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+
+    const size_t count = 100;
+    std::vector<size_t> data(count);
+    std::vector<struct iovec> iovs(count);
+    std::vector<struct mmsghdr> msgs(count);
+    std::memset(&msgs[0], 0, sizeof(msgs[0]) * count);
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = i;
+        iovs[i].iov_base = &data[i];
+        iovs[i].iov_len = sizeof(data[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t received = 0;
+    bundy::util::thread::Thread receiver(
+        boost::bind(receiveMessages, fds[1], count, &received));
+    EXPECT_EQ(count, internal::sendMessages(fds[0], &msgs[0], count));
+    receiver.wait();
+    EXPECT_EQ(count, received);
+
+    // Other errors are reported with the number of messages sent so far.
+    close(fds[1]);
+    errno = 0;
+    EXPECT_EQ(0, internal::sendMessages(fds[0], &msgs[0], count));
+    EXPECT_NE(0, errno);
+    close(fds[0]);
+}
+#endif
+
 TEST_F(SyncServerTest, resetUDPServerBeforeEvent) {
     // Reset the UDP server object after starting and before it would get
     // an event from io_service (in this case abort event).  The following
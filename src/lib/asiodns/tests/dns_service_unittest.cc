@@ -221,11 +221,25 @@ TEST_F(UDPDNSServiceTest, syncUDPServerFromFD) {
     EXPECT_EQ(first_buffer_, second_buffer_);
 }
 
+TEST_F(UDPDNSServiceTest, syncBatchUDPServerFromFD) {
+    // With "BATCH_OK" in addition to "SYNC_OK", a synchronous server should
+    // be created in the batched mode (if supported).  The two queries may or
+    // may not be received in a single batch, so we can't tell anything about
+    // the buffers; we only check that both queries are handled.
+    dns_service.addServerUDPFromFD(
+        getSocketFD(AF_INET6, TEST_IPV6_ADDR, TEST_SERVER_PORT), AF_INET6,
+        static_cast<DNSService::ServerFlag>(DNSService::SERVER_SYNC_OK |
+                                            DNSService::SERVER_BATCH_OK));
+    runService();
+    EXPECT_TRUE(serverStopSucceed());
+    EXPECT_NE(static_cast<bundy::util::OutputBuffer*>(NULL), second_buffer_);
+}
+
 TEST_F(UDPDNSServiceTest, addUDPServerFromFDWithUnknownOption) {
     // Use of undefined/incompatible options should result in an exception.
     EXPECT_THROW(dns_service.addServerUDPFromFD(
                      getSocketFD(AF_INET6, TEST_IPV6_ADDR, TEST_SERVER_PORT),
-                     AF_INET6, static_cast<DNSService::ServerFlag>(2)),
+                     AF_INET6, static_cast<DNSService::ServerFlag>(4)),
                  bundy::InvalidParameter);
 }
 
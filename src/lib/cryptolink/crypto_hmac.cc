@@ -65,7 +65,9 @@ namespace cryptolink {
 class HMACImpl {
 public:
     explicit HMACImpl(const void* secret, size_t secret_len,
-                      const HashAlgorithm hash_algorithm) {
+                      const HashAlgorithm hash_algorithm) :
+        updated_(false)
+    {
         Botan::HashFunction* hash;
         try {
             hash = Botan::get_hash(
@@ -132,6 +134,7 @@ public:
     void update(const void* data, const size_t len) {
         try {
             hmac_->update(static_cast<const Botan::byte*>(data), len);
+            updated_ = true;
         } catch (const Botan::Exception& exc) {
             bundy_throw(bundy::cryptolink::LibraryError, exc.what());
         }
@@ -139,7 +142,7 @@ public:
 
     void sign(bundy::util::OutputBuffer& result, size_t len) {
         try {
-            Botan::SecureVector<Botan::byte> b_result(hmac_->final());
+            Botan::SecureVector<Botan::byte> b_result(final());
 
             if (len == 0 || len > b_result.size()) {
                 len = b_result.size();
@@ -152,7 +155,7 @@ public:
 
     void sign(void* result, size_t len) {
         try {
-            Botan::SecureVector<Botan::byte> b_result(hmac_->final());
+            Botan::SecureVector<Botan::byte> b_result(final());
             size_t output_size = getOutputLength();
             if (output_size > len) {
                 output_size = len;
@@ -165,7 +168,7 @@ public:
 
     std::vector<uint8_t> sign(size_t len) {
         try {
-            Botan::SecureVector<Botan::byte> b_result(hmac_->final());
+            Botan::SecureVector<Botan::byte> b_result(final());
             if (len == 0 || len > b_result.size()) {
                 return (std::vector<uint8_t>(b_result.begin(), b_result.end()));
             } else {
@@ -183,7 +186,7 @@ public:
         // the check ourselves
         // SEE BELOW FOR TEMPORARY CHANGE
         try {
-            Botan::SecureVector<Botan::byte> our_mac = hmac_->final();
+            Botan::SecureVector<Botan::byte> our_mac = final();
             if (len < getOutputLength()) {
                 // Currently we don't support truncated signature in TSIG (see
                 // #920).  To avoid validating too short signature accidently,
@@ -203,8 +206,27 @@ public:
         }
     }
 
+    void reset() {
+        if (updated_) {
+            try {
+                final();
+            } catch (const Botan::Exception& exc) {
+                bundy_throw(bundy::cryptolink::LibraryError, exc.what());
+            }
+        }
+    }
+
 private:
+    // Botan resets the HMAC state to the keyed initial one in final(), so
+    // the same object can be reused for the next signature.
+    Botan::SecureVector<Botan::byte> final() {
+        Botan::SecureVector<Botan::byte> result(hmac_->final());
+        updated_ = false;
+        return (result);
+    }
+
     boost::scoped_ptr<Botan::HMAC> hmac_;
+    bool updated_;              // whether there's data since the last final()
 };
 
 HMAC::HMAC(const void* secret, size_t secret_length,
@@ -247,6 +269,11 @@ HMAC::verify(const void* sig, const size_t len) {
     return (impl_->verify(sig, len));
 }
 
+void
+HMAC::reset() {
+    impl_->reset();
+}
+
 void
 signHMAC(const void* data, const size_t data_len, const void* secret,
          size_t secret_len, const HashAlgorithm hash_algorithm,
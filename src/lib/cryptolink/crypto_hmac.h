@@ -127,6 +127,19 @@ public:
     /// \return true if the signature is correct, false otherwise
     bool verify(const void* sig, size_t len);
 
+    /// \brief Discard the data added since the last signature
+    ///
+    /// Calculating or verifying a signature resets the object to the
+    /// initial state for the same secret, so an HMAC object can be used for
+    /// any number of signatures without being keyed again.  This method
+    /// resets the object in the same way when data has been added but no
+    /// signature was calculated or verified for it.  It does nothing if no
+    /// data has been added.
+    ///
+    /// \exception LibraryError if there was any unexpected exception
+    ///                         in the underlying library
+    void reset();
+
 private:
     HMACImpl* impl_;
 };
@@ -581,6 +581,38 @@ TEST(CryptoLinkTest, HMACSigLengthArgument) {
     EXPECT_EQ(32, sigBufferLength(SHA256, 3200));
 }
 
+TEST(CryptoLinkTest, HMACReuse) {
+    // HMAC-SHA1 of "Hi There" (RFC2202 test case 1)
+    const uint8_t secret[] = { 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                               0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                               0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b };
+    const uint8_t hmac_expected[] = { 0xb6, 0x17, 0x31, 0x86, 0x55, 0x05,
+                                      0x72, 0x64, 0xe2, 0x8b, 0xc0, 0xb6,
+                                      0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46,
+                                      0xbe, 0x00 };
+    boost::shared_ptr<HMAC> hmac(
+        CryptoLink::getCryptoLink().createHMAC(secret, sizeof(secret), SHA1),
+        deleteHMAC);
+
+    // The same object can be used for any number of signatures.
+    for (int i = 0; i < 3; ++i) {
+        hmac->update("Hi There", 8);
+        const std::vector<uint8_t> sig = hmac->sign();
+        ASSERT_EQ(sizeof(hmac_expected), sig.size());
+        checkData(&sig[0], hmac_expected, sizeof(hmac_expected));
+    }
+    hmac->update("Hi There", 8);
+    EXPECT_TRUE(hmac->verify(hmac_expected, sizeof(hmac_expected)));
+
+    // reset() discards the data added since the last signature, and does
+    // nothing if there's no such data.
+    hmac->update("garbage", 7);
+    hmac->reset();
+    hmac->reset();
+    hmac->update("Hi There", 8);
+    EXPECT_TRUE(hmac->verify(hmac_expected, sizeof(hmac_expected)));
+}
+
 TEST(CryptoLinkTest, BadKey) {
     OutputBuffer data_buf(0);
     OutputBuffer hmac_sig(0);
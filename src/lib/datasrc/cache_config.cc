@@ -54,6 +54,47 @@ getSegmentTypeFromConf(const Element& conf) {
     }
     return (conf.get("cache-type")->stringValue());
 }
+
+bool
+getPrerenderFromConf(const Element& conf) {
+    return (conf.contains("cache-prerender") &&
+            conf.get("cache-prerender")->boolValue());
+}
+
+bool
+getNameIndexFromConf(const Element& conf) {
+    return (conf.contains("cache-name-index") &&
+            conf.get("cache-name-index")->boolValue());
+}
+
+bool
+getCopyOnWriteFromConf(const Element& conf) {
+    return (conf.contains("cache-copy-on-write") &&
+            conf.get("cache-copy-on-write")->boolValue());
+}
+
+// Delta loading is only useful for mapped segments, so unless explicitly
+// configured it's enabled only for them.
+bool
+getDeltaLoadFromConf(const Element& conf) {
+    if (!conf.contains("cache-delta-load")) {
+        return (getSegmentTypeFromConf(conf) == "mapped");
+    }
+    return (conf.get("cache-delta-load")->boolValue());
+}
+
+size_t
+getLoadThreadCountFromConf(const Element& conf) {
+    if (!conf.contains("cache-load-threads")) {
+        return (1);
+    }
+    const int64_t count = conf.get("cache-load-threads")->intValue();
+    if (count < 1) {
+        bundy_throw(CacheConfigError,
+                    "cache-load-threads must be positive: " << count);
+    }
+    return (count);
+}
 }
 
 CacheConfig::CacheConfig(const std::string& datasrc_type,
@@ -62,6 +103,11 @@ CacheConfig::CacheConfig(const std::string& datasrc_type,
                          bool allowed) :
     enabled_(allowed && getEnabledFromConf(datasrc_conf)),
     segment_type_(getSegmentTypeFromConf(datasrc_conf)),
+    prerender_(getPrerenderFromConf(datasrc_conf)),
+    name_index_(getNameIndexFromConf(datasrc_conf)),
+    copy_on_write_(getCopyOnWriteFromConf(datasrc_conf)),
+    delta_load_(getDeltaLoadFromConf(datasrc_conf)),
+    load_thread_count_(getLoadThreadCountFromConf(datasrc_conf)),
     datasrc_client_(datasrc_client)
 {
     ConstElementPtr params = datasrc_conf.get("params");
@@ -121,16 +167,30 @@ CacheConfig::CacheConfig(const std::string& datasrc_type,
 }
 
 namespace {
+// The options given to ZoneDataLoader, bundled as boost::bind can't take
+// all of them separately.
+struct LoaderOptions {
+    bool prerender;
+    bool name_index;
+    size_t thread_count;
+    bool copy_on_write;
+    bool delta_load;
+};
+
 // We can't use the loadZoneData function directly in boost::bind, since
 // it is overloaded and the compiler can't choose the correct version
 // reliably and fails. So we simply wrap it into an unique name.
 memory::ZoneDataLoader*
 createLoaderFromFile(util::MemorySegment& segment, const dns::RRClass& rrclass,
                      const dns::Name& name, const std::string& filename,
-                     memory::ZoneData* old_data)
+                     const LoaderOptions& options, memory::ZoneData* old_data)
 {
     return (new memory::ZoneDataLoader(segment, rrclass, name, filename,
-                                       old_data));
+                                       old_data, options.prerender,
+                                       options.name_index,
+                                       options.thread_count,
+                                       options.copy_on_write,
+                                       options.delta_load));
 }
 
 memory::ZoneDataLoader*
@@ -138,17 +198,22 @@ createLoaderFromDataSource(util::MemorySegment& segment,
                            const dns::RRClass& rrclass,
                            const dns::Name& name,
                            const DataSourceClient* datasrc_client,
+                           const LoaderOptions& options,
                            memory::ZoneData* old_data)
 {
     return (new memory::ZoneDataLoader(segment, rrclass, name,
-                                       *datasrc_client, old_data));
+                                       *datasrc_client, old_data,
+                                       options.prerender, options.name_index,
+                                       options.copy_on_write,
+                                       options.delta_load));
 }
 
 } // unnamed namespace
 
 memory::ZoneDataLoaderCreator
 CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
-                              const dns::Name& zone_name) const
+                              const dns::Name& zone_name,
+                              size_t thread_count) const
 {
     // First, check if the specified zone is configured to be cached.
     Zones::const_iterator found = zone_config_.find(zone_name);
@@ -156,10 +221,15 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
         return (memory::ZoneDataLoaderCreator());
     }
 
+    const LoaderOptions options = {
+        prerender_, name_index_,
+        thread_count > 0 ? thread_count : load_thread_count_,
+        copy_on_write_, delta_load_
+    };
     if (!found->second.empty()) {
         // This is "MasterFiles" data source.
         return (boost::bind(createLoaderFromFile, _1, rrclass, zone_name,
-                            found->second, _2));
+                            found->second, options, _2));
     }
 
     // Otherwise there must be a "source" data source (ensured by constructor)
@@ -175,7 +245,7 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
     // Wrap the iterator into the correct functor (which keeps it alive as
     // long as it is needed).
     return (boost::bind(createLoaderFromDataSource, _1, rrclass, zone_name,
-                        datasrc_client_, _2));
+                        datasrc_client_, options, _2));
 }
 
 } // namespace internal
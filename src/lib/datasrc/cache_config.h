@@ -109,6 +109,13 @@ public:
     /// used for the cache.  It's given via the "cache-type" configuration
     /// item if defined; otherwise it defaults to "local".
     ///
+    /// Likewise, whether the cached data hold pre-rendered wire images
+    /// (see \c memory::RdataSet) is given via the "cache-prerender"
+    /// configuration item if defined; otherwise it defaults to false.
+    /// Whether the cached zone data keep the hash index of the names (see
+    /// \c memory::ZoneData::create()) is given via the "cache-name-index"
+    /// item in the same way.
+    ///
     /// \throw InvalidParameter Program error at the caller side rather than
     /// in the configuration (see above)
     /// \throw CacheConfigError There is a semantics error in the given
@@ -147,6 +154,40 @@ public:
     /// \throw None
     const std::string& getSegmentType() const { return (segment_type_); }
 
+    /// \brief Return if the cached data hold pre-rendered wire images.
+    ///
+    /// \throw None
+    bool isPrerenderEnabled() const { return (prerender_); }
+
+    /// \brief Return if the cached zone data keep the name index.
+    ///
+    /// \throw None
+    bool isNameIndexEnabled() const { return (name_index_); }
+
+    /// \brief Return if cached zones are updated with the differences
+    /// (from the journal, or found by delta loading) in a copy of the zone
+    /// data.
+    ///
+    /// \throw None
+    bool isCopyOnWriteEnabled() const { return (copy_on_write_); }
+
+    /// \brief Return if cached zones are updated only with the differences
+    /// from the new version, when there's no journal for them (see
+    /// \c memory::ZoneDataLoader).
+    ///
+    /// It's the value of the "cache-delta-load" configuration item if
+    /// given; otherwise it's true iff the segment type is "mapped".
+    ///
+    /// \throw None
+    bool isDeltaLoadEnabled() const { return (delta_load_); }
+
+    /// \brief Return the maximum number of threads used to load the cached
+    /// zones at once (see \c memory::ZoneTableLoader), and to parse the
+    /// master file of each zone (see \c dns::MasterLoader).
+    ///
+    /// \throw None
+    size_t getLoadThreadCount() const { return (load_thread_count_); }
+
     /// \brief Return a \c LoadAction functor to load zone data into memory.
     ///
     /// This method returns an appropriate \c LoadAction functor that can be
@@ -200,10 +241,14 @@ public:
     ///
     /// \param rrclass The RR class of the zone
     /// \param zname The origin name of the zone
+    /// \param thread_count The maximum number of threads to parse the master
+    /// file of the zone, if it's a "MasterFiles" data source.  If it's 0,
+    /// \c getLoadThreadCount() is used.
     /// \return A \c ZoneDataLoaderCreator functor to be used to load zone
     /// data or an empty functor (see above).
     memory::ZoneDataLoaderCreator getLoaderCreator(
-        const dns::RRClass& rrclass, const dns::Name& zname) const;
+        const dns::RRClass& rrclass, const dns::Name& zname,
+        size_t thread_count = 0) const;
 
     /// \brief Read only iterator type over configured cached zones.
     ///
@@ -232,6 +277,11 @@ public:
 private:
     const bool enabled_; // if the use of in-memory zone table is enabled
     const std::string segment_type_;
+    const bool prerender_; // if RdataSets hold wire images
+    const bool name_index_; // if zone data keep the name index
+    const bool copy_on_write_; // if journal updates are made in a copy
+    const bool delta_load_; // if only differences are applied without journal
+    const size_t load_thread_count_; // threads for loading zones
     // client of underlying data source, will be NULL for MasterFile datasrc
     const DataSourceClient* datasrc_client_;
 
@@ -20,7 +20,10 @@
 #include <datasrc/cache_config.h>
 #include <datasrc/memory/memory_client.h>
 #include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_data.h>
 #include <datasrc/memory/zone_writer.h>
+#include <datasrc/memory/zone_table_loader.h>
 #include <datasrc/memory/zone_data_loader.h>
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/logger.h>
@@ -28,6 +31,8 @@
 #include <dns/masterload.h>
 #include <util/memory_segment_local.h>
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <boost/foreach.hpp>
@@ -70,6 +75,28 @@ ConfigurableClientList::DataSourceInfo::getCacheClient() const {
     return (cache_.get());
 }
 
+namespace {
+// Log the result of the initial load of a zone into the cache.
+void
+logInitialLoad(const RRClass& rrclass, const string& datasrc_name,
+               const Name& zname, memory::ZoneTableLoader::Result result,
+               const string& error_msg)
+{
+    switch (result) {
+    case memory::ZoneTableLoader::SUCCESS:
+        break;
+    case memory::ZoneTableLoader::LOAD_ERROR:
+        LOG_ERROR(logger, DATASRC_LOAD_ZONE_ERROR).arg(zname).
+            arg(rrclass).arg(datasrc_name).arg(error_msg);
+        break;
+    case memory::ZoneTableLoader::NOT_FOUND:
+        LOG_ERROR(logger, DATASRC_CACHE_ZONE_NOTFOUND).
+            arg(zname).arg(rrclass).arg(datasrc_name);
+        break;
+    }
+}
+}
+
 ConfigurableClientList::ConfigurableClientList(const RRClass& rrclass) :
     rrclass_(rrclass),
     configuration_(new bundy::data::ListElement),
@@ -156,8 +183,20 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
                 continue;
             }
 
+            // Zones are loaded at once by the table loader, possibly in
+            // multiple threads (see cache-load-threads).  Master files are
+            // also parsed in multiple threads, so we share the threads
+            // between the zones loaded at the same time to keep the total
+            // within the configured number.
+            const size_t thread_count = cache_conf->getLoadThreadCount();
+            memory::ZoneTableLoader table_loader(zt_segment, rrclass_,
+                                                 thread_count);
             internal::CacheConfig::ConstZoneIterator end_of_zones =
                 cache_conf->end();
+            const size_t parse_thread_count = std::max<size_t>(
+                thread_count / table_loader.getWorkerCount(
+                    std::distance(cache_conf->begin(), end_of_zones)),
+                1);
             for (internal::CacheConfig::ConstZoneIterator zone_it =
                      cache_conf->begin();
                  zone_it != end_of_zones;
@@ -166,27 +205,20 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
                 const Name& zname = zone_it->first;
                 try {
                     const memory::ZoneDataLoaderCreator loader_creator =
-                        cache_conf->getLoaderCreator(rrclass_, zname);
+                        cache_conf->getLoaderCreator(rrclass_, zname,
+                                                     parse_thread_count);
                     // in this loop this should be always true
                     assert(loader_creator);
-                    // For the initial load, we'll let the writer handle
-                    // loading error and install an empty zone in the table.
-                    memory::ZoneWriter writer(zt_segment, loader_creator, zname,
-                                              rrclass_, true);
-
-                    std::string error_msg;
-                    writer.load(0, &error_msg);
-                    if (!error_msg.empty()) {
-                        LOG_ERROR(logger, DATASRC_LOAD_ZONE_ERROR).arg(zname).
-                            arg(rrclass_).arg(datasrc_name).arg(error_msg);
-                    }
-                    writer.install();
-                    writer.cleanup();
+                    table_loader.add(zname, loader_creator);
                 } catch (const NoSuchZone&) {
                     LOG_ERROR(logger, DATASRC_CACHE_ZONE_NOTFOUND).
                         arg(zname).arg(rrclass_).arg(datasrc_name);
                 }
             }
+            // For the initial load, the loader installs an empty zone in
+            // the table on loading error.
+            table_loader.load(boost::bind(logInitialLoad, rrclass_,
+                                          datasrc_name, _1, _2, _3));
         }
         // If everything is OK up until now, we have the new configuration
         // ready. So just put it there and let the old one die when we exit
@@ -411,16 +443,46 @@ ConfigurableClientList::getDataSourceClient(const string& datasrc_name,
     return (DataSourcePair(&container->getInstance(), container));
 }
 
+namespace {
+// Get the status of the zones of the given cache configuration that are
+// loaded in the cache.  Zones that failed to load (and are "empty" in the
+// cache) are skipped.
+vector<CachedZoneStatus>
+getCachedZoneStatus(const internal::CacheConfig& config,
+                    const ZoneTableSegment& ztable_segment)
+{
+    vector<CachedZoneStatus> zones;
+    const memory::ZoneTable* const table =
+        ztable_segment.getHeader().getTable();
+    if (!table) {
+        return (zones);
+    }
+    for (internal::CacheConfig::ConstZoneIterator it = config.begin();
+         it != config.end(); ++it) {
+        const memory::ZoneTable::FindResult found = table->findZone(it->first);
+        if (found.code == result::SUCCESS && found.zone_data) {
+            zones.push_back(
+                CachedZoneStatus(it->first, found.zone_data->getMemorySize(),
+                                 found.zone_data->getLoadTime()));
+        }
+    }
+    return (zones);
+}
+}
+
 vector<DataSourceStatus>
-ConfigurableClientList::getStatus() const {
+ConfigurableClientList::getStatus(bool with_zones) const {
     vector<DataSourceStatus> result;
     BOOST_FOREACH(const DataSourceInfo& info, data_sources_) {
         if (info.ztable_segment_) {
+            const bool usable = info.ztable_segment_->isUsable();
             result.push_back(DataSourceStatus(
-                info.name_,
-                (info.ztable_segment_->isUsable() ?
-                 SEGMENT_INUSE : SEGMENT_WAITING),
-                info.ztable_segment_->getImplType()));
+                info.name_, (usable ? SEGMENT_INUSE : SEGMENT_WAITING),
+                info.ztable_segment_->getImplType(),
+                ((with_zones && usable) ?
+                 getCachedZoneStatus(*info.getCacheConfig(),
+                                     *info.ztable_segment_) :
+                 vector<CachedZoneStatus>())));
         } else {
             result.push_back(DataSourceStatus(info.name_));
         }
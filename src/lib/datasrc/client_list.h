@@ -69,6 +69,42 @@ enum MemorySegmentState {
     SEGMENT_INUSE
 };
 
+/// \brief Status of a zone in the in-memory cache.
+///
+/// This represents the memory used by a cached zone and the time it took
+/// to load it, as recorded when the zone was last loaded or updated in the
+/// cache (see \c memory::ZoneData::getMemorySize() and
+/// \c memory::ZoneData::getLoadTime()).
+class CachedZoneStatus {
+public:
+    /// \brief Constructor
+    CachedZoneStatus(const dns::Name& name, size_t memory_size,
+                     uint64_t load_time) :
+        name_(name),
+        memory_size_(memory_size),
+        load_time_(load_time)
+    {}
+
+    /// \brief Get the zone name.
+    const dns::Name& getName() const {
+        return (name_);
+    }
+
+    /// \brief Get the size of the memory used by the zone in bytes.
+    size_t getMemorySize() const {
+        return (memory_size_);
+    }
+
+    /// \brief Get the time it took to load the zone in microseconds.
+    uint64_t getLoadTime() const {
+        return (load_time_);
+    }
+private:
+    dns::Name name_;
+    size_t memory_size_;
+    uint64_t load_time_;
+};
+
 /// \brief Status of one data source.
 ///
 /// This indicates the status a data soure is in. It is used with segment
@@ -83,11 +119,16 @@ public:
     ///
     /// Sets initial values. If you want to use \c SEGMENT_UNUSED as the
     /// state, please use the other constructor.
+    ///
+    /// \c zones is the status of the zones in the cache, if it's known.
     DataSourceStatus(const std::string& name, MemorySegmentState state,
-                     const std::string& type) :
+                     const std::string& type,
+                     const std::vector<CachedZoneStatus>& zones =
+                     std::vector<CachedZoneStatus>()) :
         name_(name),
         type_(type),
-        state_(state)
+        state_(state),
+        zones_(zones)
     {
         assert (state != SEGMENT_UNUSED);
         assert (!type.empty());
@@ -128,10 +169,31 @@ public:
     const std::string& getName() const {
         return (name_);
     }
+
+    /// \brief Get the status of the zones in the cache.
+    ///
+    /// It's empty unless the status was created with the zones (see
+    /// \c ConfigurableClientList::getStatus()).
+    const std::vector<CachedZoneStatus>& getZoneStatus() const {
+        return (zones_);
+    }
+
+    /// \brief Get the total size of the memory used by the cached zones.
+    ///
+    /// It's the sum of the memory sizes of \c getZoneStatus().
+    size_t getMemorySize() const {
+        size_t size = 0;
+        for (std::vector<CachedZoneStatus>::const_iterator it =
+                 zones_.begin(); it != zones_.end(); ++it) {
+            size += it->getMemorySize();
+        }
+        return (size);
+    }
 private:
     std::string name_;
     std::string type_;
     MemorySegmentState state_;
+    std::vector<CachedZoneStatus> zones_;
 };
 
 /// \brief The list of data source clients.
@@ -527,9 +589,16 @@ public:
     /// Get a DataSourceStatus for current state of each data source client
     /// in this list.
     ///
+    /// If \c with_zones is true, the status of each zone that is loaded
+    /// in the cache of a data source (the segment of which is in use) is
+    /// also included; see \c DataSourceStatus::getZoneStatus().  It's not
+    /// by default as it involves searching the cache for every zone.
+    ///
     /// This may throw standard exceptions, such as std::bad_alloc. Otherwise,
     /// it is exception free.
-    std::vector<DataSourceStatus> getStatus() const;
+    ///
+    /// \param with_zones Whether to include the status of cached zones.
+    std::vector<DataSourceStatus> getStatus(bool with_zones = false) const;
 
     /// \brief Access to the data source clients.
     ///
@@ -0,0 +1,145 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <util/memory_segment_local.h>
+
+#include <dns/name.h>
+
+#include <datasrc/memory/domaintree.h>
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::vector;
+using namespace bundy::bench;
+using namespace bundy::datasrc::memory;
+using namespace bundy::dns;
+
+namespace {
+typedef DomainTree<int> TestDomainTree;
+typedef DomainTreeNode<int> TestDomainTreeNode;
+typedef DomainTreeNodeChain<int> TestDomainTreeNodeChain;
+
+// A benchmark repeating lookups of a given set of names in the tree.
+class FindBenchMark {
+public:
+    FindBenchMark(const TestDomainTree& tree, const vector<Name>& names) :
+        tree_(tree), names_(names)
+    {}
+    unsigned int run() {
+        const TestDomainTreeNode* node;
+        vector<Name>::const_iterator it;
+        const vector<Name>::const_iterator it_end = names_.end();
+        for (it = names_.begin(); it != it_end; ++it) {
+            TestDomainTreeNodeChain node_path;
+            tree_.find(*it, &node, node_path);
+        }
+        return (names_.size());
+    }
+private:
+    const TestDomainTree& tree_;
+    const vector<Name>& names_;
+};
+
+// All nodes share the same data, which doesn't have to be deleted.
+int node_data;
+
+void
+deleteData(int*) {}
+
+void
+usage() {
+    std::cerr << "Usage: domaintree_bench [-n iterations] [-s tree_size]"
+              << std::endl;
+    exit (1);
+}
+
+// Generate a random host name under the given origin.  The first label
+// has a fixed prefix, which is common in real world zones (e.g., "host",
+// "mail", "www") and is the harder case for label comparison.
+Name
+randomName(const char* prefix, const Name& origin) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    std::string label(prefix);
+    for (int i = 0; i < 8; ++i) {
+        label.push_back(chars[random() % (sizeof(chars) - 1)]);
+    }
+    return (Name(label).concatenate(origin));
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 100;
+    int tree_size = 1000000;
+    while ((ch = getopt(argc, argv, "n:s:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            tree_size = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || tree_size <= 0) {
+        usage();
+    }
+
+    // Build a tree of a single zone with many names, some of which have
+    // common prefixes in the first label, and others don't.
+    srandom(1);
+    bundy::util::MemorySegmentLocal mem_sgmt;
+    TestDomainTree* tree = TestDomainTree::create(mem_sgmt);
+    const Name origin("example.com");
+    vector<Name> names;
+    for (int i = 0; i < tree_size; ++i) {
+        const Name name = randomName((i % 2) == 0 ? "" : "host", origin);
+        TestDomainTreeNode* node;
+        if (tree->insert(mem_sgmt, name, &node) == TestDomainTree::SUCCESS) {
+            node->setData(&node_data);
+        }
+        if (names.size() < 10000) {
+            names.push_back(name);
+        }
+    }
+    vector<Name> nonexistent_names;
+    for (int i = 0; i < 10000; ++i) {
+        nonexistent_names.push_back(randomName((i % 2) == 0 ? "" : "host",
+                                               origin));
+    }
+
+    std::cout << "Benchmark for finding existing names in a tree of "
+              << tree->getNodeCount() << " nodes" << std::endl;
+    BenchMark<FindBenchMark>(iteration, FindBenchMark(*tree, names));
+
+    std::cout << "Benchmark for finding nonexistent names in a tree of "
+              << tree->getNodeCount() << " nodes" << std::endl;
+    BenchMark<FindBenchMark>(iteration,
+                             FindBenchMark(*tree, nonexistent_names));
+
+    TestDomainTree::destroy(mem_sgmt, tree, deleteData);
+
+    return (0);
+}
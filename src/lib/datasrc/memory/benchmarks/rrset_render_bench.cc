@@ -129,10 +129,11 @@ setRRset(vector<ConstRRsetPtr>* rrsets, ConstRRsetPtr rrset) {
     rrsets->push_back(rrset);
 }
 
+// If wire_image is true, the RdataSets are built with the wire image.
 void
 buildZone(bundy::util::MemorySegmentLocal& mem_sgmt,
           ZoneData* zone_data, const vector<ConstRRsetPtr>& rrsets,
-          vector<ConstRRsetPtr>& rrsets_build)
+          vector<ConstRRsetPtr>& rrsets_build, bool wire_image)
 {
     RdataEncoder encoder;
 
@@ -154,7 +155,8 @@ buildZone(bundy::util::MemorySegmentLocal& mem_sgmt,
             assert(it != rrsets.end()); // to be safe, and silence cppcheck
         }
         RdataSet* rdataset =
-            RdataSet::create(mem_sgmt, encoder, rrset, sig_rrset);
+            RdataSet::create(mem_sgmt, encoder, rrset, sig_rrset, NULL,
+                             wire_image);
         rdataset->next = node->getData();
         node->setData(rdataset);
 
@@ -197,16 +199,24 @@ main(int argc, char* argv[]) {
 
     // Build in-memory zone using RRsets constructed above, storing
     // the same set of RRsets as TreeNodeRRsets in separate vectors.
+    // We build two zones, one of which has the wire images in RdataSets.
     // This code below is not 100% exception safe (for simplicity), but at
     // least it shouldn't leak memory in normal cases.
     bundy::util::MemorySegmentLocal mem_sgmt;
     ZoneData* zone_data = ZoneData::create(mem_sgmt, Name::ROOT_NAME());
     vector<ConstRRsetPtr> delegation_treenode_rrsets;
     buildZone(mem_sgmt, zone_data, delegation_rrsets,
-              delegation_treenode_rrsets);
+              delegation_treenode_rrsets, false);
     vector<ConstRRsetPtr> nxdomain_treenode_rrsets;
     buildZone(mem_sgmt, zone_data, nxdomain_rrsets,
-              nxdomain_treenode_rrsets);
+              nxdomain_treenode_rrsets, false);
+    ZoneData* image_zone_data = ZoneData::create(mem_sgmt, Name::ROOT_NAME());
+    vector<ConstRRsetPtr> delegation_image_rrsets;
+    buildZone(mem_sgmt, image_zone_data, delegation_rrsets,
+              delegation_image_rrsets, true);
+    vector<ConstRRsetPtr> nxdomain_image_rrsets;
+    buildZone(mem_sgmt, image_zone_data, nxdomain_rrsets,
+              nxdomain_image_rrsets, true);
 
     // The benchmark test uses a message renderer.  Create it now and keep
     // using it throughout the test.
@@ -226,6 +236,12 @@ main(int argc, char* argv[]) {
                                     RRsetRenderBenchMark(
                                         delegation_treenode_rrsets, renderer));
 
+    std::cout << "Benchmark for rendering tree node RRsets with wire image "
+              << "(delegation)" << std::endl;
+    BenchMark<RRsetRenderBenchMark>(iteration,
+                                    RRsetRenderBenchMark(
+                                        delegation_image_rrsets, renderer));
+
     std::cout << "Benchmark for rendering basic RRsets (nxdomain)"
               << std::endl;
     BenchMark<RRsetRenderBenchMark>(iteration,
@@ -238,8 +254,15 @@ main(int argc, char* argv[]) {
                                     RRsetRenderBenchMark(
                                         nxdomain_treenode_rrsets, renderer));
 
+    std::cout << "Benchmark for rendering tree node RRsets with wire image "
+              << "(nxdomain)" << std::endl;
+    BenchMark<RRsetRenderBenchMark>(iteration,
+                                    RRsetRenderBenchMark(
+                                        nxdomain_image_rrsets, renderer));
+
     // Cleanup, and memory leak check
     ZoneData::destroy(mem_sgmt, zone_data, RRClass::IN());
+    ZoneData::destroy(mem_sgmt, image_zone_data, RRClass::IN());
     assert(mem_sgmt.allMemoryDeallocated());
 
     return (0);
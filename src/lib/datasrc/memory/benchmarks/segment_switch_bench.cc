@@ -0,0 +1,265 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// A benchmark of switching to a mapped zone table segment, as memmgr makes
+// the readers do after updating a zone.  It measures how long reset() in
+// the read-only mode takes, and how long the first and the second rounds of
+// lookups in the new segment take with each of the options to fault in the
+// segment or give hints on it.  The difference of the two rounds is what
+// the first queries after a switch pay for page faults and TLB misses.
+
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_writer.h>
+#include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/rdataset.h>
+
+#include <log/logger_support.h>
+#include <cc/data.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using namespace bundy::data;
+using namespace bundy::datasrc::memory;
+using namespace bundy::dns;
+
+namespace {
+
+const char* const DEFAULT_MAPPED_FILE = "segment_switch_bench.mapped";
+
+void
+usage() {
+    std::cerr << "Usage: segment_switch_bench [-c] [-f mapped_file] "
+              << "[-n queries] [-s zone_size]" << std::endl;
+    std::cerr << "  -c: evict the mapped file from the page cache before "
+              << "each switch" << std::endl;
+    exit (1);
+}
+
+double
+getTime() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+// Write a zone of the given number of names with an A RRset each, and
+// return (some of) the names for the lookups.
+vector<Name>
+createZoneFile(const string& filename, const Name& origin, int zone_size,
+               int query_count)
+{
+    std::ofstream ofs(filename.c_str(), std::ios::trunc);
+    ofs << origin << " 3600 IN SOA ns.example.com. admin.example.com. "
+        << "1 3600 900 604800 3600" << std::endl;
+    ofs << origin << " 3600 IN NS ns.example.com." << std::endl;
+    vector<Name> names;
+    for (int i = 0; i < zone_size; ++i) {
+        const Name name = Name("host" + boost::lexical_cast<string>(i)).
+            concatenate(origin);
+        ofs << name << " 3600 IN A 192.0.2." << (i % 256) << std::endl;
+        names.push_back(name);
+    }
+    if (!ofs) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        exit(1);
+    }
+
+    // Look up the names in a random order, so the accesses are spread
+    // over the segment as for real queries.
+    srandom(1);
+    for (size_t i = names.size() - 1; i > 0; --i) {
+        std::swap(names[i], names[random() % (i + 1)]);
+    }
+    names.erase(names.begin() + std::min<size_t>(names.size(), query_count),
+                names.end());
+    return (names);
+}
+
+ZoneDataLoader*
+createLoader(bundy::util::MemorySegment& mem_sgmt, const RRClass& rrclass,
+             const Name& origin, const string& zone_file, ZoneData* old_data)
+{
+    return (new ZoneDataLoader(mem_sgmt, rrclass, origin, zone_file,
+                               old_data));
+}
+
+// Evict the pages of the file from the page cache; this works only when
+// the file is not mapped.
+void
+evictFile(const string& filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0 || posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+        std::cerr << "Failed to evict " << filename
+                  << " from the page cache" << std::endl;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// Look up all the names in the zone and return the time it took.  We
+// look up the names in the zone tree and the A RRset at each node, which
+// are the memory accesses of a query; the other processing of a query
+// doesn't depend on the segment.
+double
+lookup(const ZoneTableSegment& segment, const Name& origin,
+       const vector<Name>& names)
+{
+    const double start = getTime();
+    const ZoneTable::FindResult result =
+        segment.getHeader().getTable()->findZone(origin);
+    const ZoneTree& tree = result.zone_data->getZoneTree();
+    vector<Name>::const_iterator it;
+    const vector<Name>::const_iterator it_end = names.end();
+    size_t found = 0;
+    for (it = names.begin(); it != it_end; ++it) {
+        const ZoneNode* node;
+        if (tree.find(*it, &node) == ZoneTree::EXACTMATCH &&
+            RdataSet::find(node->getData(), RRType::A()) != NULL) {
+            ++found;
+        }
+    }
+    if (found != names.size()) {
+        std::cerr << "Only " << found << " of " << names.size()
+                  << " names were found" << std::endl;
+        exit(1);
+    }
+    return (getTime() - start);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    bool evict = false;
+    string mapped_file = DEFAULT_MAPPED_FILE;
+    int query_count = 100000;
+    int zone_size = 1000000;
+    while ((ch = getopt(argc, argv, "cf:n:s:")) != -1) {
+        switch (ch) {
+        case 'c':
+            evict = true;
+            break;
+        case 'f':
+            mapped_file = optarg;
+            break;
+        case 'n':
+            query_count = atoi(optarg);
+            break;
+        case 's':
+            zone_size = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || zone_size <= 0 || query_count <= 0) {
+        usage();
+    }
+
+    bundy::log::initLogger("segment-switch-bench", bundy::log::INFO);
+
+    // Build the segment like memmgr does, from a zone file.
+    const Name origin("example.com");
+    const string zone_file = mapped_file + ".zone";
+    const vector<Name> names = createZoneFile(zone_file, origin, zone_size,
+                                              query_count);
+    ZoneTableSegment* segment =
+        ZoneTableSegment::create(RRClass::IN(), "mapped");
+    const string file_param = "{\"mapped-file\": \"" + mapped_file + "\"";
+    segment->reset(ZoneTableSegment::CREATE,
+                   Element::fromJSON(file_param + "}"));
+    {
+        std::cout << "Loading " << zone_size << " names into "
+                  << mapped_file << std::endl;
+        ZoneWriter writer(*segment,
+                          boost::bind(createLoader, _1, RRClass::IN(),
+                                      origin, zone_file, _2),
+                          origin, RRClass::IN(), false);
+        writer.load();
+        writer.install();
+        writer.cleanup();
+    }
+    segment->clear();
+    unlink(zone_file.c_str());
+    struct stat sb;
+    if (stat(mapped_file.c_str(), &sb) == 0) {
+        std::cout << "The segment is " << sb.st_size << " bytes" << std::endl;
+    }
+
+    const char* const options[] = {
+        "",
+        ", \"will-need\": true",
+        ", \"prefault\": \"populate\"",
+        ", \"prefault\": \"background\"",
+        ", \"huge-pages\": true",
+        ", \"huge-pages\": true, \"prefault\": \"populate\"",
+        NULL
+    };
+    std::cout << "Switching to the segment and looking up " << names.size()
+              << " names (" << (evict ? "cold" : "warm")
+              << " page cache), in seconds" << std::endl;
+    std::cout << std::setw(48) << std::left << "options" << std::right
+              << std::setw(10) << "reset" << std::setw(10) << "first"
+              << std::setw(10) << "second" << std::setw(10) << "total"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(4);
+    for (const char* const* option = options; *option != NULL; ++option) {
+        if (evict) {
+            evictFile(mapped_file);
+        }
+        const ConstElementPtr params =
+            Element::fromJSON(file_param + *option + "}");
+        const double start = getTime();
+        segment->reset(ZoneTableSegment::READ_ONLY, params);
+        const double reset_time = getTime() - start;
+        const double first_time = lookup(*segment, origin, names);
+        const double second_time = lookup(*segment, origin, names);
+        segment->clear();
+
+        std::cout << std::setw(48) << std::left
+                  << (**option == '\0' ? "(none)" : *option + 2)
+                  << std::right << std::setw(10) << reset_time
+                  << std::setw(10) << first_time << std::setw(10)
+                  << second_time << std::setw(10)
+                  << (reset_time + first_time) << std::endl;
+    }
+
+    ZoneTableSegment::destroy(segment);
+    unlink(mapped_file.c_str());
+
+    return (0);
+}
@@ -0,0 +1,252 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// A benchmark of updating a large zone in a mapped zone table segment from
+// a zone file, as memmgr does when a few names of the zone change.  Each
+// update opens the segment for writing, loads the new version of the zone
+// with ZoneWriter and closes the segment, and then the segment is opened
+// read-only as the readers do to switch to it.  It's done both with full
+// loads and with delta loads (see ZoneDataLoader), and reports how long
+// the updates and the switches took and how many bytes of the segment were
+// written (dirtied) per update, as counted in /proc/self/io.
+
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_writer.h>
+#include <datasrc/memory/zone_data_loader.h>
+
+#include <log/logger_support.h>
+#include <cc/data.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <boost/bind.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using std::string;
+using namespace bundy::data;
+using namespace bundy::datasrc::memory;
+using namespace bundy::dns;
+
+namespace {
+
+const char* const DEFAULT_MAPPED_FILE = "segment_update_bench.mapped";
+
+void
+usage() {
+    std::cerr << "Usage: segment_update_bench [-w] [-f mapped_file] "
+              << "[-m changed_names] [-s zone_size] [-u updates]"
+              << std::endl;
+    std::cerr << "  -w: apply the differences in copy-on-write mode"
+              << std::endl;
+    exit (1);
+}
+
+double
+getTime() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+// Return the number of bytes this process has caused to be written to
+// storage so far, including the pages of the mapped file it dirtied, or
+// -1 if it's unknown (e.g., the system doesn't have /proc/self/io).
+int64_t
+getWrittenBytes() {
+    std::ifstream ifs("/proc/self/io");
+    string key;
+    int64_t value;
+    while (ifs >> key >> value) {
+        if (key == "write_bytes:") {
+            return (value);
+        }
+    }
+    return (-1);
+}
+
+// Write the dirty pages of the file back, so the pages dirtied next are
+// counted in /proc/self/io (pages that are still dirty aren't counted again).
+void
+syncFile(const string& filename) {
+    const int fd = open(filename.c_str(), O_RDWR);
+    if (fd < 0 || fsync(fd) != 0) {
+        std::cerr << "Failed to sync " << filename << std::endl;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// Write the given version of a zone of the given number of names with an
+// A RRset each.  Each version changes the address of changed_names names
+// (different ones from the previous version) and increments the serial.
+void
+createZoneFile(const string& filename, const Name& origin, int zone_size,
+               int changed_names, int version)
+{
+    std::ofstream ofs(filename.c_str(), std::ios::trunc);
+    ofs << origin << " 3600 IN SOA ns.example.com. admin.example.com. "
+        << version + 1 << " 3600 900 604800 3600" << std::endl;
+    ofs << origin << " 3600 IN NS ns.example.com." << std::endl;
+    const int changed_begin = (version * changed_names) % zone_size;
+    for (int i = 0; i < zone_size; ++i) {
+        const bool changed =
+            version > 0 && (i - changed_begin + zone_size) % zone_size <
+            changed_names;
+        ofs << "host" << i << "." << origin << " 3600 IN A "
+            << (changed ? "198.51.100." : "192.0.2.")
+            << (changed ? version % 256 : i % 256) << std::endl;
+    }
+    if (!ofs) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        exit(1);
+    }
+}
+
+ZoneDataLoader*
+createLoader(bundy::util::MemorySegment& mem_sgmt, const RRClass& rrclass,
+             const Name& origin, const string& zone_file, bool copy_on_write,
+             bool delta_load, ZoneData* old_data)
+{
+    return (new ZoneDataLoader(mem_sgmt, rrclass, origin, zone_file,
+                               old_data, false, false, 1, copy_on_write,
+                               delta_load));
+}
+
+void
+loadZone(ZoneTableSegment& segment, const Name& origin,
+         const string& zone_file, bool copy_on_write, bool delta_load)
+{
+    ZoneWriter writer(segment,
+                      boost::bind(createLoader, _1, RRClass::IN(), origin,
+                                  zone_file, copy_on_write, delta_load, _2),
+                      origin, RRClass::IN(), false);
+    writer.load();
+    writer.install();
+    writer.cleanup();
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    bool copy_on_write = false;
+    string mapped_file = DEFAULT_MAPPED_FILE;
+    int changed_names = 10;
+    int zone_size = 100000;
+    int update_count = 10;
+    while ((ch = getopt(argc, argv, "wf:m:s:u:")) != -1) {
+        switch (ch) {
+        case 'w':
+            copy_on_write = true;
+            break;
+        case 'f':
+            mapped_file = optarg;
+            break;
+        case 'm':
+            changed_names = atoi(optarg);
+            break;
+        case 's':
+            zone_size = atoi(optarg);
+            break;
+        case 'u':
+            update_count = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || zone_size <= 0 || changed_names <= 0 ||
+        changed_names > zone_size || update_count <= 0) {
+        usage();
+    }
+
+    bundy::log::initLogger("segment-update-bench", bundy::log::WARN);
+
+    const Name origin("example.com");
+    const string zone_file = mapped_file + ".zone";
+    const ConstElementPtr params =
+        Element::fromJSON("{\"mapped-file\": \"" + mapped_file + "\"}");
+    std::cout << "Updating " << changed_names << " of " << zone_size
+              << " names " << update_count << " times"
+              << (copy_on_write ? " (copy-on-write)" : "") << std::endl;
+    std::cout << std::setw(8) << std::left << "load" << std::right
+              << std::setw(14) << "update (s)" << std::setw(14)
+              << "switch (s)" << std::setw(18) << "written (bytes)"
+              << std::endl;
+
+    for (int delta_load = 0; delta_load < 2; ++delta_load) {
+        // Build the first version of the zone.
+        createZoneFile(zone_file, origin, zone_size, changed_names, 0);
+        ZoneTableSegment* segment =
+            ZoneTableSegment::create(RRClass::IN(), "mapped");
+        segment->reset(ZoneTableSegment::CREATE, params);
+        loadZone(*segment, origin, zone_file, copy_on_write, false);
+        segment->clear();
+
+        double update_time = 0, switch_time = 0;
+        int64_t written = 0;
+        for (int version = 1; version <= update_count; ++version) {
+            createZoneFile(zone_file, origin, zone_size, changed_names,
+                           version);
+            syncFile(mapped_file);
+            const int64_t written_before = getWrittenBytes();
+            const double update_start = getTime();
+            segment->reset(ZoneTableSegment::READ_WRITE, params);
+            loadZone(*segment, origin, zone_file, copy_on_write,
+                     delta_load != 0);
+            segment->clear();
+            const double switch_start = getTime();
+            update_time += switch_start - update_start;
+            const int64_t written_after = getWrittenBytes();
+            if (written_before < 0 || written_after < 0) {
+                written = -1;
+            } else if (written >= 0) {
+                written += written_after - written_before;
+            }
+
+            segment->reset(ZoneTableSegment::READ_ONLY, params);
+            switch_time += getTime() - switch_start;
+            segment->clear();
+        }
+        ZoneTableSegment::destroy(segment);
+        unlink(mapped_file.c_str());
+
+        std::cout << std::setw(8) << std::left
+                  << (delta_load ? "delta" : "full") << std::right
+                  << std::fixed << std::setprecision(4) << std::setw(14)
+                  << update_time / update_count << std::setw(14)
+                  << switch_time / update_count << std::setw(18);
+        if (written < 0) {
+            std::cout << "n/a";
+        } else {
+            std::cout << written / update_count;
+        }
+        std::cout << std::endl;
+    }
+    unlink(zone_file.c_str());
+
+    return (0);
+}
@@ -138,6 +138,7 @@ private:
         void* p = mem_sgmt.allocate(sizeof(DomainTreeNode<T>) + labels_len);
         DomainTreeNode<T>* node = new(p) DomainTreeNode<T>(labels_len);
         labels.serialize(node->getLabelsData(), labels_len);
+        buildKey(labels, node->key_);
         return (node);
     }
 
@@ -165,8 +166,31 @@ private:
     /// otherwise the serialize() method will throw an exception.
     void resetLabels(const dns::LabelSequence& labels) {
         labels.serialize(getLabelsData(), labels_capacity_);
+        buildKey(labels, key_);
     }
 
+    /// \brief The size of the inline key of a node (see \c key_).
+    static const size_t KEY_LENGTH = 4;
+
+    /// \brief Build the inline key for a label sequence.
+    ///
+    /// The key consists of the length of the rightmost label of
+    /// \c labels, followed by its first (at most) \c KEY_LENGTH - 1
+    /// characters converted to lower case.  Unused bytes are set to 0.
+    static void buildKey(const dns::LabelSequence& labels,
+                         uint8_t key[KEY_LENGTH]);
+
+    /// \brief Compare a label sequence with the labels of this node.
+    ///
+    /// This returns the same result as
+    /// <code>labels.compare(getLabels())</code>, but most of the time
+    /// it can be decided from \c key (which must be the key of \c labels
+    /// built by \c buildKey()) and the inline key of this node without
+    /// touching the label data.
+    dns::NameComparisonResult compareLabels(
+        const dns::LabelSequence& labels,
+        const uint8_t key[KEY_LENGTH]) const;
+
 public:
     /// Node flags.
     ///
@@ -184,6 +208,7 @@ public:
         FLAG_USER1 = 0x400000U, ///< Application specific flag
         FLAG_USER2 = 0x200000U, ///< Application specific flag
         FLAG_USER3 = 0x100000U, ///< Application specific flag
+        FLAG_USER4 = 0x080000U, ///< Application specific flag
         FLAG_MAX = 0x400000U    // for integrity check
     };
 private:
@@ -193,7 +218,8 @@ private:
     // explicitly defined in \c Flags.  This constant represents all
     // such flags.
     static const uint32_t SETTABLE_FLAGS = (FLAG_CALLBACK | FLAG_USER1 |
-                                            FLAG_USER2 | FLAG_USER3);
+                                            FLAG_USER2 | FLAG_USER3 |
+                                            FLAG_USER4);
 
 public:
 
@@ -747,6 +773,18 @@ private:
     // So we can change this implementation without affecting its users if
     // a future change to LabelSequence breaks this assumption.
     BOOST_STATIC_ASSERT((1 << 9) > dns::LabelSequence::MAX_SERIALIZED_LENGTH);
+
+    /// \brief The inline key of the node's labels.
+    ///
+    /// This is a short summary of the rightmost label of the node (see
+    /// \c buildKey()).  In each level of the tree except the top one, the
+    /// rightmost labels of the nodes are the labels that distinguish them,
+    /// so a search can usually choose the left or right branch by comparing
+    /// the keys only, without decoding the label data that follows the
+    /// node (which is often in another cache line).  On 64-bit systems it
+    /// fits in what would otherwise be padding after the flags, so it
+    /// doesn't increase the size of the node.
+    uint8_t key_[KEY_LENGTH];
 };
 
 template <typename T>
@@ -765,6 +803,59 @@ template <typename T>
 DomainTreeNode<T>::~DomainTreeNode() {
 }
 
+template <typename T>
+void
+DomainTreeNode<T>::buildKey(const dns::LabelSequence& labels,
+                            uint8_t key[KEY_LENGTH])
+{
+    // Skip to the rightmost label.
+    size_t data_len;
+    const uint8_t* data = labels.getData(&data_len);
+    for (size_t i = labels.getLabelCount(); i > 1; --i) {
+        data += *data + 1;
+    }
+
+    const size_t label_len = *data;
+    key[0] = label_len;
+    for (size_t i = 1; i < KEY_LENGTH; ++i) {
+        if (i <= label_len) {
+            const uint8_t c = data[i];
+            key[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        } else {
+            key[i] = 0;
+        }
+    }
+}
+
+template <typename T>
+dns::NameComparisonResult
+DomainTreeNode<T>::compareLabels(const dns::LabelSequence& labels,
+                                 const uint8_t key[KEY_LENGTH]) const
+{
+    // LabelSequence::compare() starts with comparing the rightmost labels
+    // character by character, and then by their lengths.  If they differ
+    // within the part covered by the keys, the result is a NONE relation
+    // ordered by the first difference.
+    const size_t len1 = key[0];
+    const size_t len2 = key_[0];
+    const size_t len = std::min(std::min(len1, len2), KEY_LENGTH - 1);
+    for (size_t i = 1; i <= len; ++i) {
+        if (key[i] != key_[i]) {
+            return (dns::NameComparisonResult(
+                        static_cast<int>(key[i]) - static_cast<int>(key_[i]),
+                        0, dns::NameComparisonResult::NONE));
+        }
+    }
+    if (len1 != len2 && std::min(len1, len2) < KEY_LENGTH) {
+        return (dns::NameComparisonResult(
+                    static_cast<int>(len1) - static_cast<int>(len2),
+                    0, dns::NameComparisonResult::NONE));
+    }
+
+    // Otherwise we need to look into the labels.
+    return (labels.compare(getLabels()));
+}
+
 template <typename T>
 template <typename TT>
 TT*
@@ -1855,10 +1946,13 @@ DomainTree<T>::findImpl(TT* tree,
 
     Result ret = NOTFOUND;
     dns::LabelSequence target_labels(target_labels_orig);
+    uint8_t target_key[DomainTreeNode<T>::KEY_LENGTH];
+    DomainTreeNode<T>::buildKey(target_labels, target_key);
 
     while (node != NULL) {
         node_path.last_compared_ = node;
-        node_path.last_comparison_ = target_labels.compare(node->getLabels());
+        node_path.last_comparison_ = node->compareLabels(target_labels,
+                                                         target_key);
         const bundy::dns::NameComparisonResult::NameRelation relation =
             node_path.last_comparison_.getRelation();
 
@@ -1889,6 +1983,7 @@ DomainTree<T>::findImpl(TT* tree,
                 node_path.push(node);
                 target_labels.stripRight(
                     node_path.last_comparison_.getCommonLabels());
+                DomainTreeNode<T>::buildKey(target_labels, target_key);
                 node = node->getDown();
             } else {
                 break;
@@ -2170,16 +2265,13 @@ DomainTree<T>::insert(util::MemorySegment& mem_sgmt,
     DomainTreeNode<T>* current = root_.get();
     DomainTreeNode<T>* up_node = NULL;
     bundy::dns::LabelSequence target_labels(target_name);
+    uint8_t target_key[DomainTreeNode<T>::KEY_LENGTH];
+    DomainTreeNode<T>::buildKey(target_labels, target_key);
 
     int order = -1;
-    // For possible LabelSequence serialization we always store labels data
-    // in the separate local buffer.
-    uint8_t labels_buf[dns::LabelSequence::MAX_SERIALIZED_LENGTH];
     while (current != NULL) {
-        const dns::LabelSequence current_labels(
-            dns::LabelSequence(current->getLabels(), labels_buf));
         const bundy::dns::NameComparisonResult compare_result =
-            target_labels.compare(current_labels);
+            current->compareLabels(target_labels, target_key);
         const bundy::dns::NameComparisonResult::NameRelation relation =
             compare_result.getRelation();
         if (relation == bundy::dns::NameComparisonResult::EQUAL) {
@@ -2196,12 +2288,17 @@ DomainTree<T>::insert(util::MemorySegment& mem_sgmt,
             parent = NULL;
             up_node = current;
             target_labels.stripRight(compare_result.getCommonLabels());
+            DomainTreeNode<T>::buildKey(target_labels, target_key);
             current = current->getDown();
         } else {
             // The number of labels in common is fewer than the number of
             // labels at the current node, so the current node must be
             // adjusted to have just the common suffix, and a down pointer
-            // made to a new tree.
+            // made to a new tree.  As the labels of the current node will
+            // be overridden, we copy them to a separate local buffer.
+            uint8_t labels_buf[dns::LabelSequence::MAX_SERIALIZED_LENGTH];
+            const dns::LabelSequence current_labels(current->getLabels(),
+                                                    labels_buf);
             dns::LabelSequence common_ancestor = target_labels;
             common_ancestor.stripLeft(target_labels.getLabelCount() -
                                       compare_result.getCommonLabels());
@@ -37,6 +37,12 @@ class ZoneDataLoader;
 ///
 /// All data should be allocated from the passed MemorySegment. The ownership
 /// is passed onto the caller.
+///
+/// \c ZoneTableLoader in its parallel mode calls these factories (and uses
+/// the created loaders) in multiple threads at the same time, each time
+/// with a different segment, so a factory given to it must be thread safe,
+/// as well as anything it uses, such as the data source client the zone
+/// data are loaded from.
 typedef boost::function<ZoneDataLoader*(util::MemorySegment& mem_sgmt,
                                         ZoneData* zone_data)>
 ZoneDataLoaderCreator;
@@ -20,6 +20,7 @@
 #include <datasrc/memory/rdataset.h>
 #include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/memory/zone_finder.h>
+#include <datasrc/memory/nsec3_hash_cache.h>
 #include <datasrc/memory/zone_table_segment.h>
 
 #include <datasrc/exceptions.h>
@@ -48,7 +49,8 @@ InMemoryClient::InMemoryClient(const std::string& datasrc_name,
                                RRClass rrclass) :
     DataSourceClient(datasrc_name),
     ztable_segment_(ztable_segment),
-    rrclass_(rrclass)
+    rrclass_(rrclass),
+    nsec3_caches_(new NSEC3HashCacheTable)
 {}
 
 RRClass
@@ -72,7 +74,8 @@ InMemoryClient::findZone(const bundy::dns::Name& zone_name) const {
 
     ZoneFinderPtr finder;
     if (result.code != result::NOTFOUND && result.zone_data) {
-        finder.reset(new InMemoryZoneFinder(*result.zone_data, getClass()));
+        finder.reset(new InMemoryZoneFinder(*result.zone_data, getClass(),
+                                            nsec3_caches_.get()));
     }
 
     return (DataSourceClient::FindResult(result.code, finder,
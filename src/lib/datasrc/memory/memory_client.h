@@ -37,6 +37,7 @@ namespace datasrc {
 namespace memory {
 
 class ZoneTableSegment;
+class NSEC3HashCacheTable;
 
 /// \brief A data source client that holds all necessary data in memory.
 ///
@@ -118,6 +119,8 @@ public:
 private:
     boost::shared_ptr<ZoneTableSegment> ztable_segment_;
     const bundy::dns::RRClass rrclass_;
+    // The NSEC3 hash caches shared by the zone finders.
+    const boost::shared_ptr<NSEC3HashCacheTable> nsec3_caches_;
 };
 
 } // namespace memory
@@ -0,0 +1,176 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/nsec3_hash_cache.h>
+#include <datasrc/memory/zone_data.h>
+
+#include <dns/name_internal.h>
+#include <dns/nsec3hash.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <cstring>
+
+using namespace std;
+using namespace bundy::dns;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+const size_t NSEC3HashCache::DEFAULT_CAPACITY;
+const size_t NSEC3HashCacheTable::DEFAULT_CAPACITY;
+
+namespace {
+// Return the name data of the label sequence in lower case, which is
+// used as the key for the name.  The length octets are never changed by
+// maptolower, so they don't have to be distinguished from the labels.
+string
+getKey(const LabelSequence& name) {
+    size_t length;
+    const uint8_t* data = name.getData(&length);
+    string key(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        key[i] = name::internal::maptolower[data[i]];
+    }
+    return (key);
+}
+}
+
+NSEC3HashCache::NSEC3HashCache(const NSEC3Data& nsec3_data,
+                               size_t capacity) :
+    algorithm_(nsec3_data.hashalg), iterations_(nsec3_data.iterations),
+    salt_(nsec3_data.getSaltData(),
+          nsec3_data.getSaltData() + nsec3_data.getSaltLen()),
+    capacity_(capacity)
+{}
+
+bool
+NSEC3HashCache::match(const NSEC3Data& nsec3_data) const {
+    return (algorithm_ == nsec3_data.hashalg &&
+            iterations_ == nsec3_data.iterations &&
+            salt_.size() == nsec3_data.getSaltLen() &&
+            (salt_.empty() ||
+             memcmp(&salt_[0], nsec3_data.getSaltData(), salt_.size()) == 0));
+}
+
+void
+NSEC3HashCache::calculate(const vector<LabelSequence>& names,
+                          vector<string>& hashes)
+{
+    hashes.assign(names.size(), string());
+
+    vector<string> keys(names.size());
+    vector<LabelSequence> uncached_names;
+    vector<size_t> uncached_indices;
+    {
+        const Mutex::Locker locker(mutex_);
+        for (size_t i = 0; i < names.size(); ++i) {
+            keys[i] = getKey(names[i]);
+            const EntryMap::iterator found = entry_map_.find(keys[i]);
+            if (found != entry_map_.end()) {
+                // Make it the most recently used one.
+                entries_.splice(entries_.begin(), entries_, found->second);
+                hashes[i] = found->second->hash;
+            } else {
+                uncached_names.push_back(names[i]);
+                uncached_indices.push_back(i);
+            }
+        }
+    }
+    if (uncached_names.empty()) {
+        return;
+    }
+
+    // Calculate the uncached ones without the lock.  NSEC3Hash is not
+    // thread safe, so an instance is created for each call (the cost is
+    // negligible compared to the calculation).
+    vector<string> uncached_hashes;
+    const boost::scoped_ptr<NSEC3Hash> hash(
+        NSEC3Hash::create(algorithm_, iterations_,
+                          salt_.empty() ? NULL : &salt_[0], salt_.size()));
+    hash->calculateBatch(uncached_names, uncached_hashes);
+
+    const Mutex::Locker locker(mutex_);
+    for (size_t i = 0; i < uncached_indices.size(); ++i) {
+        const size_t index = uncached_indices[i];
+        hashes[index] = uncached_hashes[i];
+        if (capacity_ == 0 ||
+            entry_map_.find(keys[index]) != entry_map_.end()) {
+            // The same name may be given more than once, or may have been
+            // added by another thread.
+            continue;
+        }
+        if (entries_.size() >= capacity_) {
+            entry_map_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+        entries_.push_front(Entry(keys[index], uncached_hashes[i]));
+        entry_map_[keys[index]] = entries_.begin();
+    }
+}
+
+size_t
+NSEC3HashCache::getSize() const {
+    const Mutex::Locker locker(mutex_);
+    return (entries_.size());
+}
+
+NSEC3HashCacheTable::NSEC3HashCacheTable(size_t capacity) :
+    capacity_(capacity)
+{}
+
+boost::shared_ptr<NSEC3HashCache>
+NSEC3HashCacheTable::getCache(const LabelSequence& origin,
+                              const NSEC3Data& nsec3_data)
+{
+    if (capacity_ == 0) {
+        return (boost::shared_ptr<NSEC3HashCache>(
+                    new NSEC3HashCache(nsec3_data)));
+    }
+
+    const string key = getKey(origin);
+    const Mutex::Locker locker(mutex_);
+    const CacheMap::iterator found = cache_map_.find(key);
+    if (found != cache_map_.end()) {
+        // Make it the most recently used one.
+        caches_.splice(caches_.begin(), caches_, found->second);
+        boost::shared_ptr<NSEC3HashCache>& cache = found->second->second;
+        if (!cache->match(nsec3_data)) {
+            cache.reset(new NSEC3HashCache(nsec3_data));
+        }
+        return (cache);
+    }
+
+    const boost::shared_ptr<NSEC3HashCache> cache(
+        new NSEC3HashCache(nsec3_data));
+    if (caches_.size() >= capacity_) {
+        cache_map_.erase(caches_.back().first);
+        caches_.pop_back();
+    }
+    caches_.push_front(CacheEntry(key, cache));
+    cache_map_[key] = caches_.begin();
+    return (cache);
+}
+
+size_t
+NSEC3HashCacheTable::getSize() const {
+    const Mutex::Locker locker(mutex_);
+    return (caches_.size());
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,165 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_NSEC3_HASH_CACHE_H
+#define DATASRC_MEMORY_NSEC3_HASH_CACHE_H 1
+
+#include <dns/labelsequence.h>
+
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+class NSEC3Data;
+
+/// \brief A small LRU cache of the NSEC3 hash values of a zone.
+///
+/// Answering negative queries in an NSEC3-signed zone requires the NSEC3
+/// hashes of the query name and its ancestors, which can be very expensive
+/// with many hash iterations.  As the same names (the closest enclosers in
+/// particular) tend to be queried again and again, this class remembers the
+/// hash values of the most recently used names, up to a fixed number.
+/// The hash values of uncached names are calculated together by
+/// \c bundy::dns::NSEC3Hash::calculateBatch().
+///
+/// Since the hash value only depends on the name and the NSEC3 parameters,
+/// the cache is valid as long as the parameters of the zone are the same,
+/// which can be checked with \c match().
+///
+/// This class is thread safe.
+class NSEC3HashCache : boost::noncopyable {
+public:
+    /// \brief The default maximum number of cached hash values.
+    static const size_t DEFAULT_CAPACITY = 256;
+
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc Internal resource allocation failure.
+    ///
+    /// \param nsec3_data The NSEC3 parameters of the zone.
+    /// \param capacity The maximum number of cached hash values.
+    explicit NSEC3HashCache(const NSEC3Data& nsec3_data,
+                            size_t capacity = DEFAULT_CAPACITY);
+
+    /// \brief Return whether the cache is for the given NSEC3 parameters.
+    ///
+    /// \throw None
+    bool match(const NSEC3Data& nsec3_data) const;
+
+    /// \brief Return the NSEC3 hash values of the given names.
+    ///
+    /// This is equivalent to \c bundy::dns::NSEC3Hash::calculateBatch().
+    /// The names are added to the cache (as the most recently used ones),
+    /// possibly removing the least recently used ones.
+    ///
+    /// \throw bundy::dns::UnknownNSEC3HashAlgorithm The hash algorithm is
+    /// unknown.
+    /// \throw std::bad_alloc Internal resource allocation failure.
+    void calculate(const std::vector<dns::LabelSequence>& names,
+                   std::vector<std::string>& hashes);
+
+    /// \brief Return the number of cached hash values.
+    size_t getSize() const;
+
+private:
+    struct Entry {
+        Entry(const std::string& key_param, const std::string& hash_param) :
+            key(key_param), hash(hash_param)
+        {}
+        std::string key;        // the name data in lower case
+        std::string hash;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::map<std::string, EntryList::iterator> EntryMap;
+
+    const uint8_t algorithm_;
+    const uint16_t iterations_;
+    const std::vector<uint8_t> salt_;
+    const size_t capacity_;
+    EntryList entries_;         // the most recently used one first
+    EntryMap entry_map_;
+    mutable util::thread::Mutex mutex_;
+};
+
+/// \brief The NSEC3 hash caches of the zones of a data source client.
+///
+/// This class keeps an \c NSEC3HashCache for each NSEC3-signed zone of an
+/// \c InMemoryClient (that has been queried for NSEC3), so they can be
+/// shared by the zone finders created by the client.  It doesn't track
+/// the changes of the zones; the cache of a zone is recreated when its
+/// NSEC3 parameters are found to be changed.
+///
+/// As zones can be added and removed while the client is used, the
+/// number of caches is limited in the same way as the hash values in a
+/// cache: the cache of the least recently queried zone is removed to make
+/// room for a new one.  A removed cache remains valid for the finders
+/// still using it.
+///
+/// This class is thread safe.
+class NSEC3HashCacheTable : boost::noncopyable {
+public:
+    /// \brief The default maximum number of cached zones.
+    static const size_t DEFAULT_CAPACITY = 256;
+
+    /// \brief Constructor.
+    ///
+    /// \throw None
+    ///
+    /// \param capacity The maximum number of zones having a cache.
+    explicit NSEC3HashCacheTable(size_t capacity = DEFAULT_CAPACITY);
+
+    /// \brief Return the cache for the zone of the given origin and NSEC3
+    /// parameters.
+    ///
+    /// The zone becomes the most recently used one.  If the capacity is 0,
+    /// a new (unshared) cache is returned for each call.
+    ///
+    /// \throw std::bad_alloc Internal resource allocation failure.
+    boost::shared_ptr<NSEC3HashCache>
+    getCache(const dns::LabelSequence& origin, const NSEC3Data& nsec3_data);
+
+    /// \brief Return the number of zones having a cache.
+    size_t getSize() const;
+
+private:
+    typedef std::pair<std::string, boost::shared_ptr<NSEC3HashCache> >
+    CacheEntry;
+    typedef std::list<CacheEntry> CacheList;
+    typedef std::map<std::string, CacheList::iterator> CacheMap;
+
+    const size_t capacity_;
+    CacheList caches_;          // the most recently used one first
+    CacheMap cache_map_;
+    mutable util::thread::Mutex mutex_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_NSEC3_HASH_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -29,8 +29,10 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <new>                  // for the placement new
+#include <vector>
 
 using namespace bundy::dns;
 using namespace bundy::dns::rdata;
@@ -117,29 +119,145 @@ sanityChecks(const ConstRRsetPtr& rrset, const ConstRRsetPtr &sig_rrset,
 
 } // Anonymous namespace
 
+namespace {
+// Callbacks for RdataReader to build the wire image of an RdataSet (see the
+// RdataSet class description for the format).
+
+void
+checkImageName(const LabelSequence&, RdataNameAttributes, bool* has_names) {
+    *has_names = true;
+}
+
+void
+writeImageName(const LabelSequence& name, RdataNameAttributes attr,
+               util::OutputBuffer* buffer)
+{
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    name.serialize(labels_buf, sizeof(labels_buf));
+    buffer->writeUint16(RdataSet::WIRE_IMAGE_NAME | attr);
+    buffer->writeData(labels_buf, name.getSerializedLength());
+}
+
+void
+writeImageData(const void* data, size_t len, const bool* tagged,
+               util::OutputBuffer* buffer)
+{
+    if (!*tagged) {
+        buffer->writeData(data, len);
+        return;
+    }
+    // The length of a data field must not have the WIRE_IMAGE_NAME bit,
+    // so we split (very unlikely) large data.
+    const uint8_t* cp = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        const size_t field_len =
+            std::min(len, static_cast<size_t>(RdataSet::WIRE_IMAGE_NAME - 1));
+        buffer->writeUint16(field_len);
+        buffer->writeData(cp, field_len);
+        cp += field_len;
+        len -= field_len;
+    }
+}
+
+// Append the wire image entries of the given number of RDATAs or RRSIGs
+// to the buffer.
+void
+writeImageEntries(util::OutputBuffer& buffer, size_t count,
+                  RdataReader& reader, bool (RdataReader::* iterate_fn)())
+{
+    for (size_t i = 0; i < count; ++i) {
+        const size_t pos = buffer.getLength();
+        buffer.skip(sizeof(uint16_t));
+        const bool rendered = (reader.*iterate_fn)();
+        assert(rendered == true);
+        const size_t entry_len = buffer.getLength() - pos - sizeof(uint16_t);
+        if (entry_len > 0xffff) {
+            // This can only happen for a name-bearing RDATA that's nearly
+            // 64KB long, due to the overhead of the tags.
+            bundy_throw(RdataSetError, "Too large RDATA for wire image: "
+                        << entry_len);
+        }
+        buffer.writeUint16At(entry_len, pos);
+    }
+}
+
+// Build the wire image from the encoded data, and return whether the RDATA
+// entries contain names.
+bool
+buildWireImage(const void* data, size_t rdata_count, size_t rrsig_count,
+               const RRClass& rrclass, const RRType& rrtype,
+               util::OutputBuffer& buffer)
+{
+    bool has_names = false;
+    RdataReader(rrclass, rrtype, data, rdata_count, rrsig_count,
+                boost::bind(checkImageName, _1, _2, &has_names),
+                &RdataReader::emptyDataAction).iterate();
+
+    bool tagged = has_names;
+    RdataReader reader(rrclass, rrtype, data, rdata_count, rrsig_count,
+                       boost::bind(writeImageName, _1, _2, &buffer),
+                       boost::bind(writeImageData, _1, _2, &tagged, &buffer));
+    writeImageEntries(buffer, rdata_count, reader,
+                      &RdataReader::iterateRdata);
+    tagged = false;             // RRSIG entries are always in the plain form
+    writeImageEntries(buffer, rrsig_count, reader,
+                      &RdataReader::iterateSingleSig);
+    return (has_names);
+}
+}
+
 RdataSet*
 RdataSet::packSet(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
-                  size_t rdata_count, size_t rrsig_count, const RRType& rrtype,
-                  const RRTTL& rrttl)
+                  size_t rdata_count, size_t rrsig_count,
+                  const RRClass& rrclass, const RRType& rrtype,
+                  const RRTTL& rrttl, bool wire_image)
 {
-    const size_t ext_rrsig_count_len =
-        rrsig_count >= MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
     const size_t data_len = encoder.getStorageLength();
-    void* p = mem_sgmt.allocate(sizeof(RdataSet) + ext_rrsig_count_len +
-                                data_len);
+
+    // If we build the wire image, encode the data into a temporary buffer
+    // first, as we need to know the size of the image before allocating
+    // the RdataSet.  (The buffer consists of uint16_t to meet the alignment
+    // requirement of the encoder.)
+    std::vector<uint16_t> data_buf;
+    util::OutputBuffer image(0);
+    bool has_names = false;
+    if (wire_image) {
+        data_buf.resize(data_len / sizeof(uint16_t) + 1);
+        encoder.encode(&data_buf[0], data_len);
+        has_names = buildWireImage(&data_buf[0], rdata_count, rrsig_count,
+                                   rrclass, rrtype, image);
+    }
+
+    const bool ext_header = wire_image || rrsig_count >= MANY_RRSIG_COUNT;
+    const size_t ext_header_len = ext_header ? sizeof(ExtHeader) : 0;
+    void* p = mem_sgmt.allocate(sizeof(RdataSet) + ext_header_len +
+                                data_len + image.getLength());
     RdataSet* rdataset = new(p) RdataSet(rrtype, rdata_count, rrsig_count,
-                                         rrttl);
-    if (rrsig_count >= RdataSet::MANY_RRSIG_COUNT) {
-        *rdataset->getExtSIGCountBuf() = rrsig_count;
+                                         rrttl, ext_header);
+    if (ext_header) {
+        ExtHeader* header = rdataset->getExtHeader();
+        header->data_len = data_len;
+        header->image_len = image.getLength();
+        header->sig_count = rrsig_count;
+        header->flags = 0;
+        if (has_names) {
+            header->flags |= WIRE_IMAGE_HAS_NAMES;
+        }
+    }
+    if (wire_image) {
+        uint8_t* dp = static_cast<uint8_t*>(rdataset->getDataBuf());
+        std::memcpy(dp, &data_buf[0], data_len);
+        std::memcpy(dp + data_len, image.getData(), image.getLength());
+    } else {
+        encoder.encode(rdataset->getDataBuf(), data_len);
     }
-    encoder.encode(rdataset->getDataBuf(), data_len);
     return (rdataset);
 }
 
 RdataSet*
 RdataSet::create(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                  ConstRRsetPtr rrset, ConstRRsetPtr sig_rrset,
-                 const RdataSet* old_rdataset)
+                 const RdataSet* old_rdataset, bool wire_image)
 {
     const std::pair<RRClass, RRType>& rrparams =
         sanityChecks(rrset, sig_rrset, old_rdataset);
@@ -193,8 +311,8 @@ RdataSet::create(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                   << MAX_RRSIG_COUNT);
     }
 
-    return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrtype,
-                    rrttl));
+    return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrclass,
+                    rrtype, rrttl, wire_image));
 }
 
 namespace {
@@ -249,7 +367,7 @@ RdataSet*
 RdataSet::subtract(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                    const dns::ConstRRsetPtr& rrset,
                    const dns::ConstRRsetPtr& sig_rrset,
-                   const RdataSet& old_rdataset)
+                   const RdataSet& old_rdataset, bool wire_image)
 {
     const std::pair<RRClass, RRType>& rrparams =
         sanityChecks(rrset, sig_rrset, &old_rdataset);
@@ -284,25 +402,63 @@ RdataSet::subtract(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
     if (rdata_count == 0 && rrsig_count == 0) {
         return (NULL); // It is left empty
     }
-    return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrtype,
-                    restoreTTL(old_rdataset.getTTLData())));
+    return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrclass,
+                    rrtype, restoreTTL(old_rdataset.getTTLData()),
+                    wire_image));
+}
+
+RdataSet*
+RdataSet::copy(util::MemorySegment& mem_sgmt, const RdataSet& source,
+               RRClass rrclass)
+{
+    const size_t len = source.getAllocatedSize(rrclass);
+    void* p = mem_sgmt.allocate(len);
+    const bool ext_header = (source.sig_rdata_count_ == MANY_RRSIG_COUNT);
+    RdataSet* rdataset = new(p) RdataSet(source.type, source.rdata_count_,
+                                         source.sig_rdata_count_,
+                                         restoreTTL(source.getTTLData()),
+                                         ext_header);
+    // Everything following the fixed part (the extended header if any,
+    // the encoded data and the wire image) is position independent.
+    std::memcpy(rdataset + 1, &source + 1, len - sizeof(RdataSet));
+    return (rdataset);
+}
+
+bool
+RdataSet::hasSameData(const RdataSet& other, RRClass rrclass) const {
+    if (type != other.type || rdata_count_ != other.rdata_count_ ||
+        sig_rdata_count_ != other.sig_rdata_count_ || ttl_ != other.ttl_) {
+        return (false);
+    }
+    // As noted in copy(), the data following the fixed part don't depend
+    // on the position, so they are the same iff they are equal bytes.
+    const size_t len = getAllocatedSize(rrclass);
+    return (len == other.getAllocatedSize(rrclass) &&
+            std::memcmp(this + 1, &other + 1, len - sizeof(RdataSet)) == 0);
 }
 
 void
 RdataSet::destroy(util::MemorySegment& mem_sgmt, RdataSet* rdataset,
                   RRClass rrclass)
 {
-    const size_t data_len =
-        RdataReader(rrclass, rdataset->type,
-                    reinterpret_cast<const uint8_t*>(rdataset->getDataBuf()),
-                    rdataset->getRdataCount(), rdataset->getSigRdataCount(),
-                    &RdataReader::emptyNameAction,
-                    &RdataReader::emptyDataAction).getSize();
-    const size_t ext_rrsig_count_len =
-        rdataset->sig_rdata_count_ == MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
+    const size_t len = rdataset->getAllocatedSize(rrclass);
     rdataset->~RdataSet();
-    mem_sgmt.deallocate(rdataset,
-                        sizeof(RdataSet) + ext_rrsig_count_len + data_len);
+    mem_sgmt.deallocate(rdataset, len);
+}
+
+size_t
+RdataSet::getAllocatedSize(RRClass rrclass) const {
+    size_t len = sizeof(RdataSet);
+    if (sig_rdata_count_ == MANY_RRSIG_COUNT) {
+        const ExtHeader* header = getExtHeader();
+        len += sizeof(ExtHeader) + header->data_len + header->image_len;
+    } else {
+        len += RdataReader(rrclass, type, getDataBuf(), getRdataCount(),
+                           getSigRdataCount(),
+                           &RdataReader::emptyNameAction,
+                           &RdataReader::emptyDataAction).getSize();
+    }
+    return (len);
 }
 
 namespace {
@@ -324,10 +480,9 @@ convertTTL(RRTTL ttl) {
 }
 
 RdataSet::RdataSet(RRType type_param, size_t rdata_count,
-                   size_t sig_rdata_count, RRTTL ttl) :
+                   size_t sig_rdata_count, RRTTL ttl, bool ext_header) :
     type(type_param),
-    sig_rdata_count_(sig_rdata_count >= MANY_RRSIG_COUNT ?
-                     MANY_RRSIG_COUNT : sig_rdata_count),
+    sig_rdata_count_(ext_header ? MANY_RRSIG_COUNT : sig_rdata_count),
     rdata_count_(rdata_count), ttl_(convertTTL(ttl))
 {
     // Make sure an RRType object is essentially a plain 16-bit value, so
@@ -338,6 +493,11 @@ RdataSet::RdataSet(RRType type_param, size_t rdata_count,
     // Confirm we meet the alignment requirement for RdataEncoder
     // ("this + 1" should be safely passed to the encoder).
     BOOST_STATIC_ASSERT(sizeof(RdataSet) % sizeof(uint16_t) == 0);
+
+    // Likewise, "this + 1" must be suitably aligned for the extended header,
+    // and the encoded data following it.
+    BOOST_STATIC_ASSERT(sizeof(RdataSet) % sizeof(uint32_t) == 0);
+    BOOST_STATIC_ASSERT(sizeof(ExtHeader) % sizeof(uint16_t) == 0);
 }
 
 } // namespace memory
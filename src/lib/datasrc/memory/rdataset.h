@@ -80,10 +80,33 @@ public:
 /// RDATAs so it will fit in a 13-bit integer, we can use 3 more bits in a
 /// 2-byte integer for other purposes.  We use this additional field to
 /// represent the number of RRSIGs up to 6, while using the value of 7 to mean
-/// there are more than 6 RRSIGs.  In the vast majority of real world
-/// deployment, an RRset should normally have only a few RRSIGs, and 6 should
-/// normally be more than sufficient.  So we can cover most practical cases
-/// regarding the number of records with this 2-byte field.
+/// there are more than 6 RRSIGs (or the \c RdataSet has a wire image, see
+/// below), in which case an extended header follows the object.  In the
+/// vast majority of real world deployment, an RRset should normally have
+/// only a few RRSIGs, and 6 should normally be more than sufficient.  So we
+/// can cover most practical cases regarding the number of records with this
+/// 2-byte field.
+///
+/// Optionally, an \c RdataSet can also hold a "wire image" of its RDATAs
+/// and RRSIGs, i.e., a pre-rendered form of them as they'd appear in a DNS
+/// message (see \c create()).  Rendering an RRset from the wire image is
+/// mostly a matter of copying memory, instead of decoding the data with
+/// \c RdataReader for every response.  The wire image consists of one entry
+/// for each RDATA, followed by one for each RRSIG, and each entry begins
+/// with a 16-bit length field (in the network byte order) for the rest of
+/// the entry.  If none of the RDATAs contains a domain name (which is always
+/// the case for RRSIGs), the entry is simply the RDLENGTH and RDATA fields of
+/// the RR in the wire format, and can be copied to a message as it is.
+/// Otherwise (\c hasWireImageNames() returns true), the rest of each
+/// RDATA entry is a sequence of fields, each of which begins with a 16-bit
+/// tag (in the network byte order).  If the \c WIRE_IMAGE_NAME bit of the
+/// tag is set, the field is a domain name: the lower bits of the tag are
+/// its \c RdataNameAttributes, and it's followed by the serialized
+/// \c LabelSequence of the name.  Otherwise the tag is the length of the
+/// opaque data that follows it.  So only the names need to be passed to the
+/// renderer one by one, to handle the name compression.  Like the rest of
+/// the data, the wire image only consists of offset-independent data, so it
+/// can also be used in a memory segment mapped at a different address.
 ///
 /// A set of objects of this class (which would be \c RdataSets of various
 /// types of the same owner name) will often be maintained in a single linked
@@ -104,8 +127,11 @@ public:
 /// \c RdataSet object.  The memory layout would be as follows:
 /// \verbatim
 /// RdataSet object
-/// (optional) uint16_t: number of RRSIGs, if it's larger than 6 (see above)
-/// encoded RDATA (generated by RdataEncoder) \endverbatim
+/// (optional) extended header, if there are more than 6 RRSIGs or the wire
+///            image (see above); it contains the number of RRSIGs and
+///            the lengths of the following two fields
+/// encoded RDATA (generated by RdataEncoder)
+/// (optional) wire image \endverbatim
 ///
 /// This is shown here only for reference purposes.  The application must not
 /// assume any particular format of data in this region directly; it must
@@ -175,6 +201,8 @@ public:
     /// 8191 RDATAs (after unifying duplicates) for the non RRISG RRset; also,
     /// it cannot contain more than 65535 RRSIGs.  If the given RRset(s) fail
     /// to meet this condition, an \c RdataSetError exception will be thrown.
+    /// It's also thrown if the wire image is requested and an RDATA
+    /// containing domain names is too large (nearly 64KB) for it.
     ///
     /// This method ensures there'll be no memory leak on exception.
     /// But addresses allocated from \c mem_sgmt could be relocated if
@@ -199,13 +227,17 @@ public:
     /// created.  Can be NULL if rrset is not.
     /// \param old_rdataset If non NULL, create RdataSet merging old_rdataset
     /// into given rrset and sig_rrset.
+    /// \param wire_image If true, the new \c RdataSet also holds the wire
+    /// image of the data (see the class description).  It speeds up
+    /// rendering at the cost of memory.
     ///
     /// \return A pointer to the created \c RdataSet.
     static RdataSet* create(util::MemorySegment& mem_sgmt,
                             RdataEncoder& encoder,
                             dns::ConstRRsetPtr rrset,
                             dns::ConstRRsetPtr sig_rrset,
-                            const RdataSet* old_rdataset = NULL);
+                            const RdataSet* old_rdataset = NULL,
+                            bool wire_image = false);
 
     /// \brief Subtract some RDATAs and RRSIGs from an RdataSet
     ///
@@ -246,6 +278,8 @@ public:
     /// \param sig_rrset An RRSIG RRset containing the RRSIGs that are not
     /// to be present in the result. Can be NULL if rrset is not.
     /// \param old_rdataset The data from which to subtract.
+    /// \param wire_image If true, the new \c RdataSet also holds the wire
+    /// image of the data (see \c create()).
     ///
     /// \return A pointer to the created \c RdataSet.  NULL if the
     /// result RdataSet becomes empty.
@@ -253,7 +287,43 @@ public:
                               RdataEncoder& encoder,
                               const dns::ConstRRsetPtr& rrset,
                               const dns::ConstRRsetPtr& sig_rrset,
-                              const RdataSet& old_rdataset);
+                              const RdataSet& old_rdataset,
+                              bool wire_image = false);
+
+    /// \brief Allocate and construct a copy of an \c RdataSet.
+    ///
+    /// The new \c RdataSet has the same type, TTL and data as \c source
+    /// (including the wire image, if \c source has it), but it's not
+    /// linked to any other \c RdataSet; its \c next member is NULL.
+    /// This is used to make a private copy of an \c RdataSet shared by
+    /// different versions of zone data before modifying it.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    /// relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c RdataSet is allocated.
+    /// \param source The \c RdataSet to be copied.
+    /// \param rrclass The RR class of \c source.
+    /// \return A pointer to the created \c RdataSet.
+    static RdataSet* copy(util::MemorySegment& mem_sgmt,
+                          const RdataSet& source, dns::RRClass rrclass);
+
+    /// \brief Return whether this and another \c RdataSet have the same
+    /// data.
+    ///
+    /// They have the same data if they have the same type, TTL, RDATAs and
+    /// RRSIGs, in the same order, and either both or neither have the wire
+    /// image.  This compares the internal representations, so it's cheap,
+    /// but the same RDATAs stored in a different order are considered
+    /// different.  The \c next member doesn't matter.
+    ///
+    /// \throw none
+    ///
+    /// \param other The \c RdataSet to compare with.
+    /// \param rrclass The RR class of both \c RdataSets.
+    bool hasSameData(const RdataSet& other, dns::RRClass rrclass) const;
 
     /// \brief Destruct and deallocate \c RdataSet
     ///
@@ -355,15 +425,28 @@ private:
     // It's 2^16 - 1 = 65535.
     static const size_t MAX_RRSIG_COUNT = (1 << 16) - 1;
 
-    // Indicate the \c RdataSet contains many RRSIGs that require an additional
-    // field for the real number of RRSIGs.  It's 2^3 - 1 = 7.
+    // Indicate the \c RdataSet has the extended header, which contains
+    // the real number of RRSIGs (there are many RRSIGs, or there's the wire
+    // image).  It's 2^3 - 1 = 7.
     static const size_t MANY_RRSIG_COUNT = (1 << 3) - 1;
 
+    // The extended header, immediately following the object.
+    struct ExtHeader {
+        uint32_t data_len;      // length of the encoded RDATA
+        uint32_t image_len;     // length of the wire image, 0 if none
+        uint16_t sig_count;     // # of RRSIGs
+        uint16_t flags;         // see below
+    };
+
+    // Flag of ExtHeader: the RDATA entries of the wire image contain names.
+    static const uint16_t WIRE_IMAGE_HAS_NAMES = 0x0001;
+
     // Common code for packing the result in create and subtract.
     static RdataSet* packSet(util::MemorySegment& mem_sgmt,
                              RdataEncoder& encoder, size_t rdata_count,
-                             size_t rrsig_count, const dns::RRType& rrtype,
-                             const dns::RRTTL& rrttl);
+                             size_t rrsig_count, const dns::RRClass& rrclass,
+                             const dns::RRType& rrtype,
+                             const dns::RRTTL& rrttl, bool wire_image);
 
 public:
     /// \brief Return the bare pointer to the next node.
@@ -388,8 +471,52 @@ public:
         if (sig_rdata_count_ < MANY_RRSIG_COUNT) {
             return (sig_rdata_count_);
         } else {
-            return (*getExtSIGCountBuf());
+            return (getExtHeader()->sig_count);
+        }
+    }
+
+    /// \brief The bit of a tag in the wire image indicating the field is a
+    /// domain name (see the class description).
+    static const uint16_t WIRE_IMAGE_NAME = 0x8000;
+
+    /// \brief Return a pointer to the wire image of the \c RdataSet.
+    ///
+    /// See the class description for the format of the wire image.
+    /// It returns NULL if the \c RdataSet was created without it.
+    ///
+    /// \throw none
+    const uint8_t* getWireImage() const {
+        if (sig_rdata_count_ < MANY_RRSIG_COUNT ||
+            getExtHeader()->image_len == 0) {
+            return (NULL);
+        }
+        return (static_cast<const uint8_t*>(getDataBuf()) +
+                getExtHeader()->data_len);
+    }
+
+    /// \brief Return the length of the wire image of the \c RdataSet.
+    ///
+    /// It returns 0 if the \c RdataSet was created without it.
+    ///
+    /// \throw none
+    size_t getWireImageLength() const {
+        if (sig_rdata_count_ < MANY_RRSIG_COUNT) {
+            return (0);
         }
+        return (getExtHeader()->image_len);
+    }
+
+    /// \brief Return whether the RDATA entries of the wire image contain
+    /// domain names.
+    ///
+    /// If it returns true, the RDATA entries are sequences of tagged
+    /// fields; otherwise they are in the plain wire format (see the class
+    /// description).  It returns false if there's no wire image.
+    ///
+    /// \throw none
+    bool hasWireImageNames() const {
+        return (sig_rdata_count_ == MANY_RRSIG_COUNT &&
+                (getExtHeader()->flags & WIRE_IMAGE_HAS_NAMES) != 0);
     }
 
     /// \brief Return a pointer to the TTL data of the \c RdataSet.
@@ -413,6 +540,13 @@ public:
         return (getDataBuf<const void, const RdataSet>(this));
     }
 
+    /// \brief Return the size of the memory allocated for this object,
+    /// including the data following it.
+    ///
+    /// \throw none
+    /// \param rrclass The RR class of the \c RdataSet.
+    size_t getAllocatedSize(dns::RRClass rrclass) const;
+
 private:
     /// \brief Accessor to the memory region for encoded RDATAs, mutable
     /// version.
@@ -430,19 +564,19 @@ private:
         if (rdataset->sig_rdata_count_ < MANY_RRSIG_COUNT) {
             return (rdataset + 1);
         } else {
-            return (rdataset->getExtSIGCountBuf() + 1);
+            return (rdataset->getExtHeader() + 1);
         }
     }
 
-    /// \brief Accessor to the memory region for the RRSIG count field for
-    /// a large number of RRSIGs.
+    /// \brief Accessor to the extended header, which exists if there are
+    /// many RRSIGs or the wire image.
     ///
     /// These are used only internally and defined as private.
-    const uint16_t* getExtSIGCountBuf() const {
-        return (reinterpret_cast<const uint16_t*>(this + 1));
+    const ExtHeader* getExtHeader() const {
+        return (reinterpret_cast<const ExtHeader*>(this + 1));
     }
-    uint16_t* getExtSIGCountBuf() {
-        return (reinterpret_cast<uint16_t*>(this + 1));
+    ExtHeader* getExtHeader() {
+        return (reinterpret_cast<ExtHeader*>(this + 1));
     }
 
     // Shared by both mutable and immutable versions of find()
@@ -467,9 +601,12 @@ private:
     /// An object of this class is always expected to be created by the
     /// allocator (\c create()), so the constructor is hidden as private.
     ///
+    /// If \c ext_header is true, the extended header is expected to
+    /// follow the object (it's the caller's responsibility to fill it in).
+    ///
     /// It never throws an exception.
     RdataSet(dns::RRType type, size_t rdata_count, size_t sig_rdata_count,
-             dns::RRTTL ttl);
+             dns::RRTTL ttl, bool ext_header);
 
     /// \brief The destructor.
     ///
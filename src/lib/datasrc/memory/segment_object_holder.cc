@@ -14,6 +14,8 @@
 
 #include "segment_object_holder.h"
 
+#include <util/threads/sync.h>
+
 #include <boost/lexical_cast.hpp>
 
 #include <cassert>
@@ -24,15 +26,25 @@ namespace datasrc {
 namespace memory {
 namespace detail {
 
+namespace {
+// Zone data can be built in multiple threads (each with its own segment,
+// see ZoneTableLoader), so the index is protected by a lock.
+util::thread::Mutex index_mutex;
+uint64_t index = 0;
+}
+
 std::string
 getNextHolderName() {
-    static uint64_t index = 0;
-    ++index;
+    uint64_t current_index;
+    {
+        const util::thread::Mutex::Locker locker(index_mutex);
+        current_index = ++index;
+    }
     // in practice we should be able to assume this, uint64 is large
     // and should not overflow
-    assert(index != 0);
+    assert(current_index != 0);
     return ("Segment object holder auto name " +
-            boost::lexical_cast<std::string>(index));
+            boost::lexical_cast<std::string>(current_index));
 }
 
 }
@@ -30,7 +30,7 @@ namespace detail {
 // each call, it should be enough (we assert it does not wrap around,
 // but 64bits should be enough).
 //
-// Also, it is not thread safe.
+// It's thread safe, as zone data can be built in multiple threads.
 std::string
 getNextHolderName();
 
@@ -30,6 +30,7 @@
 #include <boost/bind.hpp>
 
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -189,10 +190,121 @@ writeRRs(AbstractMessageRenderer& renderer, size_t rr_count,
     }
     return (rr_count);
 }
+
+// Helpers for using the wire image of RdataSet (see the RdataSet class
+// description for its format).
+
+uint16_t
+readImageUint16(const uint8_t* cp) {
+    return ((cp[0] << 8) | cp[1]);
+}
+
+// Return the RDLENGTH of the RR of the wire image entry at image, and
+// advance image to the next entry.  tagged indicates whether the entry
+// consists of tagged fields.
+size_t
+getImageRdataLength(const uint8_t*& image, bool tagged) {
+    const size_t entry_len = readImageUint16(image);
+    image += sizeof(uint16_t);
+    if (!tagged) {
+        image += entry_len;
+        return (entry_len);
+    }
+    size_t length = 0;
+    const uint8_t* const end = image + entry_len;
+    while (image < end) {
+        const uint16_t tag = readImageUint16(image);
+        image += sizeof(uint16_t);
+        if ((tag & RdataSet::WIRE_IMAGE_NAME) != 0) {
+            const LabelSequence name_labels(image);
+            length += name_labels.getDataLength();
+            image += name_labels.getSerializedLength();
+        } else {
+            length += tag;
+            image += tag;
+        }
+    }
+    return (length);
+}
+
+// Similar to getLengthHelper, but for the wire image.
+uint16_t
+getImageLengthHelper(size_t rr_count, uint16_t name_labels_size,
+                     const uint8_t*& image, bool tagged)
+{
+    uint16_t length = 0;
+
+    for (size_t i = 0; i < rr_count; ++i) {
+        // Owner name, TYPE, CLASS, TTL, RDLENGTH and RDATA
+        const size_t rrlen = name_labels_size + 10 +
+            getImageRdataLength(image, tagged);
+        assert(length + rrlen < 65536);
+        length += rrlen;
+    }
+
+    return (length);
+}
+
+// Similar to writeRRs, but renders the RRs from the wire image.  image is
+// advanced to the next entry of the last rendered RR.  rr_header is the
+// TYPE, CLASS and TTL fields of the RRs in the wire format.
+size_t
+writeImageRRs(AbstractMessageRenderer& renderer, size_t rr_count,
+              const LabelSequence& name_labels, const uint8_t* rr_header,
+              size_t rr_header_len, const uint8_t*& image, bool tagged)
+{
+    for (size_t i = 0; i < rr_count; ++i) {
+        const size_t pos0 = renderer.getLength();
+
+        // Name, type, class, TTL
+        renderer.writeName(name_labels, true);
+        renderer.writeData(rr_header, rr_header_len);
+
+        // RDLEN and RDATA
+        const size_t entry_len = readImageUint16(image);
+        if (!tagged) {
+            // The entry is RDLENGTH and RDATA as they are.
+            renderer.writeData(image, sizeof(uint16_t) + entry_len);
+            image += sizeof(uint16_t) + entry_len;
+        } else {
+            const size_t pos = renderer.getLength();
+            renderer.skip(sizeof(uint16_t)); // leave the space for RDLENGTH
+            image += sizeof(uint16_t);
+            const uint8_t* const end = image + entry_len;
+            while (image < end) {
+                const uint16_t tag = readImageUint16(image);
+                image += sizeof(uint16_t);
+                if ((tag & RdataSet::WIRE_IMAGE_NAME) != 0) {
+                    const LabelSequence name(image);
+                    renderer.writeName(name,
+                                       (tag & NAMEATTR_COMPRESSIBLE) != 0);
+                    image += name.getSerializedLength();
+                } else {
+                    renderer.writeData(image, tag);
+                    image += tag;
+                }
+            }
+            renderer.writeUint16At(renderer.getLength() - pos -
+                                   sizeof(uint16_t), pos);
+        }
+
+        // Check if truncation would happen
+        if (renderer.getLength() > renderer.getLengthLimit()) {
+            renderer.trim(renderer.getLength() - pos0);
+            renderer.setTruncated();
+            return (i);
+        }
+    }
+    return (rr_count);
+}
 }
 
 uint16_t
 TreeNodeRRset::getLength() const {
+    if (rdataset_->getWireImage() != NULL) {
+        return (getLengthFromImage());
+    }
+
     size_t rlength = 0;
     RdataReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
                        rdataset_->getRdataCount(), rrsig_count_,
@@ -224,8 +336,67 @@ TreeNodeRRset::getLength() const {
     return (rrset_length + rrsig_length);
 }
 
+uint16_t
+TreeNodeRRset::getLengthFromImage() const {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const uint16_t name_labels_size =
+        getOwnerLabels(labels_buf).getDataLength();
+
+    const uint8_t* image = rdataset_->getWireImage();
+    const uint16_t rrset_length =
+        getImageLengthHelper(rdataset_->getRdataCount(), name_labels_size,
+                             image, rdataset_->hasWireImageNames());
+    const uint16_t rrsig_length = dnssec_ok_ ?
+        getImageLengthHelper(rrsig_count_, name_labels_size, image, false) :
+        0;
+
+    assert(rrset_length + rrsig_length < 65536);
+    return (rrset_length + rrsig_length);
+}
+
+unsigned int
+TreeNodeRRset::toWireFromImage(AbstractMessageRenderer& renderer) const {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence name_labels = getOwnerLabels(labels_buf);
+
+    // The TYPE, CLASS and TTL fields are common to all RRs of the RRset
+    // (except for the TYPE of RRSIGs), so we prepare them only once.
+    const uint16_t rrtype = rdataset_->type.getCode();
+    const uint16_t rrclass = rrclass_.getCode();
+    uint8_t header_buf[RR_HEADER_LEN];
+    header_buf[0] = rrtype >> 8;
+    header_buf[1] = rrtype & 0xff;
+    header_buf[2] = rrclass >> 8;
+    header_buf[3] = rrclass & 0xff;
+    std::memcpy(&header_buf[4], ttl_data_, sizeof(uint32_t));
+
+    // Render the main (non RRSIG) RRs
+    const uint8_t* image = rdataset_->getWireImage();
+    const size_t rendered_rdata_count =
+        writeImageRRs(renderer, rdataset_->getRdataCount(), name_labels,
+                      header_buf, RR_HEADER_LEN, image,
+                      rdataset_->hasWireImageNames());
+    if (renderer.isTruncated() || !dnssec_ok_) {
+        return (rendered_rdata_count);
+    }
+
+    // Render any RRSIGs
+    const uint16_t rrsig_type = RRType::RRSIG().getCode();
+    header_buf[0] = rrsig_type >> 8;
+    header_buf[1] = rrsig_type & 0xff;
+    const size_t rendered_rrsig_count =
+        writeImageRRs(renderer, rrsig_count_, name_labels, header_buf,
+                      RR_HEADER_LEN, image, false);
+
+    return (rendered_rdata_count + rendered_rrsig_count);
+}
+
 unsigned int
 TreeNodeRRset::toWire(AbstractMessageRenderer& renderer) const {
+    if (rdataset_->getWireImage() != NULL) {
+        return (toWireFromImage(renderer));
+    }
+
     RdataReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
                        rdataset_->getRdataCount(), rrsig_count_,
                        boost::bind(renderName, _1, _2, &renderer),
@@ -189,6 +189,13 @@ public:
 
     virtual std::string toText() const;
 
+    /// \brief Specialized version of \c toWire(renderer) for
+    /// \c TreeNodeRRset.
+    ///
+    /// If the \c RdataSet has the wire image, the RDATA fields are
+    /// rendered from it, only passing the names in the RDATAs to the
+    /// renderer separately (for name compression).  Otherwise they are
+    /// decoded with \c RdataReader.  The result is the same in both cases.
     virtual unsigned int toWire(dns::AbstractMessageRenderer& renderer) const;
 
     /// \brief Specialized version of \c toWire(buffer) for \c TreeNodeRRset.
@@ -261,6 +268,14 @@ private:
     dns::RdataIteratorPtr getRdataIteratorInternal(bool is_rrsig,
                                                    size_t count) const;
 
+    // Versions of getLength() and toWire() using the wire image of the
+    // RdataSet, used if it has the image.
+    uint16_t getLengthFromImage() const;
+    unsigned int toWireFromImage(dns::AbstractMessageRenderer& renderer) const;
+
+    // Length of the TYPE, CLASS and TTL fields of an RR.
+    static const size_t RR_HEADER_LEN = 8;
+
     // Return \c LabelSequence for the owner name regardless of how this
     /// class is constructed (with or without 'realname')
     dns::LabelSequence getOwnerLabels(
@@ -19,6 +19,11 @@
 #include <dns/rrset.h>
 #include <dns/rrtype.h>
 
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+#include <time.h>
+
 namespace bundy {
 namespace datasrc {
 namespace memory {
@@ -45,6 +50,44 @@ getCoveredType(const dns::ConstRRsetPtr& sig_rrset) {
             typeCovered());
 }
 
+/// \brief Measure the time spent for a part of a zone load.
+///
+/// The time elapsed between the construction and destruction of the object
+/// is added, in microseconds, to the variable given on construction.  It's
+/// measured with the monotonic clock, so it's not affected by adjustments
+/// of the system time.
+class LoadTimer : boost::noncopyable {
+public:
+    LoadTimer(uint64_t& load_time) : load_time_(load_time) {
+        clock_gettime(CLOCK_MONOTONIC, &start_);
+    }
+    ~LoadTimer() {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        load_time_ +=
+            static_cast<uint64_t>(end.tv_sec - start_.tv_sec) * 1000000 +
+            (end.tv_nsec - start_.tv_nsec) / 1000;
+    }
+private:
+    uint64_t& load_time_;
+    struct timespec start_;
+};
+
+/// \brief Return the memory size of zone data adjusted by the change of the
+/// allocated size of its segment.
+///
+/// The allocated size can decrease from \c old_allocated to
+/// \c new_allocated (e.g., when a journal update deletes records), and the
+/// given \c size can be inaccurate (e.g., 0 for data loaded by an older
+/// version), so the result is clamped at 0 instead of wrapping around.
+inline size_t
+adjustMemorySize(size_t size, size_t old_allocated, size_t new_allocated) {
+    const int64_t adjusted = static_cast<int64_t>(size) +
+        (static_cast<int64_t>(new_allocated) -
+         static_cast<int64_t>(old_allocated));
+    return (adjusted > 0 ? adjusted : 0);
+}
+
 } // namespace detail
 } // namespace memory
 } // namespace datasrc
@@ -12,6 +12,7 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <util/buffer.h>
 #include <util/memory_segment.h>
 
 #include <dns/name.h>
@@ -43,6 +44,7 @@ namespace memory {
 // Definition of a class static constant.  It's public and its address
 // could be needed by applications, so we need an explicit definition.
 const ZoneNode::Flags ZoneData::DNSSEC_SIGNED;
+const ZoneNode::Flags ZoneData::NO_DELEGATION_ABOVE;
 
 namespace {
 void
@@ -119,6 +121,18 @@ NSEC3Data::create(util::MemorySegment& mem_sgmt,
     return (param_data);
 }
 
+NSEC3Data*
+NSEC3Data::create(util::MemorySegment& mem_sgmt,
+                  const Name& zone_origin,
+                  const NSEC3Data& source)
+{
+    const uint8_t* const salt_data = source.getSaltData();
+    const std::vector<uint8_t> salt(salt_data,
+                                    salt_data + source.getSaltLen());
+    return (NSEC3Data::create(mem_sgmt, zone_origin, source.hashalg,
+                              source.flags, source.iterations, salt));
+}
+
 void
 NSEC3Data::destroy(util::MemorySegment& mem_sgmt, NSEC3Data* data,
                    RRClass nsec3_class)
@@ -167,6 +181,194 @@ NSEC3Data::removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node) {
     nsec3_tree_->remove(mem_sgmt, node, nullDeleter);
 }
 
+// An entry of ZoneNameIndex.  The name of the node, in the form of a
+// serialized LabelSequence, immediately follows the entry.
+struct ZoneNameIndex::Entry {
+    Entry(ZoneNode* node_param, uint32_t hash_param, size_t labels_len_param) :
+        node(node_param), hash(hash_param), labels_len(labels_len_param)
+    {}
+    const void* getLabelsData() const { return (this + 1); }
+    void* getLabelsData() { return (this + 1); }
+
+    boost::interprocess::offset_ptr<ZoneNode> node;
+    const uint32_t hash;
+    const uint16_t labels_len;
+};
+
+namespace {
+// The initial number of slots of ZoneNameIndex.  It must be a power of 2.
+const uint32_t NAME_INDEX_INITIAL_CAPACITY = 64;
+
+// The hash value of a name for ZoneNameIndex.  The index is built from the
+// zone data and the names given in the search don't affect its layout,
+// so the seed doesn't have to be unpredictable.  But it must be the same
+// in every process sharing the data.
+uint32_t
+getNameIndexHash(const LabelSequence& labels) {
+    return (static_cast<uint32_t>(labels.getFullHash(false, 0)));
+}
+}
+
+ZoneNameIndex::ZoneNameIndex() :
+    table_(NULL), capacity_(0), count_(0)
+{}
+
+void
+ZoneNameIndex::clear(util::MemorySegment& mem_sgmt) {
+    EntryPtr* const table = table_.get();
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        Entry* const entry = table[i].get();
+        if (entry != NULL) {
+            const size_t labels_len = entry->labels_len;
+            entry->~Entry();
+            mem_sgmt.deallocate(entry, sizeof(Entry) + labels_len);
+        }
+    }
+    if (table != NULL) {
+        mem_sgmt.deallocate(table, sizeof(EntryPtr) * capacity_);
+    }
+    table_ = NULL;
+    capacity_ = 0;
+    count_ = 0;
+}
+
+ZoneNameIndex::Entry*
+ZoneNameIndex::findEntry(const LabelSequence& labels, uint32_t hash,
+                         uint32_t* slot) const
+{
+    if (capacity_ == 0) {
+        return (NULL);
+    }
+    const EntryPtr* const table = table_.get();
+    const uint32_t mask = capacity_ - 1;
+    for (uint32_t i = hash & mask; table[i]; i = (i + 1) & mask) {
+        Entry* const entry = table[i].get();
+        if (entry->hash == hash &&
+            LabelSequence(entry->getLabelsData()).equals(labels)) {
+            if (slot != NULL) {
+                *slot = i;
+            }
+            return (entry);
+        }
+    }
+    return (NULL);
+}
+
+const ZoneNode*
+ZoneNameIndex::find(const LabelSequence& labels) const {
+    const Entry* const entry = findEntry(labels, getNameIndexHash(labels),
+                                         NULL);
+    return (entry != NULL ? entry->node.get() : NULL);
+}
+
+ZoneNode*
+ZoneNameIndex::find(const LabelSequence& labels) {
+    Entry* const entry = findEntry(labels, getNameIndexHash(labels), NULL);
+    return (entry != NULL ? entry->node.get() : NULL);
+}
+
+void
+ZoneNameIndex::grow(util::MemorySegment& mem_sgmt) {
+    const uint32_t new_capacity =
+        (capacity_ == 0) ? NAME_INDEX_INITIAL_CAPACITY : capacity_ * 2;
+    EntryPtr* const new_table = static_cast<EntryPtr*>(
+        mem_sgmt.allocate(sizeof(EntryPtr) * new_capacity));
+    for (uint32_t i = 0; i < new_capacity; ++i) {
+        new(&new_table[i]) EntryPtr(NULL);
+    }
+
+    // Nothing below can throw.
+    EntryPtr* const table = table_.get();
+    const uint32_t mask = new_capacity - 1;
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        Entry* const entry = table[i].get();
+        if (entry != NULL) {
+            uint32_t j = entry->hash & mask;
+            while (new_table[j]) {
+                j = (j + 1) & mask;
+            }
+            new_table[j] = entry;
+        }
+    }
+    if (table != NULL) {
+        mem_sgmt.deallocate(table, sizeof(EntryPtr) * capacity_);
+    }
+    table_ = new_table;
+    capacity_ = new_capacity;
+}
+
+void
+ZoneNameIndex::insert(util::MemorySegment& mem_sgmt,
+                      const LabelSequence& labels, ZoneNode* node)
+{
+    const uint32_t hash = getNameIndexHash(labels);
+    Entry* const found = findEntry(labels, hash, NULL);
+    if (found != NULL) {
+        found->node = node;
+        return;
+    }
+
+    // Keep the load factor at most 1/2.  Note that the allocation can
+    // throw (and relocate this object if the segment grows), so we
+    // shouldn't change anything before that.
+    if ((count_ + 1) * 2 > capacity_) {
+        grow(mem_sgmt);
+    }
+    const size_t labels_len = labels.getSerializedLength();
+    void* p = mem_sgmt.allocate(sizeof(Entry) + labels_len);
+    Entry* const entry = new(p) Entry(node, hash, labels_len);
+    labels.serialize(entry->getLabelsData(), labels_len);
+
+    EntryPtr* const table = table_.get();
+    const uint32_t mask = capacity_ - 1;
+    uint32_t i = hash & mask;
+    while (table[i]) {
+        i = (i + 1) & mask;
+    }
+    table[i] = entry;
+    ++count_;
+}
+
+void
+ZoneNameIndex::remove(util::MemorySegment& mem_sgmt,
+                      const LabelSequence& labels)
+{
+    uint32_t i;
+    Entry* const entry = findEntry(labels, getNameIndexHash(labels), &i);
+    if (entry == NULL) {
+        return;
+    }
+    const size_t labels_len = entry->labels_len;
+    entry->~Entry();
+    mem_sgmt.deallocate(entry, sizeof(Entry) + labels_len);
+    --count_;
+
+    // Fill the hole by moving back the following entries of the cluster,
+    // so no entry becomes unreachable from the slot of its hash value.
+    EntryPtr* const table = table_.get();
+    const uint32_t mask = capacity_ - 1;
+    uint32_t j = i;
+    while (true) {
+        table[i] = NULL;
+        while (true) {
+            j = (j + 1) & mask;
+            if (!table[j]) {
+                return;
+            }
+            // The entry at j can fill the hole at i unless its home slot
+            // is (cyclically) in (i, j].
+            const uint32_t home = table[j]->hash & mask;
+            const bool stays = (i <= j) ? (i < home && home <= j) :
+                (i < home || home <= j);
+            if (!stays) {
+                break;
+            }
+        }
+        table[i] = table[j];
+        i = j;
+    }
+}
+
 namespace {
 // A helper to convert a TTL value in network byte order and set it in
 // ZoneData::min_ttl_.  We can use util::OutputBuffer, but copy the logic
@@ -185,15 +387,129 @@ setTTLInNetOrder(uint32_t val, uint32_t* result) {
 }
 }
 
-ZoneData::ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node) :
+namespace {
+// The flags of a node that are copied by ZoneData::createCopy().
+const ZoneNode::Flags COPIED_NODE_FLAGS[] = {
+    ZoneNode::FLAG_CALLBACK, ZoneNode::FLAG_USER1, ZoneNode::FLAG_USER2,
+    ZoneNode::FLAG_USER3, ZoneNode::FLAG_USER4
+};
+
+// Return the absolute name of a node.
+Name
+getNodeName(const ZoneNode& node) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    size_t length;
+    const uint8_t* const data =
+        node.getAbsoluteLabels(labels_buf).getData(&length);
+    util::InputBuffer buffer(data, length);
+    return (Name(buffer));
+}
+
+// Insert all names of the given tree under the origin into the target
+// (ZoneData or NSEC3Data), with the flags of the original nodes.  The data
+// of the new nodes refer to those of the original nodes.
+template <typename TargetType>
+void
+copyNodes(util::MemorySegment& mem_sgmt, const ZoneTree& source_tree,
+          const Name& origin, TargetType& target)
+{
+    const ZoneNode* node = NULL;
+    ZoneChain node_path;
+    const ZoneTree::Result result = source_tree.find(origin, &node,
+                                                     node_path);
+    assert(result == ZoneTree::EXACTMATCH);
+    for (; node != NULL; node = source_tree.nextNode(node_path)) {
+        ZoneNode* new_node = NULL;
+        target.insertName(mem_sgmt, getNodeName(*node), &new_node);
+        for (size_t i = 0;
+             i < sizeof(COPIED_NODE_FLAGS) / sizeof(COPIED_NODE_FLAGS[0]);
+             ++i) {
+            new_node->setFlag(COPIED_NODE_FLAGS[i],
+                              node->getFlag(COPIED_NODE_FLAGS[i]));
+        }
+        // The RdataSets are never modified via the copy (see createCopy()).
+        new_node->setData(const_cast<RdataSet*>(node->getData()));
+    }
+}
+
+// Return whether the node has the same data as the node of the same name
+// in other_tree.
+bool
+isNodeDataShared(const ZoneNode& node, const ZoneTree& other_tree) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const ZoneNode* other_node = NULL;
+    ZoneChain other_path;
+    return (other_tree.find<void*>(node.getAbsoluteLabels(labels_buf),
+                                   &other_node, other_path, NULL,
+                                   NULL) == ZoneTree::EXACTMATCH &&
+            other_node->getData() == node.getData());
+}
+
+// Make the nodes of the given tree empty if they have the same data as
+// the node of the same name in other_tree.  If other_tree is NULL, all
+// nodes are made empty.  The tree is not modified otherwise.
+void
+detachNodes(const ZoneTree& tree, const LabelSequence& origin,
+            const ZoneTree* other_tree)
+{
+    const ZoneNode* node = NULL;
+    ZoneChain node_path;
+    const ZoneTree::Result result =
+        tree.find<void*>(origin, &node, node_path, NULL, NULL);
+    assert(result == ZoneTree::EXACTMATCH);
+    for (; node != NULL; node = tree.nextNode(node_path)) {
+        if (node->isEmpty()) {
+            continue;
+        }
+        if (other_tree != NULL && !isNodeDataShared(*node, *other_tree)) {
+            continue;
+        }
+        // The tree only allows read-only iteration, but we own the tree,
+        // so it's safe to modify the node.
+        const_cast<ZoneNode*>(node)->setData(NULL);
+    }
+}
+
+// Return the total size of the RdataSets of the nodes in the given tree
+// that have the same data as the node of the same name in other_tree.
+size_t
+getSharedNodeDataSize(const ZoneTree& tree, const LabelSequence& origin,
+                      const ZoneTree& other_tree, RRClass rrclass)
+{
+    const ZoneNode* node = NULL;
+    ZoneChain node_path;
+    const ZoneTree::Result result =
+        tree.find<void*>(origin, &node, node_path, NULL, NULL);
+    assert(result == ZoneTree::EXACTMATCH);
+    size_t size = 0;
+    for (; node != NULL; node = tree.nextNode(node_path)) {
+        if (node->isEmpty() || !isNodeDataShared(*node, other_tree)) {
+            continue;
+        }
+        for (const RdataSet* rdataset = node->getData();
+             rdataset != NULL;
+             rdataset = rdataset->getNext()) {
+            size += rdataset->getAllocatedSize(rrclass);
+        }
+    }
+    return (size);
+}
+}
+
+ZoneData::ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node,
+                   bool name_index) :
     zone_tree_(zone_tree), origin_node_(origin_node),
-    min_ttl_(0)          // tentatively set to silence static checkers
+    load_time_(0), memory_size_(0),
+    min_ttl_(0),         // tentatively set to silence static checkers
+    name_index_enabled_(name_index)
 {
     setTTLInNetOrder(RRTTL::MAX_TTL().getValue(), &min_ttl_);
 }
 
 ZoneData*
-ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin) {
+ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin,
+                 bool name_index)
+{
     // ZoneTree::insert() and ZoneData allocation can throw.  See also
     // NSEC3Data::create().
     typedef boost::function<void(RdataSet*)> RdataSetDeleterType;
@@ -207,7 +523,8 @@ ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin) {
         tree->insert(mem_sgmt, zone_origin, &origin_node);
     assert(result == ZoneTree::SUCCESS);
     void* p = mem_sgmt.allocate(sizeof(ZoneData));
-    ZoneData* zone_data = new(p) ZoneData(holder.release(), origin_node);
+    ZoneData* zone_data = new(p) ZoneData(holder.release(), origin_node,
+                                          name_index);
 
     return (zone_data);
 }
@@ -219,6 +536,44 @@ ZoneData::create(util::MemorySegment& mem_sgmt) {
     return (zone_data);
 }
 
+ZoneData*
+ZoneData::createCopy(util::MemorySegment& mem_sgmt, const ZoneData& source,
+                     RRClass zone_class)
+{
+    const Name origin = getNodeName(*source.origin_node_);
+    detail::SegmentObjectHolder<ZoneData, RRClass> holder(mem_sgmt,
+                                                          zone_class);
+    holder.set(create(mem_sgmt, origin, source.name_index_enabled_));
+    try {
+        ZoneData* const zone_data = holder.get();
+        zone_data->min_ttl_ = source.min_ttl_;
+        copyNodes(mem_sgmt, *source.zone_tree_, origin, *zone_data);
+        if (source.nsec3_data_) {
+            zone_data->setNSEC3Data(NSEC3Data::create(mem_sgmt, origin,
+                                                      *source.nsec3_data_));
+            copyNodes(mem_sgmt, source.nsec3_data_->getNSEC3Tree(), origin,
+                      *zone_data->nsec3_data_);
+        }
+    } catch (...) {
+        // All data of the partial copy belong to the source; make sure
+        // they are not destroyed with it.  Note that the source and the
+        // copy may have been relocated, so we shouldn't use the addresses
+        // we have here except via the holder.
+        ZoneData* const zone_data = holder.release();
+        uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+        const LabelSequence origin_labels =
+            zone_data->origin_node_->getAbsoluteLabels(labels_buf);
+        detachNodes(*zone_data->zone_tree_, origin_labels, NULL);
+        if (zone_data->nsec3_data_) {
+            detachNodes(zone_data->nsec3_data_->getNSEC3Tree(),
+                        origin_labels, NULL);
+        }
+        destroy(mem_sgmt, zone_data, zone_class);
+        throw;
+    }
+    return (holder.release());
+}
+
 void
 ZoneData::destroy(util::MemorySegment& mem_sgmt, ZoneData* zone_data,
                   RRClass zone_class)
@@ -229,6 +584,7 @@ ZoneData::destroy(util::MemorySegment& mem_sgmt, ZoneData* zone_data,
     if (zone_data->nsec3_data_) {
         NSEC3Data::destroy(mem_sgmt, zone_data->nsec3_data_.get(), zone_class);
     }
+    zone_data->name_index_.clear(mem_sgmt);
     mem_sgmt.deallocate(zone_data, sizeof(ZoneData));
 }
 
@@ -241,10 +597,37 @@ ZoneData::insertName(util::MemorySegment& mem_sgmt, const Name& name,
     // This should be ensured by the API:
     assert((result == ZoneTree::SUCCESS ||
             result == ZoneTree::ALREADYEXISTS) && node != NULL);
+
+    // Add new nodes to the name index.  Existing empty nodes may have been
+    // created by the tree as a non-terminal, or inserted but not indexed
+    // due to an exception, so we add them too (it's no-op if it's already
+    // in the index).  The index can throw, but then the node will be added
+    // when the name is inserted next time.
+    if (name_index_enabled_ &&
+        (result == ZoneTree::SUCCESS || (*node)->isEmpty())) {
+        bool delegated = false;
+        for (const ZoneNode* upper = (*node)->getUpperNode();
+             upper != NULL;
+             upper = upper->getUpperNode()) {
+            if (upper->getFlag(ZoneNode::FLAG_CALLBACK)) {
+                delegated = true;
+                break;
+            }
+        }
+        (*node)->setFlag(NO_DELEGATION_ABOVE, !delegated);
+        name_index_.insert(mem_sgmt, LabelSequence(name), *node);
+    }
 }
 
 ZoneNode*
 ZoneData::findName(const Name& name) {
+    if (name_index_enabled_) {
+        ZoneNode* const indexed_node = name_index_.find(LabelSequence(name));
+        if (indexed_node != NULL) {
+            return (indexed_node);
+        }
+    }
+
     ZoneNode* node = NULL;
     const ZoneTree::Result result = zone_tree_->find(name, &node);
 
@@ -265,9 +648,78 @@ ZoneData::removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node) {
     if (node == getOriginNode()) {
         return;
     }
+    if (name_index_enabled_) {
+        // The tree also removes the empty upper nodes that have no other
+        // subdomains.  We don't bother to check the latter condition, and
+        // simply remove all empty upper nodes from the index.
+        uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+        for (ZoneNode* cur = node;
+             cur != NULL && cur->isEmpty() && cur != getOriginNode();
+             cur = cur->getUpperNode()) {
+            name_index_.remove(mem_sgmt, cur->getAbsoluteLabels(labels_buf));
+        }
+    }
     zone_tree_->remove(mem_sgmt, node, nullDeleter);
 }
 
+void
+ZoneData::setDelegation(ZoneNode* node) {
+    node->setFlag(ZoneNode::FLAG_CALLBACK);
+    if (!name_index_enabled_) {
+        return;
+    }
+
+    // Walk through the nodes below the given one in the DNSSEC order,
+    // which come right after it.
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence node_labels = node->getAbsoluteLabels(labels_buf);
+    ZoneChain node_path;
+    ZoneNode* found = NULL;
+    const ZoneTree::Result result =
+        zone_tree_->find<void*>(node_labels, &found, node_path, NULL, NULL);
+    assert(result == ZoneTree::EXACTMATCH && found == node);
+    uint8_t cur_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    for (const ZoneNode* cur = zone_tree_->nextNode(node_path);
+         cur != NULL;
+         cur = zone_tree_->nextNode(node_path)) {
+        if (cur->getAbsoluteLabels(cur_buf).compare(node_labels).
+            getRelation() != NameComparisonResult::SUBDOMAIN) {
+            break;
+        }
+        // The tree only allows read-only iteration, but we own the tree,
+        // so it's safe to modify the node.
+        const_cast<ZoneNode*>(cur)->setFlag(NO_DELEGATION_ABOVE, false);
+    }
+}
+
+void
+ZoneData::detachSharedData(const ZoneData& other) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence origin_labels =
+        origin_node_->getAbsoluteLabels(labels_buf);
+    detachNodes(*zone_tree_, origin_labels, &other.getZoneTree());
+    if (nsec3_data_ && other.nsec3_data_) {
+        detachNodes(nsec3_data_->getNSEC3Tree(), origin_labels,
+                    &other.nsec3_data_->getNSEC3Tree());
+    }
+}
+
+size_t
+ZoneData::getSharedDataSize(const ZoneData& other, RRClass rrclass) const {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence origin_labels =
+        origin_node_->getAbsoluteLabels(labels_buf);
+    size_t size = getSharedNodeDataSize(*zone_tree_, origin_labels,
+                                        other.getZoneTree(), rrclass);
+    if (nsec3_data_ && other.nsec3_data_) {
+        size += getSharedNodeDataSize(nsec3_data_->getNSEC3Tree(),
+                                      origin_labels,
+                                      other.nsec3_data_->getNSEC3Tree(),
+                                      rrclass);
+    }
+    return (size);
+}
+
 void
 ZoneData::setMinTTL(uint32_t min_ttl_val) {
     setTTLInNetOrder(min_ttl_val, &min_ttl_);
@@ -131,6 +131,27 @@ public:
                              const dns::Name& zone_origin,
                              const dns::rdata::generic::NSEC3& rdata);
 
+    /// \brief Allocate and construct \c NSEC3Data with the same NSEC3
+    /// parameters as another one.
+    ///
+    /// The NSEC3 name space of the created \c NSEC3Data object is empty
+    /// (it only has the origin); the names of \c source aren't copied.
+    ///
+    /// The exception guarantee is the same as the other versions.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c NSEC3Data is allocated.
+    /// \param zone_origin The zone origin.
+    /// \param source The \c NSEC3Data that has the NSEC3 parameters to be
+    /// stored.
+    static NSEC3Data* create(util::MemorySegment& mem_sgmt,
+                             const dns::Name& zone_origin,
+                             const NSEC3Data& source);
+
     /// \brief Return NSEC3Data has no NSEC3 RRs.
     ///
     /// \note Implementation note: due to the simplified structure of
@@ -263,6 +284,108 @@ private:
     }
 };
 
+/// \brief A hash index of the names of a zone.
+///
+/// This class maps absolute names to the corresponding \c ZoneNode in the
+/// tree of a zone, so the node of a name can be found without walking the
+/// tree.  It's an open addressing hash table with linear probing.  Each
+/// slot of the table points to an entry that holds the name (in the form
+/// of a serialized \c LabelSequence), its hash value and the node.  The
+/// names are compared case-insensitively.
+///
+/// Like other zone data, it only uses offset pointers, and the table and
+/// entries are allocated from the memory segment of the zone, so it can
+/// be stored in a shared memory region.
+///
+/// The index isn't necessarily complete; a name that isn't in the index
+/// can still exist in the tree.  This class is used as part of
+/// \c ZoneData, and is not expected to be used directly by applications.
+class ZoneNameIndex : boost::noncopyable {
+public:
+    /// \brief The constructor.
+    ///
+    /// It creates an empty index, which doesn't allocate any memory until
+    /// the first name is inserted.
+    ///
+    /// \throw none
+    ZoneNameIndex();
+
+    /// \brief Remove all names from the index and release the memory.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for the
+    /// index.
+    void clear(util::MemorySegment& mem_sgmt);
+
+    /// \brief Find the node of the given name in the index.
+    ///
+    /// \throw none
+    ///
+    /// \param labels The absolute name to be found.
+    /// \return The node of the name; NULL if it's not in the index.
+    const ZoneNode* find(const dns::LabelSequence& labels) const;
+
+    /// \brief Find the node of the given name in the index, non-const
+    /// version.
+    ZoneNode* find(const dns::LabelSequence& labels);
+
+    /// \brief Add a name and its node to the index.
+    ///
+    /// If the name is already in the index, its node is replaced with
+    /// the given one.
+    ///
+    /// This method is exception safe: if an exception is thrown the index
+    /// is still valid, although the name may not have been added.  As
+    /// with \c ZoneData::create(), addresses allocated from \c mem_sgmt
+    /// could be relocated if \c util::MemorySegmentGrown is thrown.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown,
+    ///     possibly relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt The \c MemorySegment from which memory for the
+    /// index is allocated.
+    /// \param labels The absolute name of the node.
+    /// \param node The node of the name.
+    void insert(util::MemorySegment& mem_sgmt,
+                const dns::LabelSequence& labels, ZoneNode* node);
+
+    /// \brief Remove a name from the index.
+    ///
+    /// It's no-op if the name isn't in the index.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for the
+    /// index.
+    /// \param labels The absolute name to be removed.
+    void remove(util::MemorySegment& mem_sgmt,
+                const dns::LabelSequence& labels);
+
+    /// \brief Return the number of names in the index.
+    ///
+    /// \throw none
+    size_t getSize() const { return (count_); }
+
+private:
+    struct Entry;
+    typedef boost::interprocess::offset_ptr<Entry> EntryPtr;
+
+    // Return the entry of the given name and its hash value, and set its
+    // position in the table in slot (unless it's NULL).  Returns NULL if
+    // not found.
+    Entry* findEntry(const dns::LabelSequence& labels, uint32_t hash,
+                     uint32_t* slot) const;
+
+    // Double the size of the table (or allocate the initial one).
+    void grow(util::MemorySegment& mem_sgmt);
+
+    boost::interprocess::offset_ptr<EntryPtr> table_;
+    uint32_t capacity_;         // always a power of 2, or 0 if no table
+    uint32_t count_;
+};
+
 /// \brief DNS zone data.
 ///
 /// This class encapsulates the content of a DNS zone (which is essentially a
@@ -398,7 +521,7 @@ private:
     /// allocator (\c create()), so the constructor is hidden as private.
     ///
     /// It never throws an exception.
-    ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node);
+    ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node, bool name_index);
 
     // Zone node flags.  When adding a new flag, it's generally advisable to
     // keep existing values so the binary image of the data is as much
@@ -423,6 +546,15 @@ private:
     static const ZoneNode::Flags EMPTY_ZONE = ZoneNode::FLAG_USER3;
 
 public:
+    /// \brief Node flag indicating there's no zone cut above the node
+    ///
+    /// This means none of the node's ancestors in the zone is a zone cut
+    /// due to NS or has a DNAME, so the node is found as it is in a search
+    /// for its name.  It's only maintained if the zone has the name index
+    /// (see \c create()), and the lack of the flag doesn't necessarily mean
+    /// there's a zone cut.
+    static const ZoneNode::Flags NO_DELEGATION_ABOVE = ZoneNode::FLAG_USER4;
+
     /// \brief Allocate and construct \c ZoneData.
     ///
     /// This method ensures there'll be no memory leak on exception.
@@ -436,11 +568,19 @@ public:
     ///     relocating data.
     /// \throw std::bad_alloc Memory allocation fails.
     ///
+    /// If \c name_index is true, the zone data also keep a hash index of
+    /// the names inserted by \c insertName() (see \c ZoneNameIndex), which
+    /// makes it possible to find exact matches without walking the tree
+    /// (see \c findIndexedName()).  It needs additional memory for each
+    /// name.
+    ///
     /// \param mem_sgmt A \c MemorySegment from which memory for the new
     /// \c ZoneData is allocated.
     /// \param zone_origin The zone origin.
+    /// \param name_index Whether to keep the hash index of the names.
     static ZoneData* create(util::MemorySegment& mem_sgmt,
-                            const dns::Name& zone_origin);
+                            const dns::Name& zone_origin,
+                            bool name_index = false);
 
     /// \brief Allocate and construct a special "empty" \c ZoneData.
     ///
@@ -459,6 +599,44 @@ public:
     /// \c ZoneData is allocated.
     static ZoneData* create(util::MemorySegment& mem_sgmt);
 
+    /// \brief Allocate and construct a copy of \c ZoneData that shares
+    /// the \c RdataSets with the original.
+    ///
+    /// The created \c ZoneData object has all the names of \c source
+    /// (including those of the NSEC3 name space) with the same flags, and
+    /// its other attributes (such as the minimum TTL and whether to keep
+    /// the name index) are also the same as those of \c source.  But the
+    /// lists of \c RdataSet objects are not copied; each name of the copy
+    /// refers to the same list as the name of \c source.
+    ///
+    /// This makes it possible to build a new version of a zone from the
+    /// current version by applying (relatively small) changes, while the
+    /// current version is still in use.  The copy must not be directly
+    /// modified; the changes must be applied with a \c ZoneDataUpdater
+    /// that is aware of \c source, so that any shared \c RdataSet is
+    /// copied before being modified.  Also, before destroying either of
+    /// \c source or the copy (or its updated version) while the other is
+    /// still used, \c detachSharedData() must be called on the one to be
+    /// destroyed.
+    ///
+    /// This method ensures there'll be no memory leak on exception, and
+    /// \c source is never modified even in that case.  But as with
+    /// \c create(), addresses allocated from \c mem_sgmt (including
+    /// \c source) could be relocated if \c util::MemorySegmentGrown is
+    /// thrown.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt The \c MemorySegment from which memory for
+    /// \c source was allocated, and for the copy is allocated.
+    /// \param source The \c ZoneData to be copied.
+    /// \param zone_class The RR class of the zone.
+    static ZoneData* createCopy(util::MemorySegment& mem_sgmt,
+                                const ZoneData& source,
+                                dns::RRClass zone_class);
+
     /// \brief Destruct and deallocate \c ZoneData.
     ///
     /// It releases all resource allocated in the internal storage NSEC3 for
@@ -566,6 +744,62 @@ public:
     ///
     /// \throw none
     const void* getMinTTLData() const { return (&min_ttl_); }
+
+    /// \brief Return whether or not the zone data keep the name index.
+    ///
+    /// \throw none
+    bool hasNameIndex() const { return (name_index_enabled_); }
+
+    /// \brief Return the size of the memory used by the zone data.
+    ///
+    /// This is the value last set by \c setMemorySize(), in bytes; it's 0
+    /// by default.  It's normally set by \c ZoneWriter, based on the
+    /// memory allocated from the memory segment to build the zone data.
+    ///
+    /// \throw none
+    size_t getMemorySize() const { return (memory_size_); }
+
+    /// \brief Return the time it took to load the zone data.
+    ///
+    /// This is the value last set by \c setLoadTime(), in microseconds;
+    /// it's 0 by default.
+    ///
+    /// \throw none
+    uint64_t getLoadTime() const { return (load_time_); }
+
+    /// \brief Return the size of the \c RdataSets shared with other zone
+    /// data.
+    ///
+    /// This is the total size of the memory allocated for the \c RdataSets
+    /// that \c detachSharedData() would detach with the same \c other, in
+    /// bytes.  Unlike \c detachSharedData(), it doesn't modify the zone data,
+    /// so it can be called while the zone data are in use.
+    ///
+    /// \throw none
+    /// \param other The zone data that may share the \c RdataSets.
+    /// \param rrclass The RR class of the zone.
+    size_t getSharedDataSize(const ZoneData& other,
+                             dns::RRClass rrclass) const;
+
+    /// \brief Find the node of the given name in the name index.
+    ///
+    /// This is a faster alternative to an exact match search in the tree.
+    /// But not all names in the tree are in the index (for example, the
+    /// empty non-terminal nodes created by the tree itself), so if it
+    /// returns NULL, the tree must be searched.  It always returns NULL if
+    /// the zone data don't keep the index.
+    ///
+    /// Note that the returned node can be empty.  Also, unlike the search in
+    /// the tree, it doesn't check zone cuts above the node; the
+    /// \c NO_DELEGATION_ABOVE flag of the node can be used to see whether
+    /// that's needed.
+    ///
+    /// \throw none
+    /// \param labels The absolute name to be found.
+    /// \return The node of the given name; NULL if not found in the index.
+    const ZoneNode* findIndexedName(const dns::LabelSequence& labels) const {
+        return (name_index_enabled_ ? name_index_.find(labels) : NULL);
+    }
     //@}
 
     ///
@@ -595,6 +829,11 @@ public:
     /// succeeds (except for the rare case where memory allocation
     /// fails) and \c node will be set to a valid pointer.
     ///
+    /// If the zone data keep the name index, a newly created node (or an
+    /// existing empty one) is also added to the index, and its
+    /// \c NO_DELEGATION_ABOVE flag is set if none of its ancestors is
+    /// marked by \c setDelegation().
+    ///
     /// \note We may want to differentiate between the case where the name is
     /// newly created and the case where it already existed.  Right now it's
     /// unclear, so it doesn't return this information.  If we see the need
@@ -627,10 +866,22 @@ public:
     /// \return The node of the given name; NULL if not found.
     ZoneNode* findName(const dns::Name& name);
 
+    /// \brief Mark the given node as a zone cut or a node with DNAME.
+    ///
+    /// This sets the \c ZoneNode::FLAG_CALLBACK flag of the node, and if
+    /// the zone data keep the name index, clears the
+    /// \c NO_DELEGATION_ABOVE flag of all nodes below it.
+    ///
+    /// \throw none
+    /// \param node The node to be marked, which must belong to the zone.
+    void setDelegation(ZoneNode* node);
+
     /// \brief Remove the given node from the zone.
     ///
     /// The caller is responsible for ensuring that the node belong to
     /// the \c ZoneData.  \c node must be empty, i.e, must not have data.
+    /// If the zone data keep the name index, the node (and any of its empty
+    /// ancestors, which may be removed with it) is removed from the index.
     /// Unless given an invalid parameter, this method is exception free.
     ///
     /// \throw InvalidParameter node is not empty
@@ -638,6 +889,20 @@ public:
     /// \param node The node to be removed.
     void removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node);
 
+    /// \brief Stop referring to the \c RdataSets shared with other zone
+    /// data.
+    ///
+    /// For each name of this zone data (including those of the NSEC3 name
+    /// space) whose list of \c RdataSet objects is identical to that of the
+    /// same name in \c other, the name is made empty.  It's intended to be
+    /// called on the old or new version of a zone that was built by
+    /// \c createCopy(), right before destroying it, so that the data still
+    /// used by the other version are not destroyed.
+    ///
+    /// \throw none
+    /// \param other The zone data that may share the \c RdataSets.
+    void detachSharedData(const ZoneData& other);
+
     /// \brief Specify whether or not the zone is signed in terms of DNSSEC.
     ///
     /// The zone will be considered "signed" (in that subsequent calls to
@@ -708,13 +973,32 @@ public:
     /// \param min_ttl_val The minimum TTL value as unsigned 32-bit integer
     /// in the host byte order.
     void setMinTTL(uint32_t min_ttl_val);
+
+    /// \brief Record the size of the memory used by the zone data.
+    ///
+    /// This class doesn't check the value; it's the caller's
+    /// responsibility to give a meaningful one (see \c getMemorySize()).
+    ///
+    /// \throw none
+    /// \param memory_size The size of the memory in bytes.
+    void setMemorySize(size_t memory_size) { memory_size_ = memory_size; }
+
+    /// \brief Record the time it took to load the zone data.
+    ///
+    /// \throw none
+    /// \param load_time The time in microseconds.
+    void setLoadTime(uint64_t load_time) { load_time_ = load_time; }
     //@}
 
 private:
     const boost::interprocess::offset_ptr<ZoneTree> zone_tree_;
     const boost::interprocess::offset_ptr<ZoneNode> origin_node_;
     boost::interprocess::offset_ptr<NSEC3Data> nsec3_data_;
+    ZoneNameIndex name_index_;
+    uint64_t load_time_;
+    size_t memory_size_;
     uint32_t min_ttl_;
+    const bool name_index_enabled_;
 };
 
 } // namespace memory
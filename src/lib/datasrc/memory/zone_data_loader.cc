@@ -22,6 +22,8 @@
 #include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/client.h>
 
+#include <util/memory_segment_local.h>
+
 #include <dns/labelsequence.h>
 #include <dns/master_loader.h>
 #include <dns/rrcollator.h>
@@ -78,8 +80,10 @@ public:
     ZoneDataUpdaterHelper(util::MemorySegment& mem_sgmt,
                          const bundy::dns::RRClass& rrclass,
                          const bundy::dns::Name& zone_name,
-                         ZoneData& zone_data) :
-        updater_(mem_sgmt, rrclass, zone_name, zone_data)
+                         ZoneData& zone_data, bool wire_image,
+                         const ZoneData* base_data = NULL) :
+        updater_(mem_sgmt, rrclass, zone_name, zone_data, wire_image,
+                 base_data)
     {}
 
     void updateFromLoad(const bundy::dns::ConstRRsetPtr& rrset, OP_MODE mode);
@@ -279,11 +283,23 @@ public:
         mem_sgmt_(mem_sgmt), rrclass_(rrclass), zone_name_(zone_name),
         old_data_(old_data),
         old_serial_(old_serial ? new dns::Serial(*old_serial) : NULL),
-        loaded_data_(NULL)
+        loaded_data_(NULL), wire_image_(false), name_index_(false)
     {
         validateOldData(zone_name, old_data);
     }
 
+    // Make the loaded RdataSets hold the wire image.  It must be called
+    // before loading starts.
+    void setWireImage(bool wire_image) {
+        wire_image_ = wire_image;
+    }
+
+    // Make the newly created zone data keep the name index.  It must be
+    // called before loading starts.
+    void setNameIndex(bool name_index) {
+        name_index_ = name_index;
+    }
+
     virtual bool doLoad(size_t count_limit) {
         initUpdate(NULL);
         const bool completed = doLoadCommon(count_limit);
@@ -299,6 +315,8 @@ public:
 
     virtual bool isDataReused() const = 0;
 
+    virtual bool isDataShared() const { return (false); }
+
     ZoneData* getLoadedData() const {
         return (loaded_data_);
     }
@@ -318,7 +336,8 @@ protected:
                 if (zone_data) {
                     holder->set(zone_data);
                 } else {
-                    holder->set(ZoneData::create(mem_sgmt_, zone_name_));
+                    holder->set(ZoneData::create(mem_sgmt_, zone_name_,
+                                                 name_index_));
                 }
                 data_holder_.swap(holder);
                 break;
@@ -334,7 +353,8 @@ protected:
         }
         update_helper_.reset(new ZoneDataUpdaterHelper(mem_sgmt_, rrclass_,
                                                        zone_name_,
-                                                       *data_holder_->get()));
+                                                       *data_holder_->get(),
+                                                       wire_image_));
     }
 
     void finishUpdate();
@@ -350,6 +370,8 @@ protected:
     boost::scoped_ptr<SegmentObjectHolder<ZoneData, RRClass> > data_holder_;
     boost::scoped_ptr<ZoneDataUpdaterHelper> update_helper_;
     ZoneData* loaded_data_;
+    bool wire_image_;
+    bool name_index_;
 };
 
 void
@@ -430,10 +452,10 @@ class MasterFileLoader : public ZoneDataLoader::ZoneDataLoaderImpl {
 public:
     MasterFileLoader(util::MemorySegment& mem_sgmt, const dns::RRClass& rrclass,
                      const dns::Name& zone_name, const std::string& zone_file,
-                     ZoneData* old_data) :
+                     ZoneData* old_data, size_t thread_count) :
         ZoneDataLoader::ZoneDataLoaderImpl(mem_sgmt, rrclass, zone_name,
                                            old_data, NULL),
-        zone_file_(zone_file)
+        zone_file_(zone_file), thread_count_(thread_count)
     {}
     virtual ~MasterFileLoader() {}
     virtual bool isDataReused() const { return (false); }
@@ -464,7 +486,9 @@ protected:
                                   createMasterLoaderCallbacks(zone_name_,
                                                               rrclass_,
                                                               &load_ok_),
-                                  rrcollator_->getCallback()));
+                                  rrcollator_->getCallback(),
+                                  dns::MasterLoader::DEFAULT,
+                                  thread_count_));
     }
 
     virtual bool updateRRsets(size_t count_limit) {
@@ -482,6 +506,7 @@ protected:
 private:
     bool load_ok_; // we actually don't use it; only need a placeholder
     const std::string zone_file_;
+    const size_t thread_count_;
     boost::scoped_ptr<dns::RRCollator> rrcollator_;
     boost::scoped_ptr<dns::MasterLoader> master_loader_;
 };
@@ -549,6 +574,12 @@ protected:
 // modifies the existing zone data, rather than creating a new one and replace
 // it with the old on completion.  So any intermediate failure will invalidate
 // the zone data.
+//
+// In the copy-on-write mode, it instead applies all diffs in load() to a copy
+// of the existing zone data made by ZoneData::createCopy(), which shares the
+// unchanged RdataSets with the existing data.  The existing data are never
+// modified, and any failure only discards the copy.  commit() is then a no-op
+// and installing the new version is a simple replacement of the zone data.
 class JournalLoader : public ZoneDataLoader::ZoneDataLoaderImpl {
 public:
     JournalLoader(util::MemorySegment& mem_sgmt,
@@ -556,23 +587,32 @@ public:
                   ZoneData* old_data, const dns::Serial& old_serial,
                   const dns::Serial& new_serial,
                   ZoneJournalReaderPtr jnl_reader,
-                  const std::string& dsrc_name) :
+                  const std::string& dsrc_name, bool copy_on_write) :
         ZoneDataLoader::ZoneDataLoaderImpl(mem_sgmt, rrclass, zone_name,
                                            old_data, &old_serial),
-        jnl_reader_(jnl_reader)
+        jnl_reader_(jnl_reader), copy_on_write_(copy_on_write)
     {
         LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_LOAD_USE_JOURNAL).
             arg(zone_name_).arg(rrclass_).arg(old_serial.getValue()).
             arg(new_serial.getValue()).arg(dsrc_name);
     }
     virtual ~JournalLoader() {}
-    virtual bool isDataReused() const { return (true); }
+    virtual bool isDataReused() const { return (!copy_on_write_); }
+    virtual bool isDataShared() const { return (copy_on_write_); }
     virtual bool doLoad(size_t) {
         saveDiffs();
-        loaded_data_ = old_data_;
+        if (copy_on_write_) {
+            loadCopy();
+        } else {
+            loaded_data_ = old_data_;
+        }
         return (true);
     }
     virtual ZoneData* commitDiffs(ZoneData* update_data) {
+        if (copy_on_write_) {
+            return (update_data); // the diffs have been applied in load().
+        }
+
         // Constructing SegmentObjectHolder can result in MemorySegmentGrown.
         // This needs to be handled at the caller as update_data could now be
         // invalid.  But before propagating the exception, we should release the
@@ -591,6 +631,21 @@ public:
     }
 
 protected:
+    // For derived classes that provide the diffs by setJournalReader()
+    // before load.
+    JournalLoader(util::MemorySegment& mem_sgmt,
+                  const dns::RRClass& rrclass, const dns::Name& zone_name,
+                  ZoneData* old_data, const dns::Serial* old_serial,
+                  bool copy_on_write) :
+        ZoneDataLoader::ZoneDataLoaderImpl(mem_sgmt, rrclass, zone_name,
+                                           old_data, old_serial),
+        copy_on_write_(copy_on_write)
+    {}
+
+    void setJournalReader(ZoneJournalReaderPtr jnl_reader) {
+        jnl_reader_ = jnl_reader;
+    }
+
     // The installer called for ZoneDataLoader using a zone journal reader.
     // It performs some minimal sanity checks on the sequence of data, but
     // the basic assumption is that any invalid data mean implementation defect
@@ -625,6 +680,52 @@ protected:
     }
 
 private:
+    // Build the new version of the zone data for the copy-on-write mode.
+    void loadCopy() {
+        // The old data can be relocated if the segment grows while we make
+        // and update the copy, so we keep track of it by a named address
+        // (the stored address is valid even if it's relocated on set).
+        mem_sgmt_.setNamedAddress(BASE_DATA_NAME, old_data_);
+        try {
+            while (true) {
+                try {
+                    boost::scoped_ptr<SegmentObjectHolder<ZoneData, RRClass> >
+                        holder(new SegmentObjectHolder<ZoneData, RRClass>
+                               (mem_sgmt_, rrclass_));
+                    holder->set(ZoneData::createCopy(mem_sgmt_,
+                                                     *getBaseData(),
+                                                     rrclass_));
+                    data_holder_.swap(holder);
+                    break;
+                } catch (const util::MemorySegmentGrown&) {}
+            }
+            update_helper_.reset(
+                new ZoneDataUpdaterHelper(mem_sgmt_, rrclass_, zone_name_,
+                                          *data_holder_->get(), wire_image_,
+                                          getBaseData()));
+            doLoadCommon(0);    // must return true
+            finishUpdate();
+        } catch (...) {
+            // Discard the copy, without destroying the data of the old
+            // version.
+            update_helper_.reset();
+            ZoneData* const zone_data =
+                data_holder_ ? data_holder_->release() : NULL;
+            if (zone_data) {
+                zone_data->detachSharedData(*getBaseData());
+                ZoneData::destroy(mem_sgmt_, zone_data, rrclass_);
+            }
+            mem_sgmt_.clearNamedAddress(BASE_DATA_NAME);
+            throw;
+        }
+        mem_sgmt_.clearNamedAddress(BASE_DATA_NAME);
+    }
+
+    const ZoneData* getBaseData() const {
+        return (static_cast<const ZoneData*>(
+                    mem_sgmt_.getNamedAddress(BASE_DATA_NAME).second));
+    }
+
     void saveDiffs() {
         int count = 0;
         ConstRRsetPtr rrset;
@@ -669,6 +770,227 @@ private:
     // dynamic updates).
     static const unsigned int MAX_SAVED_DIFFS_ = 100;
     std::vector<ConstRRsetPtr> saved_diffs_;
+
+    const bool copy_on_write_;
+    static const char* const BASE_DATA_NAME;
+};
+
+const char* const JournalLoader::BASE_DATA_NAME = "journal_loader_base_data";
+
+// A journal reader that simply returns the diffs given on construction.
+// Unlike those of real journals, each diff can contain multiple RDATAs
+// (and RRSIGs), which doesn't matter for JournalLoader.
+class DeltaReader : public ZoneJournalReader {
+public:
+    DeltaReader(const std::vector<ConstRRsetPtr>& diffs) :
+        diffs_(diffs), it_(diffs_.begin())
+    {}
+    virtual ~DeltaReader() {}
+    virtual ConstRRsetPtr getNextDiff() {
+        return (it_ != diffs_.end() ? *it_++ : ConstRRsetPtr());
+    }
+private:
+    const std::vector<ConstRRsetPtr> diffs_;
+    std::vector<ConstRRsetPtr>::const_iterator it_;
+};
+
+// Make a copy of the RRset (with its RRSIGs) of the given RdataSet that
+// doesn't refer to the memory segment.  If the RdataSet only has RRSIGs,
+// the RRSIG RRset is returned.
+ConstRRsetPtr
+copyRRset(const RRClass& rrclass, const ZoneNode* node,
+          const RdataSet* rdataset)
+{
+    const TreeNodeRRset rrset(rrclass, node, rdataset, true);
+    const RRsetPtr rrsig = rrset.getRRsig();
+    if (rrset.getRdataCount() == 0) {
+        return (rrsig);
+    }
+    const RRsetPtr rrset_copy(new RRset(rrset.getName(), rrclass,
+                                        rrset.getType(), rrset.getTTL()));
+    for (RdataIteratorPtr rit = rrset.getRdataIterator(); !rit->isLast();
+         rit->next()) {
+        rrset_copy->addRdata(rit->getCurrent());
+    }
+    if (rrsig) {
+        rrset_copy->addRRsig(rrsig);
+    }
+    return (rrset_copy);
+}
+
+// Zone loader implementation that fully loads the new version of the zone,
+// but only applies its differences from the old data.  It's intended for
+// mapped segments with a source without journal (such as a master file),
+// where a full load would rewrite (and dirty) the whole zone even if only
+// a few names change.
+//
+// The new version is loaded by a usual full loader into a temporary local
+// segment.  Once that's completed, both versions are walked in the DNSSEC
+// order to find the RdataSets that differ, and the differences are
+// converted into a diff sequence as if they were read from a zone journal:
+// the old SOA, the RRsets to be deleted, the new SOA and the RRsets to be
+// added.  The temporary data are then released, and the rest is done by
+// JournalLoader, both for the normal and the copy-on-write modes.
+class DeltaLoader : public JournalLoader {
+public:
+    // Load the new version from the given master file.
+    DeltaLoader(util::MemorySegment& mem_sgmt, const dns::RRClass& rrclass,
+                const dns::Name& zone_name, const std::string& zone_file,
+                ZoneData* old_data, const dns::Serial* old_serial,
+                size_t thread_count, bool copy_on_write) :
+        JournalLoader(mem_sgmt, rrclass, zone_name, old_data, old_serial,
+                      copy_on_write),
+        local_sgmt_(new util::MemorySegmentLocal),
+        full_loader_(new MasterFileLoader(*local_sgmt_, rrclass, zone_name,
+                                          zone_file, NULL, thread_count))
+    {
+        LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_LOAD_DELTA).
+            arg(zone_name_).arg(rrclass_).arg(zone_file);
+    }
+
+    // Load the new version from the given zone iterator of a data source.
+    DeltaLoader(util::MemorySegment& mem_sgmt, const dns::RRClass& rrclass,
+                const dns::Name& zone_name, ZoneIteratorPtr iterator,
+                ZoneData* old_data, const dns::Serial* old_serial,
+                const std::string& dsrc_name, bool copy_on_write) :
+        JournalLoader(mem_sgmt, rrclass, zone_name, old_data, old_serial,
+                      copy_on_write),
+        local_sgmt_(new util::MemorySegmentLocal),
+        full_loader_(new IteratorLoader(*local_sgmt_, rrclass, zone_name,
+                                        iterator, NULL, NULL))
+    {
+        LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_LOAD_DELTA).
+            arg(zone_name_).arg(rrclass_).arg("data source '" + dsrc_name +
+                                              "'");
+    }
+
+    virtual ~DeltaLoader() {}
+
+    virtual bool doLoad(size_t count_limit) {
+        // The RdataSets of both versions must be encoded in the same way
+        // to compare them.  This only matters before loading starts.
+        full_loader_->setWireImage(wire_image_);
+        if (!full_loader_->doLoad(count_limit)) {
+            return (false);
+        }
+
+        std::vector<ConstRRsetPtr> diffs;
+        {
+            SegmentObjectHolder<ZoneData, RRClass> holder(*local_sgmt_,
+                                                          rrclass_);
+            holder.set(full_loader_->getLoadedData());
+            makeDiffs(*holder.get(), diffs);
+        }
+        full_loader_.reset();
+        local_sgmt_.reset();
+
+        setJournalReader(ZoneJournalReaderPtr(new DeltaReader(diffs)));
+        return (JournalLoader::doLoad(0));
+    }
+
+private:
+    void makeDiffs(const ZoneData& new_data,
+                   std::vector<ConstRRsetPtr>& diffs) const
+    {
+        std::vector<ConstRRsetPtr> deletions, additions;
+        diffTrees(&old_data_->getZoneTree(), &new_data.getZoneTree(),
+                  deletions, additions);
+        const NSEC3Data* const old_nsec3_data = old_data_->getNSEC3Data();
+        const NSEC3Data* const new_nsec3_data = new_data.getNSEC3Data();
+        if (old_nsec3_data || new_nsec3_data) {
+            diffTrees(old_nsec3_data ? &old_nsec3_data->getNSEC3Tree() : NULL,
+                      new_nsec3_data ? &new_nsec3_data->getNSEC3Tree() : NULL,
+                      deletions, additions);
+        }
+
+        // The SOA of both versions must exist, as the old one was checked
+        // on construction, and the new one by the full loader.
+        diffs.push_back(copyRRset(rrclass_, old_data_->getOriginNode(),
+                                  RdataSet::find(old_data_->getOriginNode()->
+                                                 getData(), RRType::SOA())));
+        diffs.insert(diffs.end(), deletions.begin(), deletions.end());
+        diffs.push_back(copyRRset(rrclass_, new_data.getOriginNode(),
+                                  RdataSet::find(new_data.getOriginNode()->
+                                                 getData(), RRType::SOA())));
+        diffs.insert(diffs.end(), additions.begin(), additions.end());
+
+        LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_LOAD_DELTA_COMPUTED).
+            arg(zone_name_).arg(rrclass_).arg(deletions.size() + 1).
+            arg(additions.size() + 1);
+    }
+
+    // Walk both trees in parallel from the origin (a NULL tree is
+    // considered empty), and compare the nodes of the same name.
+    void diffTrees(const ZoneTree* old_tree, const ZoneTree* new_tree,
+                   std::vector<ConstRRsetPtr>& deletions,
+                   std::vector<ConstRRsetPtr>& additions) const
+    {
+        ZoneChain old_chain, new_chain;
+        const ZoneNode* old_node = NULL;
+        const ZoneNode* new_node = NULL;
+        if (old_tree) {
+            old_tree->find(zone_name_, &old_node, old_chain);
+        }
+        if (new_tree) {
+            new_tree->find(zone_name_, &new_node, new_chain);
+        }
+        uint8_t old_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+        uint8_t new_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+        while (true) {
+            // Empty nodes don't matter.
+            while (old_node && !old_node->getData()) {
+                old_node = old_tree->nextNode(old_chain);
+            }
+            while (new_node && !new_node->getData()) {
+                new_node = new_tree->nextNode(new_chain);
+            }
+            if (!old_node && !new_node) {
+                break;
+            }
+            const int order =
+                !old_node ? 1 : !new_node ? -1 :
+                old_node->getAbsoluteLabels(old_buf).compare(
+                    new_node->getAbsoluteLabels(new_buf)).getOrder();
+            if (order <= 0) {
+                diffNode(old_node, order == 0 ? new_node : NULL, deletions);
+            }
+            if (order >= 0) {
+                diffNode(new_node, order == 0 ? old_node : NULL, additions);
+            }
+            if (order <= 0) {
+                old_node = old_tree->nextNode(old_chain);
+            }
+            if (order >= 0) {
+                new_node = new_tree->nextNode(new_chain);
+            }
+        }
+    }
+
+    // Append the RdataSets of the node that the other node of the same name
+    // (if any) doesn't have the same.  SOAs are skipped; the diff sequence
+    // can only have those at the origin, which are handled separately (an
+    // SOA at any other name is meaningless, and is left as it was).
+    void diffNode(const ZoneNode* node, const ZoneNode* other_node,
+                  std::vector<ConstRRsetPtr>& result) const
+    {
+        for (const RdataSet* rdataset = node->getData(); rdataset;
+             rdataset = rdataset->getNext()) {
+            if (rdataset->type == RRType::SOA()) {
+                continue;
+            }
+            const RdataSet* other = other_node ?
+                RdataSet::find(other_node->getData(), rdataset->type, true) :
+                NULL;
+            if (!other || !rdataset->hasSameData(*other, rrclass_)) {
+                result.push_back(copyRRset(rrclass_, node, rdataset));
+            }
+        }
+    }
+
+    // The local segment must be destroyed after the full loader, which may
+    // hold data in it.
+    boost::scoped_ptr<util::MemorySegmentLocal> local_sgmt_;
+    boost::scoped_ptr<ZoneDataLoader::ZoneDataLoaderImpl> full_loader_;
 };
 }
 
@@ -676,21 +998,35 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                const dns::RRClass& rrclass,
                                const dns::Name& zone_name,
                                const std::string& zone_file,
-                               ZoneData* old_data) :
+                               ZoneData* old_data, bool wire_image,
+                               bool name_index, size_t thread_count,
+                               bool copy_on_write, bool delta_load) :
     impl_(NULL)                 // defer until logging to avoid leak
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_LOAD_FROM_FILE).
         arg(zone_name).arg(rrclass).arg(zone_file);
 
-    impl_ = new MasterFileLoader(mem_sgmt, rrclass, zone_name, zone_file,
-                                 old_data);
+    // The differences can only be applied to old data that have an SOA.
+    const boost::scoped_ptr<const dns::Serial> old_serial(
+        delta_load ? getSerialFromZoneData(rrclass, old_data) : NULL);
+    if (old_serial) {
+        impl_ = new DeltaLoader(mem_sgmt, rrclass, zone_name, zone_file,
+                                old_data, NULL, thread_count, copy_on_write);
+    } else {
+        impl_ = new MasterFileLoader(mem_sgmt, rrclass, zone_name, zone_file,
+                                     old_data, thread_count);
+    }
+    impl_->setWireImage(wire_image);
+    impl_->setNameIndex(name_index);
 }
 
 ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                const dns::RRClass& rrclass,
                                const dns::Name& zone_name,
                                const DataSourceClient& datasrc_client,
-                               ZoneData* old_data) :
+                               ZoneData* old_data, bool wire_image,
+                               bool name_index, bool copy_on_write,
+                               bool delta_load) :
     impl_(NULL)
 {
     const std::string& dsrc_name = datasrc_client.getDataSourceName();
@@ -720,6 +1056,8 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
     if (old_serial && (*old_serial == *new_serial)) {
         impl_ = new ReuseLoader(mem_sgmt, rrclass, zone_name, old_data,
                                 *old_serial, dsrc_name);
+        impl_->setWireImage(wire_image);
+        impl_->setNameIndex(name_index);
         return;
     } else if (old_serial && (*old_serial < *new_serial)) {
         try {
@@ -730,7 +1068,9 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                 impl_ = new JournalLoader(mem_sgmt, rrclass, zone_name,
                                           old_data, *old_serial,
                                           *new_serial, result.second,
-                                          dsrc_name);
+                                          dsrc_name, copy_on_write);
+                impl_->setWireImage(wire_image);
+                impl_->setNameIndex(name_index);
                 return;
             }
         } catch (const bundy::NotImplemented&) {
@@ -738,8 +1078,16 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
             // serials.
         }
     }
-    impl_ = new IteratorLoader(mem_sgmt, rrclass, zone_name, iterator,
-                               old_data, old_serial.get());
+    if (old_serial && delta_load) {
+        impl_ = new DeltaLoader(mem_sgmt, rrclass, zone_name, iterator,
+                                old_data, old_serial.get(), dsrc_name,
+                                copy_on_write);
+    } else {
+        impl_ = new IteratorLoader(mem_sgmt, rrclass, zone_name, iterator,
+                                   old_data, old_serial.get());
+    }
+    impl_->setWireImage(wire_image);
+    impl_->setNameIndex(name_index);
 }
 
 ZoneDataLoader::~ZoneDataLoader() {
@@ -751,6 +1099,11 @@ ZoneDataLoader::isDataReused() const {
     return (impl_->isDataReused());
 }
 
+bool
+ZoneDataLoader::isDataShared() const {
+    return (impl_->isDataShared());
+}
+
 bool
 ZoneDataLoader::loadIncremental(size_t count_limit) {
     return (impl_->doLoad(count_limit));
@@ -52,17 +52,45 @@ public:
 
     /// \brief Constructor for loading from a file.
     ///
+    /// If \c old_data is given and \c delta_load is true, the loader only
+    /// applies the differences between \c old_data and the new version
+    /// of the zone, so the unchanged part of \c old_data is neither
+    /// rewritten nor reallocated.  This is useful if \c mem_sgmt is a
+    /// mapped segment, where the whole zone would otherwise be written to
+    /// the mapped file.  To find the differences, the new version is first
+    /// fully loaded into a temporary local segment, so the load needs more
+    /// time and (temporary) memory than a full load.  The differences are
+    /// applied like those from a zone journal (see the other constructor),
+    /// either to \c old_data in place in \c commit(), or to a copy of it
+    /// if \c copy_on_write is true.  \c copy_on_write doesn't matter
+    /// unless the differences are applied.
+    ///
     /// \param mem_sgmt The memory segment.
     /// \param rrclass The RRClass.
     /// \param zone_name The name of the zone that is being loaded.
     /// \param zone_file Filename which contains the zone data for \c zone_name.
     /// \param old_data If non-NULL, zone data currently being used.  Also
     /// in that case, its origin name must be equal to \c zone_name.
+    /// \param wire_image If true, the loaded RdataSets hold the wire image
+    /// of the data (see \c RdataSet).
+    /// \param name_index If true, newly created zone data keep the hash
+    /// index of the names (see \c ZoneData::create()).
+    /// \param thread_count The number of threads to parse the file with
+    /// (see \c dns::MasterLoader).
+    /// \param copy_on_write Whether to apply the differences to a copy of
+    /// \c old_data.
+    /// \param delta_load Whether to apply only the differences from
+    /// \c old_data.
     ZoneDataLoader(util::MemorySegment& mem_sgmt,
                    const dns::RRClass& rrclass,
                    const dns::Name& zone_name,
                    const std::string& zone_file,
-                   ZoneData* old_data = NULL);
+                   ZoneData* old_data = NULL,
+                   bool wire_image = false,
+                   bool name_index = false,
+                   size_t thread_count = 1,
+                   bool copy_on_write = false,
+                   bool delta_load = false);
 
     /// \brief Constructor for loading from a given data source.
     ///
@@ -71,13 +99,35 @@ public:
     /// the constructed \c ZoneDataLoader is used.  This should be the case
     /// in the main usage, but test code could easily break the assumption.
     ///
+    /// If \c old_data is given and the data source has the journal of the
+    /// differences from its version, the loader only applies the
+    /// differences.  By default, they are applied to \c old_data in place
+    /// in \c commit().  If \c copy_on_write is true, they are instead
+    /// applied in \c load() to a copy of \c old_data that shares the
+    /// unchanged data with it (see \c ZoneData::createCopy()), so
+    /// \c old_data are kept intact and can still be used until the new
+    /// version replaces them (see \c isDataShared()).
+    ///
+    /// If \c old_data is given but the data source has no journal for
+    /// them, the whole zone is loaded, unless \c delta_load is true, in
+    /// which case only the differences are applied as described for the
+    /// other constructor.
+    ///
     /// \param datasrc_client A client for the data source from which new
     /// zone data should be loaded.
+    /// \param copy_on_write Whether to apply the differences to a copy of
+    /// \c old_data.
+    /// \param delta_load Whether to apply only the differences from
+    /// \c old_data if there's no journal for them.
     ZoneDataLoader(util::MemorySegment& mem_sgmt,
                    const dns::RRClass& rrclass,
                    const dns::Name& zone_name,
                    const DataSourceClient& datasrc_client,
-                   ZoneData* old_data = NULL);
+                   ZoneData* old_data = NULL,
+                   bool wire_image = false,
+                   bool name_index = false,
+                   bool copy_on_write = false,
+                   bool delta_load = false);
 
     /// Destructor.
     virtual ~ZoneDataLoader();
@@ -95,6 +145,21 @@ public:
     /// otherwise false.
     virtual bool isDataReused() const;
 
+    /// \brief Return whether the loaded ZoneData share some of the data
+    /// with the ZoneData passed on construction.
+    ///
+    /// If this method returns true, the loaded data and the passed data
+    /// must not simply be destroyed while the other is used; the one to
+    /// be destroyed must first be detached from the other by
+    /// \c ZoneData::detachSharedData().  Like \c isDataReused(), this is
+    /// determined at the time of construction.
+    ///
+    /// \throw None
+    ///
+    /// \return true if the loaded data share data with the passed data;
+    /// otherwise false.
+    virtual bool isDataShared() const;
+
     /// \brief Create and return a ZoneData instance populated from the
     /// source passed on construction.
     ///
@@ -17,6 +17,7 @@
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/memory/logger.h>
 #include <datasrc/memory/util_internal.h>
+#include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/zone.h>
 
 #include <dns/rdataclass.h>
@@ -32,6 +33,7 @@ namespace datasrc {
 namespace memory {
 
 using detail::getCoveredType;
+using detail::SegmentObjectHolder;
 
 void
 ZoneDataUpdater::addWildcards(const Name& name) {
@@ -239,9 +241,29 @@ ZoneDataUpdater::setupNSEC3(const ConstRRsetPtr rrset) {
     } else {
         const NSEC3Hash* hash = getNSEC3Hash();
         if (!hash->match(nsec3_rdata)) {
-            bundy_throw(AddError,
-                      rrset->getType() << " with inconsistent parameters: "
-                      << rrset->toText());
+            // The parameters can still change if all NSEC3 RRs and the
+            // NSEC3PARAM of the old ones have been removed, as in a diff
+            // sequence changing the parameters.  Then we replace the NSEC3
+            // data.  Note that a just added NSEC3PARAM is at the origin.
+            const RdataSet* nsec3param_rdataset =
+                RdataSet::find(zone_data_->getOriginNode()->getData(),
+                               RRType::NSEC3PARAM());
+            const size_t nsec3param_count =
+                nsec3param_rdataset ? nsec3param_rdataset->getRdataCount() : 0;
+            if (!nsec3_data->isEmpty() ||
+                nsec3param_count !=
+                (rrset->getType() == RRType::NSEC3PARAM() ? 1 : 0)) {
+                bundy_throw(AddError,
+                            rrset->getType() << " with inconsistent "
+                            "parameters: " << rrset->toText());
+            }
+            NSEC3Data* const new_nsec3_data =
+                NSEC3Data::create(mem_sgmt_, zone_name_, nsec3_rdata);
+            NSEC3Data::destroy(mem_sgmt_,
+                               zone_data_->setNSEC3Data(new_nsec3_data),
+                               rrclass_);
+            delete hash_;
+            hash_ = NULL;
         }
     }
 }
@@ -269,12 +291,13 @@ ZoneDataUpdater::addNSEC3(const Name& name, const ConstRRsetPtr& rrset,
 
     ZoneNode* node;
     nsec3_data->insertName(mem_sgmt_, name, &node);
+    unshareRdataSets(node, true);
 
     // Create a new RdataSet, merging any existing NSEC3 data for this
     // name.
     RdataSet* old_rdataset = node->getData();
     RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, rrset, rrsig,
-                                          old_rdataset);
+                                          old_rdataset, wire_image_);
     old_rdataset = node->setData(rdataset);
     if (old_rdataset != NULL) {
         RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
@@ -291,6 +314,7 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
     } else {
         ZoneNode* node;
         zone_data_->insertName(mem_sgmt_, name, &node);
+        unshareRdataSets(node, false);
 
         RdataSet* rdataset_head = node->getData();
 
@@ -306,7 +330,8 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
         // type.
         RdataSet* old_rdataset = RdataSet::find(rdataset_head, rrtype, true);
         RdataSet* rdataset_new = RdataSet::create(mem_sgmt_, encoder_,
-                                                  rrset, rrsig, old_rdataset);
+                                                  rrset, rrsig, old_rdataset,
+                                                  wire_image_);
         if (old_rdataset == NULL) {
             // There is no existing RdataSet. Prepend the new RdataSet
             // to the list.
@@ -340,10 +365,10 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
         // indicating the need for callback in find().  Note that we do this
         // only when non RRSIG RRset of that type is added.
         if (rrset && rrtype == RRType::NS() && !is_origin) {
-            node->setFlag(ZoneNode::FLAG_CALLBACK);
+            zone_data_->setDelegation(node);
             // If it is DNAME, we have a callback as well here
         } else if (rrset && rrtype == RRType::DNAME()) {
-            node->setFlag(ZoneNode::FLAG_CALLBACK);
+            zone_data_->setDelegation(node);
         }
 
         // If we've added NSEC3PARAM at zone origin, set up NSEC3
@@ -372,6 +397,70 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
     }
 }
 
+void
+ZoneDataUpdater::unshareRdataSets(ZoneNode* node, bool nsec3) {
+    if (!base_data_ || node->isEmpty()) {
+        return;
+    }
+    const ZoneTree* base_tree = &base_data_->getZoneTree();
+    if (nsec3) {
+        const NSEC3Data* const base_nsec3_data = base_data_->getNSEC3Data();
+        if (!base_nsec3_data) {
+            return;
+        }
+        base_tree = &base_nsec3_data->getNSEC3Tree();
+    }
+
+    // The data are shared iff the node of the same name in the base data
+    // has the identical list of RdataSets.
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const ZoneNode* base_node = NULL;
+    ZoneChain node_path;
+    if (base_tree->find<void*>(node->getAbsoluteLabels(labels_buf),
+                               &base_node, node_path, NULL, NULL) !=
+        ZoneTree::EXACTMATCH || base_node->getData() != node->getData()) {
+        return;
+    }
+
+    // Copy the entire list.  The copies are linked in the same order as
+    // the original, and we only keep the head in the holder; the links
+    // are still valid after relocation.
+    SegmentObjectHolder<RdataSet, RRClass> holder(mem_sgmt_, rrclass_);
+    try {
+        RdataSet* tail = NULL;
+        for (const RdataSet* cur = node->getData();
+             cur != NULL;
+             cur = cur->getNext()) {
+            RdataSet* const rdataset = RdataSet::copy(mem_sgmt_, *cur,
+                                                      rrclass_);
+            if (tail == NULL) {
+                holder.set(rdataset);
+            } else {
+                tail->next = rdataset;
+            }
+            tail = rdataset;
+        }
+    } catch (...) {
+        RdataSet* next;
+        for (RdataSet* cur = holder.release(); cur != NULL; cur = next) {
+            next = cur->getNext();
+            RdataSet::destroy(mem_sgmt_, cur, rrclass_);
+        }
+        throw;
+    }
+    node->setData(holder.release());
+}
+
+void
+ZoneDataUpdater::updateDataAddresses() {
+    zone_data_ = static_cast<ZoneData*>(
+        mem_sgmt_.getNamedAddress("updater_zone_data").second);
+    if (base_data_) {
+        base_data_ = static_cast<const ZoneData*>(
+            mem_sgmt_.getNamedAddress("updater_base_data").second);
+    }
+}
+
 void
 ZoneDataUpdater::addInternal(const bundy::dns::Name& name,
                              const bundy::dns::RRType& rrtype,
@@ -425,9 +514,7 @@ ZoneDataUpdater::add(const ConstRRsetPtr& rrset,
         } catch (const bundy::util::MemorySegmentGrown&) {
             // The segment has grown. So, we update the base pointer (because
             // the data may have been remapped somewhere else in the process).
-            zone_data_ =
-                static_cast<ZoneData*>(
-                    mem_sgmt_.getNamedAddress("updater_zone_data").second);
+            updateDataAddresses();
         }
         // Retry if it didn't add due to the growth
     } while (!added);
@@ -445,6 +532,7 @@ ZoneDataUpdater::removeInternal(const bundy::dns::Name& name,
         bundy_throw(RemoveError, "can't find name for RR to be removed: " <<
                     name << "/" << rrtype);
     }
+    unshareRdataSets(node, false);
     RdataSet* cur = node->getData();
     RdataSet* prev = NULL;
     for (; cur && cur->type != rrtype; prev = cur, cur = cur->getNext()) {
@@ -458,7 +546,8 @@ ZoneDataUpdater::removeInternal(const bundy::dns::Name& name,
 
     RdataSet* const new_rdataset = RdataSet::subtract(mem_sgmt_, encoder_,
                                                       rrset, sig_rrset,
-                                                      *old_rdataset);
+                                                      *old_rdataset,
+                                                      wire_image_);
     if (new_rdataset) {
         new_rdataset->next = cur->getNext();
     }
@@ -491,6 +580,7 @@ ZoneDataUpdater::removeNSEC3(const Name& name, const ConstRRsetPtr& rrset,
         bundy_throw(RemoveError, "removing NSEC3 RR for " << name <<
                     " but the name doesn't exist in the zone");
     }
+    unshareRdataSets(node, true);
 
     RdataSet* const old_rdataset = node->getData();
     if (!old_rdataset || old_rdataset->getNext()) {
@@ -503,7 +593,8 @@ ZoneDataUpdater::removeNSEC3(const Name& name, const ConstRRsetPtr& rrset,
     }
     RdataSet* const new_rdataset = RdataSet::subtract(mem_sgmt_, encoder_,
                                                       rrset, sig_rrset,
-                                                      *old_rdataset);
+                                                      *old_rdataset,
+                                                      wire_image_);
     node->setData(new_rdataset);
     RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
 
@@ -548,8 +639,7 @@ ZoneDataUpdater::remove(const ConstRRsetPtr& rrset,
             }
             break;
         } catch (const bundy::util::MemorySegmentGrown&) {
-            zone_data_ = static_cast<ZoneData*>(
-                mem_sgmt_.getNamedAddress("updater_zone_data").second);
+            updateDataAddresses();
         }
     }
 }
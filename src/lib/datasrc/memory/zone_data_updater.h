@@ -63,18 +63,29 @@ public:
     ///                  added.
     /// \param zone_data The ZoneData object which is populated with
     ///                  record data.
+    /// \param wire_image If true, the RdataSets created by the updater
+    ///                  hold the wire image of the data (see \c RdataSet).
+    /// \param base_data If non NULL, \c zone_data is a copy of it made by
+    ///                  \c ZoneData::createCopy() (possibly with some
+    ///                  updates).  In that case, any \c RdataSet shared with
+    ///                  \c base_data is copied before the updater modifies
+    ///                  it, so \c base_data is never modified.
     /// \throw InvalidOperation if there's already a zone data updater
     ///    on the given memory segment. Currently, at most one zone data
     ///    updater may exist on the same memory segment.
     ZoneDataUpdater(util::MemorySegment& mem_sgmt,
                     const bundy::dns::RRClass& rrclass,
                     const bundy::dns::Name& zone_name,
-                    ZoneData& zone_data) :
+                    ZoneData& zone_data,
+                    bool wire_image = false,
+                    const ZoneData* base_data = NULL) :
        mem_sgmt_(mem_sgmt),
        rrclass_(rrclass),
        zone_name_(zone_name),
        hash_(NULL),
-       zone_data_(&zone_data)
+       zone_data_(&zone_data),
+       base_data_(base_data),
+       wire_image_(wire_image)
     {
         if (mem_sgmt_.getNamedAddress("updater_zone_data").first) {
             bundy_throw(bundy::InvalidOperation,
@@ -87,12 +98,26 @@ public:
                 static_cast<ZoneData*>(mem_sgmt_.getNamedAddress(
                                            "updater_zone_data").second);
         }
+        if (base_data_ &&
+            mem_sgmt_.setNamedAddress("updater_base_data",
+                                      const_cast<ZoneData*>(base_data_))) {
+            // Both data might have relocated during the set
+            zone_data_ =
+                static_cast<ZoneData*>(mem_sgmt_.getNamedAddress(
+                                           "updater_zone_data").second);
+            base_data_ =
+                static_cast<const ZoneData*>(mem_sgmt_.getNamedAddress(
+                                                 "updater_base_data").second);
+        }
         assert(zone_data_);
     }
 
     /// The destructor.
     ~ZoneDataUpdater() {
         mem_sgmt_.clearNamedAddress("updater_zone_data");
+        if (base_data_) {
+            mem_sgmt_.clearNamedAddress("updater_base_data");
+        }
         delete hash_;
     }
 
@@ -250,12 +275,23 @@ private:
                      const bundy::dns::ConstRRsetPtr& rrset,
                      const bundy::dns::ConstRRsetPtr& rrsig);
 
+    // If the RdataSets of the given node (of the NSEC3 name space if
+    // nsec3 is true) are shared with the base data, replace them with
+    // copies so they can be modified.  It either replaces all of them or
+    // nothing (on exception).
+    void unshareRdataSets(ZoneNode* node, bool nsec3);
+
+    // Update the addresses of the zone data after the segment has grown.
+    void updateDataAddresses();
+
     util::MemorySegment& mem_sgmt_;
     const bundy::dns::RRClass rrclass_;
     const bundy::dns::Name& zone_name_;
     RdataEncoder encoder_;
     const bundy::dns::NSEC3Hash* hash_;
     ZoneData* zone_data_;
+    const ZoneData* base_data_;
+    const bool wire_image_;
 };
 
 } // namespace memory
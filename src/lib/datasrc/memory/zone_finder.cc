@@ -16,6 +16,7 @@
 #include <datasrc/memory/domaintree.h>
 #include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/memory/rdata_serialization.h>
+#include <datasrc/memory/nsec3_hash_cache.h>
 
 #include <datasrc/zone_finder.h>
 #include <datasrc/exceptions.h>
@@ -29,7 +30,9 @@
 #include <datasrc/memory/logger.h>
 
 #include <util/buffer.h>
+#include <util/object_pool.h>
 
+#include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
 
@@ -41,6 +44,7 @@
 using namespace bundy::dns;
 using namespace bundy::datasrc::memory;
 using namespace bundy::datasrc;
+using bundy::util::PoolAllocator;
 
 namespace bundy {
 namespace datasrc {
@@ -105,6 +109,9 @@ typedef std::pair<const ZoneNode*, const RdataSet*> ConstNodeRRset;
 ///                 (e.g. for wildcard substitution)
 ///
 /// Returns an empty TreeNodeRRsetPtr if node is NULL or if rdataset is NULL.
+///
+/// The RRsets are usually short-lived (e.g. for a single query), so they are
+/// allocated from the object pool.
 TreeNodeRRsetPtr
 createTreeNodeRRset(const ZoneNode* node,
                     const RdataSet* rdataset,
@@ -116,16 +123,18 @@ createTreeNodeRRset(const ZoneNode* node,
     const bool dnssec = ((options & ZoneFinder::FIND_DNSSEC) != 0);
     if (node && rdataset) {
         if (realname) {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(*realname, rrclass,
-                                                       node, rdataset,
-                                                       dnssec)));
+            return (boost::allocate_shared<TreeNodeRRset>(
+                        PoolAllocator<TreeNodeRRset>(), *realname, rrclass,
+                        node, rdataset, dnssec));
         } else if (ttl_data) {
             assert(!realname);  // these two cases should be mixed in our use
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec, ttl_data)));
+            return (boost::allocate_shared<TreeNodeRRset>(
+                        PoolAllocator<TreeNodeRRset>(), rrclass, node,
+                        rdataset, dnssec, ttl_data));
         } else {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec)));
+            return (boost::allocate_shared<TreeNodeRRset>(
+                        PoolAllocator<TreeNodeRRset>(), rrclass, node,
+                        rdataset, dnssec));
         }
     } else {
         return (TreeNodeRRsetPtr());
@@ -475,7 +484,18 @@ FindNodeResult findNode(const ZoneData& zone_data,
                         ZoneFinder::FindOptions options,
                         bool out_of_zone_ok = false)
 {
-    const ZoneNode* node = NULL;
+    // If the zone data have the name index, try it first.  If the name is
+    // found and there's no zone cut above it, it's an exact match, and the
+    // tree search would result in the same node without calling back.
+    // Empty nodes need node_path to find the NSEC, so we don't bother to
+    // shortcut them.
+    const ZoneNode* node = zone_data.findIndexedName(name_labels);
+    if (node != NULL && !node->isEmpty() &&
+        node->getFlag(ZoneData::NO_DELEGATION_ABOVE)) {
+        return (FindNodeResult(ZoneFinder::SUCCESS, node, NULL));
+    }
+
+    node = NULL;
     FindState state((options & ZoneFinder::FIND_GLUE_OK) != 0);
 
     const ZoneTree& tree(zone_data.getZoneTree());
@@ -972,11 +992,31 @@ InMemoryZoneFinder::findNSEC3(const bundy::dns::Name& name, bool recursive) {
                   origin_ls << "/" << getClass());
     }
 
-    const boost::scoped_ptr<NSEC3Hash> hash
-        (NSEC3Hash::create(nsec3_data->hashalg,
-                           nsec3_data->iterations,
-                           nsec3_data->getSaltData(),
-                           nsec3_data->getSaltLen()));
+    // Calculate the hashes of all names we may examine together: only the
+    // query name in the non recursive mode, and all names from the query
+    // name to the origin name otherwise.  Most of them are needed in the
+    // latter case, and calculating them together is not much more expensive
+    // than calculating one of them.
+    std::vector<LabelSequence> hash_names;
+    for (LabelSequence ls(name_ls); ls.getLabelCount() >= olabels;
+         ls.stripLeft(1)) {
+        hash_names.push_back(ls);
+        if (!recursive || ls.getLabelCount() == 1) {
+            break;
+        }
+    }
+    std::vector<std::string> hlabels;
+    if (nsec3_caches_ != NULL) {
+        nsec3_caches_->getCache(origin_ls, *nsec3_data)->
+            calculate(hash_names, hlabels);
+    } else {
+        const boost::scoped_ptr<NSEC3Hash> hash
+            (NSEC3Hash::create(nsec3_data->hashalg,
+                               nsec3_data->iterations,
+                               nsec3_data->getSaltData(),
+                               nsec3_data->getSaltLen()));
+        hash->calculateBatch(hash_names, hlabels);
+    }
 
     // Examine all names from the query name to the origin name, stripping
     // the deepest label one by one, until we find a name that has a matching
@@ -984,7 +1024,7 @@ InMemoryZoneFinder::findNSEC3(const bundy::dns::Name& name, bool recursive) {
     for (unsigned int labels = qlabels; labels >= olabels;
          --labels, name_ls.stripLeft(1))
     {
-        const std::string hlabel = hash->calculate(name_ls);
+        const std::string& hlabel = hlabels[qlabels - labels];
 
         LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_FINDNSEC3_TRYHASH).
             arg(name).arg(labels).arg(hlabel);
@@ -33,6 +33,8 @@ namespace internal {
 class ZoneFinderResultContext;
 }
 
+class NSEC3HashCacheTable;
+
 /// A derived zone finder class intended to be used with the memory data
 /// source, using ZoneData for its contents.
 class InMemoryZoneFinder : boost::noncopyable, public ZoneFinder {
@@ -46,12 +48,20 @@ public:
     /// by some construction to pull TreeNodeRRsets from a pool, but
     /// currently, these are created dynamically with the given RRclass
     ///
+    /// If \c nsec3_caches is non NULL, \c findNSEC3() uses and updates the
+    /// NSEC3 hash cache of the zone in it; otherwise all NSEC3 hashes are
+    /// calculated for each call.  It must be valid while the finder is used.
+    ///
     /// \param zone_data The ZoneData containing the zone.
     /// \param rrclass The RR class of the zone
+    /// \param nsec3_caches The NSEC3 hash caches shared with other finders,
+    /// or NULL.
     InMemoryZoneFinder(const ZoneData& zone_data,
-                       const bundy::dns::RRClass& rrclass) :
+                       const bundy::dns::RRClass& rrclass,
+                       NSEC3HashCacheTable* nsec3_caches = NULL) :
         zone_data_(zone_data),
-        rrclass_(rrclass)
+        rrclass_(rrclass),
+        nsec3_caches_(nsec3_caches)
     {}
 
     /// \brief Find an RRset in the datasource
@@ -111,6 +121,7 @@ private:
 
     const ZoneData& zone_data_;
     const bundy::dns::RRClass rrclass_;
+    NSEC3HashCacheTable* const nsec3_caches_;
 };
 
 } // namespace memory
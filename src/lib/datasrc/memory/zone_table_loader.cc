@@ -0,0 +1,291 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/zone_table_loader.h>
+#include <datasrc/memory/logger.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_writer.h>
+#include <datasrc/memory/segment_object_holder.h>
+#include <datasrc/memory/util_internal.h>
+
+#include <datasrc/exceptions.h>
+
+#include <util/memory_segment_local.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+
+#include <stdint.h>
+
+using bundy::util::MemorySegmentLocal;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+namespace {
+// The outcome of loading a zone in a worker thread of the parallel mode.
+struct LoadedZone {
+    LoadedZone() :
+        result(ZoneTableLoader::SUCCESS), zone_data(NULL), retry(true)
+    {}
+    ZoneTableLoader::Result result;
+    ZoneData* zone_data;
+    std::string error_msg;
+    // If true, the zone failed with an unexpected exception, and needs to
+    // be loaded again in the main thread.
+    bool retry;
+};
+
+typedef boost::shared_ptr<MemorySegmentLocal> SegmentPtr;
+typedef boost::shared_ptr<Thread> ThreadPtr;
+}
+
+// The state shared by the worker threads of the parallel mode.
+struct ZoneTableLoader::ParallelState {
+    ParallelState(const std::vector<ZoneInfo>& zones) :
+        zones_(zones), loaded_(zones.size()), next_(0)
+    {}
+
+    // The main function of a worker thread.  It keeps loading the next
+    // zone into the given segment, until all zones are taken.
+    void run(MemorySegmentLocal* mem_sgmt) {
+        size_t i;
+        while (getNext(&i)) {
+            LoadedZone& loaded = loaded_[i];
+            try {
+                // Record the memory and time used for the zone, as
+                // ZoneWriter does in the sequential mode.
+                uint64_t load_time = 0;
+                const size_t start_size = mem_sgmt->getAllocatedSize();
+                {
+                    const detail::LoadTimer timer(load_time);
+                    const boost::scoped_ptr<ZoneDataLoader> loader(
+                        zones_[i].loader_creator_(*mem_sgmt, NULL));
+                    loaded.zone_data = loader->load();
+                }
+                loaded.zone_data->setMemorySize(
+                    detail::adjustMemorySize(0, start_size,
+                                             mem_sgmt->getAllocatedSize()));
+                loaded.zone_data->setLoadTime(load_time);
+                loaded.result = SUCCESS;
+            } catch (const ZoneLoaderException& ex) {
+                loaded.result = LOAD_ERROR;
+                loaded.error_msg = ex.what();
+            } catch (const NoSuchZone&) {
+                loaded.result = NOT_FOUND;
+            } catch (...) {
+                continue;       // leave it to the main thread
+            }
+            loaded.retry = false;
+        }
+    }
+
+    bool getNext(size_t* i) {
+        const Mutex::Locker locker(mutex_);
+        if (next_ == zones_.size()) {
+            return (false);
+        }
+        *i = next_++;
+        return (true);
+    }
+
+    const std::vector<ZoneInfo>& zones_;
+    std::vector<LoadedZone> loaded_;
+    Mutex mutex_;
+    size_t next_;             // protected by mutex_
+};
+
+ZoneTableLoader::ZoneTableLoader(ZoneTableSegment& segment,
+                                 const dns::RRClass& rrclass,
+                                 size_t thread_count) :
+    segment_(segment), rrclass_(rrclass), thread_count_(thread_count)
+{
+    if (!segment.isWritable()) {
+        bundy_throw(bundy::InvalidOperation,
+                    "Attempt to construct ZoneTableLoader for a read-only "
+                    "segment");
+    }
+    if (thread_count == 0) {
+        bundy_throw(bundy::InvalidParameter,
+                    "ZoneTableLoader needs at least one thread");
+    }
+}
+
+void
+ZoneTableLoader::add(const dns::Name& zone_name,
+                     const ZoneDataLoaderCreator& loader_creator)
+{
+    zones_.push_back(ZoneInfo(zone_name, loader_creator));
+}
+
+size_t
+ZoneTableLoader::getWorkerCount(size_t zone_count) const {
+    // The parallel mode is only possible for the local segment, whose memory
+    // can be allocated from separate MemorySegmentLocal objects.
+    if (!dynamic_cast<MemorySegmentLocal*>(&segment_.getMemorySegment())) {
+        return (1);
+    }
+    return (std::max<size_t>(std::min(thread_count_, zone_count), 1));
+}
+
+void
+ZoneTableLoader::load(const ResultCallback& callback) {
+    const size_t thread_count = getWorkerCount(zones_.size());
+    MemorySegmentLocal* const local_sgmt =
+        dynamic_cast<MemorySegmentLocal*>(&segment_.getMemorySegment());
+    try {
+        if (thread_count > 1) {
+            loadParallel(*local_sgmt, thread_count, callback);
+        } else {
+            loadSequential(callback);
+        }
+    } catch (...) {
+        zones_.clear();
+        throw;
+    }
+    zones_.clear();
+}
+
+ZoneTableLoader::Result
+ZoneTableLoader::loadZone(const ZoneInfo& zone, std::string& error_msg) {
+    try {
+        // For the initial load, we let the writer handle loading error and
+        // install an empty zone in the table.
+        ZoneWriter writer(segment_, zone.loader_creator_, zone.zone_name_,
+                          rrclass_, true);
+        writer.load(0, &error_msg);
+        writer.install();
+        writer.cleanup();
+    } catch (const NoSuchZone&) {
+        return (NOT_FOUND);
+    }
+    return (error_msg.empty() ? SUCCESS : LOAD_ERROR);
+}
+
+void
+ZoneTableLoader::loadSequential(const ResultCallback& callback) {
+    std::vector<ZoneInfo>::const_iterator it;
+    for (it = zones_.begin(); it != zones_.end(); ++it) {
+        std::string error_msg;
+        const Result result = loadZone(*it, error_msg);
+        if (callback) {
+            callback(it->zone_name_, result, error_msg);
+        }
+    }
+}
+
+void
+ZoneTableLoader::installZone(const dns::Name& zone_name,
+                             ZoneData* zone_data)
+{
+    // This is only used for the local segment, so we don't have to care
+    // about MemorySegmentGrown.
+    util::MemorySegment& mem_sgmt = segment_.getMemorySegment();
+    detail::SegmentObjectHolder<ZoneData, dns::RRClass> holder(mem_sgmt,
+                                                               rrclass_);
+    holder.set(zone_data);
+    ZoneTable* const table = segment_.getHeader().getTable();
+    const ZoneTable::AddResult result(
+        zone_data ? table->addZone(mem_sgmt, zone_name, zone_data) :
+        table->addEmptyZone(mem_sgmt, zone_name));
+    // The holder now destroys the replaced data, if any.
+    holder.set(result.zone_data);
+}
+
+void
+ZoneTableLoader::loadParallel(MemorySegmentLocal& table_sgmt,
+                              size_t thread_count,
+                              const ResultCallback& callback)
+{
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_LOAD_PARALLEL).
+        arg(zones_.size()).arg(rrclass_).arg(thread_count);
+
+    ParallelState state(zones_);
+    std::vector<SegmentPtr> segments;
+    std::vector<ThreadPtr> threads;
+    try {
+        for (size_t i = 0; i < thread_count; ++i) {
+            segments.push_back(SegmentPtr(new MemorySegmentLocal));
+            threads.push_back(ThreadPtr(
+                                  new Thread(boost::bind(
+                                                 &ParallelState::run, &state,
+                                                 segments.back().get()))));
+        }
+    } catch (...) {
+        // Failed to start a thread.  Let the others complete and
+        // clean up below.
+    }
+    std::vector<ThreadPtr>::iterator thread_it;
+    for (thread_it = threads.begin(); thread_it != threads.end();
+         ++thread_it) {
+        try {
+            (*thread_it)->wait();
+        } catch (...) {
+            // The thread died unexpectedly.  The zone it was loading will
+            // be retried below.
+        }
+    }
+    std::vector<SegmentPtr>::iterator segment_it;
+    for (segment_it = segments.begin(); segment_it != segments.end();
+         ++segment_it) {
+        table_sgmt.merge(**segment_it);
+    }
+
+    // Install the loaded zones in the order they were added.  Zones left
+    // unloaded due to an unexpected error (or failure in starting threads)
+    // are loaded here again, and if the error happens again the loaded
+    // data of the rest of the zones are destroyed.
+    size_t i = 0;
+    try {
+        for (; i < zones_.size(); ++i) {
+            LoadedZone& loaded = state.loaded_[i];
+            std::string error_msg;
+            Result result = loaded.result;
+            if (loaded.retry) {
+                result = loadZone(zones_[i], error_msg);
+            } else if (result != NOT_FOUND) {
+                ZoneData* const zone_data = loaded.zone_data;
+                loaded.zone_data = NULL;
+                installZone(zones_[i].zone_name_, zone_data);
+                error_msg = loaded.error_msg;
+            }
+            if (callback) {
+                callback(zones_[i].zone_name_, result, error_msg);
+            }
+        }
+    } catch (...) {
+        for (; i < zones_.size(); ++i) {
+            if (state.loaded_[i].zone_data) {
+                ZoneData::destroy(table_sgmt, state.loaded_[i].zone_data,
+                                  rrclass_);
+            }
+        }
+        throw;
+    }
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
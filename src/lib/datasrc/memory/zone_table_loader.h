@@ -0,0 +1,167 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef MEM_ZONE_TABLE_LOADER_H
+#define MEM_ZONE_TABLE_LOADER_H
+
+#include <datasrc/memory/loader_creator.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace util {
+class MemorySegmentLocal;
+}
+namespace datasrc {
+namespace memory {
+class ZoneTableSegment;
+class ZoneData;
+
+/// \brief Loads a set of zones into a zone table segment.
+///
+/// This class is intended to be used for the initial loading of (possibly
+/// many) zones into the zone table, e.g., on the startup of a server
+/// process.  The zones to be loaded are registered by \c add(), and then
+/// loaded and installed into the zone table at once by \c load().
+///
+/// If the zone table segment is of the "local" type and more than one thread
+/// is specified on construction, the zones are loaded in parallel: each
+/// thread repeatedly takes the next zone to be loaded and builds its
+/// \c ZoneData in a \c util::MemorySegmentLocal object owned by the thread,
+/// so the threads don't have to share the memory segment (which is not thread
+/// safe).  After all threads have completed, the memory of these segments
+/// is merged into the zone table segment (see
+/// \c util::MemorySegmentLocal::merge()) and the zones are installed into
+/// the table.  In other cases the zones are loaded one by one using
+/// \c ZoneWriter.
+///
+/// In the parallel mode, the loaders are created and run in the threads, so
+/// the \c ZoneDataLoaderCreator functors (and the data sources used in them)
+/// must be usable from multiple threads at the same time (see
+/// \c getWorkerCount() about the threads the loaders may use).  Also, the zone
+/// data in the table are never reused for the load (any existing zone is
+/// replaced with the newly loaded data).
+///
+/// In either case, the result is the same as loading each zone with
+/// \c ZoneWriter constructed with \c catch_load_error being \c true: if
+/// loading a zone fails with \c ZoneLoaderException, an empty zone is
+/// installed for it.  If the data source doesn't have the zone, nothing is
+/// installed for it.  Other exceptions are propagated to the caller of
+/// \c load(); in the parallel mode, the zone failing with such an exception
+/// is loaded once again in the calling thread so the exception can be
+/// propagated.  In that case, the zones before it have been installed (in
+/// the order of \c add()), and the rest are not.
+class ZoneTableLoader : boost::noncopyable {
+public:
+    /// \brief The result of loading a zone.
+    enum Result {
+        SUCCESS,       ///< The zone has been loaded and installed
+        LOAD_ERROR,    ///< Loading the zone failed and an empty zone has
+                       ///< been installed
+        NOT_FOUND      ///< The zone isn't found in the source, nothing has
+                       ///< been installed
+    };
+
+    /// \brief Callback to be called on the result of each zone.
+    ///
+    /// The parameters are the zone name, the result, and the error message
+    /// in the case of \c LOAD_ERROR (empty otherwise).
+    typedef boost::function<void(const dns::Name&, Result,
+                                 const std::string&)> ResultCallback;
+
+    /// \brief Constructor.
+    ///
+    /// \throw bundy::InvalidOperation \c segment is read-only.
+    /// \throw bundy::InvalidParameter \c thread_count is 0.
+    ///
+    /// \param segment The zone table segment to store the zones into.
+    /// \param rrclass The RR class of the zones.
+    /// \param thread_count The maximum number of threads to load the zones.
+    /// If it's 1, the zones are loaded in the calling thread.
+    ZoneTableLoader(ZoneTableSegment& segment, const dns::RRClass& rrclass,
+                    size_t thread_count);
+
+    /// \brief Return the number of threads \c load() uses to load the given
+    /// number of zones.
+    ///
+    /// It's 1 unless the zones are loaded in parallel.  Loaders that can use
+    /// multiple threads by themselves (e.g., \c dns::MasterLoader) should be
+    /// given at most \c thread_count divided by this number of threads, so
+    /// the total number of threads doesn't exceed \c thread_count.
+    ///
+    /// \throw None
+    ///
+    /// \param zone_count The number of zones to be loaded.
+    size_t getWorkerCount(size_t zone_count) const;
+
+    /// \brief Register a zone to be loaded.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param zone_name The name of the zone.
+    /// \param loader_creator Functor to create \c ZoneDataLoader for the
+    /// zone.
+    void add(const dns::Name& zone_name,
+             const ZoneDataLoaderCreator& loader_creator);
+
+    /// \brief Load all registered zones and install them into the table.
+    ///
+    /// The \c callback, if given, is called in the calling thread for each
+    /// zone in the order of \c add().  Once completed, the registered zones
+    /// are cleared.
+    ///
+    /// \throw Others Anything thrown by the loaders, other than
+    /// \c ZoneLoaderException and \c NoSuchZone (see the class description).
+    ///
+    /// \param callback The callback for the result of each zone.
+    void load(const ResultCallback& callback = ResultCallback());
+
+private:
+    struct ZoneInfo {
+        ZoneInfo(const dns::Name& zone_name,
+                 const ZoneDataLoaderCreator& loader_creator) :
+            zone_name_(zone_name), loader_creator_(loader_creator)
+        {}
+        dns::Name zone_name_;
+        ZoneDataLoaderCreator loader_creator_;
+    };
+    struct ParallelState;
+    void loadSequential(const ResultCallback& callback);
+    void loadParallel(util::MemorySegmentLocal& table_sgmt,
+                      size_t thread_count, const ResultCallback& callback);
+    Result loadZone(const ZoneInfo& zone, std::string& error_msg);
+    void installZone(const dns::Name& zone_name, ZoneData* zone_data);
+
+    ZoneTableSegment& segment_;
+    const dns::RRClass rrclass_;
+    const size_t thread_count_;
+    std::vector<ZoneInfo> zones_;
+};
+
+}
+}
+}
+
+#endif  // MEM_ZONE_TABLE_LOADER_H
+
+// Local Variables:
+// mode: c++
+// End:
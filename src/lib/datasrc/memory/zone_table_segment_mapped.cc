@@ -17,12 +17,21 @@
 #include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/memory/logger.h>
 
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
+
 #include <memory>
 
 using namespace bundy::data;
 using namespace bundy::dns;
 using namespace bundy::util;
 using bundy::datasrc::memory::detail::SegmentObjectHolder;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 
 namespace bundy {
 namespace datasrc {
@@ -36,8 +45,123 @@ const char* const ZONE_TABLE_CHECKSUM_NAME = "zone_table_checksum";
 // The name with which the zone table header is associated in the segment.
 const char* const ZONE_TABLE_HEADER_NAME = "zone_table_header";
 
+// The name with which the format version of the zone table is associated
+// in the segment.
+const char* const ZONE_TABLE_VERSION_NAME = "zone_table_version";
+
+// The format version of the zone table and the data stored in the segment.
+// It must be incremented whenever their layout changes (e.g., a member is
+// added to ZoneData), so segments of another format are rejected and
+// rebuilt instead of being misread.  Segments written by older versions
+// don't have the version at all, which we regard as version 0.
+const uint32_t ZONE_TABLE_FORMAT_VERSION = 1;
+
+// Check the format version of the zone table in the segment; if it doesn't
+// match, set error_msg and return false.
+bool
+checkFormatVersion(const MemorySegment& segment, std::string& error_msg) {
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress(ZONE_TABLE_VERSION_NAME);
+    const uint32_t version = (result.first && result.second) ?
+        *static_cast<const uint32_t*>(result.second) : 0;
+    if (version != ZONE_TABLE_FORMAT_VERSION) {
+        error_msg = "Existing segment has an incompatible format version " +
+            boost::lexical_cast<std::string>(version);
+        return (false);
+    }
+    return (true);
+}
+
+// The background prefault thread faults in this many bytes at a time, and
+// checks if it's stopped in between.
+const size_t PREFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Values of the "prefault" parameter of reset().
+enum PrefaultMode {
+    PREFAULT_NONE,
+    PREFAULT_POPULATE,
+    PREFAULT_BACKGROUND
+};
+
+PrefaultMode
+getPrefaultMode(const ConstElementPtr& params) {
+    const ConstElementPtr prefault = params->get("prefault");
+    if (!prefault) {
+        return (PREFAULT_NONE);
+    }
+    if (prefault->getType() == Element::string) {
+        const std::string& mode = prefault->stringValue();
+        if (mode == "none") {
+            return (PREFAULT_NONE);
+        } else if (mode == "populate") {
+            return (PREFAULT_POPULATE);
+        } else if (mode == "background") {
+            return (PREFAULT_BACKGROUND);
+        }
+    }
+    bundy_throw(bundy::InvalidParameter,
+                "Invalid value of \"prefault\": must be \"none\", "
+                "\"populate\" or \"background\"");
+}
+
+bool
+getBoolParam(const ConstElementPtr& params, const char* name) {
+    const ConstElementPtr value = params->get(name);
+    if (!value) {
+        return (false);
+    }
+    if (value->getType() != Element::boolean) {
+        bundy_throw(bundy::InvalidParameter,
+                    "Invalid value of \"" << name << "\": must be boolean");
+    }
+    return (value->boolValue());
+}
+
 } // end of unnamed namespace
 
+// Faults in a read-only segment in a separate thread.  It works a chunk at
+// a time, so it can be stopped soon when the segment is switched again.
+class ZoneTableSegmentMapped::Prefaulter : boost::noncopyable {
+public:
+    Prefaulter(const MemorySegmentMapped& segment) :
+        segment_(segment), stopped_(false),
+        thread_(boost::bind(&Prefaulter::run, this))
+    {}
+
+    // Stop the thread and wait for it.
+    ~Prefaulter() {
+        {
+            const Mutex::Locker locker(mutex_);
+            stopped_ = true;
+        }
+        thread_.wait();
+    }
+
+private:
+    void run() {
+        size_t offset = 0;
+        while (!isStopped()) {
+            const size_t done = segment_.prefault(offset, PREFAULT_CHUNK_SIZE);
+            if (done == 0) {
+                break;
+            }
+            offset += done;
+        }
+    }
+
+    bool isStopped() {
+        const Mutex::Locker locker(mutex_);
+        return (stopped_);
+    }
+
+    const MemorySegmentMapped& segment_;
+    Mutex mutex_;
+    bool stopped_;
+    // This must be the last member, so the thread starts after the others
+    // are initialized.
+    Thread thread_;
+};
+
 ZoneTableSegmentMapped::ZoneTableSegmentMapped(const RRClass& rrclass) :
     ZoneTableSegment(rrclass),
     impl_type_("mapped"),
@@ -48,6 +172,7 @@ ZoneTableSegmentMapped::ZoneTableSegmentMapped(const RRClass& rrclass) :
 }
 
 ZoneTableSegmentMapped::~ZoneTableSegmentMapped() {
+    stopPrefault();
     sync();
 }
 
@@ -124,6 +249,9 @@ ZoneTableSegmentMapped::processHeader(MemorySegmentMapped& segment,
             return (false);
         } else {
             assert(result.second);
+            if (!checkFormatVersion(segment, error_msg)) {
+                return (false);
+            }
         }
     } else {
         if ((!create) && has_allocations) {
@@ -134,6 +262,17 @@ ZoneTableSegmentMapped::processHeader(MemorySegmentMapped& segment,
             return (false);
         }
 
+        void* version = NULL;
+        while (!version) {
+            try {
+                version = segment.allocate(sizeof(uint32_t));
+            } catch (const MemorySegmentGrown&) {
+                // Do nothing and try again.
+            }
+        }
+        *static_cast<uint32_t*>(version) = ZONE_TABLE_FORMAT_VERSION;
+        segment.setNamedAddress(ZONE_TABLE_VERSION_NAME, version);
+
         while (true) {
             try {
                 SegmentObjectHolder<ZoneTable, int> zt_holder(segment, 0);
@@ -211,14 +350,17 @@ ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
     // 0 for checksum calculation in a read-only segment. So we continue
     // without verifying the checksum.
 
-    // There must be a previously saved ZoneTableHeader.
+    // There must be a previously saved ZoneTableHeader of the current
+    // format.
+    std::string error_msg;
     result = segment->getNamedAddress(ZONE_TABLE_HEADER_NAME);
     if (result.first) {
         assert(result.second);
     } else {
-         const std::string error_msg =
-             "There is no previously saved ZoneTableHeader in a "
-             "mapped segment opened in read-only mode.";
+        error_msg = "There is no previously saved ZoneTableHeader in a "
+            "mapped segment opened in read-only mode.";
+    }
+    if (!error_msg.empty() || !checkFormatVersion(*segment, error_msg)) {
          if (mem_sgmt_) {
               bundy_throw(ResetFailed,
                         "Error in resetting zone table segment to use "
@@ -270,6 +412,12 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
         bundy_throw(bundy::InvalidParameter,
                   "Invalid value of \"mapped-file\": must be string or null");
     }
+
+    // Check the other parameters before touching the current segment.
+    const PrefaultMode prefault = getPrefaultMode(params);
+    const bool will_need = getBoolParam(params, "will-need");
+    const bool huge_pages = getBoolParam(params, "huge-pages");
+
     if (mapped_file->getType() == Element::null) {
         LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_UNMAP_SEGMENT).
             arg(current_filename_.empty() ?
@@ -318,17 +466,47 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
                   "Invalid MemorySegmentOpenMode passed to reset()");
     }
 
+    // The background prefault of the previous segment (if any) must be
+    // stopped before it's unmapped.
+    stopPrefault();
+
     current_filename_ = filename;
     current_mode_ = mode;
     mem_sgmt_.reset(segment.release());
 
+    if (huge_pages && !mem_sgmt_->useHugePages()) {
+        LOG_WARN(logger, DATASRC_MEMORY_MEM_HUGE_PAGES_UNAVAILABLE).
+            arg(filename);
+    }
+
     if (!isWritable()) {
         // Given what we setup above, the following must not throw at
         // this point. If it does, all bets are off.
         cached_ro_header_ = getHeaderHelper<ZoneTableHeader>(true);
+
+        // The hints are not essential, so we ignore failures.
+        if (will_need) {
+            mem_sgmt_->adviseWillNeed();
+        }
+        if (prefault == PREFAULT_POPULATE) {
+            LOG_DEBUG(logger, DBG_TRACE_BASIC,
+                      DATASRC_MEMORY_MEM_PREFAULT_SEGMENT).
+                arg(filename).arg(mem_sgmt_->getSize()).arg("now");
+            mem_sgmt_->prefault(0, mem_sgmt_->getSize());
+        } else if (prefault == PREFAULT_BACKGROUND) {
+            LOG_DEBUG(logger, DBG_TRACE_BASIC,
+                      DATASRC_MEMORY_MEM_PREFAULT_SEGMENT).
+                arg(filename).arg(mem_sgmt_->getSize()).arg("in background");
+            prefaulter_.reset(new Prefaulter(*mem_sgmt_));
+        }
     }
 }
 
+void
+ZoneTableSegmentMapped::stopPrefault() {
+    prefaulter_.reset();
+}
+
 void
 ZoneTableSegmentMapped::sync() {
     // Synchronize checksum, etc.
@@ -353,6 +531,7 @@ ZoneTableSegmentMapped::sync() {
 void
 ZoneTableSegmentMapped::clear() {
     if (mem_sgmt_) {
+        stopPrefault();
         sync();
         mem_sgmt_.reset();
     }
@@ -92,9 +92,39 @@ public:
     /// and the zone table segment will become unusable.  In this case,
     /// \c mode will be ignored.
     ///
+    /// \c params can also contain the following optional keys, which reduce
+    /// the page fault and TLB miss costs of the first accesses to a large
+    /// segment right after it's switched:
+    ///
+    /// - "prefault": One of "none" (default), "populate" and "background".
+    ///   With "populate", all pages of a segment opened in READ_ONLY mode
+    ///   are faulted in before \c reset() returns, so \c reset() takes
+    ///   longer but the first lookups don't fault.  With "background",
+    ///   they are faulted in by a separate thread while the segment is
+    ///   already used; the thread is stopped when the segment is cleared
+    ///   or reset again.
+    /// - "will-need": If true, the kernel is advised that the whole segment
+    ///   opened in READ_ONLY mode will be needed soon, so it starts reading
+    ///   the file into the page cache asynchronously.
+    /// - "huge-pages": If true, the kernel is advised to back the segment
+    ///   with huge pages.  This applies to all modes, as the pages of a
+    ///   file on tmpfs mounted with "huge=advise" are allocated as huge
+    ///   pages only when written through an advised mapping.
+    ///
+    /// The other options are ignored for writable segments: they are
+    /// written as zones are loaded and remapped as they grow, so faulting
+    /// them in up front wouldn't help.
+    ///
+    /// An existing file in READ_WRITE or READ_ONLY mode must have been
+    /// written with the same format version of the zone table data as this
+    /// implementation; otherwise \c reset() fails, and the file has to be
+    /// created again in CREATE mode.
+    ///
     /// Please see the \c ZoneTableSegment API documentation for the
     /// behavior in case of exceptions.
     ///
+    /// \throws bundy::InvalidParameter \c params is not a map, doesn't
+    /// contain "mapped-file", or any value is of a wrong type or invalid.
     /// \throws bundy::Unexpected when it's unable to lookup a named
     /// address that it expected to be present. This is extremely
     /// unlikely, and it points to corruption.
@@ -117,7 +147,10 @@ public:
     virtual bool isUsable() const;
 
 private:
+    class Prefaulter;
+
     void sync();
+    void stopPrefault();
 
     bool processChecksum(bundy::util::MemorySegmentMapped& segment, bool create,
                          bool has_allocations, std::string& error_msg);
@@ -139,6 +172,9 @@ private:
     // construction, and is set by the \c reset() method.
     boost::scoped_ptr<bundy::util::MemorySegmentMapped> mem_sgmt_;
     ZoneTableHeader* cached_ro_header_;
+    // Faults in mem_sgmt_ in the background if requested in reset().
+    // This must be stopped before mem_sgmt_ is unmapped.
+    boost::scoped_ptr<Prefaulter> prefaulter_;
 };
 
 } // namespace memory
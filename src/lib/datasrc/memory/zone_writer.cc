@@ -18,6 +18,7 @@
 #include <datasrc/memory/zone_data_loader.h>
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/segment_object_holder.h>
+#include <datasrc/memory/util_internal.h>
 
 #include <boost/scoped_ptr.hpp>
 
@@ -28,6 +29,8 @@
 #include <memory>
 #include <stdexcept>
 
+#include <stdint.h>
+
 using std::auto_ptr;
 
 namespace bundy {
@@ -56,7 +59,12 @@ struct ZoneWriter::Impl {
         rrclass_(rrclass),
         state_(ZW_UNUSED),
         catch_load_error_(throw_on_load_error),
-        destroy_old_data_(true)
+        destroy_old_data_(true),
+        data_shared_(false),
+        old_size_(0),
+        shared_size_(0),
+        start_size_(0),
+        load_time_(0)
     {
         while (true) {
             try {
@@ -69,6 +77,7 @@ struct ZoneWriter::Impl {
 
     void installToTable();
     void installFailed(const std::exception* ex);
+    void setLoadStats(ZoneData* zone_data);
 
     ZoneTableSegment& segment_;
     const ZoneDataLoaderCreator loader_creator_;
@@ -87,6 +96,17 @@ struct ZoneWriter::Impl {
     boost::scoped_ptr<ZoneDataHolder> data_holder_;
     boost::scoped_ptr<ZoneDataLoader> loader_;
     bool destroy_old_data_;
+    // Whether the loaded and old data share some RdataSets.
+    bool data_shared_;
+    // Memory size of the old data, the size of the RdataSets of the old data
+    // shared with the loaded data, and the allocated size of the segment
+    // when the load started, to calculate the memory size of the loaded
+    // data.
+    size_t old_size_;
+    size_t shared_size_;
+    size_t start_size_;
+    // Time spent to load the data so far, in microseconds.
+    uint64_t load_time_;
 };
 
 ZoneWriter::ZoneWriter(ZoneTableSegment& segment,
@@ -124,6 +144,7 @@ ZoneWriter::load(size_t count_limit, std::string* error_msg) {
         bundy_throw(bundy::InvalidOperation, "Trying to load twice");
     }
 
+    const detail::LoadTimer timer(impl_->load_time_);
     try {
         // If this is the first call, initialize some stuff.
         if (!impl_->loader_) {
@@ -132,12 +153,16 @@ ZoneWriter::load(size_t count_limit, std::string* error_msg) {
                 table->findZone(impl_->origin_);
             ZoneData* const old_data =
                 (ztresult.code == result::SUCCESS) ? ztresult.zone_data : NULL;
+            impl_->old_size_ = old_data ? old_data->getMemorySize() : 0;
+            impl_->start_size_ =
+                impl_->segment_.getMemorySegment().getAllocatedSize();
             impl_->loader_.reset(impl_->loader_creator_(
                                      impl_->segment_.getMemorySegment(),
                                      old_data));
             impl_->state_ = Impl::ZW_LOADING;
         }
         impl_->destroy_old_data_ = !impl_->loader_->isDataReused();
+        impl_->data_shared_ = impl_->loader_->isDataShared();
         const bool completed = impl_->loader_->loadIncremental(count_limit);
         if (!completed) {
             return (false);
@@ -151,6 +176,19 @@ ZoneWriter::load(size_t count_limit, std::string* error_msg) {
         }
 
         impl_->data_holder_->set(zone_data);
+
+        // The old data is still installed; its RdataSets shared with the
+        // loaded data are counted here rather than in install(), which is
+        // expected to be fast.
+        if (impl_->destroy_old_data_ && impl_->data_shared_) {
+            const ZoneTable::MutableFindResult ztresult =
+                getZoneTable(impl_->segment_)->findZone(impl_->origin_);
+            if (ztresult.code == result::SUCCESS && ztresult.zone_data &&
+                ztresult.zone_data != zone_data) {
+                impl_->shared_size_ = ztresult.zone_data->getSharedDataSize(
+                    *zone_data, impl_->rrclass_);
+            }
+        }
     } catch (const ZoneLoaderException& ex) {
         if (!impl_->catch_load_error_) {
             throw;
@@ -184,6 +222,21 @@ ZoneWriter::Impl::installFailed(const std::exception* ex) {
         arg(origin_).arg(rrclass_).arg(ex ? ex->what() : "(unknown)");
 }
 
+// A subroutine of install(), recording the memory and time used for the
+// loaded zone data.  The memory newly allocated since the start of the load
+// is added to that of the old data if the loaded data is built on top of
+// the old data, or to that of the RdataSets of the old data the loaded data
+// share.  This is done before the loaded data are installed, as they can be
+// read by other threads after that.
+void
+ZoneWriter::Impl::setLoadStats(ZoneData* zone_data) {
+    const size_t base_size = !destroy_old_data_ ? old_size_ : shared_size_;
+    const size_t allocated = segment_.getMemorySegment().getAllocatedSize();
+    zone_data->setMemorySize(
+        detail::adjustMemorySize(base_size, start_size_, allocated));
+    zone_data->setLoadTime(load_time_);
+}
+
 // A commonly used subroutine of install(), installing the final zone data
 // to the zone table.
 void
@@ -228,8 +281,13 @@ ZoneWriter::install() {
             // MemorySegmentGrown, so we need another while-try-catch here.
             ZoneData* zone_data = impl_->data_holder_->get();
             if (zone_data) {
-                zone_data = impl_->loader_->commit(impl_->data_holder_->get());
+                {
+                    const detail::LoadTimer timer(impl_->load_time_);
+                    zone_data =
+                        impl_->loader_->commit(impl_->data_holder_->get());
+                }
                 assert(zone_data);  // API ensures this
+                impl_->setLoadStats(zone_data);
             }
             impl_->data_holder_->set(zone_data);
             impl_->installToTable();
@@ -261,6 +319,17 @@ ZoneWriter::cleanup() {
 
     ZoneData* zone_data = impl_->data_holder_->release();
     if (zone_data) {
+        if (impl_->data_shared_) {
+            // The data we hold (either the loaded data not installed or the
+            // replaced old data) may share RdataSets with the data in the
+            // table, which must be kept.
+            const ZoneTable::MutableFindResult ztresult =
+                getZoneTable(impl_->segment_)->findZone(impl_->origin_);
+            if (ztresult.code == result::SUCCESS && ztresult.zone_data &&
+                ztresult.zone_data != zone_data) {
+                zone_data->detachSharedData(*ztresult.zone_data);
+            }
+        }
         ZoneData::destroy(impl_->segment_.getMemorySegment(), zone_data,
                           impl_->rrclass_);
         impl_->state_ = Impl::ZW_CLEANED;
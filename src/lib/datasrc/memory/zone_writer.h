@@ -126,6 +126,14 @@ public:
     /// The operation is expected to be fast and is meant to be used inside
     /// a critical section.
     ///
+    /// Before installing the new zone data, it records in them the memory
+    /// allocated from the segment for the zone and the time spent in
+    /// \c load() and this method (see \c ZoneData::getMemorySize() and
+    /// \c ZoneData::getLoadTime()).  If the new data share some of the old
+    /// data, the memory of the shared part is included in the recorded size;
+    /// it's calculated in \c load(), so the installed data aren't modified
+    /// after this method.
+    ///
     /// This may throw in rare cases.  If it throws, you still need to
     /// call cleanup().
     ///
@@ -15,6 +15,7 @@
 #include <datasrc/cache_config.h>
 #include <datasrc/exceptions.h>
 #include <datasrc/memory/loader_creator.h>
+#include <datasrc/memory/rdataset.h>
 #include <datasrc/memory/zone_data.h>
 #include <datasrc/tests/mock_client.h>
 
@@ -22,6 +23,7 @@
 #include <util/memory_segment_local.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
+#include <dns/rrtype.h>
 
 #include <gtest/gtest.h>
 
@@ -311,4 +313,183 @@ TEST_F(CacheConfigTest, getSegmentType) {
                  bundy::data::TypeError);
 }
 
+TEST_F(CacheConfigTest, prerender) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isPrerenderEnabled());
+
+    // If we explicitly enable it, the loaded RdataSets should have the
+    // wire image.
+    ConstElementPtr config(Element::fromJSON(
+                               "{\"cache-enable\": true,"
+                               " \"cache-prerender\": true,"
+                               " \"params\": "
+                               "  {\".\": \"" TEST_DATA_DIR "/root.zone\"}"
+                               "}"));
+    const CacheConfig cache_conf("MasterFiles", 0, *config, true);
+    EXPECT_TRUE(cache_conf.isPrerenderEnabled());
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name::ROOT_NAME())
+        (msgmt_, NULL));
+    ZoneData* zone_data = loader->load();
+    ASSERT_TRUE(zone_data);
+    const memory::RdataSet* rdataset =
+        memory::RdataSet::find(zone_data->getOriginNode()->getData(),
+                               RRType::SOA());
+    ASSERT_TRUE(rdataset);
+    EXPECT_TRUE(rdataset->getWireImage());
+    ZoneData::destroy(msgmt_, zone_data, RRClass::IN());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-prerender\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, nameIndex) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isNameIndexEnabled());
+
+    // If we explicitly enable it, the loaded zone data should have the
+    // index.
+    ConstElementPtr config(Element::fromJSON(
+                               "{\"cache-enable\": true,"
+                               " \"cache-name-index\": true,"
+                               " \"params\": "
+                               "  {\".\": \"" TEST_DATA_DIR "/root.zone\"}"
+                               "}"));
+    const CacheConfig cache_conf("MasterFiles", 0, *config, true);
+    EXPECT_TRUE(cache_conf.isNameIndexEnabled());
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name::ROOT_NAME())
+        (msgmt_, NULL));
+    ZoneData* zone_data = loader->load();
+    ASSERT_TRUE(zone_data);
+    EXPECT_TRUE(zone_data->hasNameIndex());
+    EXPECT_EQ(zone_data->getOriginNode(),
+              zone_data->findIndexedName(LabelSequence(Name::ROOT_NAME())));
+    ZoneData::destroy(msgmt_, zone_data, RRClass::IN());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-name-index\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, copyOnWrite) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("mock", &mock_client_, *mock_config_,
+                             true).isCopyOnWriteEnabled());
+
+    ConstElementPtr config(Element::fromJSON(
+                               "{\"cache-enable\": true,"
+                               " \"cache-copy-on-write\": true,"
+                               " \"cache-zones\": [\"example.org\"]}"));
+    const CacheConfig cache_conf("mock", &mock_client_, *config, true);
+    EXPECT_TRUE(cache_conf.isCopyOnWriteEnabled());
+
+    // The loader for a new zone doesn't share any data (the journal is
+    // only used with the old data).
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name("example.org"))
+        (msgmt_, NULL));
+    EXPECT_FALSE(loader->isDataShared());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-copy-on-write\": 1,"
+                                                " \"cache-zones\": []}"));
+    EXPECT_THROW(CacheConfig("mock", &mock_client_, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, deltaLoad) {
+    // Disabled by default for the local segment type
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isDeltaLoadEnabled());
+
+    // But enabled by default for the mapped type, unless explicitly
+    // disabled.
+    ConstElementPtr config(Element::fromJSON(
+                               "{\"cache-enable\": true,"
+                               " \"cache-type\": \"mapped\","
+                               " \"params\": {}}"));
+    EXPECT_TRUE(CacheConfig("MasterFiles", 0, *config,
+                            true).isDeltaLoadEnabled());
+    config = Element::fromJSON("{\"cache-enable\": true,"
+                               " \"cache-type\": \"mapped\","
+                               " \"cache-delta-load\": false,"
+                               " \"params\": {}}");
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0, *config,
+                             true).isDeltaLoadEnabled());
+
+    // If we explicitly enable it, reloading the zone applies the
+    // differences to the old data.
+    config = Element::fromJSON("{\"cache-enable\": true,"
+                               " \"cache-delta-load\": true,"
+                               " \"params\": "
+                               "  {\".\": \"" TEST_DATA_DIR "/root.zone\"}"
+                               "}");
+    const CacheConfig cache_conf("MasterFiles", 0, *config, true);
+    EXPECT_TRUE(cache_conf.isDeltaLoadEnabled());
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name::ROOT_NAME())
+        (msgmt_, NULL));
+    EXPECT_FALSE(loader->isDataReused()); // no old data
+    ZoneData* zone_data = loader->load();
+    ASSERT_TRUE(zone_data);
+    loader.reset(cache_conf.getLoaderCreator(RRClass::IN(),
+                                             Name::ROOT_NAME())
+                 (msgmt_, zone_data));
+    EXPECT_TRUE(loader->isDataReused());
+    EXPECT_EQ(zone_data, loader->load());
+    EXPECT_EQ(zone_data, loader->commit(zone_data));
+    ZoneData::destroy(msgmt_, zone_data, RRClass::IN());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-delta-load\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, loadThreadCount) {
+    // One thread by default
+    EXPECT_EQ(1, CacheConfig("mock", &mock_client_, *mock_config_,
+                             true).getLoadThreadCount());
+
+    ConstElementPtr config(Element::fromJSON(
+                               "{\"cache-enable\": true,"
+                               " \"cache-load-threads\": 4,"
+                               " \"cache-zones\": [\"example.org\"]}"));
+    EXPECT_EQ(4, CacheConfig("mock", &mock_client_, *config,
+                             true).getLoadThreadCount());
+
+    // Non positive values are rejected
+    ConstElementPtr badconfig(Element::fromJSON(
+                                  "{\"cache-enable\": true,"
+                                  " \"cache-load-threads\": 0,"
+                                  " \"cache-zones\": []}"));
+    EXPECT_THROW(CacheConfig("mock", &mock_client_, *badconfig, true),
+                 CacheConfigError);
+    badconfig = Element::fromJSON("{\"cache-enable\": true,"
+                                  " \"cache-load-threads\": -1,"
+                                  " \"cache-zones\": []}");
+    EXPECT_THROW(CacheConfig("mock", &mock_client_, *badconfig, true),
+                 CacheConfigError);
+
+    // Wrong types
+    badconfig = Element::fromJSON("{\"cache-enable\": true,"
+                                  " \"cache-load-threads\": true,"
+                                  " \"cache-zones\": []}");
+    EXPECT_THROW(CacheConfig("mock", &mock_client_, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
 }
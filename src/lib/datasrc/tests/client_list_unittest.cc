@@ -1132,6 +1132,28 @@ TEST_P(ListTest, reloadSuccess) {
     EXPECT_EQ(GetParam()->getType(), statii_after[0].getSegmentType());
 }
 
+// Check the status of the cached zones (memory and load time)
+TEST_P(ListTest, zoneStatus) {
+    list_->configure(config_elem_zones_, true);
+    const Name name("example.org");
+    prepareCache(0, name);
+    EXPECT_EQ(ConfigurableClientList::ZONE_SUCCESS, doReload(name));
+
+    // Zones are only included on request.
+    const vector<DataSourceStatus> statii(list_->getStatus());
+    ASSERT_EQ(1, statii.size());
+    EXPECT_TRUE(statii[0].getZoneStatus().empty());
+    EXPECT_EQ(0, statii[0].getMemorySize());
+
+    const vector<DataSourceStatus> statii_zones(list_->getStatus(true));
+    ASSERT_EQ(1, statii_zones.size());
+    const vector<CachedZoneStatus>& zones(statii_zones[0].getZoneStatus());
+    ASSERT_EQ(1, zones.size());
+    EXPECT_EQ(name, zones[0].getName());
+    EXPECT_LT(0, zones[0].getMemorySize());
+    EXPECT_EQ(zones[0].getMemorySize(), statii_zones[0].getMemorySize());
+}
+
 // The cache is not enabled. The load should be rejected.
 //
 // FIXME: This test is broken by #2853 and needs to be fixed or
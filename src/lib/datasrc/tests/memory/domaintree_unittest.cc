@@ -1572,6 +1572,80 @@ TEST_F(DomainTreeTest, getLastComparedNode) {
     chain.clear();
 }
 
+TEST_F(DomainTreeTest, compareWithInlineKeys) {
+    // The search compares the rightmost labels using short inline keys
+    // of the nodes first.  Check it with labels whose differences are in
+    // and beyond the part covered by the keys, and in their lengths.
+    const char* const labels[] = {
+        "abcde", "a", "abc", "abcd", "abd", "ab", "b", "abcdf", "abce",
+        "a-", "xn--abc", "0", "abcdefghijklmnop", "abcdefghijklmnoq"
+    };
+    const size_t labels_count = sizeof(labels) / sizeof(labels[0]);
+    TreeHolder tree_holder(mem_sgmt_, TestDomainTree::create(mem_sgmt_,
+                                                              true));
+    TestDomainTree& tree(*tree_holder.get());
+    for (size_t i = 0; i < labels_count; ++i) {
+        EXPECT_EQ(TestDomainTree::SUCCESS,
+                  tree.insert(mem_sgmt_,
+                              Name(labels[i]).concatenate(Name("example")),
+                              &dtnode));
+        dtnode->setData(new int(i));
+    }
+    EXPECT_TRUE(tree.checkProperties());
+
+    // The names should be found regardless of the case, and iterated in the
+    // DNSSEC order.
+    for (size_t i = 0; i < labels_count; ++i) {
+        string upper(labels[i]);
+        transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        const Name name = Name(upper).concatenate(Name("example"));
+        TestDomainTreeNodeChain chain;
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  tree.find(name, &cdtnode, chain));
+        EXPECT_EQ(static_cast<int>(i), *cdtnode->getData());
+    }
+    TestDomainTreeNodeChain chain;
+    EXPECT_EQ(TestDomainTree::EXACTMATCH,
+              tree.find(Name("example"), &cdtnode, chain));
+    Name prev_name = Name("example");
+    size_t count = 0;
+    while ((cdtnode = tree.nextNode(chain)) != NULL) {
+        const Name name(cdtnode->getAbsoluteLabels(buf).toText());
+        EXPECT_GT(0, prev_name.compare(name).getOrder());
+        prev_name = name;
+        ++count;
+    }
+    EXPECT_EQ(labels_count, count);
+
+    // For names that don't exist, the last comparison should be the same
+    // as the full comparison of the labels.
+    const char* const nonexistent_labels[] = {
+        "abcdd", "ABCDG", "abcc", "abf", "aa", "b0", "abcdefghijklmnopq",
+        "abcdefghijklmnoo", "xn--abd", "-", "z"
+    };
+    for (size_t i = 0;
+         i < sizeof(nonexistent_labels) / sizeof(nonexistent_labels[0]);
+         ++i) {
+        const Name target_name(nonexistent_labels[i]);
+        TestDomainTreeNodeChain chain;
+        EXPECT_EQ(TestDomainTree::PARTIALMATCH,
+                  tree.find(target_name.concatenate(Name("example")),
+                            &cdtnode, chain));
+        // The name is searched for in the tree below "example", where the
+        // target label sequence is relative.
+        LabelSequence relative_labels(target_name);
+        relative_labels.stripRight(1);
+        const NameComparisonResult expected = relative_labels.compare(
+            chain.getLastComparedNode()->getLabels());
+        EXPECT_EQ(expected.getOrder(),
+                  chain.getLastComparisonResult().getOrder());
+        EXPECT_EQ(expected.getCommonLabels(),
+                  chain.getLastComparisonResult().getCommonLabels());
+        EXPECT_EQ(expected.getRelation(),
+                  chain.getLastComparisonResult().getRelation());
+    }
+}
+
 TEST_F(DomainTreeTest, dumpTree) {
     std::ostringstream str;
     std::ostringstream str2;
@@ -0,0 +1,261 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/nsec3_hash_cache.h>
+#include <datasrc/memory/zone_data.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/nsec3hash.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+
+namespace {
+
+// The number of NSEC3 hashes calculated by CountingNSEC3Hash.
+size_t calculate_count = 0;
+
+// An NSEC3 hash calculator that counts the calculations of the default one.
+class CountingNSEC3Hash : public NSEC3Hash {
+public:
+    CountingNSEC3Hash(NSEC3Hash* hash) : hash_(hash) {}
+    virtual string calculate(const Name& name) const {
+        ++calculate_count;
+        return (hash_->calculate(name));
+    }
+    virtual string calculate(const LabelSequence& ls) const {
+        ++calculate_count;
+        return (hash_->calculate(ls));
+    }
+    virtual bool match(const generic::NSEC3PARAM& param) const {
+        return (hash_->match(param));
+    }
+    virtual bool match(const generic::NSEC3& nsec3) const {
+        return (hash_->match(nsec3));
+    }
+private:
+    const boost::scoped_ptr<NSEC3Hash> hash_;
+};
+
+class CountingNSEC3HashCreator : public NSEC3HashCreator {
+public:
+    virtual NSEC3Hash* create(const generic::NSEC3PARAM& param) const {
+        return (new CountingNSEC3Hash(default_creator_.create(param)));
+    }
+    virtual NSEC3Hash* create(const generic::NSEC3& nsec3) const {
+        return (new CountingNSEC3Hash(default_creator_.create(nsec3)));
+    }
+    virtual NSEC3Hash* create(uint8_t algorithm, uint16_t iterations,
+                              const uint8_t* salt_data,
+                              size_t salt_length) const
+    {
+        return (new CountingNSEC3Hash(
+                    default_creator_.create(algorithm, iterations,
+                                            salt_data, salt_length)));
+    }
+private:
+    DefaultNSEC3HashCreator default_creator_;
+};
+
+class NSEC3HashCacheTest : public ::testing::Test {
+protected:
+    NSEC3HashCacheTest() :
+        nsec3_data_(NSEC3Data::create(mem_sgmt_, Name("example"),
+                                      generic::NSEC3PARAM("1 0 12 aabbccdd"))),
+        other_data_(NSEC3Data::create(mem_sgmt_, Name("example"),
+                                      generic::NSEC3PARAM("1 0 11 aabbccdd"))),
+        hash_(NSEC3Hash::create(generic::NSEC3PARAM("1 0 12 aabbccdd"))),
+        a_name_("a.example"), b_name_("B.example"), c_name_("c.example"),
+        a_ls_(a_name_), b_ls_(b_name_), c_ls_(c_name_)
+    {
+        calculate_count = 0;
+        setNSEC3HashCreator(&creator_);
+    }
+    ~NSEC3HashCacheTest() {
+        setNSEC3HashCreator(NULL);
+        NSEC3Data::destroy(mem_sgmt_, nsec3_data_, RRClass::IN());
+        NSEC3Data::destroy(mem_sgmt_, other_data_, RRClass::IN());
+    }
+
+    // Calculate the hash of a name with the cache, and check the result.
+    void checkCalculate(NSEC3HashCache& cache, const LabelSequence& ls) {
+        vector<string> hashes;
+        cache.calculate(vector<LabelSequence>(1, ls), hashes);
+        ASSERT_EQ(1, hashes.size());
+        EXPECT_EQ(hash_->calculate(ls), hashes[0]);
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    NSEC3Data* const nsec3_data_;
+    NSEC3Data* const other_data_;
+    const boost::scoped_ptr<NSEC3Hash> hash_;
+    const CountingNSEC3HashCreator creator_;
+    const Name a_name_, b_name_, c_name_;
+    const LabelSequence a_ls_, b_ls_, c_ls_;
+};
+
+TEST_F(NSEC3HashCacheTest, match) {
+    const NSEC3HashCache cache(*nsec3_data_);
+    EXPECT_TRUE(cache.match(*nsec3_data_));
+    EXPECT_FALSE(cache.match(*other_data_));
+}
+
+TEST_F(NSEC3HashCacheTest, calculate) {
+    NSEC3HashCache cache(*nsec3_data_);
+    EXPECT_EQ(0, cache.getSize());
+
+    // The hashes of new names are calculated together and cached.  The same
+    // name can be given more than once.
+    vector<LabelSequence> names;
+    names.push_back(a_ls_);
+    names.push_back(b_ls_);
+    names.push_back(a_ls_);
+    vector<string> hashes;
+    cache.calculate(names, hashes);
+    ASSERT_EQ(3, hashes.size());
+    EXPECT_EQ("35MTHGPGCU1QG68FAB165KLNSNK3DPVL", hashes[0]);
+    EXPECT_EQ(hash_->calculate(b_ls_), hashes[1]);
+    EXPECT_EQ(hashes[0], hashes[2]);
+    EXPECT_EQ(2, cache.getSize());
+    const size_t count = calculate_count;
+
+    // Cached ones aren't calculated again, regardless of the case.
+    const Name a_upper_name("A.EXAMPLE");
+    checkCalculate(cache, LabelSequence(a_upper_name));
+    checkCalculate(cache, b_ls_);
+    EXPECT_EQ(count, calculate_count);
+    EXPECT_EQ(2, cache.getSize());
+
+    // Mixed cached and uncached names.
+    names.push_back(c_ls_);
+    cache.calculate(names, hashes);
+    ASSERT_EQ(4, hashes.size());
+    EXPECT_EQ(hash_->calculate(c_ls_), hashes[3]);
+    EXPECT_EQ(3, cache.getSize());
+
+    // Empty list.
+    cache.calculate(vector<LabelSequence>(), hashes);
+    EXPECT_TRUE(hashes.empty());
+}
+
+TEST_F(NSEC3HashCacheTest, evict) {
+    NSEC3HashCache cache(*nsec3_data_, 2);
+    checkCalculate(cache, a_ls_);
+    checkCalculate(cache, b_ls_);
+    // Use a again, so b is the least recently used one, which will be
+    // removed for c.
+    checkCalculate(cache, a_ls_);
+    checkCalculate(cache, c_ls_);
+    EXPECT_EQ(2, cache.getSize());
+
+    size_t count = calculate_count;
+    checkCalculate(cache, a_ls_);
+    checkCalculate(cache, c_ls_);
+    EXPECT_EQ(count, calculate_count);
+    checkCalculate(cache, b_ls_);
+    EXPECT_EQ(count + 1, calculate_count);
+    EXPECT_EQ(2, cache.getSize());
+
+    // Nothing is cached with zero capacity.
+    NSEC3HashCache empty_cache(*nsec3_data_, 0);
+    count = calculate_count;
+    checkCalculate(empty_cache, a_ls_);
+    checkCalculate(empty_cache, a_ls_);
+    EXPECT_EQ(count + 2, calculate_count);
+    EXPECT_EQ(0, empty_cache.getSize());
+}
+
+TEST_F(NSEC3HashCacheTest, unknownAlgorithm) {
+    NSEC3Data* const data =
+        NSEC3Data::create(mem_sgmt_, Name("example"),
+                          generic::NSEC3PARAM("2 0 12 aabbccdd"));
+    NSEC3HashCache cache(*data);
+    vector<string> hashes;
+    EXPECT_THROW(cache.calculate(vector<LabelSequence>(1, a_ls_), hashes),
+                 UnknownNSEC3HashAlgorithm);
+    NSEC3Data::destroy(mem_sgmt_, data, RRClass::IN());
+}
+
+TEST_F(NSEC3HashCacheTest, table) {
+    NSEC3HashCacheTable table;
+    const Name origin("example"), other_origin("example.org");
+    const LabelSequence origin_ls(origin), other_origin_ls(other_origin);
+
+    // The same cache is returned for the same zone (in any case) as long as
+    // the parameters are the same.
+    const boost::shared_ptr<NSEC3HashCache> cache =
+        table.getCache(origin_ls, *nsec3_data_);
+    ASSERT_TRUE(cache);
+    EXPECT_TRUE(cache->match(*nsec3_data_));
+    const Name upper_origin("EXAMPLE");
+    EXPECT_EQ(cache, table.getCache(LabelSequence(upper_origin),
+                                    *nsec3_data_));
+
+    // Other zones have their own caches.
+    const boost::shared_ptr<NSEC3HashCache> other_cache =
+        table.getCache(other_origin_ls, *nsec3_data_);
+    EXPECT_NE(cache, other_cache);
+    EXPECT_EQ(other_cache, table.getCache(other_origin_ls, *nsec3_data_));
+
+    // If the parameters of the zone are changed, a new cache is created.
+    const boost::shared_ptr<NSEC3HashCache> new_cache =
+        table.getCache(origin_ls, *other_data_);
+    EXPECT_NE(cache, new_cache);
+    EXPECT_TRUE(new_cache->match(*other_data_));
+    EXPECT_EQ(new_cache, table.getCache(origin_ls, *other_data_));
+    EXPECT_EQ(2, table.getSize());
+}
+
+TEST_F(NSEC3HashCacheTest, tableCapacity) {
+    NSEC3HashCacheTable table(2);
+    const Name origin1("example"), origin2("example.org"),
+        origin3("example.com");
+    const LabelSequence ls1(origin1), ls2(origin2), ls3(origin3);
+
+    const boost::shared_ptr<NSEC3HashCache> cache1 =
+        table.getCache(ls1, *nsec3_data_);
+    const boost::shared_ptr<NSEC3HashCache> cache2 =
+        table.getCache(ls2, *nsec3_data_);
+    // Make the first zone the most recently used one, so the second one
+    // is removed for the third one.
+    EXPECT_EQ(cache1, table.getCache(ls1, *nsec3_data_));
+    table.getCache(ls3, *nsec3_data_);
+    EXPECT_EQ(2, table.getSize());
+    EXPECT_EQ(cache1, table.getCache(ls1, *nsec3_data_));
+    EXPECT_NE(cache2, table.getCache(ls2, *nsec3_data_));
+    EXPECT_EQ(2, table.getSize());
+
+    // Nothing is kept with zero capacity.
+    NSEC3HashCacheTable empty_table(0);
+    EXPECT_NE(empty_table.getCache(ls1, *nsec3_data_),
+              empty_table.getCache(ls1, *nsec3_data_));
+    EXPECT_EQ(0, empty_table.getSize());
+}
+
+}
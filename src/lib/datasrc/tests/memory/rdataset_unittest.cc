@@ -16,6 +16,7 @@
 
 #include <util/buffer.h>
 #include <util/memory_segment_local.h>
+#include <util/unittests/wiredata.h>
 
 #include <dns/rdata.h>
 #include <dns/rdataclass.h>
@@ -46,6 +47,7 @@ using std::string;
 using std::vector;
 using bundy::datasrc::memory::detail::SegmentObjectHolder;
 using boost::lexical_cast;
+using bundy::util::unittests::matchWireData;
 
 namespace {
 
@@ -162,6 +164,144 @@ TEST_F(RdataSetTest, create) {
     RdataSet::destroy(mem_sgmt_, rdataset, RRClass::IN());
 }
 
+// Append the given RRset's RDATAs in the plain form of the wire image
+// (i.e., RDLENGTH and RDATA) to the buffer.
+void
+renderImageEntries(const AbstractRRset& rrset,
+                   bundy::util::OutputBuffer& buffer)
+{
+    for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+         it->next()) {
+        buffer.writeUint16(it->getCurrent().getLength());
+        it->getCurrent().toWire(buffer);
+    }
+}
+
+TEST_F(RdataSetTest, createWithWireImage) {
+    // By default there's no wire image.
+    RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                          rrsig_rrset_);
+    EXPECT_EQ(static_cast<const uint8_t*>(NULL), rdataset->getWireImage());
+    EXPECT_EQ(0, rdataset->getWireImageLength());
+    EXPECT_FALSE(rdataset->hasWireImageNames());
+    RdataSet::destroy(mem_sgmt_, rdataset, RRClass::IN());
+
+    // Creating it with the wire image shouldn't change the rest of the data.
+    rdataset = RdataSet::create(mem_sgmt_, encoder_, a_rrset_, rrsig_rrset_,
+                                NULL, true);
+    checkRdataSet(*rdataset, def_rdata_txt_, def_rrsig_txt_);
+    ASSERT_NE(static_cast<const uint8_t*>(NULL), rdataset->getWireImage());
+    EXPECT_FALSE(rdataset->hasWireImageNames());
+
+    // Neither A nor RRSIG has a name to be compressed, so the image is
+    // simply a sequence of RDLENGTH and RDATA.
+    bundy::util::OutputBuffer expected(0);
+    renderImageEntries(*a_rrset_, expected);
+    renderImageEntries(*rrsig_rrset_, expected);
+    matchWireData(expected.getData(), expected.getLength(),
+                  rdataset->getWireImage(), rdataset->getWireImageLength());
+    RdataSet::destroy(mem_sgmt_, rdataset, RRClass::IN());
+}
+
+TEST_F(RdataSetTest, createWithWireImageNames) {
+    ConstRRsetPtr mx_rrset = textToRRset("example.com. 3600 IN MX "
+                                         "10 mx.example.com.");
+    RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, mx_rrset,
+                                          ConstRRsetPtr(), NULL, true);
+    EXPECT_TRUE(rdataset->hasWireImageNames());
+
+    // The single entry should consist of the preference as opaque data
+    // and the exchange name.
+    const uint8_t* const image = rdataset->getWireImage();
+    ASSERT_NE(static_cast<const uint8_t*>(NULL), image);
+    bundy::util::InputBuffer b(image, rdataset->getWireImageLength());
+    EXPECT_EQ(b.getLength() - sizeof(uint16_t), b.readUint16());
+    EXPECT_EQ(sizeof(uint16_t), b.readUint16());
+    EXPECT_EQ(10, b.readUint16());
+    EXPECT_EQ(RdataSet::WIRE_IMAGE_NAME |
+              NAMEATTR_COMPRESSIBLE | NAMEATTR_ADDITIONAL, b.readUint16());
+    const LabelSequence exchange(image + b.getPosition());
+    EXPECT_TRUE(exchange.equals(LabelSequence(Name("mx.example.com"))));
+    EXPECT_EQ(b.getLength(), b.getPosition() + exchange.getSerializedLength());
+    RdataSet::destroy(mem_sgmt_, rdataset, RRClass::IN());
+}
+
+TEST_F(RdataSetTest, copy) {
+    // A copy of a simple RdataSet should have the same data, but it's not
+    // linked to anything even if the original is.
+    SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, rrclass);
+    holder1.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_));
+    holder1.get()->next = holder1.get();
+    SegmentObjectHolder<RdataSet, RRClass> holder2(mem_sgmt_, rrclass);
+    holder2.set(RdataSet::copy(mem_sgmt_, *holder1.get(), rrclass));
+    EXPECT_NE(holder1.get(), holder2.get());
+    checkRdataSet(*holder2.get(), def_rdata_txt_, def_rrsig_txt_);
+    EXPECT_EQ(static_cast<const uint8_t*>(NULL),
+              holder2.get()->getWireImage());
+    holder1.get()->next = NULL;
+
+    // The wire image should be copied, too.
+    SegmentObjectHolder<RdataSet, RRClass> holder3(mem_sgmt_, rrclass);
+    holder3.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_, rrsig_rrset_,
+                                 NULL, true));
+    SegmentObjectHolder<RdataSet, RRClass> holder4(mem_sgmt_, rrclass);
+    holder4.set(RdataSet::copy(mem_sgmt_, *holder3.get(), rrclass));
+    checkRdataSet(*holder4.get(), def_rdata_txt_, def_rrsig_txt_);
+    ASSERT_NE(static_cast<const uint8_t*>(NULL),
+              holder4.get()->getWireImage());
+    EXPECT_NE(holder3.get()->getWireImage(), holder4.get()->getWireImage());
+    matchWireData(holder3.get()->getWireImage(),
+                  holder3.get()->getWireImageLength(),
+                  holder4.get()->getWireImage(),
+                  holder4.get()->getWireImageLength());
+}
+
+TEST_F(RdataSetTest, hasSameData) {
+    SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, rrclass);
+    holder1.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_));
+    // A copy or one created from the same RRsets has the same data, no
+    // matter how it's linked.
+    SegmentObjectHolder<RdataSet, RRClass> holder2(mem_sgmt_, rrclass);
+    holder2.set(RdataSet::copy(mem_sgmt_, *holder1.get(), rrclass));
+    holder2.get()->next = holder1.get();
+    EXPECT_TRUE(holder1.get()->hasSameData(*holder2.get(), rrclass));
+    holder2.get()->next = NULL;
+    SegmentObjectHolder<RdataSet, RRClass> holder3(mem_sgmt_, rrclass);
+    holder3.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_));
+    EXPECT_TRUE(holder3.get()->hasSameData(*holder1.get(), rrclass));
+
+    // Without the RRSIG, with a different TTL, different RDATA, or the wire
+    // image, the data differ.
+    SegmentObjectHolder<RdataSet, RRClass> holder4(mem_sgmt_, rrclass);
+    holder4.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 ConstRRsetPtr()));
+    EXPECT_FALSE(holder4.get()->hasSameData(*holder1.get(), rrclass));
+    EXPECT_FALSE(holder1.get()->hasSameData(*holder4.get(), rrclass));
+    SegmentObjectHolder<RdataSet, RRClass> holder5(mem_sgmt_, rrclass);
+    holder5.set(RdataSet::create(mem_sgmt_, encoder_,
+                                 textToRRset("www.example.com. 1800 IN A "
+                                             "192.0.2.1"),
+                                 rrsig_rrset_));
+    EXPECT_FALSE(holder5.get()->hasSameData(*holder1.get(), rrclass));
+    SegmentObjectHolder<RdataSet, RRClass> holder6(mem_sgmt_, rrclass);
+    holder6.set(RdataSet::create(mem_sgmt_, encoder_,
+                                 textToRRset("www.example.com. 1076895760 IN "
+                                             "A 192.0.2.2"),
+                                 rrsig_rrset_));
+    EXPECT_FALSE(holder6.get()->hasSameData(*holder1.get(), rrclass));
+    SegmentObjectHolder<RdataSet, RRClass> holder7(mem_sgmt_, rrclass);
+    holder7.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_, NULL, true));
+    EXPECT_FALSE(holder7.get()->hasSameData(*holder1.get(), rrclass));
+    SegmentObjectHolder<RdataSet, RRClass> holder8(mem_sgmt_, rrclass);
+    holder8.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_, NULL, true));
+    EXPECT_TRUE(holder7.get()->hasSameData(*holder8.get(), rrclass));
+}
+
 // This is similar to the simple create test, but we check all combinations
 // of old and new data.
 TEST_F(RdataSetTest, mergeCreate) {
@@ -311,6 +451,38 @@ TEST_F(RdataSetTest, subtract) {
                                        rrsig_rrsets, *holder_old.get()));
 }
 
+TEST_F(RdataSetTest, subtractWithWireImage) {
+    ConstRRsetPtr a_rrsets = textToRRset("www.example.com. 3600 IN A "
+                                         "192.0.2.1\n"
+                                         "www.example.com. 3600 IN A "
+                                         "192.0.2.2");
+    SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, rrclass);
+    holder1.set(RdataSet::create(mem_sgmt_, encoder_, a_rrsets, rrsig_rrset_,
+                                 NULL, true));
+
+    // The wire image of the new RdataSet should only contain the remaining
+    // data.
+    SegmentObjectHolder<RdataSet, RRClass> holder2(mem_sgmt_, rrclass);
+    holder2.set(RdataSet::subtract(mem_sgmt_, encoder_, a_rrset_,
+                                   ConstRRsetPtr(), *holder1.get(), true));
+    bundy::util::OutputBuffer expected(0);
+    renderImageEntries(*textToRRset("www.example.com. 3600 IN A 192.0.2.2"),
+                       expected);
+    renderImageEntries(*rrsig_rrset_, expected);
+    matchWireData(expected.getData(), expected.getLength(),
+                  holder2.get()->getWireImage(),
+                  holder2.get()->getWireImageLength());
+
+    // It can also be subtracted without the wire image.
+    SegmentObjectHolder<RdataSet, RRClass> holder3(mem_sgmt_, rrclass);
+    holder3.set(RdataSet::subtract(mem_sgmt_, encoder_, a_rrset_,
+                                   ConstRRsetPtr(), *holder1.get()));
+    EXPECT_EQ(static_cast<const uint8_t*>(NULL),
+              holder3.get()->getWireImage());
+    EXPECT_EQ(1, holder3.get()->getRdataCount());
+    EXPECT_EQ(1, holder3.get()->getSigRdataCount());
+}
+
 TEST_F(RdataSetTest, duplicate) {
     // Create RRset and RRSIG containing duplicate RDATA.
     ConstRRsetPtr dup_rrset =
@@ -449,7 +621,8 @@ RdataSetTest::checkCreateManyRRs(CreateFn create_fn, size_t n_old_rdata) {
 
 TEST_F(RdataSetTest, createManyRRs) {
     checkCreateManyRRs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                   static_cast<const RdataSet*>(NULL)), 0);
+                                   static_cast<const RdataSet*>(NULL),
+                                   false), 0);
 }
 
 TEST_F(RdataSetTest, mergeCreateManyRRs) {
@@ -458,7 +631,8 @@ TEST_F(RdataSetTest, mergeCreateManyRRs) {
     holder.set(RdataSet::create(mem_sgmt_, encoder_, rrset, ConstRRsetPtr()));
 
     checkCreateManyRRs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                   holder.get()), rrset->getRdataCount());
+                                   holder.get(), false),
+                       rrset->getRdataCount());
 }
 
 TEST_F(RdataSetTest, createWithRRSIG) {
@@ -541,7 +715,16 @@ RdataSetTest::checkCreateManyRRSIGs(CreateFn create_fn, size_t n_old_sig) {
 
 TEST_F(RdataSetTest, createManyRRSIGs) {
     checkCreateManyRRSIGs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                      static_cast<const RdataSet*>(NULL)), 0);
+                                      static_cast<const RdataSet*>(NULL),
+                                      false), 0);
+}
+
+TEST_F(RdataSetTest, createManyRRSIGsWithWireImage) {
+    // The number of RRSIGs is stored in the same extended header as the
+    // information of the wire image, so they should work together.
+    checkCreateManyRRSIGs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
+                                      static_cast<const RdataSet*>(NULL),
+                                      true), 0);
 }
 
 TEST_F(RdataSetTest, mergeCreateManyRRSIGs) {
@@ -554,7 +737,23 @@ TEST_F(RdataSetTest, mergeCreateManyRRSIGs) {
     holder.set(RdataSet::create(mem_sgmt_, encoder_, ConstRRsetPtr(), rrsig));
 
     checkCreateManyRRSIGs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                      holder.get()), rrsig->getRdataCount());
+                                      holder.get(), false),
+                          rrsig->getRdataCount());
+}
+
+TEST_F(RdataSetTest, copyManyRRSIGs) {
+    // The extra sig count field should be copied, too.
+    SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, rrclass);
+    holder1.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 getRRSIGWithRdataCount(8), NULL, true));
+    SegmentObjectHolder<RdataSet, RRClass> holder2(mem_sgmt_, rrclass);
+    holder2.set(RdataSet::copy(mem_sgmt_, *holder1.get(), rrclass));
+    EXPECT_EQ(1, holder2.get()->getRdataCount());
+    EXPECT_EQ(8, holder2.get()->getSigRdataCount());
+    matchWireData(holder1.get()->getWireImage(),
+                  holder1.get()->getWireImageLength(),
+                  holder2.get()->getWireImage(),
+                  holder2.get()->getWireImageLength());
 }
 
 TEST_F(RdataSetTest, createWithRRSIGOnly) {
@@ -611,7 +810,7 @@ RdataSetTest::checkBadCreate(CreateFn create_fn) {
 
 TEST_F(RdataSetTest, badCreate) {
     checkBadCreate(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                               static_cast<const RdataSet*>(NULL)));
+                               static_cast<const RdataSet*>(NULL), false));
 }
 
 TEST_F(RdataSetTest, badMergeCreate) {
@@ -623,7 +822,7 @@ TEST_F(RdataSetTest, badMergeCreate) {
                          ConstRRsetPtr()));
 
     checkBadCreate(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                               holder.get()));
+                               holder.get(), false));
 
     // Type mismatch: this case is specific to the merge create.
     EXPECT_THROW(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
@@ -26,6 +26,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <string>
@@ -520,6 +521,65 @@ TEST_F(TreeNodeRRsetTest, toWireTruncated) {
                       0);   // no RR
 }
 
+// Rendering RdataSets that have the wire image.  The result should be the
+// same as the normal case.
+TEST_F(TreeNodeRRsetTest, toWireWithWireImage) {
+    MessageRenderer expected_renderer, actual_renderer;
+    // MX, whose RDATA contains compressible names.
+    const ConstRRsetPtr mx_rrset =
+        textToRRset("example.com. 3600 IN MX 10 mx.example.com.\n"
+                    "example.com. 3600 IN MX 20 mx.example.org.");
+    const ConstRRsetPtr null_rrset;
+    const ConstRRsetPtr rrsets[] = {
+        a_rrset_, aaaa_rrset_, ns_rrset_, dname_rrset_, mx_rrset, null_rrset
+    };
+    const ConstRRsetPtr sig_rrsets[] = {
+        a_rrsig_rrset_, aaaa_rrsig_rrset_, null_rrset, null_rrset, null_rrset,
+        txt_rrsig_rrset_
+    };
+    ZoneNode* const nodes[] = {
+        www_node_, www_node_, origin_node_, origin_node_, origin_node_,
+        www_node_
+    };
+
+    for (size_t i = 0; i < sizeof(rrsets) / sizeof(rrsets[0]); ++i) {
+        RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, rrsets[i],
+                                              sig_rrsets[i], NULL, true);
+        for (int dnssec_ok = 0; dnssec_ok < 2; ++dnssec_ok) {
+            SCOPED_TRACE("wire image case " +
+                         boost::lexical_cast<string>(i) +
+                         (dnssec_ok ? ", DNSSEC OK" : ", DNSSEC not OK"));
+            const TreeNodeRRset rrset(rrclass_, nodes[i], rdataset,
+                                      dnssec_ok);
+            // Prepending "example.org" checks both compressible and
+            // uncompressible (DNAME) names in RDATA.
+            checkToWireResult(expected_renderer, actual_renderer, rrset,
+                              Name("example.org"), rrsets[i], sig_rrsets[i],
+                              dnssec_ok);
+
+            const size_t expected_len =
+                (rrsets[i] ? rrsets[i]->getLength() : 0) +
+                ((dnssec_ok && sig_rrsets[i]) ?
+                 sig_rrsets[i]->getLength() : 0);
+            EXPECT_EQ(expected_len, rrset.getLength());
+        }
+        RdataSet::destroy(mem_sgmt_, rdataset, rrclass_);
+    }
+
+    // Truncation, similar to the toWireTruncated test.
+    RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, aaaa_rrset_,
+                                          aaaa_rrsig_rrset_, NULL, true);
+    expected_renderer.clear();
+    aaaa_rrset_->toWire(expected_renderer);
+    a_rrsig_rrset_->toWire(expected_renderer);
+    checkToWireResult(expected_renderer, actual_renderer,
+                      *createRRset(rrclass_, www_node_, rdataset, true),
+                      Name::ROOT_NAME(), aaaa_rrset_, aaaa_rrsig_rrset_, true,
+                      expected_renderer.getLength(),
+                      2);   // 1 main RR, 1 RRSIG
+    RdataSet::destroy(mem_sgmt_, rdataset, rrclass_);
+}
+
 void
 checkRdataIterator(const vector<string>& expected, RdataIteratorPtr rit) {
     for (vector<string>::const_iterator it = expected.begin();
@@ -19,6 +19,7 @@
 #include <datasrc/memory/zone_data.h>
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/memory/segment_object_holder.h>
+#include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/client.h>
 #include <datasrc/zone_iterator.h>
 
@@ -39,8 +40,11 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <vector>
 
+#include <unistd.h>
+
 using namespace bundy::dns;
 using namespace bundy::datasrc;
 using namespace bundy::datasrc::memory;
@@ -132,9 +136,9 @@ public:
             }
             diffs_.push_back(soa); // add new SOA
             diffs_.push_back(ns); // add new NS
-            it_ = diffs_.begin();
         }
         diffs_.push_back(ConstRRsetPtr());
+        it_ = diffs_.begin();
     }
     virtual ConstRRsetPtr getNextDiff() {
         const ConstRRsetPtr result = *it_;
@@ -422,6 +426,305 @@ TEST_F(ZoneDataLoaderTest, loadToBeNSEC3Unsigned) {
     EXPECT_FALSE(zone_data_->isNSEC3Signed());
 }
 
+// Return the SOA serial of the given zone data.
+uint32_t
+getSerial(const ZoneData& zone_data) {
+    const ZoneNode* origin_node = zone_data.getOriginNode();
+    const RdataSet* rdataset = RdataSet::find(origin_node->getData(),
+                                              RRType::SOA());
+    EXPECT_NE(static_cast<const RdataSet*>(NULL), rdataset);
+    const TreeNodeRRset rrset(RRClass::IN(), origin_node, rdataset, false);
+    return (dynamic_cast<const rdata::generic::SOA&>(
+                rrset.getRdataIterator()->getCurrent()).getSerial().
+            getValue());
+}
+
+TEST_F(ZoneDataLoaderTest, loadFromJournalCopyOnWrite) {
+    const Name origin("example.com");
+    MockDataSourceClient dsc;
+    dsc.use_nsec3_ = true;
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, dsc).load();
+
+    // In the copy-on-write mode, diffs are applied to a copy of the old data
+    // in load(), and the old data are intact.
+    dsc.serial_ = 12;
+    dsc.use_journal_ = true;
+    dsc.remove_nsec3_ = true;
+    ZoneDataLoader loader1(mem_sgmt_, zclass_, origin, dsc, zone_data_,
+                           false, false, true);
+    EXPECT_FALSE(loader1.isDataReused());
+    EXPECT_TRUE(loader1.isDataShared());
+    ZoneData* const new_data = loader1.load();
+    ASSERT_TRUE(new_data);
+    EXPECT_NE(zone_data_, new_data);
+    EXPECT_EQ(1, getSerial(*zone_data_));
+    EXPECT_TRUE(zone_data_->isNSEC3Signed());
+    EXPECT_EQ(12, getSerial(*new_data));
+    EXPECT_FALSE(new_data->isNSEC3Signed());
+
+    // commit() has nothing to do.
+    EXPECT_EQ(new_data, loader1.commit(new_data));
+
+    // Replace the old data with the new ones.
+    zone_data_->detachSharedData(*new_data);
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+    zone_data_ = new_data;
+
+    // If the journal is broken, load() fails, but the old data are intact
+    // and the partial copy doesn't leak (which TearDown() would detect).
+    dsc.serial_ = 15;
+    dsc.remove_nsec3_ = false;
+    dsc.use_broken_journal_ = true;
+    ZoneDataLoader loader2(mem_sgmt_, zclass_, origin, dsc, zone_data_,
+                           false, false, true);
+    EXPECT_THROW(loader2.load(), ZoneDataUpdater::RemoveError);
+    EXPECT_EQ(12, getSerial(*zone_data_));
+}
+
+TEST_F(ZoneDataLoaderTest, loadFromJournalCopyOnWriteExceptionSafety) {
+    const Name origin("example.com");
+    MockDataSourceClient dsc;
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, dsc).load();
+
+    // Make the copy or update fail at every possible allocation.
+    dsc.serial_ = 3;
+    dsc.use_journal_ = true;
+    ZoneData* new_data = NULL;
+    for (int count = 1; new_data == NULL; ++count) {
+        ZoneDataLoader loader(mem_sgmt_, zclass_, origin, dsc, zone_data_,
+                              false, false, true);
+        mem_sgmt_.setThrowCount(count);
+        try {
+            new_data = loader.load();
+        } catch (const std::bad_alloc&) {
+            EXPECT_EQ(1, getSerial(*zone_data_));
+        }
+    }
+    mem_sgmt_.setThrowCount(0);
+    EXPECT_EQ(3, getSerial(*new_data));
+    zone_data_->detachSharedData(*new_data);
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+    zone_data_ = new_data;
+}
+
+const char* const DELTA_ZONE_FILE = TEST_DATA_BUILDDIR "/delta-load.zone";
+
+void
+writeZoneFile(const char* const zone_text) {
+    std::ofstream ofs(DELTA_ZONE_FILE, std::ios::trunc);
+    ofs << zone_text;
+    ASSERT_TRUE(ofs);
+}
+
+const char* const DELTA_ZONE_V1 =
+    "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+    "1 3600 900 604800 3600\n"
+    "example.org. 3600 IN NS ns.example.org.\n"
+    "ns.example.org. 3600 IN A 192.0.2.1\n"
+    "mail.example.org. 3600 IN A 192.0.2.2\n"
+    "mail.example.org. 3600 IN AAAA 2001:db8::2\n"
+    "old.example.org. 3600 IN A 192.0.2.3\n"
+    "www.example.org. 3600 IN A 192.0.2.4\n";
+
+const char* const DELTA_ZONE_V2 =
+    "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+    "2 3600 900 604800 3600\n"
+    "example.org. 3600 IN NS ns.example.org.\n"
+    "ns.example.org. 3600 IN A 192.0.2.1\n"
+    "mail.example.org. 3600 IN A 192.0.2.2\n"
+    "mail.example.org. 1800 IN AAAA 2001:db8::2\n"
+    "new.example.org. 3600 IN A 192.0.2.5\n"
+    "www.example.org. 3600 IN A 192.0.2.4\n"
+    "www.example.org. 3600 IN A 192.0.2.6\n";
+
+// Return the RdataSet of the given name and type in the zone data, or NULL
+// if there's no such RdataSet.
+const RdataSet*
+findRdataSet(const ZoneData& zone_data, const Name& name, const RRType& type)
+{
+    const ZoneNode* node = NULL;
+    if (zone_data.getZoneTree().find(name, &node) != ZoneTree::EXACTMATCH) {
+        return (NULL);
+    }
+    return (RdataSet::find(node->getData(), type));
+}
+
+// Check the zone data have the second version of the delta zone.
+void
+checkDeltaZoneV2(const ZoneData& zone_data) {
+    EXPECT_EQ(2, getSerial(zone_data));
+    EXPECT_FALSE(findRdataSet(zone_data, Name("old.example.org"),
+                              RRType::A()));
+    EXPECT_TRUE(findRdataSet(zone_data, Name("new.example.org"),
+                             RRType::A()));
+    const RdataSet* rdataset = findRdataSet(zone_data,
+                                            Name("www.example.org"),
+                                            RRType::A());
+    ASSERT_TRUE(rdataset);
+    EXPECT_EQ(2, rdataset->getRdataCount());
+    rdataset = findRdataSet(zone_data, Name("mail.example.org"),
+                            RRType::AAAA());
+    ASSERT_TRUE(rdataset);
+    bundy::util::InputBuffer b(rdataset->getTTLData(), sizeof(uint32_t));
+    EXPECT_EQ(RRTTL(1800), RRTTL(b));
+}
+
+TEST_F(ZoneDataLoaderTest, loadDeltaFromFile) {
+    const Name origin("example.org");
+    writeZoneFile(DELTA_ZONE_V1);
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE).
+        load();
+    const RdataSet* const ns_rdataset =
+        findRdataSet(*zone_data_, origin, RRType::NS());
+    const RdataSet* const mail_rdataset =
+        findRdataSet(*zone_data_, Name("mail.example.org"), RRType::A());
+
+    // Only the differences are applied to the old data in commit(), so the
+    // unchanged RdataSets are kept as they were.  The second time the same
+    // version is loaded again (incrementally), which changes nothing.
+    writeZoneFile(DELTA_ZONE_V2);
+    for (int i = 0; i < 2; ++i) {
+        const bool incremental = (i == 1);
+        ZoneDataLoader loader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                              zone_data_, false, false, 1, false, true);
+        EXPECT_TRUE(loader.isDataReused());
+        EXPECT_EQ(zone_data_, checkLoad(loader, incremental));
+        EXPECT_EQ(1 + i, getSerial(*zone_data_)); // not applied yet
+        EXPECT_EQ(zone_data_, loader.commit(zone_data_));
+        checkDeltaZoneV2(*zone_data_);
+        EXPECT_EQ(ns_rdataset, findRdataSet(*zone_data_, origin,
+                                            RRType::NS()));
+        EXPECT_EQ(mail_rdataset, findRdataSet(*zone_data_,
+                                              Name("mail.example.org"),
+                                              RRType::A()));
+    }
+
+    // Without delta_load the old data are fully replaced as usual.
+    ZoneDataLoader loader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                          zone_data_, false, false, 1, false, false);
+    EXPECT_FALSE(loader.isDataReused());
+    ZoneData* const new_data = loader.load();
+    EXPECT_NE(zone_data_, new_data);
+    checkDeltaZoneV2(*new_data);
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+    zone_data_ = new_data;
+
+    // Broken new version: load() fails and the old data are intact.
+    writeZoneFile("example.org. 3600 IN NS ns.example.org.\n");
+    ZoneDataLoader loader2(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                           zone_data_, false, false, 1, false, true);
+    EXPECT_THROW(loader2.load(), ZoneValidationError);
+    checkDeltaZoneV2(*zone_data_);
+
+    EXPECT_EQ(0, unlink(DELTA_ZONE_FILE));
+}
+
+TEST_F(ZoneDataLoaderTest, loadDeltaFromFileCopyOnWrite) {
+    const Name origin("example.org");
+    writeZoneFile(DELTA_ZONE_V1);
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE).
+        load();
+
+    // The differences are applied to a copy, which shares the RdataSets of
+    // the unchanged names with the old data.
+    writeZoneFile(DELTA_ZONE_V2);
+    ZoneDataLoader loader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                          zone_data_, false, false, 1, true, true);
+    EXPECT_FALSE(loader.isDataReused());
+    EXPECT_TRUE(loader.isDataShared());
+    ZoneData* const new_data = loader.load();
+    ASSERT_TRUE(new_data);
+    EXPECT_NE(zone_data_, new_data);
+    EXPECT_EQ(new_data, loader.commit(new_data));
+    EXPECT_EQ(1, getSerial(*zone_data_));
+    checkDeltaZoneV2(*new_data);
+    EXPECT_EQ(findRdataSet(*zone_data_, Name("ns.example.org"),
+                           RRType::A()),
+              findRdataSet(*new_data, Name("ns.example.org"), RRType::A()));
+
+    zone_data_->detachSharedData(*new_data);
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+    zone_data_ = new_data;
+    EXPECT_EQ(0, unlink(DELTA_ZONE_FILE));
+}
+
+TEST_F(ZoneDataLoaderTest, loadDeltaNSEC3ParametersChange) {
+    const Name origin("example.org");
+    writeZoneFile(
+        "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+        "1 3600 900 604800 3600\n"
+        "example.org. 3600 IN NS ns.example.org.\n"
+        "example.org. 3600 IN NSEC3PARAM 1 0 10 AABBCCDD\n"
+        "09GM5T42SMIMVF6IH3H2ANQGHJ6D9K1B.example.org. 3600 IN NSEC3 "
+        "1 0 10 AABBCCDD 09GM5T42SMIMVF6IH3H2ANQGHJ6D9K1B NS SOA\n");
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE).
+        load();
+    ASSERT_TRUE(zone_data_->isNSEC3Signed());
+
+    // All NSEC3 RRs and the NSEC3PARAM are replaced with those of the new
+    // parameters, which replaces the NSEC3 data.
+    writeZoneFile(
+        "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+        "2 3600 900 604800 3600\n"
+        "example.org. 3600 IN NS ns.example.org.\n"
+        "example.org. 3600 IN NSEC3PARAM 1 0 5 -\n"
+        "A7BD2CVR0HQL4G8P5KRN4AH83BM1A4EL.example.org. 3600 IN NSEC3 "
+        "1 0 5 - A7BD2CVR0HQL4G8P5KRN4AH83BM1A4EL NS SOA\n");
+    ZoneDataLoader loader(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                          zone_data_, false, false, 1, false, true);
+    EXPECT_EQ(zone_data_, loader.load());
+    EXPECT_EQ(zone_data_, loader.commit(zone_data_));
+    ASSERT_TRUE(zone_data_->isNSEC3Signed());
+    EXPECT_EQ(5, zone_data_->getNSEC3Data()->iterations);
+    EXPECT_EQ(0, zone_data_->getNSEC3Data()->getSaltLen());
+
+    // And to NSEC3-unsigned.
+    writeZoneFile(
+        "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+        "3 3600 900 604800 3600\n"
+        "example.org. 3600 IN NS ns.example.org.\n");
+    ZoneDataLoader loader2(mem_sgmt_, zclass_, origin, DELTA_ZONE_FILE,
+                           zone_data_, false, false, 1, false, true);
+    EXPECT_EQ(zone_data_, loader2.load());
+    EXPECT_EQ(zone_data_, loader2.commit(zone_data_));
+    EXPECT_FALSE(zone_data_->isNSEC3Signed());
+    EXPECT_EQ(3, getSerial(*zone_data_));
+
+    EXPECT_EQ(0, unlink(DELTA_ZONE_FILE));
+}
+
+TEST_F(ZoneDataLoaderTest, loadDeltaFromDataSource) {
+    const Name origin("example.com");
+    MockDataSourceClient dsc;
+    dsc.use_nsec3_ = true;
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, dsc).load();
+    const RdataSet* const ns_rdataset =
+        findRdataSet(*zone_data_, origin, RRType::NS());
+
+    // Without a journal, the differences from the iterator are applied,
+    // removing the NSEC3PARAM.
+    dsc.serial_ = 2;
+    dsc.use_nsec3_ = false;
+    ZoneDataLoader loader(mem_sgmt_, zclass_, origin, dsc, zone_data_,
+                          false, false, false, true);
+    EXPECT_TRUE(loader.isDataReused());
+    EXPECT_EQ(zone_data_, checkLoad(loader, true));
+    EXPECT_EQ(zone_data_, loader.commit(zone_data_));
+    EXPECT_EQ(2, getSerial(*zone_data_));
+    EXPECT_FALSE(zone_data_->isNSEC3Signed());
+    EXPECT_EQ(ns_rdataset, findRdataSet(*zone_data_, origin, RRType::NS()));
+
+    // The journal is preferred if it's available.
+    dsc.serial_ = 3;
+    dsc.use_journal_ = true;
+    ZoneDataLoader loader2(mem_sgmt_, zclass_, origin, dsc, zone_data_,
+                           false, false, false, true);
+    EXPECT_TRUE(loader2.isDataReused());
+    EXPECT_EQ(zone_data_, checkLoad(loader2, true, true));
+    EXPECT_EQ(zone_data_, loader2.commit(zone_data_));
+    EXPECT_EQ(3, getSerial(*zone_data_));
+}
+
 // Load bunch of small zones, hoping some of the relocation will happen
 // during the memory creation, not only Rdata creation.
 // Note: this doesn't even compile unless USE_SHARED_MEMORY is defined.
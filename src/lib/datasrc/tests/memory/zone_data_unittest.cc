@@ -33,8 +33,11 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/lexical_cast.hpp>
+
 #include <new>                  // for bad_alloc
 #include <string>
+#include <vector>
 
 using namespace bundy::dns;
 using namespace bundy::dns::rdata;
@@ -286,6 +289,114 @@ TEST_F(ZoneDataTest, minTTL) {
     EXPECT_EQ(RRTTL(1200), createRRTTL(zone_data_->getMinTTLData()));
 }
 
+TEST_F(ZoneDataTest, createCopy) {
+    ZoneNode* node = NULL;
+    zone_data_->insertName(mem_sgmt_, a_rrset_->getName(), &node);
+    RdataSet* rdataset_a =
+        RdataSet::create(mem_sgmt_, encoder_, a_rrset_, ConstRRsetPtr());
+    node->setData(rdataset_a);
+    zone_data_->insertName(mem_sgmt_, Name("wild.example.com"), &node);
+    node->setFlag(ZoneData::WILDCARD_NODE);
+    zone_data_->insertName(mem_sgmt_, Name("sub.example.com"), &node);
+    node->setFlag(ZoneNode::FLAG_CALLBACK);
+    zone_data_->setSigned(true);
+    zone_data_->setMinTTL(1200);
+    NSEC3Data* nsec3_data = NSEC3Data::create(mem_sgmt_, zname_, param_rdata_);
+    zone_data_->setNSEC3Data(nsec3_data);
+    nsec3_data->insertName(mem_sgmt_, nsec3_rrset_->getName(), &node);
+    RdataSet* rdataset_nsec3 =
+        RdataSet::create(mem_sgmt_, encoder_, nsec3_rrset_, ConstRRsetPtr());
+    node->setData(rdataset_nsec3);
+
+    ZoneData* copy = ZoneData::createCopy(mem_sgmt_, *zone_data_,
+                                          RRClass::IN());
+    EXPECT_NE(zone_data_, copy);
+    EXPECT_EQ(zone_data_->getZoneTree().getNodeCount(),
+              copy->getZoneTree().getNodeCount());
+    EXPECT_TRUE(copy->isSigned());
+    EXPECT_EQ(RRTTL(1200), createRRTTL(copy->getMinTTLData()));
+
+    // The nodes are copied with their flags, but the data are shared.
+    node = copy->findName(a_rrset_->getName());
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_NE(zone_data_->findName(a_rrset_->getName()), node);
+    EXPECT_EQ(rdataset_a, node->getData());
+    node = copy->findName(Name("wild.example.com"));
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_TRUE(node->getFlag(ZoneData::WILDCARD_NODE));
+    node = copy->findName(Name("sub.example.com"));
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_TRUE(node->getFlag(ZoneNode::FLAG_CALLBACK));
+
+    // Same for the NSEC3 data.
+    ASSERT_TRUE(copy->isNSEC3Signed());
+    NSEC3Data* nsec3_copy = copy->getNSEC3Data();
+    EXPECT_NE(nsec3_data, nsec3_copy);
+    EXPECT_EQ(nsec3_data->hashalg, nsec3_copy->hashalg);
+    EXPECT_EQ(nsec3_data->flags, nsec3_copy->flags);
+    EXPECT_EQ(nsec3_data->iterations, nsec3_copy->iterations);
+    ASSERT_EQ(nsec3_data->getSaltLen(), nsec3_copy->getSaltLen());
+    EXPECT_EQ(0, memcmp(nsec3_data->getSaltData(), nsec3_copy->getSaltData(),
+                        nsec3_data->getSaltLen()));
+    node = nsec3_copy->findName(nsec3_rrset_->getName());
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_EQ(rdataset_nsec3, node->getData());
+
+    // Give a name in the copy its own data, as an updater would do.  Only
+    // the shared data are detached, so destroying the copy releases the
+    // new data (TearDown() would detect a leak) but keeps the original.
+    // The size of the shared data is the same from both sides, and doesn't
+    // include the data of the copy.
+    const size_t a_size = rdataset_a->getAllocatedSize(RRClass::IN());
+    const size_t nsec3_size = rdataset_nsec3->getAllocatedSize(RRClass::IN());
+    EXPECT_EQ(a_size + nsec3_size,
+              zone_data_->getSharedDataSize(*copy, RRClass::IN()));
+    node = copy->findName(a_rrset_->getName());
+    RdataSet* rdataset_aaaa =
+        RdataSet::create(mem_sgmt_, encoder_, aaaa_rrset_, ConstRRsetPtr());
+    node->setData(rdataset_aaaa);
+    EXPECT_EQ(nsec3_size, zone_data_->getSharedDataSize(*copy, RRClass::IN()));
+    EXPECT_EQ(nsec3_size, copy->getSharedDataSize(*zone_data_, RRClass::IN()));
+    copy->detachSharedData(*zone_data_);
+    ZoneData::destroy(mem_sgmt_, copy, RRClass::IN());
+    checkFindRdataSet(zone_data_->getZoneTree(), a_rrset_->getName(),
+                      RRType::A(), rdataset_a);
+    node = zone_data_->getNSEC3Data()->findName(nsec3_rrset_->getName());
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_EQ(rdataset_nsec3, node->getData());
+}
+
+TEST_F(ZoneDataTest, createCopyExceptionSafety) {
+    ZoneNode* node = NULL;
+    zone_data_->insertName(mem_sgmt_, a_rrset_->getName(), &node);
+    RdataSet* rdataset_a =
+        RdataSet::create(mem_sgmt_, encoder_, a_rrset_, ConstRRsetPtr());
+    node->setData(rdataset_a);
+    NSEC3Data* nsec3_data = NSEC3Data::create(mem_sgmt_, zname_, param_rdata_);
+    zone_data_->setNSEC3Data(nsec3_data);
+    nsec3_data->insertName(mem_sgmt_, nsec3_rrset_->getName(), &node);
+    node->setData(RdataSet::create(mem_sgmt_, encoder_, nsec3_rrset_,
+                                   ConstRRsetPtr()));
+
+    // Make the copy fail at every possible allocation.  The original should
+    // be intact, and the partial copy shouldn't leak (checked in TearDown()).
+    ZoneData* copy = NULL;
+    for (int count = 1; copy == NULL; ++count) {
+        mem_sgmt_.setThrowCount(count);
+        try {
+            copy = ZoneData::createCopy(mem_sgmt_, *zone_data_,
+                                        RRClass::IN());
+        } catch (const std::bad_alloc&) {
+            checkFindRdataSet(zone_data_->getZoneTree(), a_rrset_->getName(),
+                              RRType::A(), rdataset_a);
+            EXPECT_EQ(nsec3_data, zone_data_->getNSEC3Data());
+        }
+    }
+    mem_sgmt_.setThrowCount(0);
+    copy->detachSharedData(*zone_data_);
+    ZoneData::destroy(mem_sgmt_, copy, RRClass::IN());
+}
+
 TEST_F(ZoneDataTest, emptyData) {
     // normally create zone data are never "empty"
     EXPECT_FALSE(zone_data_->isEmpty());
@@ -350,6 +461,25 @@ TEST_F(ZoneDataTest, removeNode) {
     removeCommon<ZoneData>(*zone_data_, zone_data_->findName(zname_));
 }
 
+TEST_F(ZoneDataTest, removeIndexedNode) {
+    ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+    zone_data_ = NULL;
+    zone_data_ = ZoneData::create(mem_sgmt_, zname_, true);
+    removeCommon<ZoneData>(*zone_data_, zone_data_->findName(zname_));
+
+    // Removed names, including the empty upper node removed by the tree,
+    // shouldn't remain in the index.
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("b.b.example.com"))));
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("b.example.com"))));
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("a.example.com"))));
+    EXPECT_EQ(zone_data_->findName(Name("www.example.com")),
+              zone_data_->findIndexedName(
+                  LabelSequence(Name("www.example.com"))));
+}
+
 TEST_F(ZoneDataTest, removeNSEC3Node) {
     NSEC3Data* nsec3_data = NSEC3Data::create(mem_sgmt_, zname_, param_rdata_);
     EXPECT_TRUE(nsec3_data->isEmpty());   // initially it's considered empty
@@ -358,4 +488,140 @@ TEST_F(ZoneDataTest, removeNSEC3Node) {
     removeCommon<NSEC3Data>(*nsec3_data, nsec3_data->findName(zname_));
 }
 
+TEST_F(ZoneDataTest, nameIndex) {
+    // By default the zone data don't have the index.
+    EXPECT_FALSE(zone_data_->hasNameIndex());
+    ZoneNode* node = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("www.example.com"), &node);
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("www.example.com"))));
+    ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+    zone_data_ = NULL;
+
+    zone_data_ = ZoneData::create(mem_sgmt_, zname_, true);
+    EXPECT_TRUE(zone_data_->hasNameIndex());
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("www.example.com"))));
+
+    // Inserted names are indexed, and the search is case-insensitive.
+    zone_data_->insertName(mem_sgmt_, Name("www.example.com"), &node);
+    EXPECT_EQ(node, zone_data_->findIndexedName(
+                  LabelSequence(Name("WWW.Example.COM"))));
+    EXPECT_EQ(node, zone_data_->findName(Name("www.example.com")));
+    EXPECT_TRUE(node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+
+    // The origin is indexed when it's explicitly inserted.
+    ZoneNode* origin_node = NULL;
+    zone_data_->insertName(mem_sgmt_, zname_, &origin_node);
+    EXPECT_EQ(zone_data_->getOriginNode(), origin_node);
+    EXPECT_EQ(origin_node, zone_data_->findIndexedName(LabelSequence(zname_)));
+
+    // Non-terminals created by the tree (on splitting a node here) aren't
+    // indexed, but can be found in the tree.  The split node is still
+    // found in the index.
+    ZoneNode* deep_node = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("a.b.c.example.com"), &deep_node);
+    zone_data_->insertName(mem_sgmt_, Name("x.b.c.example.com"), &node);
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("b.c.example.com"))));
+    ZoneNode* nonterminal = zone_data_->findName(Name("b.c.example.com"));
+    ASSERT_TRUE(nonterminal);
+
+    // Inserting it explicitly adds it to the index.
+    ZoneNode* node2 = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("b.c.example.com"), &node2);
+    EXPECT_EQ(nonterminal, node2);
+    EXPECT_EQ(nonterminal, zone_data_->findIndexedName(
+                  LabelSequence(Name("b.c.example.com"))));
+    EXPECT_EQ(deep_node, zone_data_->findIndexedName(
+                  LabelSequence(Name("a.b.c.example.com"))));
+}
+
+TEST_F(ZoneDataTest, nameIndexDelegation) {
+    ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+    zone_data_ = NULL;
+    zone_data_ = ZoneData::create(mem_sgmt_, zname_, true);
+
+    ZoneNode* deleg_node = NULL;
+    ZoneNode* below_node = NULL;
+    ZoneNode* other_node = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("child.example.com"), &deleg_node);
+    zone_data_->insertName(mem_sgmt_, Name("ns.child.example.com"),
+                           &below_node);
+    zone_data_->insertName(mem_sgmt_, Name("www.example.com"), &other_node);
+    EXPECT_TRUE(below_node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+
+    // Marking a delegation clears the flag of the existing nodes below it,
+    // but not of the node itself or other nodes.
+    zone_data_->setDelegation(deleg_node);
+    EXPECT_TRUE(deleg_node->getFlag(ZoneNode::FLAG_CALLBACK));
+    EXPECT_TRUE(deleg_node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+    EXPECT_FALSE(below_node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+    EXPECT_TRUE(other_node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+
+    // Nodes inserted below it later don't have the flag either.
+    ZoneNode* node = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("a.b.child.example.com"), &node);
+    EXPECT_FALSE(node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+    EXPECT_EQ(node, zone_data_->findIndexedName(
+                  LabelSequence(Name("a.b.child.example.com"))));
+
+    // Without the index, it's just setting the callback flag.
+    ZoneData* zone_data = ZoneData::create(mem_sgmt_, zname_);
+    zone_data->insertName(mem_sgmt_, Name("child.example.com"), &deleg_node);
+    zone_data->insertName(mem_sgmt_, Name("ns.child.example.com"),
+                          &below_node);
+    zone_data->setDelegation(deleg_node);
+    EXPECT_TRUE(deleg_node->getFlag(ZoneNode::FLAG_CALLBACK));
+    EXPECT_FALSE(below_node->getFlag(ZoneData::NO_DELEGATION_ABOVE));
+    ZoneData::destroy(mem_sgmt_, zone_data, RRClass::IN());
+}
+
+TEST_F(ZoneDataTest, nameIndexManyNames) {
+    ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+    zone_data_ = NULL;
+    zone_data_ = ZoneData::create(mem_sgmt_, zname_, true);
+
+    // Insert enough names to let the index grow a few times, then remove
+    // every other one.  All others should still be found in the index.
+    std::vector<ZoneNode*> nodes;
+    for (int i = 0; i < 1000; ++i) {
+        ZoneNode* node = NULL;
+        zone_data_->insertName(mem_sgmt_,
+                               Name("n" + boost::lexical_cast<std::string>(i)
+                                    + ".example.com"), &node);
+        nodes.push_back(node);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        zone_data_->removeNode(mem_sgmt_, nodes[i]);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        const Name name("n" + boost::lexical_cast<std::string>(i) +
+                        ".example.com");
+        EXPECT_EQ((i % 2) == 0 ? NULL : nodes[i],
+                  zone_data_->findIndexedName(LabelSequence(name)));
+    }
+}
+
+TEST_F(ZoneDataTest, nameIndexExceptionSafety) {
+    ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+    zone_data_ = NULL;
+    zone_data_ = ZoneData::create(mem_sgmt_, zname_, true);
+
+    // Allocating the tree node succeeds, but allocating the index fails.
+    // The node is in the tree but not in the index.
+    ZoneNode* node = NULL;
+    mem_sgmt_.setThrowCount(2);
+    EXPECT_THROW(zone_data_->insertName(mem_sgmt_, Name("www.example.com"),
+                                        &node), std::bad_alloc);
+    EXPECT_FALSE(zone_data_->findIndexedName(
+                     LabelSequence(Name("www.example.com"))));
+    ASSERT_TRUE(zone_data_->findName(Name("www.example.com")));
+
+    // Inserting it again adds it to the index.
+    zone_data_->insertName(mem_sgmt_, Name("www.example.com"), &node);
+    EXPECT_EQ(node, zone_data_->findIndexedName(
+                  LabelSequence(Name("www.example.com"))));
+}
+
 }
@@ -519,4 +519,89 @@ TEST_P(ZoneDataUpdaterTest, removeNSEC3) {
                  ZoneDataUpdater::RemoveError);
 }
 
+
+TEST_P(ZoneDataUpdaterTest, copyOnWrite) {
+    const std::string nsec3spec(" 5 IN NSEC3 1 0 12 aabbccdd TDK23RP6 A");
+    updater_->add(textToRRset("a.example.org. 5 IN A 192.0.2.1"),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("a.example.org. 5 IN TXT text-data"),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("b.example.org. 5 IN A 192.0.2.2"),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("c.example.org. 5 IN A 192.0.2.3"),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("n3.example.org." + nsec3spec),
+                  ConstRRsetPtr());
+    updater_.reset();
+
+    // Make a copy of the zone, and update it with an updater aware of the
+    // original.  Note that the segment may grow and relocate the data.
+    while (true) {
+        try {
+            ZoneData* copy = ZoneData::createCopy(*mem_sgmt_, *getZoneData(),
+                                                  zclass_);
+            mem_sgmt_->setNamedAddress("Test zone copy", copy);
+            break;
+        } catch (const bundy::util::MemorySegmentGrown&) {}
+    }
+    ZoneData* copy = static_cast<ZoneData*>(
+        mem_sgmt_->getNamedAddress("Test zone copy").second);
+    updater_.reset(new ZoneDataUpdater(*mem_sgmt_, zclass_, zname_, *copy,
+                                       false, getZoneData()));
+    updater_->add(textToRRset("a.example.org. 5 IN AAAA 2001:db8::1"),
+                  ConstRRsetPtr());
+    updater_->remove(textToRRset("b.example.org. 5 IN A 192.0.2.2"),
+                     ConstRRsetPtr());
+    updater_->add(textToRRset("d.example.org. 5 IN A 192.0.2.4"),
+                  ConstRRsetPtr());
+    updater_->remove(textToRRset("n3.example.org." + nsec3spec),
+                     ConstRRsetPtr());
+    updater_.reset();
+    copy = static_cast<ZoneData*>(
+        mem_sgmt_->getNamedAddress("Test zone copy").second);
+
+    // The original zone is intact.
+    const ZoneData& base = *getZoneData();
+    checkRdataSet(base, Name("a.example.org"), RRType::A(), 1, 0);
+    checkRdataSet(base, Name("a.example.org"), RRType::TXT(), 1, 0);
+    checkRdataSet(base, Name("a.example.org"), RRType::AAAA(), 0, 0);
+    checkRdataSet(base, Name("b.example.org"), RRType::A(), 1, 0);
+    const ZoneNode* node = NULL;
+    EXPECT_EQ(ZoneTree::PARTIALMATCH,
+              base.getZoneTree().find(Name("d.example.org"), &node));
+    EXPECT_EQ(ZoneTree::EXACTMATCH,
+              base.getNSEC3Data()->getNSEC3Tree().find(
+                  Name("n3.example.org"), &node));
+
+    // The copy has been updated.
+    checkRdataSet(*copy, Name("a.example.org"), RRType::A(), 1, 0);
+    checkRdataSet(*copy, Name("a.example.org"), RRType::TXT(), 1, 0);
+    checkRdataSet(*copy, Name("a.example.org"), RRType::AAAA(), 1, 0);
+    checkRdataSet(*copy, Name("d.example.org"), RRType::A(), 1, 0);
+    EXPECT_EQ(ZoneTree::PARTIALMATCH,
+              copy->getZoneTree().find(Name("b.example.org"), &node));
+    EXPECT_EQ(ZoneTree::PARTIALMATCH,
+              copy->getNSEC3Data()->getNSEC3Tree().find(
+                  Name("n3.example.org"), &node));
+
+    // The unmodified name still shares the data, but the modified one
+    // doesn't.
+    const ZoneNode* base_node = NULL;
+    base.getZoneTree().find(Name("c.example.org"), &base_node);
+    copy->getZoneTree().find(Name("c.example.org"), &node);
+    EXPECT_EQ(base_node->getData(), node->getData());
+    base.getZoneTree().find(Name("a.example.org"), &base_node);
+    copy->getZoneTree().find(Name("a.example.org"), &node);
+    EXPECT_NE(base_node->getData(), node->getData());
+
+    // Replace the original with the copy, as the zone writer would do.
+    // Any leak or double free would be detected on destruction.
+    getZoneData()->detachSharedData(*copy);
+    ZoneData::destroy(*mem_sgmt_, getZoneData(), zclass_);
+    mem_sgmt_->setNamedAddress("Test zone data", copy);
+    mem_sgmt_->clearNamedAddress("Test zone copy");
+    updater_.reset(new ZoneDataUpdater(*mem_sgmt_, zclass_, zname_,
+                                       *getZoneData()));
+}
+
 }
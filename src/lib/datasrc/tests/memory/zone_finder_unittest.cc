@@ -29,6 +29,7 @@
 #include <datasrc/memory/rdata_serialization.h>
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/memory_client.h>
+#include <datasrc/memory/nsec3_hash_cache.h>
 #include <datasrc/exceptions.h>
 #include <datasrc/client.h>
 #include <testutils/dnsmessage_test.h>
@@ -680,6 +681,59 @@ TEST_F(InMemoryZoneFinderTest, glue) {
              NULL, ZoneFinder::FIND_GLUE_OK);
 }
 
+TEST_F(InMemoryZoneFinderTest, findWithNameIndex) {
+    // Same data as some of the above tests, but in zone data with the name
+    // index.  The results should be the same as the tree search.
+    updater_.reset();       // there can be only one updater for mem_sgmt_
+    ZoneData* zone_data = ZoneData::create(mem_sgmt_, origin_, true);
+    InMemoryZoneFinder finder(*zone_data, class_);
+    ZoneDataUpdater updater(mem_sgmt_, class_, origin_, *zone_data);
+
+    // The glue is added before the zone cut above it, so the zone cut
+    // must be detected for the existing node.
+    updater.add(rr_a_, ConstRRsetPtr());
+    updater.add(rr_child_glue_, ConstRRsetPtr());
+    updater.add(rr_child_ns_, ConstRRsetPtr());
+    updater.add(rr_grandchild_glue_, ConstRRsetPtr());
+    updater.add(rr_dname_, ConstRRsetPtr());
+    updater.add(rr_dname_a_, ConstRRsetPtr());
+    const ConstRRsetPtr rr_below_dname =
+        textToRRset("a.below.dname.example.org. 300 IN A 192.0.2.40");
+    updater.add(rr_below_dname, ConstRRsetPtr());
+
+    // Normal exact matches, including one at the origin.
+    findTest(origin_, RRType::A(), ZoneFinder::SUCCESS, true, rr_a_,
+             ZoneFinder::RESULT_DEFAULT, &finder);
+    findTest(origin_, RRType::TXT(), ZoneFinder::NXRRSET, true,
+             ConstRRsetPtr(), ZoneFinder::RESULT_DEFAULT, &finder);
+    findTest(Name("dname.example.org"), RRType::A(), ZoneFinder::SUCCESS,
+             true, rr_dname_a_, ZoneFinder::RESULT_DEFAULT, &finder);
+
+    // Glue is hidden unless it's explicitly allowed.
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::DELEGATION,
+             true, rr_child_ns_, ZoneFinder::RESULT_DEFAULT, &finder);
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::SUCCESS,
+             true, rr_child_glue_, ZoneFinder::RESULT_DEFAULT, &finder,
+             ZoneFinder::FIND_GLUE_OK);
+    findTest(rr_grandchild_glue_->getName(), RRType::AAAA(),
+             ZoneFinder::DELEGATION, true, rr_child_ns_,
+             ZoneFinder::RESULT_DEFAULT, &finder);
+
+    // Names under DNAME are hidden by it.
+    findTest(rr_below_dname->getName(), RRType::A(), ZoneFinder::DNAME,
+             true, rr_dname_, ZoneFinder::RESULT_DEFAULT, &finder);
+
+    // An empty non-terminal created by the tree.
+    updater.add(textToRRset("a.b.example.org. 300 IN A 192.0.2.41"),
+                ConstRRsetPtr());
+    updater.add(textToRRset("c.b.example.org. 300 IN A 192.0.2.42"),
+                ConstRRsetPtr());
+    findTest(Name("b.example.org"), RRType::A(), ZoneFinder::NXRRSET, true,
+             ConstRRsetPtr(), ZoneFinder::RESULT_DEFAULT, &finder);
+
+    ZoneData::destroy(mem_sgmt_, zone_data, class_);
+}
+
 TEST_F(InMemoryZoneFinderTest, findAtOrigin) {
     // Add origin NS.
     rr_ns_->addRRsig(createRdata(RRType::RRSIG(), RRClass::IN(),
@@ -1664,6 +1718,15 @@ TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3) {
     performNSEC3Test(zone_finder_);
 }
 
+TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3WithCache) {
+    // The results should be the same with the NSEC3 hash cache, both when
+    // the hashes are calculated and when they are cached.
+    NSEC3HashCacheTable caches;
+    InMemoryZoneFinder finder(*zone_data_, class_, &caches);
+    performNSEC3Test(finder);
+    performNSEC3Test(finder);
+}
+
 struct TestData {
      // String for the name passed to findNSEC3() (concatenated with
      // "example.org.")
@@ -0,0 +1,259 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <datasrc/memory/zone_table_loader.h>
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/exceptions.h>
+#include <datasrc/result.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <cc/data.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc;
+using namespace bundy::datasrc::memory;
+using boost::lexical_cast;
+
+namespace {
+
+class TestException {};
+
+ZoneDataLoader*
+fileLoaderCreator(bundy::util::MemorySegment& mem_sgmt, const Name& zone_name,
+                  const std::string& filename, ZoneData* old_data)
+{
+    return (new ZoneDataLoader(mem_sgmt, RRClass::IN(), zone_name,
+                               TEST_DATA_DIR "/" + filename, old_data));
+}
+
+ZoneDataLoader*
+notFoundLoaderCreator(bundy::util::MemorySegment&, ZoneData*) {
+    bundy_throw(NoSuchZone, "test zone not found");
+}
+
+ZoneDataLoader*
+throwingLoaderCreator(bundy::util::MemorySegment&, ZoneData*) {
+    throw TestException();
+}
+
+struct LoadResult {
+    LoadResult(const Name& zone_name, ZoneTableLoader::Result result,
+               const std::string& error_msg) :
+        zone_name_(zone_name), result_(result), error_msg_(error_msg)
+    {}
+    Name zone_name_;
+    ZoneTableLoader::Result result_;
+    std::string error_msg_;
+};
+
+// Parameter is the number of threads
+class ZoneTableLoaderTest : public ::testing::TestWithParam<size_t> {
+protected:
+    ZoneTableLoaderTest() :
+        ztable_segment_(ZoneTableSegment::create(RRClass::IN(), "local")),
+        loader_(new ZoneTableLoader(*ztable_segment_, RRClass::IN(),
+                                    GetParam()))
+    {}
+
+    void addFile(const char* zone_name, const char* filename) {
+        loader_->add(Name(zone_name),
+                     boost::bind(fileLoaderCreator, _1, Name(zone_name),
+                                 filename, _2));
+    }
+    void callback(const Name& zone_name, ZoneTableLoader::Result result,
+                  const std::string& error_msg)
+    {
+        results_.push_back(LoadResult(zone_name, result, error_msg));
+    }
+    void load() {
+        loader_->load(boost::bind(&ZoneTableLoaderTest::callback, this,
+                                  _1, _2, _3));
+    }
+    const ZoneTable& getTable() const {
+        return (*ztable_segment_->getHeader().getTable());
+    }
+    const ZoneData* findZone(const char* zone_name) {
+        const ZoneTable::FindResult result =
+            getTable().findZone(Name(zone_name));
+        if (result.code != result::SUCCESS) {
+            return (NULL);
+        }
+        return (result.zone_data);
+    }
+    void checkResult(size_t i, const char* zone_name,
+                     ZoneTableLoader::Result result)
+    {
+        ASSERT_GT(results_.size(), i);
+        EXPECT_EQ(Name(zone_name), results_[i].zone_name_);
+        EXPECT_EQ(result, results_[i].result_);
+        EXPECT_EQ(result == ZoneTableLoader::LOAD_ERROR,
+                  !results_[i].error_msg_.empty());
+    }
+
+    // The segment is destroyed after the loader, and its destructor checks
+    // that all memory, including the part merged from the loading threads,
+    // is deallocated.
+    boost::scoped_ptr<ZoneTableSegment> ztable_segment_;
+    boost::scoped_ptr<ZoneTableLoader> loader_;
+    std::vector<LoadResult> results_;
+};
+
+INSTANTIATE_TEST_CASE_P(, ZoneTableLoaderTest, ::testing::Values(1, 2, 4));
+
+TEST_P(ZoneTableLoaderTest, load) {
+    addFile("example.org", "example.org-nsec3-signed.zone");
+    addFile("example.com", "2503-test.zone");
+    // The file has records out of the zone, so loading it fails.
+    addFile("example.net", "example.org.zone");
+    loader_->add(Name("example.info"),
+                 boost::bind(notFoundLoaderCreator, _1, _2));
+    addFile("example", "example.org-broken1.zone");
+    load();
+
+    // The callback is called in the order of add().
+    ASSERT_EQ(5, results_.size());
+    checkResult(0, "example.org", ZoneTableLoader::SUCCESS);
+    checkResult(1, "example.com", ZoneTableLoader::SUCCESS);
+    checkResult(2, "example.net", ZoneTableLoader::LOAD_ERROR);
+    checkResult(3, "example.info", ZoneTableLoader::NOT_FOUND);
+    checkResult(4, "example", ZoneTableLoader::LOAD_ERROR);
+
+    // Loaded zones have their data, failed ones are installed as empty
+    // zones, and missing ones are not installed at all.
+    EXPECT_EQ(4, getTable().getZoneCount());
+    ASSERT_NE(static_cast<const ZoneData*>(NULL), findZone("example.org"));
+    EXPECT_FALSE(findZone("example.org")->isEmpty());
+    EXPECT_TRUE(findZone("example.org")->isNSEC3Signed());
+    ASSERT_NE(static_cast<const ZoneData*>(NULL), findZone("example.com"));
+    EXPECT_FALSE(findZone("example.com")->isEmpty());
+    EXPECT_EQ(static_cast<const ZoneData*>(NULL), findZone("example.net"));
+    EXPECT_EQ(static_cast<const ZoneData*>(NULL), findZone("example"));
+    EXPECT_EQ(static_cast<const ZoneData*>(NULL), findZone("example.info"));
+    EXPECT_EQ(result::SUCCESS, getTable().findZone(Name("example.net")).code);
+    EXPECT_NE(0, getTable().findZone(Name("example.net")).flags &
+              result::ZONE_EMPTY);
+
+    // The registered zones have been cleared.
+    results_.clear();
+    load();
+    EXPECT_TRUE(results_.empty());
+}
+
+TEST_P(ZoneTableLoaderTest, manyZones) {
+    for (int i = 0; i < 50; ++i) {
+        const std::string zone_name = "zone" + lexical_cast<std::string>(i) +
+            ".example";
+        addFile(zone_name.c_str(), "template.zone");
+    }
+    load();
+    ASSERT_EQ(50, results_.size());
+    for (int i = 0; i < 50; ++i) {
+        const std::string zone_name = "zone" + lexical_cast<std::string>(i) +
+            ".example";
+        checkResult(i, zone_name.c_str(), ZoneTableLoader::SUCCESS);
+        const ZoneData* zone_data = findZone(zone_name.c_str());
+        ASSERT_NE(static_cast<const ZoneData*>(NULL), zone_data);
+        EXPECT_FALSE(zone_data->isEmpty());
+    }
+}
+
+TEST_P(ZoneTableLoaderTest, replaceZone) {
+    // Zones already in the table are replaced, and the old data are
+    // released (which is checked in the destructor of the segment).
+    addFile("example.org", "example.org-empty.zone");
+    addFile("example.com", "2503-test.zone");
+    load();
+    const ZoneData* const old_data = findZone("example.org");
+    ASSERT_NE(static_cast<const ZoneData*>(NULL), old_data);
+
+    addFile("example.org", "example.org-nsec3-signed.zone");
+    addFile("example.com", "2504-test.zone");
+    load();
+    ASSERT_EQ(4, results_.size());
+    checkResult(2, "example.org", ZoneTableLoader::SUCCESS);
+    EXPECT_EQ(2, getTable().getZoneCount());
+    ASSERT_NE(static_cast<const ZoneData*>(NULL), findZone("example.org"));
+    EXPECT_TRUE(findZone("example.org")->isNSEC3Signed());
+}
+
+TEST_P(ZoneTableLoaderTest, unexpectedError) {
+    // Exceptions other than those on loading errors are propagated, after
+    // installing the zones preceding the failed one.
+    addFile("example.org", "example.org-nsec3-signed.zone");
+    loader_->add(Name("example.net"),
+                 boost::bind(throwingLoaderCreator, _1, _2));
+    addFile("example.com", "2503-test.zone");
+    EXPECT_THROW(load(), TestException);
+    ASSERT_EQ(1, results_.size());
+    checkResult(0, "example.org", ZoneTableLoader::SUCCESS);
+    EXPECT_NE(static_cast<const ZoneData*>(NULL), findZone("example.org"));
+    EXPECT_EQ(1, getTable().getZoneCount());
+
+    // The registered zones have been cleared even in this case.
+    results_.clear();
+    load();
+    EXPECT_TRUE(results_.empty());
+}
+
+TEST_P(ZoneTableLoaderTest, getWorkerCount) {
+    // No more threads than zones are used.
+    EXPECT_EQ(1, loader_->getWorkerCount(0));
+    EXPECT_EQ(1, loader_->getWorkerCount(1));
+    EXPECT_EQ(std::min<size_t>(GetParam(), 3), loader_->getWorkerCount(3));
+    EXPECT_EQ(GetParam(), loader_->getWorkerCount(50));
+}
+
+#ifdef USE_SHARED_MEMORY
+TEST(ZoneTableLoaderConstructTest, mappedWorkerCount) {
+    // The mapped segment is always loaded in the calling thread.
+    boost::scoped_ptr<ZoneTableSegment> ztable_segment(
+        ZoneTableSegment::create(RRClass::IN(), "mapped"));
+    ztable_segment->reset(ZoneTableSegment::CREATE,
+                          bundy::data::Element::fromJSON(
+                              "{\"mapped-file\": \"" TEST_DATA_BUILDDIR
+                              "/zt_loader.mapped\"}"));
+    EXPECT_EQ(1, ZoneTableLoader(*ztable_segment, RRClass::IN(), 4).
+              getWorkerCount(50));
+    ztable_segment->clear();
+    unlink(TEST_DATA_BUILDDIR "/zt_loader.mapped");
+}
+#endif
+
+TEST(ZoneTableLoaderConstructTest, badParameter) {
+    boost::scoped_ptr<ZoneTableSegment> ztable_segment(
+        ZoneTableSegment::create(RRClass::IN(), "local"));
+    EXPECT_THROW(ZoneTableLoader(*ztable_segment, RRClass::IN(), 0),
+                 bundy::InvalidParameter);
+}
+
+}
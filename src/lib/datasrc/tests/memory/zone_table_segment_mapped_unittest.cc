@@ -122,6 +122,20 @@ deleteHeader(MemorySegment& segment) {
     segment.clearNamedAddress("zone_table_header");
 }
 
+// Make the segment look like one written by an older version, which didn't
+// store the format version.  The checksum is updated, so the segment is
+// otherwise valid.
+void
+deleteVersion(MemorySegmentMapped& segment) {
+    segment.clearNamedAddress("zone_table_version");
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress("zone_table_checksum");
+    ASSERT_TRUE(result.first);
+    *static_cast<size_t*>(result.second) = 0;
+    const size_t checksum = segment.getCheckSum();
+    *static_cast<size_t*>(result.second) = checksum;
+}
+
 void
 ZoneTableSegmentMappedTest::addData(MemorySegment& segment) {
     // For purposes of this test, we assume that the following
@@ -249,6 +263,28 @@ TEST_F(ZoneTableSegmentMappedTest, resetBadConfig) {
     }, bundy::InvalidParameter);
 
     EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+    // Invalid values of the optional keys
+    const char* const bad_options[] = {
+        "\"prefault\": \"always\"",
+        "\"prefault\": true",
+        "\"will-need\": \"yes\"",
+        "\"huge-pages\": 1",
+        NULL
+    };
+    for (const char* const* option = bad_options; *option != NULL; ++option) {
+        SCOPED_TRACE(*option);
+        EXPECT_THROW({
+            ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                   Element::fromJSON(
+                                       "{\"mapped-file\": \"" +
+                                       std::string(mapped_file) + "\", " +
+                                       *option + "}"));
+        }, bundy::InvalidParameter);
+
+        EXPECT_TRUE(ztable_segment_->isWritable());
+        EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    }
 }
 
 TEST_F(ZoneTableSegmentMappedTest, nullReset) {
@@ -430,6 +466,69 @@ TEST_F(ZoneTableSegmentMappedTest, resetReadOnly) {
                  MemorySegmentError);
 }
 
+TEST_F(ZoneTableSegmentMappedTest, resetReadOnlyPrefault) {
+    setupMappedFiles();
+
+    // Each of the options to fault in the segment or give hints on it
+    // doesn't affect the data.
+    const char* const options[] = {
+        "\"prefault\": \"none\"",
+        "\"prefault\": \"populate\"",
+        "\"prefault\": \"background\"",
+        "\"will-need\": true",
+        "\"huge-pages\": true",
+        "\"prefault\": \"background\", \"will-need\": true, "
+        "\"huge-pages\": false",
+        NULL
+    };
+    for (const char* const* option = options; *option != NULL; ++option) {
+        SCOPED_TRACE(*option);
+        ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                               Element::fromJSON(
+                                   "{\"mapped-file\": \"" +
+                                   std::string(mapped_file) + "\", " +
+                                   *option + "}"));
+        EXPECT_FALSE(ztable_segment_->isWritable());
+        EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+        // Switching to another segment, clearing it or destroying it while
+        // it's faulted in in the background is safe.
+        ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                               Element::fromJSON(
+                                   "{\"mapped-file\": \"" +
+                                   std::string(mapped_file2) + "\", " +
+                                   *option + "}"));
+        EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+        ztable_segment_->clear();
+        EXPECT_FALSE(ztable_segment_->isUsable());
+    }
+
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                           Element::fromJSON(
+                               "{\"mapped-file\": \"" +
+                               std::string(mapped_file) + "\", "
+                               "\"prefault\": \"background\"}"));
+    ZoneTableSegment::destroy(ztable_segment_.release());
+}
+
+TEST_F(ZoneTableSegmentMappedTest, resetReadWriteHugePages) {
+    // The options apply to writable segments too, which still work as
+    // usual (faulting in is ignored for them).
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE,
+                           Element::fromJSON(
+                               "{\"mapped-file\": \"" +
+                               std::string(mapped_file) + "\", "
+                               "\"huge-pages\": true, "
+                               "\"prefault\": \"background\"}"));
+    EXPECT_TRUE(ztable_segment_->isWritable());
+    addData(ztable_segment_->getMemorySegment());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    ztable_segment_->clear();
+
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY, config_params_);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+}
+
 TEST_F(ZoneTableSegmentMappedTest, clearUninitialized) {
     // Clearing a segment that has not been reset() is a nop, as clear()
     // returns it to a fresh uninitialized state anyway.
@@ -545,6 +644,40 @@ TEST_F(ZoneTableSegmentMappedTest, resetFailedMissingHeader) {
     EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
 }
 
+TEST_F(ZoneTableSegmentMappedTest, resetFailedOldVersion) {
+    setupMappedFiles();
+
+    // Open mapped file 1 in read-write mode
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+
+    // Make mapped file 2 look like an older version.
+    scoped_ptr<MemorySegmentMapped> segment
+        (new MemorySegmentMapped(mapped_file2,
+                                 MemorySegmentMapped::OPEN_OR_CREATE));
+    EXPECT_TRUE(verifyData(*segment));
+    deleteVersion(*segment);
+    segment.reset();
+
+    // Resetting to mapped file 2 should fail in both read-write and
+    // read-only modes, as the data may have a different layout.
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params2_);
+    }, ResetFailed);
+    EXPECT_TRUE(ztable_segment_->isUsable());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_ONLY, config_params2_);
+    }, ResetFailed);
+    EXPECT_TRUE(ztable_segment_->isUsable());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+    // It can be created again.
+    EXPECT_NO_THROW(ztable_segment_->reset(ZoneTableSegment::CREATE,
+                                           config_params2_));
+    EXPECT_TRUE(ztable_segment_->isWritable());
+    EXPECT_FALSE(verifyData(ztable_segment_->getMemorySegment()));
+}
+
 TEST_F(ZoneTableSegmentMappedTest, resetCreateOverCorruptedFile) {
     setupMappedFiles();
 
@@ -39,6 +39,7 @@
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 
+#include <fstream>
 #include <string>
 #include <stdexcept>
 #include <unistd.h>
@@ -76,6 +77,7 @@ public:
         }
         return (false);
     }
+    virtual bool isDataShared() const { return (false); }
     virtual ZoneData* getLoadedData() const {
         return (loaded_data_);
     }
@@ -553,6 +555,116 @@ createLoaderWrapper(bundy::util::MemorySegment& segment, const RRClass& rrclass,
     return (new ZoneDataLoader(segment, rrclass, name, filename, NULL));
 }
 
+ZoneDataLoader*
+createUpdateLoader(bundy::util::MemorySegment& segment, const Name& name,
+                   const std::string& filename, bool copy_on_write,
+                   ZoneData* old_data)
+{
+    return (new ZoneDataLoader(segment, RRClass::IN(), name, filename,
+                               old_data, false, false, 1, copy_on_write,
+                               true));
+}
+
+// Load a version of a zone of the given serial and number of names, and
+// return its data in the table.
+const ZoneData*
+loadVersion(ZoneTableSegment& zt_segment, const Name& origin, int serial,
+            int name_count, bool copy_on_write)
+{
+    const char* const zone_file = TEST_DATA_BUILDDIR "/writer-stats.zone";
+    {
+        std::ofstream ofs(zone_file, std::ios::trunc);
+        ofs << "example.org. 3600 IN SOA ns.example.org. admin.example.org. "
+            << serial << " 3600 900 604800 3600\n"
+            << "example.org. 3600 IN NS ns.example.org.\n"
+            << "ns.example.org. 3600 IN A 192.0.2.1\n";
+        for (int i = 0; i < name_count; ++i) {
+            ofs << "host" << i << ".example.org. 3600 IN A 192.0.2.2\n";
+        }
+    }
+    ZoneWriter writer(zt_segment,
+                      boost::bind(createUpdateLoader, _1, origin, zone_file,
+                                  copy_on_write, _2),
+                      origin, RRClass::IN(), false);
+    writer.load();
+    writer.install();
+    writer.cleanup();
+    unlink(zone_file);
+    return (zt_segment.getHeader().getTable()->findZone(origin).zone_data);
+}
+
+// The memory used by a zone is recorded in the zone data, whether it's
+// fully loaded or updated in place or copy-on-write.
+TEST_F(ZoneWriterTest, loadStats) {
+    boost::scoped_ptr<ZoneTableSegment> zt_segment(
+        ZoneTableSegment::create(RRClass::IN(), "local"));
+    const bundy::util::MemorySegment& mem_sgmt =
+        zt_segment->getMemorySegment();
+    const Name origin("example.org");
+
+    // The initial load is a full load.  The rest of the allocated memory
+    // is used by the table.
+    const ZoneData* zone_data =
+        loadVersion(*zt_segment, origin, 1, 10, false);
+    ASSERT_TRUE(zone_data);
+    EXPECT_LT(0, zone_data->getMemorySize());
+    const size_t table_size =
+        mem_sgmt.getAllocatedSize() - zone_data->getMemorySize();
+
+    // The differences are applied in place, then copy-on-write.  Adding
+    // names grows the zone, and removing them shrinks it.
+    const int name_counts[] = {20, 5, 30, 10};
+    for (int i = 0; i < 4; ++i) {
+        const size_t prev_size = zone_data->getMemorySize();
+        zone_data = loadVersion(*zt_segment, origin, i + 2, name_counts[i],
+                                i >= 2);
+        if (i % 2 == 0) {
+            EXPECT_LT(prev_size, zone_data->getMemorySize());
+        } else {
+            EXPECT_GT(prev_size, zone_data->getMemorySize());
+        }
+        EXPECT_EQ(table_size + zone_data->getMemorySize(),
+                  mem_sgmt.getAllocatedSize());
+    }
+}
+
+// An update deleting records releases more memory than it allocates.  The
+// recorded size then shrinks, and never wraps around even if it was too
+// small to begin with.
+TEST_F(ZoneWriterTest, loadStatsDeleted) {
+    boost::scoped_ptr<ZoneTableSegment> zt_segment(
+        ZoneTableSegment::create(RRClass::IN(), "local"));
+    const bundy::util::MemorySegment& mem_sgmt =
+        zt_segment->getMemorySegment();
+    const Name origin("example.org");
+
+    const ZoneData* zone_data =
+        loadVersion(*zt_segment, origin, 1, 30, false);
+    ASSERT_TRUE(zone_data);
+    const size_t table_size =
+        mem_sgmt.getAllocatedSize() - zone_data->getMemorySize();
+    const size_t full_size = zone_data->getMemorySize();
+    zone_data = loadVersion(*zt_segment, origin, 2, 0, false);
+    EXPECT_GT(full_size, zone_data->getMemorySize());
+    EXPECT_LT(0, zone_data->getMemorySize());
+    EXPECT_EQ(table_size + zone_data->getMemorySize(),
+              mem_sgmt.getAllocatedSize());
+
+    // Pretend the size wasn't recorded, as for data loaded by an older
+    // version.  Deleting records from it in place results in 0.  With
+    // copy-on-write, the size doesn't depend on the old one, and is
+    // accurate again.
+    zone_data = loadVersion(*zt_segment, origin, 3, 30, false);
+    const_cast<ZoneData*>(zone_data)->setMemorySize(0);
+    zone_data = loadVersion(*zt_segment, origin, 4, 0, false);
+    EXPECT_EQ(0, zone_data->getMemorySize());
+    zone_data = loadVersion(*zt_segment, origin, 5, 30, false);
+    const_cast<ZoneData*>(zone_data)->setMemorySize(0);
+    zone_data = loadVersion(*zt_segment, origin, 6, 0, true);
+    EXPECT_EQ(table_size + zone_data->getMemorySize(),
+              mem_sgmt.getAllocatedSize());
+}
+
 // Check the behavior of creating many small zones.  The main purpose of
 // test is to trigger MemorySegmentGrown exception in ZoneWriter::install.
 // There's no easy (if any) way to cause that reliably as it's highly
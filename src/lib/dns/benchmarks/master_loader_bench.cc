@@ -0,0 +1,218 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <dns/master_loader.h>
+#include <dns/master_loader_callbacks.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <boost/bind.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+
+namespace {
+void
+addRR(size_t* count, const Name&, const RRClass&, const RRType&,
+      const RRTTL&, const rdata::RdataPtr&)
+{
+    ++*count;
+}
+
+// This benchmark loads a master file with MasterLoader, either from the
+// file name (so the loader reads the file in its own way, i.e., by mapping
+// it in memory, possibly in multiple threads) or from an input stream of
+// the file.  The loaded RRs are simply counted.
+class LoaderBenchMark {
+public:
+    LoaderBenchMark(const char* filename, const Name& origin,
+                    const RRClass& rrclass, bool use_stream,
+                    size_t thread_count = 1) :
+        filename_(filename), origin_(origin), rrclass_(rrclass),
+        use_stream_(use_stream), thread_count_(thread_count), rr_count_(0)
+    {}
+    unsigned int run() {
+        rr_count_ = 0;
+        const AddRRCallback callback =
+            boost::bind(addRR, &rr_count_, _1, _2, _3, _4, _5);
+        if (use_stream_) {
+            ifstream ifs(filename_);
+            assert(ifs);
+            MasterLoader loader(ifs, origin_, rrclass_,
+                                MasterLoaderCallbacks::getNullCallbacks(),
+                                callback);
+            loader.load();
+        } else {
+            MasterLoader loader(filename_, origin_, rrclass_,
+                                MasterLoaderCallbacks::getNullCallbacks(),
+                                callback, MasterLoader::DEFAULT,
+                                thread_count_);
+            loader.load();
+        }
+        return (1);
+    }
+    size_t getRRCount() const { return (rr_count_); }
+    const char* getFileName() const { return (filename_); }
+private:
+    const char* const filename_;
+    const Name origin_;
+    const RRClass rrclass_;
+    const bool use_stream_;
+    const size_t thread_count_;
+    size_t rr_count_;
+};
+}
+
+namespace bundy {
+namespace bench {
+template<>
+void
+BenchMark<LoaderBenchMark>::printResult() const {
+    struct stat st;
+    if (stat(target_->getFileName(), &st) != 0) {
+        cerr << "failed to get the size of " << target_->getFileName()
+             << endl;
+        return;
+    }
+    const double mbytes = static_cast<double>(st.st_size) * getIteration() /
+        (1024 * 1024);
+    cout.precision(6);
+    cout << "Loaded " << target_->getRRCount() << " RRs "
+         << getIteration() << " times in " << fixed << getDuration() << "s";
+    cout.precision(2);
+    cout << " (" << fixed << mbytes / getDuration() << "MB/s, "
+         << target_->getRRCount() * getIterationPerSecond() << "RRs/s)"
+         << endl;
+}
+}
+}
+
+namespace {
+// Generate a zone of the given number of names, each of which has an A
+// and a TXT RR, so it's not dominated by the tokenization of short fields.
+void
+generateZone(const char* filename, const Name& origin, int zone_size) {
+    ofstream ofs(filename);
+    ofs << origin << " 3600 IN SOA ns." << origin << " root." << origin
+        << " 1 3600 300 3600000 3600\n";
+    ofs << origin << " 3600 IN NS ns." << origin << "\n";
+    for (int i = 0; i < zone_size; ++i) {
+        ofs << "host" << i << " 3600 IN A 192.0.2." << (i % 256) << "\n";
+        ofs << "host" << i << " 3600 IN TXT \"v=spf1 ip4:192.0.2.0/24"
+            << " include:_spf." << origin << " ~all\"\n";
+    }
+}
+
+void
+usage() {
+    cerr << "Usage: master_loader_bench [-n iterations] [-c class] "
+        "[-s zone_size] [-t threads] [zone_file origin]" << endl;
+    cerr << "  If zone_file is omitted, a zone of zone_size names is "
+        "generated." << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 10;
+    int zone_size = 100000;
+    int thread_count = 4;
+    const char* rrclass_txt = "IN";
+    while ((ch = getopt(argc, argv, "n:c:s:t:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'c':
+            rrclass_txt = optarg;
+            break;
+        case 's':
+            zone_size = atoi(optarg);
+            break;
+        case 't':
+            thread_count = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if ((argc != 0 && argc != 2) || iteration <= 0 || zone_size <= 0 ||
+        thread_count <= 0) {
+        usage();
+    }
+
+    const RRClass rrclass(rrclass_txt);
+    string filename;
+    Name origin(Name::ROOT_NAME());
+    bool generated = false;
+    if (argc == 2) {
+        filename = argv[0];
+        origin = Name(argv[1]);
+    } else {
+        filename = "master_loader_bench.zone";
+        origin = Name("example.com");
+        generateZone(filename.c_str(), origin, zone_size);
+        generated = true;
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Zone file: " << filename << endl;
+    cout << "  Origin: " << origin << "/" << rrclass << endl;
+    cout << "  Threads: " << thread_count << endl;
+
+    // printResult() refers to the target, so we need to pass it by
+    // reference.
+    cout << "Benchmark for loading from the file" << endl;
+    LoaderBenchMark file_bench(filename.c_str(), origin, rrclass, false);
+    BenchMark<LoaderBenchMark>(iteration, file_bench, true);
+
+    if (thread_count > 1) {
+        cout << "Benchmark for loading from the file in " << thread_count
+             << " threads" << endl;
+        LoaderBenchMark parallel_bench(filename.c_str(), origin, rrclass,
+                                       false, thread_count);
+        BenchMark<LoaderBenchMark>(iteration, parallel_bench, true);
+    }
+
+    cout << "Benchmark for loading from a stream of the file" << endl;
+    LoaderBenchMark stream_bench(filename.c_str(), origin, rrclass, true);
+    BenchMark<LoaderBenchMark>(iteration, stream_bench, true);
+
+    if (generated) {
+        unlink(filename.c_str());
+    }
+
+    return (0);
+}
@@ -19,7 +19,10 @@
 #include <dns/messagerenderer.h>
 #include <oldmessagerenderer.h>
 
+#include <boost/lexical_cast.hpp>
+
 #include <cassert>
+#include <string>
 #include <vector>
 
 using namespace std;
@@ -88,6 +91,24 @@ const char* const root_to_com_names[] = {
     NULL
 };
 
+// Names contained in a referral from a TLD server with many name servers
+// in different domains, and their glue records (A and AAAA).
+const char* const tld_referral_names[] = {
+    // question section
+    "www.department.example.org",
+    // authority section
+    "example.org", "ns1.example.org", "example.org", "ns2.example.org",
+    "example.org", "ns3.example.org", "example.org", "ns1.example.net",
+    "example.org", "ns2.example.net", "example.org", "ns.example-dns.com",
+    "example.org", "ns.secondary.example-dns.com",
+    "example.org",              // owner name of DS
+    "example.org", "org",       // owner name and signer of RRSIG(DS)
+    // additional section
+    "ns1.example.org", "ns1.example.org", "ns2.example.org",
+    "ns2.example.org", "ns3.example.org", "ns3.example.org",
+    NULL
+};
+
 // Names contained a typical "NXDOMAIN" response: the question, the owner
 // name of SOA, and its MNAME and RNAME.
 const char* const example_nxdomain_names[] = {
@@ -123,6 +144,20 @@ public:
     }
 };
 
+// Generate names of a large response containing many names in the same
+// zone, like the response to an ANY query or a zone transfer: the owner
+// name and a host name in the RDATA for each RR.
+void
+generateLargeResponseNames(vector<Name>& names) {
+    names.push_back(Name("example.com"));
+    for (size_t i = 0; i < 200; ++i) {
+        const string host = "host" + boost::lexical_cast<string>(i) +
+            ((i % 2) == 0 ? ".example.com" : ".sub.example.com");
+        names.push_back(Name("example.com"));
+        names.push_back(Name(host));
+    }
+}
+
 void
 usage() {
     cerr << "Usage: message_renderer_bench [-n iterations]" << endl;
@@ -155,15 +190,20 @@ main(int argc, char* argv[]) {
     typedef pair<const char* const*, string> DataSpec;
     vector<DataSpec> spec_list;
     spec_list.push_back(DataSpec(root_to_com_names, "(positive response)"));
+    spec_list.push_back(DataSpec(tld_referral_names, "(referral response)"));
     spec_list.push_back(DataSpec(example_nxdomain_names,
                                  "(NXDOMAIN response)"));
     spec_list.push_back(DataSpec(example_servfail_names,
                                  "(SERVFAIL response)"));
+    spec_list.push_back(DataSpec(NULL, "(large response)"));
     for (vector<DataSpec>::const_iterator it = spec_list.begin();
          it != spec_list.end();
          ++it) {
         vector<Name> names;
-        for (size_t i = 0; it->first[i] != NULL; ++i) {
+        if (it->first == NULL) {
+            generateLargeResponseNames(names);
+        }
+        for (size_t i = 0; it->first != NULL && it->first[i] != NULL; ++i) {
             names.push_back(Name(it->first[i]));
         }
 
@@ -0,0 +1,183 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <util/buffer.h>
+
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using bundy::util::InputBuffer;
+
+namespace {
+// Construct names from their textual representations.
+class TextParseBenchMark {
+public:
+    TextParseBenchMark(const vector<string>& texts) :
+        texts_(texts), length_(0)
+    {}
+    unsigned int run() {
+        vector<string>::const_iterator it;
+        for (it = texts_.begin(); it != texts_.end(); ++it) {
+            const Name name(*it);
+            length_ += name.getLength();
+        }
+        return (texts_.size());
+    }
+private:
+    const vector<string>& texts_;
+    size_t length_;             // so the construction is not optimized away
+};
+
+// Construct names from wire-format data, rendered with name compression
+// like in a DNS message.
+class WireParseBenchMark {
+public:
+    WireParseBenchMark(const void* data, size_t data_len, size_t count) :
+        data_(data), data_len_(data_len), count_(count), length_(0)
+    {}
+    unsigned int run() {
+        InputBuffer buffer(data_, data_len_);
+        for (size_t i = 0; i < count_; ++i) {
+            const Name name(buffer);
+            length_ += name.getLength();
+        }
+        return (count_);
+    }
+private:
+    const void* const data_;
+    const size_t data_len_;
+    const size_t count_;
+    size_t length_;
+};
+
+// Copy names into a vector, as is done when, e.g., building RRsets or
+// questions from parsed names.
+class CopyBenchMark {
+public:
+    CopyBenchMark(const vector<Name>& names) : names_(names) {}
+    unsigned int run() {
+        copied_.clear();
+        copied_.reserve(names_.size());
+        vector<Name>::const_iterator it;
+        for (it = names_.begin(); it != names_.end(); ++it) {
+            copied_.push_back(*it);
+        }
+        return (names_.size());
+    }
+private:
+    const vector<Name>& names_;
+    vector<Name> copied_;
+};
+
+// Generate names of a typical zone: hosts of a few domains of various
+// lengths.
+void
+generateNames(size_t count, vector<string>& texts) {
+    const char* const domains[] = {
+        "example.com", "example.org", "subdomain.example.net",
+        "department.organization.example"
+    };
+    for (size_t i = 0; i < count; ++i) {
+        string label = "host";
+        for (size_t j = 0; j < i % 4; ++j) {
+            label += "-name";
+        }
+        texts.push_back(label + "." + domains[i % 4]);
+    }
+}
+
+void
+usage() {
+    cerr << "Usage: name_bench [-n iterations] [-s set_size]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000;
+    int set_size = 1000;
+    while ((ch = getopt(argc, argv, "n:s:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            set_size = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || set_size <= 0) {
+        usage();
+    }
+
+    vector<string> texts;
+    generateNames(set_size, texts);
+    vector<Name> names;
+    MessageRenderer renderer;
+    // Don't let the renderer truncate the data.
+    renderer.setLengthLimit(0xffff);
+    for (vector<string>::const_iterator it = texts.begin();
+         it != texts.end(); ++it) {
+        names.push_back(Name(*it));
+        if (renderer.getLength() + Name::MAX_WIRE < 0xffff) {
+            renderer.writeName(names.back());
+        }
+    }
+    // The number of names rendered in the wire-format data.
+    size_t wire_count = 0;
+    {
+        InputBuffer buffer(renderer.getData(), renderer.getLength());
+        while (buffer.getPosition() < buffer.getLength()) {
+            const Name name(buffer);
+            ++wire_count;
+        }
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Set size: " << set_size << endl;
+
+    cout << "Benchmark for constructing names from text" << endl;
+    BenchMark<TextParseBenchMark>(iteration, TextParseBenchMark(texts));
+
+    cout << "Benchmark for constructing " << wire_count <<
+        " names from compressed wire-format data" << endl;
+    BenchMark<WireParseBenchMark>(iteration,
+                                  WireParseBenchMark(renderer.getData(),
+                                                     renderer.getLength(),
+                                                     wire_count));
+
+    cout << "Benchmark for copying names" << endl;
+    BenchMark<CopyBenchMark>(iteration, CopyBenchMark(names));
+
+    return (0);
+}
@@ -0,0 +1,185 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/name_internal.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using namespace bundy::dns::name::internal;
+
+namespace {
+// The comparison operations to be benchmarked.  Each of them compares
+// every name of the data set with the corresponding name of another set.
+enum Operation {
+    NAME_EQUALS,
+    NAME_COMPARE,
+    LABELSEQ_EQUALS
+};
+
+class NameCompareBenchMark {
+public:
+    NameCompareBenchMark(const vector<Name>& names1,
+                         const vector<Name>& names2, Operation op) :
+        names1_(names1), names2_(names2), op_(op), matched_(0)
+    {}
+    unsigned int run() {
+        const size_t n = names1_.size();
+        for (size_t i = 0; i < n; ++i) {
+            switch (op_) {
+            case NAME_EQUALS:
+                matched_ += names1_[i].equals(names2_[i]);
+                break;
+            case NAME_COMPARE:
+                matched_ += names1_[i].compare(names2_[i]).getOrder() < 0;
+                break;
+            case LABELSEQ_EQUALS:
+                matched_ += LabelSequence(names1_[i]).equals(
+                    LabelSequence(names2_[i]));
+                break;
+            }
+        }
+        return (n);
+    }
+private:
+    const vector<Name>& names1_;
+    const vector<Name>& names2_;
+    const Operation op_;
+    // Used so that the comparisons are not optimized away.
+    size_t matched_;
+};
+
+// Generate names resembling those in signed zones and in queries: a mixture
+// of host names of different lengths and NSEC3 hashed owner names.  The
+// names are sorted; upper_names have the same names in upper case, and
+// next_names have the next name of each in the sorted order.
+void
+generateNames(size_t count, vector<Name>& names, vector<Name>& upper_names,
+              vector<Name>& next_names)
+{
+    const char* const chars = "abcdefghijklmnopqrstuvwxyz0123456789-";
+    for (size_t i = 0; i < count; ++i) {
+        string label;
+        const size_t label_len = (i % 3 == 0) ? 32 : 4 + (i % 5) * 4;
+        for (size_t j = 0; j < label_len; ++j) {
+            label.push_back(chars[(i * 7 + j * 13) % (i % 3 == 0 ? 36 : 37)]);
+        }
+        if (label[0] == '-') {
+            label[0] = 'x';
+        }
+        names.push_back(Name(label + (i % 2 == 0 ? ".www" : "") +
+                             ".example-service-provider.com"));
+    }
+    sort(names.begin(), names.end());
+    for (size_t i = 0; i < count; ++i) {
+        string upper_txt(names[i].toText());
+        transform(upper_txt.begin(), upper_txt.end(), upper_txt.begin(),
+                  ::toupper);
+        upper_names.push_back(Name(upper_txt));
+        next_names.push_back(names[(i + 1) % count]);
+    }
+}
+
+void
+usage() {
+    cerr << "Usage: name_compare_bench [-n iterations] [-s set_size]" << endl;
+    exit (1);
+}
+
+const char*
+getImplName(CompareImpl impl) {
+    switch (impl) {
+    case COMPARE_SCALAR:
+        return ("scalar");
+    case COMPARE_SSE2:
+        return ("SSE2");
+    case COMPARE_AVX2:
+        return ("AVX2");
+    }
+    return ("unknown");
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000;
+    int set_size = 1000;
+    while ((ch = getopt(argc, argv, "n:s:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            set_size = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || set_size <= 0) {
+        usage();
+    }
+
+    vector<Name> names, upper_names, next_names;
+    generateNames(set_size, names, upper_names, next_names);
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Set size: " << set_size << endl;
+    cout << "  Default implementation: " << getImplName(getCompareImpl())
+         << endl;
+
+    const CompareImpl impls[] = { COMPARE_SCALAR, COMPARE_SSE2,
+                                  COMPARE_AVX2 };
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); ++i) {
+        if (!selectCompareImpl(impls[i])) {
+            cout << "Implementation " << getImplName(impls[i])
+                 << " is not available" << endl;
+            continue;
+        }
+        cout << "Benchmark for Name::equals() with the " <<
+            getImplName(impls[i]) << " implementation" << endl;
+        BenchMark<NameCompareBenchMark>(
+            iteration, NameCompareBenchMark(names, upper_names, NAME_EQUALS));
+
+        cout << "Benchmark for LabelSequence::equals() with the " <<
+            getImplName(impls[i]) << " implementation" << endl;
+        BenchMark<NameCompareBenchMark>(
+            iteration, NameCompareBenchMark(names, upper_names,
+                                            LABELSEQ_EQUALS));
+
+        cout << "Benchmark for Name::compare() with the " <<
+            getImplName(impls[i]) << " implementation" << endl;
+        BenchMark<NameCompareBenchMark>(
+            iteration, NameCompareBenchMark(names, next_names, NAME_COMPARE));
+    }
+
+    return (0);
+}
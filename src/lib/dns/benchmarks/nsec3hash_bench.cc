@@ -0,0 +1,177 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/nsec3hash.h>
+#include <dns/rdataclass.h>
+
+#include <util/hash/sha1_multi.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using namespace bundy::util::hash;
+
+namespace {
+// Calculate the NSEC3 hashes of the given names, either one by one or
+// together in groups of the given size.  A group of 4 names corresponds
+// to the names examined for the closest encloser proof of a query name 3
+// labels below the zone origin.
+class NSEC3HashBenchMark {
+public:
+    NSEC3HashBenchMark(const NSEC3Hash& hash,
+                       const vector<LabelSequence>& names,
+                       size_t batch_size) :
+        hash_(hash), names_(names), batch_size_(batch_size), length_(0)
+    {}
+    unsigned int run() {
+        if (batch_size_ == 0) {
+            for (size_t i = 0; i < names_.size(); ++i) {
+                length_ += hash_.calculate(names_[i]).size();
+            }
+            return (names_.size());
+        }
+        for (size_t i = 0; i < names_.size(); i += batch_size_) {
+            const size_t n = min(batch_size_, names_.size() - i);
+            const vector<LabelSequence> batch(names_.begin() + i,
+                                              names_.begin() + i + n);
+            hash_.calculateBatch(batch, hashes_);
+            length_ += hashes_.size();
+        }
+        return (names_.size());
+    }
+private:
+    const NSEC3Hash& hash_;
+    const vector<LabelSequence>& names_;
+    const size_t batch_size_;
+    vector<string> hashes_;
+    size_t length_;             // so the calculation is not optimized away
+};
+
+const char*
+getImplName(SHA1MultiImpl impl) {
+    switch (impl) {
+    case SHA1_MULTI_SCALAR:
+        return ("scalar");
+    case SHA1_MULTI_SSE2:
+        return ("SSE2");
+    case SHA1_MULTI_AVX2:
+        return ("AVX2");
+    }
+    return ("unknown");
+}
+
+void
+usage() {
+    cerr << "Usage: nsec3hash_bench [-n iterations] [-s set_size] "
+        "[-i hash_iterations]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 100;
+    int set_size = 1000;
+    int hash_iterations = 10;
+    while ((ch = getopt(argc, argv, "n:s:i:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            set_size = atoi(optarg);
+            break;
+        case 'i':
+            hash_iterations = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || set_size <= 0 ||
+        hash_iterations < 0 || hash_iterations > 0xffff) {
+        usage();
+    }
+
+    // Names of the query for a non existent name and its ancestors in a
+    // signed zone.
+    vector<Name> name_objs;
+    for (int i = 0; i < set_size; i += 4) {
+        const Name name("host" + boost::lexical_cast<string>(i) +
+                        ".sub.example.com");
+        for (unsigned int j = 0; j < 4; ++j) {
+            name_objs.push_back(name.split(j));
+        }
+    }
+    name_objs.resize(set_size, Name("example.com"));
+    vector<LabelSequence> names;
+    for (size_t i = 0; i < name_objs.size(); ++i) {
+        names.push_back(LabelSequence(name_objs[i]));
+    }
+
+    const boost::scoped_ptr<NSEC3Hash> hash(
+        NSEC3Hash::create(rdata::generic::NSEC3PARAM(
+                              "1 0 " +
+                              boost::lexical_cast<string>(hash_iterations) +
+                              " aabbccdd")));
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Set size: " << set_size << endl;
+    cout << "  Hash iterations: " << hash_iterations << endl;
+    cout << "  Default implementation: " << getImplName(getSHA1MultiImpl())
+         << endl;
+
+    cout << "Benchmark for calculating hashes one by one" << endl;
+    BenchMark<NSEC3HashBenchMark>(iteration,
+                                  NSEC3HashBenchMark(*hash, names, 0));
+
+    const SHA1MultiImpl impls[] = { SHA1_MULTI_SCALAR, SHA1_MULTI_SSE2,
+                                    SHA1_MULTI_AVX2 };
+    const size_t batch_sizes[] = { 4, 64 };
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); ++i) {
+        if (!selectSHA1MultiImpl(impls[i])) {
+            cout << "Implementation " << getImplName(impls[i])
+                 << " is not available" << endl;
+            continue;
+        }
+        for (size_t j = 0; j < sizeof(batch_sizes) / sizeof(batch_sizes[0]);
+             ++j) {
+            cout << "Benchmark for calculating hashes in batches of "
+                 << batch_sizes[j] << " with the " << getImplName(impls[i])
+                 << " implementation" << endl;
+            BenchMark<NSEC3HashBenchMark>(
+                iteration, NSEC3HashBenchMark(*hash, names, batch_sizes[j]));
+        }
+    }
+
+    return (0);
+}
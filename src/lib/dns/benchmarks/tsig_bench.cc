@@ -0,0 +1,191 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <util/buffer.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <dns/tsig.h>
+#include <dns/tsigerror.h>
+#include <dns/tsigkey.h>
+#include <dns/tsigrecord.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using bundy::util::InputBuffer;
+
+namespace {
+// A signed request of a key and its wire-format data.
+struct SignedRequest {
+    SignedRequest(const TSIGKey& key_param, const vector<uint8_t>& wire) :
+        key(key_param), data(wire)
+    {
+        InputBuffer buffer(&data[0], data.size());
+        Message message(Message::PARSE);
+        message.fromWire(buffer);
+        assert(message.getTSIGRecord() != NULL);
+        record.reset(new TSIGRecord(*message.getTSIGRecord()));
+    }
+    TSIGKey key;
+    vector<uint8_t> data;
+    boost::shared_ptr<TSIGRecord> record;
+};
+
+// Emulate a server handling TSIG-signed requests: for each request, find
+// its key in the key ring, verify the request, and sign the response (the
+// request data itself, as the content doesn't matter).  If use_keyring is
+// false, the context is created from a new copy of the key parameters each
+// time, so no prepared crypto state can be reused.
+class TSIGBenchMark {
+public:
+    TSIGBenchMark(const TSIGKeyRing& keyring,
+                  const vector<SignedRequest>& requests, bool use_keyring) :
+        keyring_(keyring), requests_(requests), use_keyring_(use_keyring)
+    {}
+    unsigned int run() {
+        for (vector<SignedRequest>::const_iterator it = requests_.begin();
+             it != requests_.end();
+             ++it) {
+            if (use_keyring_) {
+                TSIGContext ctx(it->record->getName(),
+                                it->record->getRdata().getAlgorithm(),
+                                keyring_);
+                handleRequest(ctx, *it);
+            } else {
+                TSIGContext ctx(TSIGKey(it->key.getKeyName(),
+                                        it->key.getAlgorithmName(),
+                                        it->key.getSecret(),
+                                        it->key.getSecretLength()));
+                handleRequest(ctx, *it);
+            }
+        }
+        return (requests_.size());
+    }
+private:
+    void handleRequest(TSIGContext& ctx, const SignedRequest& request) {
+        const TSIGError error = ctx.verify(request.record.get(),
+                                           &request.data[0],
+                                           request.data.size());
+        assert(error == TSIGError::NOERROR());
+        ctx.sign(0, &request.data[0], request.data.size());
+    }
+
+    const TSIGKeyRing& keyring_;
+    const vector<SignedRequest>& requests_;
+    const bool use_keyring_;
+};
+
+void
+usage() {
+    cerr << "Usage: tsig_bench [-n iterations] [-k keys] [-r requests]"
+         << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000;
+    int key_count = 100;
+    int request_count = 100;
+    while ((ch = getopt(argc, argv, "n:k:r:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'k':
+            key_count = atoi(optarg);
+            break;
+        case 'r':
+            request_count = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || key_count <= 0 || request_count <= 0) {
+        usage();
+    }
+
+    const Name algorithms[] = { TSIGKey::HMACMD5_NAME(),
+                                TSIGKey::HMACSHA1_NAME(),
+                                TSIGKey::HMACSHA256_NAME() };
+    const size_t algorithm_count = sizeof(algorithms) / sizeof(algorithms[0]);
+    const string secret = "tsig-bench-secret-0123456789";
+    TSIGKeyRing keyring;
+    vector<TSIGKey> keys;
+    for (int i = 0; i < key_count; ++i) {
+        keys.push_back(TSIGKey(Name("key" + boost::lexical_cast<string>(i) +
+                                    ".example"),
+                               algorithms[i % algorithm_count],
+                               secret.c_str(), secret.size()));
+        keyring.add(keys.back());
+    }
+
+    // Signed queries, each using one of the keys in turn.
+    vector<SignedRequest> requests;
+    for (int i = 0; i < request_count; ++i) {
+        const TSIGKey& key = keys[i % key_count];
+        Message message(Message::RENDER);
+        message.setQid(i);
+        message.setOpcode(Opcode::QUERY());
+        message.setRcode(Rcode::NOERROR());
+        message.addQuestion(Question(Name("www.example.com"), RRClass::IN(),
+                                     RRType::A()));
+        MessageRenderer renderer;
+        TSIGContext ctx(key);
+        message.toWire(renderer, &ctx);
+        const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+        requests.push_back(
+            SignedRequest(key, vector<uint8_t>(data,
+                                               data + renderer.getLength())));
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Keys: " << key_count << endl;
+    cout << "  Requests: " << request_count << endl;
+
+    cout << "Benchmark for verifying and signing with keys from the key ring"
+         << endl;
+    BenchMark<TSIGBenchMark>(iteration,
+                             TSIGBenchMark(keyring, requests, true));
+
+    cout << "Benchmark for verifying and signing with new keys" << endl;
+    BenchMark<TSIGBenchMark>(iteration,
+                             TSIGBenchMark(keyring, requests, false));
+
+    return (0);
+}
@@ -20,7 +20,9 @@
 
 #include <boost/functional/hash.hpp>
 
+#include <algorithm>
 #include <cstring>
+#include <utility>
 
 namespace bundy {
 namespace dns {
@@ -161,15 +163,8 @@ LabelSequence::equals(const LabelSequence& other, bool case_sensitive) const {
     // As long as the data was originally validated as (part of) a name,
     // label length must never be a capital ascii character, so we can
     // simply compare them after converting to lower characters.
-    for (size_t i = 0; i < len; ++i) {
-        const uint8_t ch = data[i];
-        const uint8_t other_ch = other_data[i];
-        if (bundy::dns::name::internal::maptolower[ch] !=
-            bundy::dns::name::internal::maptolower[other_ch]) {
-            return (false);
-        }
-    }
-    return (true);
+    return (bundy::dns::name::internal::mismatchNoCase(data, other_data,
+                                                       len) == len);
 }
 
 NameComparisonResult
@@ -202,18 +197,25 @@ LabelSequence::compare(const LabelSequence& other,
         const int cdiff = static_cast<int>(count1) - static_cast<int>(count2);
         unsigned int count = (cdiff < 0) ? count1 : count2;
 
-        while (count > 0) {
-            const uint8_t label1 = data_[pos1];
-            const uint8_t label2 = other.data_[pos2];
+        // Find the first different character of the labels (if any), and
+        // the ordering is determined by it.
+        if (count > 0) {
             int chdiff;
-
             if (case_sensitive) {
-                chdiff = static_cast<int>(label1) - static_cast<int>(label2);
+                const uint8_t* const label1 = &data_[pos1];
+                const uint8_t* const label2 = &other.data_[pos2];
+                const std::pair<const uint8_t*, const uint8_t*> mismatch =
+                    std::mismatch(label1, label1 + count, label2);
+                chdiff = mismatch.first == label1 + count ? 0 :
+                    static_cast<int>(*mismatch.first) -
+                    static_cast<int>(*mismatch.second);
             } else {
-                chdiff = static_cast<int>(
-                    bundy::dns::name::internal::maptolower[label1]) -
-                    static_cast<int>(
-                        bundy::dns::name::internal::maptolower[label2]);
+                using bundy::dns::name::internal::maptolower;
+                const size_t i = bundy::dns::name::internal::mismatchNoCase(
+                    &data_[pos1], &other.data_[pos2], count);
+                chdiff = i == count ? 0 :
+                    static_cast<int>(maptolower[data_[pos1 + i]]) -
+                    static_cast<int>(maptolower[other.data_[pos2 + i]]);
             }
 
             if (chdiff != 0) {
@@ -222,9 +224,6 @@ LabelSequence::compare(const LabelSequence& other,
                             nlabels == 0 ? NameComparisonResult::NONE :
                             NameComparisonResult::COMMONANCESTOR));
             }
-            --count;
-            ++pos1;
-            ++pos2;
         }
         if (cdiff != 0) {
             return (NameComparisonResult(
@@ -26,6 +26,7 @@
 #include <cassert>
 #include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace bundy {
@@ -63,6 +64,9 @@ struct MasterLexer::MasterLexerImpl {
         separators_.set('"');
         esc_separators_.set('\r');
         esc_separators_.set('\n');
+        run_stops_ = separators_;
+        run_stops_.set(';');
+        run_stops_.set('\\');
     }
 
     // A helper method to skip possible comments toward the end of EOL or EOF.
@@ -81,6 +85,20 @@ struct MasterLexer::MasterLexerImpl {
         return (c);
     }
 
+    // Append the characters of a string or number token from the current
+    // position to data_ at once, up to the first character that needs
+    // special handling, if the source supports it (see
+    // InputSource::getCharRun()).  This must not be called if the last
+    // character was an escaping backslash.  Returns the appended characters.
+    std::pair<const char*, size_t> appendCharRun() {
+        const char* run = NULL;
+        const size_t len = source_->getCharRun(run_stops_, &run);
+        if (len > 0) {
+            data_.insert(data_.end(), run, run + len);
+        }
+        return (std::pair<const char*, size_t>(run, len));
+    }
+
     bool isTokenEnd(int c, bool escaped) {
         // Special case of EOF (end of stream); this is not in the bitmaps
         if (c == InputSource::END_OF_STREAM) {
@@ -126,6 +144,9 @@ struct MasterLexer::MasterLexerImpl {
     // if escaped by a backslash.  See isTokenEnd() for the bitmap size.
     std::bitset<128> separators_;
     std::bitset<128> esc_separators_;
+    // Characters that stop appendCharRun(): the separators, and those that
+    // start a comment or an escape.
+    std::bitset<128> run_stops_;
 
     // These are to allow restoring state before previous token.
     bool has_previous_;
@@ -177,6 +198,19 @@ MasterLexer::pushSource(std::istream& input) {
     impl_->setTotalSize();
 }
 
+void
+MasterLexer::pushSource(const char* data, size_t length,
+                        const std::string& name, size_t first_line)
+{
+    impl_->sources_.push_back(InputSourcePtr(new InputSource(data, length,
+                                                             name,
+                                                             first_line)));
+    impl_->source_ = impl_->sources_.back().get();
+    impl_->has_previous_ = false;
+    impl_->last_was_eol_ = true;
+    impl_->setTotalSize();
+}
+
 void
 MasterLexer::popSource() {
     if (impl_->sources_.empty()) {
@@ -519,6 +553,9 @@ String::handle(MasterLexer& lexer) const {
 
     bool escaped = false;
     while (true) {
+        if (!escaped) {
+            getLexerImpl(lexer)->appendCharRun();
+        }
         const int c = getLexerImpl(lexer)->skipComment(
             getLexerImpl(lexer)->source_->getChar(), escaped);
 
@@ -584,6 +621,15 @@ Number::handle(MasterLexer& lexer) const {
     bool escaped = false;
 
     while (true) {
+        if (!escaped) {
+            const std::pair<const char*, size_t> run =
+                getLexerImpl(lexer)->appendCharRun();
+            for (size_t i = 0; digits_only && i < run.second; ++i) {
+                if (!isdigit(run.first[i])) {
+                    digits_only = false;
+                }
+            }
+        }
         const int c = getLexerImpl(lexer)->skipComment(
             getLexerImpl(lexer)->source_->getChar(), escaped);
         if (getLexerImpl(lexer)->isTokenEnd(c, escaped)) {
@@ -424,6 +424,26 @@ public:
     /// representation of DNS RRs.
     void pushSource(std::istream& input);
 
+    /// \brief Make the given region of memory the current input source of
+    /// MasterLexer.
+    ///
+    /// The data are not copied, so the caller must keep the region valid
+    /// as long as it's used in \c MasterLexer, as in the case of the
+    /// stream version.  \c getSourceName() returns the given \c name, and
+    /// the line number of the first line in the region is \c first_line.
+    /// This is useful to parse part of a larger input, such as a file
+    /// already mapped in memory, while reporting the position in the
+    /// original input.
+    ///
+    /// \throw std::bad_alloc Internal resource allocation fails (rare case).
+    ///
+    /// \param data The beginning of the region.
+    /// \param length The length of the region in bytes.
+    /// \param name The name of the source.
+    /// \param first_line The line number of the first line of the region.
+    void pushSource(const char* data, size_t length, const std::string& name,
+                    size_t first_line = 1);
+
     /// \brief Stop using the most recently opened input source (file or
     /// stream).
     ///
@@ -17,10 +17,18 @@
 
 #include <istream>
 #include <iostream>
+#include <limits>
 #include <cassert>
 #include <cerrno>
 #include <cstring>
 
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace bundy {
 namespace dns {
 namespace master_lexer_internal {
@@ -94,6 +102,10 @@ InputSource::InputSource(std::istream& input_stream) :
     saved_line_(line_),
     buffer_pos_(0),
     total_pos_(0),
+    mapped_data_(NULL),
+    mapped_size_(0),
+    mark_pos_(0),
+    unmap_(false),
     name_(createStreamName(input_stream)),
     input_(input_stream),
     input_size_(getStreamSize(input_))
@@ -118,6 +130,47 @@ openFileStream(std::ifstream& file_stream, const char* filename) {
 
     return (file_stream);
 }
+
+// Try to map the whole file into memory.  Returns NULL if it's not a regular
+// file, is empty, or cannot be mapped for whatever reason; the caller then
+// falls back to the file stream (which also reports errors in opening the
+// file).
+const char*
+mapFile(const char* filename, size_t* size) {
+    const int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return (NULL);
+    }
+    void* addr = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        static_cast<uint64_t>(st.st_size) <=
+        std::numeric_limits<size_t>::max()) {
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);                  // the mapping remains valid
+    if (addr == MAP_FAILED) {
+        return (NULL);
+    }
+    // It's just a hint, so we ignore any error.
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    *size = st.st_size;
+    return (static_cast<const char*>(addr));
+}
+
+// A helper to initialize InputSource::input_ for a file.  If the file is
+// mapped, the returned stream is the unopened file_stream, which will never
+// be used.
+std::istream&
+openFile(std::ifstream& file_stream, const char* filename,
+         const char** mapped_data, size_t* mapped_size)
+{
+    *mapped_data = mapFile(filename, mapped_size);
+    if (*mapped_data != NULL) {
+        return (file_stream);
+    }
+    return (openFileStream(file_stream, filename));
+}
 }
 
 InputSource::InputSource(const char* filename) :
@@ -126,13 +179,40 @@ InputSource::InputSource(const char* filename) :
     saved_line_(line_),
     buffer_pos_(0),
     total_pos_(0),
+    mapped_data_(NULL),
+    mapped_size_(0),
+    mark_pos_(0),
+    unmap_(false),
     name_(filename),
-    input_(openFileStream(file_stream_, filename)),
-    input_size_(getStreamSize(input_))
+    input_(openFile(file_stream_, filename, &mapped_data_, &mapped_size_)),
+    input_size_(mapped_data_ != NULL ? mapped_size_ : getStreamSize(input_))
+{
+    unmap_ = (mapped_data_ != NULL);
+}
+
+InputSource::InputSource(const char* data, size_t length,
+                         const std::string& name, size_t first_line) :
+    at_eof_(false),
+    line_(first_line),
+    saved_line_(line_),
+    buffer_pos_(0),
+    total_pos_(0),
+    // An empty region may be given as NULL, but the mapped mode needs a
+    // valid pointer.
+    mapped_data_(data != NULL ? data : ""),
+    mapped_size_(length),
+    mark_pos_(0),
+    unmap_(false),
+    name_(name),
+    input_(file_stream_),       // never used
+    input_size_(length)
 {}
 
 InputSource::~InputSource()
 {
+    if (unmap_) {
+        munmap(const_cast<char*>(mapped_data_), mapped_size_);
+    }
     if (file_stream_.is_open()) {
         file_stream_.close();
     }
@@ -140,32 +220,43 @@ InputSource::~InputSource()
 
 int
 InputSource::getChar() {
-    if (buffer_pos_ == buffer_.size()) {
-        // We may have reached EOF at the last call to
-        // getChar(). at_eof_ will be set then. We then simply return
-        // early.
-        if (at_eof_) {
-            return (END_OF_STREAM);
-        }
-        // We are not yet at EOF. Read from the stream.
-        const int c = input_.get();
-        // Have we reached EOF now? If so, set at_eof_ and return early,
-        // but don't modify buffer_pos_ (which should still be equal to
-        // the size of buffer_).
-        if (input_.eof()) {
+    int c;
+    if (mapped_data_ != NULL) {
+        // The whole file is available in memory, so we simply return the
+        // next character, if any.
+        if (buffer_pos_ == mapped_size_) {
             at_eof_ = true;
             return (END_OF_STREAM);
         }
-        // This has to come after the .eof() check as some
-        // implementations seem to check the eofbit also in .fail().
-        if (input_.fail()) {
-            bundy_throw(MasterLexer::ReadError,
-                      "Error reading from the input stream: " << getName());
+        c = mapped_data_[buffer_pos_];
+    } else {
+        if (buffer_pos_ == buffer_.size()) {
+            // We may have reached EOF at the last call to
+            // getChar(). at_eof_ will be set then. We then simply return
+            // early.
+            if (at_eof_) {
+                return (END_OF_STREAM);
+            }
+            // We are not yet at EOF. Read from the stream.
+            const int read_c = input_.get();
+            // Have we reached EOF now? If so, set at_eof_ and return early,
+            // but don't modify buffer_pos_ (which should still be equal to
+            // the size of buffer_).
+            if (input_.eof()) {
+                at_eof_ = true;
+                return (END_OF_STREAM);
+            }
+            // This has to come after the .eof() check as some
+            // implementations seem to check the eofbit also in .fail().
+            if (input_.fail()) {
+                bundy_throw(MasterLexer::ReadError,
+                          "Error reading from the input stream: " << getName());
+            }
+            buffer_.push_back(read_c);
         }
-        buffer_.push_back(c);
+        c = buffer_[buffer_pos_];
     }
 
-    const int c = buffer_[buffer_pos_];
     ++buffer_pos_;
     ++total_pos_;
     if (c == '\n') {
@@ -175,17 +266,44 @@ InputSource::getChar() {
     return (c);
 }
 
+size_t
+InputSource::getCharRun(const std::bitset<128>& stop_chars,
+                        const char** run)
+{
+    assert(stop_chars['\n']);
+    if (mapped_data_ == NULL) {
+        return (0);
+    }
+    const char* const begin = mapped_data_ + buffer_pos_;
+    const char* const end = mapped_data_ + mapped_size_;
+    const char* cp = begin;
+    while (cp != end) {
+        const unsigned char c = *cp;
+        if (c >= 0x80 || stop_chars[c]) {
+            break;
+        }
+        ++cp;
+    }
+    const size_t len = cp - begin;
+    buffer_pos_ += len;
+    total_pos_ += len;
+    *run = begin;
+    return (len);
+}
+
 void
 InputSource::ungetChar() {
     if (at_eof_) {
         at_eof_ = false;
-    } else if (buffer_pos_ == 0) {
+    } else if (buffer_pos_ == mark_pos_) {
         bundy_throw(UngetBeforeBeginning,
                   "Cannot skip before the start of buffer");
     } else {
         --buffer_pos_;
         --total_pos_;
-        if (buffer_[buffer_pos_] == '\n') {
+        const char c = (mapped_data_ != NULL) ? mapped_data_[buffer_pos_] :
+            buffer_[buffer_pos_];
+        if (c == '\n') {
             --line_;
         }
     }
@@ -193,9 +311,10 @@ InputSource::ungetChar() {
 
 void
 InputSource::ungetAll() {
-    assert(total_pos_ >= buffer_pos_);
-    total_pos_ -= buffer_pos_;
-    buffer_pos_ = 0;
+    assert(buffer_pos_ >= mark_pos_);
+    assert(total_pos_ >= buffer_pos_ - mark_pos_);
+    total_pos_ -= buffer_pos_ - mark_pos_;
+    buffer_pos_ = mark_pos_;
     line_ = saved_line_;
     at_eof_ = false;
 }
@@ -207,6 +326,11 @@ InputSource::saveLine() {
 
 void
 InputSource::compact() {
+    if (mapped_data_ != NULL) {
+        // Nothing to release; we just remember the position.
+        mark_pos_ = buffer_pos_;
+        return;
+    }
     if (buffer_pos_ == buffer_.size()) {
         buffer_.clear();
     } else {
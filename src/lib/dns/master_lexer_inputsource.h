@@ -19,6 +19,7 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <bitset>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -36,6 +37,15 @@ namespace master_lexer_internal {
 /// can have multiple InputSources if $INCLUDE is used. The source can
 /// also be generic input stream (std::istream).
 ///
+/// If the source is a regular file, it's mapped into memory with mmap(2)
+/// and read directly from the mapped region, instead of being read
+/// through \c std::ifstream one character at a time and buffered.  This
+/// doesn't change the behavior of the public methods, except that
+/// \c getCharRun() is only effective for such sources.  Other files (such
+/// as pipes) and streams are read through \c std::istream.  Note that the
+/// file shouldn't be truncated while it's mapped; it would result in
+/// SIGBUS on access to the lost part.
+///
 /// This class is not meant for public use. We also enforce that
 /// instances are non-copyable.
 class InputSource : boost::noncopyable {
@@ -71,12 +81,27 @@ public:
     explicit InputSource(std::istream& input_stream);
 
     /// \brief Constructor which takes a filename to read from. The
-    /// associated file stream is managed internally.
+    /// associated file (memory-mapped region or stream) is managed
+    /// internally.
     ///
     /// \throws OpenError when opening the input file fails or the size of
     /// the file cannot be detected.
     explicit InputSource(const char* filename);
 
+    /// \brief Constructor which takes a region of memory to read from.
+    ///
+    /// The region is read in the same way as a memory-mapped file; it's
+    /// not copied, and the caller must keep it valid as long as the
+    /// \c InputSource is used.  This is intended to parse part of a larger
+    /// input that is already in memory.
+    ///
+    /// \param data The beginning of the region.
+    /// \param length The length of the region in bytes.
+    /// \param name The name of the source, returned by \c getName().
+    /// \param first_line The line number of the first line of the region.
+    InputSource(const char* data, size_t length, const std::string& name,
+                size_t first_line);
+
     /// \brief Destructor
     ~InputSource();
 
@@ -152,6 +177,26 @@ public:
     /// file fails.
     int getChar();
 
+    /// \brief Returns a run of characters from the input source at once.
+    ///
+    /// This is a faster alternative to calling \c getChar() repeatedly
+    /// when the caller is only interested in the characters until one of
+    /// the given \c stop_chars.  It returns the number of characters from
+    /// the current position, none of which is in \c stop_chars or has the
+    /// most significant bit set, and advances the position past them (as
+    /// if \c getChar() was called for each of them).  \c run is set to
+    /// the beginning of these characters, which are valid until the
+    /// source is destroyed.  \c stop_chars must contain '\\n', so the
+    /// current line doesn't change.
+    ///
+    /// This method only works for memory-mapped file sources.  For other
+    /// sources, it returns 0 without changing anything, and the caller is
+    /// expected to fall back to \c getChar().  It also returns 0 if the
+    /// next character is in \c stop_chars or at the end of the source.
+    ///
+    /// \throw None
+    size_t getCharRun(const std::bitset<128>& stop_chars, const char** run);
+
     /// \brief Skips backward a single character in the input
     /// source. The last-read character is unget.
     ///
@@ -176,6 +221,16 @@ private:
     size_t buffer_pos_;
     size_t total_pos_;
 
+    // For a memory-mapped file (or a region of memory given on
+    // construction), these point to the mapped file, which replaces buffer_.
+    // buffer_pos_ is then the offset in the file, and mark_pos_ is the
+    // offset where compact() was last called.  mark_pos_ is always 0
+    // otherwise.  unmap_ is true iff we mapped the file ourselves.
+    const char* mapped_data_;
+    size_t mapped_size_;
+    size_t mark_pos_;
+    bool unmap_;
+
     const std::string name_;
     std::ifstream file_stream_;
     std::istream& input_;
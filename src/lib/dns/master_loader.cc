@@ -21,23 +21,37 @@
 #include <dns/rrtype.h>
 #include <dns/rdata.h>
 
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp> // for iequals
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <memory>
 #include <vector>
 
 #include <cstdio> // for sscanf()
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using std::string;
 using std::auto_ptr;
 using std::vector;
 using std::pair;
 using boost::algorithm::iequals;
 using boost::shared_ptr;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 
 namespace bundy {
 namespace dns {
@@ -54,6 +68,297 @@ public:
     {}
 };
 
+typedef shared_ptr<RRTTL> RRTTLPtr;
+
+// An RR parsed from a chunk of a master file in the parallel mode, to be
+// passed to the add callback later.
+struct ParsedRR {
+    ParsedRR(const Name& name_param, const RRType& type_param,
+             const RRTTL& ttl_param, const rdata::RdataPtr& rdata_param) :
+        name(name_param), type(type_param), ttl(ttl_param),
+        rdata(rdata_param)
+    {}
+    Name name;
+    RRType type;
+    RRTTL ttl;
+    rdata::RdataPtr rdata;
+};
+
+// An error or warning found in a chunk of a master file in the parallel
+// mode, to be passed to the callbacks later.
+struct ParseIssue {
+    enum Type {
+        ERROR,
+        WARNING,
+        RFC1035_TTL_WARNING     // only reported if it's the first one
+    };
+    ParseIssue(Type type_param, size_t rr_index_param,
+               const string& source_param, size_t line_param,
+               const string& reason_param) :
+        type(type_param), rr_index(rr_index_param), source(source_param),
+        line(line_param), reason(reason_param)
+    {}
+    Type type;
+    size_t rr_index;            // number of RRs of the chunk preceding it
+    string source;
+    size_t line;
+    string reason;
+};
+
+// A chunk of a master file to be parsed in the parallel mode, and the result
+// of parsing it.  The chunk begins at the beginning of a line with an owner
+// name, so it doesn't depend on the last name of the preceding part.  The
+// origin and the default TTL at the beginning are determined by the
+// splitter from the preceding directives.  The default TTL may also be
+// set from the SOA minimum TTL, and the current TTL depends on the preceding
+// RRs, so the parser records whether it uses them and the loader checks it
+// later (see MasterLoaderImpl::isChunkValid()).
+struct Chunk {
+    Chunk(const char* data_param, size_t length_param,
+          size_t first_line_param, const Name& origin_param,
+          const RRTTLPtr& default_ttl_param) :
+        data(data_param), length(length_param), first_line(first_line_param),
+        origin(origin_param), default_ttl(default_ttl_param), parsed(false)
+    {
+        reset();
+    }
+
+    // Clear the result of parsing, so it can be parsed again.
+    void reset() {
+        rrs.clear();
+        issues.clear();
+        last_default_ttl.reset();
+        last_current_ttl.reset();
+        used_default_ttl = false;
+        used_current_ttl = false;
+        seen_error = false;
+        failed = false;
+        error.clear();
+        rr_count = 0;
+        delivered = false;
+        retry = false;
+    }
+
+    // Set by the splitter
+    const char* const data;
+    const size_t length;
+    const size_t first_line;
+    const Name origin;
+    const RRTTLPtr default_ttl; // From $TTL; NULL if there's no preceding one
+
+    // Set by the parser
+    vector<ParsedRR> rrs;
+    vector<ParseIssue> issues;
+    RRTTLPtr last_default_ttl;  // TTLs at the end, if set in the chunk
+    RRTTLPtr last_current_ttl;
+    bool used_default_ttl;      // The TTLs at the beginning were used
+    bool used_current_ttl;
+    bool seen_error;
+    bool failed;                // Stopped at an error without MANY_ERRORS
+    string error;               // The error that stopped the parser
+    size_t rr_count;
+    bool delivered;             // RRs have been passed in the UNORDERED mode
+    bool retry;                 // Parsing failed unexpectedly
+    bool parsed;                // protected by ParallelState::mutex_
+};
+
+typedef shared_ptr<Chunk> ChunkPtr;
+
+// Parameters of the parallel mode.  We split a file into chunks of about
+// (file size / (thread count * CHUNKS_PER_THREAD)) bytes within the range of
+// [MIN_CHUNK_SIZE, MAX_CHUNK_SIZE], and let the threads parse up to
+// (thread count * PENDING_CHUNKS_PER_THREAD) chunks ahead of the delivery,
+// to limit the memory for the parsed RRs.
+const size_t MIN_CHUNK_SIZE = 64 * 1024;
+const size_t MAX_CHUNK_SIZE = 4 * 1024 * 1024;
+const size_t CHUNKS_PER_THREAD = 8;
+const size_t PENDING_CHUNKS_PER_THREAD = 4;
+
+// Map the whole file into memory for the parallel mode.  Returns NULL if
+// it's not a regular file, is empty, or cannot be mapped for whatever reason;
+// the caller then falls back to the sequential mode (which also reports
+// errors in opening the file).  This is similar to what InputSource does
+// for a file, but we need the mapped data here to split them.
+const char*
+mapMasterFile(const char* filename, size_t* size) {
+    const int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return (NULL);
+    }
+    void* addr = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        static_cast<uint64_t>(st.st_size) <=
+        std::numeric_limits<size_t>::max()) {
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);                  // the mapping remains valid
+    if (addr == MAP_FAILED) {
+        return (NULL);
+    }
+    *size = st.st_size;
+    return (static_cast<const char*>(addr));
+}
+
+// Process a directive found by splitMasterFile(), updating the origin and
+// the default TTL for the subsequent chunks.  Returns false if the file
+// can't be split because of the directive.
+bool
+handleSplitDirective(const char* data, size_t length, Name& origin,
+                     RRTTLPtr& default_ttl)
+{
+    try {
+        MasterLexer lexer;
+        lexer.pushSource(data, length, "");
+        const MasterToken::StringRegion& directive =
+            lexer.getNextToken(MasterToken::STRING).getStringRegion();
+        const string name(directive.beg + 1, directive.len - 1);
+        if (iequals(name, "INCLUDE")) {
+            // We'd need to handle the included file in the same way.  It's
+            // rarely used for a large file, so we simply give up.
+            return (false);
+        } else if (iequals(name, "ORIGIN")) {
+            const MasterToken::StringRegion& name_string =
+                lexer.getNextToken(MasterToken::QSTRING).getStringRegion();
+            origin = Name(name_string.beg, name_string.len, &origin);
+        } else if (iequals(name, "TTL")) {
+            RRTTL ttl(lexer.getNextToken(MasterToken::STRING).getString());
+            if (ttl > RRTTL::MAX_TTL()) {
+                ttl = RRTTL(0); // see MasterLoaderImpl::limitTTL()
+            }
+            default_ttl.reset(new RRTTL(ttl));
+        }
+        // Others don't change the state of the subsequent chunks.
+    } catch (const bundy::Exception&) {
+        // Leave it to the sequential mode to report the error.
+        return (false);
+    }
+    return (true);
+}
+
+// Whether a line beginning with the given character starts with an owner
+// name.  We exclude the case of a quoted name to keep it simple.
+inline bool
+isOwnerStart(char c) {
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case ';':
+    case '$':
+    case '(':
+    case ')':
+    case '"':
+        return (false);
+    default:
+        return (true);
+    }
+}
+
+// Split the data of a master file into chunks of at least chunk_size bytes
+// (except for the last one) for the parallel mode.  The chunks begin at
+// the beginning of lines that start with an owner name, and are not in
+// parentheses.  Returns false if the file can't be split safely, in which
+// case it should be parsed sequentially.
+//
+// This is a simplified version of the lexer, just to identify the lines.
+// Note that a backslash escapes the next character other than a newline
+// (which still ends the line) outside of quoted strings.
+bool
+splitMasterFile(const char* data, size_t length, size_t chunk_size,
+                const Name& zone_origin, vector<ChunkPtr>& chunks)
+{
+    const char* const end = data + length;
+    Name origin = zone_origin;
+    RRTTLPtr default_ttl;
+    const char* chunk_begin = data;
+    size_t chunk_line = 1;
+    Name chunk_origin = origin;
+    RRTTLPtr chunk_default_ttl;
+    const char* directive = (*data == '$') ? data : NULL;
+    size_t line = 1;
+    size_t paren_count = 0;
+    bool in_quote = false;
+    for (const char* cp = data; cp != end; ++cp) {
+        const char c = *cp;
+        if (c == '\n') {
+            ++line;
+            if (in_quote) {
+                return (false); // unbalanced quotes
+            }
+            if (paren_count > 0) {
+                continue;
+            }
+            // The end of a line.
+            if (directive != NULL) {
+                if (!handleSplitDirective(directive, cp + 1 - directive,
+                                          origin, default_ttl)) {
+                    return (false);
+                }
+                directive = NULL;
+            }
+            const char* const next = cp + 1;
+            if (next == end) {
+                break;
+            } else if (*next == '$') {
+                directive = next;
+            } else if (static_cast<size_t>(next - chunk_begin) >= chunk_size &&
+                       isOwnerStart(*next)) {
+                chunks.push_back(ChunkPtr(new Chunk(chunk_begin,
+                                                    next - chunk_begin,
+                                                    chunk_line, chunk_origin,
+                                                    chunk_default_ttl)));
+                chunk_begin = next;
+                chunk_line = line;
+                chunk_origin = origin;
+                chunk_default_ttl = default_ttl;
+            }
+        } else if (c == '\\') {
+            if (cp + 1 != end && (in_quote || cp[1] != '\n')) {
+                ++cp;
+                if (*cp == '\n') {
+                    ++line;
+                }
+            }
+        } else if (c == '"') {
+            in_quote = !in_quote;
+        } else if (in_quote) {
+            continue;
+        } else if (c == ';') {
+            cp = std::find(cp, end, '\n') - 1; // skip the comment
+        } else if (c == '(') {
+            ++paren_count;
+        } else if (c == ')') {
+            if (paren_count == 0) {
+                return (false); // unbalanced parentheses
+            }
+            --paren_count;
+        }
+    }
+    chunks.push_back(ChunkPtr(new Chunk(chunk_begin, end - chunk_begin,
+                                        chunk_line, chunk_origin,
+                                        chunk_default_ttl)));
+    return (true);
+}
+
+void
+addChunkRR(Chunk* chunk, const Name& name, const RRClass&,
+           const RRType& type, const RRTTL& ttl, const rdata::RdataPtr& rdata)
+{
+    chunk->rrs.push_back(ParsedRR(name, type, ttl, rdata));
+}
+
+void
+addChunkIssue(Chunk* chunk, ParseIssue::Type type, const string& source,
+              size_t line, const string& reason)
+{
+    chunk->issues.push_back(ParseIssue(type, chunk->rrs.size(), source, line,
+                                       reason));
+}
+
+typedef shared_ptr<Thread> ThreadPtr;
+
 } // end unnamed namespace
 
 /// \brief Private implementation class for the \c MasterLoader
@@ -83,13 +388,15 @@ public:
     ///     the Options values or DEFAULT. If the MANY_ERRORS option is
     ///     included, the parser tries to continue past errors. If it
     ///     is not included, it stops at first encountered error.
+    /// \param thread_count The number of threads to parse the file with.
     /// \throw std::bad_alloc when there's not enough memory.
     MasterLoaderImpl(const char* master_file,
                      const Name& zone_origin,
                      const RRClass& zone_class,
                      const MasterLoaderCallbacks& callbacks,
                      const AddRRCallback& add_callback,
-                     MasterLoader::Options options) :
+                     MasterLoader::Options options,
+                     size_t thread_count) :
         lexer_(),
         zone_origin_(zone_origin),
         active_origin_(zone_origin),
@@ -102,12 +409,21 @@ public:
         ok_(true),
         many_errors_((options & MANY_ERRORS) != 0),
         previous_name_(false),
+        thread_count_(thread_count),
+        chunk_(NULL),
+        default_ttl_set_(false),
+        current_ttl_set_(false),
         complete_(false),
         seen_error_(false),
         warn_rfc1035_ttl_(true),
         rr_count_(0)
     {}
 
+    /// \brief Destructor.
+    ///
+    /// It stops the threads of the parallel mode, if any.
+    ~MasterLoaderImpl();
+
     /// \brief Wrapper around \c MasterLexer::pushSource() (file version)
     ///
     /// This method is used as a wrapper around the lexer's
@@ -153,13 +469,92 @@ public:
 
     /// \brief Return the total size of the input sources pushed so
     /// far. See \c MasterLexer::getTotalSourceSize().
-    size_t getSize() const { return (lexer_.getTotalSourceSize()); }
+    size_t getSize() const;
 
     /// \brief Return the line number being parsed in the pushed input
     /// sources. See \c MasterLexer::getPosition().
-    size_t getPosition() const { return (lexer_.getPosition()); }
+    size_t getPosition() const;
 
 private:
+    /// \brief Start the parallel mode.
+    ///
+    /// It maps the file, splits it into chunks and starts the threads to
+    /// parse them.  If the file can't be parsed in parallel, it returns
+    /// false and the file should be parsed sequentially.
+    bool startParallel();
+
+    /// \brief The parallel version of \c loadIncremental().
+    ///
+    /// It passes the result of the parsed chunks to the callbacks in the
+    /// order of the file.
+    bool loadParallel(size_t count_limit);
+
+    /// \brief The main function of the threads of the parallel mode.
+    void runParseThread();
+
+    /// \brief Stop and wait for the threads of the parallel mode.
+    void stopThreads();
+
+    /// \brief Parse a chunk of the file in the parallel mode.
+    ///
+    /// The chunk is parsed with a separate \c MasterLoaderImpl, starting
+    /// with the given TTLs, and the result is stored in the chunk.  This
+    /// can be called from any thread.
+    void parseChunk(Chunk& chunk, const RRTTLPtr& default_ttl,
+                    const RRTTLPtr& current_ttl) const;
+
+    /// \brief Prepare to parse a chunk, see \c parseChunk().
+    void initChunk(Chunk& chunk, const RRTTLPtr& default_ttl,
+                   const RRTTLPtr& current_ttl)
+    {
+        lexer_.pushSource(chunk.data, chunk.length, master_file_,
+                          chunk.first_line);
+        initialized_ = true;
+        active_origin_ = chunk.origin;
+        if (default_ttl) {
+            default_ttl_.reset(new RRTTL(*default_ttl));
+        }
+        if (current_ttl) {
+            current_ttl_.reset(new RRTTL(*current_ttl));
+        }
+        chunk_ = &chunk;
+    }
+
+    /// \brief Check if a chunk was parsed with the correct state.
+    ///
+    /// The current default and current TTLs must be those at the beginning
+    /// of the chunk.
+    bool isChunkValid(const Chunk& chunk) const {
+        if (chunk.used_default_ttl &&
+            !((!chunk.default_ttl && !default_ttl_) ||
+              (chunk.default_ttl && default_ttl_ &&
+               *chunk.default_ttl == *default_ttl_))) {
+            return (false);
+        }
+        // The chunks are parsed without the current TTL.
+        return (!chunk.used_current_ttl || !current_ttl_);
+    }
+
+    /// \brief Pass the issues of a chunk preceding the RR of the given
+    /// index in the chunk to the callbacks.
+    void reportChunkIssues(const Chunk& chunk, size_t rr_index);
+
+    /// \brief Record that the TTLs at the beginning of a chunk are used.
+    ///
+    /// This is called when we use the default TTL (or its absence) and/or
+    /// the current TTL.  It only matters when parsing a chunk and the TTL
+    /// hasn't been set in it.
+    void useInitialTTL(bool default_ttl, bool current_ttl) {
+        if (chunk_ != NULL) {
+            if (default_ttl && !default_ttl_set_) {
+                chunk_->used_default_ttl = true;
+            }
+            if (current_ttl && !current_ttl_set_) {
+                chunk_->used_current_ttl = true;
+            }
+        }
+    }
+
     /// \brief Report an error using the callbacks that were supplied
     /// during \c MasterLoader construction. Note that this method also
     /// throws \c MasterLoaderError exception if necessary, so the
@@ -379,6 +774,7 @@ private:
     void setDefaultTTL(const RRTTL& ttl, bool post_parsing) {
         assignTTL(default_ttl_, ttl);
         limitTTL(*default_ttl_, post_parsing);
+        default_ttl_set_ = true;
     }
 
     /// \brief Try to set/reset the current TTL from candidate TTL text.
@@ -398,6 +794,7 @@ private:
         if (rrttl) {
             current_ttl_.reset(rrttl);
             limitTTL(*current_ttl_, false);
+            current_ttl_set_ = true;
             return (true);
         }
         return (false);
@@ -420,6 +817,7 @@ private:
         const size_t current_line = lexer_.getSourceLine() - 1;
 
         if (!current_ttl_ && !default_ttl_) {
+            useInitialTTL(true, true);
             if (rrtype == RRType::SOA()) {
                 callbacks_.warning(lexer_.getSourceName(), current_line,
                                    "no TTL specified; "
@@ -429,6 +827,7 @@ private:
                     getMinimum();
                 setDefaultTTL(RRTTL(ttl_val), true);
                 assignTTL(current_ttl_, *default_ttl_);
+                current_ttl_set_ = true;
             } else {
                 // On catching the exception we'll try to reach EOL again,
                 // so we need to unget it now.
@@ -437,14 +836,27 @@ private:
                                         "no TTL specified; load rejected");
             }
         } else if (!explicit_ttl && default_ttl_) {
+            useInitialTTL(true, false);
             assignTTL(current_ttl_, *default_ttl_);
-        } else if (!explicit_ttl && warn_rfc1035_ttl_) {
-            // Omitted (class and) TTL values are default to the last
-            // explicitly stated values (RFC 1035, Sec. 5.1).
-            callbacks_.warning(lexer_.getSourceName(), current_line,
-                               "using RFC1035 TTL semantics; default to the "
-                               "last explicitly stated TTL");
-            warn_rfc1035_ttl_ = false; // we only warn about this once
+            current_ttl_set_ = true;
+        } else if (!explicit_ttl) {
+            useInitialTTL(true, true);
+            if (warn_rfc1035_ttl_) {
+                // Omitted (class and) TTL values are default to the last
+                // explicitly stated values (RFC 1035, Sec. 5.1).
+                const char* const reason = "using RFC1035 TTL semantics; "
+                    "default to the last explicitly stated TTL";
+                if (chunk_ != NULL) {
+                    // Whether it's the first one is known only later.
+                    addChunkIssue(chunk_, ParseIssue::RFC1035_TTL_WARNING,
+                                  lexer_.getSourceName(), current_line,
+                                  reason);
+                } else {
+                    callbacks_.warning(lexer_.getSourceName(), current_line,
+                                       reason);
+                }
+                warn_rfc1035_ttl_ = false; // we only warn about this once
+            }
         }
         assert(current_ttl_);
         return (*current_ttl_);
@@ -544,6 +956,16 @@ private:
     bool previous_name_; // True if there was a previous name in this file
                          // (false at the beginning or after an $INCLUDE line)
 
+    // For the parallel mode
+    const size_t thread_count_;
+    struct ParallelState;
+    boost::scoped_ptr<ParallelState> parallel_;
+    // For parsing a chunk in the parallel mode: the chunk, and whether the
+    // default and current TTLs have been set in it.
+    Chunk* chunk_;
+    bool default_ttl_set_;
+    bool current_ttl_set_;
+
 public:
     bool complete_;             // All work done.
     bool seen_error_;           // Was there at least one error during the
@@ -943,6 +1365,299 @@ MasterLoader::MasterLoaderImpl::handleInitialToken() {
     }
 }
 
+// The state of the parallel mode, shared by the calling thread and the
+// parsing threads.
+struct MasterLoader::MasterLoaderImpl::ParallelState {
+    ParallelState(const char* data, size_t size) :
+        data_(data), size_(size), position_(0), next_deliver_(0),
+        chunk_started_(false), rr_index_(0), issue_index_(0), next_parse_(0),
+        stop_(false)
+    {}
+    ~ParallelState() {
+        munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* const data_;    // The mapped file
+    const size_t size_;
+    vector<ChunkPtr> chunks_;
+    vector<ThreadPtr> threads_;
+    size_t position_;           // The size of the delivered chunks
+
+    // The chunk being delivered, and the state in it.  next_deliver_ is
+    // protected by mutex_, but can be read without it in the calling thread.
+    size_t next_deliver_;
+    bool chunk_started_;
+    size_t rr_index_;
+    size_t issue_index_;
+
+    Mutex mutex_;
+    CondVar parse_cond_;        // Signaled when a thread can parse a chunk
+    CondVar parsed_cond_;       // Signaled when a chunk has been parsed
+    size_t next_parse_;         // protected by mutex_
+    bool stop_;                 // protected by mutex_
+};
+
+MasterLoader::MasterLoaderImpl::~MasterLoaderImpl() {
+    if (parallel_) {
+        stopThreads();
+    }
+}
+
+size_t
+MasterLoader::MasterLoaderImpl::getSize() const {
+    if (parallel_) {
+        return (parallel_->size_);
+    }
+    return (lexer_.getTotalSourceSize());
+}
+
+size_t
+MasterLoader::MasterLoaderImpl::getPosition() const {
+    if (parallel_) {
+        return (parallel_->position_);
+    }
+    return (lexer_.getPosition());
+}
+
+bool
+MasterLoader::MasterLoaderImpl::startParallel() {
+    size_t size = 0;
+    const char* const data = mapMasterFile(master_file_.c_str(), &size);
+    if (data == NULL) {
+        return (false);
+    }
+    boost::scoped_ptr<ParallelState> parallel(new ParallelState(data, size));
+    const size_t chunk_size =
+        std::min(std::max(size / (thread_count_ * CHUNKS_PER_THREAD),
+                          MIN_CHUNK_SIZE),
+                 MAX_CHUNK_SIZE);
+    if (!splitMasterFile(data, size, chunk_size, active_origin_,
+                         parallel->chunks_) ||
+        parallel->chunks_.size() < 2) {
+        return (false);
+    }
+    parallel_.swap(parallel);
+    initialized_ = true;
+
+    const size_t thread_count = std::min(thread_count_,
+                                         parallel_->chunks_.size());
+    try {
+        for (size_t i = 0; i < thread_count; ++i) {
+            parallel_->threads_.push_back(
+                ThreadPtr(new Thread(boost::bind(
+                                         &MasterLoaderImpl::runParseThread,
+                                         this))));
+        }
+    } catch (...) {
+        // Failed to start a thread.  The others (or the calling thread, if
+        // none) will parse the chunks.
+    }
+    return (true);
+}
+
+void
+MasterLoader::MasterLoaderImpl::runParseThread() {
+    ParallelState& parallel = *parallel_;
+    const size_t max_pending = thread_count_ * PENDING_CHUNKS_PER_THREAD;
+    while (true) {
+        ChunkPtr chunk;
+        {
+            const Mutex::Locker locker(parallel.mutex_);
+            while (!parallel.stop_ &&
+                   parallel.next_parse_ < parallel.chunks_.size() &&
+                   parallel.next_parse_ >=
+                   parallel.next_deliver_ + max_pending) {
+                parallel.parse_cond_.wait(parallel.mutex_);
+            }
+            if (parallel.stop_ ||
+                parallel.next_parse_ == parallel.chunks_.size()) {
+                return;
+            }
+            chunk = parallel.chunks_[parallel.next_parse_++];
+        }
+        try {
+            parseChunk(*chunk, chunk->default_ttl, RRTTLPtr());
+            // In the UNORDERED mode, we can pass the RRs right now if the
+            // chunk doesn't depend on the preceding part (the default TTL
+            // from $TTL can't be changed by it).
+            if ((options_ & UNORDERED) != 0 && !chunk->failed &&
+                !chunk->used_current_ttl &&
+                (!chunk->used_default_ttl || chunk->default_ttl)) {
+                vector<ParsedRR>::const_iterator it;
+                for (it = chunk->rrs.begin(); it != chunk->rrs.end(); ++it) {
+                    add_callback_(it->name, zone_class_, it->type, it->ttl,
+                                  it->rdata);
+                }
+                vector<ParsedRR>().swap(chunk->rrs);
+                chunk->delivered = true;
+            }
+        } catch (...) {
+            // Let the calling thread parse it again, so the exception can be
+            // propagated.  In the UNORDERED mode, it may pass some of the RRs
+            // to the add callback again.
+            chunk->retry = true;
+        }
+        {
+            const Mutex::Locker locker(parallel.mutex_);
+            chunk->parsed = true;
+        }
+        parallel.parsed_cond_.signal();
+    }
+}
+
+void
+MasterLoader::MasterLoaderImpl::stopThreads() {
+    {
+        const Mutex::Locker locker(parallel_->mutex_);
+        parallel_->stop_ = true;
+    }
+    vector<ThreadPtr>::const_iterator it;
+    for (it = parallel_->threads_.begin(); it != parallel_->threads_.end();
+         ++it) {
+        parallel_->parse_cond_.signal();
+    }
+    for (it = parallel_->threads_.begin(); it != parallel_->threads_.end();
+         ++it) {
+        try {
+            (*it)->wait();
+        } catch (...) {
+            // It shouldn't happen as the thread catches everything, and
+            // there's nothing we can do for it anyway.
+        }
+    }
+    parallel_->threads_.clear();
+}
+
+void
+MasterLoader::MasterLoaderImpl::parseChunk(Chunk& chunk,
+                                           const RRTTLPtr& default_ttl,
+                                           const RRTTLPtr& current_ttl) const
+{
+    MasterLoaderImpl parser(master_file_.c_str(), zone_origin_, zone_class_,
+                            MasterLoaderCallbacks(
+                                boost::bind(addChunkIssue, &chunk,
+                                            ParseIssue::ERROR, _1, _2, _3),
+                                boost::bind(addChunkIssue, &chunk,
+                                            ParseIssue::WARNING, _1, _2, _3)),
+                            boost::bind(addChunkRR, &chunk,
+                                        _1, _2, _3, _4, _5),
+                            options_, 1);
+    parser.initChunk(chunk, default_ttl, current_ttl);
+    try {
+        parser.loadIncremental(std::numeric_limits<size_t>::max());
+    } catch (const MasterLoaderError& ex) {
+        chunk.failed = true;
+        chunk.error = ex.what();
+    }
+    chunk.seen_error = parser.seen_error_;
+    chunk.rr_count = parser.rr_count_;
+    if (parser.default_ttl_set_) {
+        chunk.last_default_ttl.reset(new RRTTL(*parser.default_ttl_));
+    }
+    if (parser.current_ttl_set_) {
+        chunk.last_current_ttl.reset(new RRTTL(*parser.current_ttl_));
+    }
+}
+
+void
+MasterLoader::MasterLoaderImpl::reportChunkIssues(const Chunk& chunk,
+                                                  size_t rr_index)
+{
+    size_t& i = parallel_->issue_index_;
+    for (; i < chunk.issues.size() && chunk.issues[i].rr_index <= rr_index;
+         ++i) {
+        const ParseIssue& issue = chunk.issues[i];
+        switch (issue.type) {
+        case ParseIssue::ERROR:
+            callbacks_.error(issue.source, issue.line, issue.reason);
+            break;
+        case ParseIssue::WARNING:
+            callbacks_.warning(issue.source, issue.line, issue.reason);
+            break;
+        case ParseIssue::RFC1035_TTL_WARNING:
+            if (warn_rfc1035_ttl_) {
+                callbacks_.warning(issue.source, issue.line, issue.reason);
+                warn_rfc1035_ttl_ = false;
+            }
+            break;
+        }
+    }
+}
+
+bool
+MasterLoader::MasterLoaderImpl::loadParallel(size_t count_limit) {
+    ParallelState& parallel = *parallel_;
+    size_t count = 0;
+    while (count < count_limit) {
+        if (parallel.next_deliver_ == parallel.chunks_.size()) {
+            stopThreads();
+            return (true);
+        }
+        Chunk& chunk = *parallel.chunks_[parallel.next_deliver_];
+        if (!parallel.chunk_started_) {
+            {
+                const Mutex::Locker locker(parallel.mutex_);
+                while (!chunk.parsed && !parallel.threads_.empty()) {
+                    parallel.parsed_cond_.wait(parallel.mutex_);
+                }
+            }
+            if (!chunk.parsed || chunk.retry || !isChunkValid(chunk)) {
+                // Parse it here, now that we know the correct state.
+                chunk.reset();
+                parseChunk(chunk,
+                           default_ttl_ ? RRTTLPtr(new RRTTL(*default_ttl_)) :
+                           RRTTLPtr(),
+                           current_ttl_ ? RRTTLPtr(new RRTTL(*current_ttl_)) :
+                           RRTTLPtr());
+            }
+            parallel.chunk_started_ = true;
+            parallel.rr_index_ = 0;
+            parallel.issue_index_ = 0;
+        }
+
+        // Pass the RRs and the issues in the order of the file.
+        while (parallel.rr_index_ < chunk.rrs.size() && count < count_limit) {
+            reportChunkIssues(chunk, parallel.rr_index_);
+            const ParsedRR& rr = chunk.rrs[parallel.rr_index_];
+            add_callback_(rr.name, zone_class_, rr.type, rr.ttl, rr.rdata);
+            ++parallel.rr_index_;
+            ++count;
+        }
+        if (parallel.rr_index_ < chunk.rrs.size()) {
+            break;
+        }
+        reportChunkIssues(chunk, std::numeric_limits<size_t>::max());
+        if (chunk.delivered) {
+            count += chunk.rr_count;
+        }
+
+        // Complete the chunk, and update the state to that at the end of it.
+        if (chunk.last_default_ttl) {
+            assignTTL(default_ttl_, *chunk.last_default_ttl);
+        }
+        if (chunk.last_current_ttl) {
+            assignTTL(current_ttl_, *chunk.last_current_ttl);
+        }
+        rr_count_ += chunk.rr_count;
+        seen_error_ = seen_error_ || chunk.seen_error;
+        parallel.position_ += chunk.length;
+        if (chunk.failed) {
+            stopThreads();
+            ok_ = false;
+            complete_ = true;
+            bundy_throw(MasterLoaderError, chunk.error.c_str());
+        }
+        parallel.chunks_[parallel.next_deliver_].reset();
+        parallel.chunk_started_ = false;
+        {
+            const Mutex::Locker locker(parallel.mutex_);
+            ++parallel.next_deliver_;
+        }
+        parallel.parse_cond_.signal();
+    }
+    return (false);
+}
+
 bool
 MasterLoader::MasterLoaderImpl::loadIncremental(size_t count_limit) {
     if (count_limit == 0) {
@@ -952,9 +1667,12 @@ MasterLoader::MasterLoaderImpl::loadIncremental(size_t count_limit) {
         bundy_throw(bundy::InvalidOperation,
                   "Trying to load when already loaded");
     }
-    if (!initialized_) {
+    if (!initialized_ && !(thread_count_ > 1 && startParallel())) {
         pushSource(master_file_, active_origin_);
     }
+    if (parallel_) {
+        return (loadParallel(count_limit));
+    }
     size_t count = 0;
     while (ok_ && count < count_limit) {
         try {
@@ -1024,13 +1742,18 @@ MasterLoader::MasterLoader(const char* master_file,
                            const RRClass& zone_class,
                            const MasterLoaderCallbacks& callbacks,
                            const AddRRCallback& add_callback,
-                           Options options)
+                           Options options,
+                           size_t thread_count)
 {
     if (add_callback.empty()) {
         bundy_throw(bundy::InvalidParameter, "Empty add RR callback");
     }
+    if (thread_count == 0) {
+        bundy_throw(bundy::InvalidParameter, "Thread count set to 0");
+    }
     impl_ = new MasterLoaderImpl(master_file, zone_origin,
-                                 zone_class, callbacks, add_callback, options);
+                                 zone_class, callbacks, add_callback, options,
+                                 thread_count);
 }
 
 MasterLoader::MasterLoader(std::istream& stream,
@@ -1046,7 +1769,7 @@ MasterLoader::MasterLoader(std::istream& stream,
     auto_ptr<MasterLoaderImpl> impl(new MasterLoaderImpl("", zone_origin,
                                                          zone_class, callbacks,
                                                          add_callback,
-                                                         options));
+                                                         options, 1));
     impl->pushStreamSource(stream);
     impl_ = impl.release();
 }
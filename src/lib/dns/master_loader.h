@@ -41,12 +41,34 @@ public:
 /// incrementally.
 ///
 /// It reports the loaded RRs and encountered errors by callbacks.
+///
+/// When loading a file, it can parse the file in multiple threads (see
+/// the \c thread_count parameter of the constructor).  The file is then
+/// split at the beginning of lines that start with an owner name (and are
+/// not within parentheses), into chunks of a few megabytes.  The chunks
+/// are parsed by worker threads, starting with the origin and the default
+/// TTL determined by the $ORIGIN and $TTL directives preceding the chunk,
+/// and the results are passed to the callbacks in the original order from
+/// the thread calling \c load() or \c loadIncremental().  If a chunk turns
+/// out to depend on other state of the preceding part of the file (which
+/// is only the case if the TTL of an RR is determined by the TTL of a
+/// preceding RR or the SOA minimum), it's parsed again in the calling thread
+/// with the correct state.  So the result is the same as that of the
+/// sequential parse, including the order of RRs, errors and warnings.
+/// The exception is when the loading stops on an error without
+/// \c MANY_ERRORS; the errors in the subsequent part of the file (that is
+/// already parsed) are not reported.  Files that contain $INCLUDE, or cannot
+/// be mapped in memory, are always parsed sequentially.
 class MasterLoader : boost::noncopyable {
 public:
     /// \brief Options how the parsing should work.
     enum Options {
         DEFAULT = 0,       ///< Nothing special.
-        MANY_ERRORS = 1    ///< Lenient mode (see documentation of MasterLoader
+        MANY_ERRORS = 1,   ///< Lenient mode (see documentation of MasterLoader
+                           ///  constructor).
+        UNORDERED = 2      ///< The add callback may be called in any order,
+                           ///  and from multiple threads at the same time
+                           ///  (see documentation of MasterLoader
                            ///  constructor).
     };
 
@@ -76,14 +98,27 @@ public:
     ///     the Options values or DEFAULT. If the MANY_ERRORS option is
     ///     included, the parser tries to continue past errors. If it
     ///     is not included, it stops at first encountered error.
+    ///     If the UNORDERED option is included and the file is parsed in
+    ///     multiple threads, RRs of the chunks that don't depend on the
+    ///     preceding ones (see the class description) are passed to
+    ///     \c add_callback from the worker threads as soon as the chunk is
+    ///     parsed.  So \c add_callback must be thread safe then, and the
+    ///     RRs are not necessarily passed in the order of the file.  The
+    ///     other callbacks are still called from the calling thread in the
+    ///     order of the file.  This option doesn't matter in other cases.
+    /// \param thread_count The number of threads to parse the file with.
+    ///     If it's 1 (the default) or the file is small, the file is parsed
+    ///     sequentially in the calling thread.
     /// \throw std::bad_alloc when there's not enough memory.
-    /// \throw bundy::InvalidParameter if add_callback is empty.
+    /// \throw bundy::InvalidParameter if add_callback is empty or
+    ///     thread_count is 0.
     MasterLoader(const char* master_file,
                  const Name& zone_origin,
                  const RRClass& zone_class,
                  const MasterLoaderCallbacks& callbacks,
                  const AddRRCallback& add_callback,
-                 Options options = DEFAULT);
+                 Options options = DEFAULT,
+                 size_t thread_count = 1);
 
     /// \brief Constructor from a stream
     ///
@@ -108,6 +143,10 @@ public:
     /// an error (either fatal or without MANY_ERRORS) or end of file is
     /// encountered, they may be less.
     ///
+    /// In the parallel mode with the UNORDERED option, the RRs passed from
+    /// the parsing threads are counted when the loader reaches them in the
+    /// order of the file, so there may be more.
+    ///
     /// \param count_limit Upper limit on the number of RRs loaded.
     /// \return In case it stops because of the count limit, it returns false.
     ///     It returns true if the loading is done.
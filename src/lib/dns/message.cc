@@ -22,11 +22,13 @@
 
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <exceptions/exceptions.h>
 
 #include <util/buffer.h>
+#include <util/object_pool.h>
 
 #include <dns/edns.h>
 #include <dns/exceptions.h>
@@ -118,6 +120,20 @@ public:
     ConstEDNSPtr edns_;
     ConstTSIGRecordPtr tsig_rr_;
 
+    // Used for parsing with PARSE_LAZY: if deferred_ is true, the RRsets of
+    // the answer, authority and additional sections haven't been built yet.
+    // deferred_data_ is a copy of the entire wire-format message (as the
+    // names of the RRs can be compressed), and deferred_position_ is the
+    // position of the answer section in it.  The vector is kept over
+    // clear() so a reused Message normally doesn't allocate memory for it.
+    // deferred_counts_ are the RR counts of the header; unlike counts_, they
+    // include the OPT and TSIG RRs, which are skipped in the deferred parse.
+    bool deferred_;
+    vector<uint8_t> deferred_data_;
+    size_t deferred_position_;
+    int deferred_counts_[NUM_SECTIONS];
+    Message::ParseOptions deferred_options_;
+
     // RRsetsSorter* sorter_; : TODO
 
     void init();
@@ -125,7 +141,9 @@ public:
     void setRcode(const Rcode& rcode);
     int parseQuestion(InputBuffer& buffer);
     int parseSection(const Message::Section section, InputBuffer& buffer,
-                     Message::ParseOptions options);
+                     Message::ParseOptions options, bool meta_parsed = false);
+    int scanSection(const Message::Section section, InputBuffer& buffer);
+    void parseDeferredSections();
     void addRR(Message::Section section, const Name& name,
                const RRClass& rrclass, const RRType& rrtype,
                const RRTTL& ttl, ConstRdataPtr rdata,
@@ -164,9 +182,14 @@ MessageImpl::init() {
 
     for (int i = 0; i < NUM_SECTIONS; ++i) {
         counts_[i] = 0;
+        deferred_counts_[i] = 0;
     }
 
     header_parsed_ = false;
+    deferred_ = false;
+    deferred_data_.clear();
+    deferred_position_ = 0;
+    deferred_options_ = Message::PARSE_DEFAULT;
     questions_.clear();
     rrsets_[Message::SECTION_ANSWER].clear();
     rrsets_[Message::SECTION_AUTHORITY].clear();
@@ -528,6 +551,7 @@ Message::hasRRset(const Section section, const Name& name,
         bundy_throw(OutOfRange, "Invalid message section: " << section);
     }
 
+    impl_->parseDeferredSections();
     BOOST_FOREACH(ConstRRsetPtr r, impl_->rrsets_[section]) {
         if (r->getClass() == rrclass &&
             r->getType() == rrtype &&
@@ -551,6 +575,7 @@ Message::removeRRset(const Section section, RRsetIterator& iterator) {
         bundy_throw(OutOfRange, "Invalid message section: " << section);
     }
 
+    impl_->parseDeferredSections();
     bool removed = false;
     for (vector<RRsetPtr>::iterator i = impl_->rrsets_[section].begin();
             i != impl_->rrsets_[section].end(); ++i) {
@@ -651,6 +676,33 @@ Message::fromWire(InputBuffer& buffer, ParseOptions options) {
     parseHeader(buffer);
 
     impl_->counts_[SECTION_QUESTION] = impl_->parseQuestion(buffer);
+
+    if ((options & PARSE_LAZY) != 0) {
+        const size_t position = buffer.getPosition();
+        std::copy(impl_->counts_, impl_->counts_ + MessageImpl::NUM_SECTIONS,
+                  impl_->deferred_counts_);
+        impl_->counts_[SECTION_ANSWER] =
+            impl_->scanSection(SECTION_ANSWER, buffer);
+        impl_->counts_[SECTION_AUTHORITY] =
+            impl_->scanSection(SECTION_AUTHORITY, buffer);
+        impl_->counts_[SECTION_ADDITIONAL] =
+            impl_->scanSection(SECTION_ADDITIONAL, buffer);
+
+        // If there's nothing but OPT and TSIG, we are done.
+        if (impl_->counts_[SECTION_ANSWER] != 0 ||
+            impl_->counts_[SECTION_AUTHORITY] != 0 ||
+            impl_->counts_[SECTION_ADDITIONAL] != 0) {
+            const size_t end_position = buffer.getPosition();
+            buffer.setPosition(0);
+            buffer.readVector(impl_->deferred_data_, buffer.getLength());
+            buffer.setPosition(end_position);
+            impl_->deferred_position_ = position;
+            impl_->deferred_options_ = options;
+            impl_->deferred_ = true;
+        }
+        return;
+    }
+
     impl_->counts_[SECTION_ANSWER] =
         impl_->parseSection(SECTION_ANSWER, buffer, options);
     impl_->counts_[SECTION_AUTHORITY] =
@@ -679,8 +731,14 @@ MessageImpl::parseQuestion(InputBuffer& buffer) {
         // XXX: need a duplicate check.  We might also want to have an
         // optimized algorithm that requires the question section contain
         // exactly one RR.
-
-        questions_.push_back(QuestionPtr(new Question(name, rrclass, rrtype)));
+        //
+        // Objects created from a message are usually released soon (at the
+        // latest on clear()), so they are allocated from the object pool
+        // to avoid the overhead of the general memory allocator.
+
+        questions_.push_back(
+            boost::allocate_shared<Question>(PoolAllocator<Question>(),
+                                             name, rrclass, rrtype));
         ++added;
     }
 
@@ -730,15 +788,22 @@ struct MatchRR : public unary_function<RRsetPtr, bool> {
 // introduce separate concrete classes, and move context-independent
 // logic to that class; processing logic dependent on parse context
 // is hardcoded here.
+//
+// If meta_parsed is true, the EDNS OPT and TSIG RRs are skipped as they have
+// already been handled by scanSection().  As counts_ doesn't include them in
+// that case, the RR counts of the header saved in deferred_counts_ are used.
 int
 MessageImpl::parseSection(const Message::Section section,
-                          InputBuffer& buffer, Message::ParseOptions options)
+                          InputBuffer& buffer, Message::ParseOptions options,
+                          bool meta_parsed)
 {
     assert(static_cast<int>(section) < MessageImpl::NUM_SECTIONS);
 
     unsigned int added = 0;
+    const int rr_count =
+        meta_parsed ? deferred_counts_[section] : counts_[section];
 
-    for (unsigned int count = 0; count < counts_[section]; ++count) {
+    for (int count = 0; count < rr_count; ++count) {
         // We need to remember the start position for TSIG processing
         const size_t start_position = buffer.getPosition();
 
@@ -767,6 +832,11 @@ MessageImpl::parseSection(const Message::Section section,
             ++added;
             continue;
         }
+        if (meta_parsed &&
+            (rrtype == RRType::OPT() || rrtype == RRType::TSIG())) {
+            buffer.setPosition(buffer.getPosition() + rdlen);
+            continue;
+        }
         ConstRdataPtr rdata = createRdata(rrtype, rrclass, buffer, rdlen);
 
         if (rrtype == RRType::OPT()) {
@@ -783,6 +853,130 @@ MessageImpl::parseSection(const Message::Section section,
     return (added);
 }
 
+namespace {
+// Skip a wire-format name in the buffer with the same validation as the
+// Name constructor, except that compression pointers are not followed;
+// they are checked when the name is actually built.
+void
+skipName(InputBuffer& buffer) {
+    size_t nused = 0;
+    while (buffer.getPosition() < buffer.getLength()) {
+        const unsigned int c = buffer.readUint8();
+        if (c <= Name::MAX_LABELLEN) {
+            if (nused + c + 1 > Name::MAX_WIRE) {
+                bundy_throw(DNSMessageFORMERR, "wire name is too long: "
+                          << nused + c + 1 << " bytes");
+            }
+            if (c == 0) {
+                return;
+            }
+            if (buffer.getLength() - buffer.getPosition() < c) {
+                break;
+            }
+            nused += c + 1;
+            buffer.setPosition(buffer.getPosition() + c);
+        } else if ((c & Name::COMPRESS_POINTER_MARK8) ==
+                   Name::COMPRESS_POINTER_MARK8) {
+            if (buffer.getPosition() == buffer.getLength()) {
+                break;
+            }
+            buffer.readUint8();
+            return;
+        } else {
+            bundy_throw(DNSMessageFORMERR, "unknown label character: " << c);
+        }
+    }
+    bundy_throw(DNSMessageFORMERR, "incomplete wire-format name");
+}
+}
+
+// Skip the RRs of a section for PARSE_LAZY, except for the EDNS OPT and TSIG
+// RRs, which are parsed in the same way as parseSection().  Like
+// parseSection(), it returns the number of the other RRs.
+int
+MessageImpl::scanSection(const Message::Section section, InputBuffer& buffer)
+{
+    assert(static_cast<int>(section) < MessageImpl::NUM_SECTIONS);
+
+    unsigned int skipped = 0;
+
+    for (int count = 0; count < counts_[section]; ++count) {
+        const size_t start_position = buffer.getPosition();
+
+        skipName(buffer);
+
+        if ((buffer.getLength() - buffer.getPosition()) <
+            3 * sizeof(uint16_t) + sizeof(uint32_t)) {
+            bundy_throw(DNSMessageFORMERR, sectiontext[section] <<
+                      " section too short: " <<
+                      (buffer.getLength() - buffer.getPosition()) << " bytes");
+        }
+
+        const RRType rrtype(buffer.readUint16());
+        const RRClass rrclass(buffer.readUint16());
+        const RRTTL ttl(buffer.readUint32());
+        const size_t rdlen = buffer.readUint16();
+        if ((buffer.getLength() - buffer.getPosition()) < rdlen) {
+            bundy_throw(DNSMessageFORMERR, sectiontext[section] <<
+                      " section too short for RDATA: " <<
+                      (buffer.getLength() - buffer.getPosition()) << " bytes");
+        }
+
+        // See parseSection() about the class check.
+        if ((rrtype != RRType::OPT() && rrtype != RRType::TSIG()) ||
+            ((rrclass == RRClass::ANY() || rrclass == RRClass::NONE()) &&
+             rdlen == 0)) {
+            buffer.setPosition(buffer.getPosition() + rdlen);
+            ++skipped;
+            continue;
+        }
+
+        // Go back to build the owner name, then skip the fields we've
+        // already read.
+        const size_t rdata_position = buffer.getPosition();
+        buffer.setPosition(start_position);
+        const Name name(buffer);
+        buffer.setPosition(rdata_position);
+
+        ConstRdataPtr rdata = createRdata(rrtype, rrclass, buffer, rdlen);
+        if (rrtype == RRType::OPT()) {
+            addEDNS(section, name, rrclass, rrtype, ttl, *rdata);
+        } else {
+            addTSIG(section, count, buffer, start_position, name, rrclass, ttl,
+                    *rdata);
+        }
+    }
+
+    return (skipped);
+}
+
+// Build the RRsets whose parsing was deferred by PARSE_LAZY.  If this fails,
+// the sections are left empty and still deferred, so the subsequent attempts
+// result in the same exception.
+void
+MessageImpl::parseDeferredSections() {
+    if (!deferred_) {
+        return;
+    }
+
+    InputBuffer buffer(&deferred_data_[0], deferred_data_.size());
+    buffer.setPosition(deferred_position_);
+    try {
+        parseSection(Message::SECTION_ANSWER, buffer, deferred_options_,
+                     true);
+        parseSection(Message::SECTION_AUTHORITY, buffer, deferred_options_,
+                     true);
+        parseSection(Message::SECTION_ADDITIONAL, buffer, deferred_options_,
+                     true);
+    } catch (...) {
+        rrsets_[Message::SECTION_ANSWER].clear();
+        rrsets_[Message::SECTION_AUTHORITY].clear();
+        rrsets_[Message::SECTION_ADDITIONAL].clear();
+        throw;
+    }
+    deferred_ = false;
+}
+
 void
 MessageImpl::addRR(Message::Section section, const Name& name,
                    const RRClass& rrclass, const RRType& rrtype,
@@ -799,7 +993,8 @@ MessageImpl::addRR(Message::Section section, const Name& name,
             return;
         }
     }
-    RRsetPtr rrset(new RRset(name, rrclass, rrtype, ttl));
+    RRsetPtr rrset(boost::allocate_shared<RRset>(PoolAllocator<RRset>(),
+                                                 name, rrclass, rrtype, ttl));
     rrset->addRdata(rdata);
     rrsets_[section].push_back(rrset);
 }
@@ -818,7 +1013,8 @@ MessageImpl::addRR(Message::Section section, const Name& name,
             return;
         }
     }
-    RRsetPtr rrset(new RRset(name, rrclass, rrtype, ttl));
+    RRsetPtr rrset(boost::allocate_shared<RRset>(PoolAllocator<RRset>(),
+                                                 name, rrclass, rrtype, ttl));
     rrsets_[section].push_back(rrset);
 }
 
@@ -893,6 +1089,8 @@ Message::toText() const {
                   "Message::toText() attempted without Opcode set");
     }
 
+    impl_->parseDeferredSections();
+
     string s;
 
     s += ";; ->>HEADER<<- opcode: " + impl_->opcode_->toText();
@@ -1017,6 +1215,7 @@ Message::makeResponse() {
 
     impl_->mode_ = Message::RENDER;
 
+    impl_->deferred_ = false;
     impl_->edns_ = EDNSPtr();
     impl_->flags_ &= MESSAGE_REPLYPRESERVE;
     setHeaderFlag(HEADERFLAG_QR, true);
@@ -1143,6 +1342,7 @@ Message::beginSection(const Section section) const {
                   "RRset iterator is requested for question");
     }
 
+    impl_->parseDeferredSections();
     return (RRsetIterator(RRsetIteratorImpl(impl_->rrsets_[section].begin())));
 }
 
@@ -1156,6 +1356,7 @@ Message::endSection(const Section section) const {
                   "RRset iterator is requested for question");
     }
 
+    impl_->parseDeferredSections();
     return (RRsetIterator(RRsetIteratorImpl(impl_->rrsets_[section].end())));
 }
 
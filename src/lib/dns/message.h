@@ -427,6 +427,12 @@ public:
     ///
     /// \c section must be a valid constant of the \c Section type;
     /// otherwise, an exception of class \c OutOfRange will be thrown.
+    ///
+    /// If the message was parsed with the \c PARSE_LAZY option, the
+    /// answer, authority and additional sections are built on the first
+    /// call to this method (or to any other method that refers to the RRsets
+    /// of these sections), which can therefore throw the exceptions that
+    /// \c fromWire() would throw for malformed RRs.
     const RRsetIterator beginSection(const Section section) const;
 
     /// \brief Return an iterator corresponding to the end of the
@@ -594,7 +600,9 @@ public:
     /// performed on these values to express compound options.
     enum ParseOptions {
         PARSE_DEFAULT = 0,       ///< The default options
-        PRESERVE_ORDER = 1       ///< Preserve RR order and don't combine them
+        PRESERVE_ORDER = 1,      ///< Preserve RR order and don't combine them
+        PARSE_LAZY = 2           ///< Build RRsets of the sections other than
+                                 ///< Question on first access
     };
 
     /// \brief Parse the header section of the \c Message.
@@ -630,6 +638,22 @@ public:
     /// ordering conscious.  For example, in AXFR and IXFR, the position of
     /// the SOA RRs are crucial.
     ///
+    /// If the \c PARSE_LAZY option is specified, only the header and
+    /// question sections and the EDNS OPT and TSIG RRs are parsed by this
+    /// method.  The other RRs are only checked to be well formed in terms of
+    /// owner names and RDLENGTH (so their number is known and the OPT and
+    /// TSIG RRs can be located), and the wire-format data is copied to the
+    /// \c Message.  They are converted to RRsets when an RRset of the
+    /// answer, authority or additional section is first referred to, e.g.,
+    /// by \c beginSection() or \c toText().  This mode is useful when the
+    /// application mostly doesn't need these sections, like a server
+    /// answering queries; it avoids creating objects for RRs that are never
+    /// used.  Note that errors in these RRs (other than the ones detected
+    /// by the scan) are reported only on that first access, and that
+    /// the first access modifies the \c Message even though the accessor is
+    /// a const method, so it's not safe to call it from multiple threads at
+    /// the same time.
+    ///
     /// \exception InvalidMessageOperation \c Message is in the RENDER mode
     /// \exception DNSMessageFORMERR The given message data is syntactically
     /// \exception MessageTooShort The given data is shorter than a valid
@@ -22,8 +22,7 @@
 #include <boost/array.hpp>
 #include <boost/static_assert.hpp>
 
-#include <limits>
-#include <cassert>
+#include <algorithm>
 #include <vector>
 
 using namespace std;
@@ -38,114 +37,70 @@ namespace {     // hide internal-only names from the public namespaces
 /// \brief The \c OffsetItem class represents a pointer to a name
 /// rendered in the internal buffer for the \c MessageRendererImpl object.
 ///
-/// A \c MessageRendererImpl object maintains a set of \c OffsetItem
-/// objects in a hash table, and searches the table for the position of the
-/// longest match (ancestor) name against each new name to be rendered into
-/// the buffer.
+/// A name is identified by its first label and the item of its parent
+/// name, i.e., the name with the first label stripped, so the items of
+/// the rendered names form a tree rooted at the root name (which doesn't
+/// have an item).  Since the parent items are unique for each name, two
+/// names are equal if and only if their parent items are the same and
+/// their first labels are equal; there's no need for comparing the rest
+/// of the names, following compression pointers in the buffer.
 struct OffsetItem {
-    OffsetItem(size_t hash, size_t pos, size_t len) :
-        hash_(hash), pos_(pos), len_(len)
+    OffsetItem(uint32_t hash, uint32_t parent, size_t pos) :
+        hash_(hash), parent_(parent), pos_(pos)
     {}
 
-    /// The hash value for the stored name calculated by LabelSequence.getHash.
-    /// This will help make name comparison in \c NameCompare more efficient.
-    size_t hash_;
+    /// The hash value for the name, calculated from that of the parent
+    /// name and the first label.  It's used as the key of the table and as
+    /// a fingerprint to avoid comparing labels of different names.
+    uint32_t hash_;
 
-    /// The position (offset from the beginning) in the buffer where the
-    /// name starts.
-    uint16_t pos_;
+    /// The index of the item for the parent name, or one of the special
+    /// values for the root (or the end of a relative sequence).
+    uint32_t parent_;
 
-    /// The length of the corresponding sequence (which is a domain name).
-    uint16_t len_;
+    /// The position (offset from the beginning) in the buffer where the
+    /// first label of the name starts.  The label is always stored there
+    /// uncompressed.
+    uint32_t pos_;
 };
 
-/// \brief The \c NameCompare class is a functor that checks equality
-/// between the name corresponding to an \c OffsetItem object and the name
-/// consists of labels represented by a \c LabelSequence object.
+/// \brief Return the hash value for a name from that of its parent name
+/// and its first label.
 ///
-/// Template parameter CASE_SENSITIVE determines whether to ignore the case
-/// of the names.  This policy doesn't change throughout the lifetime of
-/// this object, so we separate these using template to avoid unnecessary
-/// condition check.
+/// This is a variant of FNV-1a over the label, including its length.  If
+/// \c CASE_SENSITIVE is false, characters are mapped to lower case first.
 template <bool CASE_SENSITIVE>
-struct NameCompare {
-    /// \brief Constructor
-    ///
-    /// \param buffer The buffer for rendering used in the caller renderer
-    /// \param name_buf An input buffer storing the wire-format data of the
-    /// name to be newly rendered (and only that data).
-    /// \param hash The hash value for the name.
-    NameCompare(const OutputBuffer& buffer, InputBuffer& name_buf,
-                size_t hash) :
-        buffer_(&buffer), name_buf_(&name_buf), hash_(hash)
-    {}
-
-    bool operator()(const OffsetItem& item) const {
-        // Trivial inequality check.  If either the hash or the total length
-        // doesn't match, the names are obviously different.
-        if (item.hash_  != hash_ || item.len_ != name_buf_->getLength()) {
-            return (false);
-        }
-
-        // Compare the name data, character-by-character.
-        // item_pos keeps track of the position in the buffer corresponding to
-        // the character to compare.  item_label_len is the number of
-        // characters in the labels where the character pointed by item_pos
-        // belongs.  When it reaches zero, nextPosition() identifies the
-        // position for the subsequent label, taking into account name
-        // compression, and resets item_label_len to the length of the new
-        // label.
-        name_buf_->setPosition(0); // buffer can be reused, so reset position
-        uint16_t item_pos = item.pos_;
-        uint16_t item_label_len = 0;
-        for (size_t i = 0; i < item.len_; ++i, ++item_pos) {
-            item_pos = nextPosition(*buffer_, item_pos, item_label_len);
-            const uint8_t ch1 = (*buffer_)[item_pos];
-            const uint8_t ch2 = name_buf_->readUint8();
-            if (CASE_SENSITIVE) {
-                if (ch1 != ch2) {
-                    return (false);
-                }
-            } else {
-                if (maptolower[ch1] != maptolower[ch2]) {
-                    return (false);
-                }
-            }
-        }
-
-        return (true);
+inline uint32_t
+hashLabel(uint32_t hash, const uint8_t* label) {
+    const uint8_t* const end = label + label[0] + 1;
+    for (; label != end; ++label) {
+        hash ^= (CASE_SENSITIVE ? *label : maptolower[*label]);
+        hash *= 16777619;
     }
+    return (hash);
+}
 
-private:
-    uint16_t nextPosition(const OutputBuffer& buffer,
-                          uint16_t pos, uint16_t& llen) const
-    {
-        if (llen == 0) {
-            size_t i = 0;
-
-            while ((buffer[pos] & Name::COMPRESS_POINTER_MARK8) ==
-                   Name::COMPRESS_POINTER_MARK8) {
-                pos = (buffer[pos] & ~Name::COMPRESS_POINTER_MARK8) *
-                    256 + buffer[pos + 1];
-
-                // This loop should stop as long as the buffer has been
-                // constructed validly and the search/insert argument is based
-                // on a valid name, which is an assumption for this class.
-                // But we'll abort if a bug could cause an infinite loop.
-                i += 2;
-                assert(i < Name::MAX_WIRE);
+/// \brief Return whether the given two labels are equal.
+template <bool CASE_SENSITIVE>
+inline bool
+labelEqual(const uint8_t* label1, const uint8_t* label2) {
+    const uint8_t len = label1[0];
+    if (len != label2[0]) {
+        return (false);
+    }
+    for (size_t i = 1; i <= len; ++i) {
+        if (CASE_SENSITIVE) {
+            if (label1[i] != label2[i]) {
+                return (false);
             }
-            llen = buffer[pos];
         } else {
-            --llen;
+            if (maptolower[label1[i]] != maptolower[label2[i]]) {
+                return (false);
+            }
         }
-        return (pos);
     }
-
-    const OutputBuffer* buffer_;
-    InputBuffer* name_buf_;
-    const size_t hash_;
-};
+    return (true);
+}
 }
 
 ///
@@ -157,58 +112,108 @@ private:
 ///
 /// It internally holds a hash table for OffsetItem objects corresponding
 /// to portions of names rendered in this renderer.  The offset information
-/// is used to compress subsequent names to be rendered.
+/// is used to compress subsequent names to be rendered.  The table uses
+/// open addressing with linear probing; the slots store the indices (plus
+/// 1, so 0 means an empty slot) of items in a separate vector, so the
+/// slots are small and can be cleared quickly.  As items are never removed
+/// until the renderer is cleared, we don't need tombstones.
 struct MessageRenderer::MessageRendererImpl {
-    // The size of hash buckets and number of hash entries per bucket for
-    // which space is preallocated and kept reserved for subsequent rendering
-    // to provide better performance.  These values are derived from the
-    // BIND 9 implementation that uses a similar hash table.
-    static const size_t BUCKETS = 64;
-    static const size_t RESERVED_ITEMS = 16;
+    // The number of hash slots and hash entries for which space is
+    // preallocated and kept reserved for subsequent rendering to provide
+    // better performance.  The table is kept at most half full, so this
+    // number of slots is enough for a typical response without growing it.
+    static const size_t RESERVED_SLOTS = 256;
+    static const size_t RESERVED_ITEMS = RESERVED_SLOTS / 2;
     static const uint16_t NO_OFFSET = 65535; // used as a marker of 'not found'
 
+    // Special item indices.
+    static const uint32_t NO_ITEM = 0xffffffff; // 'not found'
+    static const uint32_t ROOT_ITEM = 0xfffffffe; // parent of TLDs
+    static const uint32_t RELATIVE_ITEM = 0xfffffffd; // end of relative seq.
+
     /// \brief Constructor
     MessageRendererImpl() :
         msglength_limit_(512), truncated_(false),
-        compress_mode_(MessageRenderer::CASE_INSENSITIVE)
+        compress_mode_(MessageRenderer::CASE_INSENSITIVE),
+        slots_(RESERVED_SLOTS, 0)
     {
-        // Reserve some spaces for hash table items.
-        for (size_t i = 0; i < BUCKETS; ++i) {
-            table_[i].reserve(RESERVED_ITEMS);
+        items_.reserve(RESERVED_ITEMS);
+    }
+
+    static size_t getSlot(uint32_t hash, size_t nslots) {
+        return ((hash ^ (hash >> 16)) & (nslots - 1));
+    }
+
+    // Find the item for the name consisting of the given label and parent
+    // name.  buffer is the beginning of the rendered data.
+    template <bool CASE_SENSITIVE>
+    uint32_t findItem(const uint8_t* buffer, uint32_t hash, uint32_t parent,
+                      const uint8_t* label) const
+    {
+        const size_t nslots = slots_.size();
+        for (size_t slot = getSlot(hash, nslots); ;
+             slot = (slot + 1) & (nslots - 1)) {
+            const uint32_t index = slots_[slot];
+            if (index == 0) {
+                return (NO_ITEM);
+            }
+            const OffsetItem& item = items_[index - 1];
+            if (item.hash_ == hash && item.parent_ == parent &&
+                labelEqual<CASE_SENSITIVE>(buffer + item.pos_, label)) {
+                return (index - 1);
+            }
         }
     }
 
-    uint16_t findOffset(const OutputBuffer& buffer, InputBuffer& name_buf,
-                        size_t hash, bool case_sensitive) const
+    uint32_t findItem(const uint8_t* buffer, uint32_t hash, uint32_t parent,
+                      const uint8_t* label, bool case_sensitive) const
     {
-        // Find a matching entry, if any.  We use some heuristics here: often
-        // the same name appears consecutively (like repeating the same owner
-        // name for a single RRset), so in case there's a collision in the
-        // bucket it will be more likely to find it in the tail side of the
-        // bucket.
-        const size_t bucket_id = hash % BUCKETS;
-        vector<OffsetItem>::const_reverse_iterator found;
         if (case_sensitive) {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<true>(buffer, name_buf, hash));
-        } else {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<false>(buffer, name_buf, hash));
+            return (findItem<true>(buffer, hash, parent, label));
         }
-        if (found != table_[bucket_id].rend()) {
-            return (found->pos_);
+        return (findItem<false>(buffer, hash, parent, label));
+    }
+
+    // Add an item, which must not be in the table, and return its index.
+    uint32_t addItem(uint32_t hash, uint32_t parent, size_t pos) {
+        if ((items_.size() + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
         }
-        return (NO_OFFSET);
+        items_.push_back(OffsetItem(hash, parent, pos));
+        insertSlot(hash, items_.size());
+        return (items_.size() - 1);
     }
 
-    void addOffset(size_t hash, size_t offset, size_t len) {
-        table_[hash % BUCKETS].push_back(OffsetItem(hash, offset, len));
+    void insertSlot(uint32_t hash, uint32_t index) {
+        const size_t nslots = slots_.size();
+        size_t slot = getSlot(hash, nslots);
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & (nslots - 1);
+        }
+        slots_[slot] = index;
+    }
+
+    // Clear the slots used by the items.  Each item is found by probing from
+    // its hash; clearing the slots of other items doesn't matter as we look
+    // for the specific index.
+    void clearSlots() {
+        const size_t nslots = slots_.size();
+        for (size_t i = 0; i < items_.size(); ++i) {
+            size_t slot = getSlot(items_[i].hash_, nslots);
+            while (slots_[slot] != i + 1) {
+                slot = (slot + 1) & (nslots - 1);
+            }
+            slots_[slot] = 0;
+        }
+    }
+
+    void rehash(size_t nslots) {
+        slots_.assign(nslots, 0);
+        for (size_t i = 0; i < items_.size(); ++i) {
+            insertSlot(items_[i].hash_, i + 1);
+        }
     }
 
-    // The hash table for the (offset + position in the buffer) entries
-    vector<OffsetItem> table_[BUCKETS];
     /// The maximum length of rendered data that can fit without
     /// truncation.
     uint16_t msglength_limit_;
@@ -218,10 +223,14 @@ struct MessageRenderer::MessageRendererImpl {
     /// The name compression mode.
     CompressMode compress_mode_;
 
-    // Placeholder for hash values as they are calculated in writeName().
-    // Note: we may want to make it a local variable of writeName() if it
-    // works more efficiently.
-    boost::array<size_t, Name::MAX_LABELS> seq_hashes_;
+    // The hash table: the slots (the number of which is a power of 2) and
+    // the items.
+    vector<uint32_t> slots_;
+    vector<OffsetItem> items_;
+
+    // Placeholder for the offsets of labels in the data of the name being
+    // rendered in writeName().
+    boost::array<uint8_t, Name::MAX_LABELS> label_offsets_;
 };
 
 MessageRenderer::MessageRenderer() :
@@ -241,17 +250,24 @@ MessageRenderer::clear() {
     impl_->compress_mode_ = CASE_INSENSITIVE;
 
     // Clear the hash table.  We reserve the minimum space for possible
-    // subsequent use of the renderer.
-    for (size_t i = 0; i < MessageRendererImpl::BUCKETS; ++i) {
-        if (impl_->table_[i].size() > MessageRendererImpl::RESERVED_ITEMS) {
-            // Trim excessive capacity: swap ensures the new capacity is only
-            // reasonably large for the reserved space.
-            vector<OffsetItem> new_table;
-            new_table.reserve(MessageRendererImpl::RESERVED_ITEMS);
-            new_table.swap(impl_->table_[i]);
-        }
-        impl_->table_[i].clear();
+    // subsequent use of the renderer.  If only a few slots are used (which
+    // should be the common case), only those are cleared.
+    if (impl_->slots_.size() > MessageRendererImpl::RESERVED_SLOTS) {
+        vector<uint32_t>(MessageRendererImpl::RESERVED_SLOTS, 0).swap(
+            impl_->slots_);
+    } else if (impl_->items_.size() * 8 < impl_->slots_.size()) {
+        impl_->clearSlots();
+    } else {
+        std::fill(impl_->slots_.begin(), impl_->slots_.end(), 0);
     }
+    if (impl_->items_.capacity() > MessageRendererImpl::RESERVED_ITEMS) {
+        // Trim excessive capacity: swap ensures the new capacity is only
+        // reasonably large for the reserved space.
+        vector<OffsetItem> new_items;
+        new_items.reserve(MessageRendererImpl::RESERVED_ITEMS);
+        new_items.swap(impl_->items_);
+    }
+    impl_->items_.clear();
 }
 
 size_t
@@ -290,75 +306,77 @@ MessageRenderer::setCompressMode(const CompressMode mode) {
 
 void
 MessageRenderer::writeName(const LabelSequence& ls, const bool compress) {
-    LabelSequence sequence(ls);
-    const size_t nlabels = sequence.getLabelCount();
     size_t data_len;
-    const uint8_t* data;
-
-    // Find the offset in the offset table whose name gives the longest
-    // match against the name to be rendered.
-    size_t nlabels_uncomp;
-    uint16_t ptr_offset = MessageRendererImpl::NO_OFFSET;
+    const uint8_t* const data = ls.getData(&data_len);
     const bool case_sensitive = (impl_->compress_mode_ ==
                                  MessageRenderer::CASE_SENSITIVE);
-    for (nlabels_uncomp = 0; nlabels_uncomp < nlabels; ++nlabels_uncomp) {
-        if (nlabels_uncomp > 0) {
-            sequence.stripLeft(1);
-        }
 
-        data = sequence.getData(&data_len);
-        if (data_len == 1) { // trailing dot.
-            ++nlabels_uncomp;
+    // Identify the labels of the name.  The root label (if any) is neither
+    // compressed nor recorded.
+    const bool absolute = ls.isAbsolute();
+    const size_t nlabels = ls.getLabelCount() - (absolute ? 1 : 0);
+    for (size_t i = 0, pos = 0; i < nlabels; ++i) {
+        impl_->label_offsets_[i] = pos;
+        pos += data[pos] + 1;
+    }
+
+    // Find the longest ancestor (or the name itself) that has been rendered
+    // and can be pointed to, looking up the ancestors from the top.  As the
+    // table contains all ancestors of the rendered names, the search can
+    // stop at the first one not found.  Each lookup only needs to compare
+    // one label, and the hash values are calculated incrementally.
+    const uint8_t* const buffer =
+        static_cast<const uint8_t*>(getBuffer().getData());
+    uint32_t parent = MessageRendererImpl::ROOT_ITEM;
+    if (!absolute) {
+        parent = MessageRendererImpl::RELATIVE_ITEM;
+    }
+    uint32_t hash = 2166136261u ^ parent;
+    size_t nlabels_uncomp = nlabels;
+    uint16_t ptr_offset = MessageRendererImpl::NO_OFFSET;
+    size_t nlabels_unknown = nlabels;
+    for (; nlabels_unknown > 0; --nlabels_unknown) {
+        const uint8_t* const label =
+            data + impl_->label_offsets_[nlabels_unknown - 1];
+        const uint32_t label_hash = case_sensitive ?
+            hashLabel<true>(hash, label) : hashLabel<false>(hash, label);
+        const uint32_t item = impl_->findItem(buffer, label_hash, parent,
+                                              label, case_sensitive);
+        if (item == MessageRendererImpl::NO_ITEM) {
             break;
         }
-        // write with range check for safety
-        impl_->seq_hashes_.at(nlabels_uncomp) =
-            sequence.getHash(impl_->compress_mode_);
-        InputBuffer name_buf(data, data_len);
-        ptr_offset = impl_->findOffset(getBuffer(), name_buf,
-                                       impl_->seq_hashes_[nlabels_uncomp],
-                                       case_sensitive);
-        if (ptr_offset != MessageRendererImpl::NO_OFFSET) {
-            break;
+        hash = label_hash;
+        parent = item;
+        const uint32_t pos = impl_->items_[item].pos_;
+        if (pos <= Name::MAX_COMPRESS_POINTER) {
+            nlabels_uncomp = nlabels_unknown - 1;
+            ptr_offset = pos;
         }
     }
 
     // Record the current offset before updating the offset table
-    size_t offset = getLength();
-    // Write uncompress part:
-    if (nlabels_uncomp > 0 || !compress) {
-        LabelSequence uncomp_sequence(ls);
-        if (compress && nlabels > nlabels_uncomp) {
-            // If there's compressed part, strip off that part.
-            uncomp_sequence.stripRight(nlabels - nlabels_uncomp);
-        }
-        data = uncomp_sequence.getData(&data_len);
+    const size_t offset = getLength();
+    if (!compress || ptr_offset == MessageRendererImpl::NO_OFFSET) {
         writeData(data, data_len);
-    }
-    // And write compression pointer if available:
-    if (compress && ptr_offset != MessageRendererImpl::NO_OFFSET) {
-        ptr_offset |= Name::COMPRESS_POINTER_MARK16;
-        writeUint16(ptr_offset);
+    } else {
+        // Write uncompress part and the compression pointer.
+        if (nlabels_uncomp > 0) {
+            writeData(data, impl_->label_offsets_[nlabels_uncomp]);
+        }
+        writeUint16(ptr_offset | Name::COMPRESS_POINTER_MARK16);
     }
 
-    // Finally, record the offset and length for each uncompressed sequence
-    // in the hash table.  The renderer's buffer has just stored the
-    // corresponding data, so we use the rendered data to get the length
-    // of each label of the names.
-    size_t seqlen = ls.getDataLength();
-    for (size_t i = 0; i < nlabels_uncomp; ++i) {
-        const uint8_t label_len = getBuffer()[offset];
-        if (label_len == 0) { // offset for root doesn't need to be stored.
-            break;
-        }
-        if (offset > Name::MAX_COMPRESS_POINTER) {
-            break;
-        }
-        // Store the tuple of <hash, offset, len> to the table.  Note that we
-        // already know the hash value for each name.
-        impl_->addOffset(impl_->seq_hashes_[i], offset, seqlen);
-        offset += (label_len + 1);
-        seqlen -= (label_len + 1);
+    // Finally, record the names that weren't found in the table.  They are
+    // all in the uncompressed part just rendered.  Note that they are
+    // recorded even if they can't be pointed to, so their descendants
+    // can be found.
+    for (; nlabels_unknown > 0; --nlabels_unknown) {
+        const size_t label_offset =
+            impl_->label_offsets_[nlabels_unknown - 1];
+        hash = case_sensitive ?
+            hashLabel<true>(hash, data + label_offset) :
+            hashLabel<false>(hash, data + label_offset);
+        parent = impl_->addItem(hash, parent, offset + label_offset);
     }
 }
 
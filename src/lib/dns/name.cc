@@ -14,9 +14,7 @@
 
 #include <cctype>
 #include <cassert>
-#include <iterator>
-#include <functional>
-#include <vector>
+#include <cstring>
 #include <iostream>
 #include <algorithm>
 
@@ -127,12 +125,13 @@ typedef enum {
 } ft_state;
 
 // The parser of name from a string. It is a template, because
-// some parameters are used with two different types, while others
-// are private type aliases.
-template<class Iterator, class Offsets, class Data>
+// the input is given by two different types of iterators.  The name data
+// and the label offsets are stored in the given arrays (of MAX_WIRE and
+// MAX_LABELS elements), and their sizes are set in nused and nlabels.
+template<class Iterator>
 void
-stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
-            Data& ndata)
+stringParse(Iterator s, Iterator send, bool downcase, uint8_t* offsets,
+            unsigned int& nlabels, uint8_t* ndata, unsigned int& nused)
 {
     const Iterator orig_s(s);
     //
@@ -151,16 +150,16 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
     ft_state state = ft_init;
 
     // Prepare the output buffers.
-    offsets.reserve(Name::MAX_LABELS);
-    offsets.push_back(0);
-    ndata.reserve(Name::MAX_WIRE);
+    nlabels = 0;
+    offsets[nlabels++] = 0;
+    nused = 0;
 
     // should we refactor this code using, e.g, the state pattern?  Probably
     // not at this point, as this is based on proved code (derived from BIND9)
     // and it's less likely that we'll have more variations in the domain name
     // syntax.  If this ever happens next time, we should consider refactor
     // the code, rather than adding more states and cases below.
-    while (ndata.size() < Name::MAX_WIRE && s != send && !done) {
+    while (nused < Name::MAX_WIRE && s != send && !done) {
         unsigned char c = *s++;
 
         switch (state) {
@@ -181,21 +180,27 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
             }
 
             if (is_root) {
-                ndata.push_back(0);
+                ndata[nused++] = 0;
                 done = true;
                 break;
             }
 
             // FALLTHROUGH
         case ft_start:
-            ndata.push_back(0); // placeholder for the label length field
+            ndata[nused++] = 0; // placeholder for the label length field
             count = 0;
             if (c == '\\') {
                 state = ft_initialescape;
                 break;
             }
             state = ft_ordinary;
-            assert(ndata.size() < Name::MAX_WIRE);
+            // The new label (and the trailing dot) can't fit in the buffer.
+            // Note that we need to check it here, as the following
+            // character would otherwise be stored beyond the buffer.
+            if (nused == Name::MAX_WIRE) {
+                bundy_throw(TooLongName, "name is too long in " <<
+                            string(orig_s, send));
+            }
             // FALLTHROUGH
         case ft_ordinary:
             if (c == '.') {
@@ -203,10 +208,10 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
                     bundy_throw(EmptyLabel,
                               "duplicate period in " << string(orig_s, send));
                 }
-                ndata.at(offsets.back()) = count;
-                offsets.push_back(ndata.size());
+                ndata[offsets[nlabels - 1]] = count;
+                offsets[nlabels++] = nused;
                 if (s == send) {
-                    ndata.push_back(0);
+                    ndata[nused++] = 0;
                     done = true;
                 }
                 state = ft_start;
@@ -217,7 +222,7 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
                     bundy_throw(TooLongLabel,
                               "label is too long in " << string(orig_s, send));
                 }
-                ndata.push_back(downcase ? maptolower[c] : c);
+                ndata[nused++] = downcase ? maptolower[c] : c;
             }
             break;
         case ft_initialescape:
@@ -234,7 +239,7 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
                     bundy_throw(TooLongLabel,
                               "label is too long in " << string(orig_s, send));
                 }
-                ndata.push_back(downcase ? maptolower[c] : c);
+                ndata[nused++] = downcase ? maptolower[c] : c;
                 state = ft_ordinary;
                 break;
             }
@@ -261,7 +266,7 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
                     bundy_throw(TooLongLabel,
                               "label is too long in " << string(orig_s, send));
                 }
-                ndata.push_back(downcase ? maptolower[value] : value);
+                ndata[nused++] = downcase ? maptolower[value] : value;
                 state = ft_ordinary;
             }
             break;
@@ -272,7 +277,7 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
     }
 
     if (!done) {                // no trailing '.' was found.
-        if (ndata.size() == Name::MAX_WIRE) {
+        if (nused == Name::MAX_WIRE) {
             bundy_throw(TooLongName,
                       "name is too long for termination in " <<
                       string(orig_s, send));
@@ -285,11 +290,11 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
         }
         if (state == ft_ordinary) {
             assert(count != 0);
-            ndata.at(offsets.back()) = count;
+            ndata[offsets[nlabels - 1]] = count;
 
-            offsets.push_back(ndata.size());
+            offsets[nlabels++] = nused;
             // add a trailing \0
-            ndata.push_back('\0');
+            ndata[nused++] = '\0';
         }
     }
 }
@@ -301,19 +306,9 @@ Name::Name(const std::string &namestring, bool downcase) {
     const std::string::const_iterator s = namestring.begin();
     const std::string::const_iterator send = namestring.end();
 
-    // Prepare outputs
-    NameOffsets offsets;
-    NameString ndata;
-
     // To the parsing
-    stringParse(s, send, downcase, offsets, ndata);
-
-    // And get the output
-    labelcount_ = offsets.size();
+    stringParse(s, send, downcase, offsets_, labelcount_, ndata_, length_);
     assert(labelcount_ > 0 && labelcount_ <= Name::MAX_LABELS);
-    ndata_.assign(ndata.data(), ndata.size());
-    length_ = ndata_.size();
-    offsets_.assign(offsets.begin(), offsets.end());
 }
 
 Name::Name(const char* namedata, size_t data_len, const Name* origin,
@@ -335,49 +330,34 @@ Name::Name(const char* namedata, size_t data_len, const Name* origin,
     // Prepare inputs for the parser
     const char* end = namedata + data_len;
 
-    // Prepare outputs
-    NameOffsets offsets;
-    NameString ndata;
-
     // Do the actual parsing
-    stringParse(namedata, end, downcase, offsets, ndata);
-
-    // Get the output
-    labelcount_ = offsets.size();
+    stringParse(namedata, end, downcase, offsets_, labelcount_, ndata_,
+                length_);
     assert(labelcount_ > 0 && labelcount_ <= Name::MAX_LABELS);
-    ndata_.assign(ndata.data(), ndata.size());
-    length_ = ndata_.size();
-    offsets_.assign(offsets.begin(), offsets.end());
 
     if (!absolute) {
         // Now, extend the data with the ones from origin. But eat the
-        // last label (the empty one).
+        // last label (the empty one).  First check the sizes are OK.
+        const unsigned int offset = length_ - 1;
+        const unsigned int offset_count = labelcount_ - 1;
+        if (offset_count + origin->labelcount_ > Name::MAX_LABELS ||
+            offset + origin->length_ > Name::MAX_WIRE) {
+            bundy_throw(TooLongName, "Combined name is too long");
+        }
 
-        // Drop the last character of the data (the \0) and append a copy of
+        // Replace the last character of the data (the \0) with a copy of
         // the origin's data
-        ndata_.erase(ndata_.end() - 1);
-        ndata_.append(origin->ndata_);
+        std::memcpy(ndata_ + offset, origin->ndata_, origin->length_);
 
         // Do a similar thing with offsets. However, we need to move them
         // so they point after the prefix we parsed before.
-        size_t offset = offsets_.back();
-        offsets_.pop_back();
-        size_t offset_count = offsets_.size();
-        offsets_.insert(offsets_.end(), origin->offsets_.begin(),
-                        origin->offsets_.end());
-        for (NameOffsets::iterator it(offsets_.begin() + offset_count);
-             it != offsets_.end(); ++it) {
-            *it += offset;
+        for (unsigned int i = 0; i < origin->labelcount_; ++i) {
+            offsets_[offset_count + i] = origin->offsets_[i] + offset;
         }
 
         // Adjust sizes.
-        length_ = ndata_.size();
-        labelcount_ = offsets_.size();
-
-        // And check the sizes are OK.
-        if (labelcount_ > Name::MAX_LABELS || length_ > Name::MAX_WIRE) {
-            bundy_throw(TooLongName, "Combined name is too long");
-        }
+        length_ = offset + origin->length_;
+        labelcount_ = offset_count + origin->labelcount_;
     }
 }
 
@@ -393,8 +373,7 @@ typedef enum {
 }
 
 Name::Name(InputBuffer& buffer, bool downcase) {
-    NameOffsets offsets;
-    offsets.reserve(Name::MAX_LABELS);
+    unsigned int nlabels = 0;
 
     /*
      * Initialize things to make the compiler happy; they're not required.
@@ -433,13 +412,15 @@ Name::Name(InputBuffer& buffer, bool downcase) {
         switch (state) {
         case fw_start:
             if (c <= MAX_LABELLEN) {
-                offsets.push_back(nused);
                 if (nused + c + 1 > Name::MAX_WIRE) {
                     bundy_throw(DNSMessageFORMERR, "wire name is too long: "
                               << nused + c + 1 << " bytes");
                 }
+                // The total length is checked above, so the number of
+                // labels can't exceed MAX_LABELS.
+                offsets_[nlabels++] = nused;
+                ndata_[nused] = c;
                 nused += c + 1;
-                ndata_.push_back(c);
                 if (c == 0) {
                     done = true;
                 }
@@ -462,7 +443,7 @@ Name::Name(InputBuffer& buffer, bool downcase) {
             if (downcase) {
                 c = maptolower[c];
             }
-            ndata_.push_back(c);
+            ndata_[nused - n] = c;
             if (--n == 0) {
                 state = fw_start;
             }
@@ -493,15 +474,14 @@ Name::Name(InputBuffer& buffer, bool downcase) {
         bundy_throw(DNSMessageFORMERR, "incomplete wire-format name");
     }
 
-    labelcount_ = offsets.size();
+    labelcount_ = nlabels;
     length_ = nused;
-    offsets_.assign(offsets.begin(), offsets.end());
     buffer.setPosition(pos_begin + cused);
 }
 
 void
 Name::toWire(OutputBuffer& buffer) const {
-    buffer.writeData(ndata_.data(), ndata_.size());
+    buffer.writeData(ndata_, length_);
 }
 
 void
@@ -528,25 +508,10 @@ Name::equals(const Name& other) const {
         return (false);
     }
 
-    for (unsigned int l = labelcount_, pos = 0; l > 0; --l) {
-        uint8_t count = ndata_[pos];
-        if (count != other.ndata_[pos]) {
-            return (false);
-        }
-        ++pos;
-
-        while (count-- > 0) {
-            uint8_t label1 = ndata_[pos];
-            uint8_t label2 = other.ndata_[pos];
-
-            if (maptolower[label1] != maptolower[label2]) {
-                return (false);
-            }
-            ++pos;
-        }
-    }
-
-    return (true);
+    // Label lengths are never affected by maptolower, so we can compare the
+    // whole data at once: the names are equal if and only if the data are
+    // equal ignoring case.
+    return (mismatchNoCase(ndata_, other.ndata_, length_) == length_);
 }
 
 bool
@@ -585,26 +550,22 @@ Name::concatenate(const Name& suffix) const {
     }
 
     Name retname;
-    retname.ndata_.reserve(length);
-    retname.ndata_.assign(ndata_, 0, length_ - 1);
-    retname.ndata_.insert(retname.ndata_.end(),
-                          suffix.ndata_.begin(), suffix.ndata_.end());
-    assert(retname.ndata_.size() == length);
+    std::memcpy(retname.ndata_, ndata_, length_ - 1);
+    std::memcpy(retname.ndata_ + length_ - 1, suffix.ndata_, suffix.length_);
     retname.length_ = length;
 
     //
-    // Setup the offsets vector.  Copy the offsets of this (prefix) name,
+    // Setup the offsets array.  Copy the offsets of this (prefix) name,
     // excluding that for the trailing dot, and append the offsets of the
     // suffix name with the additional offset of the length of the prefix.
     //
     unsigned int labels = labelcount_ + suffix.labelcount_ - 1;
     assert(labels <= Name::MAX_LABELS);
-    retname.offsets_.reserve(labels);
-    retname.offsets_.assign(&offsets_[0], &offsets_[0] + labelcount_ - 1);
-    transform(suffix.offsets_.begin(), suffix.offsets_.end(),
-              back_inserter(retname.offsets_),
-              bind2nd(plus<char>(), length_ - 1));
-    assert(retname.offsets_.size() == labels);
+    std::memcpy(retname.offsets_, offsets_, labelcount_ - 1);
+    for (unsigned int i = 0; i < suffix.labelcount_; ++i) {
+        retname.offsets_[labelcount_ - 1 + i] =
+            suffix.offsets_[i] + length_ - 1;
+    }
     retname.labelcount_ = labels;
 
     return (retname);
@@ -617,21 +578,17 @@ Name::reverse() const {
     // Set up offsets: The size of the string and number of labels will
     // be the same in as in the original.
     //
-    retname.offsets_.reserve(labelcount_);
-    retname.ndata_.reserve(length_);
-
     // Copy the original name, label by label, from tail to head.
-    NameOffsets::const_reverse_iterator rit0 = offsets_.rbegin();
-    NameOffsets::const_reverse_iterator rit1 = rit0 + 1;
-    NameString::const_iterator n0 = ndata_.begin();
-    retname.offsets_.push_back(0);
-    while (rit1 != offsets_.rend()) {
-        retname.ndata_.append(n0 + *rit1, n0 + *rit0);
-        retname.offsets_.push_back(retname.ndata_.size());
-        ++rit0;
-        ++rit1;
+    unsigned int nused = 0;
+    retname.offsets_[0] = 0;
+    for (unsigned int l = labelcount_ - 1; l > 0; --l) {
+        const unsigned int label_len = offsets_[l] - offsets_[l - 1];
+        std::memcpy(retname.ndata_ + nused, ndata_ + offsets_[l - 1],
+                    label_len);
+        nused += label_len;
+        retname.offsets_[labelcount_ - l] = nused;
     }
-    retname.ndata_.push_back(0);
+    retname.ndata_[nused] = 0;
 
     retname.labelcount_ = labelcount_;
     retname.length_ = length_;
@@ -654,10 +611,9 @@ Name::split(const unsigned int first, const unsigned int n) const {
     // Set up offsets: copy the corresponding range of the original offsets
     // with subtracting an offset of the prefix length.
     //
-    retname.offsets_.reserve(newlabels);
-    transform(offsets_.begin() + first, offsets_.begin() + first + newlabels,
-              back_inserter(retname.offsets_),
-              bind2nd(plus<char>(), -offsets_[first]));
+    for (unsigned int i = 0; i < newlabels; ++i) {
+        retname.offsets_[i] = offsets_[first + i] - offsets_[first];
+    }
 
     //
     // Set up the new name.  At this point the tail of the new offsets specifies
@@ -665,13 +621,12 @@ Name::split(const unsigned int first, const unsigned int n) const {
     // the extracted portion excluding the dot.  First copy that part from the
     // original name, and append the trailing dot explicitly.
     //
-    retname.ndata_.reserve(retname.offsets_.back() + 1);
-    retname.ndata_.assign(ndata_, offsets_[first], retname.offsets_.back());
-    retname.ndata_.push_back(0);
+    const unsigned int last = retname.offsets_[newlabels - 1];
+    std::memcpy(retname.ndata_, ndata_ + offsets_[first], last);
+    retname.ndata_[last] = 0;
 
-    retname.length_ = retname.ndata_.size();
-    retname.labelcount_ = retname.offsets_.size();
-    assert(retname.labelcount_ == newlabels);
+    retname.length_ = last + 1;
+    retname.labelcount_ = newlabels;
 
     return (retname);
 }
@@ -698,13 +653,12 @@ Name::downcase() {
 
         // we assume a valid name, and do abort() if the assumption fails
         // rather than throwing an exception.
-        unsigned int count = ndata_.at(pos++);
+        unsigned int count = ndata_[pos++];
         assert(count <= MAX_LABELLEN);
         assert(nlen >= count);
 
         while (count > 0) {
-            ndata_.at(pos) =
-                maptolower[ndata_.at(pos)];
+            ndata_[pos] = maptolower[ndata_[pos]];
             ++pos;
             --nlen;
             --count;
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -193,16 +194,17 @@ private:
 /// access to various properties of a name, etc.
 ///
 /// Notes to developers: Internally, a name object maintains the name %data
-/// in wire format as an instance of \c std::string.  Since many string
-/// implementations adopt copy-on-write %data sharing, we expect this approach
-/// will make copying a name less expensive in typical cases.  If this is
-/// found to be a significant performance bottleneck later, we may reconsider
-/// the internal representation or perhaps the API.
+/// in wire format in an array of \c MAX_WIRE bytes embedded in the object
+/// (\c ndata_ member).  Names are constructed very frequently, e.g., for
+/// every question and RR of incoming messages, and this way constructing or
+/// copying a name never involves memory allocation (copying a name only
+/// copies the part of the arrays actually used).  The cost is a larger
+/// object, which is still small enough to be placed on the stack.
 ///
-/// A name object also maintains a vector of offsets (\c offsets_ member),
+/// A name object also maintains an array of offsets (\c offsets_ member),
 /// each of which is the offset to a label of the name: The n-th element of
-/// the vector specifies the offset to the n-th label.  For example, if the
-/// object represents "www.example.com", the elements of the offsets vector
+/// the array specifies the offset to the n-th label.  For example, if the
+/// object represents "www.example.com", the elements of the offsets array
 /// are 0, 4, 12, and 16.  Note that the offset to the trailing dot (16) is
 /// included.  In the BIND9 DNS library from which this implementation is
 /// derived, the offsets are optional, probably due to performance
@@ -230,8 +232,8 @@ private:
 ///
 class Name {
     // LabelSequences use knowledge about the internal data structure
-    // of this class for efficiency (they use the offsets_ vector and
-    // the ndata_ string)
+    // of this class for efficiency (they use the offsets_ and ndata_
+    // arrays)
     friend class LabelSequence;
 
     ///
@@ -239,11 +241,6 @@ class Name {
     ///
     //@{
 private:
-    /// \brief Name data string
-    typedef std::basic_string<uint8_t> NameString;
-    /// \brief Name offsets type
-    typedef std::vector<uint8_t> NameOffsets;
-
     /// The default constructor
     ///
     /// This is used internally in the class implementation, but at least at
@@ -311,11 +308,31 @@ public:
     /// \param buffer A buffer storing the wire format %data.
     /// \param downcase Whether to convert upper case alphabets to lower case.
     explicit Name(bundy::util::InputBuffer& buffer, bool downcase = false);
+
+    /// \brief Copy constructor.
     ///
-    /// We use the default copy constructor intentionally.
+    /// Only the used part of the name %data is copied.  This method never
+    /// throws an exception.
+    Name(const Name& other) :
+        length_(other.length_), labelcount_(other.labelcount_)
+    {
+        std::memcpy(ndata_, other.ndata_, length_);
+        std::memcpy(offsets_, other.offsets_, labelcount_);
+    }
     //@}
-    /// We use the default copy assignment operator intentionally.
+
+    /// \brief Assignment operator.
     ///
+    /// Like the copy constructor, this method never throws an exception.
+    Name& operator=(const Name& other) {
+        if (this != &other) {
+            length_ = other.length_;
+            labelcount_ = other.labelcount_;
+            std::memcpy(ndata_, other.ndata_, length_);
+            std::memcpy(offsets_, other.offsets_, labelcount_);
+        }
+        return (*this);
+    }
 
     ///
     /// \name Getter Methods
@@ -726,10 +743,10 @@ public:
     //@}
 
 private:
-    NameString ndata_;
-    NameOffsets offsets_;
-    unsigned int length_;
-    unsigned int labelcount_;
+    unsigned int length_;       // the number of used bytes of ndata_
+    unsigned int labelcount_;   // the number of used elements of offsets_
+    uint8_t ndata_[MAX_WIRE];
+    uint8_t offsets_[MAX_LABELS];
 };
 
 inline const Name&
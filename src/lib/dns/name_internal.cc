@@ -0,0 +1,226 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/name_internal.h>
+
+#include <util/cpu_features.h>
+
+#ifdef BUNDY_CPU_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef BUNDY_CPU_AVX2
+#include <immintrin.h>
+#endif
+
+namespace bundy {
+namespace dns {
+namespace name {
+namespace internal {
+
+namespace {
+typedef size_t (*MismatchFunc)(const uint8_t*, const uint8_t*, size_t);
+
+size_t
+mismatchScalar(const uint8_t* data1, const uint8_t* data2, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (maptolower[data1[i]] != maptolower[data2[i]]) {
+            return (i);
+        }
+    }
+    return (len);
+}
+
+#ifdef BUNDY_CPU_SSE2
+// The vectorized versions of maptolower: add 0x20 to the bytes between 'A'
+// and 'Z'.  Shifting the bytes by 0x80 - 'A' maps this range to the lowest
+// 26 values of signed bytes, so a single signed comparison can detect it.
+inline __m128i
+toLower16(__m128i v) {
+    const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x80 - 'A'));
+    const __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-0x80 + 26));
+    return (_mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+}
+
+// Compare 16 bytes at the given positions; return the offset of the first
+// different byte, or 16 if they're all equal.
+inline unsigned int
+mismatch16(const uint8_t* data1, const uint8_t* data2) {
+    const __m128i v1 =
+        toLower16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data1)));
+    const __m128i v2 =
+        toLower16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data2)));
+    const unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2));
+    if (mask == 0xffff) {
+        return (16);
+    }
+    return (__builtin_ctz(~mask));
+}
+
+// Compare the rest of the regions from offset i, where i + 16 > len and
+// len >= 16.  Instead of falling back to the scalar code for the last bytes
+// we compare the last 16 bytes of the regions, some of which have already
+// been compared.
+inline size_t
+mismatchTail16(const uint8_t* data1, const uint8_t* data2, size_t i,
+               size_t len)
+{
+    if (i == len) {
+        return (len);
+    }
+    const size_t pos = len - 16;
+    const unsigned int diff = mismatch16(data1 + pos, data2 + pos);
+    return (diff == 16 ? len : pos + diff);
+}
+
+size_t
+mismatchSSE2(const uint8_t* data1, const uint8_t* data2, size_t len) {
+    if (len < 16) {
+        return (mismatchScalar(data1, data2, len));
+    }
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const unsigned int diff = mismatch16(data1 + i, data2 + i);
+        if (diff != 16) {
+            return (i + diff);
+        }
+    }
+    return (mismatchTail16(data1, data2, i, len));
+}
+#endif
+
+#ifdef BUNDY_CPU_AVX2
+__attribute__((target("avx2"))) inline __m256i
+toLower32(__m256i v) {
+    const __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(0x80 - 'A'));
+    const __m256i upper =
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x80 + 26), shifted);
+    return (_mm256_add_epi8(v, _mm256_and_si256(upper,
+                                                _mm256_set1_epi8(0x20))));
+}
+
+__attribute__((target("avx2"))) size_t
+mismatchAVX2(const uint8_t* data1, const uint8_t* data2, size_t len) {
+    if (len < 16) {
+        return (mismatchScalar(data1, data2, len));
+    }
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v1 = toLower32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data1 + i)));
+        const __m256i v2 = toLower32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data2 + i)));
+        const unsigned int mask =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2));
+        if (mask != 0xffffffff) {
+            _mm256_zeroupper();
+            return (i + __builtin_ctz(~mask));
+        }
+    }
+    // Avoid the penalty of transitions to the legacy SSE code of the caller
+    // (compilers don't always do this for functions with the target
+    // attribute).
+    _mm256_zeroupper();
+    // At most 31 bytes are left; use the 16-byte version for them.
+    if (i + 16 <= len) {
+        const unsigned int diff = mismatch16(data1 + i, data2 + i);
+        if (diff != 16) {
+            return (i + diff);
+        }
+        i += 16;
+    }
+    return (mismatchTail16(data1, data2, i, len));
+}
+#endif
+
+bool
+isAvailable(CompareImpl impl) {
+    switch (impl) {
+    case COMPARE_SCALAR:
+        return (true);
+    case COMPARE_SSE2:
+        return (util::hasCPUFeature(util::CPU_SSE2));
+    case COMPARE_AVX2:
+        return (util::hasCPUFeature(util::CPU_AVX2));
+    default:
+        return (false);
+    }
+}
+
+// An implementation and its function, selected together.
+struct Implementation {
+    CompareImpl impl;
+    MismatchFunc func;
+};
+
+const Implementation IMPLEMENTATIONS[] = {
+    { COMPARE_SCALAR, mismatchScalar },
+#ifdef BUNDY_CPU_SSE2
+    { COMPARE_SSE2, mismatchSSE2 },
+#endif
+#ifdef BUNDY_CPU_AVX2
+    { COMPARE_AVX2, mismatchAVX2 },
+#endif
+};
+const size_t IMPLEMENTATION_COUNT =
+    sizeof(IMPLEMENTATIONS) / sizeof(IMPLEMENTATIONS[0]);
+
+const Implementation*
+findImplementation(CompareImpl impl) {
+    for (size_t i = 0; i < IMPLEMENTATION_COUNT; ++i) {
+        if (IMPLEMENTATIONS[i].impl == impl) {
+            return (&IMPLEMENTATIONS[i]);
+        }
+    }
+    return (NULL);
+}
+
+// The selected implementation.  It's usable even if a name is compared in
+// the initialization of another translation unit (see the note on
+// maptolower in name.cc).
+util::ImplSelector<const Implementation*> selected_impl;
+
+const Implementation*
+selectBestImpl() {
+    if (isAvailable(COMPARE_AVX2)) {
+        return (findImplementation(COMPARE_AVX2));
+    } else if (isAvailable(COMPARE_SSE2)) {
+        return (findImplementation(COMPARE_SSE2));
+    }
+    return (findImplementation(COMPARE_SCALAR));
+}
+}
+
+size_t
+mismatchNoCaseLong(const uint8_t* data1, const uint8_t* data2, size_t len) {
+    return (selected_impl.get(selectBestImpl)->func(data1, data2, len));
+}
+
+CompareImpl
+getCompareImpl() {
+    return (selected_impl.get(selectBestImpl)->impl);
+}
+
+bool
+selectCompareImpl(CompareImpl impl) {
+    if (!isAvailable(impl)) {
+        return (false);
+    }
+    selected_impl.set(findImplementation(impl));
+    return (true);
+}
+
+} // end of internal
+} // end of name
+} // end of dns
+} // end of bundy
@@ -15,6 +15,10 @@
 #ifndef NAME_INTERNAL_H
 #define NAME_INTERNAL_H 1
 
+#include <stdint.h>
+
+#include <cstddef>
+
 // This is effectively a "private" namespace for the Name class implementation,
 // but exposed publicly so the definitions in it can be shared with other
 // modules of the library (as of its introduction, used by LabelSequence and
@@ -32,6 +36,68 @@ namespace dns {
 namespace name {
 namespace internal {
 extern const uint8_t maptolower[];
+
+/// \brief Implementations of the case-insensitive comparison of name data.
+///
+/// \c COMPARE_SSE2 and \c COMPARE_AVX2 compare 16 and 32 bytes at a time,
+/// respectively, and are only available on x86 processors supporting these
+/// instruction sets (and with compilers supporting them).
+/// \c COMPARE_SCALAR is always available.  All of them give the same
+/// result.
+enum CompareImpl {
+    COMPARE_SCALAR,
+    COMPARE_SSE2,
+    COMPARE_AVX2
+};
+
+/// \brief Regions shorter than this are always compared by the scalar code.
+///
+/// This is also the minimum size of the regions passed to
+/// \c mismatchNoCaseLong().  Most labels are shorter than this, and for them
+/// the overhead of calling a vectorized implementation is not worth it.
+const size_t COMPARE_VECTOR_MIN = 16;
+
+/// \brief Case-insensitive comparison of regions of at least
+/// \c COMPARE_VECTOR_MIN bytes, using the selected implementation.
+///
+/// See \c mismatchNoCase().
+size_t mismatchNoCaseLong(const uint8_t* data1, const uint8_t* data2,
+                          size_t len);
+
+/// \brief Compare two regions of name data ignoring the case of ASCII
+/// letters.
+///
+/// Return the offset of the first byte of the regions that differs after
+/// converting them with \c maptolower, or \c len if they are equal.
+/// The regions must be valid for \c len bytes.
+///
+/// On its first call the fastest implementation available on the running
+/// processor is selected (unless \c selectCompareImpl() has been called).
+inline size_t
+mismatchNoCase(const uint8_t* data1, const uint8_t* data2, size_t len) {
+    if (len >= COMPARE_VECTOR_MIN) {
+        return (mismatchNoCaseLong(data1, data2, len));
+    }
+    for (size_t i = 0; i < len; ++i) {
+        if (maptolower[data1[i]] != maptolower[data2[i]]) {
+            return (i);
+        }
+    }
+    return (len);
+}
+
+/// \brief Return the implementation used by \c mismatchNoCase().
+CompareImpl getCompareImpl();
+
+/// \brief Force \c mismatchNoCase() to use the given implementation.
+///
+/// This is intended for tests and benchmarks.  It can be called while
+/// other threads compare names, which may use either implementation for
+/// a while.
+///
+/// \return true if the implementation is available and selected, false
+/// otherwise (in which case the selection isn't changed).
+bool selectCompareImpl(CompareImpl impl);
 } // end of internal
 } // end of name
 } // end of dns
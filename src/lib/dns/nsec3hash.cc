@@ -27,6 +27,7 @@
 #include <util/buffer.h>
 #include <util/encode/base32hex.h>
 #include <util/hash/sha1.h>
+#include <util/hash/sha1_multi.h>
 
 #include <dns/name.h>
 #include <dns/labelsequence.h>
@@ -63,7 +64,8 @@ public:
                      const uint8_t* salt_data, size_t salt_length) :
         algorithm_(algorithm), iterations_(iterations),
         salt_data_(NULL), salt_length_(salt_length),
-        digest_(SHA1_HASHSIZE), obuf_(Name::MAX_WIRE)
+        digest_(SHA1_HASHSIZE), obuf_(Name::MAX_WIRE),
+        buffer_(Name::MAX_WIRE + salt_length)
     {
         if (algorithm_ != NSEC3_HASH_SHA1) {
             bundy_throw(UnknownNSEC3HashAlgorithm, "Unknown NSEC3 algorithm: " <<
@@ -77,8 +79,6 @@ public:
             }
             std::memcpy(salt_data_, salt_data, salt_length);
         }
-
-        SHA1Reset(&sha1_ctx_);
     }
 
     virtual ~NSEC3HashRFC5155() {
@@ -87,6 +87,8 @@ public:
 
     virtual std::string calculate(const Name& name) const;
     virtual std::string calculate(const LabelSequence& ls) const;
+    virtual void calculateBatch(const vector<LabelSequence>& names,
+                                vector<string>& hashes) const;
 
     virtual bool match(const generic::NSEC3& nsec3) const;
     virtual bool match(const generic::NSEC3PARAM& nsec3param) const;
@@ -95,6 +97,9 @@ public:
 
 private:
     std::string calculateForWiredata(const uint8_t* data, size_t length) const;
+    void calculateDigests(size_t count, const size_t lengths[],
+                          uint8_t* buffer,
+                          uint8_t digests[][SHA1_HASHSIZE]) const;
 
     const uint8_t algorithm_;
     const uint16_t iterations_;
@@ -104,34 +109,17 @@ private:
     // The following members are placeholder of work place and don't hold
     // any state over multiple calls so can be mutable without breaking
     // constness.
-    mutable SHA1Context sha1_ctx_;
     mutable vector<uint8_t> digest_;
     mutable OutputBuffer obuf_;
+    mutable vector<uint8_t> buffer_;
 };
 
+// Copy the name data to buf, converting all upper case characters in the
+// labels to lower ones.
 inline void
-iterateSHA1(SHA1Context* ctx, const uint8_t* input, size_t inlength,
-            const uint8_t* salt, size_t saltlen,
-            uint8_t output[SHA1_HASHSIZE])
-{
-    SHA1Reset(ctx);
-    SHA1Input(ctx, input, inlength);
-    SHA1Input(ctx, salt, saltlen); // this works whether saltlen == or > 0
-    SHA1Result(ctx, output);
-}
-
-string
-NSEC3HashRFC5155::calculateForWiredata(const uint8_t* data,
-                                       size_t length) const
-{
-    // We first need to normalize the name by converting all upper case
-    // characters in the labels to lower ones.
-
-    uint8_t name_buf[256];
-    assert(length < sizeof (name_buf));
-
-    const uint8_t *p1 = data;
-    uint8_t *p2 = name_buf;
+normalizeName(const uint8_t* data, uint8_t* buf) {
+    const uint8_t* p1 = data;
+    uint8_t* p2 = buf;
     while (*p1 != 0) {
         char len = *p1;
 
@@ -142,16 +130,60 @@ NSEC3HashRFC5155::calculateForWiredata(const uint8_t* data,
     }
 
     *p2 = *p1;
+}
 
-    uint8_t* const digest = &digest_[0];
-    assert(digest_.size() == SHA1_HASHSIZE);
+// Calculate the hashes of normalized names.  The buffer has the space of
+// (Name::MAX_WIRE + salt_length_) bytes for each name, which begins with
+// the name of the given length.
+void
+NSEC3HashRFC5155::calculateDigests(size_t count, const size_t lengths[],
+                                   uint8_t* buffer,
+                                   uint8_t digests[][SHA1_HASHSIZE]) const
+{
+    // Each name is followed by the salt in its own part of the buffer, so
+    // they can be hashed together.  In the following iterations the part
+    // holds the digest of the previous iteration followed by the salt.
+    const size_t buffer_len = Name::MAX_WIRE + salt_length_;
+    vector<const uint8_t*> inputs(count);
+    vector<size_t> input_lengths(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* const input = buffer + i * buffer_len;
+        if (salt_length_ > 0) {
+            std::memcpy(input + lengths[i], salt_data_, salt_length_);
+        }
+        inputs[i] = input;
+        input_lengths[i] = lengths[i] + salt_length_;
+    }
+    SHA1MultiDigest(count, &inputs[0], &input_lengths[0], digests);
 
-    iterateSHA1(&sha1_ctx_, name_buf, length,
-                salt_data_, salt_length_, digest);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* const input = buffer + i * buffer_len;
+        if (salt_length_ > 0) {
+            std::memcpy(input + SHA1_HASHSIZE, salt_data_, salt_length_);
+        }
+        input_lengths[i] = SHA1_HASHSIZE + salt_length_;
+    }
     for (unsigned int n = 0; n < iterations_; ++n) {
-        iterateSHA1(&sha1_ctx_, digest, SHA1_HASHSIZE,
-                    salt_data_, salt_length_, digest);
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(buffer + i * buffer_len, digests[i], SHA1_HASHSIZE);
+        }
+        SHA1MultiDigest(count, &inputs[0], &input_lengths[0], digests);
     }
+}
+
+string
+NSEC3HashRFC5155::calculateForWiredata(const uint8_t* data,
+                                       size_t length) const
+{
+    // We first need to normalize the name by converting all upper case
+    // characters in the labels to lower ones.
+    assert(length <= Name::MAX_WIRE);
+    normalizeName(data, &buffer_[0]);
+
+    assert(digest_.size() == SHA1_HASHSIZE);
+    calculateDigests(1, &length, &buffer_[0],
+                     reinterpret_cast<uint8_t(*)[SHA1_HASHSIZE]>(
+                         &digest_[0]));
 
     return (encodeBase32Hex(digest_));
 }
@@ -175,6 +207,38 @@ NSEC3HashRFC5155::calculate(const LabelSequence& ls) const {
     return (calculateForWiredata(data, length));
 }
 
+void
+NSEC3HashRFC5155::calculateBatch(const vector<LabelSequence>& names,
+                                 vector<string>& hashes) const
+{
+    hashes.clear();
+    const size_t count = names.size();
+    if (count == 0) {
+        return;
+    }
+
+    const size_t buffer_len = Name::MAX_WIRE + salt_length_;
+    vector<uint8_t> buffer(count * buffer_len);
+    vector<size_t> lengths(count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(names[i].isAbsolute());
+        normalizeName(names[i].getData(&lengths[i]), &buffer[i * buffer_len]);
+    }
+
+    vector<uint8_t> digests(count * SHA1_HASHSIZE);
+    calculateDigests(count, &lengths[0], &buffer[0],
+                     reinterpret_cast<uint8_t(*)[SHA1_HASHSIZE]>(
+                         &digests[0]));
+
+    hashes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::copy(digests.begin() + i * SHA1_HASHSIZE,
+                  digests.begin() + (i + 1) * SHA1_HASHSIZE,
+                  digest_.begin());
+        hashes.push_back(encodeBase32Hex(digest_));
+    }
+}
+
 bool
 NSEC3HashRFC5155::match(uint8_t algorithm, uint16_t iterations,
                         const vector<uint8_t>& salt) const
@@ -218,6 +282,17 @@ getNSEC3HashCreator() {
 namespace bundy {
 namespace dns {
 
+void
+NSEC3Hash::calculateBatch(const vector<LabelSequence>& names,
+                          vector<string>& hashes) const
+{
+    hashes.clear();
+    hashes.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        hashes.push_back(calculate(names[i]));
+    }
+}
+
 NSEC3Hash*
 NSEC3Hash::create(const generic::NSEC3PARAM& param) {
     return (getNSEC3HashCreator()->create(param));
@@ -40,6 +40,12 @@ RRset (so this RRset should contain exactly one Rdata). This mode will\n\
 be necessary when the higher level protocol is ordering conscious. For\n\
 example, in AXFR and IXFR, the position of the SOA RRs are crucial.\n\
 \n\
+If the PARSE_LAZY option is specified, only the header and question\n\
+sections and the EDNS OPT and TSIG RRs are parsed, and the other RRs\n\
+are converted to RRsets when the sections are first referred to, e.g.,\n\
+by get_section() or to_text(). Errors in these RRs other than broken\n\
+owner names or RDLENGTH are reported at that time.\n\
+\n\
 Exceptions:\n\
   InvalidMessageOperation Message is in the RENDER mode\n\
   DNSMessageFORMERR The given message data is syntactically\n\
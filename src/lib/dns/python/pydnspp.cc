@@ -105,6 +105,8 @@ initModulePart_Message(PyObject* mod) {
                              Py_BuildValue("I", Message::PARSE_DEFAULT));
         installClassVariable(message_type, "PRESERVE_ORDER",
                              Py_BuildValue("I", Message::PRESERVE_ORDER));
+        installClassVariable(message_type, "PARSE_LAZY",
+                             Py_BuildValue("I", Message::PARSE_LAZY));
 
         // Header flags
         installClassVariable(message_type, "HEADERFLAG_QR",
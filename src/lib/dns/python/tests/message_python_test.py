@@ -571,6 +571,20 @@ test.example.com. 3600 IN A 192.0.2.2
                         Message.PRESERVE_ORDER)
         self.check_preserve_rrs(self.p, Message.SECTION_ADDITIONAL)
 
+    def test_from_wire_lazy(self):
+        factoryFromFile(self.p, "message_fromWire19.wire",
+                        Message.PARSE_LAZY | Message.PRESERVE_ORDER)
+        self.assertEqual(3, self.p.get_rr_count(Message.SECTION_ANSWER))
+        self.check_preserve_rrs(self.p, Message.SECTION_ANSWER)
+
+        # Broken RDATA is detected when the section is referred to.
+        data = bytearray(read_wire_data("message_fromWire1"))
+        data[53] = RRType.AAAA.get_code()
+        self.p.from_wire(bytes(data), Message.PARSE_LAZY)
+        self.assertEqual(2, self.p.get_rr_count(Message.SECTION_ANSWER))
+        self.assertRaises(IscException, self.p.get_section,
+                          Message.SECTION_ANSWER)
+
     def test_EDNS0ExtCode(self):
         # Extended Rcode = BADVERS
         message_parse = Message(Message.PARSE)
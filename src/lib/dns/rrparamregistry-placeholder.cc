@@ -23,10 +23,14 @@
 
 #include <stdint.h>
 
+#include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <exceptions/exceptions.h>
 
+#include <util/object_pool.h>
+
 #include <dns/rrparamregistry.h>
 #include <dns/rrclass.h>
 #include <dns/rrtype.h>
@@ -168,14 +172,21 @@ public:
         return (RdataPtr(new T(rdata_str)));
     }
 
+    // RDATA created from wire data or copied are mostly used in DNS
+    // messages, which are created and destroyed in large quantities, so
+    // they are allocated from the object pool.  The buffer is passed as
+    // a reference wrapper, as allocate_shared() could otherwise take it
+    // as a const reference.
     virtual RdataPtr create(InputBuffer& buffer, size_t rdata_len) const
     {
-        return (RdataPtr(new T(buffer, rdata_len)));
+        return (boost::allocate_shared<T>(PoolAllocator<T>(),
+                                          boost::ref(buffer), rdata_len));
     }
 
     virtual RdataPtr create(const Rdata& source) const
     {
-        return (RdataPtr(new T(dynamic_cast<const T&>(source))));
+        return (boost::allocate_shared<T>(PoolAllocator<T>(),
+                                          dynamic_cast<const T&>(source)));
     }
 
     virtual RdataPtr create(MasterLexer& lexer, const Name* origin,
@@ -16,10 +16,12 @@
 #include <string>
 #include <vector>
 
+#include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/foreach.hpp>
 
 #include <util/buffer.h>
+#include <util/object_pool.h>
 #include <dns/messagerenderer.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
@@ -34,6 +36,13 @@ using namespace bundy::dns::rdata;
 
 namespace bundy {
 namespace dns {
+namespace {
+// The container of RDATA in BasicRRset.  RRsets are often created and
+// destroyed in large quantities (e.g. in DNS messages), so the memory
+// for them is taken from the object pool.
+typedef vector<ConstRdataPtr, PoolAllocator<ConstRdataPtr> > RdataVector;
+}
+
 void
 AbstractRRset::addRdata(const Rdata& rdata) {
     addRdata(createRdata(getType(), getClass(), rdata));
@@ -172,6 +181,13 @@ public:
 
     unsigned int toWire(AbstractMessageRenderer& renderer, size_t limit) const;
 
+    static void* operator new(size_t size) {
+        return (ObjectPool::allocate(size));
+    }
+    static void operator delete(void* ptr, size_t size) {
+        ObjectPool::deallocate(ptr, size);
+    }
+
     Name name_;
     RRClass rrclass_;
     RRType rrtype_;
@@ -179,7 +195,7 @@ public:
     // XXX: "list" is not a good name: It in fact isn't a list; more conceptual
     // name than a data structure name is generally better.  But since this
     // is only used in the internal implementation we'll live with it.
-    vector<ConstRdataPtr> rdatalist_;
+    RdataVector rdatalist_;
 };
 
 // FIXME: This method's code should somehow be unified with
@@ -423,7 +439,7 @@ class BasicRdataIterator : public RdataIterator {
 private:
     BasicRdataIterator() {}
 public:
-    BasicRdataIterator(const std::vector<rdata::ConstRdataPtr>& datavector) :
+    explicit BasicRdataIterator(const RdataVector& datavector) :
         datavector_(&datavector), it_(datavector_->begin())
     {}
     ~BasicRdataIterator() {}
@@ -432,14 +448,15 @@ public:
     virtual const rdata::Rdata& getCurrent() const { return (**it_); }
     virtual bool isLast() const { return (it_ == datavector_->end()); }
 private:
-    const std::vector<rdata::ConstRdataPtr>* datavector_;
-    std::vector<rdata::ConstRdataPtr>::const_iterator it_;
+    const RdataVector* datavector_;
+    RdataVector::const_iterator it_;
 };
 }
 
 RdataIteratorPtr
 BasicRRset::getRdataIterator() const {
-    return (RdataIteratorPtr(new BasicRdataIterator(impl_->rdatalist_)));
+    return (boost::allocate_shared<BasicRdataIterator>(
+                PoolAllocator<BasicRdataIterator>(), impl_->rdatalist_));
 }
 }
 }
@@ -32,18 +32,39 @@ RRsetCollection::loaderCallback(const std::string&, size_t, const std::string&)
      // We just ignore callbacks for errors and warnings.
 }
 
+namespace {
+// Return the position of the RRset of the given class and type in the
+// group, or the size of the group if there's no such RRset.
+template <typename Group>
+size_t
+findInGroup(const Group& group, const RRClass& rrclass, const RRType& rrtype) {
+    size_t i = 0;
+    for (; i < group.size(); ++i) {
+        if (group[i]->getType() == rrtype && group[i]->getClass() == rrclass) {
+            break;
+        }
+    }
+    return (i);
+}
+}
+
 void
 RRsetCollection::addRRset(RRsetPtr rrset) {
-    const CollectionKey key(rrset->getClass(), rrset->getType(),
-                            rrset->getName());
-    CollectionMap::const_iterator it = rrsets_.find(key);
-    if (it != rrsets_.end()) {
+    const LabelSequence key(rrset->getName());
+    CollectionMap::iterator it = rrsets_.find(key);
+    if (it == rrsets_.end()) {
+        rrsets_.insert(CollectionMap::value_type(key, RRsetGroup(1, rrset)));
+        return;
+    }
+
+    RRsetGroup& group = it->second;
+    if (findInGroup(group, rrset->getClass(), rrset->getType()) !=
+        group.size()) {
         bundy_throw(InvalidParameter,
                   "RRset for " << rrset->getName() << "/" << rrset->getClass()
                   << " with type " << rrset->getType() << " already exists");
     }
-
-    rrsets_.insert(std::pair<CollectionKey, RRsetPtr>(key, rrset));
+    group.push_back(rrset);
 }
 
 template<typename T>
@@ -77,10 +98,12 @@ RRsetCollection::RRsetCollection(std::istream& input_stream, const Name& origin,
 RRsetPtr
 RRsetCollection::find(const Name& name, const RRClass& rrclass,
                       const RRType& rrtype) {
-    const CollectionKey key(rrclass, rrtype, name);
-    CollectionMap::iterator it = rrsets_.find(key);
+    CollectionMap::iterator it = rrsets_.find(LabelSequence(name));
     if (it != rrsets_.end()) {
-        return (it->second);
+        const size_t i = findInGroup(it->second, rrclass, rrtype);
+        if (i != it->second.size()) {
+            return (it->second[i]);
+        }
     }
     return (RRsetPtr());
 }
@@ -89,10 +112,12 @@ ConstRRsetPtr
 RRsetCollection::find(const Name& name, const RRClass& rrclass,
                       const RRType& rrtype) const
 {
-    const CollectionKey key(rrclass, rrtype, name);
-    CollectionMap::const_iterator it = rrsets_.find(key);
+    CollectionMap::const_iterator it = rrsets_.find(LabelSequence(name));
     if (it != rrsets_.end()) {
-        return (it->second);
+        const size_t i = findInGroup(it->second, rrclass, rrtype);
+        if (i != it->second.size()) {
+            return (it->second[i]);
+        }
     }
     return (ConstRRsetPtr());
 }
@@ -101,27 +126,44 @@ bool
 RRsetCollection::removeRRset(const Name& name, const RRClass& rrclass,
                              const RRType& rrtype)
 {
-    const CollectionKey key(rrclass, rrtype, name);
-
-    CollectionMap::iterator it = rrsets_.find(key);
+    CollectionMap::iterator it = rrsets_.find(LabelSequence(name));
     if (it == rrsets_.end()) {
         return (false);
     }
+    RRsetGroup& group = it->second;
+    const size_t i = findInGroup(group, rrclass, rrtype);
+    if (i == group.size()) {
+        return (false);
+    }
 
-    rrsets_.erase(it);
+    if (group.size() == 1) {
+        rrsets_.erase(it);
+    } else if (i != 0) {
+        group.erase(group.begin() + i);
+    } else {
+        // The key refers to the name of the RRset to be removed, so the
+        // group is moved to a new key referring to the next one.
+        RRsetGroup rest;
+        rest.swap(group);
+        rrsets_.erase(it);
+        rest.erase(rest.begin());
+        const LabelSequence key(rest[0]->getName());
+        rrsets_.insert(CollectionMap::value_type(key, RRsetGroup())).
+            first->second.swap(rest);
+    }
     return (true);
 }
 
 RRsetCollectionBase::IterPtr
 RRsetCollection::getBeginning() {
     CollectionMap::iterator it = rrsets_.begin();
-    return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
+    return (RRsetCollectionBase::IterPtr(new DnsIter(it, 0)));
 }
 
 RRsetCollectionBase::IterPtr
 RRsetCollection::getEnd() {
     CollectionMap::iterator it = rrsets_.end();
-    return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
+    return (RRsetCollectionBase::IterPtr(new DnsIter(it, 0)));
 }
 
 } // end of namespace dns
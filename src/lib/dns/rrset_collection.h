@@ -16,18 +16,25 @@
 #define RRSET_COLLECTION_H 1
 
 #include <dns/rrset_collection_base.h>
+#include <dns/labelsequence.h>
 #include <dns/rrclass.h>
 
-#include <boost/tuple/tuple.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/unordered_map.hpp>
 
-#include <map>
+#include <vector>
 
 namespace bundy {
 namespace dns {
 
 /// \brief libdns++ implementation of RRsetCollectionBase using an STL
 /// container.
+///
+/// The RRsets are grouped by their owner names, and the groups are indexed
+/// by a hash table of the names, so finding an RRset takes constant time
+/// regardless of the size of the collection.  The index refers to the names
+/// stored in the RRsets themselves and doesn't copy them.  The order of
+/// iteration is unspecified except that the RRsets of the same name are
+/// returned consecutively.
 class RRsetCollection : public RRsetCollectionBase {
 public:
     /// \brief Constructor.
@@ -122,28 +129,36 @@ private:
                          const bundy::dns::RRClass& rrclass);
     void loaderCallback(const std::string&, size_t, const std::string&);
 
-    typedef boost::tuple<bundy::dns::RRClass, bundy::dns::RRType, bundy::dns::Name>
-        CollectionKey;
-    typedef std::map<CollectionKey, bundy::dns::RRsetPtr> CollectionMap;
-
+    // The key of each group refers to the name of its first RRset.
+    typedef std::vector<bundy::dns::RRsetPtr> RRsetGroup;
+    struct KeyHash {
+        size_t operator()(const LabelSequence& key) const {
+            return (key.getFullHash(false, 0));
+        }
+    };
+    typedef boost::unordered_map<LabelSequence, RRsetGroup, KeyHash>
+    CollectionMap;
     CollectionMap rrsets_;
 
 protected:
     class DnsIter : public RRsetCollectionBase::Iter {
     public:
-        DnsIter(CollectionMap::iterator& iter) :
-            iter_(iter)
+        DnsIter(CollectionMap::iterator& iter, size_t index) :
+            iter_(iter), index_(index)
         {}
 
         virtual const bundy::dns::AbstractRRset& getValue() {
-            bundy::dns::RRsetPtr& rrset = iter_->second;
-            return (*rrset);
+            return (*iter_->second[index_]);
         }
 
         virtual IterPtr getNext() {
             CollectionMap::iterator it = iter_;
+            if (index_ + 1 < it->second.size()) {
+                return (RRsetCollectionBase::IterPtr(
+                            new DnsIter(it, index_ + 1)));
+            }
             ++it;
-            return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
+            return (RRsetCollectionBase::IterPtr(new DnsIter(it, 0)));
         }
 
         virtual bool equals(Iter& other) {
@@ -151,11 +166,13 @@ protected:
             if (other_real == NULL) {
                 return (false);
             }
-            return (iter_ == other_real->iter_);
+            return (iter_ == other_real->iter_ &&
+                    index_ == other_real->index_);
         }
 
     private:
         CollectionMap::iterator iter_;
+        size_t index_;          // the position in the group
     };
 
     virtual RRsetCollectionBase::IterPtr getBeginning();
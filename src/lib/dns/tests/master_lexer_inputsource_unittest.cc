@@ -141,6 +141,93 @@ TEST_F(InputSourceTest, file) {
     checkGetAndUngetChar(source, str.c_str(), str.size());
 }
 
+// compact() and ungetAll() on a (memory-mapped) file source.
+TEST_F(InputSourceTest, fileMark) {
+    InputSource source(TEST_DATA_SRCDIR "/masterload.txt");
+    while (source.getCurrentLine() != 3) {
+        source.getChar();
+    }
+    const size_t pos = source.getPosition();
+    source.mark();
+    EXPECT_THROW(source.ungetChar(), InputSource::UngetBeforeBeginning);
+
+    while (!source.atEOF()) {
+        source.getChar();
+    }
+    EXPECT_EQ(source.getSize(), source.getPosition());
+    source.ungetAll();
+    EXPECT_EQ(pos, source.getPosition());
+    EXPECT_EQ(3, source.getCurrentLine());
+    EXPECT_FALSE(source.atEOF());
+    EXPECT_EQ('e', source.getChar());
+}
+
+TEST_F(InputSourceTest, getCharRun) {
+    std::bitset<128> stop_chars;
+    stop_chars.set('\n');
+    stop_chars.set(' ');
+    const char* run = NULL;
+
+    // Not available for a stream.
+    EXPECT_EQ(0, source_.getCharRun(stop_chars, &run));
+    EXPECT_EQ(0, source_.getPosition());
+
+    // For a file, it returns characters up to the stop character, as if
+    // getChar() was called for them.
+    InputSource source(TEST_DATA_SRCDIR "/masterload.txt");
+    while (source.getCurrentLine() != 3) {
+        source.getChar();
+    }
+    const size_t pos = source.getPosition();
+    ASSERT_EQ(12, source.getCharRun(stop_chars, &run));
+    EXPECT_EQ("example.com.", std::string(run, 12));
+    EXPECT_EQ(pos + 12, source.getPosition());
+    EXPECT_EQ(' ', source.getChar());
+    // The next character is a stop character.
+    source.ungetChar();
+    EXPECT_EQ(0, source.getCharRun(stop_chars, &run));
+    // The characters can be ungotten.
+    source.ungetChar();
+    EXPECT_EQ('.', source.getChar());
+    source.ungetAll();
+    EXPECT_EQ(0, source.getPosition());
+
+    // At the end of the source.
+    while (!source.atEOF()) {
+        source.getChar();
+    }
+    EXPECT_EQ(0, source.getCharRun(stop_chars, &run));
+    EXPECT_TRUE(source.atEOF());
+}
+
+// A region of memory is read in place, with the given name and line.
+TEST_F(InputSourceTest, memory) {
+    const std::string data("abc\nde");
+    InputSource source(data.c_str(), data.size(), "region", 10);
+    EXPECT_EQ("region", source.getName());
+    EXPECT_EQ(data.size(), source.getSize());
+    EXPECT_EQ(10, source.getCurrentLine());
+
+    std::bitset<128> stop_chars;
+    stop_chars.set('\n');
+    const char* run = NULL;
+    ASSERT_EQ(3, source.getCharRun(stop_chars, &run));
+    EXPECT_EQ(data.c_str(), run);
+    EXPECT_EQ('\n', source.getChar());
+    EXPECT_EQ(11, source.getCurrentLine());
+    EXPECT_EQ('d', source.getChar());
+    EXPECT_EQ('e', source.getChar());
+    EXPECT_EQ(InputSource::END_OF_STREAM, source.getChar());
+    source.ungetAll();
+    EXPECT_EQ(10, source.getCurrentLine());
+    EXPECT_EQ('a', source.getChar());
+
+    // An empty region.
+    InputSource empty(NULL, 0, "empty", 1);
+    EXPECT_EQ(InputSource::END_OF_STREAM, empty.getChar());
+    EXPECT_TRUE(empty.atEOF());
+}
+
 // ungetAll() should skip back to the place where the InputSource
 // started at construction, or the last saved start of line.
 TEST_F(InputSourceTest, ungetAll) {
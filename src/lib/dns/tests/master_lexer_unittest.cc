@@ -24,9 +24,12 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
 
+#include <fstream>
 #include <string>
 #include <sstream>
 
+#include <unistd.h>
+
 using namespace bundy::dns;
 using std::string;
 using std::stringstream;
@@ -429,6 +432,53 @@ eofCheck(MasterLexer& lexer, MasterToken::Type expect) {
     EXPECT_THROW(lexer.getNextToken(expect, false), MasterLexer::LexerError);
 }
 
+// Tokens read from a file, which is memory-mapped and partly scanned
+// a run of characters at once, should be the same as those read from
+// a stream of the same data.
+TEST_F(MasterLexerTest, fileAndStream) {
+    const char* const data =
+        "example.com. 3600 IN TXT \"quoted\\\" text\" ; comment\n"
+        "\tfoo\\ bar 12abc 4294967296 (\n  multi line ) \\;not-comment\r\n"
+        "esc\\\\;comment\n\xe3\x81\x82high-bit 0123 \"unbalanced\n"
+        "last-token-at-eof";
+    const char* const filename = TEST_DATA_BUILDDIR "/lexer_tokens.txt";
+    std::ofstream ofs(filename);
+    ofs << data;
+    ofs.close();
+    ss << data;
+
+    MasterLexer file_lexer;
+    ASSERT_TRUE(file_lexer.pushSource(filename));
+    lexer.pushSource(ss);
+    const MasterLexer::Options options =
+        MasterLexer::INITIAL_WS | MasterLexer::QSTRING | MasterLexer::NUMBER;
+    while (true) {
+        const MasterToken& token = lexer.getNextToken(options);
+        const MasterToken& file_token = file_lexer.getNextToken(options);
+        ASSERT_EQ(token.getType(), file_token.getType());
+        EXPECT_EQ(lexer.getSourceLine(), file_lexer.getSourceLine());
+        EXPECT_EQ(lexer.getPosition(), file_lexer.getPosition());
+        switch (token.getType()) {
+        case MasterToken::STRING:
+        case MasterToken::QSTRING:
+            EXPECT_EQ(token.getString(), file_token.getString());
+            break;
+        case MasterToken::NUMBER:
+            EXPECT_EQ(token.getNumber(), file_token.getNumber());
+            break;
+        case MasterToken::ERROR:
+            EXPECT_EQ(token.getErrorCode(), file_token.getErrorCode());
+            break;
+        default:
+            break;
+        }
+        if (token.getType() == MasterToken::END_OF_FILE) {
+            break;
+        }
+    }
+    unlink(filename);
+}
+
 TEST_F(MasterLexerTest, getNextTokenString) {
     ss << "normal-string\n";
     ss << "\n";
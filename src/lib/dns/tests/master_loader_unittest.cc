@@ -21,17 +21,23 @@
 #include <dns/name.h>
 #include <dns/rdata.h>
 
+#include <util/threads/sync.h>
+
 #include <gtest/gtest.h>
 
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <list>
 #include <sstream>
 
+#include <unistd.h>
+
 using namespace bundy::dns;
 using std::vector;
 using std::string;
@@ -1444,4 +1450,241 @@ TEST_F(MasterLoaderTest, numericOwnerName) {
     checkRR("1.example.org", RRType::A(), "192.0.2.1");
 }
 
+// Tests for the parallel mode.  They load a generated file both
+// sequentially and in parallel and compare the results.
+class MasterLoaderParallelTest : public ::testing::Test {
+protected:
+    MasterLoaderParallelTest() :
+        zone_file_(TEST_DATA_BUILDDIR "/parallel_load.zone")
+    {}
+
+    ~MasterLoaderParallelTest() {
+        unlink(zone_file_.c_str());
+    }
+
+    struct Result {
+        vector<string> rrs;
+        vector<string> issues;  // errors and warnings in the order
+        bool succeeded;
+        bool thrown;
+        size_t size;
+        size_t position;
+    };
+
+    static void addIssue(vector<string>* issues, const char* type,
+                         const string& file, size_t line,
+                         const string& reason)
+    {
+        std::stringstream ss;
+        ss << type << ": " << reason << " [" << file << ":" << line << "]";
+        issues->push_back(ss.str());
+    }
+
+    static void addRR(bundy::util::thread::Mutex* mutex, vector<string>* rrs,
+                      const Name& name, const RRClass& rrclass,
+                      const RRType& rrtype, const RRTTL& rrttl,
+                      const rdata::RdataPtr& data)
+    {
+        const string text = name.toText() + " " + rrttl.toText() + " " +
+            rrclass.toText() + " " + rrtype.toText() + " " + data->toText();
+        const bundy::util::thread::Mutex::Locker locker(*mutex);
+        rrs->push_back(text);
+    }
+
+    void writeZone(const string& content) {
+        std::ofstream ofs(zone_file_.c_str());
+        ofs << content;
+    }
+
+    Result load(MasterLoader::Options options, size_t thread_count,
+                size_t count_limit = 1000)
+    {
+        Result result;
+        bundy::util::thread::Mutex mutex;
+        MasterLoaderCallbacks callbacks(
+            boost::bind(addIssue, &result.issues, "error", _1, _2, _3),
+            boost::bind(addIssue, &result.issues, "warning", _1, _2, _3));
+        MasterLoader loader(zone_file_.c_str(), Name("example.org"),
+                            RRClass::IN(), callbacks,
+                            boost::bind(addRR, &mutex, &result.rrs,
+                                        _1, _2, _3, _4, _5),
+                            options, thread_count);
+        result.thrown = false;
+        try {
+            while (!loader.loadIncremental(count_limit)) {
+                ;
+            }
+        } catch (const MasterLoaderError&) {
+            result.thrown = true;
+        }
+        result.succeeded = loader.loadedSucessfully();
+        result.size = loader.getSize();
+        result.position = loader.getPosition();
+        return (result);
+    }
+
+    // Load the file sequentially and in parallel, and check the results are
+    // the same.
+    void checkLoad(MasterLoader::Options options) {
+        const Result expected = load(options, 1);
+        for (size_t thread_count = 2; thread_count <= 4; thread_count += 2) {
+            SCOPED_TRACE("thread count " +
+                         lexical_cast<string>(thread_count));
+            const Result result = load(options, thread_count);
+            EXPECT_EQ(expected.succeeded, result.succeeded);
+            EXPECT_EQ(expected.thrown, result.thrown);
+            EXPECT_TRUE(expected.rrs == result.rrs);
+            EXPECT_EQ(expected.rrs.size(), result.rrs.size());
+            EXPECT_TRUE(expected.issues == result.issues);
+            EXPECT_EQ(expected.size, result.size);
+            EXPECT_EQ(expected.position, result.position);
+
+            // The result shouldn't change with a small count limit.
+            const Result result_incremental = load(options, thread_count, 7);
+            EXPECT_TRUE(expected.rrs == result_incremental.rrs);
+            EXPECT_TRUE(expected.issues == result_incremental.issues);
+        }
+    }
+
+    // Generate a zone of the given number of names, large enough to be
+    // split into several chunks.  Each name has some tricky records for
+    // the splitter.
+    static string generateZone(size_t name_count, bool use_ttl_directive) {
+        std::stringstream ss;
+        if (use_ttl_directive) {
+            ss << "$TTL 3600\n";
+            ss << "example.org. IN SOA ns1 admin 1 3600 1800 2419200 7200\n";
+        } else {
+            ss << "example.org. IN SOA ns1 admin 1 3600 1800 2419200 300\n";
+        }
+        for (size_t i = 0; i < name_count; ++i) {
+            if (i % 500 == 0) {
+                ss << "$ORIGIN sub" << i / 500 << ".example.org.\n";
+            }
+            if (use_ttl_directive && i % 700 == 0) {
+                ss << "$TTL " << 100 + i << " ; comment\n";
+            }
+            ss << "host" << i << " A 192.0.2." << i % 256 << "\n";
+            if (i % 3 == 0) {
+                // The TTL of the next one comes from this one without $TTL.
+                ss << "     " << i << " AAAA 2001:db8::" << i % 1000 << "\n";
+                ss << "\tAAAA 2001:db8::1:" << i % 1000 << "\n";
+            }
+            ss << "txt" << i << " TXT \"(quoted; \\\"\" ( \"string\"\n"
+               << "host" << i << " \"in parentheses\" ) ; (\n";
+            ss << "mx" << i << " MX ( 10 ; comment with \"\n"
+               << "host" << i << " )\n";
+            ss << ";host" << i << " A 192.0.2.1\n";
+            ss << "\n";
+        }
+        return (ss.str());
+    }
+
+    const string zone_file_;
+};
+
+TEST_F(MasterLoaderParallelTest, load) {
+    writeZone(generateZone(5000, true));
+    checkLoad(MasterLoader::DEFAULT);
+    checkLoad(MasterLoader::MANY_ERRORS);
+    const Result result = load(MasterLoader::DEFAULT, 4);
+    EXPECT_TRUE(result.succeeded);
+    EXPECT_TRUE(result.issues.empty());
+    EXPECT_EQ(result.size, result.position);
+}
+
+TEST_F(MasterLoaderParallelTest, ttlFromSOA) {
+    // The default TTL comes from the SOA minimum.
+    writeZone(generateZone(5000, false));
+    checkLoad(MasterLoader::DEFAULT);
+    const Result result = load(MasterLoader::DEFAULT, 4);
+    EXPECT_TRUE(result.succeeded);
+    ASSERT_EQ(1, result.issues.size());
+    EXPECT_NE(string::npos, result.issues[0].find("using SOA MINTTL"));
+}
+
+TEST_F(MasterLoaderParallelTest, ttlFromPrevious) {
+    // The TTLs come from the preceding RRs.  There's only one warning for
+    // the RFC1035 semantics.
+    writeZone("example.org. 7200 IN NS ns1\n" + generateZone(5000, false));
+    checkLoad(MasterLoader::DEFAULT);
+    const Result result = load(MasterLoader::DEFAULT, 4);
+    EXPECT_TRUE(result.succeeded);
+    ASSERT_EQ(1, result.issues.size());
+    EXPECT_NE(string::npos, result.issues[0].find("RFC1035 TTL semantics"));
+}
+
+TEST_F(MasterLoaderParallelTest, errors) {
+    string zone = generateZone(2000, true);
+    zone += "bad A 192.0.2.256\n";
+    zone += generateZone(2000, false);
+    zone += "bad2 A 192.0.2.\n";
+    zone += "bad3 A 192.0.2.1 extra\n";
+    zone += generateZone(2000, true);
+    zone += "$ORIGIN\n";
+    zone += "$ORIGIN sub1.example.org.\n";
+    zone += "$TTL\n";
+    zone += "$TTL 300\n";
+    zone += generateZone(2000, true);
+    writeZone(zone);
+    checkLoad(MasterLoader::MANY_ERRORS);
+    const Result result = load(MasterLoader::MANY_ERRORS, 4);
+    EXPECT_FALSE(result.succeeded);
+    size_t error_count = 0;
+    for (size_t i = 0; i < result.issues.size(); ++i) {
+        if (result.issues[i].compare(0, 6, "error:") == 0) {
+            ++error_count;
+        }
+    }
+    EXPECT_EQ(5, error_count);
+
+    // Without MANY_ERRORS, it stops at the first error.
+    checkLoad(MasterLoader::DEFAULT);
+    EXPECT_TRUE(load(MasterLoader::DEFAULT, 4).thrown);
+}
+
+TEST_F(MasterLoaderParallelTest, unordered) {
+    writeZone(generateZone(5000, false));
+    Result expected = load(MasterLoader::DEFAULT, 1);
+    Result result = load(MasterLoader::UNORDERED, 4);
+    EXPECT_TRUE(result.succeeded);
+    EXPECT_TRUE(expected.issues == result.issues);
+    std::sort(expected.rrs.begin(), expected.rrs.end());
+    std::sort(result.rrs.begin(), result.rrs.end());
+    EXPECT_TRUE(expected.rrs == result.rrs);
+}
+
+TEST_F(MasterLoaderParallelTest, sequentialFallback) {
+    // Files including another file are parsed sequentially.
+    writeZone(generateZone(3000, true) +
+              "$INCLUDE " TEST_DATA_SRCDIR "/example.org\n" +
+              generateZone(3000, true));
+    checkLoad(MasterLoader::DEFAULT);
+
+    // So are small files, and those that can't be split.
+    writeZone(generateZone(10, true));
+    checkLoad(MasterLoader::DEFAULT);
+    writeZone(generateZone(3000, true) + "a TXT \"unbalanced\n" +
+              generateZone(3000, true));
+    checkLoad(MasterLoader::MANY_ERRORS);
+
+    // Or, the file can't be opened.
+    unlink(zone_file_.c_str());
+    const Result result = load(MasterLoader::MANY_ERRORS, 4);
+    EXPECT_FALSE(result.succeeded);
+    EXPECT_EQ(1, result.issues.size());
+}
+
+TEST_F(MasterLoaderParallelTest, badThreadCount) {
+    EXPECT_THROW(MasterLoader(zone_file_.c_str(), Name("example.org"),
+                              RRClass::IN(), MasterLoaderCallbacks::
+                              getNullCallbacks(),
+                              boost::bind(addRR, static_cast<bundy::util::
+                                          thread::Mutex*>(NULL),
+                                          static_cast<vector<string>*>(NULL),
+                                          _1, _2, _3, _4, _5),
+                              MasterLoader::DEFAULT, 0),
+                 bundy::InvalidParameter);
+}
+
 }
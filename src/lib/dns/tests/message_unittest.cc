@@ -719,6 +719,141 @@ TEST_F(MessageTest, fromWirePreserveAdditional) {
     }
 }
 
+TEST_F(MessageTest, fromWireLazy) {
+    factoryFromFile(message_parse, "message_fromWire1", Message::PARSE_LAZY);
+
+    // The number of RRs is known before the answer section is parsed.
+    EXPECT_EQ(2, message_parse.getRRCount(Message::SECTION_ANSWER));
+
+    // The data is copied, so the original data doesn't have to be valid
+    // when the sections are built.
+    const vector<unsigned char> data = received_data;
+    received_data.assign(received_data.size(), 0);
+    checkMessageFromWire(message_parse, test_name);
+
+    // The result should be the same as that of the normal mode.
+    Message message_eager(Message::PARSE);
+    received_data = data;
+    InputBuffer buffer(&received_data[0], received_data.size());
+    message_eager.fromWire(buffer);
+    EXPECT_EQ(message_eager.toText(), message_parse.toText());
+
+    // Parse another message into the same object.
+    factoryFromFile(message_parse, "message_fromWire19.wire",
+                    Message::PARSE_LAZY);
+    EXPECT_EQ(3, message_parse.getRRCount(Message::SECTION_ANSWER));
+    EXPECT_TRUE(message_parse.hasRRset(Message::SECTION_ANSWER,
+                                       Name("example.com"), RRClass::IN(),
+                                       RRType::AAAA()));
+}
+
+TEST_F(MessageTest, fromWireLazyPreserveOrder) {
+    const Message::ParseOptions options =
+        static_cast<Message::ParseOptions>(Message::PARSE_LAZY |
+                                           Message::PRESERVE_ORDER);
+    factoryFromFile(message_parse, "message_fromWire19.wire", options);
+    {
+        SCOPED_TRACE("lazily preserve answer RRs");
+        preserveRRCheck(message_parse, Message::SECTION_ANSWER);
+    }
+    factoryFromFile(message_parse, "message_fromWire20.wire", options);
+    {
+        SCOPED_TRACE("lazily preserve authority RRs");
+        preserveRRCheck(message_parse, Message::SECTION_AUTHORITY);
+    }
+    factoryFromFile(message_parse, "message_fromWire21.wire", options);
+    {
+        SCOPED_TRACE("lazily preserve additional RRs");
+        preserveRRCheck(message_parse, Message::SECTION_ADDITIONAL);
+    }
+}
+
+TEST_F(MessageTest, fromWireLazyEDNSAndTSIG) {
+    // EDNS and TSIG are parsed immediately, and the same checks apply.
+    factoryFromFile(message_parse, "message_fromWire10.wire",
+                    Message::PARSE_LAZY);
+    ASSERT_TRUE(message_parse.getEDNS());
+    EXPECT_EQ(4096, message_parse.getEDNS()->getUDPSize());
+    EXPECT_EQ(Rcode::BADVERS(), message_parse.getRcode());
+    EXPECT_EQ(0, message_parse.getRRCount(Message::SECTION_ADDITIONAL));
+
+    factoryFromFile(message_parse, "message_toWire2.wire",
+                    Message::PARSE_LAZY);
+    ASSERT_NE(static_cast<void*>(NULL), message_parse.getTSIGRecord());
+    EXPECT_EQ(85, message_parse.getTSIGRecord()->getLength());
+
+    factoryFromFile(message_parse, "message_fromWire12.wire",
+                    Message::PARSE_LAZY);
+    ASSERT_NE(static_cast<void*>(NULL), message_parse.getTSIGRecord());
+    EXPECT_EQ(Name("www.example.com"),
+              message_parse.getTSIGRecord()->getName());
+    EXPECT_EQ(70, message_parse.getTSIGRecord()->getLength());
+
+    const char* const bad_files[] = {
+        "message_fromWire4", "message_fromWire5", "message_fromWire13.wire",
+        "message_fromWire14.wire", "message_fromWire15.wire"
+    };
+    for (size_t i = 0; i < sizeof(bad_files) / sizeof(bad_files[0]); ++i) {
+        SCOPED_TRACE(bad_files[i]);
+        EXPECT_THROW(factoryFromFile(message_parse, bad_files[i],
+                                     Message::PARSE_LAZY),
+                     DNSMessageFORMERR);
+    }
+}
+
+TEST_F(MessageTest, fromWireLazyEDNSFirst) {
+    // The RRs following the OPT RR in the additional section are built
+    // as in the normal mode.
+    factoryFromFile(message_parse, "message_fromWire23.wire",
+                    Message::PARSE_LAZY);
+    ASSERT_TRUE(message_parse.getEDNS());
+    EXPECT_EQ(2, message_parse.getRRCount(Message::SECTION_ADDITIONAL));
+    RRsetIterator rrset =
+        message_parse.beginSection(Message::SECTION_ADDITIONAL);
+    ASSERT_TRUE(rrset !=
+                message_parse.endSection(Message::SECTION_ADDITIONAL));
+    EXPECT_EQ(RRType::A(), (*rrset)->getType());
+    EXPECT_EQ(2, (*rrset)->getRdataCount());
+    EXPECT_TRUE(++rrset ==
+                message_parse.endSection(Message::SECTION_ADDITIONAL));
+
+    Message message_eager(Message::PARSE);
+    InputBuffer buffer(&received_data[0], received_data.size());
+    message_eager.fromWire(buffer);
+    EXPECT_EQ(message_eager.toText(), message_parse.toText());
+}
+
+TEST_F(MessageTest, fromWireLazyErrors) {
+    // A broken RR is detected when the RR is skipped.
+    UnitTestUtil::readWireData("message_fromWire22.wire", received_data);
+    InputBuffer buffer(&received_data[0], received_data.size() - 1);
+    EXPECT_THROW(message_parse.fromWire(buffer, Message::PARSE_LAZY),
+                 DNSMessageFORMERR);
+
+    // Invalid RDATA is only detected when the section is built.  Here we
+    // change the type of the second answer RR (at offset 50) to AAAA, whose
+    // RDATA must be 16 bytes long.
+    received_data.clear();
+    UnitTestUtil::readWireData("message_fromWire1", received_data);
+    received_data[53] = RRType::AAAA().getCode();
+    InputBuffer buffer2(&received_data[0], received_data.size());
+    EXPECT_THROW(Message(Message::PARSE).fromWire(buffer2),
+                 DNSMessageFORMERR);
+    message_parse.fromWire(buffer2, Message::PARSE_LAZY);
+    EXPECT_EQ(2, message_parse.getRRCount(Message::SECTION_ANSWER));
+    EXPECT_THROW(message_parse.beginSection(Message::SECTION_ANSWER),
+                 DNSMessageFORMERR);
+    // The failure persists, and no partial result is visible.
+    EXPECT_THROW(message_parse.endSection(Message::SECTION_AUTHORITY),
+                 DNSMessageFORMERR);
+    EXPECT_THROW(message_parse.toText(), DNSMessageFORMERR);
+
+    // Making a response drops the sections, so there's nothing to fail.
+    message_parse.makeResponse();
+    EXPECT_TRUE(message_parse.beginSection(Message::SECTION_ANSWER) ==
+                message_parse.endSection(Message::SECTION_ANSWER));
+}
+
 TEST_F(MessageTest, EDNS0ExtRcode) {
     // Extended Rcode = BADVERS
     factoryFromFile(message_parse, "message_fromWire10.wire");
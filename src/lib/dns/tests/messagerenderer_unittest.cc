@@ -238,6 +238,47 @@ TEST_F(MessageRendererTest, writeNameLabelSequence3) {
                   renderer.getData(), renderer.getLength());
 }
 
+TEST_F(MessageRendererTest, writeNameDeepHierarchy) {
+    // Names sharing ancestors at various levels.  Each name should be
+    // compressed to its longest rendered ancestor, which is not necessarily
+    // a name rendered before as a whole.
+    renderer.writeName(Name("a.b.c.example.com"));
+    const size_t len1 = renderer.getLength();
+    renderer.writeName(Name("x.c.example.com"));
+    // "x" + pointer to "c.example.com"
+    EXPECT_EQ(len1 + 2 + 2, renderer.getLength());
+    renderer.writeName(Name("y.x.C.EXAMPLE.com"));
+    // "y" + pointer to "x.c.example.com"
+    EXPECT_EQ(len1 + 4 + 2 + 2, renderer.getLength());
+    renderer.writeName(Name("b.c.example.com"));
+    // pointer only
+    EXPECT_EQ(len1 + 8 + 2, renderer.getLength());
+
+    bundy::util::InputBuffer b(renderer.getData(), renderer.getLength());
+    EXPECT_EQ(Name("a.b.c.example.com"), Name(b));
+    EXPECT_EQ(Name("x.c.example.com"), Name(b));
+    EXPECT_EQ(Name("y.x.c.example.com"), Name(b));
+    EXPECT_EQ(Name("b.c.example.com"), Name(b));
+}
+
+TEST_F(MessageRendererTest, clearAndReuse) {
+    // After clear(), the renderer should behave like a new one, whether
+    // its internal table has been grown or not.
+    for (size_t count = 1; count <= 1000; count *= 10) {
+        MessageRenderer new_renderer;
+        for (size_t i = 0; i < count; ++i) {
+            const Name name(lexical_cast<std::string>(i % 20) + "." +
+                            lexical_cast<std::string>(i) + ".example");
+            renderer.writeName(name);
+            new_renderer.writeName(name);
+        }
+        matchWireData(new_renderer.getData(), new_renderer.getLength(),
+                      renderer.getData(), renderer.getLength());
+        renderer.clear();
+        EXPECT_EQ(0, renderer.getLength());
+    }
+}
+
 TEST_F(MessageRendererTest, setBuffer) {
     OutputBuffer new_buffer(0);
     renderer.setBuffer(&new_buffer);
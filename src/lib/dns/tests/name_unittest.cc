@@ -22,6 +22,8 @@
 #include <util/buffer.h>
 #include <dns/exceptions.h>
 #include <dns/name.h>
+#include <dns/name_internal.h>
+#include <dns/labelsequence.h>
 #include <dns/messagerenderer.h>
 
 #include <dns/tests/unittest_util.h>
@@ -34,6 +36,7 @@ using namespace bundy;
 using namespace bundy::dns;
 using namespace bundy::util;
 using bundy::util::unittests::matchWireData;
+using namespace bundy::dns::name::internal;
 
 //
 // XXX: these are defined as class static constants, but some compilers
@@ -286,6 +289,15 @@ TEST_F(NameTest, fromText) {
                                   "123456789.1234");
     // This is a possible longest name and should be accepted
     EXPECT_NO_THROW(Name(string(max_len_str)));
+    // Too long names consisting of the max number of short labels.  The
+    // last label starts at the end of the possible name data.
+    string short_labels_str;
+    for (int i = 0; i < 127; ++i) {
+        short_labels_str += "a.";
+    }
+    checkBadTextName<TooLongName>(short_labels_str + "a");
+    checkBadTextName<TooLongName>(short_labels_str + "ab.");
+    checkBadTextName<TooLongName>(short_labels_str + "\\097");
     // \DDD must consist of 3 digits.
     checkBadTextName<IncompleteName>("\\12");
 
@@ -597,6 +609,132 @@ TEST_F(NameTest, equal) {
     EXPECT_TRUE(example_name.nequals(Name("www\\.example.com.")));
 }
 
+// A simple deterministic pseudo random generator for the tests below.
+class RandomGenerator {
+public:
+    RandomGenerator() : state_(12345) {}
+    unsigned int operator()(unsigned int limit) {
+        state_ = state_ * 1103515245 + 12345;
+        return ((state_ >> 16) % limit);
+    }
+private:
+    uint32_t state_;
+};
+
+// Restore the implementation of case-insensitive comparison on destruction.
+class CompareImplRestorer {
+public:
+    CompareImplRestorer() : impl_(getCompareImpl()) {}
+    ~CompareImplRestorer() { selectCompareImpl(impl_); }
+private:
+    const CompareImpl impl_;
+};
+
+// Bytes that are close to the range of uppercase letters, including those
+// that would be converted if the high bit were ignored.
+const uint8_t tricky_bytes[] = {
+    '@', 'A', 'Z', '[', '`', 'a', 'z', '{', 0x00, 0x7f, 0x80, 0xc0, 0xc1,
+    0xda, 0xdb, 0xe1, 0xfa, 0xff
+};
+
+TEST_F(NameTest, compareImplementations) {
+    const CompareImplRestorer restorer;
+    EXPECT_TRUE(selectCompareImpl(COMPARE_SCALAR));
+    EXPECT_EQ(COMPARE_SCALAR, getCompareImpl());
+
+    const CompareImpl impls[] = { COMPARE_SSE2, COMPARE_AVX2 };
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); ++n) {
+        if (!selectCompareImpl(impls[n])) {
+            continue;           // not supported in this environment
+        }
+        EXPECT_EQ(impls[n], getCompareImpl());
+
+        RandomGenerator rand;
+        for (size_t len = 0; len <= 300; ++len) {
+            for (int i = 0; i < 20; ++i) {
+                vector<uint8_t> data1(len + 1), data2(len + 1);
+                for (size_t j = 0; j < len; ++j) {
+                    data1[j] = (rand(2) == 0) ?
+                        tricky_bytes[rand(sizeof(tricky_bytes))] : rand(256);
+                    // Use the same byte, possibly in the other case.
+                    data2[j] = data1[j];
+                    if (rand(2) == 0 && maptolower[data1[j]] != data1[j]) {
+                        data2[j] = maptolower[data1[j]];
+                    } else if (rand(2) == 0 && data1[j] >= 'a' &&
+                               data1[j] <= 'z') {
+                        data2[j] = data1[j] - 'a' + 'A';
+                    }
+                }
+                // Change a byte in some cases.
+                if (len > 0 && i % 2 == 1) {
+                    data2[rand(len)] = tricky_bytes[rand(sizeof(tricky_bytes))];
+                }
+                const size_t result = mismatchNoCase(&data1[0], &data2[0],
+                                                     len);
+                ASSERT_TRUE(selectCompareImpl(COMPARE_SCALAR));
+                EXPECT_EQ(mismatchNoCase(&data1[0], &data2[0], len), result)
+                    << "length " << len;
+                ASSERT_TRUE(selectCompareImpl(impls[n]));
+            }
+        }
+    }
+}
+
+TEST_F(NameTest, compareNamesWithImplementations) {
+    const CompareImplRestorer restorer;
+
+    // Build names with labels of various lengths, and their variants
+    // differing in case or in one character.
+    RandomGenerator rand;
+    vector<Name> names;
+    for (int i = 0; i < 200; ++i) {
+        string name_txt;
+        const unsigned int labels = 1 + rand(5);
+        for (unsigned int l = 0; l < labels; ++l) {
+            const unsigned int label_len = 1 + rand(l == 0 ? 63 : 20);
+            for (unsigned int j = 0; j < label_len; ++j) {
+                name_txt.push_back("abcXYZ-09"[rand(9)]);
+            }
+            name_txt.push_back('.');
+        }
+        name_txt += "example.com";
+        names.push_back(Name(name_txt));
+        string variant_txt(name_txt);
+        char& ch = variant_txt[rand(variant_txt.size() - 12)];
+        ch = (ch == '.') ? '.' : ((ch >= '0' && ch <= '9') ? 'q' : ch ^ 0x20);
+        names.push_back(Name(variant_txt));
+    }
+
+    const CompareImpl impls[] = { COMPARE_SSE2, COMPARE_AVX2 };
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); ++n) {
+        if (!selectCompareImpl(impls[n])) {
+            continue;
+        }
+        for (size_t i = 0; i < names.size(); ++i) {
+            for (size_t j = i; j < names.size() && j < i + 10; ++j) {
+                const NameComparisonResult result =
+                    names[i].compare(names[j]);
+                const bool equal = names[i].equals(names[j]);
+                const LabelSequence ls1(names[i]), ls2(names[j]);
+                const bool ls_equal = ls1.equals(ls2);
+
+                ASSERT_TRUE(selectCompareImpl(COMPARE_SCALAR));
+                const NameComparisonResult expected =
+                    names[i].compare(names[j]);
+                EXPECT_EQ(expected.getOrder(), result.getOrder());
+                EXPECT_EQ(expected.getCommonLabels(),
+                          result.getCommonLabels());
+                EXPECT_EQ(expected.getRelation(), result.getRelation());
+                EXPECT_EQ(names[i].equals(names[j]), equal);
+                EXPECT_EQ(ls1.equals(ls2), ls_equal);
+                EXPECT_EQ(expected.getRelation() ==
+                          NameComparisonResult::EQUAL, equal);
+                ASSERT_TRUE(selectCompareImpl(impls[n]));
+            }
+        }
+    }
+}
+
 TEST_F(NameTest, isWildcard) {
     EXPECT_FALSE(example_name.isWildcard());
     EXPECT_TRUE(Name("*.a.example.com").isWildcard());
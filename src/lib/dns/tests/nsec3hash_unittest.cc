@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -138,6 +139,75 @@ TEST_F(NSEC3HashTest, calculate) {
               ->calculate(LabelSequence(Name("example.org"))));
 }
 
+TEST_F(NSEC3HashTest, calculateBatch) {
+    // The names and hashes of the RFC5155 example (Appendix A), with some
+    // upper case letters.
+    const char* const names[] = {
+        "example", "a.example", "ai.example", "NS1.example", "ns2.example",
+        "w.example", "*.w.example", "x.w.example", "y.w.Example",
+        "x.y.w.example", "xx.example", NULL
+    };
+    const char* const hashes[] = {
+        "0P9MHAVEQVM6T7VBL5LOP2U3T2RP3TOM", "35MTHGPGCU1QG68FAB165KLNSNK3DPVL",
+        "GJEQE526PLBF1G8MKLP59ENFD789NJGI", "2T7B4G4VSA5SMI47K61MV5BV1A22BOJR",
+        "Q04JKCEVQVMU85R014C7DKBA38O0JI5R", "K8UDEMVP1J2F7EG6JEBPS17VP3N8I58H",
+        "R53BQ7CC2UVMUBFU5OCMM6PERS9TK9EN", "B4UM86EGHHDS6NEA196SMVMLO4ORS995",
+        "JI6NEOAEPV8B5O6K4EV33ABHA8HT9FGC", "2VPTU5TIMAMQTTGL4LUU9KG21E0AOR3S",
+        "T644EBQK9BIBCNA874GIVR6JOJ62MLHV"
+    };
+    vector<Name> name_objs;
+    for (size_t i = 0; names[i] != NULL; ++i) {
+        name_objs.push_back(Name(names[i]));
+    }
+
+    // Hash any number of the names together.
+    for (size_t count = 0; count <= name_objs.size(); ++count) {
+        vector<LabelSequence> sequences;
+        for (size_t i = 0; i < count; ++i) {
+            sequences.push_back(LabelSequence(name_objs[i]));
+        }
+        vector<string> results(1, "garbage");
+        test_hash->calculateBatch(sequences, results);
+        ASSERT_EQ(count, results.size());
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(hashes[i], results[i]) << names[i];
+        }
+    }
+
+    // Long names and salt, some of them longer than a block of SHA-1, and
+    // other parameters.  The results should be the same as those of
+    // calculate().
+    const string params[] = {
+        "1 0 0 -", "1 0 1 aa", "1 0 150 " + string(100, 'a'),
+        "1 0 2 " + string(510, 'b')
+    };
+    vector<Name> long_names;
+    string label;
+    for (size_t i = 0; i < 20; ++i) {
+        label.push_back('a' + i);
+        long_names.push_back(Name(label + "." + string(i * 10, 'x').substr(
+                                      0, i * 3) + "x.example"));
+    }
+    long_names.push_back(Name(string(63, 'a') + "." + string(63, 'b') + "." +
+                              string(63, 'c') + "." + string(61, 'd')));
+    long_names.push_back(Name::ROOT_NAME());
+    vector<LabelSequence> sequences;
+    for (size_t i = 0; i < long_names.size(); ++i) {
+        sequences.push_back(LabelSequence(long_names[i]));
+    }
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); ++i) {
+        const NSEC3HashPtr hash(NSEC3Hash::create(
+                                    generic::NSEC3PARAM(params[i])));
+        vector<string> results;
+        hash->calculateBatch(sequences, results);
+        ASSERT_EQ(sequences.size(), results.size());
+        for (size_t j = 0; j < sequences.size(); ++j) {
+            EXPECT_EQ(hash->calculate(sequences[j]), results[j])
+                << params[i] << ", " << long_names[j];
+        }
+    }
+}
+
 // Common checks for match cases
 template <typename RDATAType>
 void
@@ -238,6 +308,12 @@ TEST_F(NSEC3HashTest, setCreator) {
               test_hash->calculate(Name("example")));
     EXPECT_EQ("00000000000000000000000000000000",
               test_hash->calculate(LabelSequence(Name("example"))));
+    // The default calculateBatch() uses the faked calculate().
+    const Name example("example");
+    vector<string> results;
+    test_hash->calculateBatch(vector<LabelSequence>(2, LabelSequence(example)),
+                              results);
+    EXPECT_EQ(vector<string>(2, "00000000000000000000000000000000"), results);
     // Same for hash from NSEC3 RDATA
     test_hash.reset(NSEC3Hash::create(generic::NSEC3
                                       ("1 0 12 aabbccdd " +
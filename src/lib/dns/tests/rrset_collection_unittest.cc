@@ -172,6 +172,76 @@ TEST_F(RRsetCollectionTest, iteratorTest) {
     EXPECT_EQ(4, count);
 }
 
+TEST_F(RRsetCollectionTest, sameName) {
+    RRsetCollection cln;
+    const RRType types[] = { RRType::A(), RRType::AAAA(), RRType::MX(),
+                             RRType::TXT() };
+    const size_t type_count = sizeof(types) / sizeof(types[0]);
+
+    // Add RRsets of the same name (in different cases) and some others.
+    // The collection holds the only reference to them.
+    for (size_t i = 0; i < type_count; ++i) {
+        cln.addRRset(RRsetPtr(new BasicRRset(Name(i % 2 == 0 ?
+                                                  "www.example.org" :
+                                                  "WWW.Example.ORG"),
+                                             rrclass, types[i], RRTTL(60))));
+        cln.addRRset(RRsetPtr(new BasicRRset(Name("x" +
+                                                  types[i].toText() +
+                                                  ".example.org"),
+                                             rrclass, types[i], RRTTL(60))));
+    }
+    EXPECT_THROW(cln.addRRset(RRsetPtr(new BasicRRset(Name("WWW.EXAMPLE.ORG"),
+                                                      rrclass, RRType::MX(),
+                                                      RRTTL(60)))),
+                 bundy::InvalidParameter);
+    // Same name and type but different class is a different RRset.
+    cln.addRRset(RRsetPtr(new BasicRRset(Name("www.example.org"),
+                                         RRClass::CH(), RRType::A(),
+                                         RRTTL(60))));
+    EXPECT_TRUE(cln.find(Name("www.example.org"), RRClass::CH(),
+                         RRType::A()));
+
+    // The RRsets of the same name are iterated over consecutively.
+    size_t count = 0;
+    size_t www_count = 0;
+    bool www_done = false;
+    for (RRsetCollection::Iterator it = cln.begin(); it != cln.end(); ++it) {
+        ++count;
+        if ((*it).getName() == Name("www.example.org")) {
+            EXPECT_FALSE(www_done);
+            ++www_count;
+        } else if (www_count > 0) {
+            www_done = true;
+        }
+    }
+    EXPECT_EQ(type_count * 2 + 1, count);
+    EXPECT_EQ(type_count + 1, www_count);
+
+    // Remove them in the order they were added, so the first one of the
+    // name is always removed.  Others must still be found.
+    for (size_t i = 0; i < type_count; ++i) {
+        EXPECT_TRUE(cln.removeRRset(Name("www.example.org"), rrclass,
+                                    types[i]));
+        EXPECT_FALSE(cln.find(Name("www.example.org"), rrclass, types[i]));
+        for (size_t j = i + 1; j < type_count; ++j) {
+            const ConstRRsetPtr found = cln.find(Name("Www.example.org"),
+                                                 rrclass, types[j]);
+            ASSERT_TRUE(found);
+            EXPECT_EQ(types[j], found->getType());
+        }
+    }
+    EXPECT_TRUE(cln.find(Name("www.example.org"), RRClass::CH(),
+                         RRType::A()));
+    EXPECT_TRUE(cln.removeRRset(Name("www.example.org"), RRClass::CH(),
+                                RRType::A()));
+    EXPECT_FALSE(cln.removeRRset(Name("www.example.org"), RRClass::CH(),
+                                 RRType::A()));
+    for (size_t i = 0; i < type_count; ++i) {
+        EXPECT_TRUE(cln.find(Name("x" + types[i].toText() + ".example.org"),
+                             rrclass, types[i]));
+    }
+}
+
 // This is a dummy class which is used in iteratorCompareDifferent test
 // to compare iterators from different RRsetCollectionBase
 // implementations.
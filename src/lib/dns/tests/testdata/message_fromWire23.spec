@@ -0,0 +1,19 @@
+#
+# A DNS response message whose additional section has the EDNS OPT RR
+# before other RRs.
+#
+
+[custom]
+sections: header:question:edns:a/1:a/2
+[header]
+qr: 1
+arcount: 3
+[question]
+name: www.example.com
+rrtype: A
+[edns]
+[a/1]
+as_rr: True
+[a/2]
+as_rr: True
+address: 192.0.2.2
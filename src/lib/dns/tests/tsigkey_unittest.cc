@@ -13,12 +13,17 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <gtest/gtest.h>
 
 #include <exceptions/exceptions.h>
 
 #include <cryptolink/cryptolink.h>
+#include <cryptolink/crypto_hmac.h>
 
 #include <dns/tsigkey.h>
 
@@ -151,6 +156,45 @@ TEST_F(TSIGKeyTest, assignment) {
     compareTSIGKeys(original, copy);
 }
 
+TEST_F(TSIGKeyTest, createHMAC) {
+    const TSIGKey key(key_name, TSIGKey::HMACSHA256_NAME(),
+                      secret.c_str(), secret.size());
+    bundy::util::OutputBuffer expected(0);
+    bundy::cryptolink::signHMAC("data", 4, secret.c_str(), secret.size(),
+                                bundy::cryptolink::SHA256, expected);
+
+    boost::shared_ptr<bundy::cryptolink::HMAC> hmac = key.createHMAC();
+    hmac->update("data", 4);
+    vector<uint8_t> sig = hmac->sign();
+    matchWireData(expected.getData(), expected.getLength(),
+                  &sig[0], sig.size());
+
+    // A released object is reused, also by the copies of the key.  Data
+    // added without a signature is discarded.
+    const bundy::cryptolink::HMAC* const hmac_ptr = hmac.get();
+    hmac->update("garbage", 7);
+    hmac.reset();
+    const TSIGKey copy(key);
+    hmac = copy.createHMAC();
+    EXPECT_EQ(hmac_ptr, hmac.get());
+    hmac->update("data", 4);
+    sig = hmac->sign();
+    matchWireData(expected.getData(), expected.getLength(),
+                  &sig[0], sig.size());
+
+    // Objects used at the same time are different ones.
+    const boost::shared_ptr<bundy::cryptolink::HMAC> hmac2 =
+        key.createHMAC();
+    EXPECT_NE(hmac.get(), hmac2.get());
+
+    // Keys without a usable algorithm or secret can't create one.
+    EXPECT_THROW(TSIGKey(key_name, Name("unknown-alg"), NULL, 0).createHMAC(),
+                 bundy::cryptolink::UnsupportedAlgorithm);
+    EXPECT_THROW(TSIGKey(key_name, TSIGKey::HMACSHA256_NAME(), NULL,
+                         0).createHMAC(),
+                 bundy::cryptolink::BadKey);
+}
+
 class TSIGKeyRingTest : public ::testing::Test {
 protected:
     TSIGKeyRingTest() :
@@ -302,6 +346,40 @@ TEST_F(TSIGKeyRingTest, findFromSome) {
               keyring.find(Name("another.example"), sha256_name).key);
 }
 
+TEST_F(TSIGKeyRingTest, findFromMany) {
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(TSIGKeyRing::SUCCESS, keyring.add(
+                      TSIGKey(Name("key" + boost::lexical_cast<string>(i) +
+                                   ".example"),
+                              sha256_name, secret, secret_len)));
+    }
+    EXPECT_EQ(100, keyring.size());
+
+    // Names are compared in a case insensitive manner.
+    for (int i = 0; i < 100; ++i) {
+        const Name name("KEY" + boost::lexical_cast<string>(i) + ".Example");
+        const TSIGKeyRing::FindResult result = keyring.find(name,
+                                                            sha256_name);
+        EXPECT_EQ(TSIGKeyRing::SUCCESS, result.code);
+        EXPECT_EQ(name, result.key->getKeyName());
+    }
+    EXPECT_EQ(TSIGKeyRing::NOTFOUND, keyring.find(Name("key100.example")).code);
+
+    EXPECT_EQ(TSIGKeyRing::SUCCESS, keyring.remove(Name("Key50.example")));
+    EXPECT_EQ(TSIGKeyRing::NOTFOUND, keyring.find(Name("key50.example")).code);
+    EXPECT_EQ(99, keyring.size());
+}
+
+TEST_F(TSIGKeyRingTest, addKeyWithoutSecret) {
+    // A key that can't be used for signing can still be added.
+    EXPECT_EQ(TSIGKeyRing::SUCCESS,
+              keyring.add(TSIGKey(key_name, Name("unknown-alg"), NULL, 0)));
+    EXPECT_EQ(TSIGKeyRing::SUCCESS,
+              keyring.add(TSIGKey(Name("another.example"), sha256_name,
+                                  NULL, 0)));
+    EXPECT_EQ(2, keyring.size());
+}
+
 TEST(TSIGStringTest, TSIGKeyFromToString) {
     TSIGKey k1 = TSIGKey("test.example:MSG6Ng==:hmac-md5.sig-alg.reg.int");
     TSIGKey k2 = TSIGKey("test.example.:MSG6Ng==:hmac-md5.sig-alg.reg.int.");
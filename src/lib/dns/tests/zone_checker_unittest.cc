@@ -27,6 +27,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <algorithm>
@@ -349,4 +350,185 @@ TEST_F(ZoneCheckerTest, checkNSWithDNAME) {
     checkIssues();
 }
 
+// A source of RRsets for the streaming version of checkZone().
+class RRsetSource {
+public:
+    RRsetSource(const std::vector<ConstRRsetPtr>& rrsets) :
+        rrsets_(rrsets), pos_(0)
+    {}
+    ConstRRsetPtr getNext() {
+        if (pos_ == rrsets_.size()) {
+            return (ConstRRsetPtr());
+        }
+        return (rrsets_[pos_++]);
+    }
+private:
+    const std::vector<ConstRRsetPtr> rrsets_;
+    size_t pos_;
+};
+
+ConstRRsetPtr
+copyRRset(const AbstractRRset& rrset) {
+    RRsetPtr copy(new RRset(rrset.getName(), rrset.getClass(),
+                            rrset.getType(), rrset.getTTL()));
+    for (RdataIteratorPtr rit = rrset.getRdataIterator(); !rit->isLast();
+         rit->next()) {
+        copy->addRdata(rit->getCurrent());
+    }
+    return (copy);
+}
+
+// Build the RRsets of a zone from the given master file text, in the
+// order of the text.  The RRs of the same name and type can be split into
+// multiple RRsets with separate lines.
+std::vector<ConstRRsetPtr>
+buildRRsets(const char* const lines[], size_t line_count) {
+    std::vector<ConstRRsetPtr> rrsets;
+    for (size_t i = 0; i < line_count; ++i) {
+        std::stringstream ss(lines[i]);
+        RRsetCollection collection(ss, Name("example.com"), RRClass::IN());
+        rrsets.push_back(copyRRset(*collection.begin()));
+    }
+    return (rrsets);
+}
+
+TEST_F(ZoneCheckerTest, checkStreamed) {
+    // For each zone, the streaming version should give the same result as
+    // the collection version, regardless of the order of the RRsets.
+    const char* const zones[][8] = {
+        // Good zone.
+        { "example.com. 60 IN SOA ns.example.com. root.example.com. "
+          "0 0 0 0 0",
+          "example.com. 60 IN NS ns.example.com.",
+          "ns.example.com. 60 IN A 192.0.2.1",
+          "www.example.com. 60 IN A 192.0.2.2",
+          "www.example.com. 60 IN MX 10 mail.example.com.",
+          "mail.example.com. 60 IN AAAA 2001:db8::1", NULL },
+        // NS names without an address, with a CNAME, and below a DNAME, and
+        // a delegation.
+        { "example.com. 60 IN SOA ns.example.com. root.example.com. "
+          "0 0 0 0 0",
+          "example.com. 60 IN NS ns.example.com.",
+          "example.com. 60 IN NS cname.example.com.",
+          "example.com. 60 IN NS ns.dname.example.com.",
+          "example.com. 60 IN NS ns.child.example.com.",
+          "cname.example.com. 60 IN CNAME ns.example.com.",
+          "dname.example.com. 60 IN DNAME example.org.",
+          "child.example.com. 60 IN NS ns.example.org." },
+        // No SOA, out-of-zone NS name, and the zone origin as an NS name.
+        { "example.com. 60 IN NS ns.example.org.",
+          "example.com. 60 IN NS example.com.",
+          "example.com. 60 IN AAAA 2001:db8::1",
+          "ns.example.org. 60 IN CNAME www.example.org.", NULL },
+        // No NS.
+        { "example.com. 60 IN SOA ns.example.com. root.example.com. "
+          "0 0 0 0 0",
+          "ns.example.com. 60 IN A 192.0.2.1", NULL }
+    };
+    const size_t max_lines = sizeof(zones[0]) / sizeof(zones[0][0]);
+    for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); ++i) {
+        SCOPED_TRACE("zone " + boost::lexical_cast<std::string>(i));
+        size_t line_count = 0;
+        while (line_count < max_lines && zones[i][line_count] != NULL) {
+            ++line_count;
+        }
+        std::stringstream ss;
+        for (size_t j = 0; j < line_count; ++j) {
+            ss << zones[i][j] << "\n";
+        }
+        const RRsetCollection collection(ss, zname_, zclass_);
+        const bool result = checkZone(zname_, zclass_, collection,
+                                      callbacks_);
+        const std::vector<std::string> errors = errors_;
+        const std::vector<std::string> warns = warns_;
+        errors_.clear();
+        warns_.clear();
+
+        std::vector<ConstRRsetPtr> rrsets = buildRRsets(zones[i],
+                                                        line_count);
+        for (int reversed = 0; reversed < 2; ++reversed) {
+            RRsetSource source(rrsets);
+            EXPECT_EQ(result,
+                      checkZone(zname_, zclass_,
+                                boost::bind(&RRsetSource::getNext, &source),
+                                callbacks_));
+            std::sort(errors_.begin(), errors_.end());
+            std::sort(warns_.begin(), warns_.end());
+            std::vector<std::string> sorted_errors = errors;
+            std::vector<std::string> sorted_warns = warns;
+            std::sort(sorted_errors.begin(), sorted_errors.end());
+            std::sort(sorted_warns.begin(), sorted_warns.end());
+            EXPECT_EQ(sorted_errors, errors_);
+            EXPECT_EQ(sorted_warns, warns_);
+            errors_.clear();
+            warns_.clear();
+            std::reverse(rrsets.begin(), rrsets.end());
+        }
+    }
+}
+
+TEST_F(ZoneCheckerTest, checkStreamedSplitRRs) {
+    // The RRs of the same name and type can be given in separate RRsets.
+    const char* const lines[] = {
+        "example.com. 60 IN SOA ns.example.com. root.example.com. 0 0 0 0 0",
+        "example.com. 60 IN NS ns.example.com.",
+        "example.com. 60 IN NS ns2.example.com.",
+        "www.example.com. 60 IN A 192.0.2.3",
+        "ns.example.com. 60 IN A 192.0.2.1",
+        "ns2.example.com. 60 IN AAAA 2001:db8::2",
+        "ns2.example.com. 60 IN AAAA 2001:db8::3"
+    };
+    std::vector<ConstRRsetPtr> rrsets =
+        buildRRsets(lines, sizeof(lines) / sizeof(lines[0]));
+    RRsetSource source(rrsets);
+    EXPECT_TRUE(checkZone(zname_, zclass_,
+                          boost::bind(&RRsetSource::getNext, &source),
+                          callbacks_));
+    checkIssues();
+
+    // Two SOA RRs in separate RRsets are counted together.
+    rrsets.insert(rrsets.begin() + 1, rrsets[0]);
+    RRsetSource source2(rrsets);
+    EXPECT_FALSE(checkZone(zname_, zclass_,
+                           boost::bind(&RRsetSource::getNext, &source2),
+                           callbacks_));
+    expected_errors_.push_back("zone example.com/IN: has 2 SOA records");
+    checkIssues();
+}
+
+TEST_F(ZoneCheckerTest, checkStreamedIgnored) {
+    // RRsets of other classes or out of the zone are ignored.
+    std::vector<ConstRRsetPtr> rrsets;
+    for (RRsetCollection::Iterator it = rrsets_->begin();
+         it != rrsets_->end();
+         ++it) {
+        rrsets.push_back(copyRRset(*it));
+    }
+    RRsetPtr ch_soa(new RRset(zname_, RRClass::CH(), RRType::SOA(),
+                              RRTTL(60)));
+    ch_soa->addRdata(generic::SOA(soa_txt));
+    rrsets.push_back(ch_soa);
+    RRsetPtr ch_cname(new RRset(Name(ns_txt1), RRClass::CH(), RRType::CNAME(),
+                                RRTTL(60)));
+    ch_cname->addRdata(generic::CNAME("www.example.com."));
+    rrsets.push_back(ch_cname);
+    RRsetPtr other_soa(new RRset(Name("example.org"), zclass_, RRType::SOA(),
+                                 RRTTL(60)));
+    other_soa->addRdata(generic::SOA(soa_txt));
+    rrsets.push_back(other_soa);
+
+    RRsetSource source(rrsets);
+    EXPECT_TRUE(checkZone(zname_, zclass_,
+                          boost::bind(&RRsetSource::getNext, &source),
+                          callbacks_));
+    checkIssues();
+
+    // An empty source is a zone without SOA and NS.
+    RRsetSource empty_source((std::vector<ConstRRsetPtr>()));
+    EXPECT_FALSE(checkZone(zname_, zclass_,
+                           boost::bind(&RRsetSource::getNext, &empty_source),
+                           callbacks_));
+    EXPECT_EQ(2, errors_.size());
+}
+
 }
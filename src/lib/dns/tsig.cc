@@ -75,10 +75,7 @@ struct TSIGContext::TSIGContextImpl {
             // it at this moment; a subsequent sign/verify operation will try
             // to create the HMAC, which would also fail.
             try {
-                hmac_.reset(CryptoLink::getCryptoLink().createHMAC(
-                                key_.getSecret(), key_.getSecretLength(),
-                                key_.getAlgorithm()),
-                            deleteHMAC);
+                hmac_ = key_.createHMAC();
             } catch (const bundy::Exception&) {
                 return;
             }
@@ -110,19 +107,16 @@ struct TSIGContext::TSIGContextImpl {
 
     // A shortcut method to create an HMAC object for sign/verify.  If one
     // has been successfully created in the constructor, return it; otherwise
-    // create a new one and return it.  In the former case, the ownership is
-    // transferred to the caller; the stored HMAC will be reset after the
-    // call.
+    // get one from the key (which reuses a prepared object if possible) and
+    // return it.  In the former case, the ownership is transferred to the
+    // caller; the stored HMAC will be reset after the call.
     HMACPtr createHMAC() {
         if (hmac_) {
             HMACPtr ret = HMACPtr();
             ret.swap(hmac_);
             return (ret);
         }
-        return (HMACPtr(CryptoLink::getCryptoLink().createHMAC(
-                            key_.getSecret(), key_.getSecretLength(),
-                            key_.getAlgorithm()),
-                        deleteHMAC));
+        return (key_.createHMAC());
     }
 
     // The following three are helper methods to compute the digest for
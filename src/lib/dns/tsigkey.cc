@@ -12,21 +12,27 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
-#include <map>
 #include <utility>
 #include <vector>
 #include <sstream>
 
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
 #include <exceptions/exceptions.h>
 
 #include <cryptolink/cryptolink.h>
+#include <cryptolink/crypto_hmac.h>
 
+#include <dns/labelsequence.h>
 #include <dns/name.h>
 #include <util/encode/base64.h>
+#include <util/threads/sync.h>
 #include <dns/tsigkey.h>
 
 using namespace std;
 using namespace bundy::cryptolink;
+using bundy::util::thread::Mutex;
 
 namespace bundy {
 namespace dns {
@@ -57,6 +63,66 @@ namespace {
 
         return (bundy::cryptolink::UNKNOWN_HASH);
     }
+
+// The prepared HMAC objects of a key, shared by the copies of the key.
+class HMACPool : boost::noncopyable {
+public:
+    // The maximum number of unused HMAC objects kept in the pool.  It's
+    // large enough for the objects used at the same time by a few threads.
+    static const size_t MAX_HMACS = 16;
+
+    ~HMACPool() {
+        for (size_t i = 0; i < hmacs_.size(); ++i) {
+            deleteHMAC(hmacs_[i]);
+        }
+    }
+
+    // Return an unused object, or NULL if there's none.
+    HMAC* get() {
+        const Mutex::Locker locker(mutex_);
+        if (hmacs_.empty()) {
+            return (NULL);
+        }
+        HMAC* hmac = hmacs_.back();
+        hmacs_.pop_back();
+        return (hmac);
+    }
+
+    // Keep an object that is no longer used, or delete it if the pool is
+    // full.
+    void put(HMAC* hmac) {
+        {
+            const Mutex::Locker locker(mutex_);
+            if (hmacs_.size() < MAX_HMACS) {
+                hmacs_.push_back(hmac);
+                return;
+            }
+        }
+        deleteHMAC(hmac);
+    }
+
+private:
+    vector<HMAC*> hmacs_;
+    Mutex mutex_;
+};
+
+// The deleter of the shared pointers returned by TSIGKey::createHMAC(),
+// which resets the HMAC object and puts it back in the pool.
+class HMACReleaser {
+public:
+    HMACReleaser(const boost::shared_ptr<HMACPool>& pool) : pool_(pool) {}
+    void operator()(HMAC* hmac) const {
+        try {
+            hmac->reset();
+        } catch (const bundy::Exception&) {
+            deleteHMAC(hmac);
+            return;
+        }
+        pool_->put(hmac);
+    }
+private:
+    const boost::shared_ptr<HMACPool> pool_;
+};
 }
 
 struct
@@ -67,7 +133,8 @@ TSIGKey::TSIGKeyImpl {
         key_name_(key_name), algorithm_name_(algorithm_name),
         algorithm_(algorithm),
         secret_(static_cast<const uint8_t*>(secret),
-                static_cast<const uint8_t*>(secret) + secret_len)
+                static_cast<const uint8_t*>(secret) + secret_len),
+        hmac_pool_(new HMACPool)
     {
         // Convert the key and algorithm names to the canonical form.
         key_name_.downcase();
@@ -80,6 +147,8 @@ TSIGKey::TSIGKeyImpl {
     Name algorithm_name_;
     const bundy::cryptolink::HashAlgorithm algorithm_;
     const vector<uint8_t> secret_;
+    // Shared with the copies of the key, which have the same parameters.
+    const boost::shared_ptr<HMACPool> hmac_pool_;
 };
 
 TSIGKey::TSIGKey(const Name& key_name, const Name& algorithm_name,
@@ -194,6 +263,19 @@ TSIGKey::getSecretLength() const {
     return (impl_->secret_.size());
 }
 
+boost::shared_ptr<HMAC>
+TSIGKey::createHMAC() const {
+    HMAC* hmac = impl_->hmac_pool_->get();
+    if (hmac == NULL) {
+        hmac = CryptoLink::getCryptoLink().createHMAC(getSecret(),
+                                                      getSecretLength(),
+                                                      getAlgorithm());
+    }
+    // If the shared pointer fails to be created, the deleter is called for
+    // the object, so it won't leak.
+    return (boost::shared_ptr<HMAC>(hmac, HMACReleaser(impl_->hmac_pool_)));
+}
+
 std::string
 TSIGKey::toText() const {
     const vector<uint8_t> secret_v(static_cast<const uint8_t*>(getSecret()),
@@ -247,8 +329,17 @@ Name& TSIGKey::HMACSHA512_NAME() {
     return (alg_name);
 }
 
+namespace {
+// Key names are compared case-insensitively, so is the hash.
+struct KeyNameHash {
+    size_t operator()(const Name& name) const {
+        return (LabelSequence(name).getFullHash(false, 0));
+    }
+};
+}
+
 struct TSIGKeyRing::TSIGKeyRingImpl {
-    typedef map<Name, TSIGKey> TSIGKeyMap;
+    typedef boost::unordered_map<Name, TSIGKey, KeyNameHash> TSIGKeyMap;
     typedef pair<Name, TSIGKey> NameAndKey;
     TSIGKeyMap keys;
 };
@@ -267,13 +358,21 @@ TSIGKeyRing::size() const {
 
 TSIGKeyRing::Result
 TSIGKeyRing::add(const TSIGKey& key) {
-    if (impl_->keys.insert(
-                TSIGKeyRingImpl::NameAndKey(key.getKeyName(), key)).second
-        == true) {
-        return (SUCCESS);
-    } else {
+    const pair<TSIGKeyRingImpl::TSIGKeyMap::iterator, bool> result =
+        impl_->keys.insert(TSIGKeyRingImpl::NameAndKey(key.getKeyName(),
+                                                       key));
+    if (!result.second) {
         return (EXIST);
     }
+
+    // Prepare an HMAC object for the key, which will be kept in its pool.
+    // A key with an unknown algorithm or an empty secret can't be used for
+    // signing, and it's not an error to have one in the key ring.
+    try {
+        result.first->second.createHMAC();
+    } catch (const bundy::Exception&) {
+    }
+    return (SUCCESS);
 }
 
 TSIGKeyRing::Result
@@ -17,6 +17,8 @@
 
 #include <cryptolink/cryptolink.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace bundy {
 namespace dns {
 
@@ -184,6 +186,30 @@ public:
     const void* getSecret() const;
     //@}
 
+    /// \brief Return an HMAC object keyed with this key.
+    ///
+    /// Creating and keying an HMAC object is relatively expensive compared
+    /// to signing a short DNS message, so the objects are reused: each
+    /// \c TSIGKey (and its copies, including the one stored in a
+    /// \c TSIGKeyRing) has a small pool of prepared HMAC objects.  When
+    /// the returned object is released, it's reset (see
+    /// \c cryptolink::HMAC::reset()) and put back in the pool, and will be
+    /// returned by a later call to this method.
+    ///
+    /// This method is thread safe; the returned object itself must not be
+    /// used by multiple threads at the same time.
+    ///
+    /// \exception cryptolink::UnsupportedAlgorithm The algorithm of the key
+    /// is unknown.
+    /// \exception cryptolink::BadKey The secret is empty.
+    /// \exception cryptolink::LibraryError Some unexpected error in the
+    /// underlying crypto library
+    /// \exception std::bad_alloc Resource allocation failure
+    ///
+    /// \return A shared pointer to an HMAC object ready to sign or verify
+    /// data with this key.
+    boost::shared_ptr<cryptolink::HMAC> createHMAC() const;
+
     /// \brief Converts the TSIGKey to a string value
     ///
     /// The resulting string will be of the form
@@ -226,6 +252,12 @@ private:
 /// algorithms are considered to be the same, and cannot be stored in the
 /// key ring at the same time.
 ///
+/// The keys are stored in a hash table, so finding a key takes constant
+/// time regardless of the number of keys.  An HMAC object is prepared for
+/// each key when it's added (see \c TSIGKey::createHMAC()), so signing or
+/// verifying messages with the keys found in the key ring doesn't have to
+/// set up the crypto state from scratch.
+///
 /// <b>Implementation Note:</b>
 /// For simplicity the initial implementation requests the application make
 /// a copy of keys stored in the key ring if it needs to use the keys for
@@ -19,15 +19,17 @@
 #include <dns/rrclass.h>
 #include <dns/rrtype.h>
 #include <dns/rrset.h>
-#include <dns/rrset_collection_base.h>
+#include <dns/rrset_collection.h>
 
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <string>
+#include <vector>
 
 using boost::lexical_cast;
 using std::string;
+using std::vector;
 
 namespace bundy {
 namespace dns {
@@ -175,12 +177,150 @@ errorWrapper(const string& reason, const ZoneCheckerCallbacks* callbacks,
     *had_error = true;
     callbacks->error(reason);
 }
-}
+
+// A collection of the RRsets given one by one that can be examined by the
+// checks.  Other than the apex SOA and NS, they are the NS and DNAME RRsets
+// at or above the in-zone NS names (for findZoneCut()) and the CNAME, A and
+// AAAA RRsets of the NS names (for checkNSNames()).  As the NS names are
+// unknown until the apex NS is given, RRsets of these types are kept
+// regardless of the names until then.
+class ZoneRRsetFilter {
+public:
+    ZoneRRsetFilter(const Name& zone_name, const RRClass& zone_class) :
+        zone_name_(zone_name), zone_class_(zone_class),
+        apex_ns_found_(false), targets_fixed_(false)
+    {}
+
+    void add(const AbstractRRset& rrset) {
+        if (rrset.getClass() != zone_class_) {
+            return;
+        }
+        const NameComparisonResult::NameRelation reln =
+            rrset.getName().compare(zone_name_).getRelation();
+        if (reln != NameComparisonResult::EQUAL &&
+            reln != NameComparisonResult::SUBDOMAIN) {
+            return;
+        }
+        const bool apex_ns = (reln == NameComparisonResult::EQUAL &&
+                              rrset.getType() == RRType::NS());
+
+        // The RRs of the apex NS are given consecutively, so all the NS
+        // names are known when anything else is given after them.
+        if (apex_ns_found_ && !apex_ns && !targets_fixed_) {
+            fixTargets();
+        }
+        if (isNeeded(rrset, reln == NameComparisonResult::EQUAL)) {
+            merge(rrset);
+        }
+        if (apex_ns) {
+            apex_ns_found_ = true;
+        }
+    }
+
+    const RRsetCollectionBase& getRRsets() const {
+        return (rrsets_);
+    }
+
+private:
+    bool isNeeded(const AbstractRRset& rrset, bool at_apex) const {
+        const RRType& rrtype = rrset.getType();
+        if (at_apex && (rrtype == RRType::SOA() || rrtype == RRType::NS())) {
+            return (true);
+        }
+        const bool cut_type = (rrtype == RRType::NS() ||
+                               rrtype == RRType::DNAME());
+        if (!cut_type && rrtype != RRType::CNAME() &&
+            rrtype != RRType::A() && rrtype != RRType::AAAA()) {
+            return (false);
+        }
+        if (!targets_fixed_) {
+            return (true);
+        }
+        for (vector<Name>::const_iterator it = targets_.begin();
+             it != targets_.end();
+             ++it) {
+            const NameComparisonResult::NameRelation reln =
+                it->compare(rrset.getName()).getRelation();
+            if (reln == NameComparisonResult::EQUAL ||
+                (cut_type && reln == NameComparisonResult::SUBDOMAIN)) {
+                return (true);
+            }
+        }
+        return (false);
+    }
+
+    // Add the RRset to the collection, merging it with the one of the same
+    // name and type if any.
+    void merge(const AbstractRRset& rrset) {
+        RRsetPtr stored = rrsets_.find(rrset.getName(), rrset.getClass(),
+                                       rrset.getType());
+        if (!stored) {
+            stored.reset(new BasicRRset(rrset.getName(), rrset.getClass(),
+                                        rrset.getType(), rrset.getTTL()));
+            rrsets_.addRRset(stored);
+        }
+        for (RdataIteratorPtr rit = rrset.getRdataIterator();
+             !rit->isLast();
+             rit->next()) {
+            stored->addRdata(rit->getCurrent());
+        }
+    }
+
+    // Remember the in-zone NS names, and remove the RRsets kept so far that
+    // turn out to be unnecessary.
+    void fixTargets() {
+        targets_fixed_ = true;
+        const ConstRRsetPtr ns_rrset = rrsets_.find(zone_name_, zone_class_,
+                                                    RRType::NS());
+        assert(ns_rrset);
+        for (RdataIteratorPtr rit = ns_rrset->getRdataIterator();
+             !rit->isLast();
+             rit->next()) {
+            const rdata::generic::NS* ns_data =
+                dynamic_cast<const rdata::generic::NS*>(&rit->getCurrent());
+            if (ns_data == NULL) {
+                continue;       // this will be reported by checkNSNames().
+            }
+            const NameComparisonResult::NameRelation reln =
+                ns_data->getNSName().compare(zone_name_).getRelation();
+            if (reln == NameComparisonResult::EQUAL ||
+                reln == NameComparisonResult::SUBDOMAIN) {
+                targets_.push_back(ns_data->getNSName());
+            }
+        }
+
+        vector<ConstRRsetPtr> unneeded;
+        for (RRsetCollectionBase::Iterator it = rrsets_.begin();
+             it != rrsets_.end();
+             ++it) {
+            const AbstractRRset& rrset = *it;
+            if (!isNeeded(rrset, rrset.getName() == zone_name_)) {
+                unneeded.push_back(rrsets_.find(rrset.getName(),
+                                                rrset.getClass(),
+                                                rrset.getType()));
+            }
+        }
+        for (vector<ConstRRsetPtr>::const_iterator it = unneeded.begin();
+             it != unneeded.end();
+             ++it) {
+            rrsets_.removeRRset((*it)->getName(), (*it)->getClass(),
+                                (*it)->getType());
+        }
+    }
+
+    const Name zone_name_;
+    const RRClass zone_class_;
+    bool apex_ns_found_;
+    bool targets_fixed_;        // whether targets_ are known
+    vector<Name> targets_;      // the in-zone NS names
+    RRsetCollection rrsets_;
+};
 
 bool
-checkZone(const Name& zone_name, const RRClass& zone_class,
-          const RRsetCollectionBase& zone_rrsets,
-          const ZoneCheckerCallbacks& callbacks) {
+checkZoneRRsets(const Name& zone_name, const RRClass& zone_class,
+                const RRsetCollectionBase& zone_rrsets,
+                const ZoneCheckerCallbacks& callbacks)
+{
     bool had_error = false;
     ZoneCheckerCallbacks my_callbacks(
         boost::bind(errorWrapper, _1, &callbacks, &had_error),
@@ -191,6 +331,26 @@ checkZone(const Name& zone_name, const RRClass& zone_class,
 
     return (!had_error);
 }
+}
+
+bool
+checkZone(const Name& zone_name, const RRClass& zone_class,
+          const RRsetCollectionBase& zone_rrsets,
+          const ZoneCheckerCallbacks& callbacks) {
+    return (checkZoneRRsets(zone_name, zone_class, zone_rrsets, callbacks));
+}
+
+bool
+checkZone(const Name& zone_name, const RRClass& zone_class,
+          const ZoneRRsetSource& zone_rrsets,
+          const ZoneCheckerCallbacks& callbacks) {
+    ZoneRRsetFilter filter(zone_name, zone_class);
+    for (ConstRRsetPtr rrset = zone_rrsets(); rrset; rrset = zone_rrsets()) {
+        filter.add(*rrset);
+    }
+    return (checkZoneRRsets(zone_name, zone_class, filter.getRRsets(),
+                            callbacks));
+}
 
 } // end namespace dns
 } // end namespace bundy
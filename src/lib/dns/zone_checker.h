@@ -16,6 +16,7 @@
 #define ZONE_CHECKER_H 1
 
 #include <dns/dns_fwd.h>
+#include <dns/rrset.h>
 
 #include <boost/function.hpp>
 
@@ -153,6 +154,46 @@ checkZone(const Name& zone_name, const RRClass& zone_class,
           const RRsetCollectionBase& zone_rrsets,
           const ZoneCheckerCallbacks& callbacks);
 
+/// \brief A functor type to get the RRsets of a zone one by one.
+///
+/// Each call returns the next RRset of the zone, or \c NULL if all RRsets
+/// have been returned.  For example, the \c getNextRRset() method of a
+/// \c bundy::datasrc::ZoneIterator can be used via \c boost::bind().
+typedef boost::function<ConstRRsetPtr()> ZoneRRsetSource;
+
+/// \brief Perform basic integrity checks on zone RRsets given one by one.
+///
+/// This is the same as the other version of \c checkZone(), except that
+/// the RRsets of the zone are given by \c zone_rrsets one by one, so the
+/// whole zone doesn't have to be stored anywhere.  Only the RRsets that
+/// can be examined by the checks (the apex SOA and NS, and the RRsets at
+/// and above the in-zone NS names) are kept until all RRsets are given,
+/// and the others are discarded immediately.  RRsets that are not of
+/// \c zone_class or not in the zone are ignored.
+///
+/// The RRs of the same owner name and type can be split into multiple
+/// RRsets, but they must be given consecutively.  Until the apex NS RRset
+/// is given, the RRsets of any type that could be needed for the NS names
+/// are kept, so the memory used for the checks is small and bounded only
+/// if the apex NS comes early, which is the case for the iterators of
+/// the data sources and for zone transfers.
+///
+/// \throw Unexpected Conditions that suggest a caller's bug (see the other
+/// version)
+/// \throw std::bad_alloc Internal resource allocation failure
+/// \throw Any exception propagated from \c zone_rrsets
+///
+/// \param zone_name The name of the zone to be checked
+/// \param zone_class The RR class of the zone to be checked
+/// \param zone_rrsets The functor giving the RRsets of the zone
+/// \param callbacks Callback object used to report errors and issues
+///
+/// \return \c true if no critical errors are found; \c false otherwise.
+bool
+checkZone(const Name& zone_name, const RRClass& zone_class,
+          const ZoneRRsetSource& zone_rrsets,
+          const ZoneCheckerCallbacks& callbacks);
+
 } // namespace dns
 } // namespace bundy
 #endif  // ZONE_CHECKER_H
@@ -552,6 +552,20 @@ class MappedSegmentInfo(SegmentInfo):
             'zone-' + str(rrclass) + '-' + str(genid) + '-' + datasrc_name + \
             '-mapped'
 
+        # Options to map the segment, passed with the mapped file (see
+        # ZoneTableSegmentMapped::reset()).  Huge pages matter to the writer
+        # as well, as the pages are allocated when it writes them; the other
+        # options are only for the readers, which switch to new versions.
+        self.__writer_options = {}
+        if mgr_config.get('mapped_segment_huge_pages'):
+            self.__writer_options['huge-pages'] = True
+        self.__reader_options = dict(self.__writer_options)
+        prefault = mgr_config.get('mapped_segment_prefault')
+        if prefault is not None and prefault != 'none':
+            self.__reader_options['prefault'] = prefault
+        if mgr_config.get('mapped_segment_will_need'):
+            self.__reader_options['will-need'] = True
+
         # Current versions (suffix of the mapped files) for readers and the
         # writer.  In this initial implementation we assume that all possible
         # readers are waiting for a new version (not using pre-existing one),
@@ -612,9 +626,14 @@ class MappedSegmentInfo(SegmentInfo):
         if utype == self.READER and not self.__reader_file_validated:
             return {'mapped-file': None}
 
-        ver = self.__reader_ver if utype == self.READER else self.__writer_ver
-        mapped_file = self.__mapped_file_base + '.' + str(ver)
-        return {'mapped-file': mapped_file}
+        if utype == self.READER:
+            ver = self.__reader_ver
+            param = dict(self.__reader_options)
+        else:
+            ver = self.__writer_ver
+            param = dict(self.__writer_options)
+        param['mapped-file'] = self.__mapped_file_base + '.' + str(ver)
+        return param
 
     def _start_validate(self):
         return self.__rvalidate_action, self.__wvalidate_action
@@ -621,6 +621,42 @@ class TestSegmentInfo(unittest.TestCase):
         self.__check_sgmt_reset_param(SegmentInfo.WRITER, 1, sgmt_info)
         self.__check_sgmt_reset_param(SegmentInfo.READER, 0, sgmt_info)
 
+    def test_mapping_options(self):
+        # By default, only the mapped file is passed.
+        self.__sgmt_info._switch_versions()
+        self.assertEqual(['mapped-file'],
+                         list(self.__sgmt_info.get_reset_param(
+                             SegmentInfo.READER).keys()))
+        self.assertEqual(['mapped-file'],
+                         list(self.__sgmt_info.get_reset_param(
+                             SegmentInfo.WRITER).keys()))
+
+        # The options to prefault and advise are passed to readers; huge
+        # pages to the writer, too.
+        sgmt_info = SegmentInfo.create('mapped', 0, RRClass.IN, 'sqlite3',
+                                       {'mapped_file_dir':
+                                            self.__mapped_file_dir,
+                                        'mapped_segment_prefault':
+                                            'background',
+                                        'mapped_segment_will_need': True,
+                                        'mapped_segment_huge_pages': True})
+        sgmt_info._switch_versions()
+        self.assertEqual({'mapped-file': self.__mapped_file_base + '0',
+                          'prefault': 'background', 'will-need': True,
+                          'huge-pages': True},
+                         sgmt_info.get_reset_param(SegmentInfo.READER))
+        self.assertEqual({'mapped-file': self.__mapped_file_base + '1',
+                          'huge-pages': True},
+                         sgmt_info.get_reset_param(SegmentInfo.WRITER))
+
+        # Unless the reader version is usable, no option is passed.
+        sgmt_info = SegmentInfo.create('mapped', 1, RRClass.IN, 'sqlite3',
+                                       {'mapped_file_dir':
+                                            self.__mapped_file_dir,
+                                        'mapped_segment_prefault': 'populate'})
+        self.assertEqual({'mapped-file': None},
+                         sgmt_info.get_reset_param(SegmentInfo.READER))
+
     def test_init_others(self):
         # For local type of segment, information isn't needed and won't be
         # created.
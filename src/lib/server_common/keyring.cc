@@ -24,6 +24,7 @@ namespace server_common {
 typedef boost::shared_ptr<TSIGKeyRing> KeyringPtr;
 
 KeyringPtr keyring;
+util::thread::Mutex keyring_mutex;
 
 namespace {
 
@@ -41,6 +42,7 @@ updateKeyring(const std::string&, ConstElementPtr data,
     for (size_t i(0); list && i < list->size(); ++ i) {
         load->add(TSIGKey(list->get(i)->stringValue()));
     }
+    util::thread::Mutex::Locker locker(keyring_mutex);
     keyring.swap(load);
 }
 
@@ -63,7 +65,10 @@ deinitKeyring(config::ModuleCCSession& session) {
         return;
     }
     LOG_DEBUG(logger, DBG_TRACE_BASIC, SRVCOMM_KEYS_DEINIT);
-    keyring.reset();
+    {
+        util::thread::Mutex::Locker locker(keyring_mutex);
+        keyring.reset();
+    }
     session.removeRemoteConfig("tsig_keys");
 }
 
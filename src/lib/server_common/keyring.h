@@ -18,6 +18,7 @@
 #include <boost/shared_ptr.hpp>
 #include <dns/tsigkey.h>
 #include <config/ccsession.h>
+#include <util/threads/sync.h>
 
 /**
  * \file keyring.h
@@ -57,6 +58,17 @@ namespace server_common {
  */
 extern boost::shared_ptr<dns::TSIGKeyRing> keyring;
 
+/**
+ * \brief Mutex protecting the key ring pointer
+ *
+ * The key ring is replaced in the thread that handles the configuration
+ * session while holding this mutex.  Applications that use the key ring
+ * from other threads must also hold it while making their own copy of
+ * the \c keyring pointer (they don't have to keep holding it while using
+ * the copy).
+ */
+extern util::thread::Mutex keyring_mutex;
+
 /**
  * \brief Load the key ring for the first time
  *
@@ -76,6 +76,25 @@ public:
         }
         return (counters_.at(type));
     }
+
+    /// \brief Add the values of all counter items of another counter.
+    ///
+    /// This is useful to aggregate counters that are incremented
+    /// separately, e.g., one per thread, to avoid locking on every update.
+    ///
+    /// \param other %Counter whose values are added to this one
+    ///
+    /// \throw bundy::InvalidParameter the number of items of \a other
+    /// differs from that of this counter
+    void add(const Counter& other) {
+        if (other.counters_.size() != counters_.size()) {
+            bundy_throw(bundy::InvalidParameter,
+                        "Counters of different sizes can't be added");
+        }
+        for (size_t i = 0; i < counters_.size(); ++i) {
+            counters_[i] += other.counters_[i];
+        }
+    }
 };
 
 }   // namespace statistics
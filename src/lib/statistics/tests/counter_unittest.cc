@@ -88,3 +88,23 @@ TEST_F(CounterTest, invalidCounterItem) {
     // exception
     EXPECT_THROW(counter.get(NUMBER_OF_ITEMS), bundy::OutOfRange);
 }
+
+TEST_F(CounterTest, addCounter) {
+    Counter other(NUMBER_OF_ITEMS);
+    counter.inc(ITEM1);
+    other.inc(ITEM1);
+    other.inc(ITEM3);
+    other.inc(ITEM3);
+
+    counter.add(other);
+    EXPECT_EQ(2, counter.get(ITEM1));
+    EXPECT_EQ(0, counter.get(ITEM2));
+    EXPECT_EQ(2, counter.get(ITEM3));
+    // The other counter isn't changed
+    EXPECT_EQ(1, other.get(ITEM1));
+    EXPECT_EQ(2, other.get(ITEM3));
+
+    // Counters of different sizes can't be added
+    Counter larger(NUMBER_OF_ITEMS + 1);
+    EXPECT_THROW(counter.add(larger), bundy::InvalidParameter);
+}
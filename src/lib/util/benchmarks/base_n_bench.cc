@@ -0,0 +1,198 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <util/encode/base32hex.h>
+#include <util/encode/base64.h>
+#include <util/encode/hex.h>
+#include <util/encode/base_n_internal.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::util::encode;
+using namespace bundy::util::encode::internal;
+
+namespace {
+typedef string (*EncodeFunc)(const vector<uint8_t>&);
+typedef void (*DecodeFunc)(const string&, vector<uint8_t>&);
+
+// Encode each of the given data.
+class EncodeBenchMark {
+public:
+    EncodeBenchMark(const vector<vector<uint8_t> >& data, EncodeFunc func) :
+        data_(data), func_(func), length_(0)
+    {}
+    unsigned int run() {
+        for (size_t i = 0; i < data_.size(); ++i) {
+            length_ += func_(data_[i]).size();
+        }
+        return (data_.size());
+    }
+private:
+    const vector<vector<uint8_t> >& data_;
+    const EncodeFunc func_;
+    size_t length_;             // so the encoding is not optimized away
+};
+
+// Decode each of the given texts.
+class DecodeBenchMark {
+public:
+    DecodeBenchMark(const vector<string>& texts, DecodeFunc func) :
+        texts_(texts), func_(func), length_(0)
+    {}
+    unsigned int run() {
+        for (size_t i = 0; i < texts_.size(); ++i) {
+            func_(texts_[i], result_);
+            length_ += result_.size();
+        }
+        return (texts_.size());
+    }
+private:
+    const vector<string>& texts_;
+    const DecodeFunc func_;
+    vector<uint8_t> result_;
+    size_t length_;
+};
+
+// The data sets: binary data of a typical size for each encoding, and
+// their encoded texts, optionally split into words separated by spaces as
+// in zone files.
+struct DataSet {
+    const char* description;
+    EncodeFunc encode;
+    DecodeFunc decode;
+    size_t data_len;
+    size_t word_len;            // 0 means no spaces
+};
+
+const DataSet data_sets[] = {
+    { "base64, RSA/SHA-256 signature (256 bytes)",
+      encodeBase64, decodeBase64, 256, 0 },
+    { "base64, RSA/SHA-256 signature (256 bytes) split into words",
+      encodeBase64, decodeBase64, 256, 44 },
+    { "base64, TSIG secret (32 bytes)", encodeBase64, decodeBase64, 32, 0 },
+    { "base32hex, NSEC3 hash (20 bytes)",
+      encodeBase32Hex, decodeBase32Hex, 20, 0 },
+    { "base16, SHA-256 DS digest (32 bytes)", encodeHex, decodeHex, 32, 0 }
+};
+
+void
+generateData(const DataSet& data_set, size_t count,
+             vector<vector<uint8_t> >& data, vector<string>& texts)
+{
+    for (size_t i = 0; i < count; ++i) {
+        vector<uint8_t> binary(data_set.data_len);
+        for (size_t j = 0; j < binary.size(); ++j) {
+            binary[j] = (i * 131 + j * 17) & 0xff;
+        }
+        string text = data_set.encode(binary);
+        if (data_set.word_len > 0) {
+            for (size_t pos = data_set.word_len; pos < text.size();
+                 pos += data_set.word_len + 1) {
+                text.insert(pos, 1, ' ');
+            }
+        }
+        data.push_back(binary);
+        texts.push_back(text);
+    }
+}
+
+const char*
+getImplName(CodecImpl impl) {
+    switch (impl) {
+    case CODEC_REFERENCE:
+        return ("reference");
+    case CODEC_SCALAR:
+        return ("scalar");
+    case CODEC_SSSE3:
+        return ("SSSE3");
+    case CODEC_AVX2:
+        return ("AVX2");
+    }
+    return ("unknown");
+}
+
+void
+usage() {
+    cerr << "Usage: base_n_bench [-n iterations] [-s set_size]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000;
+    int set_size = 1000;
+    while ((ch = getopt(argc, argv, "n:s:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            set_size = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || set_size <= 0) {
+        usage();
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Set size: " << set_size << endl;
+    cout << "  Default implementation: " << getImplName(getCodecImpl())
+         << endl;
+
+    const CodecImpl impls[] = { CODEC_REFERENCE, CODEC_SCALAR, CODEC_SSSE3,
+                                CODEC_AVX2 };
+    for (size_t i = 0; i < sizeof(data_sets) / sizeof(data_sets[0]); ++i) {
+        vector<vector<uint8_t> > data;
+        vector<string> texts;
+        generateData(data_sets[i], set_size, data, texts);
+
+        for (size_t j = 0; j < sizeof(impls) / sizeof(impls[0]); ++j) {
+            if (!selectCodecImpl(impls[j])) {
+                cout << "Implementation " << getImplName(impls[j])
+                     << " is not available" << endl;
+                continue;
+            }
+            cout << "Benchmark for encoding " << data_sets[i].description
+                 << " with the " << getImplName(impls[j])
+                 << " implementation" << endl;
+            BenchMark<EncodeBenchMark>(
+                iteration, EncodeBenchMark(data, data_sets[i].encode));
+
+            cout << "Benchmark for decoding " << data_sets[i].description
+                 << " with the " << getImplName(impls[j])
+                 << " implementation" << endl;
+            BenchMark<DecodeBenchMark>(
+                iteration, DecodeBenchMark(texts, data_sets[i].decode));
+        }
+    }
+
+    return (0);
+}
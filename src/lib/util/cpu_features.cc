@@ -0,0 +1,63 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/cpu_features.h>
+
+#include <pthread.h>
+
+namespace bundy {
+namespace util {
+
+namespace {
+// Statically initialized, so it's usable during static initialization.
+pthread_mutex_t selection_mutex = PTHREAD_MUTEX_INITIALIZER;
+}
+
+bool
+hasCPUFeature(CPUFeature feature) {
+    switch (feature) {
+#ifdef BUNDY_CPU_SSE2
+    case CPU_SSE2:
+        // It's part of the compiler's target, so it's always supported.
+        return (true);
+#endif
+#ifdef BUNDY_CPU_SSSE3
+    case CPU_SSSE3:
+        // This can be called before the static initialization of the
+        // library that sets up __builtin_cpu_supports().
+        __builtin_cpu_init();
+        return (__builtin_cpu_supports("ssse3"));
+#endif
+#ifdef BUNDY_CPU_AVX2
+    case CPU_AVX2:
+        __builtin_cpu_init();
+        return (__builtin_cpu_supports("avx2"));
+#endif
+    default:
+        return (false);
+    }
+}
+
+namespace internal {
+ImplSelectionLocker::ImplSelectionLocker() {
+    pthread_mutex_lock(&selection_mutex);
+}
+
+ImplSelectionLocker::~ImplSelectionLocker() {
+    pthread_mutex_unlock(&selection_mutex);
+}
+}
+
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,135 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_UTIL_CPU_FEATURES_H
+#define BUNDY_UTIL_CPU_FEATURES_H 1
+
+/// \file cpu_features.h
+/// \brief Support for code vectorized for specific processor features.
+///
+/// Some performance critical functions (such as name comparison and the
+/// baseN codecs) have alternative implementations using SIMD instructions.
+/// They are built with the compiler intrinsics and the target attribute, so
+/// the library doesn't require these instructions, and the best one is
+/// selected at run time with the definitions of this file.
+///
+/// The following macros are defined if the implementations for the
+/// corresponding instruction sets can be built.  As they rely on GCC (or
+/// compatible) extensions and the x86 intrinsics, they are never defined
+/// for other compilers and processors.
+/// - \c BUNDY_CPU_SSE2: SSE2 is part of the compiler's target, so it can
+///   be used without the target attribute (\c <emmintrin.h>).
+/// - \c BUNDY_CPU_SSSE3 and \c BUNDY_CPU_AVX2: the compiler supports the
+///   target attribute for them (\c <immintrin.h>).
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BUNDY_CPU_SSE2 1
+#if (defined(__clang__) && __clang_major__ >= 4) || \
+    (!defined(__clang__) && \
+     (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define BUNDY_CPU_SSSE3 1
+#define BUNDY_CPU_AVX2 1
+#endif
+#endif
+
+namespace bundy {
+namespace util {
+
+/// \brief The processor features used by the vectorized implementations.
+enum CPUFeature {
+    CPU_SSE2,
+    CPU_SSSE3,
+    CPU_AVX2
+};
+
+/// \brief Return whether the running processor supports the given feature.
+///
+/// This returns false for a feature whose \c BUNDY_CPU_xxx macro isn't
+/// defined, even if the processor supports it.  It's thread safe, and can
+/// be called during the static initialization of any translation unit.
+bool hasCPUFeature(CPUFeature feature);
+
+namespace internal {
+/// \brief Serialize the first selection of all \c ImplSelector objects.
+///
+/// This is an internal helper of \c ImplSelector; the lock is a statically
+/// initialized pthread mutex.
+class ImplSelectionLocker {
+public:
+    ImplSelectionLocker();
+    ~ImplSelectionLocker();
+private:
+    ImplSelectionLocker(const ImplSelectionLocker&);
+    ImplSelectionLocker& operator=(const ImplSelectionLocker&);
+};
+}
+
+/// \brief The implementation of an algorithm selected for the processor.
+///
+/// A module having several implementations of an algorithm defines an
+/// object of this class at namespace scope, and gets the implementation to
+/// use with \c get(), passing a function that selects the best one for the
+/// running processor (usually with \c hasCPUFeature()).  The function is
+/// called only on the first use, exactly once even if multiple threads
+/// call \c get() at the same time.  After that, \c get() is a single
+/// atomic load.
+///
+/// \c T must be a type that can be handled by the atomic builtins of the
+/// compiler, such as an enum or a pointer to a table of the functions of
+/// the implementation.
+///
+/// The class deliberately has no constructor, so the object is zero
+/// initialized (i.e., unselected) before any dynamic initialization takes
+/// place, and can be used during the static initialization of other
+/// translation units.
+template <typename T>
+class ImplSelector {
+public:
+    /// \brief Return the selected implementation, selecting it with the
+    /// given function on the first use.
+    T get(T (*select)()) {
+        if (!__atomic_load_n(&selected_, __ATOMIC_ACQUIRE)) {
+            const internal::ImplSelectionLocker locker;
+            if (!__atomic_load_n(&selected_, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&value_, select(), __ATOMIC_RELAXED);
+                __atomic_store_n(&selected_, true, __ATOMIC_RELEASE);
+            }
+        }
+        return (__atomic_load_n(&value_, __ATOMIC_RELAXED));
+    }
+
+    /// \brief Replace the selected implementation.
+    ///
+    /// This is intended for tests and benchmarks.  It's safe to call it
+    /// while other threads call \c get(), but they may use either of the
+    /// implementations for a while.
+    void set(T value) {
+        const internal::ImplSelectionLocker locker;
+        __atomic_store_n(&value_, value, __ATOMIC_RELAXED);
+        __atomic_store_n(&selected_, true, __ATOMIC_RELEASE);
+    }
+
+private:
+    bool selected_;
+    T value_;
+};
+
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_UTIL_CPU_FEATURES_H
+
+// Local Variables:
+// mode: c++
+// End:
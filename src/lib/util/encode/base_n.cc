@@ -18,6 +18,7 @@
 #include <util/encode/binary_from_base16.h>
 #include <util/encode/base32hex.h>
 #include <util/encode/base64.h>
+#include <util/encode/base_n_internal.h>
 
 #include <exceptions/exceptions.h>
 
@@ -35,6 +36,9 @@
 
 using namespace std;
 using namespace boost::archive::iterators;
+using bundy::util::encode::internal::CodecImpl;
+using bundy::util::encode::internal::CODEC_REFERENCE;
+using bundy::util::encode::internal::getCodecImpl;
 
 namespace bundy {
 namespace util {
@@ -95,6 +99,12 @@ class IncompleteBaseInput : public std::exception {
 //
 // Below, we define a set of templated classes to handle different parameters
 // for different encoding algorithms.
+//
+// This implementation handles one bit group at a time through several
+// layers of iterators, which is slow for large data like DNSSEC keys and
+// signatures.  It's kept as the reference implementation (CODEC_REFERENCE);
+// the public functions use the faster implementations in base_n_fast.cc
+// unless it's explicitly selected (see base_n_internal.h).
 namespace {
 // Common constants used for all baseN encoding.
 const char BASE_PADDING_CHAR = '=';
@@ -445,32 +455,59 @@ Base16Transformer;
 
 string
 encodeBase64(const vector<uint8_t>& binary) {
-    return (Base64Transformer::encode(binary));
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        return (Base64Transformer::encode(binary));
+    }
+    return (internal::encodeBase64Fast(binary, impl));
 }
 
 void
 decodeBase64(const string& input, vector<uint8_t>& result) {
-    Base64Transformer::decode("base64", input, result);
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        Base64Transformer::decode("base64", input, result);
+    } else {
+        internal::decodeBase64Fast(input, result, impl);
+    }
 }
 
 string
 encodeBase32Hex(const vector<uint8_t>& binary) {
-    return (Base32HexTransformer::encode(binary));
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        return (Base32HexTransformer::encode(binary));
+    }
+    return (internal::encodeBase32HexFast(binary, impl));
 }
 
 void
 decodeBase32Hex(const string& input, vector<uint8_t>& result) {
-    Base32HexTransformer::decode("base32hex", input, result);
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        Base32HexTransformer::decode("base32hex", input, result);
+    } else {
+        internal::decodeBase32HexFast(input, result, impl);
+    }
 }
 
 string
 encodeHex(const vector<uint8_t>& binary) {
-    return (Base16Transformer::encode(binary));
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        return (Base16Transformer::encode(binary));
+    }
+    return (internal::encodeHexFast(binary, impl));
 }
 
 void
 decodeHex(const string& input, vector<uint8_t>& result) {
-    Base16Transformer::decode("base16", input, result);
+    const CodecImpl impl = getCodecImpl();
+    if (impl == CODEC_REFERENCE) {
+        Base16Transformer::decode("base16", input, result);
+    } else {
+        internal::decodeHexFast(input, result, impl);
+    }
 }
 
 } // namespace encode
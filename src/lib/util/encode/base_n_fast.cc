@@ -0,0 +1,788 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/encode/base_n_internal.h>
+#include <util/cpu_features.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/math/common_factor.hpp>
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+// The SSE2 kernels for base16 are used by both the SSSE3 and AVX2
+// implementations.
+#ifdef BUNDY_CPU_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef BUNDY_CPU_SSSE3
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace bundy {
+namespace util {
+namespace encode {
+namespace internal {
+
+namespace {
+// The encoded characters, and the decoded values of characters: the value
+// for valid characters (in upper or lower case for base32hex and base16),
+// CODE_SPACE for spaces (as isspace() in the C locale), CODE_PAD for
+// the padding character, and CODE_INVALID for the others.
+const int8_t CODE_INVALID = -1;
+const int8_t CODE_SPACE = -2;
+const int8_t CODE_PAD = -3;
+
+const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char BASE32HEX_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+const char BASE16_CHARS[] = "0123456789ABCDEF";
+
+const int8_t BASE64_DECODE_TABLE[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-2,-2,-2,-2,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,
+    52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-3,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,
+    15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
+    -1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,
+    41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+};
+
+const int8_t BASE32HEX_DECODE_TABLE[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-2,-2,-2,-2,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-3,-1,-1,
+    -1,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,
+    25,26,27,28,29,30,31,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,
+    25,26,27,28,29,30,31,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+};
+
+const int8_t BASE16_DECODE_TABLE[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-2,-2,-2,-2,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-3,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+};
+
+// The kernels encode or decode as many complete groups (e.g. 3 bytes and
+// 4 characters for base64) as possible from the beginning of the input,
+// and return the number of bytes or characters processed.  The decode
+// kernels stop at the first group containing a character other than the
+// valid ones; those are handled by the generic code.  The vectorized
+// decode kernels store up to DECODE_SLACK bytes beyond the decoded data.
+typedef size_t (*EncodeKernel)(const uint8_t* data, size_t len, char* out);
+typedef size_t (*DecodeKernel)(const uint8_t* input, size_t len,
+                               uint8_t* out);
+const size_t DECODE_SLACK = 8;
+
+//
+// Scalar kernels
+//
+size_t
+encodeBase64Scalar(const uint8_t* data, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3, out += 4) {
+        const uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out[0] = BASE64_CHARS[v >> 18];
+        out[1] = BASE64_CHARS[(v >> 12) & 0x3f];
+        out[2] = BASE64_CHARS[(v >> 6) & 0x3f];
+        out[3] = BASE64_CHARS[v & 0x3f];
+    }
+    return (i);
+}
+
+size_t
+decodeBase64Scalar(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4, out += 3) {
+        const int a = BASE64_DECODE_TABLE[input[i]];
+        const int b = BASE64_DECODE_TABLE[input[i + 1]];
+        const int c = BASE64_DECODE_TABLE[input[i + 2]];
+        const int d = BASE64_DECODE_TABLE[input[i + 3]];
+        if ((a | b | c | d) < 0) {
+            break;
+        }
+        const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = v >> 16;
+        out[1] = v >> 8;
+        out[2] = v;
+    }
+    return (i);
+}
+
+size_t
+encodeBase32HexScalar(const uint8_t* data, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 5 <= len; i += 5, out += 8) {
+        const uint64_t v = (static_cast<uint64_t>(data[i]) << 32) |
+            (static_cast<uint32_t>(data[i + 1]) << 24) | (data[i + 2] << 16) |
+            (data[i + 3] << 8) | data[i + 4];
+        for (int j = 0; j < 8; ++j) {
+            out[j] = BASE32HEX_CHARS[(v >> (35 - j * 5)) & 0x1f];
+        }
+    }
+    return (i);
+}
+
+size_t
+decodeBase32HexScalar(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8, out += 5) {
+        uint64_t v = 0;
+        int valid = 0;
+        for (int j = 0; j < 8; ++j) {
+            const int code = BASE32HEX_DECODE_TABLE[input[i + j]];
+            valid |= code;
+            v = (v << 5) | (code & 0x1f);
+        }
+        if (valid < 0) {
+            break;
+        }
+        for (int j = 0; j < 5; ++j) {
+            out[j] = v >> (32 - j * 8);
+        }
+    }
+    return (i);
+}
+
+size_t
+encodeBase16Scalar(const uint8_t* data, size_t len, char* out) {
+    for (size_t i = 0; i < len; ++i, out += 2) {
+        out[0] = BASE16_CHARS[data[i] >> 4];
+        out[1] = BASE16_CHARS[data[i] & 0x0f];
+    }
+    return (len);
+}
+
+size_t
+decodeBase16Scalar(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 2 <= len; i += 2, ++out) {
+        const int hi = BASE16_DECODE_TABLE[input[i]];
+        const int lo = BASE16_DECODE_TABLE[input[i + 1]];
+        if ((hi | lo) < 0) {
+            break;
+        }
+        *out = (hi << 4) | lo;
+    }
+    return (i);
+}
+
+#ifdef BUNDY_CPU_SSE2
+//
+// SSE2 kernels for base16
+//
+inline __m128i
+toBase16Chars(__m128i nibbles) {
+    // '0' + n for 0-9, 'A' + n - 10 = '0' + n + 7 for 10-15.
+    const __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    return (_mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+                         _mm_and_si128(letters, _mm_set1_epi8(7))));
+}
+
+size_t
+encodeBase16SSE2(const uint8_t* data, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, out += 32) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        const __m128i lo = _mm_and_si128(v, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         toBase16Chars(_mm_unpacklo_epi8(hi, lo)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16),
+                         toBase16Chars(_mm_unpackhi_epi8(hi, lo)));
+    }
+    return (i + encodeBase16Scalar(data + i, len - i, out));
+}
+
+// Decode 16 characters into 16 nibbles (one per 16-bit word) in bytes
+// combined as described below.  Return the bitmask of valid characters.
+inline unsigned int
+decodeBase16x16(__m128i chars, __m128i& bytes) {
+    // Unsigned x < n is checked as signed (x ^ 0x80) < (n ^ 0x80).
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i is_digit =
+        _mm_cmplt_epi8(_mm_xor_si128(digits, bias), _mm_set1_epi8(-0x80 + 10));
+    const __m128i letters =
+        _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                     _mm_set1_epi8('a'));
+    const __m128i is_letter =
+        _mm_cmplt_epi8(_mm_xor_si128(letters, bias), _mm_set1_epi8(-0x80 + 6));
+    const __m128i nibbles =
+        _mm_or_si128(_mm_and_si128(is_digit, digits),
+                     _mm_and_si128(is_letter,
+                                   _mm_add_epi8(letters, _mm_set1_epi8(10))));
+    // Each 16-bit word has the higher nibble in the lower byte.
+    bytes = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4),
+        _mm_srli_epi16(nibbles, 8));
+    return (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)));
+}
+
+size_t
+decodeBase16SSE2(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, out += 16) {
+        __m128i bytes1, bytes2;
+        const unsigned int valid1 = decodeBase16x16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)),
+            bytes1);
+        const unsigned int valid2 = decodeBase16x16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 16)),
+            bytes2);
+        if ((valid1 & valid2) != 0xffff) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_packus_epi16(bytes1, bytes2));
+    }
+    return (i + decodeBase16Scalar(input + i, len - i, out));
+}
+#endif
+
+#ifdef BUNDY_CPU_SSSE3
+//
+// SSSE3 kernels for base64.  See http://0x80.pl/articles/index.html#base64
+// (by Wojciech Mula) for the algorithms.
+//
+// Convert 16 6-bit values into base64 characters: the value is classified
+// into the ranges A-Z, a-z, 0-9, + and /, and each range is converted by
+// adding an offset taken from a table.
+__attribute__((target("ssse3"))) inline __m128i
+toBase64Chars(__m128i values) {
+    __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+    index = _mm_or_si128(index, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return (_mm_add_epi8(values, _mm_shuffle_epi8(offsets, index)));
+}
+
+// Split 12 bytes (in the lower part of the vector) into 16 6-bit values.
+__attribute__((target("ssse3"))) inline __m128i
+toBase64Values(__m128i bytes) {
+    // Arrange bytes b0, b1, b2 of each group in 32 bits as b1, b0, b2, b1;
+    // then the 16-bit words contain the bits for two values each.  Those
+    // are moved into place with multiplications.
+    bytes = _mm_shuffle_epi8(bytes, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                                  7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i values02 =
+        _mm_mulhi_epu16(_mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)),
+                        _mm_set1_epi32(0x04000040));
+    const __m128i values13 =
+        _mm_mullo_epi16(_mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)),
+                        _mm_set1_epi32(0x01000010));
+    return (_mm_or_si128(values02, values13));
+}
+
+__attribute__((target("ssse3"))) size_t
+encodeBase64SSSE3(const uint8_t* data, size_t len, char* out) {
+    size_t i = 0;
+    // Each iteration reads 16 bytes, of which 12 are encoded.
+    for (; i + 16 <= len; i += 12, out += 16) {
+        const __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         toBase64Chars(toBase64Values(bytes)));
+    }
+    return (i + encodeBase64Scalar(data + i, len - i, out));
+}
+
+// Convert 16 base64 characters into 6-bit values (one per byte).  Return
+// the bitmask of valid characters.  The characters are classified by their
+// higher and lower nibbles, using tables with a bit for each class of
+// invalid characters (an invalid character has a bit set in both), and
+// a valid character is converted by adding an offset selected by the
+// higher nibble ('/' is special as it shares the nibble with '+').
+__attribute__((target("ssse3"))) inline unsigned int
+fromBase64Chars(__m128i chars, __m128i& values) {
+    const __m128i hi_nibbles =
+        _mm_and_si128(_mm_srli_epi32(chars, 4), _mm_set1_epi8(0x0f));
+    const __m128i lo_nibbles = _mm_and_si128(chars, _mm_set1_epi8(0x0f));
+    const __m128i lo_classes = _mm_shuffle_epi8(
+        _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a),
+        lo_nibbles);
+    const __m128i hi_classes = _mm_shuffle_epi8(
+        _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),
+        hi_nibbles);
+    const __m128i invalid = _mm_and_si128(lo_classes, hi_classes);
+    const __m128i slashes = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+    const __m128i offsets = _mm_shuffle_epi8(
+        _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                      0, 0, 0, 0, 0, 0, 0, 0),
+        _mm_add_epi8(slashes, hi_nibbles));
+    values = _mm_add_epi8(chars, offsets);
+    return (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())));
+}
+
+// Combine 16 6-bit values into 12 bytes (in the lower part of the
+// vector).
+__attribute__((target("ssse3"))) inline __m128i
+fromBase64Values(__m128i values) {
+    const __m128i merged =
+        _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)),
+                       _mm_set1_epi32(0x00011000));
+    return (_mm_shuffle_epi8(merged,
+                             _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                           14, 13, 12, -1, -1, -1, -1)));
+}
+
+__attribute__((target("ssse3"))) size_t
+decodeBase64SSSE3(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    // Each iteration stores 16 bytes, of which 12 are decoded.
+    for (; i + 16 <= len; i += 16, out += 12) {
+        __m128i values;
+        const unsigned int valid = fromBase64Chars(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)),
+            values);
+        if (valid != 0xffff) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         fromBase64Values(values));
+    }
+    return (i + decodeBase64Scalar(input + i, len - i, out));
+}
+#endif
+
+#ifdef BUNDY_CPU_AVX2
+//
+// AVX2 kernels for base64.  These are the 256-bit versions of the SSSE3
+// kernels; since shuffles work within each 128-bit lane, the input
+// (for encoding) or the output (for decoding) is split between the lanes.
+//
+__attribute__((target("avx2"))) size_t
+encodeBase64AVX2(const uint8_t* data, size_t len, char* out) {
+    size_t i = 0;
+    // Each iteration reads 28 bytes, of which 24 are encoded.
+    for (; i + 28 <= len; i += 24, out += 32) {
+        __m256i bytes = _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        bytes = _mm256_inserti128_si256(
+            bytes,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12)),
+            1);
+        bytes = _mm256_shuffle_epi8(
+            bytes, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                    7, 6, 8, 7, 10, 9, 11, 10,
+                                    1, 0, 2, 1, 4, 3, 5, 4,
+                                    7, 6, 8, 7, 10, 9, 11, 10));
+        const __m256i values = _mm256_or_si256(
+            _mm256_mulhi_epu16(
+                _mm256_and_si256(bytes, _mm256_set1_epi32(0x0fc0fc00)),
+                _mm256_set1_epi32(0x04000040)),
+            _mm256_mullo_epi16(
+                _mm256_and_si256(bytes, _mm256_set1_epi32(0x003f03f0)),
+                _mm256_set1_epi32(0x01000010)));
+        __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+        index = _mm256_or_si256(index,
+                                _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        const __m256i offsets = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A', 0, 0);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out),
+            _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, index)));
+    }
+    // Avoid the penalty of transitions to the legacy SSE code (compilers
+    // don't always do this for functions with the target attribute).
+    _mm256_zeroupper();
+    return (i + encodeBase64SSSE3(data + i, len - i, out));
+}
+
+__attribute__((target("avx2"))) size_t
+decodeBase64AVX2(const uint8_t* input, size_t len, uint8_t* out) {
+    size_t i = 0;
+    // Each iteration stores 32 bytes, of which 24 are decoded.
+    for (; i + 32 <= len; i += 32, out += 24) {
+        const __m256i chars =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        const __m256i hi_nibbles = _mm256_and_si256(
+            _mm256_srli_epi32(chars, 4), _mm256_set1_epi8(0x0f));
+        const __m256i lo_nibbles =
+            _mm256_and_si256(chars, _mm256_set1_epi8(0x0f));
+        const __m256i lo_classes = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                             0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                             0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                             0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a),
+            lo_nibbles);
+        const __m256i hi_classes = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                             0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),
+            hi_nibbles);
+        const __m256i invalid = _mm256_and_si256(lo_classes, hi_classes);
+        if (!_mm256_testz_si256(invalid, invalid)) {
+            break;
+        }
+        const __m256i slashes =
+            _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('/'));
+        const __m256i offsets = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                             0, 0, 0, 0, 0, 0, 0, 0,
+                             0, 16, 19, 4, -65, -65, -71, -71,
+                             0, 0, 0, 0, 0, 0, 0, 0),
+            _mm256_add_epi8(slashes, hi_nibbles));
+        const __m256i values = _mm256_add_epi8(chars, offsets);
+        const __m256i merged = _mm256_madd_epi16(
+            _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+            _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_shuffle_epi8(
+            merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                     14, 13, 12, -1, -1, -1, -1,
+                                     2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                     14, 13, 12, -1, -1, -1, -1));
+        // Move the 12 bytes of the upper lane next to those of the lower.
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out),
+            _mm256_permutevar8x32_epi32(
+                packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)));
+    }
+    _mm256_zeroupper();
+    return (i + decodeBase64SSSE3(input + i, len - i, out));
+}
+#endif
+
+struct Kernels {
+    Kernels(EncodeKernel encode_kernel, DecodeKernel decode_kernel) :
+        encode(encode_kernel), decode(decode_kernel)
+    {}
+    EncodeKernel encode;
+    DecodeKernel decode;
+};
+
+Kernels
+getBase64Kernels(CodecImpl impl) {
+    switch (impl) {
+#ifdef BUNDY_CPU_SSSE3
+    case CODEC_SSSE3:
+        return (Kernels(encodeBase64SSSE3, decodeBase64SSSE3));
+#endif
+#ifdef BUNDY_CPU_AVX2
+    case CODEC_AVX2:
+        return (Kernels(encodeBase64AVX2, decodeBase64AVX2));
+#endif
+    default:
+        return (Kernels(encodeBase64Scalar, decodeBase64Scalar));
+    }
+}
+
+Kernels
+getBase16Kernels(CodecImpl impl) {
+#ifdef BUNDY_CPU_SSE2
+    if (impl == CODEC_SSSE3 || impl == CODEC_AVX2) {
+        return (Kernels(encodeBase16SSE2, decodeBase16SSE2));
+    }
+#endif
+    return (Kernels(encodeBase16Scalar, decodeBase16Scalar));
+}
+
+// The generic part of the encoding and decoding, which handles the input
+// that the kernels can't handle.  See base_n.cc for the details of the
+// parameters, padding and validation, which must be the same as the
+// reference implementation.
+template <int BitsPerChunk>
+struct FastTransformer {
+    static const int BITS_PER_GROUP =
+        boost::math::static_lcm<BitsPerChunk, 8>::value;
+    static const int BYTES_PER_GROUP = BITS_PER_GROUP / 8;
+    static const int CHARS_PER_GROUP = BITS_PER_GROUP / BitsPerChunk;
+    static const int MAX_PADDING_CHARS =
+        CHARS_PER_GROUP - (8 / BitsPerChunk + ((8 % BitsPerChunk) == 0 ?
+                                               0 : 1));
+    static const uint32_t CHUNK_MASK = (1 << BitsPerChunk) - 1;
+
+    static string encode(const vector<uint8_t>& binary, const char* chars,
+                         EncodeKernel kernel);
+    static void decode(const char* algorithm, const string& input,
+                       vector<uint8_t>& result, const int8_t* table,
+                       DecodeKernel kernel);
+};
+
+template <int BitsPerChunk>
+string
+FastTransformer<BitsPerChunk>::encode(const vector<uint8_t>& binary,
+                                      const char* chars, EncodeKernel kernel)
+{
+    const size_t len = binary.size();
+    const size_t groups = (len + BYTES_PER_GROUP - 1) / BYTES_PER_GROUP;
+    string result(groups * CHARS_PER_GROUP, '=');
+    if (len == 0) {
+        return (result);
+    }
+
+    const uint8_t* const data = &binary[0];
+    char* out = &result[0];
+    const size_t done = kernel(data, len, out);
+    out += done / BYTES_PER_GROUP * CHARS_PER_GROUP;
+
+    // Encode the last incomplete group, if any; the rest of the group is
+    // the padding characters.
+    uint32_t bits = 0;
+    int nbits = 0;
+    for (size_t i = done; i < len; ++i) {
+        bits = (bits << 8) | data[i];
+        nbits += 8;
+        while (nbits >= BitsPerChunk) {
+            nbits -= BitsPerChunk;
+            *out++ = chars[(bits >> nbits) & CHUNK_MASK];
+        }
+    }
+    if (nbits > 0) {
+        *out++ = chars[(bits << (BitsPerChunk - nbits)) & CHUNK_MASK];
+    }
+    assert(out <= &result[0] + result.size());
+    return (result);
+}
+
+template <int BitsPerChunk>
+void
+FastTransformer<BitsPerChunk>::decode(const char* algorithm,
+                                      const string& input,
+                                      vector<uint8_t>& result,
+                                      const int8_t* table,
+                                      DecodeKernel kernel)
+{
+    // Count the trailing padding characters, and check them as the
+    // reference implementation does.
+    size_t padchars = 0;
+    size_t beginpad = input.size();
+    for (; beginpad > 0; --beginpad) {
+        const int8_t code = table[static_cast<uint8_t>(input[beginpad - 1])];
+        if (code == CODE_PAD) {
+            if (++padchars > MAX_PADDING_CHARS) {
+                bundy_throw(BadValue, "Too many " << algorithm
+                          << " padding characters: " << input);
+            }
+        } else if (code != CODE_SPACE) {
+            break;
+        }
+    }
+    const size_t padbits = (padchars * BitsPerChunk + 7) & ~7;
+    if (padbits > BitsPerChunk * (padchars + 1)) {
+        bundy_throw(BadValue, "Invalid " << algorithm << "padding: " << input);
+    }
+    const size_t padbytes = padbits / 8;
+    // Padding characters are only accepted when they immediately follow
+    // the last encoded character (possibly followed by spaces).
+    const bool pad_allowed = beginpad > 0 && beginpad < input.size() &&
+        input[beginpad] == '=';
+
+    // Each character is decoded to at most BitsPerChunk bits.
+    result.resize(input.size() * BitsPerChunk / 8 + DECODE_SLACK);
+    const uint8_t* const data = reinterpret_cast<const uint8_t*>(input.data());
+    const size_t len = input.size();
+    uint8_t* const out_begin = &result[0];
+    uint8_t* out = out_begin;
+    uint32_t bits = 0;
+    int nbits = 0;
+    size_t char_count = 0;      // number of non-space characters
+    int group_chars = 0;        // char_count % CHARS_PER_GROUP
+    size_t next_kernel_pos = 0;
+    for (size_t i = 0; i < len;) {
+        // Use the kernel from each group boundary until it stops; then
+        // handle at least one character here before calling it again.
+        if (group_chars == 0 && i >= next_kernel_pos && i < beginpad) {
+            const size_t done = kernel(data + i, beginpad - i, out);
+            out += done / CHARS_PER_GROUP * BYTES_PER_GROUP;
+            char_count += done;
+            i += done;
+            next_kernel_pos = i + 1;
+            if (i == len) {
+                break;
+            }
+        }
+
+        const int8_t code = table[data[i]];
+        uint32_t value;
+        if (code >= 0) {
+            value = code;
+        } else if (code == CODE_SPACE) {
+            ++i;
+            continue;
+        } else if (code == CODE_PAD) {
+            if (!pad_allowed || i < beginpad) {
+                bundy_throw(BadValue, "Intermediate padding found");
+            }
+            value = 0;
+        } else {
+            bundy_throw(BadValue, "attempt to decode a value not in "
+                      << algorithm << " char set");
+        }
+        ++i;
+        ++char_count;
+        if (++group_chars == CHARS_PER_GROUP) {
+            group_chars = 0;
+        }
+        bits = (bits << BitsPerChunk) | value;
+        nbits += BitsPerChunk;
+        if (nbits >= 8) {
+            nbits -= 8;
+            *out++ = bits >> nbits;
+            bits &= (1 << nbits) - 1;
+        }
+    }
+
+    // See the reference implementation for these checks.
+    if (((char_count * BitsPerChunk) % 8) != 0) {
+        bundy_throw(BadValue, "Incomplete input for " << algorithm
+                  << ": " << input);
+    }
+    result.resize(out - out_begin);
+    assert(result.size() >= padbytes);
+    if (padbytes > 0 && *(result.end() - padbytes) != 0) {
+        bundy_throw(BadValue, "Non 0 bits included in " << algorithm
+                  << " padding: " << input);
+    }
+    result.resize(result.size() - padbytes);
+}
+
+typedef FastTransformer<6> Base64Transformer;
+typedef FastTransformer<5> Base32HexTransformer;
+typedef FastTransformer<4> Base16Transformer;
+
+ImplSelector<CodecImpl> selected_impl;
+
+CodecImpl
+selectBestImpl() {
+    if (isCodecAvailable(CODEC_AVX2)) {
+        return (CODEC_AVX2);
+    } else if (isCodecAvailable(CODEC_SSSE3)) {
+        return (CODEC_SSSE3);
+    }
+    return (CODEC_SCALAR);
+}
+}
+
+bool
+isCodecAvailable(CodecImpl impl) {
+    switch (impl) {
+    case CODEC_REFERENCE:
+    case CODEC_SCALAR:
+        return (true);
+    case CODEC_SSSE3:
+        return (hasCPUFeature(CPU_SSSE3));
+    case CODEC_AVX2:
+        return (hasCPUFeature(CPU_AVX2));
+    default:
+        return (false);
+    }
+}
+
+CodecImpl
+getCodecImpl() {
+    return (selected_impl.get(selectBestImpl));
+}
+
+bool
+selectCodecImpl(CodecImpl impl) {
+    if (!isCodecAvailable(impl)) {
+        return (false);
+    }
+    selected_impl.set(impl);
+    return (true);
+}
+
+string
+encodeBase64Fast(const vector<uint8_t>& binary, CodecImpl impl) {
+    return (Base64Transformer::encode(binary, BASE64_CHARS,
+                                      getBase64Kernels(impl).encode));
+}
+
+void
+decodeBase64Fast(const string& input, vector<uint8_t>& result,
+                 CodecImpl impl)
+{
+    Base64Transformer::decode("base64", input, result, BASE64_DECODE_TABLE,
+                              getBase64Kernels(impl).decode);
+}
+
+string
+encodeBase32HexFast(const vector<uint8_t>& binary, CodecImpl) {
+    return (Base32HexTransformer::encode(binary, BASE32HEX_CHARS,
+                                         encodeBase32HexScalar));
+}
+
+void
+decodeBase32HexFast(const string& input, vector<uint8_t>& result, CodecImpl) {
+    Base32HexTransformer::decode("base32hex", input, result,
+                                 BASE32HEX_DECODE_TABLE,
+                                 decodeBase32HexScalar);
+}
+
+string
+encodeHexFast(const vector<uint8_t>& binary, CodecImpl impl) {
+    return (Base16Transformer::encode(binary, BASE16_CHARS,
+                                      getBase16Kernels(impl).encode));
+}
+
+void
+decodeHexFast(const string& input, vector<uint8_t>& result, CodecImpl impl) {
+    Base16Transformer::decode("base16", input, result, BASE16_DECODE_TABLE,
+                              getBase16Kernels(impl).decode);
+}
+
+} // namespace internal
+} // namespace encode
+} // namespace util
+} // namespace bundy
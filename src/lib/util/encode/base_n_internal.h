@@ -0,0 +1,96 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BASE_N_INTERNAL_H
+#define BASE_N_INTERNAL_H 1
+
+// This is a header file for the implementations of the baseN encoding and
+// decoding.  The definitions in this file are not intended to be used
+// directly by applications; they are public only for tests and benchmarks.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace util {
+namespace encode {
+namespace internal {
+
+/// \brief The implementations of the baseN encoding and decoding.
+///
+/// \c CODEC_REFERENCE is the original, generic implementation based on
+/// boost archive iterators, which handles one bit group at a time.  It's
+/// kept as the reference for the others.  \c CODEC_SCALAR uses lookup
+/// tables and handles a full group of bytes at a time.  \c CODEC_SSSE3
+/// and \c CODEC_AVX2 are \c CODEC_SCALAR with vectorized kernels for
+/// base64 (and SSE2 kernels for base16), used for the parts of the input
+/// that don't contain spaces or padding.  All of them produce the same
+/// results (including errors) for any input.
+enum CodecImpl {
+    CODEC_REFERENCE,
+    CODEC_SCALAR,
+    CODEC_SSSE3,
+    CODEC_AVX2
+};
+
+/// \brief Return the implementation used by the encode and decode
+/// functions.
+///
+/// Unless explicitly selected by \c selectCodecImpl(), it's the fastest
+/// one available on the running machine.
+CodecImpl getCodecImpl();
+
+/// \brief Select the implementation used by the encode and decode
+/// functions.
+///
+/// This is mainly intended for tests and benchmarks.  Encoding or
+/// decoding already running in other threads completes with the previous
+/// implementation.
+///
+/// \return true if \c impl is available and selected; false otherwise.
+bool selectCodecImpl(CodecImpl impl);
+
+/// \brief The implementations other than \c CODEC_REFERENCE.
+///
+/// These are defined in base_n_fast.cc.  \c impl must be available.
+//@{
+std::string encodeBase64Fast(const std::vector<uint8_t>& binary,
+                             CodecImpl impl);
+void decodeBase64Fast(const std::string& input, std::vector<uint8_t>& result,
+                      CodecImpl impl);
+std::string encodeBase32HexFast(const std::vector<uint8_t>& binary,
+                                CodecImpl impl);
+void decodeBase32HexFast(const std::string& input,
+                         std::vector<uint8_t>& result, CodecImpl impl);
+std::string encodeHexFast(const std::vector<uint8_t>& binary,
+                          CodecImpl impl);
+void decodeHexFast(const std::string& input, std::vector<uint8_t>& result,
+                   CodecImpl impl);
+//@}
+
+/// \brief Return whether the given implementation is available on the
+/// running machine.
+bool isCodecAvailable(CodecImpl impl);
+
+} // end of internal
+} // end of encode
+} // end of util
+} // end of bundy
+#endif // BASE_N_INTERNAL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,401 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/hash/sha1_multi.h>
+#include <util/cpu_features.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef BUNDY_CPU_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef BUNDY_CPU_AVX2
+#include <immintrin.h>
+#endif
+
+namespace bundy {
+namespace util {
+namespace hash {
+
+namespace {
+// The maximum number of messages processed together.
+const size_t MAX_LANES = 8;
+
+// The compression functions process one 64-byte block of each message.
+// The state and the block are interleaved: word i of the state (or the
+// block, already converted to host byte order) of lane j is stored at
+// index i * lanes + j.
+typedef void (*CompressFunc)(uint32_t* state, const uint32_t* block);
+
+// The compression function of SHA-1 (RFC 3174, Section 6.1), written once
+// with the following vector operations, which are defined for each
+// implementation before its use: SHA1_VEC (the type), SHA1_LOAD,
+// SHA1_STORE, SHA1_SET1, SHA1_ADD, SHA1_XOR, SHA1_AND, SHA1_OR and
+// SHA1_ROTL.
+#define SHA1_ROUND(f, k, t) \
+    do { \
+        const SHA1_VEC temp = \
+            SHA1_ADD(SHA1_ADD(SHA1_ROTL(a, 5), (f)), \
+                     SHA1_ADD(SHA1_ADD(e, (k)), w[(t) & 15])); \
+        e = d; \
+        d = c; \
+        c = SHA1_ROTL(b, 30); \
+        b = a; \
+        a = temp; \
+    } while (0)
+
+#define SHA1_SCHEDULE(t) \
+    do { \
+        if ((t) >= 16) { \
+            w[(t) & 15] = SHA1_ROTL( \
+                SHA1_XOR(SHA1_XOR(w[((t) - 3) & 15], w[((t) - 8) & 15]), \
+                         SHA1_XOR(w[((t) - 14) & 15], w[(t) & 15])), 1); \
+        } \
+    } while (0)
+
+#define SHA1_COMPRESS(state, block, lanes) \
+    do { \
+        SHA1_VEC w[16]; \
+        for (int t = 0; t < 16; ++t) { \
+            w[t] = SHA1_LOAD((block) + t * (lanes)); \
+        } \
+        SHA1_VEC a = SHA1_LOAD((state) + 0 * (lanes)); \
+        SHA1_VEC b = SHA1_LOAD((state) + 1 * (lanes)); \
+        SHA1_VEC c = SHA1_LOAD((state) + 2 * (lanes)); \
+        SHA1_VEC d = SHA1_LOAD((state) + 3 * (lanes)); \
+        SHA1_VEC e = SHA1_LOAD((state) + 4 * (lanes)); \
+        const SHA1_VEC k1 = SHA1_SET1(0x5A827999); \
+        for (int t = 0; t < 20; ++t) { \
+            SHA1_SCHEDULE(t); \
+            SHA1_ROUND(SHA1_XOR(d, SHA1_AND(b, SHA1_XOR(c, d))), k1, t); \
+        } \
+        const SHA1_VEC k2 = SHA1_SET1(0x6ED9EBA1); \
+        for (int t = 20; t < 40; ++t) { \
+            SHA1_SCHEDULE(t); \
+            SHA1_ROUND(SHA1_XOR(SHA1_XOR(b, c), d), k2, t); \
+        } \
+        const SHA1_VEC k3 = SHA1_SET1(0x8F1BBCDC); \
+        for (int t = 40; t < 60; ++t) { \
+            SHA1_SCHEDULE(t); \
+            SHA1_ROUND(SHA1_OR(SHA1_AND(b, c), SHA1_AND(d, SHA1_OR(b, c))), \
+                       k3, t); \
+        } \
+        const SHA1_VEC k4 = SHA1_SET1(0xCA62C1D6); \
+        for (int t = 60; t < 80; ++t) { \
+            SHA1_SCHEDULE(t); \
+            SHA1_ROUND(SHA1_XOR(SHA1_XOR(b, c), d), k4, t); \
+        } \
+        SHA1_STORE((state) + 0 * (lanes), \
+                   SHA1_ADD(SHA1_LOAD((state) + 0 * (lanes)), a)); \
+        SHA1_STORE((state) + 1 * (lanes), \
+                   SHA1_ADD(SHA1_LOAD((state) + 1 * (lanes)), b)); \
+        SHA1_STORE((state) + 2 * (lanes), \
+                   SHA1_ADD(SHA1_LOAD((state) + 2 * (lanes)), c)); \
+        SHA1_STORE((state) + 3 * (lanes), \
+                   SHA1_ADD(SHA1_LOAD((state) + 3 * (lanes)), d)); \
+        SHA1_STORE((state) + 4 * (lanes), \
+                   SHA1_ADD(SHA1_LOAD((state) + 4 * (lanes)), e)); \
+    } while (0)
+
+#define SHA1_VEC uint32_t
+#define SHA1_LOAD(p) (*(p))
+#define SHA1_STORE(p, v) (*(p) = (v))
+#define SHA1_SET1(x) static_cast<uint32_t>(x)
+#define SHA1_ADD(x, y) ((x) + (y))
+#define SHA1_XOR(x, y) ((x) ^ (y))
+#define SHA1_AND(x, y) ((x) & (y))
+#define SHA1_OR(x, y) ((x) | (y))
+#define SHA1_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+void
+compressScalar(uint32_t* state, const uint32_t* block) {
+    SHA1_COMPRESS(state, block, 1);
+}
+
+#undef SHA1_VEC
+#undef SHA1_LOAD
+#undef SHA1_STORE
+#undef SHA1_SET1
+#undef SHA1_ADD
+#undef SHA1_XOR
+#undef SHA1_AND
+#undef SHA1_OR
+#undef SHA1_ROTL
+
+#ifdef BUNDY_CPU_SSE2
+#define SHA1_VEC __m128i
+#define SHA1_LOAD(p) _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+#define SHA1_STORE(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), (v))
+#define SHA1_SET1(x) _mm_set1_epi32(x)
+#define SHA1_ADD(x, y) _mm_add_epi32((x), (y))
+#define SHA1_XOR(x, y) _mm_xor_si128((x), (y))
+#define SHA1_AND(x, y) _mm_and_si128((x), (y))
+#define SHA1_OR(x, y) _mm_or_si128((x), (y))
+#define SHA1_ROTL(x, n) \
+    _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+void
+compressSSE2(uint32_t* state, const uint32_t* block) {
+    SHA1_COMPRESS(state, block, 4);
+}
+
+#undef SHA1_VEC
+#undef SHA1_LOAD
+#undef SHA1_STORE
+#undef SHA1_SET1
+#undef SHA1_ADD
+#undef SHA1_XOR
+#undef SHA1_AND
+#undef SHA1_OR
+#undef SHA1_ROTL
+#endif
+
+#ifdef BUNDY_CPU_AVX2
+#define SHA1_VEC __m256i
+#define SHA1_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define SHA1_STORE(p, v) \
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), (v))
+#define SHA1_SET1(x) _mm256_set1_epi32(x)
+#define SHA1_ADD(x, y) _mm256_add_epi32((x), (y))
+#define SHA1_XOR(x, y) _mm256_xor_si256((x), (y))
+#define SHA1_AND(x, y) _mm256_and_si256((x), (y))
+#define SHA1_OR(x, y) _mm256_or_si256((x), (y))
+#define SHA1_ROTL(x, n) \
+    _mm256_or_si256(_mm256_slli_epi32((x), (n)), \
+                    _mm256_srli_epi32((x), 32 - (n)))
+
+__attribute__((target("avx2"))) void
+compressAVX2(uint32_t* state, const uint32_t* block) {
+    SHA1_COMPRESS(state, block, 8);
+    // Avoid the penalty of transitions to the legacy SSE code of the
+    // caller.
+    _mm256_zeroupper();
+}
+
+#undef SHA1_VEC
+#undef SHA1_LOAD
+#undef SHA1_STORE
+#undef SHA1_SET1
+#undef SHA1_ADD
+#undef SHA1_XOR
+#undef SHA1_AND
+#undef SHA1_OR
+#undef SHA1_ROTL
+#endif
+
+#undef SHA1_COMPRESS
+#undef SHA1_SCHEDULE
+#undef SHA1_ROUND
+
+const uint32_t INITIAL_STATE[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+inline uint32_t
+readUint32(const uint8_t* cp) {
+    return ((static_cast<uint32_t>(cp[0]) << 24) |
+            (static_cast<uint32_t>(cp[1]) << 16) |
+            (static_cast<uint32_t>(cp[2]) << 8) |
+            static_cast<uint32_t>(cp[3]));
+}
+
+// The number of 64-byte blocks of a message after padding: a 0x80 byte and
+// the 8-byte length in bits follow the message.
+inline size_t
+getBlockCount(size_t length) {
+    return ((length + 8) / SHA1_BLOCKSIZE + 1);
+}
+
+// Store the given block of a padded message in the interleaved block
+// words of a lane.
+void
+loadBlock(const uint8_t* data, size_t length, size_t block_index,
+          uint32_t* block, size_t lanes)
+{
+    const size_t offset = block_index * SHA1_BLOCKSIZE;
+    if (offset + SHA1_BLOCKSIZE <= length) {
+        for (size_t t = 0; t < 16; ++t) {
+            block[t * lanes] = readUint32(data + offset + t * 4);
+        }
+        return;
+    }
+
+    uint8_t buf[SHA1_BLOCKSIZE];
+    std::memset(buf, 0, sizeof(buf));
+    if (offset < length) {
+        std::memcpy(buf, data + offset, length - offset);
+    }
+    if (offset <= length) {
+        buf[length - offset] = 0x80;
+    }
+    if (block_index + 1 == getBlockCount(length)) {
+        const uint64_t bits = static_cast<uint64_t>(length) * 8;
+        for (size_t i = 0; i < 8; ++i) {
+            buf[SHA1_BLOCKSIZE - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+        }
+    }
+    for (size_t t = 0; t < 16; ++t) {
+        block[t * lanes] = readUint32(buf + t * 4);
+    }
+}
+
+// Calculate the digests of up to "lanes" messages with the given
+// compression function.  The lanes of the messages that are shorter than
+// the others are just processed with garbage after their digests are
+// stored.
+void
+digestGroup(CompressFunc func, size_t lanes, size_t count,
+            const uint8_t* const data[], const size_t lengths[],
+            uint8_t digests[][SHA1_HASHSIZE])
+{
+    uint32_t state[5 * MAX_LANES];
+    uint32_t block[16 * MAX_LANES];
+    size_t block_counts[MAX_LANES];
+
+    for (size_t i = 0; i < 5; ++i) {
+        std::fill(state + i * lanes, state + (i + 1) * lanes,
+                  INITIAL_STATE[i]);
+    }
+    std::memset(block, 0, sizeof(block));
+    size_t max_blocks = 0;
+    for (size_t j = 0; j < count; ++j) {
+        block_counts[j] = getBlockCount(lengths[j]);
+        max_blocks = std::max(max_blocks, block_counts[j]);
+    }
+
+    for (size_t b = 0; b < max_blocks; ++b) {
+        for (size_t j = 0; j < count; ++j) {
+            if (b < block_counts[j]) {
+                loadBlock(data[j], lengths[j], b, block + j, lanes);
+            }
+        }
+        func(state, block);
+        for (size_t j = 0; j < count; ++j) {
+            if (b + 1 == block_counts[j]) {
+                for (size_t i = 0; i < 5; ++i) {
+                    const uint32_t word = state[i * lanes + j];
+                    digests[j][i * 4] = word >> 24;
+                    digests[j][i * 4 + 1] = word >> 16;
+                    digests[j][i * 4 + 2] = word >> 8;
+                    digests[j][i * 4 + 3] = word;
+                }
+            }
+        }
+    }
+}
+
+bool
+isAvailable(SHA1MultiImpl impl) {
+    switch (impl) {
+    case SHA1_MULTI_SCALAR:
+        return (true);
+    case SHA1_MULTI_SSE2:
+        return (hasCPUFeature(CPU_SSE2));
+    case SHA1_MULTI_AVX2:
+        return (hasCPUFeature(CPU_AVX2));
+    default:
+        return (false);
+    }
+}
+
+// An implementation with its compression function and number of lanes,
+// selected together.
+struct Kernel {
+    SHA1MultiImpl impl;
+    CompressFunc func;
+    size_t lanes;
+};
+
+const size_t SSE2_LANES = 4;
+
+const Kernel KERNELS[] = {
+    { SHA1_MULTI_SCALAR, compressScalar, 1 },
+#ifdef BUNDY_CPU_SSE2
+    { SHA1_MULTI_SSE2, compressSSE2, SSE2_LANES },
+#endif
+#ifdef BUNDY_CPU_AVX2
+    { SHA1_MULTI_AVX2, compressAVX2, 8 },
+#endif
+};
+const size_t KERNEL_COUNT = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+const Kernel*
+findKernel(SHA1MultiImpl impl) {
+    for (size_t i = 0; i < KERNEL_COUNT; ++i) {
+        if (KERNELS[i].impl == impl) {
+            return (&KERNELS[i]);
+        }
+    }
+    return (NULL);
+}
+
+ImplSelector<const Kernel*> selected_kernel;
+
+const Kernel*
+selectBestKernel() {
+    if (isAvailable(SHA1_MULTI_AVX2)) {
+        return (findKernel(SHA1_MULTI_AVX2));
+    } else if (isAvailable(SHA1_MULTI_SSE2)) {
+        return (findKernel(SHA1_MULTI_SSE2));
+    }
+    return (findKernel(SHA1_MULTI_SCALAR));
+}
+}
+
+void
+SHA1MultiDigest(size_t count, const uint8_t* const data[],
+                const size_t lengths[], uint8_t digests[][SHA1_HASHSIZE])
+{
+    const Kernel* const kernel = selected_kernel.get(selectBestKernel);
+    const size_t lanes = kernel->lanes;
+    for (size_t i = 0; i < count; i += lanes) {
+        const size_t n = std::min(lanes, count - i);
+        if (n == 1) {
+            // A single message (which is common for NSEC3 hashes of a
+            // query) doesn't need the vectors.
+            digestGroup(compressScalar, 1, 1, data + i, lengths + i,
+                        digests + i);
+        } else if (n <= SSE2_LANES && lanes > SSE2_LANES) {
+            // A query needs the hashes of a few names (up to 4 for the
+            // closest encloser proof).  With them, the AVX2 kernel wastes
+            // half of its lanes, and was measured to be slower than the
+            // SSE2 one (which is always available with AVX2).
+            const Kernel* const sse2 = findKernel(SHA1_MULTI_SSE2);
+            digestGroup(sse2->func, SSE2_LANES, n, data + i, lengths + i,
+                        digests + i);
+        } else {
+            digestGroup(kernel->func, lanes, n, data + i, lengths + i,
+                        digests + i);
+        }
+    }
+}
+
+SHA1MultiImpl
+getSHA1MultiImpl() {
+    return (selected_kernel.get(selectBestKernel)->impl);
+}
+
+bool
+selectSHA1MultiImpl(SHA1MultiImpl impl) {
+    if (!isAvailable(impl)) {
+        return (false);
+    }
+    selected_kernel.set(findKernel(impl));
+    return (true);
+}
+
+} // namespace hash
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,84 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SHA1_MULTI_H
+#define SHA1_MULTI_H 1
+
+#include <util/hash/sha1.h>
+
+#include <stdint.h>
+
+#include <cstddef>
+
+namespace bundy {
+namespace util {
+namespace hash {
+
+/// \brief Implementations of \c SHA1MultiDigest().
+///
+/// \c SHA1_MULTI_SSE2 and \c SHA1_MULTI_AVX2 calculate the digests of 4 and
+/// 8 messages in parallel, respectively, one message in each 32-bit lane of
+/// the vector registers.  They are only available on x86 processors
+/// supporting these instruction sets (and with compilers supporting them).
+/// \c SHA1_MULTI_SCALAR handles one message at a time and is always
+/// available.  All of them give the same result.  \c SHA1_MULTI_AVX2 still
+/// uses the SSE2 code for a group of up to 4 messages, for which it's
+/// faster.
+enum SHA1MultiImpl {
+    SHA1_MULTI_SCALAR,
+    SHA1_MULTI_SSE2,
+    SHA1_MULTI_AVX2
+};
+
+/// \brief Calculate the SHA-1 digests of multiple messages.
+///
+/// This is equivalent to calculating the digest of each message with
+/// \c SHA1Reset(), \c SHA1Input() and \c SHA1Result(), but the messages are
+/// processed together by the selected implementation, so it's much faster
+/// for many short messages, such as the iterations of NSEC3 hashes.  It
+/// works best when the messages have the same number of 64-byte blocks.
+///
+/// On its first call the fastest implementation available on the running
+/// processor is selected (unless \c selectSHA1MultiImpl() has been called).
+///
+/// \param count The number of messages.
+/// \param data The data of each message.
+/// \param lengths The length of each message in bytes.
+/// \param digests The digest of each message is stored here.  The digest
+/// of a message may overwrite its own data.
+void SHA1MultiDigest(size_t count, const uint8_t* const data[],
+                     const size_t lengths[],
+                     uint8_t digests[][SHA1_HASHSIZE]);
+
+/// \brief Return the implementation used by \c SHA1MultiDigest().
+SHA1MultiImpl getSHA1MultiImpl();
+
+/// \brief Force \c SHA1MultiDigest() to use the given implementation.
+///
+/// This is intended for tests and benchmarks.  A concurrent call to
+/// \c SHA1MultiDigest() uses either the previous implementation or the new
+/// one for all of its messages.
+///
+/// \return true if the implementation is available and selected, false
+/// otherwise (in which case the selection isn't changed).
+bool selectSHA1MultiImpl(SHA1MultiImpl impl);
+
+} // namespace hash
+} // namespace util
+} // namespace bundy
+#endif // SHA1_MULTI_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -159,6 +159,18 @@ public:
     /// deallocated, <code>false</code> otherwise.
     virtual bool allMemoryDeallocated() const = 0;
 
+    /// \brief Return the total size of the memory currently allocated.
+    ///
+    /// This is the sum of the sizes passed to \c allocate() minus those
+    /// passed to \c deallocate(), so it doesn't include any overhead of
+    /// the implementation (such as the space left unused in internal
+    /// chunks).  It's intended to be used for accounting the memory used
+    /// by a set of objects by comparing the values before and after
+    /// building (or destroying) them.
+    ///
+    /// \throw None
+    virtual size_t getAllocatedSize() const = 0;
+
     /// \brief Associate specified address in the segment with a given name.
     ///
     /// This method establishes an association between the given name and
@@ -18,11 +18,31 @@
 namespace bundy {
 namespace util {
 
+MemorySegmentLocal::~MemorySegmentLocal() {
+    void* chunk;
+    while ((chunk = slab_.releaseChunk()) != NULL) {
+        free(chunk);
+    }
+}
+
 void*
 MemorySegmentLocal::allocate(size_t size) {
-    void* ptr = malloc(size);
-    if (ptr == NULL) {
-        throw std::bad_alloc();
+    void* ptr;
+    if (size <= SlabAllocator<void*>::MAX_OBJECT_SIZE) {
+        ptr = slab_.allocate(size);
+        if (ptr == NULL) {
+            void* const chunk = malloc(slab_.getChunkSize(size));
+            if (chunk == NULL) {
+                throw std::bad_alloc();
+            }
+            slab_.addChunk(size, chunk);
+            ptr = slab_.allocate(size);
+        }
+    } else {
+        ptr = malloc(size);
+        if (ptr == NULL) {
+            throw std::bad_alloc();
+        }
     }
 
     allocated_size_ += size;
@@ -43,7 +63,11 @@ MemorySegmentLocal::deallocate(void* ptr, size_t size) {
     }
 
     allocated_size_ -= size;
-    free(ptr);
+    if (size <= SlabAllocator<void*>::MAX_OBJECT_SIZE) {
+        slab_.deallocate(ptr, size);
+    } else {
+        free(ptr);
+    }
 }
 
 bool
@@ -51,6 +75,21 @@ MemorySegmentLocal::allMemoryDeallocated() const {
     return (allocated_size_ == 0 && named_addrs_.empty());
 }
 
+void
+MemorySegmentLocal::merge(MemorySegmentLocal& other) {
+    if (&other == this) {
+        bundy_throw(InvalidParameter, "Memory segment merged into itself");
+    }
+    if (!other.named_addrs_.empty()) {
+        bundy_throw(InvalidParameter,
+                    "Memory segment with named addresses can't be merged");
+    }
+
+    slab_.merge(other.slab_);
+    allocated_size_ += other.allocated_size_;
+    other.allocated_size_ = 0;
+}
+
 MemorySegment::NamedAddressResult
 MemorySegmentLocal::getNamedAddressImpl(const char* name) const {
     std::map<std::string, void*>::const_iterator found =
@@ -16,6 +16,7 @@
 #define MEMORY_SEGMENT_LOCAL_H
 
 #include <util/memory_segment.h>
+#include <util/slab_allocator.h>
 
 #include <string>
 #include <map>
@@ -37,10 +38,16 @@ public:
     }
 
     /// \brief Destructor
-    virtual ~MemorySegmentLocal() {}
+    ///
+    /// The chunks of small objects are released, so any memory of the
+    /// segment that has not been deallocated becomes invalid.
+    virtual ~MemorySegmentLocal();
 
-    /// \brief Allocate/acquire a segment of memory. The source of the
-    /// memory is libc's malloc().
+    /// \brief Allocate/acquire a segment of memory.
+    ///
+    /// Objects up to \c SlabAllocator::MAX_OBJECT_SIZE bytes are allocated
+    /// by a \c SlabAllocator from chunks taken from libc's malloc(); larger
+    /// ones are directly taken from malloc().
     ///
     /// Throws <code>std::bad_alloc</code> if the implementation cannot
     /// allocate the requested storage.
@@ -66,6 +73,29 @@ public:
     /// deallocated, <code>false</code> otherwise.
     virtual bool allMemoryDeallocated() const;
 
+    /// \brief Local segment version of getAllocatedSize.
+    virtual size_t getAllocatedSize() const { return (allocated_size_); }
+
+    /// \brief Take over the memory allocated from another segment.
+    ///
+    /// Since the memory of this class comes from the same libc heap, memory
+    /// allocated from one \c MemorySegmentLocal can be released via another
+    /// once its ownership is moved.  This method moves the chunks of small
+    /// objects and the accounting of the memory currently allocated
+    /// from \c other to this segment, so that the memory can (and must) be
+    /// deallocated via this segment afterwards.  This is useful for building
+    /// data in separate segments in different threads (as this class is not
+    /// thread safe) and then using them from a single segment.
+    ///
+    /// \c other becomes empty, i.e., its \c allMemoryDeallocated() will
+    /// return \c true unless it's used again.
+    ///
+    /// \throw bundy::InvalidParameter \c other has a named address, or is
+    /// this segment itself.
+    ///
+    /// \param other The segment whose memory is to be taken over.
+    void merge(MemorySegmentLocal& other);
+
     /// \brief Local segment version of getNamedAddress.
     ///
     /// There's a small chance this method could throw std::bad_alloc.
@@ -95,6 +125,8 @@ private:
     // relation comparison, this is okay.
     size_t allocated_size_;
 
+    SlabAllocator<void*> slab_;
+
     std::map<std::string, void*> named_addrs_;
 };
 
@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <util/memory_segment_mapped.h>
+#include <util/slab_allocator.h>
 #include <util/unittests/check_valgrind.h>
 
 #include <exceptions/exceptions.h>
@@ -24,11 +25,13 @@
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <new>
 
 #include <stdint.h>
+#include <sys/mman.h>
 
 // boost::interprocess namespace is big and can cause unexpected import
 // (e.g., it has "read_only"), so it's safer to be specific for shortcuts.
@@ -52,6 +55,15 @@ namespace { // unnamed namespace
 const char* const RESERVED_NAMED_ADDRESS_STORAGE_NAME =
     "_RESERVED_NAMED_ADDRESS_STORAGE";
 
+// The allocator of small objects is stored in the segment with this name,
+// so the free objects are kept across remaps and opens of the segment.
+const char* const RESERVED_SLAB_ALLOCATOR_NAME = "_RESERVED_SLAB_ALLOCATOR";
+
+// Likewise, the total size of the allocated memory is stored with this name.
+const char* const RESERVED_ALLOCATED_SIZE_NAME = "_RESERVED_ALLOCATED_SIZE";
+
+typedef SlabAllocator<offset_ptr<void> > SegmentSlabAllocator;
+
 } // end of unnamed namespace
 
 
@@ -76,7 +88,8 @@ struct MemorySegmentMapped::Impl {
     // to detect possible conflict with other readers or writers using
     // file lock.
     Impl(const std::string& filename, create_only_t, size_t initial_size) :
-        read_only_(false), filename_(filename)
+        read_only_(false), filename_(filename), slab_(NULL),
+        allocated_size_(NULL), huge_pages_(false)
     {
         try {
             // First, try opening it in boost create_only mode; it fails if
@@ -117,6 +130,7 @@ struct MemorySegmentMapped::Impl {
         read_only_(false), filename_(filename),
         base_sgmt_(new BaseSegment(open_or_create, filename.c_str(),
                                    initial_size)),
+        slab_(NULL), allocated_size_(NULL), huge_pages_(false),
         lock_(new boost::interprocess::file_lock(filename.c_str()))
     {
         checkWriter();
@@ -129,6 +143,7 @@ struct MemorySegmentMapped::Impl {
         base_sgmt_(read_only_ ?
                    new BaseSegment(open_read_only, filename.c_str()) :
                    new BaseSegment(open_only, filename.c_str())),
+        slab_(NULL), allocated_size_(NULL), huge_pages_(false),
         lock_(new boost::interprocess::file_lock(filename.c_str()))
     {
         if (read_only_) {
@@ -139,14 +154,14 @@ struct MemorySegmentMapped::Impl {
         reserveMemory();
     }
 
-    void reserveMemory(bool no_grow = false) {
+    void reserveMemory() {
         if (!read_only_) {
+            checkSlab();
+
             // Reserve a named address for use during
-            // setNamedAddress(). Though this will almost always succeed
-            // on the first try during construction, it may require
-            // multiple attempts later during a call from
-            // allMemoryDeallocated() when the segment has been in use
-            // for a while.
+            // setNamedAddress(). This will almost always succeed on the
+            // first try, but the segment may have to grow if an existing
+            // one is full.
             while (true) {
                 const offset_ptr<void>* reserved_storage =
                     base_sgmt_->find_or_construct<offset_ptr<void> >(
@@ -155,13 +170,78 @@ struct MemorySegmentMapped::Impl {
                 if (reserved_storage) {
                     break;
                 }
-                assert(!no_grow);
 
                 growSegment();
             }
+
+            // Likewise, create the allocator of small objects and the
+            // allocated size unless they already exist in the segment.
+            while (!base_sgmt_->find_or_construct<SegmentSlabAllocator>(
+                       RESERVED_SLAB_ALLOCATOR_NAME, std::nothrow)()) {
+                growSegment();
+            }
+            while (!base_sgmt_->find_or_construct<size_t>(
+                       RESERVED_ALLOCATED_SIZE_NAME, std::nothrow)(0)) {
+                growSegment();
+            }
+        }
+        findSlab();
+    }
+
+    // A segment created by an older version doesn't have the allocator of
+    // small objects, and the objects allocated in it can't be deallocated
+    // with the allocator created now.  So we only accept such a segment for
+    // writing if it's empty except for the reserved named address storage,
+    // which was normally destroyed on close anyway.
+    void checkSlab() {
+        if (base_sgmt_->find<SegmentSlabAllocator>(
+                RESERVED_SLAB_ALLOCATOR_NAME).first) {
+            return;
+        }
+        base_sgmt_->destroy<offset_ptr<void> >(
+            RESERVED_NAMED_ADDRESS_STORAGE_NAME);
+        if (!base_sgmt_->all_memory_deallocated()) {
+            bundy_throw(MemorySegmentOpenError,
+                        "mapped memory segment created by an older version "
+                        "can't be opened as read-write");
         }
     }
 
+    // (Re)fetch the address of the allocator of small objects and the
+    // allocated size; this must be called whenever the segment is
+    // (re)mapped.  They can be NULL for a read-only segment created by an
+    // older version.
+    void findSlab() {
+        slab_ = base_sgmt_->find<SegmentSlabAllocator>(
+            RESERVED_SLAB_ALLOCATOR_NAME).first;
+        allocated_size_ = base_sgmt_->find<size_t>(
+            RESERVED_ALLOCATED_SIZE_NAME).first;
+    }
+
+    // Give the huge page hint on the whole mapping.  The hint is tied to
+    // the mapping, so this must be called again whenever the segment is
+    // remapped if useHugePages() was called.
+    bool adviseHugePages() {
+#ifdef MADV_HUGEPAGE
+        return (madvise(base_sgmt_->get_address(), base_sgmt_->get_size(),
+                        MADV_HUGEPAGE) == 0);
+#else
+        return (false);
+#endif
+    }
+
+    // Allocate memory from the underlying segment; NULL is returned if
+    // the segment needs to grow.
+    void* allocateBase(size_t size) {
+        // We explicitly check the free memory size; it appears
+        // managed_mapped_file::allocate() could incorrectly return a
+        // seemingly valid pointer for some very large requested size.
+        if (base_sgmt_->get_free_memory() >= size) {
+            return (base_sgmt_->allocate(size, std::nothrow));
+        }
+        return (NULL);
+    }
+
     void freeReservedMemory() {
         if (!read_only_) {
             const bool deleted = base_sgmt_->destroy<offset_ptr<void> >
@@ -214,6 +294,10 @@ struct MemorySegmentMapped::Impl {
         } catch (...) {
             abort();
         }
+        findSlab();
+        if (huge_pages_) {
+            adviseHugePages();
+        }
         if (!grown) {
             throw std::bad_alloc();
         }
@@ -228,6 +312,16 @@ struct MemorySegmentMapped::Impl {
     // actual Boost implementation of mapped segment.
     boost::scoped_ptr<BaseSegment> base_sgmt_;
 
+    // allocator of small objects in the segment.
+    SegmentSlabAllocator* slab_;
+
+    // total size of the allocated memory, stored in the segment.
+    size_t* allocated_size_;
+
+    // whether useHugePages() was called, so the hint is given again on
+    // remap.
+    bool huge_pages_;
+
 private:
     // helper methods and member to detect any reader-writer conflict at
     // the time of construction using an advisory file lock.  The lock will
@@ -304,28 +398,40 @@ MemorySegmentMapped::allocate(size_t size) {
         bundy_throw(MemorySegmentError, "allocate attempt on read-only segment");
     }
 
-    // We explicitly check the free memory size; it appears
-    // managed_mapped_file::allocate() could incorrectly return a seemingly
-    // valid pointer for some very large requested size.
-    if (impl_->base_sgmt_->get_free_memory() >= size) {
-        void* ptr = impl_->base_sgmt_->allocate(size, std::nothrow);
-        if (ptr) {
-            return (ptr);
+    // Small objects are allocated from chunks of the slab allocator, which
+    // are allocated from the underlying segment; larger ones directly.
+    size_t base_size = size;
+    void* ptr = NULL;
+    if (size <= SegmentSlabAllocator::MAX_OBJECT_SIZE) {
+        ptr = impl_->slab_->allocate(size);
+        if (!ptr) {
+            base_size = impl_->slab_->getChunkSize(size);
+            void* chunk = impl_->allocateBase(base_size);
+            if (chunk) {
+                impl_->slab_->addChunk(size, chunk);
+                ptr = impl_->slab_->allocate(size);
+            }
         }
+    } else {
+        ptr = impl_->allocateBase(size);
+    }
+    if (ptr) {
+        *impl_->allocated_size_ += size;
+        return (ptr);
     }
 
     // Grow the mapped segment doubling the size until we have sufficient
     // free memory in the revised segment for the requested size.
     do {
         impl_->growSegment();
-    } while (impl_->base_sgmt_->get_free_memory() < size);
+    } while (impl_->base_sgmt_->get_free_memory() < base_size);
     bundy_throw(MemorySegmentGrown, "mapped memory segment grown, size: "
               << impl_->base_sgmt_->get_size() << ", free size: "
               << impl_->base_sgmt_->get_free_memory());
 }
 
 void
-MemorySegmentMapped::deallocate(void* ptr, size_t) {
+MemorySegmentMapped::deallocate(void* ptr, size_t size) {
     if (impl_->read_only_) {
         bundy_throw(MemorySegmentError,
                   "deallocate attempt on read-only segment");
@@ -337,24 +443,30 @@ MemorySegmentMapped::deallocate(void* ptr, size_t) {
         return;
     }
 
-    impl_->base_sgmt_->deallocate(ptr);
+    if (size <= SegmentSlabAllocator::MAX_OBJECT_SIZE) {
+        impl_->slab_->deallocate(ptr, size);
+    } else {
+        impl_->base_sgmt_->deallocate(ptr);
+    }
+    *impl_->allocated_size_ -= size;
 }
 
 bool
 MemorySegmentMapped::allMemoryDeallocated() const {
-    // This method is not technically const, but it reserves the
-    // const-ness property. In case of exceptions, we abort here. (See
-    // ticket #2850 for additional commentary.)
-    try {
-        impl_->freeReservedMemory();
-        const bool result = impl_->base_sgmt_->all_memory_deallocated();
-        // reserveMemory() should succeed now as the memory was already
-        // allocated, so we set no_grow to true.
-        impl_->reserveMemory(true);
-        return (result);
-    } catch (...) {
-        abort();
+    if (!impl_->allocated_size_) {
+        // A read-only segment created by an older version, which has
+        // neither the allocator of small objects nor the reserved storage
+        // for setNamedAddress() (it's only kept while opened for writing).
+        return (impl_->base_sgmt_->all_memory_deallocated());
     }
+
+    // The allocated size covers the objects of any size, and the named
+    // addresses are separate objects in the underlying segment.  Other
+    // than them, there are only the reserved objects, and the chunks of
+    // small objects, which are kept for later allocations.
+    const size_t reserved_count = impl_->read_only_ ? 2 : 3;
+    return (*impl_->allocated_size_ == 0 &&
+            impl_->base_sgmt_->get_num_named_objects() == reserved_count);
 }
 
 MemorySegment::NamedAddressResult
@@ -451,10 +563,14 @@ MemorySegmentMapped::shrinkToFit() {
         // case as gracefully as possible.
         impl_->base_sgmt_.reset(
             new BaseSegment(open_only, impl_->filename_.c_str()));
+        impl_->findSlab();
     } catch (const boost::interprocess::interprocess_exception& ex) {
         bundy_throw(MemorySegmentError,
                   "remap after shrink failed; segment is now unusable");
     }
+    if (impl_->huge_pages_) {
+        impl_->adviseHugePages();
+    }
 
     // Flush possible dirty pages after shrinking the segment.  As documented
     // in growSegment(), we don't expect too much memory to be flushed here,
@@ -462,6 +578,11 @@ MemorySegmentMapped::shrinkToFit() {
     impl_->base_sgmt_->flush();
 }
 
+size_t
+MemorySegmentMapped::getAllocatedSize() const {
+    return (impl_->allocated_size_ ? *impl_->allocated_size_ : 0);
+}
+
 size_t
 MemorySegmentMapped::getSize() const {
     return (impl_->base_sgmt_->get_size());
@@ -483,5 +604,50 @@ MemorySegmentMapped::getCheckSum() const {
     return (sum);
 }
 
+bool
+MemorySegmentMapped::adviseWillNeed() const {
+    return (madvise(impl_->base_sgmt_->get_address(),
+                    impl_->base_sgmt_->get_size(), MADV_WILLNEED) == 0);
+}
+
+bool
+MemorySegmentMapped::useHugePages() {
+    impl_->huge_pages_ = true;
+    return (impl_->adviseHugePages());
+}
+
+size_t
+MemorySegmentMapped::prefault(size_t offset, size_t length) const {
+    const size_t size = impl_->base_sgmt_->get_size();
+    if (offset >= size) {
+        return (0);
+    }
+    length = std::min(length, size - offset);
+
+    // madvise() needs a page aligned address; the mapping itself is.
+    const size_t pagesize =
+        boost::interprocess::mapped_region::get_page_size();
+    uint8_t* const base = static_cast<uint8_t*>(
+        impl_->base_sgmt_->get_address());
+    uint8_t* const begin = base + offset / pagesize * pagesize;
+    uint8_t* const end = base + offset + length;
+
+#ifdef MADV_POPULATE_READ
+    // This is much faster than touching the pages one by one, but older
+    // kernels reject it (with EINVAL), and then we fall back to touching.
+    if (madvise(begin, end - begin, MADV_POPULATE_READ) == 0) {
+        return (length);
+    }
+#endif
+
+    // Read through a volatile pointer so the reads are not optimized out.
+    const volatile uint8_t* cp = begin;
+    for (; cp < end; cp += pagesize) {
+        *cp;
+    }
+
+    return (length);
+}
+
 } // namespace util
 } // namespace bundy
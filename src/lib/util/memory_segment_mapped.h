@@ -133,6 +133,12 @@ public:
     /// detects violation of the restriction on the mixed open of read-only
     /// and read-write mode (see the class description).
     ///
+    /// An existing file created by an older version that doesn't allocate
+    /// small objects with a slab allocator can only be opened by this
+    /// constructor if nothing is allocated in it; otherwise
+    /// \c MemorySegmentOpenError is thrown, and the file must be created
+    /// again.  Such a file can still be opened in the read-only mode.
+    ///
     /// When initial_size is specified but is too small (including a value of
     /// 0), the underlying Boost library will reject it, and this constructor
     /// throws \c MemorySegmentOpenError exception.  The Boost documentation
@@ -158,6 +164,13 @@ public:
 
     /// \brief Allocate/acquire a segment of memory.
     ///
+    /// Objects up to \c SlabAllocator::MAX_OBJECT_SIZE bytes are allocated
+    /// by a \c SlabAllocator stored in the segment from chunks of the
+    /// underlying segment, so they don't have a per object header; larger
+    /// ones are directly allocated from the underlying segment.  A
+    /// \c MemorySegmentGrown exception can also be thrown when a new chunk
+    /// doesn't fit in the segment.
+    ///
     /// This version can throw \c MemorySegmentGrown.  Furthermore, there is
     /// a very small chance that the object loses its integrity and can't be
     /// usable in the case where \c MemorySegmentGrown would be thrown.
@@ -177,7 +190,13 @@ public:
     /// if this segment object was constructed for an existing file to map,
     /// the underlying segment may already contain allocated regions, so
     /// this object cannot reliably detect whether it's safe to deallocate
-    /// the given size of memory from the underlying segment.
+    /// the given size of memory from the underlying segment.  But as the
+    /// size determines whether and in which size class \c ptr was allocated
+    /// by the allocator of small objects, it must be the size passed to
+    /// \c allocate(), or at least in the same size class of
+    /// \c SlabAllocator.  Deallocating a small object with a wrong size or
+    /// twice is detected (with an assertion failure) only if no other
+    /// object of the size class is allocated.
     ///
     /// Parameter \c ptr must point to an address that was returned by a
     /// prior call to \c allocate() of this segment object, and there should
@@ -190,8 +209,26 @@ public:
     /// read-only mode; in that case MemorySegmentError will be thrown.
     virtual void deallocate(void* ptr, size_t size);
 
+    /// \brief Mapped segment version of allMemoryDeallocated.
+    ///
+    /// This checks the allocated size stored in the segment and that there
+    /// is no named address, so the result is only correct if the size
+    /// passed to \c deallocate() was correct.  The chunks of small objects
+    /// are kept in the segment for later allocations.
+    ///
+    /// \throw None
     virtual bool allMemoryDeallocated() const;
 
+    /// \brief Mapped segment version of getAllocatedSize.
+    ///
+    /// The size is stored in the segment, so it's kept across opens of
+    /// the segment and can also be retrieved in the read-only mode.  A
+    /// segment created by an older version doesn't store it; it's 0 in
+    /// the read-only mode and is only meaningful as a difference otherwise.
+    ///
+    /// \throw None
+    virtual size_t getAllocatedSize() const;
+
     /// \brief Mapped segment version of setNamedAddress.
     ///
     /// This implementation detects if \c addr is invalid (see the base class
@@ -261,6 +298,59 @@ public:
     /// \throw None
     size_t getCheckSum() const;
 
+    /// \brief Tell the kernel that the whole segment will be needed soon.
+    ///
+    /// This is a hint with \c MADV_WILLNEED, so the kernel starts reading
+    /// the pages of the underlying file that are not in the page cache
+    /// asynchronously.  It doesn't map the pages, so the first access to
+    /// each page can still cause a (minor) page fault; see \c prefault()
+    /// for that.
+    ///
+    /// As it's only a hint, failure is not fatal and is only reported by
+    /// the return value.
+    ///
+    /// \throw None
+    /// \return true if the kernel accepted the hint; false otherwise.
+    bool adviseWillNeed() const;
+
+    /// \brief Ask the kernel to back the segment with huge pages.
+    ///
+    /// This is a hint with \c MADV_HUGEPAGE, which reduces TLB misses
+    /// when a large segment is accessed randomly.  Whether it has an
+    /// effect depends on the file system of the mapped file and the
+    /// kernel configuration; for example, a file on a tmpfs mounted with
+    /// "huge=advise" is allocated in huge pages when it's written through
+    /// an advised mapping.  Unlike \c adviseWillNeed(), the hint is
+    /// remembered and given again whenever the segment is remapped as
+    /// it grows or shrinks.
+    ///
+    /// \throw None
+    /// \return true if the kernel accepted the hint; false if it was
+    /// rejected or huge pages are not supported on this system.
+    bool useHugePages();
+
+    /// \brief Fault in pages of the segment.
+    ///
+    /// This method maps the pages of the given range of the segment into
+    /// the address space, reading them from the underlying file if they
+    /// are not in the page cache, so subsequent accesses to the range won't
+    /// cause a page fault.  It uses \c MADV_POPULATE_READ where available,
+    /// and otherwise reads a byte of each page as \c getCheckSum() does.
+    ///
+    /// The range is clipped to the segment.  Large segments can be
+    /// faulted in piece by piece by calling this method with increasing
+    /// \c offset until it returns 0.  This method only reads the segment,
+    /// so it can be called in a separate thread while other threads
+    /// read the segment, as long as the segment is not remapped (which
+    /// never happens in the read-only mode).
+    ///
+    /// \throw None
+    /// \param offset The offset of the range from the start of the segment.
+    /// \param length The length of the range in bytes.
+    /// \return The number of bytes faulted in (0 if \c offset is beyond
+    /// the segment).
+    size_t prefault(size_t offset, size_t length) const;
+
 private:
     struct Impl;
     Impl* impl_;
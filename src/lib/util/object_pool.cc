@@ -0,0 +1,148 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/object_pool.h>
+
+#include <pthread.h>
+
+namespace bundy {
+namespace util {
+
+const size_t ObjectPool::GRANULARITY;
+const size_t ObjectPool::MAX_OBJECT_SIZE;
+const size_t ObjectPool::MAX_FREE_BLOCKS;
+
+namespace {
+const size_t CLASS_COUNT =
+    ObjectPool::MAX_OBJECT_SIZE / ObjectPool::GRANULARITY;
+
+// A free block; the memory of the block itself is used for the link.
+struct FreeBlock {
+    FreeBlock* next_;
+};
+
+struct FreeList {
+    FreeBlock* head_;
+    size_t count_;
+};
+
+// The pool of a thread.  It's only accessed by the owner thread, so no
+// locking is needed.
+struct ThreadPool {
+    FreeList lists_[CLASS_COUNT];
+};
+
+pthread_key_t pool_key;
+pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+bool pool_key_created = false;
+
+// Called on the exit of a thread with its pool.
+void
+destroyPool(void* arg) {
+    ThreadPool* pool = static_cast<ThreadPool*>(arg);
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        FreeBlock* block = pool->lists_[i].head_;
+        while (block != NULL) {
+            FreeBlock* next = block->next_;
+            ::operator delete(block);
+            block = next;
+        }
+    }
+    delete pool;
+}
+
+void
+createPoolKey() {
+    // This can only fail due to a resource shortage, in which case we
+    // simply don't use the pool.
+    pool_key_created = (pthread_key_create(&pool_key, destroyPool) == 0);
+}
+
+// Return the pool of the calling thread, creating it on the first call.
+// NULL is returned if the pool can't be used.
+ThreadPool*
+getPool() {
+    pthread_once(&pool_key_once, createPoolKey);
+    if (!pool_key_created) {
+        return (NULL);
+    }
+    ThreadPool* pool = static_cast<ThreadPool*>(pthread_getspecific(pool_key));
+    if (pool == NULL) {
+        pool = new(std::nothrow) ThreadPool();
+        if (pool != NULL && pthread_setspecific(pool_key, pool) != 0) {
+            delete pool;
+            pool = NULL;
+        }
+    }
+    return (pool);
+}
+
+inline size_t
+getClass(size_t size) {
+    return ((size + ObjectPool::GRANULARITY - 1) / ObjectPool::GRANULARITY -
+            1);
+}
+}
+
+void*
+ObjectPool::allocate(size_t size) {
+    if (size == 0 || size > MAX_OBJECT_SIZE) {
+        return (::operator new(size));
+    }
+    const size_t cls = getClass(size);
+    ThreadPool* pool = getPool();
+    if (pool != NULL) {
+        FreeList& list = pool->lists_[cls];
+        if (list.head_ != NULL) {
+            FreeBlock* block = list.head_;
+            list.head_ = block->next_;
+            --list.count_;
+            return (block);
+        }
+    }
+    return (::operator new((cls + 1) * GRANULARITY));
+}
+
+void
+ObjectPool::deallocate(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (size > 0 && size <= MAX_OBJECT_SIZE) {
+        ThreadPool* pool = getPool();
+        if (pool != NULL) {
+            FreeList& list = pool->lists_[getClass(size)];
+            if (list.count_ < MAX_FREE_BLOCKS) {
+                FreeBlock* block = static_cast<FreeBlock*>(ptr);
+                block->next_ = list.head_;
+                list.head_ = block;
+                ++list.count_;
+                return;
+            }
+        }
+    }
+    ::operator delete(ptr);
+}
+
+size_t
+ObjectPool::getFreeCount(size_t size) {
+    if (size == 0 || size > MAX_OBJECT_SIZE) {
+        return (0);
+    }
+    const ThreadPool* pool = getPool();
+    return (pool != NULL ? pool->lists_[getClass(size)].count_ : 0);
+}
+
+} // namespace util
+} // namespace bundy
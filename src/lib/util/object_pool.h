@@ -0,0 +1,134 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef UTIL_OBJECT_POOL_H
+#define UTIL_OBJECT_POOL_H 1
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace bundy {
+namespace util {
+
+/// \brief Per-thread pool of memory for small objects.
+///
+/// This class provides memory for objects that are created and destroyed
+/// repeatedly, like the RRsets and RDATA of DNS messages processed by a
+/// server.  Deallocated memory is kept in free lists of the deallocating
+/// thread, one for each size class (multiples of \c GRANULARITY bytes),
+/// and reused by subsequent allocations of the same size class in that
+/// thread.  So once enough memory is allocated, such objects can be created
+/// and destroyed without calling malloc() or free() or locking.
+///
+/// As each block of memory is individually taken from the global operator
+/// new, it can be deallocated in a different thread than the one that
+/// allocated it (it's then kept in the pool of that thread), and an object
+/// that lives long doesn't prevent other memory from being reused.  At most
+/// \c MAX_FREE_BLOCKS blocks are kept in each free list; others are released
+/// with the global operator delete, as well as the kept blocks when the
+/// thread exits.  Sizes larger than \c MAX_OBJECT_SIZE are not pooled.
+///
+/// All methods are static; the pool of the calling thread is used.
+class ObjectPool {
+public:
+    /// \brief The granularity of size classes.
+    ///
+    /// The size of a block is rounded up to a multiple of this value, which
+    /// is also the alignment for any object type used in this library.
+    static const size_t GRANULARITY = 16;
+
+    /// \brief The largest size of objects allocated from the pool.
+    static const size_t MAX_OBJECT_SIZE = 1024;
+
+    /// \brief The maximum number of blocks kept in each free list.
+    static const size_t MAX_FREE_BLOCKS = 1024;
+
+    /// \brief Allocate memory of the given size.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    static void* allocate(size_t size);
+
+    /// \brief Deallocate memory allocated by \c allocate().
+    ///
+    /// \c size must be the same as the one given to \c allocate().
+    ///
+    /// \throw None
+    static void deallocate(void* ptr, size_t size);
+
+    /// \brief Return the number of free blocks kept for the given size in
+    /// the pool of the calling thread.
+    ///
+    /// This is mainly for testing.
+    static size_t getFreeCount(size_t size);
+};
+
+/// \brief A standard allocator using \c ObjectPool.
+///
+/// This is intended to be used with \c boost::allocate_shared() so that
+/// both the object and the reference counter of the shared pointer are in a
+/// single block taken from the pool, and with containers of objects that
+/// are frequently created.
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U> other;
+    };
+
+    PoolAllocator() {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    pointer address(reference x) const { return (&x); }
+    const_pointer address(const_reference x) const { return (&x); }
+
+    pointer allocate(size_type n, const void* = 0) {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+        return (static_cast<pointer>(ObjectPool::allocate(n * sizeof(T))));
+    }
+    void deallocate(pointer p, size_type n) {
+        ObjectPool::deallocate(p, n * sizeof(T));
+    }
+
+    size_type max_size() const {
+        return (std::numeric_limits<size_type>::max() / sizeof(T));
+    }
+
+    void construct(pointer p, const T& val) { new(p) T(val); }
+    void destroy(pointer p) { p->~T(); }
+
+    bool operator==(const PoolAllocator&) const { return (true); }
+    bool operator!=(const PoolAllocator&) const { return (false); }
+};
+
+} // namespace util
+} // namespace bundy
+
+#endif // UTIL_OBJECT_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
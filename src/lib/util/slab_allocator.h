@@ -0,0 +1,359 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef UTIL_SLAB_ALLOCATOR_H
+#define UTIL_SLAB_ALLOCATOR_H 1
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace util {
+
+namespace detail {
+// Return the raw address of a void pointer, which may be a "smart" pointer
+// like boost::interprocess::offset_ptr<void>.
+inline void*
+getRawPointer(void* ptr) {
+    return (ptr);
+}
+
+template <typename Pointer>
+void*
+getRawPointer(const Pointer& ptr) {
+    return (ptr.get());
+}
+}
+
+/// \brief Segregated size-class allocator of small objects.
+///
+/// This class is the allocator of small objects for the \c MemorySegment
+/// implementations.  The data stored in a segment, like zone data, mostly
+/// consist of a large number of small objects in a limited variety of
+/// sizes.  A general purpose allocator spends a header for each of them and
+/// searches for a free block to allocate, while this allocator carves
+/// objects of the same size class out of larger chunks of memory with
+/// no per object overhead.  Deallocated objects are kept in a free list of
+/// their size class, and reused by subsequent allocations of that class.
+///
+/// The allocator doesn't allocate chunks by itself, so it can manage
+/// memory of any kind of segment: if \c allocate() returns NULL, the segment
+/// allocates a chunk of \c getChunkSize() bytes in its own way and passes
+/// it with \c addChunk(); it takes back the chunks with \c releaseChunk()
+/// when all the objects are gone or the segment is destroyed.  The size of
+/// an object is not recorded, so \c deallocate() must be given the size
+/// that was passed to \c allocate() (which \c MemorySegment::deallocate()
+/// requires anyway).  The allocator counts the objects of each size class,
+/// so deallocating an object in a class that has no allocated object (for
+/// example, with a wrong size or twice) triggers an assertion failure, but
+/// other misuse isn't detected.
+///
+/// The state of the allocator is self-contained and refers to the memory
+/// only via \c VoidPointer, so with a relative pointer type like
+/// \c boost::interprocess::offset_ptr<void> the allocator object itself can
+/// be placed in a mapped segment, and remains valid when the segment is
+/// remapped at a different address or in another process.
+///
+/// Sizes up to 128 bytes are rounded up to a multiple of 8 bytes, and larger
+/// ones up to \c MAX_OBJECT_SIZE to 8 classes per power of two, so the
+/// space lost in rounding is at most 7 bytes, or 1/8 of the object if it's
+/// larger than 64 bytes.  Objects are aligned to 8 bytes, and those of size
+/// classes of multiples of 16 bytes to 16 bytes if the chunks are.  Each
+/// chunk of a size class is twice as large as the previous one (up to
+/// \c MAX_CHUNK_SIZE), so small data don't waste much memory in a partially
+/// used chunk while large data are allocated in a small number of chunks.
+///
+/// This class is not thread safe.
+template <typename VoidPointer>
+class SlabAllocator : boost::noncopyable {
+public:
+    /// \brief The largest size of objects allocated by this allocator.
+    static const size_t MAX_OBJECT_SIZE = 1024;
+
+    /// \brief The number of size classes.
+    static const size_t CLASS_COUNT = 40;
+
+    /// \brief The minimum size of the first chunk of a size class.
+    static const size_t MIN_CHUNK_SIZE = 256;
+
+    /// \brief The maximum size of chunks, unless a single object is larger.
+    static const size_t MAX_CHUNK_SIZE = 65536;
+
+    /// \brief Constructor of an allocator without chunks.
+    SlabAllocator() : chunks_(), chunk_size_(0), object_count_(0) {
+        resetClasses();
+    }
+
+    /// \brief Return the size class of a size.
+    ///
+    /// \c size must not be larger than \c MAX_OBJECT_SIZE.
+    static size_t getClass(size_t size) {
+        assert(size <= MAX_OBJECT_SIZE);
+        if (size <= LINEAR_LIMIT) {
+            return (size == 0 ? 0 : (size - 1) / LINEAR_GRANULARITY);
+        }
+        size_t group = 0;
+        size_t limit = LINEAR_LIMIT * 2;
+        while (size > limit) {
+            ++group;
+            limit *= 2;
+        }
+        return (LINEAR_CLASSES + group * GROUP_CLASSES +
+                ((size - 1 - limit / 2) >> (GROUP_SHIFT + group)));
+    }
+
+    /// \brief Return the size of the objects of a size class.
+    static size_t getClassSize(size_t cls) {
+        assert(cls < CLASS_COUNT);
+        if (cls < LINEAR_CLASSES) {
+            return ((cls + 1) * LINEAR_GRANULARITY);
+        }
+        const size_t group = (cls - LINEAR_CLASSES) / GROUP_CLASSES;
+        return ((LINEAR_LIMIT << group) +
+                ((cls - LINEAR_CLASSES) % GROUP_CLASSES + 1) *
+                (static_cast<size_t>(1) << (GROUP_SHIFT + group)));
+    }
+
+    /// \brief Allocate an object.
+    ///
+    /// \c size must not be larger than \c MAX_OBJECT_SIZE.
+    ///
+    /// \throw None
+    /// \return The allocated object, or NULL if a chunk must be added
+    /// for the size class with \c addChunk().
+    void* allocate(size_t size) {
+        const size_t cls = getClass(size);
+        SizeClass& sc = classes_[cls];
+        void* ptr;
+        if (sc.free_) {
+            ptr = detail::getRawPointer(sc.free_);
+            sc.free_ = *static_cast<VoidPointer*>(ptr);
+        } else if (sc.remaining_ > 0) {
+            ptr = detail::getRawPointer(sc.next_);
+            sc.next_ = static_cast<char*>(ptr) + getClassSize(cls);
+            --sc.remaining_;
+        } else {
+            return (NULL);
+        }
+        ++sc.objects_;
+        ++object_count_;
+        return (ptr);
+    }
+
+    /// \brief Deallocate an object allocated by \c allocate().
+    ///
+    /// \c size must be the same as the one given to \c allocate() (or at
+    /// least in the same size class).
+    ///
+    /// \throw None
+    void deallocate(void* ptr, size_t size) {
+        SizeClass& sc = classes_[getClass(size)];
+        assert(sc.objects_ > 0);
+        new(ptr) VoidPointer(sc.free_);
+        sc.free_ = ptr;
+        --sc.objects_;
+        --object_count_;
+    }
+
+    /// \brief Return the size of the chunk to be added for a size.
+    ///
+    /// This is the size \c addChunk() expects when \c allocate() returns
+    /// NULL for \c size.
+    size_t getChunkSize(size_t size) const {
+        const size_t cls = getClass(size);
+        return (sizeof(Chunk) +
+                getClassSize(cls) * getChunkObjects(classes_[cls], cls));
+    }
+
+    /// \brief Add a chunk for a size class.
+    ///
+    /// This must be called only after \c allocate() returned NULL for
+    /// \c size, with \c chunk pointing to memory of \c getChunkSize() bytes
+    /// for the size, aligned to at least 8 bytes.  The allocator owns the
+    /// chunk until it's taken back by \c releaseChunk().
+    ///
+    /// \throw None
+    void addChunk(size_t size, void* chunk) {
+        const size_t cls = getClass(size);
+        SizeClass& sc = classes_[cls];
+        assert(!sc.free_ && sc.remaining_ == 0);
+        const size_t objects = getChunkObjects(sc, cls);
+        const size_t class_size = getClassSize(cls);
+        Chunk* const header = new(chunk) Chunk;
+        header->next_ = chunks_;
+        header->size_ = sizeof(Chunk) + class_size * objects;
+        chunks_ = chunk;
+        chunk_size_ += header->size_;
+        sc.next_ = static_cast<char*>(chunk) + sizeof(Chunk);
+        sc.remaining_ = objects;
+        if (objects * 2 * class_size <= MAX_CHUNK_SIZE) {
+            sc.chunk_objects_ = objects * 2;
+        } else {
+            sc.chunk_objects_ = objects;
+        }
+    }
+
+    /// \brief Take back a chunk.
+    ///
+    /// All the objects allocated from the chunks become invalid (they are
+    /// expected to have been deallocated), and the allocator forgets all
+    /// the free objects.  This method should be called repeatedly until it
+    /// returns NULL to take back all the chunks.
+    ///
+    /// \throw None
+    /// \return A chunk passed to \c addChunk(), or NULL if there's none.
+    void* releaseChunk() {
+        resetClasses();
+        object_count_ = 0;
+        if (!chunks_) {
+            return (NULL);
+        }
+        void* const chunk = detail::getRawPointer(chunks_);
+        const Chunk* const header = static_cast<const Chunk*>(chunk);
+        chunks_ = header->next_;
+        chunk_size_ -= header->size_;
+        return (chunk);
+    }
+
+    /// \brief Take over the chunks and objects of another allocator.
+    ///
+    /// The objects allocated by \c other can (and must) be deallocated via
+    /// this allocator afterwards, and \c other becomes empty.  The cost is
+    /// proportional to the number of free objects of \c other.
+    ///
+    /// \throw None
+    void merge(SlabAllocator& other) {
+        assert(&other != this);
+        if (other.chunks_) {
+            Chunk* tail = static_cast<Chunk*>(
+                detail::getRawPointer(other.chunks_));
+            while (tail->next_) {
+                tail = static_cast<Chunk*>(detail::getRawPointer(tail->next_));
+            }
+            tail->next_ = chunks_;
+            chunks_ = other.chunks_;
+            other.chunks_ = VoidPointer();
+        }
+        for (size_t cls = 0; cls < CLASS_COUNT; ++cls) {
+            SizeClass& sc = classes_[cls];
+            SizeClass& other_sc = other.classes_[cls];
+            while (other_sc.free_) {
+                void* const ptr = detail::getRawPointer(other_sc.free_);
+                other_sc.free_ = *static_cast<VoidPointer*>(ptr);
+                new(ptr) VoidPointer(sc.free_);
+                sc.free_ = ptr;
+            }
+            if (sc.remaining_ == 0) {
+                sc.next_ = other_sc.next_;
+                sc.remaining_ = other_sc.remaining_;
+            } else {
+                for (; other_sc.remaining_ > 0; --other_sc.remaining_) {
+                    void* const ptr = detail::getRawPointer(other_sc.next_);
+                    other_sc.next_ = static_cast<char*>(ptr) +
+                        getClassSize(cls);
+                    new(ptr) VoidPointer(sc.free_);
+                    sc.free_ = ptr;
+                }
+            }
+            sc.chunk_objects_ = std::max(sc.chunk_objects_,
+                                         other_sc.chunk_objects_);
+            sc.objects_ += other_sc.objects_;
+        }
+        chunk_size_ += other.chunk_size_;
+        object_count_ += other.object_count_;
+        other.chunk_size_ = 0;
+        other.object_count_ = 0;
+        other.resetClasses();
+    }
+
+    /// \brief Return the number of objects currently allocated.
+    size_t getObjectCount() const { return (object_count_); }
+
+    /// \brief Return the total size of the chunks currently owned.
+    size_t getChunkSize() const { return (chunk_size_); }
+
+private:
+    static const size_t LINEAR_GRANULARITY = 8;
+    static const size_t LINEAR_LIMIT = 128;
+    static const size_t LINEAR_CLASSES = LINEAR_LIMIT / LINEAR_GRANULARITY;
+    static const size_t GROUP_CLASSES = 8;
+    static const size_t GROUP_SHIFT = 4; // log2(LINEAR_LIMIT / GROUP_CLASSES)
+
+    // The header of a chunk, followed by the objects.  It's 16 bytes on
+    // common platforms, so the objects are aligned as the chunk is.
+    struct Chunk {
+        VoidPointer next_;
+        size_t size_;
+    };
+
+    // The counts are 32-bit so the allocator object stays small enough
+    // for the initial size of a mapped segment; a chunk has far fewer
+    // objects, and more than 2^32 objects of a class would need tens of
+    // gigabytes.
+    struct SizeClass {
+        VoidPointer free_;      // head of the free list
+        VoidPointer next_;      // next unused object of the last chunk
+        uint32_t remaining_;    // number of unused objects in the last chunk
+        uint32_t chunk_objects_; // number of objects of the next chunk
+        uint32_t objects_;      // number of allocated objects
+    };
+
+    static size_t getChunkObjects(const SizeClass& sc, size_t cls) {
+        if (sc.chunk_objects_ > 0) {
+            return (sc.chunk_objects_);
+        }
+        const size_t class_size = getClassSize(cls);
+        return ((MIN_CHUNK_SIZE - sizeof(Chunk) + class_size - 1) /
+                class_size);
+    }
+
+    void resetClasses() {
+        for (size_t cls = 0; cls < CLASS_COUNT; ++cls) {
+            classes_[cls].free_ = VoidPointer();
+            classes_[cls].next_ = VoidPointer();
+            classes_[cls].remaining_ = 0;
+            classes_[cls].chunk_objects_ = 0;
+            classes_[cls].objects_ = 0;
+        }
+    }
+
+    SizeClass classes_[CLASS_COUNT];
+    VoidPointer chunks_;
+    size_t chunk_size_;
+    size_t object_count_;
+};
+
+template <typename VoidPointer>
+const size_t SlabAllocator<VoidPointer>::MAX_OBJECT_SIZE;
+template <typename VoidPointer>
+const size_t SlabAllocator<VoidPointer>::CLASS_COUNT;
+template <typename VoidPointer>
+const size_t SlabAllocator<VoidPointer>::MIN_CHUNK_SIZE;
+template <typename VoidPointer>
+const size_t SlabAllocator<VoidPointer>::MAX_CHUNK_SIZE;
+
+} // namespace util
+} // namespace bundy
+
+#endif // UTIL_SLAB_ALLOCATOR_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,242 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+
+#include <util/encode/base32hex.h>
+#include <util/encode/base64.h>
+#include <util/encode/hex.h>
+#include <util/encode/base_n_internal.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bundy;
+using namespace bundy::util::encode;
+using namespace bundy::util::encode::internal;
+
+// Tests for the implementations of the baseN encoding: all of them should
+// produce the same results as the reference implementation for random
+// input, including invalid input.  The specific cases are tested in the
+// tests for each encoding with the default implementation.
+
+namespace {
+
+typedef string (*EncodeFunc)(const vector<uint8_t>&);
+typedef void (*DecodeFunc)(const string&, vector<uint8_t>&);
+
+struct Encoding {
+    const char* name;
+    EncodeFunc encode;
+    DecodeFunc decode;
+};
+
+const Encoding encodings[] = {
+    { "base64", encodeBase64, decodeBase64 },
+    { "base32hex", encodeBase32Hex, decodeBase32Hex },
+    { "base16", encodeHex, decodeHex }
+};
+
+const CodecImpl implementations[] = {
+    CODEC_SCALAR, CODEC_SSSE3, CODEC_AVX2
+};
+
+class BaseNTest : public ::testing::Test {
+protected:
+    BaseNTest() : default_impl_(getCodecImpl()), seed_(1) {}
+    ~BaseNTest() {
+        selectCodecImpl(default_impl_);
+    }
+
+    // A simple deterministic pseudo random number generator, so any
+    // failure can be reproduced.
+    uint32_t random(uint32_t limit) {
+        seed_ = seed_ * 1103515245 + 12345;
+        return ((seed_ >> 8) % limit);
+    }
+
+    void randomData(size_t len, vector<uint8_t>& data) {
+        data.resize(len);
+        for (size_t i = 0; i < len; ++i) {
+            data[i] = random(256);
+        }
+    }
+
+    // Return a string representing the result of decoding the input with
+    // the given implementation, so they can be compared.
+    string decodeResult(CodecImpl impl, const Encoding& encoding,
+                        const string& input)
+    {
+        EXPECT_TRUE(selectCodecImpl(impl));
+        try {
+            vector<uint8_t> result;
+            encoding.decode(input, result);
+            return (string(result.begin(), result.end()));
+        } catch (const BadValue&) {
+            return ("(error)");
+        }
+    }
+
+    // Make a random change to the encoded text, which may or may not make
+    // it invalid.
+    void mutate(string& text) {
+        const char specials[] = " \t\n=A/+z09\x80\xff!*";
+        const size_t pos = text.empty() ? 0 : random(text.size());
+        switch (random(5)) {
+        case 0:                 // insert a space
+            text.insert(pos, 1, " \t\r\n"[random(4)]);
+            break;
+        case 1:                 // replace a character
+            if (!text.empty()) {
+                text[pos] = specials[random(sizeof(specials) - 1)];
+            }
+            break;
+        case 2:                 // remove a character
+            if (!text.empty()) {
+                text.erase(pos, 1);
+            }
+            break;
+        case 3:                 // add padding
+            text.append(random(3), '=');
+            break;
+        default:                // change case
+            if (!text.empty()) {
+                text[pos] ^= 0x20;
+            }
+            break;
+        }
+    }
+
+    const CodecImpl default_impl_;
+    uint32_t seed_;
+};
+
+TEST_F(BaseNTest, defaultImpl) {
+    // The default should be the best available one.
+    EXPECT_NE(CODEC_REFERENCE, default_impl_);
+    EXPECT_TRUE(isCodecAvailable(default_impl_));
+    if (isCodecAvailable(CODEC_AVX2)) {
+        EXPECT_EQ(CODEC_AVX2, default_impl_);
+    }
+
+    // Unavailable ones can't be selected.
+    for (size_t i = 0;
+         i < sizeof(implementations) / sizeof(implementations[0]);
+         ++i) {
+        const CodecImpl impl = implementations[i];
+        EXPECT_EQ(isCodecAvailable(impl), selectCodecImpl(impl));
+    }
+    EXPECT_TRUE(isCodecAvailable(CODEC_REFERENCE));
+    EXPECT_TRUE(isCodecAvailable(CODEC_SCALAR));
+}
+
+TEST_F(BaseNTest, encode) {
+    for (size_t i = 0;
+         i < sizeof(implementations) / sizeof(implementations[0]);
+         ++i) {
+        const CodecImpl impl = implementations[i];
+        if (!isCodecAvailable(impl)) {
+            continue;
+        }
+        for (size_t j = 0; j < sizeof(encodings) / sizeof(encodings[0]);
+             ++j) {
+            const Encoding& encoding = encodings[j];
+            vector<uint8_t> data;
+            // Cover all lengths around the block sizes of the vectorized
+            // implementations.
+            for (size_t len = 0; len < 200; ++len) {
+                randomData(len, data);
+                selectCodecImpl(CODEC_REFERENCE);
+                const string expected = encoding.encode(data);
+                selectCodecImpl(impl);
+                EXPECT_EQ(expected, encoding.encode(data))
+                    << "impl=" << impl << ", " << encoding.name
+                    << ", len=" << len;
+            }
+        }
+    }
+}
+
+TEST_F(BaseNTest, decode) {
+    for (size_t i = 0;
+         i < sizeof(implementations) / sizeof(implementations[0]);
+         ++i) {
+        const CodecImpl impl = implementations[i];
+        if (!isCodecAvailable(impl)) {
+            continue;
+        }
+        for (size_t j = 0; j < sizeof(encodings) / sizeof(encodings[0]);
+             ++j) {
+            const Encoding& encoding = encodings[j];
+            vector<uint8_t> data;
+            for (size_t n = 0; n < 3000; ++n) {
+                randomData(random(120), data);
+                string text = encoding.encode(data);
+                // Apply a few random changes to most of the texts, so both
+                // valid and invalid input are tested.
+                const size_t changes = random(4);
+                for (size_t k = 0; k < changes; ++k) {
+                    mutate(text);
+                }
+                const string expected =
+                    decodeResult(CODEC_REFERENCE, encoding, text);
+                EXPECT_EQ(expected, decodeResult(impl, encoding, text))
+                    << "impl=" << impl << ", " << encoding.name
+                    << ", input=" << text;
+                if (changes == 0) {
+                    EXPECT_EQ(string(data.begin(), data.end()), expected);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(BaseNTest, decodeSpecialCases) {
+    // Some cases around padding and spaces that random changes would
+    // rarely produce.
+    const char* const inputs[] = {
+        "", " ", "=", "==", " ==", "A==", "AA==", "AA ==", "AA= =",
+        "AA==  ", "AAA=", "AAAA", "AAAA=", "AAAA====", "Zm9vYmFy\n",
+        "Zm9v\nYmFy", "Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFy",
+        "Zm9vYmFyZm9vYmFyZm9v YmFyZm9vYmFyZm9vYmFyZm9vYmFy",
+        "Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmF=",
+        "0123456789abcdefABCDEF0123456789abcdefABCDEF",
+        "0123456789abcdef ABCDEF0123456789abcdefABCDEF01",
+        "CPNMUOJ1", "CPNMUOG=", "CPNMU===", "CPNMUOJ1E8======",
+        "cpnmuoj1 e8======", "CPNMUOJ1E8=====", NULL
+    };
+    for (size_t i = 0;
+         i < sizeof(implementations) / sizeof(implementations[0]);
+         ++i) {
+        const CodecImpl impl = implementations[i];
+        if (!isCodecAvailable(impl)) {
+            continue;
+        }
+        for (size_t j = 0; j < sizeof(encodings) / sizeof(encodings[0]);
+             ++j) {
+            for (size_t k = 0; inputs[k] != NULL; ++k) {
+                EXPECT_EQ(decodeResult(CODEC_REFERENCE, encodings[j],
+                                       inputs[k]),
+                          decodeResult(impl, encodings[j], inputs[k]))
+                    << "impl=" << impl << ", " << encodings[j].name
+                    << ", input=" << inputs[k];
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,94 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/cpu_features.h>
+
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+
+using namespace bundy::util;
+
+namespace {
+enum TestImpl {
+    TEST_IMPL_NONE,
+    TEST_IMPL_SLOW,
+    TEST_IMPL_FAST
+};
+
+// Statically initialized (unselected), as in the modules using it.
+ImplSelector<TestImpl> selector;
+int select_count = 0;           // protected by the lock of ImplSelector
+
+TestImpl
+selectFast() {
+    ++select_count;
+    return (TEST_IMPL_FAST);
+}
+
+void*
+getInThread(void*) {
+    for (int i = 0; i < 1000; ++i) {
+        if (selector.get(selectFast) != TEST_IMPL_FAST) {
+            return (&selector); // anything other than NULL means failure
+        }
+    }
+    return (NULL);
+}
+
+TEST(CPUFeaturesTest, hasCPUFeature) {
+#ifdef BUNDY_CPU_SSE2
+    EXPECT_TRUE(hasCPUFeature(CPU_SSE2));
+#else
+    EXPECT_FALSE(hasCPUFeature(CPU_SSE2));
+#endif
+#ifndef BUNDY_CPU_SSSE3
+    EXPECT_FALSE(hasCPUFeature(CPU_SSSE3));
+#endif
+#ifdef BUNDY_CPU_AVX2
+    // Any processor supporting AVX2 supports SSSE3.
+    if (hasCPUFeature(CPU_AVX2)) {
+        EXPECT_TRUE(hasCPUFeature(CPU_SSSE3));
+    }
+#else
+    EXPECT_FALSE(hasCPUFeature(CPU_AVX2));
+#endif
+}
+
+TEST(CPUFeaturesTest, implSelector) {
+    // The selection function is called only once, even if the first uses
+    // are concurrent.
+    pthread_t threads[4];
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, getInThread, NULL));
+    }
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        void* result;
+        ASSERT_EQ(0, pthread_join(threads[i], &result));
+        EXPECT_EQ(static_cast<void*>(NULL), result);
+    }
+    EXPECT_EQ(1, select_count);
+
+    // An explicitly set implementation overrides the selection.
+    selector.set(TEST_IMPL_SLOW);
+    EXPECT_EQ(TEST_IMPL_SLOW, selector.get(selectFast));
+    EXPECT_EQ(1, select_count);
+
+    // A selector set before the first use never calls the function.
+    ImplSelector<TestImpl> other = ImplSelector<TestImpl>();
+    other.set(TEST_IMPL_SLOW);
+    EXPECT_EQ(TEST_IMPL_SLOW, other.get(selectFast));
+    EXPECT_EQ(1, select_count);
+}
+}
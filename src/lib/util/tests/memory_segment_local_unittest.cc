@@ -108,9 +108,50 @@ TEST(MemorySegmentLocal, TestNullDeallocate) {
     EXPECT_TRUE(segment->allMemoryDeallocated());
 }
 
+TEST(MemorySegmentLocal, getAllocatedSize) {
+    MemorySegmentLocal segment1, segment2;
+    EXPECT_EQ(0, segment1.getAllocatedSize());
+    void* ptr1 = segment1.allocate(1024);
+    void* ptr2 = segment1.allocate(42);
+    EXPECT_EQ(1066, segment1.getAllocatedSize());
+    segment1.deallocate(ptr1, 1024);
+    EXPECT_EQ(42, segment1.getAllocatedSize());
+
+    // Merged memory is counted in the segment it's merged into.
+    void* ptr3 = segment2.allocate(100);
+    segment1.merge(segment2);
+    EXPECT_EQ(142, segment1.getAllocatedSize());
+    EXPECT_EQ(0, segment2.getAllocatedSize());
+    segment1.deallocate(ptr2, 42);
+    segment1.deallocate(ptr3, 100);
+    EXPECT_EQ(0, segment1.getAllocatedSize());
+}
+
 TEST(MemorySegmentLocal, namedAddress) {
     MemorySegmentLocal segment;
     bundy::util::test::checkSegmentNamedAddress(segment, true);
 }
 
+TEST(MemorySegmentLocal, merge) {
+    MemorySegmentLocal segment1, segment2;
+    void* ptr1 = segment1.allocate(1024);
+    void* ptr2 = segment2.allocate(42);
+
+    // After merge, memory allocated from segment2 belongs to segment1.
+    segment1.merge(segment2);
+    EXPECT_TRUE(segment2.allMemoryDeallocated());
+    EXPECT_THROW(segment2.deallocate(ptr2, 42), bundy::OutOfRange);
+    segment1.deallocate(ptr2, 42);
+    EXPECT_FALSE(segment1.allMemoryDeallocated());
+    segment1.deallocate(ptr1, 1024);
+    EXPECT_TRUE(segment1.allMemoryDeallocated());
+
+    // A segment with a named address can't be merged, nor can the segment
+    // itself.
+    segment2.setNamedAddress("test address", NULL);
+    EXPECT_THROW(segment1.merge(segment2), bundy::InvalidParameter);
+    segment2.clearNamedAddress("test address");
+    EXPECT_THROW(segment1.merge(segment1), bundy::InvalidParameter);
+}
+
 } // anonymous namespace
@@ -17,12 +17,15 @@
 #include <util/unittests/interprocess_util.h>
 
 #include <util/memory_segment_mapped.h>
+#include <util/slab_allocator.h>
 #include <exceptions/exceptions.h>
 
 #include <gtest/gtest.h>
 
 #include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/foreach.hpp>
 
@@ -203,6 +206,50 @@ TEST_F(MemorySegmentMappedTest, openFail) {
                  MemorySegmentOpenError);
 }
 
+// Make a mapped file as an older version (without the slab allocator)
+// would, with a named object of the given size unless it's 0.
+void
+makeOlderSegment(size_t size) {
+    typedef boost::interprocess::basic_managed_mapped_file<
+        char,
+        boost::interprocess::rbtree_best_fit<
+            boost::interprocess::null_mutex_family>,
+        boost::interprocess::iset_index> BaseSegment;
+    typedef boost::interprocess::offset_ptr<void> VoidPtr;
+
+    boost::interprocess::file_mapping::remove(mapped_file);
+    BaseSegment sgmt(boost::interprocess::create_only, mapped_file,
+                     DEFAULT_INITIAL_SIZE);
+    sgmt.construct<VoidPtr>("_RESERVED_NAMED_ADDRESS_STORAGE")();
+    if (size > 0) {
+        sgmt.construct<VoidPtr>("object")(sgmt.allocate(size));
+    }
+}
+
+TEST_F(MemorySegmentMappedTest, openOlder) {
+    segment_.reset();
+
+    // Objects allocated by an older version can't be deallocated, so such
+    // a segment can only be read.
+    makeOlderSegment(32);
+    EXPECT_THROW(MemorySegmentMapped sgmt(mapped_file, OPEN_FOR_WRITE),
+                 MemorySegmentOpenError);
+    EXPECT_THROW(MemorySegmentMapped sgmt(mapped_file, OPEN_OR_CREATE),
+                 MemorySegmentOpenError);
+    segment_.reset(new MemorySegmentMapped(mapped_file));
+    EXPECT_TRUE(segment_->getNamedAddress("object").first);
+    EXPECT_FALSE(segment_->allMemoryDeallocated());
+    segment_.reset();
+
+    // An empty one can be used for writing.
+    makeOlderSegment(0);
+    segment_.reset(new MemorySegmentMapped(mapped_file, OPEN_FOR_WRITE));
+    EXPECT_TRUE(segment_->allMemoryDeallocated());
+    void* ptr = segment_->allocate(32);
+    segment_->deallocate(ptr, 32);
+    EXPECT_TRUE(segment_->allMemoryDeallocated());
+}
+
 TEST_F(MemorySegmentMappedTest, allocate) {
     // Various case of allocation.  The simplest cases are covered above.
 
@@ -265,13 +312,18 @@ TEST_F(MemorySegmentMappedTest, DISABLED_allocateHuge) {
 }
 
 TEST_F(MemorySegmentMappedTest, badDeallocate) {
-    void* ptr = segment_->allocate(4);
+    // Small objects are allocated by the slab allocator, which doesn't
+    // detect the following errors, so we use a size that is allocated
+    // from the underlying segment directly.
+    const size_t large_size = SlabAllocator<void*>::MAX_OBJECT_SIZE + 1;
+    void* ptr = segment_->allocate(large_size);
     EXPECT_NE(static_cast<void*>(NULL), ptr);
 
-    segment_->deallocate(ptr, 4); // this is okay
+    segment_->deallocate(ptr, large_size); // this is okay
     // This is duplicate dealloc; should trigger assertion failure.
     if (!bundy::util::unittests::runningOnValgrind()) {
-        EXPECT_DEATH_IF_SUPPORTED({segment_->deallocate(ptr, 4);}, "");
+        EXPECT_DEATH_IF_SUPPORTED({segment_->deallocate(ptr, large_size);},
+                                  "");
         resetSegment();   // the segment is possibly broken; reset it.
     }
 
@@ -279,21 +331,106 @@ TEST_F(MemorySegmentMappedTest, badDeallocate) {
     // behavior may not be portable enough; if so we should disable it by
     // default).
     if (!bundy::util::unittests::runningOnValgrind()) {
-        ptr = segment_->allocate(4);
+        ptr = segment_->allocate(large_size);
         EXPECT_NE(static_cast<void*>(NULL), ptr);
         EXPECT_DEATH_IF_SUPPORTED({
-                segment_->deallocate(static_cast<char*>(ptr) + 1, 3);
+                segment_->deallocate(static_cast<char*>(ptr) + 1,
+                                     large_size - 1);
             }, "");
         resetSegment();
     }
 
-    // Invalid size; this implementation doesn't detect such errors.
+    // Small objects with a wrong size or deallocated twice; the slab
+    // allocator detects them if there's no other object of the size class.
+    if (!bundy::util::unittests::runningOnValgrind()) {
+        ptr = segment_->allocate(4);
+        EXPECT_NE(static_cast<void*>(NULL), ptr);
+        EXPECT_DEATH_IF_SUPPORTED({segment_->deallocate(ptr, 512);}, "");
+        segment_->deallocate(ptr, 4);
+        EXPECT_DEATH_IF_SUPPORTED({segment_->deallocate(ptr, 4);}, "");
+        resetSegment();
+    }
+
+    // Invalid size in the same size class; the slab allocator doesn't
+    // detect it, and it's harmless to the allocator, but the allocated
+    // size becomes inconsistent.
     ptr = segment_->allocate(4);
     EXPECT_NE(static_cast<void*>(NULL), ptr);
     segment_->deallocate(ptr, 8);
+    EXPECT_FALSE(segment_->allMemoryDeallocated());
+    EXPECT_EQ(ptr, segment_->allocate(8));
+    segment_->deallocate(ptr, 4);
     EXPECT_TRUE(segment_->allMemoryDeallocated());
 }
 
+TEST_F(MemorySegmentMappedTest, smallObjects) {
+    // Small objects don't have a per object header, so many of them fit in
+    // a segment less than twice as large as their total size (the segment
+    // doubles as it grows).
+    const size_t count = 100000;
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = NULL;
+        while (!ptr) {
+            try {
+                ptr = segment_->allocate(24);
+            } catch (const MemorySegmentGrown&) {}
+        }
+        std::memset(ptr, 0, 24);
+    }
+    EXPECT_LT(segment_->getSize(), count * 24 * 2);
+    EXPECT_FALSE(segment_->allMemoryDeallocated());
+
+    // The free objects survive reopening the segment, and are reused.
+    void* ptr = NULL;
+    while (!ptr) {
+        try {
+            ptr = segment_->allocate(24);
+        } catch (const MemorySegmentGrown&) {}
+    }
+    segment_->setNamedAddress("freed", ptr);
+    segment_->deallocate(segment_->getNamedAddress("freed").second, 24);
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(mapped_file, OPEN_FOR_WRITE));
+    EXPECT_EQ(segment_->getNamedAddress("freed").second,
+              segment_->allocate(20));
+    segment_->clearNamedAddress("freed");
+}
+
+TEST_F(MemorySegmentMappedTest, getAllocatedSize) {
+    EXPECT_EQ(0, segment_->getAllocatedSize());
+
+    // Both small and large objects are counted by their requested size.
+    const size_t large_size = SlabAllocator<void*>::MAX_OBJECT_SIZE + 1;
+    void* ptr1 = NULL;
+    void* ptr2 = NULL;
+    while (!ptr1 || !ptr2) {
+        try {
+            if (!ptr1) {
+                ptr1 = segment_->allocate(20);
+            }
+            ptr2 = segment_->allocate(large_size);
+        } catch (const MemorySegmentGrown&) {}
+    }
+    EXPECT_EQ(20 + large_size, segment_->getAllocatedSize());
+    segment_->setNamedAddress("large", ptr2);
+    segment_->deallocate(ptr1, 20);
+    EXPECT_EQ(large_size, segment_->getAllocatedSize());
+
+    // The size is stored in the segment.
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(mapped_file));
+    EXPECT_EQ(large_size, segment_->getAllocatedSize());
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(mapped_file, OPEN_FOR_WRITE));
+    EXPECT_EQ(large_size, segment_->getAllocatedSize());
+    segment_->deallocate(segment_->getNamedAddress("large").second,
+                         large_size);
+    segment_->clearNamedAddress("large");
+    EXPECT_EQ(0, segment_->getAllocatedSize());
+    EXPECT_TRUE(segment_->allMemoryDeallocated());
+    EXPECT_EQ(0, segment_->getAllocatedSize());
+}
+
 // A helper of namedAddress.
 void
 checkNamedData(const std::string& name, const std::vector<uint8_t>& data,
@@ -562,6 +699,59 @@ TEST_F(MemorySegmentMappedTest, getCheckSum) {
     EXPECT_EQ(old_cksum + 1, segment_->getCheckSum());
 }
 
+TEST_F(MemorySegmentMappedTest, prefault) {
+    void* ptr = segment_->allocate(sizeof(uint32_t));
+    *static_cast<uint32_t*>(ptr) = 0x12345678;
+    segment_->setNamedAddress("test address", ptr);
+    segment_->shrinkToFit();
+    const size_t size = segment_->getSize();
+    const size_t cksum = segment_->getCheckSum();
+    segment_.reset(new MemorySegmentMapped(mapped_file));
+
+    // The range is clipped to the segment, and the offset doesn't have to
+    // be page aligned.
+    EXPECT_EQ(size, segment_->prefault(0, size * 2));
+    EXPECT_EQ(size - 100, segment_->prefault(100, size));
+    EXPECT_EQ(10, segment_->prefault(size - 10, 10));
+    EXPECT_EQ(0, segment_->prefault(size, 10));
+    EXPECT_EQ(0, segment_->prefault(size * 2, 10));
+
+    // Prefaulting piece by piece covers the whole segment.
+    size_t offset = 0;
+    size_t done;
+    while ((done = segment_->prefault(offset, 1000)) > 0) {
+        offset += done;
+    }
+    EXPECT_EQ(size, offset);
+
+    // The advice on the expected use is not fatal even if rejected, and
+    // none of these change the data.
+    EXPECT_TRUE(segment_->adviseWillNeed());
+    segment_->useHugePages();
+    EXPECT_EQ(cksum, segment_->getCheckSum());
+    const MemorySegment::NamedAddressResult result =
+        segment_->getNamedAddress("test address");
+    ASSERT_TRUE(result.first);
+    EXPECT_EQ(0x12345678, *static_cast<const uint32_t*>(result.second));
+}
+
+TEST_F(MemorySegmentMappedTest, useHugePages) {
+    // The hint is kept while the segment grows and shrinks.
+    segment_->useHugePages();
+    const size_t prev_size = segment_->getSize();
+    void* ptr = NULL;
+    while (!ptr) {
+        try {
+            ptr = segment_->allocate(prev_size * 2);
+        } catch (const MemorySegmentGrown&) {}
+    }
+    EXPECT_LT(prev_size, segment_->getSize());
+    std::memset(ptr, 0, prev_size * 2);
+    segment_->deallocate(ptr, prev_size * 2);
+    segment_->shrinkToFit();
+    EXPECT_TRUE(segment_->allMemoryDeallocated());
+}
+
 // Mode of opening segments in the tests below.
 enum TestOpenMode {
     READER = 0,
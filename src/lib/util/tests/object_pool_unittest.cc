@@ -0,0 +1,134 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/object_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+using namespace bundy::util;
+
+namespace {
+
+TEST(ObjectPoolTest, reuse) {
+    // Make sure the free list is empty first.
+    std::vector<void*> blocks;
+    while (ObjectPool::getFreeCount(40) > 0) {
+        blocks.push_back(ObjectPool::allocate(40));
+    }
+
+    void* ptr = ObjectPool::allocate(40);
+    std::memset(ptr, 0xff, 40);
+    ObjectPool::deallocate(ptr, 40);
+    EXPECT_EQ(1, ObjectPool::getFreeCount(40));
+    // Sizes of the same class share the free list.
+    EXPECT_EQ(1, ObjectPool::getFreeCount(33));
+    EXPECT_EQ(1, ObjectPool::getFreeCount(48));
+    EXPECT_EQ(0, ObjectPool::getFreeCount(49));
+
+    EXPECT_EQ(ptr, ObjectPool::allocate(48));
+    EXPECT_EQ(0, ObjectPool::getFreeCount(40));
+    ObjectPool::deallocate(ptr, 48);
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        ObjectPool::deallocate(blocks[i], 40);
+    }
+}
+
+TEST(ObjectPoolTest, largeObjects) {
+    // Objects larger than the max aren't pooled.
+    void* ptr = ObjectPool::allocate(ObjectPool::MAX_OBJECT_SIZE + 1);
+    std::memset(ptr, 0, ObjectPool::MAX_OBJECT_SIZE + 1);
+    ObjectPool::deallocate(ptr, ObjectPool::MAX_OBJECT_SIZE + 1);
+    EXPECT_EQ(0, ObjectPool::getFreeCount(ObjectPool::MAX_OBJECT_SIZE + 1));
+
+    // The null pointer is ignored.
+    ObjectPool::deallocate(NULL, 10);
+}
+
+TEST(ObjectPoolTest, maxFreeBlocks) {
+    const size_t size = ObjectPool::MAX_OBJECT_SIZE;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < ObjectPool::MAX_FREE_BLOCKS + 10; ++i) {
+        blocks.push_back(ObjectPool::allocate(size));
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        ObjectPool::deallocate(blocks[i], size);
+    }
+    EXPECT_EQ(ObjectPool::MAX_FREE_BLOCKS, ObjectPool::getFreeCount(size));
+}
+
+struct TestObject {
+    TestObject(const std::string& text, int value) :
+        text_(text), value_(value)
+    {}
+    std::string text_;
+    int value_;
+};
+
+TEST(ObjectPoolTest, allocator) {
+    // Use it with a shared pointer.
+    boost::shared_ptr<TestObject> obj =
+        boost::allocate_shared<TestObject>(PoolAllocator<TestObject>(),
+                                           "test", 42);
+    EXPECT_EQ("test", obj->text_);
+    EXPECT_EQ(42, obj->value_);
+    boost::shared_ptr<TestObject> obj2 = obj;
+    obj.reset();
+    EXPECT_EQ("test", obj2->text_);
+    obj2.reset();
+
+    // And with a container.
+    std::vector<int, PoolAllocator<int> > values;
+    for (int i = 0; i < 100; ++i) {
+        values.push_back(i);
+    }
+    EXPECT_EQ(99, values[99]);
+}
+
+void*
+allocateInThread(void*) {
+    return (ObjectPool::allocate(100));
+}
+
+void*
+deallocateInThread(void* arg) {
+    ObjectPool::deallocate(arg, 100);
+    return (NULL);
+}
+
+TEST(ObjectPoolTest, threads) {
+    // Memory allocated in one thread can be deallocated in another, and
+    // each thread has its own pool.
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, allocateInThread, NULL));
+    void* ptr;
+    ASSERT_EQ(0, pthread_join(thread, &ptr));
+    ASSERT_NE(static_cast<void*>(NULL), ptr);
+
+    const size_t count = ObjectPool::getFreeCount(100);
+    ASSERT_EQ(0, pthread_create(&thread, NULL, deallocateInThread, ptr));
+    ASSERT_EQ(0, pthread_join(thread, NULL));
+    EXPECT_EQ(count, ObjectPool::getFreeCount(100));
+}
+
+}
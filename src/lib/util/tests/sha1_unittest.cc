@@ -13,9 +13,12 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdint.h>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include <util/hash/sha1.h>
+#include <util/hash/sha1_multi.h>
 
 #include <gtest/gtest.h>
 
@@ -103,6 +106,125 @@ TEST_F(Sha1Test, Test4) {
     }
 }
 
+class Sha1MultiTest : public ::testing::Test {
+protected:
+    Sha1MultiTest() : default_impl_(getSHA1MultiImpl()), seed_(1) {}
+    ~Sha1MultiTest() {
+        selectSHA1MultiImpl(default_impl_);
+    }
+
+    // A simple deterministic pseudo random number generator, so any
+    // failure can be reproduced.
+    uint32_t random(uint32_t limit) {
+        seed_ = seed_ * 1103515245 + 12345;
+        return ((seed_ >> 8) % limit);
+    }
+
+    void referenceDigest(const vector<uint8_t>& data,
+                         uint8_t digest[SHA1_HASHSIZE])
+    {
+        SHA1Context sha;
+        SHA1Reset(&sha);
+        SHA1Input(&sha, data.empty() ? NULL : &data[0], data.size());
+        SHA1Result(&sha, digest);
+    }
+
+    // Calculate the digests of the given number of random messages of the
+    // given maximum length with the given implementation, and compare them
+    // with those calculated one by one.
+    void checkDigests(SHA1MultiImpl impl, size_t count, size_t max_length) {
+        vector<vector<uint8_t> > messages(count);
+        vector<const uint8_t*> data(count);
+        vector<size_t> lengths(count);
+        for (size_t i = 0; i < count; ++i) {
+            messages[i].resize(random(max_length + 1));
+            for (size_t j = 0; j < messages[i].size(); ++j) {
+                messages[i][j] = random(256);
+            }
+            data[i] = messages[i].empty() ? NULL : &messages[i][0];
+            lengths[i] = messages[i].size();
+        }
+
+        vector<uint8_t> digests(count * SHA1_HASHSIZE);
+        ASSERT_TRUE(selectSHA1MultiImpl(impl));
+        SHA1MultiDigest(count, &data[0], &lengths[0],
+                        reinterpret_cast<uint8_t(*)[SHA1_HASHSIZE]>(
+                            &digests[0]));
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t expected[SHA1_HASHSIZE];
+            referenceDigest(messages[i], expected);
+            EXPECT_EQ(0, memcmp(expected, &digests[i * SHA1_HASHSIZE],
+                                SHA1_HASHSIZE))
+                << "impl=" << impl << ", count=" << count << ", message="
+                << i << ", length=" << lengths[i];
+        }
+    }
+
+    const SHA1MultiImpl default_impl_;
+    uint32_t seed_;
+};
+
+const SHA1MultiImpl multi_impls[] = {
+    SHA1_MULTI_SCALAR, SHA1_MULTI_SSE2, SHA1_MULTI_AVX2
+};
+
+TEST_F(Sha1MultiTest, defaultImpl) {
+    // The scalar implementation is always available, and the default
+    // should be the best one.
+    EXPECT_TRUE(selectSHA1MultiImpl(SHA1_MULTI_SCALAR));
+    if (selectSHA1MultiImpl(SHA1_MULTI_AVX2)) {
+        EXPECT_EQ(SHA1_MULTI_AVX2, default_impl_);
+    } else if (selectSHA1MultiImpl(SHA1_MULTI_SSE2)) {
+        EXPECT_EQ(SHA1_MULTI_SSE2, default_impl_);
+    } else {
+        EXPECT_EQ(SHA1_MULTI_SCALAR, default_impl_);
+    }
+}
+
+TEST_F(Sha1MultiTest, digests) {
+    for (size_t i = 0; i < sizeof(multi_impls) / sizeof(multi_impls[0]);
+         ++i) {
+        if (!selectSHA1MultiImpl(multi_impls[i])) {
+            continue;
+        }
+        // Messages around the block boundaries, with any number of partial
+        // groups of lanes.
+        for (size_t count = 0; count <= 20; ++count) {
+            checkDigests(multi_impls[i], count, 200);
+        }
+        // Messages of the same length, like the iterations of NSEC3 hashes.
+        for (size_t length = 0; length < 140; ++length) {
+            checkDigests(multi_impls[i], 9, 0);
+            seed_ += length;
+        }
+    }
+}
+
+TEST_F(Sha1MultiTest, overwriteData) {
+    // The iterations of NSEC3 hashes (without salt) calculate the digests
+    // of the digests in place.
+    for (size_t i = 0; i < sizeof(multi_impls) / sizeof(multi_impls[0]);
+         ++i) {
+        if (!selectSHA1MultiImpl(multi_impls[i])) {
+            continue;
+        }
+        uint8_t digests[5][SHA1_HASHSIZE];
+        const uint8_t* data[5];
+        size_t lengths[5];
+        uint8_t expected[5][SHA1_HASHSIZE];
+        for (size_t j = 0; j < 5; ++j) {
+            memset(digests[j], j, SHA1_HASHSIZE);
+            data[j] = digests[j];
+            lengths[j] = SHA1_HASHSIZE;
+            referenceDigest(vector<uint8_t>(digests[j],
+                                            digests[j] + SHA1_HASHSIZE),
+                            expected[j]);
+        }
+        SHA1MultiDigest(5, data, lengths, digests);
+        EXPECT_EQ(0, memcmp(expected, digests, sizeof(expected)));
+    }
+}
+
 } // namespace hash
 } // namespace util
 } // namespace bundy
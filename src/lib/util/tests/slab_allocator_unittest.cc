@@ -0,0 +1,236 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/slab_allocator.h>
+#include <util/unittests/check_valgrind.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <stdint.h>
+
+using namespace bundy::util;
+using boost::interprocess::offset_ptr;
+
+namespace {
+
+typedef SlabAllocator<void*> Allocator;
+
+class SlabAllocatorTest : public ::testing::Test {
+protected:
+    ~SlabAllocatorTest() {
+        releaseChunks(allocator_);
+    }
+
+    // Allocate an object, adding a chunk from malloc() if necessary.
+    template <typename SlabType>
+    static void* allocate(SlabType& allocator, size_t size) {
+        void* ptr = allocator.allocate(size);
+        if (ptr == NULL) {
+            allocator.addChunk(size,
+                               std::malloc(allocator.getChunkSize(size)));
+            ptr = allocator.allocate(size);
+        }
+        EXPECT_NE(static_cast<void*>(NULL), ptr);
+        return (ptr);
+    }
+
+    template <typename SlabType>
+    static void releaseChunks(SlabType& allocator) {
+        void* chunk;
+        while ((chunk = allocator.releaseChunk()) != NULL) {
+            std::free(chunk);
+        }
+    }
+
+    Allocator allocator_;
+};
+
+TEST_F(SlabAllocatorTest, sizeClasses) {
+    // Small sizes are rounded up to multiples of 8 bytes.
+    EXPECT_EQ(0, Allocator::getClass(0));
+    EXPECT_EQ(0, Allocator::getClass(1));
+    EXPECT_EQ(0, Allocator::getClass(8));
+    EXPECT_EQ(1, Allocator::getClass(9));
+    EXPECT_EQ(15, Allocator::getClass(128));
+    // Then 8 classes per power of two.
+    EXPECT_EQ(16, Allocator::getClass(129));
+    EXPECT_EQ(144, Allocator::getClassSize(16));
+    EXPECT_EQ(1024, Allocator::getClassSize(Allocator::getClass(1024)));
+    EXPECT_EQ(Allocator::CLASS_COUNT - 1,
+              Allocator::getClass(Allocator::MAX_OBJECT_SIZE));
+
+    // Every size is in the smallest class that fits, with at most 7 bytes
+    // or 1/8 of the size wasted.
+    for (size_t size = 1; size <= Allocator::MAX_OBJECT_SIZE; ++size) {
+        const size_t cls = Allocator::getClass(size);
+        ASSERT_LT(cls, Allocator::CLASS_COUNT);
+        EXPECT_LE(size, Allocator::getClassSize(cls));
+        EXPECT_LE(Allocator::getClassSize(cls) - size,
+                  std::max<size_t>(7, size / 8));
+        if (cls > 0) {
+            EXPECT_GT(size, Allocator::getClassSize(cls - 1));
+        }
+    }
+}
+
+TEST_F(SlabAllocatorTest, allocate) {
+    // Without a chunk, nothing can be allocated.
+    EXPECT_EQ(static_cast<void*>(NULL), allocator_.allocate(40));
+    EXPECT_EQ(0, allocator_.getChunkSize());
+
+    // Objects are carved out of a single chunk without gaps.
+    const size_t chunk_size = allocator_.getChunkSize(40);
+    EXPECT_GE(chunk_size, Allocator::MIN_CHUNK_SIZE);
+    char* ptr1 = static_cast<char*>(allocate(allocator_, 40));
+    char* ptr2 = static_cast<char*>(allocate(allocator_, 33));
+    EXPECT_EQ(ptr1 + 40, ptr2);
+    EXPECT_EQ(2, allocator_.getObjectCount());
+    EXPECT_EQ(chunk_size, allocator_.getChunkSize());
+    std::memset(ptr1, 0xff, 40);
+    std::memset(ptr2, 0xff, 33);
+
+    // A deallocated object is reused for the same size class.
+    allocator_.deallocate(ptr1, 40);
+    EXPECT_EQ(1, allocator_.getObjectCount());
+    EXPECT_EQ(ptr1, allocator_.allocate(35));
+    allocator_.deallocate(ptr1, 35);
+    allocator_.deallocate(ptr2, 33);
+    EXPECT_EQ(0, allocator_.getObjectCount());
+}
+
+TEST_F(SlabAllocatorTest, badDeallocate) {
+    if (bundy::util::unittests::runningOnValgrind()) {
+        return;
+    }
+    void* ptr1 = allocate(allocator_, 40);
+    void* ptr2 = allocate(allocator_, 500);
+
+    // A size in the same class is okay, but a class without allocated
+    // objects is detected, as well as duplicate deallocation.
+    EXPECT_DEATH_IF_SUPPORTED({allocator_.deallocate(ptr1, 48);}, "");
+    allocator_.deallocate(ptr1, 35);
+    EXPECT_DEATH_IF_SUPPORTED({allocator_.deallocate(ptr1, 40);}, "");
+
+    allocator_.deallocate(ptr2, 500);
+    EXPECT_EQ(0, allocator_.getObjectCount());
+}
+
+TEST_F(SlabAllocatorTest, chunks) {
+    // Fill some chunks; each is larger than the previous one, and the
+    // objects are distinct and aligned.
+    const size_t first_chunk_size = allocator_.getChunkSize(24);
+    std::set<void*> objects;
+    std::vector<void*> ptrs;
+    for (size_t i = 0; i < 10000; ++i) {
+        void* ptr = allocate(allocator_, 24);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % 8);
+        EXPECT_TRUE(objects.insert(ptr).second);
+        ptrs.push_back(ptr);
+    }
+    EXPECT_GT(allocator_.getChunkSize(24), first_chunk_size);
+    EXPECT_LE(allocator_.getChunkSize(24), Allocator::MAX_CHUNK_SIZE + 16);
+    EXPECT_GE(allocator_.getChunkSize(), 10000 * 24);
+    // Per object overhead is small.
+    EXPECT_LT(allocator_.getChunkSize(), 10000 * 24 * 2);
+
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        allocator_.deallocate(ptrs[i], 24);
+    }
+    EXPECT_EQ(0, allocator_.getObjectCount());
+
+    // Releasing chunks forgets everything.
+    releaseChunks(allocator_);
+    EXPECT_EQ(0, allocator_.getChunkSize());
+    EXPECT_EQ(static_cast<void*>(NULL), allocator_.allocate(24));
+    EXPECT_EQ(first_chunk_size, allocator_.getChunkSize(24));
+}
+
+TEST_F(SlabAllocatorTest, largeClasses) {
+    // The chunk of the largest class holds at least one object.
+    void* ptr = allocate(allocator_, Allocator::MAX_OBJECT_SIZE);
+    std::memset(ptr, 0, Allocator::MAX_OBJECT_SIZE);
+    EXPECT_EQ(1, allocator_.getObjectCount());
+    allocator_.deallocate(ptr, Allocator::MAX_OBJECT_SIZE);
+}
+
+TEST_F(SlabAllocatorTest, merge) {
+    Allocator other;
+    void* ptr1 = allocate(allocator_, 16);
+    void* ptr2 = allocate(other, 16);
+    void* ptr3 = allocate(other, 500);
+    void* ptr4 = allocate(other, 16);
+    other.deallocate(ptr4, 16);
+    const size_t chunk_size = allocator_.getChunkSize() + other.getChunkSize();
+
+    allocator_.merge(other);
+    EXPECT_EQ(0, other.getObjectCount());
+    EXPECT_EQ(0, other.getChunkSize());
+    EXPECT_EQ(static_cast<void*>(NULL), other.releaseChunk());
+    EXPECT_EQ(3, allocator_.getObjectCount());
+    EXPECT_EQ(chunk_size, allocator_.getChunkSize());
+
+    // The free objects of the other allocator are reused, and the objects
+    // it allocated can be deallocated here.
+    std::set<void*> objects;
+    objects.insert(ptr1);
+    objects.insert(ptr2);
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(objects.insert(allocate(allocator_, 16)).second);
+    }
+    EXPECT_TRUE(objects.count(ptr4) > 0);
+    allocator_.deallocate(ptr3, 500);
+    for (std::set<void*>::const_iterator it = objects.begin();
+         it != objects.end();
+         ++it) {
+        allocator_.deallocate(*it, 16);
+    }
+    EXPECT_EQ(0, allocator_.getObjectCount());
+}
+
+TEST_F(SlabAllocatorTest, offsetPointer) {
+    // The allocator works with relative pointers, even if it's moved with
+    // the memory it manages.
+    typedef SlabAllocator<offset_ptr<void> > RelativeAllocator;
+    const size_t region_size = sizeof(RelativeAllocator) + 8192;
+    char* region = static_cast<char*>(std::malloc(region_size));
+    RelativeAllocator* allocator = new(region) RelativeAllocator;
+    ASSERT_LE(allocator->getChunkSize(32), 8192);
+    allocator->addChunk(32, region + sizeof(RelativeAllocator));
+    void* ptr1 = allocator->allocate(32);
+    void* ptr2 = allocator->allocate(32);
+    allocator->deallocate(ptr1, 32);
+    const size_t offset1 = static_cast<char*>(ptr1) - region;
+    const size_t offset2 = static_cast<char*>(ptr2) - region;
+
+    char* moved = static_cast<char*>(std::malloc(region_size));
+    std::memcpy(moved, region, region_size);
+    std::free(region);
+    allocator = reinterpret_cast<RelativeAllocator*>(moved);
+    void* ptr3 = allocator->allocate(32);
+    EXPECT_EQ(offset1, static_cast<char*>(ptr3) - moved);
+    void* ptr4 = allocator->allocate(32);
+    EXPECT_EQ(offset2 + 32, static_cast<char*>(ptr4) - moved);
+    EXPECT_EQ(moved + sizeof(RelativeAllocator), allocator->releaseChunk());
+    std::free(moved);
+}
+
+}
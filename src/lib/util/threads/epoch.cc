@@ -0,0 +1,154 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "config.h"
+
+#include "epoch.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <sched.h>
+#include <time.h>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+namespace {
+// The index of the calling thread, assigned on its first read-side
+// critical section in any domain.  It determines the counter the thread
+// uses in each domain.
+__thread unsigned int thread_index;
+__thread bool thread_index_assigned;
+unsigned int next_thread_index;
+
+unsigned int
+getThreadIndex() {
+    if (!thread_index_assigned) {
+        thread_index = __atomic_fetch_add(&next_thread_index, 1,
+                                          __ATOMIC_RELAXED);
+        thread_index_assigned = true;
+    }
+    return (thread_index);
+}
+
+// Readers are expected to be short (processing a single query, for
+// example), so we first only yield the CPU a few times while waiting for
+// them, then sleep between the checks so long waits don't burn the CPU.
+const int WAIT_YIELD_COUNT = 10;
+const long WAIT_SLEEP_NSEC = 100000; // 100us
+}
+
+// The slots are aligned to their size (a cache line) so counters of
+// different threads never share a line.
+EpochDomain::Slot*
+EpochDomain::allocateSlots() {
+    void* slots;
+    if (posix_memalign(&slots, sizeof(Slot), sizeof(Slot) * SLOT_COUNT) != 0) {
+        throw std::bad_alloc();
+    }
+    std::memset(slots, 0, sizeof(Slot) * SLOT_COUNT);
+    return (static_cast<Slot*>(slots));
+}
+
+EpochDomain::EpochDomain() :
+    slots_(allocateSlots()), phase_(0), exclusive_(false)
+{}
+
+EpochDomain::~EpochDomain() {
+    free(slots_);
+}
+
+unsigned long*
+EpochDomain::enter() {
+    Slot& slot = slots_[getThreadIndex() % SLOT_COUNT];
+    while (true) {
+        unsigned long* const counter =
+            &slot.counters[__atomic_load_n(&phase_, __ATOMIC_RELAXED) & 1];
+        // This increment and the check of exclusive_ below pair with the
+        // setting of exclusive_ and the check of the counters in Writer:
+        // both are sequentially consistent, so either the writer sees our
+        // counter or we see exclusive_ set.  The same goes for the
+        // publication of data and waitForReaders() in synchronize().
+        __atomic_fetch_add(counter, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&exclusive_, __ATOMIC_SEQ_CST)) {
+            return (counter);
+        }
+
+        // A writer is (about to be) modifying the data.  Back off, and
+        // wait for it by acquiring the mutex it holds.
+        leave(counter);
+        Mutex::Locker locker(mutex_);
+    }
+}
+
+void
+EpochDomain::waitForReaders(unsigned int phase) const {
+    for (int count = 0; ; ++count) {
+        bool active = false;
+        for (size_t i = 0; i < SLOT_COUNT && !active; ++i) {
+            const unsigned long* const counters = slots_[i].counters;
+            active = (phase != 1 &&
+                      __atomic_load_n(&counters[0], __ATOMIC_SEQ_CST) != 0) ||
+                (phase != 0 &&
+                 __atomic_load_n(&counters[1], __ATOMIC_SEQ_CST) != 0);
+        }
+        if (!active) {
+            return;
+        }
+        if (count < WAIT_YIELD_COUNT) {
+            sched_yield();
+        } else {
+            const struct timespec ts = { 0, WAIT_SLEEP_NSEC };
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+void
+EpochDomain::synchronize() {
+    Mutex::Locker locker(mutex_);
+
+    // Readers register at the counter of the current phase.  We flip the
+    // phase and wait for the readers of the previous one; the readers that
+    // start after the flip use the other counter, so this terminates even
+    // if readers keep coming.  A reader may have read the phase before the
+    // flip but not yet incremented the counter; it could then register at
+    // the counter we've already waited on, so we flip again and wait for
+    // the other counter, too.  In either case the reader increments the
+    // counter after our check, so it sees the data published before this
+    // call.
+    for (int i = 0; i < 2; ++i) {
+        const unsigned int phase = __atomic_load_n(&phase_, __ATOMIC_RELAXED);
+        __atomic_store_n(&phase_, phase + 1, __ATOMIC_SEQ_CST);
+        waitForReaders(phase & 1);
+    }
+}
+
+EpochDomain::Writer::Writer(EpochDomain& domain) :
+    domain_(domain), locker_(domain.mutex_)
+{
+    __atomic_store_n(&domain_.exclusive_, true, __ATOMIC_SEQ_CST);
+    domain_.waitForReaders(2);
+}
+
+EpochDomain::Writer::~Writer() {
+    __atomic_store_n(&domain_.exclusive_, false, __ATOMIC_RELEASE);
+}
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,176 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_EPOCH_H
+#define BUNDY_THREAD_EPOCH_H
+
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+/// \brief Lock-free read-side protection of shared data (RCU style).
+///
+/// An \c EpochDomain lets many threads read shared data without taking
+/// any lock, while (rare) writers replace or modify the data.  A reader
+/// marks the period it uses the data by a \c Reader object; this only
+/// increments and decrements a counter that belongs to the calling thread
+/// (counters of different threads are on different cache lines), so
+/// readers don't contend with each other.
+///
+/// Writers have two ways to make sure no reader sees data they are going
+/// to destroy or modify:
+/// - Publish a new version of the data (with \c publish()), then call
+///   \c synchronize().  It returns once all readers that might have seen
+///   the old version have finished, so the old version can be destroyed.
+///   Readers aren't blocked at all; those that start during the call
+///   see the new version.
+/// - Hold a \c Writer object while modifying the data in place.  New
+///   readers wait until it's destroyed, and its constructor waits until
+///   all current readers have finished.  This is more expensive for the
+///   readers, so it should only be used for changes that can't be made
+///   by publishing a new version.
+///
+/// Each reader thread is assigned one of \c SLOT_COUNT counters; if there
+/// are more threads, some of them share a counter, which is still correct
+/// but makes them contend for it.
+///
+/// A \c Reader must not be nested in another \c Reader of the same domain
+/// in the same thread, and a thread must not call \c synchronize() or
+/// create a \c Writer while it has a \c Reader of the domain; either
+/// could deadlock.  Writers are serialized with each other.
+class EpochDomain : boost::noncopyable {
+public:
+    /// \brief The number of reader counters of a domain.
+    static const size_t SLOT_COUNT = 64;
+
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc memory allocation failure.
+    EpochDomain();
+
+    /// \brief Destructor.
+    ///
+    /// There must be no \c Reader or \c Writer of the domain at the time
+    /// of destruction.
+    ~EpochDomain();
+
+    /// \brief A read-side critical section.
+    ///
+    /// While the object exists, the shared data the reader got from the
+    /// domain (with \c load()) remain valid and unmodified.
+    class Reader : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// This doesn't block unless a \c Writer of the domain exists.
+        ///
+        /// \throw bundy::InvalidOperation only in case of system errors on
+        ///     waiting for a \c Writer.
+        explicit Reader(EpochDomain& domain) :
+            counter_(domain.enter())
+        {}
+
+        /// \brief Destructor.
+        ~Reader() {
+            EpochDomain::leave(counter_);
+        }
+    private:
+        unsigned long* const counter_;
+    };
+
+    /// \brief A write-side exclusive section.
+    ///
+    /// While the object exists, there's no \c Reader of the domain (in
+    /// any thread), so the writer can modify the shared data in place.
+    class Writer : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// It blocks until all existing readers have finished.
+        ///
+        /// \throw bundy::InvalidOperation system errors on locking.
+        explicit Writer(EpochDomain& domain);
+
+        /// \brief Destructor.
+        ///
+        /// New readers can start after this.
+        ~Writer();
+    private:
+        EpochDomain& domain_;
+        Mutex::Locker locker_;
+    };
+
+    /// \brief Wait for all readers that might see old data.
+    ///
+    /// Once this returns, no \c Reader that started before the call
+    /// exists any more, so data unpublished before the call can safely
+    /// be destroyed.  It doesn't block new readers.
+    ///
+    /// \throw bundy::InvalidOperation system errors on locking.
+    void synchronize();
+
+    /// \brief Get a pointer published for readers.
+    ///
+    /// Readers should use this (within a \c Reader) to get the pointer
+    /// to the shared data, as it's concurrently updated by \c publish().
+    template <typename T>
+    static T* load(T* const& ptr) {
+        return (__atomic_load_n(&ptr, __ATOMIC_ACQUIRE));
+    }
+
+    /// \brief Publish a pointer for readers.
+    ///
+    /// The data pointed to by \c value must have been fully constructed;
+    /// readers that \c load() the pointer after this see it.
+    template <typename T>
+    static void publish(T*& ptr, T* value) {
+        __atomic_store_n(&ptr, value, __ATOMIC_SEQ_CST);
+    }
+
+private:
+    // A pair of reader counters of each phase, in its own cache line.
+    struct Slot {
+        unsigned long counters[2];
+        char padding[64 - 2 * sizeof(unsigned long)];
+    };
+
+    static Slot* allocateSlots();
+    unsigned long* enter();
+    static void leave(unsigned long* counter) {
+        __atomic_fetch_sub(counter, 1, __ATOMIC_RELEASE);
+    }
+    // Wait until the given phase (or both, if phase is 2) has no reader.
+    void waitForReaders(unsigned int phase) const;
+
+    Slot* const slots_;
+    unsigned int phase_;
+    bool exclusive_;
+    Mutex mutex_;           // serializes writers; blocked readers wait on it
+};
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,202 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <util/unittests/check_valgrind.h>
+
+#include <util/threads/epoch.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+#include <unistd.h>
+
+using namespace bundy::util::thread;
+
+namespace {
+
+// Helpers to share flags between the threads of the tests.
+int
+getFlag(const int* flag) {
+    return (__atomic_load_n(flag, __ATOMIC_SEQ_CST));
+}
+
+void
+setFlag(int* flag, int value) {
+    __atomic_store_n(flag, value, __ATOMIC_SEQ_CST);
+}
+
+void
+waitFlag(const int* flag) {
+    while (getFlag(flag) == 0) {
+        usleep(1000);
+    }
+}
+
+class EpochDomainTest : public ::testing::Test {
+protected:
+    EpochDomainTest() : entered_(0), finished_(0) {}
+
+    EpochDomain domain_;
+    int entered_;
+    int finished_;
+};
+
+TEST_F(EpochDomainTest, publish) {
+    int value1 = 1, value2 = 2;
+    int* ptr = &value1;
+    {
+        EpochDomain::Reader reader(domain_);
+        EXPECT_EQ(&value1, EpochDomain::load(ptr));
+    }
+    EpochDomain::publish(ptr, &value2);
+    {
+        EpochDomain::Reader reader(domain_);
+        EXPECT_EQ(&value2, EpochDomain::load(ptr));
+    }
+
+    // Without readers, neither of the writer operations blocks.
+    domain_.synchronize();
+    { EpochDomain::Writer writer(domain_); }
+
+    // A reader of another domain doesn't matter either.
+    EpochDomain other_domain;
+    EpochDomain::Reader reader(other_domain);
+    domain_.synchronize();
+    { EpochDomain::Writer writer(domain_); }
+}
+
+// Enter a read-side section, and leave it after a while.
+void
+readAndWait(EpochDomain* domain, int* entered, int* finished) {
+    EpochDomain::Reader reader(*domain);
+    setFlag(entered, 1);
+    usleep(100000);
+    setFlag(finished, 1);
+}
+
+TEST_F(EpochDomainTest, synchronizeWaitsForReaders) {
+    if (bundy::util::unittests::runningOnValgrind()) {
+        return;
+    }
+    Thread thread(boost::bind(readAndWait, &domain_, &entered_, &finished_));
+    waitFlag(&entered_);
+    domain_.synchronize();
+    EXPECT_EQ(1, getFlag(&finished_));
+    thread.wait();
+}
+
+TEST_F(EpochDomainTest, writerWaitsForReaders) {
+    if (bundy::util::unittests::runningOnValgrind()) {
+        return;
+    }
+    Thread thread(boost::bind(readAndWait, &domain_, &entered_, &finished_));
+    waitFlag(&entered_);
+    {
+        EpochDomain::Writer writer(domain_);
+        EXPECT_EQ(1, getFlag(&finished_));
+    }
+    thread.wait();
+}
+
+// Enter a read-side section only.
+void
+enterReader(EpochDomain* domain, int* entered) {
+    EpochDomain::Reader reader(*domain);
+    setFlag(entered, 1);
+}
+
+TEST_F(EpochDomainTest, writerBlocksReaders) {
+    if (bundy::util::unittests::runningOnValgrind()) {
+        return;
+    }
+    boost::shared_ptr<Thread> thread;
+    {
+        EpochDomain::Writer writer(domain_);
+        thread.reset(new Thread(boost::bind(enterReader, &domain_,
+                                            &entered_)));
+        usleep(100000);
+        EXPECT_EQ(0, getFlag(&entered_));
+    }
+    thread->wait();
+    EXPECT_EQ(1, getFlag(&entered_));
+}
+
+// Data replaced by the writer; the readers check they never see it
+// destroyed.
+struct Data {
+    explicit Data(int value) : value(value) {}
+    int value;
+};
+const int VALID_VALUE = 42;
+
+void
+readRepeatedly(EpochDomain* domain, Data** data, int* started,
+               int* finished, int* errors)
+{
+    __atomic_fetch_add(started, 1, __ATOMIC_SEQ_CST);
+    while (getFlag(finished) == 0) {
+        EpochDomain::Reader reader(*domain);
+        const Data* current = EpochDomain::load(*data);
+        for (int i = 0; i < 100; ++i) {
+            if (__atomic_load_n(&current->value, __ATOMIC_RELAXED) !=
+                VALID_VALUE) {
+                __atomic_fetch_add(errors, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+TEST_F(EpochDomainTest, replaceWhileReading) {
+    if (bundy::util::unittests::runningOnValgrind()) {
+        return;
+    }
+    Data* data = new Data(VALID_VALUE);
+    int errors = 0;
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(readRepeatedly, &domain_, &data,
+                                   &entered_, &finished_, &errors))));
+    }
+    while (getFlag(&entered_) < 4) {
+        usleep(1000);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        Data* const old_data = data;
+        EpochDomain::publish(data, new Data(VALID_VALUE));
+        domain_.synchronize();
+        __atomic_store_n(&old_data->value, 0, __ATOMIC_RELAXED);
+        delete old_data;
+        if (i % 100 == 0) {
+            EpochDomain::Writer writer(domain_);
+            data->value = 0;
+            data->value = VALID_VALUE;
+        }
+    }
+    setFlag(&finished_, 1);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+    }
+    EXPECT_EQ(0, errors);
+    delete data;
+}
+
+}
@@ -0,0 +1,288 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "command_options.h"
+
+#include <exceptions/exceptions.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace bundy {
+namespace perfdns {
+
+CommandOptions::CommandOptions() {
+    reset();
+}
+
+void
+CommandOptions::reset() {
+    server_ = "127.0.0.1";
+    port_ = 53;
+    input_file_.clear();
+    input_format_ = FORMAT_TEXT;
+    transport_ = TRANSPORT_UDP;
+    threads_ = 1;
+    rate_ = 0;
+    aggressivity_ = 16;
+    max_outstanding_ = 100;
+    runs_ = 0;
+    time_limit_ = 0;
+    timeout_ = 2000;
+    edns_ = false;
+    udp_size_ = 4096;
+    dnssec_ok_ = false;
+    recursion_desired_ = false;
+    tsig_key_.reset();
+    histogram_ = false;
+}
+
+void
+CommandOptions::check(bool condition, const string& errmsg) const {
+    if (condition) {
+        bundy_throw(bundy::InvalidParameter, errmsg);
+    }
+}
+
+int
+CommandOptions::getInteger(int min, int max, const string& errmsg) const {
+    try {
+        const int value = boost::lexical_cast<int>(optarg);
+        check(value < min || value > max, errmsg);
+        return (value);
+    } catch (const boost::bad_lexical_cast&) {
+        bundy_throw(bundy::InvalidParameter, errmsg);
+    }
+}
+
+bool
+CommandOptions::parse(int argc, char** const argv) {
+    // See perfdhcp's CommandOptions::parse() about resetting getopt().
+#ifdef __GLIBC__
+    optind = 0;
+#else
+    optind = 1;
+#endif
+#ifdef HAVE_OPTRESET
+    optreset = 1;
+#endif
+    opterr = 0;
+
+    reset();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hvs:p:d:f:m:T:Q:a:q:n:l:t:eb:DRy:H"))
+           != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return (true);
+
+        case 'v':
+            version();
+            return (true);
+
+        case 's':
+            server_ = optarg;
+            break;
+
+        case 'p':
+            port_ = getInteger(1, 0xffff, "value of port: -p<port> must be "
+                               "between 1 and 65535");
+            break;
+
+        case 'd':
+            input_file_ = optarg;
+            break;
+
+        case 'f':
+            if (string(optarg) == "text") {
+                input_format_ = FORMAT_TEXT;
+            } else if (string(optarg) == "pcap") {
+                input_format_ = FORMAT_PCAP;
+            } else {
+                bundy_throw(bundy::InvalidParameter, "value of input format: "
+                            "-f<format> must be 'text' or 'pcap'");
+            }
+            break;
+
+        case 'm':
+            if (string(optarg) == "udp") {
+                transport_ = TRANSPORT_UDP;
+            } else if (string(optarg) == "tcp") {
+                transport_ = TRANSPORT_TCP;
+            } else {
+                bundy_throw(bundy::InvalidParameter, "value of transport: "
+                            "-m<mode> must be 'udp' or 'tcp'");
+            }
+            break;
+
+        case 'T':
+            threads_ = getInteger(1, 1024, "value of threads: -T<threads> "
+                                  "must be between 1 and 1024");
+            break;
+
+        case 'Q':
+            rate_ = getInteger(0, 100000000, "value of rate: -Q<rate> must "
+                               "not be a negative integer");
+            break;
+
+        case 'a':
+            aggressivity_ = getInteger(1, 1024, "value of aggressivity: "
+                                       "-a<value> must be between 1 and "
+                                       "1024");
+            break;
+
+        case 'q':
+            // Query IDs of the outstanding queries of a thread must be
+            // unique.
+            max_outstanding_ = getInteger(1, 0xffff, "value of outstanding "
+                                          "queries: -q<num> must be between "
+                                          "1 and 65535");
+            break;
+
+        case 'n':
+            runs_ = getInteger(1, 1000000000, "value of runs: -n<runs> must "
+                               "be a positive integer");
+            break;
+
+        case 'l':
+            time_limit_ = getInteger(1, 1000000000, "value of time limit: "
+                                     "-l<seconds> must be a positive "
+                                     "integer");
+            break;
+
+        case 't':
+            timeout_ = getInteger(1, 1000000000, "value of timeout: "
+                                  "-t<milliseconds> must be a positive "
+                                  "integer");
+            break;
+
+        case 'e':
+            edns_ = true;
+            break;
+
+        case 'b':
+            udp_size_ = getInteger(512, 0xffff, "value of EDNS buffer size: "
+                                   "-b<size> must be between 512 and 65535");
+            edns_ = true;
+            break;
+
+        case 'D':
+            dnssec_ok_ = true;
+            edns_ = true;
+            break;
+
+        case 'R':
+            recursion_desired_ = true;
+            break;
+
+        case 'y':
+            try {
+                tsig_key_.reset(new dns::TSIGKey(optarg));
+            } catch (const bundy::Exception& ex) {
+                bundy_throw(bundy::InvalidParameter, "value of TSIG key: "
+                            "-y<name:secret[:algorithm]> is invalid: " <<
+                            ex.what());
+            }
+            break;
+
+        case 'H':
+            histogram_ = true;
+            break;
+
+        default:
+            bundy_throw(bundy::InvalidParameter,
+                        "unknown command line option");
+        }
+    }
+    check(optind < argc, "extra arguments?");
+
+    // Without any limit, each query in the input is sent once.
+    if (runs_ == 0 && time_limit_ == 0) {
+        runs_ = 1;
+    }
+    validate();
+    return (false);
+}
+
+void
+CommandOptions::validate() const {
+    check(input_file_.empty(), "query input file must be specified with "
+          "-d<file>");
+    // Each thread is given its share of the rate; a share of 0 would mean
+    // no limit at all.
+    check(rate_ > 0 && rate_ < threads_, "rate -Q<rate> must not be lower "
+          "than the number of threads");
+}
+
+void
+CommandOptions::usage() const {
+    cout <<
+        "perfdns [-hv] [-s<server>] [-p<port>] -d<query-file> [-f<format>]\n"
+        "        [-m<mode>] [-T<threads>] [-Q<rate>] [-a<aggressivity>]\n"
+        "        [-q<outstanding>] [-n<runs>] [-l<time-limit>]\n"
+        "        [-t<timeout>] [-e] [-b<bufsize>] [-D] [-R]\n"
+        "        [-y<name:secret[:algorithm]>] [-H]\n"
+        "\n"
+        "Send DNS queries read from a file to a server and report the\n"
+        "query rate, response codes and latency of the responses.\n"
+        "\n"
+        "Options:\n"
+        "-a<aggressivity>: the maximum number of queries a thread sends at\n"
+        "    once to catch up with the rate (default 16).  With UDP this is\n"
+        "    also the maximum number of queries per sendmmsg() call.\n"
+        "-b<bufsize>: the EDNS UDP payload size (default 4096, implies -e).\n"
+        "-d<query-file>: the file to read the queries from.\n"
+        "-D: set the DO bit in queries (implies -e).\n"
+        "-e: include an EDNS OPT RR in queries.\n"
+        "-f<format>: the format of the query file: 'text' (default), with\n"
+        "    one query per line in the form of \"name type\", or 'pcap', a\n"
+        "    packet capture of which the UDP queries to port 53 are used.\n"
+        "-h: print this help.\n"
+        "-H: print the latency histogram.\n"
+        "-l<time-limit>: stop sending queries after this many seconds.\n"
+        "-m<mode>: the transport, 'udp' (default) or 'tcp'.  With TCP each\n"
+        "    thread pipelines its queries over a single connection.\n"
+        "-n<runs>: the number of times to send the queries in the file\n"
+        "    (default 1, unless -l is specified).\n"
+        "-p<port>: the server port (default 53).\n"
+        "-q<outstanding>: the maximum number of outstanding queries of each\n"
+        "    thread (default 100).\n"
+        "-Q<rate>: the total number of queries per second to send, shared\n"
+        "    by all the threads (default 0, as fast as possible).\n"
+        "-R: set the RD bit in queries.\n"
+        "-s<server>: the name or address of the server (default 127.0.0.1).\n"
+        "-t<timeout>: the time in milliseconds after which a query is\n"
+        "    considered lost (default 2000).\n"
+        "-T<threads>: the number of sending threads (default 1).\n"
+        "-v: print the version.\n"
+        "-y<name:secret[:algorithm]>: sign queries with this TSIG key.\n";
+}
+
+void
+CommandOptions::version() const {
+    cout << "VERSION: " << VERSION << endl;
+}
+
+} // namespace perfdns
+} // namespace bundy
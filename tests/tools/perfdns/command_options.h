@@ -0,0 +1,166 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_COMMAND_OPTIONS_H
+#define PERFDNS_COMMAND_OPTIONS_H
+
+#include <dns/tsigkey.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief Command line options of perfdns.
+///
+/// This class parses and holds the command line options of perfdns.
+/// The options are checked for consistency by \c parse(), so the rest
+/// of the tool can use them as they are.
+class CommandOptions : public boost::noncopyable {
+public:
+    /// \brief The format of the query input file.
+    enum InputFormat {
+        FORMAT_TEXT,            ///< Lines of "name type"
+        FORMAT_PCAP             ///< A pcap capture of queries
+    };
+
+    /// \brief The transport protocol to send queries with.
+    enum Transport {
+        TRANSPORT_UDP,
+        TRANSPORT_TCP
+    };
+
+    /// \brief Constructor.
+    ///
+    /// All options get their default values.
+    CommandOptions();
+
+    /// \brief Parse the command line.
+    ///
+    /// \param argc The number of arguments.
+    /// \param argv The arguments, including the program name.
+    /// \return true if the help or version was requested (and printed),
+    ///     false otherwise.
+    /// \throw bundy::InvalidParameter if the command line is invalid.
+    bool parse(int argc, char** const argv);
+
+    /// \brief Print the usage of the program to the standard output.
+    void usage() const;
+
+    /// \brief Print the version of the program to the standard output.
+    void version() const;
+
+    /// \brief Returns the name or address of the server.
+    const std::string& getServer() const { return (server_); }
+
+    /// \brief Returns the port of the server.
+    uint16_t getPort() const { return (port_); }
+
+    /// \brief Returns the name of the query input file.
+    const std::string& getInputFile() const { return (input_file_); }
+
+    /// \brief Returns the format of the query input file.
+    InputFormat getInputFormat() const { return (input_format_); }
+
+    /// \brief Returns the transport protocol.
+    Transport getTransport() const { return (transport_); }
+
+    /// \brief Returns the number of sending threads.
+    int getThreads() const { return (threads_); }
+
+    /// \brief Returns the total query rate (0 means as fast as possible).
+    int getRate() const { return (rate_); }
+
+    /// \brief Returns the maximum number of queries sent at once.
+    ///
+    /// As in perfdhcp, this is passed to \c RateControl as the
+    /// aggressivity; with UDP it is also the maximum number of queries
+    /// passed to a single \c sendmmsg() call.
+    int getAggressivity() const { return (aggressivity_); }
+
+    /// \brief Returns the maximum number of outstanding queries per thread.
+    int getMaxOutstanding() const { return (max_outstanding_); }
+
+    /// \brief Returns the number of runs through the input (0: unlimited).
+    int getRuns() const { return (runs_); }
+
+    /// \brief Returns the time limit of the test in seconds (0: none).
+    int getTimeLimit() const { return (time_limit_); }
+
+    /// \brief Returns the query timeout in milliseconds.
+    int getTimeout() const { return (timeout_); }
+
+    /// \brief Returns whether queries include an EDNS OPT RR.
+    bool isEDNS() const { return (edns_); }
+
+    /// \brief Returns the EDNS UDP payload size.
+    uint16_t getUDPSize() const { return (udp_size_); }
+
+    /// \brief Returns whether the DO bit is set in queries.
+    bool isDNSSECOK() const { return (dnssec_ok_); }
+
+    /// \brief Returns whether the RD bit is set in queries.
+    bool isRecursionDesired() const { return (recursion_desired_); }
+
+    /// \brief Returns the key to sign queries with, or NULL if queries are
+    /// not signed.
+    const dns::TSIGKey* getTSIGKey() const { return (tsig_key_.get()); }
+
+    /// \brief Returns whether the latency histogram is printed.
+    bool isHistogram() const { return (histogram_); }
+
+private:
+    /// \brief Reset all options to their defaults.
+    void reset();
+
+    /// \brief Throw \c bundy::InvalidParameter with the given message if
+    /// the condition holds.
+    void check(bool condition, const std::string& errmsg) const;
+
+    /// \brief Convert the current option argument to an integer in the
+    /// given range.
+    int getInteger(int min, int max, const std::string& errmsg) const;
+
+    /// \brief Check the consistency of the options.
+    void validate() const;
+
+    std::string server_;
+    uint16_t port_;
+    std::string input_file_;
+    InputFormat input_format_;
+    Transport transport_;
+    int threads_;
+    int rate_;
+    int aggressivity_;
+    int max_outstanding_;
+    int runs_;
+    int time_limit_;
+    int timeout_;
+    bool edns_;
+    uint16_t udp_size_;
+    bool dnssec_ok_;
+    bool recursion_desired_;
+    boost::shared_ptr<dns::TSIGKey> tsig_key_;
+    bool histogram_;
+};
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_COMMAND_OPTIONS_H
@@ -0,0 +1,64 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <iostream>
+
+#include <config.h>
+#include <exceptions/exceptions.h>
+
+#include "command_options.h"
+#include "query_builder.h"
+#include "query_list.h"
+#include "test_control.h"
+
+using namespace bundy::perfdns;
+
+int
+main(int argc, char* argv[]) {
+    CommandOptions options;
+    try {
+        // If parser returns true it means that user specified
+        // 'h' or 'v' command line option.
+        if (options.parse(argc, argv)) {
+            return (0);
+        }
+    } catch (const bundy::Exception& e) {
+        std::cerr << "Error parsing command line options: "
+                  << e.what() << std::endl;
+        options.usage();
+        return (1);
+    }
+    try {
+        QueryList queries;
+        queries.load(options.getInputFile(),
+                     options.getInputFormat() == CommandOptions::FORMAT_PCAP);
+        std::cout << "Loaded " << queries.getQuestions().size()
+                  << " queries from " << options.getInputFile();
+        if (queries.getSkipped() > 0) {
+            std::cout << " (" << queries.getSkipped()
+                      << " packets skipped)";
+        }
+        std::cout << std::endl;
+        const QueryBuilder builder(queries.getQuestions(),
+                                   options.isRecursionDesired(),
+                                   options.isEDNS(), options.getUDPSize(),
+                                   options.isDNSSECOK(),
+                                   options.getTSIGKey());
+        TestControl test_control(options, builder);
+        return (test_control.run());
+    } catch (const bundy::Exception& e) {
+        std::cerr << "Error running perfdns: " << e.what() << std::endl;
+        return (1);
+    }
+}
@@ -0,0 +1,95 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "query_builder.h"
+
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/opcode.h>
+#include <dns/rcode.h>
+#include <dns/tsig.h>
+#include <dns/tsigrecord.h>
+
+#include <cassert>
+
+using namespace std;
+using namespace bundy::dns;
+
+namespace bundy {
+namespace perfdns {
+
+namespace {
+// Offset of the ARCOUNT field in the header.
+const size_t ARCOUNT_OFFSET = 10;
+}
+
+QueryBuilder::QueryBuilder(const vector<Question>& questions,
+                           bool recursion_desired, bool edns,
+                           uint16_t udp_size, bool dnssec_ok,
+                           const TSIGKey* tsig_key) :
+    tsig_key_(tsig_key != NULL ? new TSIGKey(*tsig_key) : NULL)
+{
+    EDNSPtr opt;
+    if (edns) {
+        opt.reset(new EDNS());
+        opt->setUDPSize(udp_size);
+        opt->setDNSSECAwareness(dnssec_ok);
+    }
+    queries_.reserve(questions.size());
+    MessageRenderer renderer;
+    for (vector<Question>::const_iterator it = questions.begin();
+         it != questions.end();
+         ++it) {
+        Message message(Message::RENDER);
+        message.setQid(0);
+        message.setOpcode(Opcode::QUERY());
+        message.setRcode(Rcode::NOERROR());
+        message.setHeaderFlag(Message::HEADERFLAG_RD, recursion_desired);
+        message.addQuestion(*it);
+        if (opt) {
+            message.setEDNS(opt);
+        }
+        renderer.clear();
+        message.toWire(renderer);
+        const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+        queries_.push_back(vector<uint8_t>(data,
+                                           data + renderer.getLength()));
+    }
+}
+
+void
+QueryBuilder::build(size_t index, uint16_t qid,
+                    util::OutputBuffer& buffer) const
+{
+    assert(index < queries_.size());
+    const vector<uint8_t>& query = queries_[index];
+    const size_t start = buffer.getLength();
+    buffer.writeData(&query[0], query.size());
+    buffer.writeUint16At(qid, start);
+    if (tsig_key_) {
+        TSIGContext ctx(*tsig_key_);
+        const ConstTSIGRecordPtr record =
+            ctx.sign(qid, static_cast<const uint8_t*>(buffer.getData()) +
+                     start, query.size());
+        record->toWire(buffer);
+        const uint8_t* arcount = static_cast<const uint8_t*>(buffer.getData()) +
+            start + ARCOUNT_OFFSET;
+        buffer.writeUint16At(((arcount[0] << 8) | arcount[1]) + 1,
+                             start + ARCOUNT_OFFSET);
+    }
+}
+
+} // namespace perfdns
+} // namespace bundy
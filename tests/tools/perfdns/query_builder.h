@@ -0,0 +1,75 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_QUERY_BUILDER_H
+#define PERFDNS_QUERY_BUILDER_H
+
+#include <dns/question.h>
+#include <dns/tsigkey.h>
+
+#include <util/buffer.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief Builder of the wire format queries.
+///
+/// The queries for all questions are rendered once on construction, with
+/// the header flags and EDNS given to the constructor, so sending a query
+/// only needs to copy its data and set the query ID.  Queries to be signed
+/// with TSIG are signed each time they are built, as the signature covers
+/// the query ID and time.
+///
+/// Building queries doesn't modify the object, so it can be shared by
+/// the sending threads.
+class QueryBuilder : public boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param questions The questions of the queries.
+    /// \param recursion_desired Whether to set the RD bit.
+    /// \param edns Whether to include an EDNS OPT RR.
+    /// \param udp_size The UDP payload size of the OPT RR.
+    /// \param dnssec_ok Whether to set the DO bit of the OPT RR.
+    /// \param tsig_key The key to sign queries with, or NULL.
+    QueryBuilder(const std::vector<dns::Question>& questions,
+                 bool recursion_desired, bool edns, uint16_t udp_size,
+                 bool dnssec_ok, const dns::TSIGKey* tsig_key);
+
+    /// \brief Returns the number of queries.
+    size_t getQueryCount() const { return (queries_.size()); }
+
+    /// \brief Append a query to the buffer.
+    ///
+    /// \param index The index of the query, less than \c getQueryCount().
+    /// \param qid The query ID.
+    /// \param buffer The buffer to append the query to.
+    void build(size_t index, uint16_t qid, util::OutputBuffer& buffer) const;
+
+private:
+    std::vector<std::vector<uint8_t> > queries_;
+    boost::scoped_ptr<dns::TSIGKey> tsig_key_;
+};
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_QUERY_BUILDER_H
@@ -0,0 +1,247 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "query_list.h"
+
+#include <exceptions/exceptions.h>
+
+#include <util/buffer.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace bundy::dns;
+
+namespace bundy {
+namespace perfdns {
+
+namespace {
+// Magic numbers of pcap files, with microsecond and nanosecond time stamps.
+const uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+const uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;
+
+// Sizes of the pcap file header and packet record headers.
+const size_t PCAP_HEADER_LENGTH = 24;
+const size_t PCAP_RECORD_LENGTH = 16;
+
+// A (very generous) limit of the size of captured packets, so a corrupted
+// file doesn't make us allocate arbitrary amounts of memory.
+const uint32_t PCAP_MAX_PACKET_LENGTH = 0x40000;
+
+// Link layer types we know.
+const uint32_t LINKTYPE_NULL = 0;
+const uint32_t LINKTYPE_ETHERNET = 1;
+const uint32_t LINKTYPE_RAW_BSD = 12;
+const uint32_t LINKTYPE_RAW = 101;
+const uint32_t LINKTYPE_LOOP = 108;
+const uint32_t LINKTYPE_LINUX_SLL = 113;
+
+const uint16_t ETHERTYPE_IP = 0x0800;
+const uint16_t ETHERTYPE_IPV6 = 0x86dd;
+const uint16_t ETHERTYPE_VLAN = 0x8100;
+const uint16_t ETHERTYPE_QINQ = 0x88a8;
+
+const uint8_t IPPROTO_UDP_NUMBER = 17;
+const uint16_t DNS_PORT = 53;
+const size_t DNS_HEADER_LENGTH = 12;
+
+uint16_t
+readUint16(const uint8_t* data) {
+    return ((data[0] << 8) | data[1]);
+}
+
+uint32_t
+readUint32(const uint8_t* data, bool swap) {
+    if (swap) {
+        return ((data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0]);
+    }
+    return ((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+}
+}
+
+void
+QueryList::loadText(istream& input, const string& source) {
+    string line;
+    size_t line_number = 0;
+    while (getline(input, line)) {
+        ++line_number;
+        istringstream iss(line);
+        string name, type, extra;
+        if (!(iss >> name) || name[0] == '#' || name[0] == ';') {
+            continue;
+        }
+        if (!(iss >> type) || (iss >> extra)) {
+            bundy_throw(bundy::BadValue, source << ":" << line_number <<
+                        ": expected \"name type\": " << line);
+        }
+        try {
+            questions_.push_back(Question(Name(name), RRClass::IN(),
+                                          RRType(type)));
+        } catch (const bundy::Exception& ex) {
+            bundy_throw(bundy::BadValue, source << ":" << line_number <<
+                        ": " << ex.what());
+        }
+    }
+}
+
+void
+QueryList::loadPcap(istream& input, const string& source) {
+    uint8_t header[PCAP_HEADER_LENGTH];
+    if (!input.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        bundy_throw(bundy::BadValue, source << ": not a pcap file");
+    }
+    bool swap;
+    const uint32_t magic = readUint32(header, false);
+    if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NSEC) {
+        swap = false;
+    } else if (readUint32(header, true) == PCAP_MAGIC ||
+               readUint32(header, true) == PCAP_MAGIC_NSEC) {
+        swap = true;
+    } else {
+        bundy_throw(bundy::BadValue, source << ": not a pcap file");
+    }
+    const uint32_t linktype = readUint32(header + 20, swap);
+
+    vector<uint8_t> packet;
+    uint8_t record[PCAP_RECORD_LENGTH];
+    while (input.read(reinterpret_cast<char*>(record), sizeof(record))) {
+        const uint32_t length = readUint32(record + 8, swap);
+        if (length > PCAP_MAX_PACKET_LENGTH) {
+            bundy_throw(bundy::BadValue, source << ": invalid packet length "
+                        << length);
+        }
+        packet.resize(length);
+        if (length > 0 &&
+            !input.read(reinterpret_cast<char*>(&packet[0]), length)) {
+            bundy_throw(bundy::BadValue, source << ": truncated packet");
+        }
+        if (length == 0 || !addPacket(&packet[0], length, linktype)) {
+            ++skipped_;
+        }
+    }
+    if (input.gcount() != 0) {
+        bundy_throw(bundy::BadValue, source << ": truncated packet header");
+    }
+}
+
+void
+QueryList::load(const string& filename, bool pcap) {
+    ifstream input(filename.c_str(), pcap ? ios::in | ios::binary : ios::in);
+    if (!input) {
+        bundy_throw(bundy::BadValue, "failed to open " << filename);
+    }
+    if (pcap) {
+        loadPcap(input, filename);
+    } else {
+        loadText(input, filename);
+    }
+}
+
+bool
+QueryList::addPacket(const uint8_t* data, size_t length, uint32_t linktype) {
+    // Skip the link layer header.
+    size_t offset = 0;
+    uint16_t ethertype = 0;     // 0: decide by the IP version
+    switch (linktype) {
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+        offset = 4;
+        break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_RAW_BSD:
+        break;
+    case LINKTYPE_ETHERNET:
+        offset = 14;
+        if (length < offset) {
+            return (false);
+        }
+        ethertype = readUint16(data + 12);
+        while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) &&
+               length >= offset + 4) {
+            ethertype = readUint16(data + offset + 2);
+            offset += 4;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        offset = 16;
+        if (length < offset) {
+            return (false);
+        }
+        ethertype = readUint16(data + 14);
+        break;
+    default:
+        return (false);
+    }
+    if (length <= offset) {
+        return (false);
+    }
+    data += offset;
+    length -= offset;
+
+    // Find the UDP datagram in the IP packet.  Fragments and IPv6 packets
+    // with extension headers are skipped.
+    const unsigned int ip_version = data[0] >> 4;
+    if (ip_version == 4 && (ethertype == 0 || ethertype == ETHERTYPE_IP)) {
+        const size_t header_length = (data[0] & 0x0f) * 4;
+        if (length < 20 || header_length < 20 || length < header_length ||
+            data[9] != IPPROTO_UDP_NUMBER ||
+            (readUint16(data + 6) & 0x3fff) != 0) {
+            return (false);
+        }
+        // Ignore the link layer padding.
+        length = min<size_t>(length, readUint16(data + 2));
+        offset = header_length;
+    } else if (ip_version == 6 &&
+               (ethertype == 0 || ethertype == ETHERTYPE_IPV6)) {
+        if (length < 40 || data[6] != IPPROTO_UDP_NUMBER) {
+            return (false);
+        }
+        length = min<size_t>(length, 40 + readUint16(data + 4));
+        offset = 40;
+    } else {
+        return (false);
+    }
+    if (length < offset + 8 || readUint16(data + offset + 2) != DNS_PORT) {
+        return (false);
+    }
+    length = min<size_t>(length, offset + readUint16(data + offset + 4));
+    offset += 8;
+    if (length < offset + DNS_HEADER_LENGTH) {
+        return (false);
+    }
+    data += offset;
+    length -= offset;
+
+    // Take the question of a standard query.
+    if ((data[2] & 0x80) != 0 || ((data[2] >> 3) & 0x0f) != 0 ||
+        readUint16(data + 4) != 1) {
+        return (false);
+    }
+    try {
+        util::InputBuffer buffer(data, length);
+        buffer.setPosition(DNS_HEADER_LENGTH);
+        questions_.push_back(Question(buffer));
+    } catch (const bundy::Exception&) {
+        return (false);
+    }
+    return (true);
+}
+
+} // namespace perfdns
+} // namespace bundy
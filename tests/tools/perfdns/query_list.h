@@ -0,0 +1,95 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_QUERY_LIST_H
+#define PERFDNS_QUERY_LIST_H
+
+#include <dns/question.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief The mix of queries to send.
+///
+/// This class holds the questions of the queries perfdns sends, in the
+/// order they are sent.  They are read either from a text file, or from
+/// a packet capture of real queries, so the mix of names and types of a
+/// production server can be replayed.  Only the questions are taken from
+/// a capture; the rest of the queries (flags, EDNS and TSIG) is built
+/// from the command line options.
+class QueryList {
+public:
+    /// \brief Constructor of an empty list.
+    QueryList() : skipped_(0) {}
+
+    /// \brief Add queries from text.
+    ///
+    /// Each line is of the form "name type", e.g., "www.example.com AAAA".
+    /// The class is IN.  Empty lines and lines beginning with '#' or ';'
+    /// are ignored.
+    ///
+    /// \param input The stream to read the queries from.
+    /// \param source The name of the input, used in error messages.
+    /// \throw bundy::BadValue if a line is invalid.
+    void loadText(std::istream& input, const std::string& source);
+
+    /// \brief Add queries from a pcap capture.
+    ///
+    /// The queries are the UDP packets to port 53 (over IPv4 or IPv6, with
+    /// Ethernet, Linux cooked, loopback or raw IP link layers) that are
+    /// DNS queries with exactly one question.  Other packets are skipped,
+    /// and counted in \c getSkipped().
+    ///
+    /// \param input The stream to read the capture from.
+    /// \param source The name of the input, used in error messages.
+    /// \throw bundy::BadValue if the input is not a pcap capture, or is
+    ///     truncated.
+    void loadPcap(std::istream& input, const std::string& source);
+
+    /// \brief Add queries from a file of the given format.
+    ///
+    /// \param filename The name of the file.
+    /// \param pcap Whether the file is a pcap capture, rather than text.
+    /// \throw bundy::BadValue if the file can't be opened or is invalid.
+    void load(const std::string& filename, bool pcap);
+
+    /// \brief Returns the questions.
+    const std::vector<dns::Question>& getQuestions() const {
+        return (questions_);
+    }
+
+    /// \brief Returns the number of packets of pcap captures that weren't
+    /// used as queries.
+    size_t getSkipped() const { return (skipped_); }
+
+private:
+    /// \brief Add the query in a captured packet, if it is one.
+    ///
+    /// \return true if the packet is a query and was added.
+    bool addPacket(const uint8_t* data, size_t length, uint32_t linktype);
+
+    std::vector<dns::Question> questions_;
+    size_t skipped_;
+};
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_QUERY_LIST_H
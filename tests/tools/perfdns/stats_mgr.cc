@@ -0,0 +1,278 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "stats_mgr.h"
+
+#include <dns/rcode.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+using namespace std;
+
+namespace bundy {
+namespace perfdns {
+
+namespace {
+// The number of buckets each power of two range is divided into.
+const unsigned int SUB_BUCKETS = 32;
+const unsigned int SUB_BUCKET_BITS = 5;
+
+// Latencies below this have a bucket each.
+const uint64_t LINEAR_LIMIT = 2 * SUB_BUCKETS;
+
+// Latencies above this (more than an hour) are counted in the last bucket.
+const uint64_t MAX_LATENCY = 0xffffffffULL;
+
+const size_t BUCKET_COUNT =
+    LINEAR_LIMIT + (32 - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+double
+toMsec(double usec) {
+    return (usec / 1000.0);
+}
+}
+
+LatencyHistogram::LatencyHistogram() :
+    buckets_(BUCKET_COUNT), count_(0), min_(0), max_(0), sum_(0),
+    sum_squares_(0)
+{}
+
+size_t
+LatencyHistogram::getBucket(uint64_t usec) {
+    if (usec < LINEAR_LIMIT) {
+        return (usec);
+    }
+    usec = min(usec, MAX_LATENCY);
+    unsigned int msb = SUB_BUCKET_BITS + 1;
+    while ((usec >> (msb + 1)) != 0) {
+        ++msb;
+    }
+    const unsigned int shift = msb - SUB_BUCKET_BITS;
+    return (LINEAR_LIMIT + (shift - 1) * SUB_BUCKETS +
+            ((usec >> shift) - SUB_BUCKETS));
+}
+
+uint64_t
+LatencyHistogram::getBucketLow(size_t bucket) {
+    if (bucket < LINEAR_LIMIT) {
+        return (bucket);
+    }
+    const unsigned int shift = (bucket - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+    return (static_cast<uint64_t>((bucket - LINEAR_LIMIT) % SUB_BUCKETS +
+                                  SUB_BUCKETS) << shift);
+}
+
+uint64_t
+LatencyHistogram::getBucketHigh(size_t bucket) {
+    if (bucket < LINEAR_LIMIT) {
+        return (bucket);
+    }
+    const unsigned int shift = (bucket - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+    return (getBucketLow(bucket) + (static_cast<uint64_t>(1) << shift) - 1);
+}
+
+void
+LatencyHistogram::add(uint64_t usec) {
+    ++buckets_[getBucket(usec)];
+    if (count_ == 0 || usec < min_) {
+        min_ = usec;
+    }
+    max_ = max(max_, usec);
+    ++count_;
+    sum_ += usec;
+    sum_squares_ += static_cast<double>(usec) * usec;
+}
+
+void
+LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    if (count_ == 0 || other.min_ < min_) {
+        min_ = other.min_;
+    }
+    max_ = max(max_, other.max_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+    sum_squares_ += other.sum_squares_;
+}
+
+double
+LatencyHistogram::getMean() const {
+    return (count_ > 0 ? sum_ / count_ : 0);
+}
+
+double
+LatencyHistogram::getStddev() const {
+    if (count_ == 0) {
+        return (0);
+    }
+    const double mean = getMean();
+    const double variance = sum_squares_ / count_ - mean * mean;
+    return (variance > 0 ? sqrt(variance) : 0);
+}
+
+uint64_t
+LatencyHistogram::getPercentile(double percent) const {
+    if (count_ == 0) {
+        return (0);
+    }
+    const uint64_t target =
+        max<uint64_t>(1, static_cast<uint64_t>(ceil(count_ * percent / 100)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        cumulative += buckets_[i];
+        if (cumulative >= target) {
+            return (min(getBucketHigh(i), max_));
+        }
+    }
+    return (max_);
+}
+
+void
+LatencyHistogram::print(ostream& os) const {
+    uint64_t cumulative = 0;
+    os << "Latency histogram (ms):" << endl;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (buckets_[i] == 0) {
+            continue;
+        }
+        cumulative += buckets_[i];
+        os << "  " << fixed << setprecision(3) << setw(10)
+           << toMsec(getBucketLow(i)) << " - " << setw(10)
+           << toMsec(getBucketHigh(i)) << ": " << setw(10) << buckets_[i]
+           << " " << setprecision(2) << setw(6)
+           << (100.0 * cumulative / count_) << "%" << endl;
+    }
+}
+
+QueryStats::QueryStats() :
+    sent(0), received(0), lost(0), unexpected(0), truncated(0),
+    send_errors(0), connections(0), bytes_sent(0), bytes_received(0)
+{
+    memset(rcodes, 0, sizeof(rcodes));
+}
+
+void
+QueryStats::merge(const QueryStats& other) {
+    sent += other.sent;
+    received += other.received;
+    lost += other.lost;
+    unexpected += other.unexpected;
+    truncated += other.truncated;
+    send_errors += other.send_errors;
+    connections += other.connections;
+    bytes_sent += other.bytes_sent;
+    bytes_received += other.bytes_received;
+    for (size_t i = 0; i < sizeof(rcodes) / sizeof(rcodes[0]); ++i) {
+        rcodes[i] += other.rcodes[i];
+    }
+    latency.merge(other.latency);
+}
+
+StatsMgr::StatsMgr(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) {
+        thread_stats_.push_back(boost::shared_ptr<QueryStats>(
+                                    new QueryStats));
+    }
+}
+
+QueryStats&
+StatsMgr::getThreadStats(size_t thread) {
+    assert(thread < thread_stats_.size());
+    return (*thread_stats_[thread]);
+}
+
+QueryStats
+StatsMgr::getTotal() const {
+    QueryStats total;
+    for (size_t i = 0; i < thread_stats_.size(); ++i) {
+        total.merge(*thread_stats_[i]);
+    }
+    return (total);
+}
+
+void
+StatsMgr::print(ostream& os, double duration, bool histogram) const {
+    const QueryStats total = getTotal();
+    const double sent = max<uint64_t>(total.sent, 1);
+    const double received = max<uint64_t>(total.received, 1);
+
+    os << fixed << setprecision(2);
+    os << "Statistics:" << endl;
+    os << "  Queries sent:         " << total.sent << endl;
+    os << "  Queries completed:    " << total.received << " ("
+       << (100 * total.received / sent) << "%)" << endl;
+    os << "  Queries lost:         " << total.lost << " ("
+       << (100 * total.lost / sent) << "%)" << endl;
+    if (total.send_errors > 0) {
+        os << "  Send errors:          " << total.send_errors << endl;
+    }
+    if (total.unexpected > 0) {
+        os << "  Unexpected responses: " << total.unexpected << endl;
+    }
+    if (total.truncated > 0) {
+        os << "  Truncated responses:  " << total.truncated << endl;
+    }
+    if (total.connections > 0) {
+        os << "  TCP connections:      " << total.connections << endl;
+    }
+    os << "  Response codes:      ";
+    bool first = true;
+    for (size_t i = 0; i < sizeof(total.rcodes) / sizeof(total.rcodes[0]);
+         ++i) {
+        if (total.rcodes[i] == 0) {
+            continue;
+        }
+        os << (first ? " " : ", ") << dns::Rcode(i).toText() << " "
+           << total.rcodes[i] << " (" << (100 * total.rcodes[i] / received)
+           << "%)";
+        first = false;
+    }
+    os << endl;
+    os << "  Bytes sent:           " << total.bytes_sent << endl;
+    os << "  Bytes received:       " << total.bytes_received << endl;
+    os << "  Run time (s):         " << setprecision(6) << duration << endl;
+    if (duration > 0) {
+        os << "  Queries per second:   " << (total.received / duration)
+           << endl;
+    }
+
+    const LatencyHistogram& latency = total.latency;
+    os << setprecision(3);
+    os << "Latency (ms):" << endl;
+    os << "  min/avg/max/stddev:   " << toMsec(latency.getMin()) << "/"
+       << toMsec(latency.getMean()) << "/" << toMsec(latency.getMax())
+       << "/" << toMsec(latency.getStddev()) << endl;
+    const double percents[] = { 50, 90, 99, 99.9, 99.99 };
+    os << "  percentiles:         ";
+    for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); ++i) {
+        os << " " << setprecision(2) << percents[i] << "%: "
+           << setprecision(3) << toMsec(latency.getPercentile(percents[i]));
+    }
+    os << endl;
+    if (histogram) {
+        latency.print(os);
+    }
+}
+
+} // namespace perfdns
+} // namespace bundy
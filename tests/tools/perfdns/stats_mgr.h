@@ -0,0 +1,156 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_STATS_MGR_H
+#define PERFDNS_STATS_MGR_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ostream>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief Histogram of response latencies.
+///
+/// Latencies are counted in buckets whose width grows with the latency,
+/// so the relative error of a bucket is below about 3% for any latency:
+/// latencies below 64 microseconds have a bucket each, and each further
+/// power of two range is divided into 32 buckets.  This keeps the
+/// histogram small (under 900 buckets up to more than an hour) and
+/// recording a latency cheap, while percentiles can be reported
+/// accurately enough.
+class LatencyHistogram {
+public:
+    /// \brief Constructor of an empty histogram.
+    LatencyHistogram();
+
+    /// \brief Count a latency.
+    ///
+    /// \param usec The latency in microseconds.
+    void add(uint64_t usec);
+
+    /// \brief Add the counts of another histogram to this one.
+    void merge(const LatencyHistogram& other);
+
+    /// \brief Returns the number of latencies counted.
+    uint64_t getCount() const { return (count_); }
+
+    /// \brief Returns the lowest latency counted (0 if none).
+    uint64_t getMin() const { return (count_ > 0 ? min_ : 0); }
+
+    /// \brief Returns the highest latency counted (0 if none).
+    uint64_t getMax() const { return (max_); }
+
+    /// \brief Returns the mean latency (0 if none).
+    double getMean() const;
+
+    /// \brief Returns the standard deviation of the latencies (0 if none).
+    double getStddev() const;
+
+    /// \brief Returns a percentile of the latencies.
+    ///
+    /// The returned value is the upper bound of the bucket that contains
+    /// the percentile, but not more than the highest latency counted.
+    ///
+    /// \param percent The percentile, between 0 and 100.
+    /// \return The percentile in microseconds, or 0 if no latencies were
+    ///     counted.
+    uint64_t getPercentile(double percent) const;
+
+    /// \brief Print the non-empty buckets.
+    ///
+    /// Each line has the lower and upper bound of the bucket in
+    /// milliseconds, the count and the cumulative percentage.
+    void print(std::ostream& os) const;
+
+    /// \brief Returns the index of the bucket of a latency.
+    static size_t getBucket(uint64_t usec);
+
+    /// \brief Returns the lowest latency of a bucket.
+    static uint64_t getBucketLow(size_t bucket);
+
+    /// \brief Returns the highest latency of a bucket.
+    static uint64_t getBucketHigh(size_t bucket);
+
+private:
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+    double sum_squares_;
+};
+
+/// \brief Statistics of the queries of a sending thread.
+///
+/// Each sending thread updates its own object, without locking, and
+/// \c StatsMgr sums them up when the test is done.
+struct QueryStats {
+    /// \brief Constructor with all the counters 0.
+    QueryStats();
+
+    /// \brief Add the counters of another object to this one.
+    void merge(const QueryStats& other);
+
+    uint64_t sent;              ///< Queries sent
+    uint64_t received;          ///< Responses matched with a query
+    uint64_t lost;              ///< Queries not responded in time
+    uint64_t unexpected;        ///< Responses not matched with a query
+    uint64_t truncated;         ///< Responses with the TC bit set
+    uint64_t send_errors;       ///< Queries that failed to be sent
+    uint64_t connections;       ///< TCP connections made
+    uint64_t bytes_sent;        ///< Bytes of queries sent
+    uint64_t bytes_received;    ///< Bytes of responses received
+    uint64_t rcodes[16];        ///< Responses per response code
+    LatencyHistogram latency;   ///< Latencies of the responses
+};
+
+/// \brief Statistics manager of perfdns.
+///
+/// As the statistics manager of perfdhcp, this class collects the
+/// statistics of a test and reports them.  It holds a \c QueryStats
+/// object for each sending thread.
+class StatsMgr : public boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param threads The number of sending threads.
+    StatsMgr(size_t threads);
+
+    /// \brief Returns the statistics of a thread.
+    QueryStats& getThreadStats(size_t thread);
+
+    /// \brief Returns the sum of the statistics of all threads.
+    QueryStats getTotal() const;
+
+    /// \brief Print the statistics of the test.
+    ///
+    /// \param os The stream to print to.
+    /// \param duration The duration of the test in seconds.
+    /// \param histogram Whether to print the latency histogram too.
+    void print(std::ostream& os, double duration, bool histogram) const;
+
+private:
+    std::vector<boost::shared_ptr<QueryStats> > thread_stats_;
+};
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_STATS_MGR_H
@@ -0,0 +1,611 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "test_control.h"
+
+#include <perfdhcp/rate_control.h>
+
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+using bundy::perfdhcp::RateControl;
+using bundy::util::OutputBuffer;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace perfdns {
+
+volatile sig_atomic_t TestControl::interrupted_ = 0;
+
+namespace {
+// The size of the DNS header, and the offsets of the flags in it.
+const size_t HEADER_LENGTH = 12;
+const size_t FLAGS_OFFSET = 2;
+const uint8_t FLAG_QR = 0x80;
+const uint8_t FLAG_TC = 0x02;
+const uint8_t RCODE_MASK = 0x0f;
+
+// The number of UDP responses received with one recvmmsg() call, and the
+// space for each of them.
+const size_t RECV_BATCH_SIZE = 32;
+const size_t RECV_BUFFER_SIZE = 65535;
+
+// The socket buffer size we try to set for UDP sockets, so bursts of
+// queries and responses are not dropped locally.
+const int UDP_SOCKET_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// The number of query IDs.
+const size_t QID_COUNT = 0x10000;
+
+// The time to wait for a socket to become ready when there is nothing
+// else to do, in milliseconds.
+const int POLL_INTERVAL = 1;
+
+// Current time in microseconds.
+uint64_t
+currentTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+bool
+isTemporaryError(int error) {
+    return (error == EAGAIN || error == EWOULDBLOCK || error == EINTR ||
+            error == ENOBUFS);
+}
+
+// The sender of the queries of a thread.  It keeps the IDs and sending
+// times of the outstanding queries, so the responses can be matched with
+// them and the queries can time out.
+class Sender : public boost::noncopyable {
+public:
+    Sender(const CommandOptions& options, const QueryBuilder& builder,
+           const struct sockaddr* server, socklen_t server_len,
+           QueryStats& stats, size_t first_query, uint64_t query_count,
+           int rate, uint64_t deadline,
+           const volatile sig_atomic_t& interrupted) :
+        options_(options), builder_(builder), server_(server),
+        server_len_(server_len), stats_(stats),
+        next_query_(first_query % builder.getQueryCount()),
+        remaining_(query_count), rate_control_(rate,
+                                               options.getAggressivity()),
+        deadline_(deadline), timeout_(options.getTimeout() * 1000ULL),
+        interrupted_(interrupted), sent_time_(QID_COUNT),
+        active_(QID_COUNT, false), outstanding_(0), next_qid_(0),
+        sending_done_(false), drain_deadline_(0), fd_(-1)
+    {}
+
+    ~Sender() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    void run() {
+        if (options_.getTransport() == CommandOptions::TRANSPORT_TCP) {
+            runTCP();
+        } else {
+            runUDP();
+        }
+        // Queries still outstanding weren't responded within the timeout,
+        // unless the test was interrupted.
+        if (!interrupted_) {
+            stats_.lost += outstanding_;
+        }
+    }
+
+private:
+    // Check whether the test is over, and whether queries can still be
+    // sent.
+    bool isDone(uint64_t now) {
+        if (!sending_done_ &&
+            (remaining_ == 0 || (deadline_ != 0 && now >= deadline_) ||
+             interrupted_)) {
+            sending_done_ = true;
+            drain_deadline_ = now + timeout_;
+        }
+        return (sending_done_ &&
+                (outstanding_ == 0 || now >= drain_deadline_ || interrupted_));
+    }
+
+    // The number of queries to send now.
+    size_t getDueCount() {
+        if (sending_done_) {
+            return (0);
+        }
+        uint64_t count = rate_control_.getOutboundMessageCount();
+        count = min<uint64_t>(count, options_.getMaxOutstanding() -
+                              outstanding_);
+        return (min<uint64_t>(count, remaining_));
+    }
+
+    // Get a free query ID.  As the outstanding queries are limited below
+    // the number of IDs, there is always one.
+    uint16_t getQid() {
+        while (active_[next_qid_]) {
+            ++next_qid_;
+        }
+        return (next_qid_++);
+    }
+
+    // Build a query to the buffer; offset 0 is the next query to send.
+    void buildQuery(size_t offset, uint16_t qid, OutputBuffer& buffer) {
+        builder_.build((next_query_ + offset) % builder_.getQueryCount(), qid,
+                       buffer);
+    }
+
+    // Record that the query with the ID has been sent.
+    void querySent(uint16_t qid, size_t length, uint64_t now) {
+        if (++next_query_ == builder_.getQueryCount()) {
+            next_query_ = 0;
+        }
+        --remaining_;
+        active_[qid] = true;
+        sent_time_[qid] = now;
+        timeouts_.push_back(make_pair(qid, now));
+        ++outstanding_;
+        ++stats_.sent;
+        stats_.bytes_sent += length;
+    }
+
+    // Skip the next query, as it failed to be sent.
+    void queryFailed() {
+        if (++next_query_ == builder_.getQueryCount()) {
+            next_query_ = 0;
+        }
+        --remaining_;
+        ++stats_.send_errors;
+    }
+
+    void handleResponse(const uint8_t* data, size_t length, uint64_t now) {
+        stats_.bytes_received += length;
+        if (length < HEADER_LENGTH || (data[FLAGS_OFFSET] & FLAG_QR) == 0) {
+            ++stats_.unexpected;
+            return;
+        }
+        const uint16_t qid = (data[0] << 8) | data[1];
+        if (!active_[qid]) {
+            ++stats_.unexpected;
+            return;
+        }
+        active_[qid] = false;
+        --outstanding_;
+        ++stats_.received;
+        ++stats_.rcodes[data[FLAGS_OFFSET + 1] & RCODE_MASK];
+        if ((data[FLAGS_OFFSET] & FLAG_TC) != 0) {
+            ++stats_.truncated;
+        }
+        stats_.latency.add(now - sent_time_[qid]);
+    }
+
+    // Count the queries that timed out as lost.  The entries of queries
+    // that have been responded (and maybe reused) are just removed.
+    void expire(uint64_t now) {
+        while (!timeouts_.empty()) {
+            const uint16_t qid = timeouts_.front().first;
+            const uint64_t sent = timeouts_.front().second;
+            if (active_[qid] && sent_time_[qid] == sent) {
+                if (now - sent < timeout_) {
+                    break;
+                }
+                active_[qid] = false;
+                --outstanding_;
+                ++stats_.lost;
+            }
+            timeouts_.pop_front();
+        }
+    }
+
+    void openSocket(int type) {
+        fd_ = socket(server_->sa_family, type, 0);
+        if (fd_ < 0) {
+            bundy_throw(bundy::Unexpected, "failed to open socket: " <<
+                        strerror(errno));
+        }
+        if (type == SOCK_DGRAM) {
+            setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &UDP_SOCKET_BUFFER_SIZE,
+                       sizeof(UDP_SOCKET_BUFFER_SIZE));
+            setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &UDP_SOCKET_BUFFER_SIZE,
+                       sizeof(UDP_SOCKET_BUFFER_SIZE));
+        }
+        if (connect(fd_, server_, server_len_) < 0) {
+            const int error = errno;
+            close(fd_);
+            fd_ = -1;
+            bundy_throw(bundy::Unexpected, "failed to connect to " <<
+                        options_.getServer() << ": " << strerror(error));
+        }
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    }
+
+    void wait(short events) {
+        struct pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = events;
+        pfd.revents = 0;
+        poll(&pfd, 1, POLL_INTERVAL);
+    }
+
+    void runUDP();
+    size_t sendUDP(size_t count, uint64_t now);
+    size_t receiveUDP();
+
+    void runTCP();
+
+    const CommandOptions& options_;
+    const QueryBuilder& builder_;
+    const struct sockaddr* const server_;
+    const socklen_t server_len_;
+    QueryStats& stats_;
+    size_t next_query_;
+    uint64_t remaining_;
+    RateControl rate_control_;
+    const uint64_t deadline_;
+    const uint64_t timeout_;
+    const volatile sig_atomic_t& interrupted_;
+    vector<uint64_t> sent_time_;
+    vector<bool> active_;
+    deque<pair<uint16_t, uint64_t> > timeouts_;
+    size_t outstanding_;
+    uint16_t next_qid_;
+    bool sending_done_;
+    uint64_t drain_deadline_;
+    int fd_;
+
+    // Buffers of the UDP queries and responses.
+    vector<boost::shared_ptr<OutputBuffer> > send_buffers_;
+    vector<uint16_t> send_qids_;
+    vector<uint8_t> recv_data_;
+};
+
+void
+Sender::runUDP() {
+    openSocket(SOCK_DGRAM);
+    for (int i = 0; i < options_.getAggressivity(); ++i) {
+        send_buffers_.push_back(boost::shared_ptr<OutputBuffer>(
+                                    new OutputBuffer(512)));
+    }
+    send_qids_.resize(options_.getAggressivity());
+    recv_data_.resize(RECV_BATCH_SIZE * RECV_BUFFER_SIZE);
+
+    while (true) {
+        const uint64_t now = currentTime();
+        if (isDone(now)) {
+            break;
+        }
+        const size_t received = receiveUDP();
+        expire(now);
+        const size_t due = getDueCount();
+        if (due > 0) {
+            sendUDP(due, currentTime());
+            rate_control_.updateSendTime();
+        }
+        if (received == 0 && due == 0) {
+            wait(POLLIN);
+        }
+    }
+}
+
+size_t
+Sender::sendUDP(size_t count, uint64_t now) {
+    for (size_t i = 0; i < count; ++i) {
+        send_buffers_[i]->clear();
+        send_qids_[i] = getQid();
+        // Reserve the ID for now, so the next one is different.
+        active_[send_qids_[i]] = true;
+        buildQuery(i, send_qids_[i], *send_buffers_[i]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        active_[send_qids_[i]] = false;
+    }
+
+    size_t sent = 0;
+#ifdef HAVE_SENDMMSG
+    vector<struct iovec> iovs(count);
+    vector<struct mmsghdr> msgs(count);
+    for (size_t i = 0; i < count; ++i) {
+        iovs[i].iov_base = const_cast<void*>(send_buffers_[i]->getData());
+        iovs[i].iov_len = send_buffers_[i]->getLength();
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < count) {
+        const int ret = sendmmsg(fd_, &msgs[sent], count - sent, 0);
+        if (ret < 0) {
+            if (isTemporaryError(errno)) {
+                break;
+            }
+            queryFailed();
+            ++sent;
+            continue;
+        }
+        for (int i = 0; i < ret; ++i, ++sent) {
+            querySent(send_qids_[sent], iovs[sent].iov_len, now);
+        }
+    }
+#else
+    for (; sent < count; ++sent) {
+        const OutputBuffer& buffer = *send_buffers_[sent];
+        if (send(fd_, buffer.getData(), buffer.getLength(), 0) < 0) {
+            if (isTemporaryError(errno)) {
+                break;
+            }
+            queryFailed();
+            continue;
+        }
+        querySent(send_qids_[sent], buffer.getLength(), now);
+    }
+#endif
+    return (sent);
+}
+
+size_t
+Sender::receiveUDP() {
+    size_t received = 0;
+#ifdef HAVE_RECVMMSG
+    struct iovec iovs[RECV_BATCH_SIZE];
+    struct mmsghdr msgs[RECV_BATCH_SIZE];
+    while (true) {
+        for (size_t i = 0; i < RECV_BATCH_SIZE; ++i) {
+            iovs[i].iov_base = &recv_data_[i * RECV_BUFFER_SIZE];
+            iovs[i].iov_len = RECV_BUFFER_SIZE;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int ret = recvmmsg(fd_, msgs, RECV_BATCH_SIZE, MSG_DONTWAIT,
+                                 NULL);
+        if (ret <= 0) {
+            break;
+        }
+        const uint64_t now = currentTime();
+        for (int i = 0; i < ret; ++i) {
+            handleResponse(&recv_data_[i * RECV_BUFFER_SIZE], msgs[i].msg_len,
+                           now);
+        }
+        received += ret;
+        if (ret < static_cast<int>(RECV_BATCH_SIZE)) {
+            break;
+        }
+    }
+#else
+    while (true) {
+        const ssize_t ret = recv(fd_, &recv_data_[0], RECV_BUFFER_SIZE,
+                                 MSG_DONTWAIT);
+        if (ret < 0) {
+            break;
+        }
+        handleResponse(&recv_data_[0], ret, currentTime());
+        ++received;
+    }
+#endif
+    return (received);
+}
+
+void
+Sender::runTCP() {
+    openSocket(SOCK_STREAM);
+    ++stats_.connections;
+    OutputBuffer out(4096);
+    size_t out_pos = 0;
+    vector<uint8_t> in(RECV_BUFFER_SIZE + 2);
+    size_t in_len = 0;
+
+    while (true) {
+        uint64_t now = currentTime();
+        if (isDone(now)) {
+            break;
+        }
+        bool progress = false;
+
+        // Queue the queries due.  They are considered sent, as their time
+        // in the queue is part of the latency.
+        const size_t due = getDueCount();
+        for (size_t i = 0; i < due; ++i) {
+            const size_t start = out.getLength();
+            const uint16_t qid = getQid();
+            out.writeUint16(0);
+            buildQuery(0, qid, out);
+            const size_t length = out.getLength() - start - 2;
+            out.writeUint16At(length, start);
+            querySent(qid, length, now);
+        }
+        if (due > 0) {
+            rate_control_.updateSendTime();
+            progress = true;
+        }
+
+        // Write what we can.
+        bool closed = false;
+        if (out_pos < out.getLength()) {
+            const ssize_t ret =
+                send(fd_, static_cast<const uint8_t*>(out.getData()) + out_pos,
+                     out.getLength() - out_pos, MSG_NOSIGNAL);
+            if (ret > 0) {
+                out_pos += ret;
+                progress = true;
+            } else if (ret < 0 && !isTemporaryError(errno)) {
+                closed = true;
+            }
+            if (out_pos == out.getLength()) {
+                out.clear();
+                out_pos = 0;
+            }
+        }
+
+        // Read the responses.
+        while (!closed) {
+            const ssize_t ret = recv(fd_, &in[in_len], in.size() - in_len,
+                                     MSG_DONTWAIT);
+            if (ret == 0 || (ret < 0 && !isTemporaryError(errno))) {
+                closed = true;
+                break;
+            } else if (ret < 0) {
+                break;
+            }
+            progress = true;
+            in_len += ret;
+            now = currentTime();
+            size_t pos = 0;
+            while (in_len - pos >= 2) {
+                const size_t length = (in[pos] << 8) | in[pos + 1];
+                if (in_len - pos < length + 2) {
+                    break;
+                }
+                handleResponse(&in[pos + 2], length, now);
+                pos += length + 2;
+            }
+            memmove(&in[0], &in[pos], in_len - pos);
+            in_len -= pos;
+        }
+
+        // Connect again if the server closed the connection.  The queries
+        // still outstanding on it will time out.
+        if (closed) {
+            close(fd_);
+            fd_ = -1;
+            out.clear();
+            out_pos = 0;
+            in_len = 0;
+            openSocket(SOCK_STREAM);
+            ++stats_.connections;
+            continue;
+        }
+
+        expire(currentTime());
+        if (!progress) {
+            wait(out_pos < out.getLength() ? POLLIN | POLLOUT : POLLIN);
+        }
+    }
+}
+}
+
+TestControl::TestControl(const CommandOptions& options,
+                         const QueryBuilder& builder) :
+    options_(options), builder_(builder), server_len_(0)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype =
+        options.getTransport() == CommandOptions::TRANSPORT_TCP ?
+        SOCK_STREAM : SOCK_DGRAM;
+    struct addrinfo* res;
+    const string port = boost::lexical_cast<string>(options.getPort());
+    const int error = getaddrinfo(options.getServer().c_str(), port.c_str(),
+                                  &hints, &res);
+    if (error != 0) {
+        bundy_throw(bundy::BadValue, "failed to resolve " <<
+                    options.getServer() << ": " << gai_strerror(error));
+    }
+    memcpy(&server_, res->ai_addr, res->ai_addrlen);
+    server_len_ = res->ai_addrlen;
+    freeaddrinfo(res);
+}
+
+void
+TestControl::handleInterrupt(int) {
+    interrupted_ = 1;
+}
+
+void
+TestControl::runThread(size_t thread, QueryStats& stats, uint64_t deadline) {
+    const size_t threads = options_.getThreads();
+    const size_t query_count = builder_.getQueryCount();
+
+    // Each thread starts at a different place in the queries, so they
+    // don't all send the same query at the same time.
+    uint64_t count = numeric_limits<uint64_t>::max();
+    if (options_.getRuns() > 0) {
+        const uint64_t total =
+            static_cast<uint64_t>(options_.getRuns()) * query_count;
+        count = total / threads + (thread < total % threads ? 1 : 0);
+    }
+    const int rate = options_.getRate() / threads +
+        (thread < options_.getRate() % threads ? 1 : 0);
+    Sender sender(options_, builder_,
+                  reinterpret_cast<const struct sockaddr*>(&server_),
+                  server_len_, stats, thread * query_count / threads, count,
+                  rate, deadline, interrupted_);
+    sender.run();
+}
+
+double
+TestControl::runTest(StatsMgr& stats) {
+    if (builder_.getQueryCount() == 0) {
+        bundy_throw(bundy::BadValue, "no queries to send");
+    }
+    interrupted_ = 0;
+    const uint64_t start = currentTime();
+    const uint64_t deadline = options_.getTimeLimit() > 0 ?
+        start + options_.getTimeLimit() * 1000000ULL : 0;
+
+    vector<boost::shared_ptr<Thread> > threads;
+    for (int i = 0; i < options_.getThreads(); ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(&TestControl::runThread, this, i,
+                                   boost::ref(stats.getThreadStats(i)),
+                                   deadline))));
+    }
+    string error;
+    for (size_t i = 0; i < threads.size(); ++i) {
+        try {
+            threads[i]->wait();
+        } catch (const Thread::UncaughtException& ex) {
+            if (error.empty()) {
+                error = ex.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        bundy_throw(bundy::Unexpected, error);
+    }
+    return ((currentTime() - start) / 1000000.0);
+}
+
+int
+TestControl::run() {
+    signal(SIGINT, TestControl::handleInterrupt);
+    StatsMgr stats(options_.getThreads());
+    const double duration = runTest(stats);
+    stats.print(cout, duration, options_.isHistogram());
+    return (0);
+}
+
+} // namespace perfdns
+} // namespace bundy
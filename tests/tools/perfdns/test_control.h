@@ -0,0 +1,93 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_TEST_CONTROL_H
+#define PERFDNS_TEST_CONTROL_H
+
+#include "command_options.h"
+#include "query_builder.h"
+#include "stats_mgr.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <string>
+
+#include <signal.h>
+#include <sys/socket.h>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief Sequencing of the perfdns test.
+///
+/// This class runs the test: it starts a sending thread for each thread
+/// requested on the command line, each of them sending its share of the
+/// queries at its share of the rate, and collects their statistics.
+///
+/// With UDP, each thread has its own socket, and sends the queries due
+/// in batches with \c sendmmsg() and receives the responses with
+/// \c recvmmsg() where they are available.  With TCP, each thread has a
+/// connection to the server over which it pipelines its queries, up to
+/// the maximum number of outstanding queries; the connection is made
+/// again if the server closes it.
+///
+/// Each thread matches the responses to its queries by the query ID, so
+/// the outstanding queries of a thread are limited to 65535.  Responses
+/// are not verified otherwise; in particular TSIG signatures of responses
+/// are not checked.  Queries that are not responded within the timeout
+/// are counted as lost.
+class TestControl : public boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param options The command line options.
+    /// \param builder The builder of the queries to send.
+    /// \throw bundy::BadValue if the server address can't be resolved.
+    TestControl(const CommandOptions& options, const QueryBuilder& builder);
+
+    /// \brief Run the test and print the statistics.
+    ///
+    /// \return The exit code of the program.
+    /// \throw bundy::Unexpected if a sending thread fails.
+    int run();
+
+    /// \brief Run the test.
+    ///
+    /// \param stats The statistics manager to collect the statistics in.
+    ///     It must have been created for the number of threads in the
+    ///     options.
+    /// \return The duration of the test in seconds.
+    /// \throw bundy::Unexpected if a sending thread fails.
+    double runTest(StatsMgr& stats);
+
+    /// \brief Handle the interrupt signal.
+    ///
+    /// The threads stop sending queries and the test ends.
+    static void handleInterrupt(int);
+
+private:
+    /// \brief The main function of a sending thread.
+    void runThread(size_t thread, QueryStats& stats, uint64_t deadline);
+
+    const CommandOptions& options_;
+    const QueryBuilder& builder_;
+    struct sockaddr_storage server_;
+    socklen_t server_len_;
+    static volatile sig_atomic_t interrupted_;
+};
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_TEST_CONTROL_H
@@ -0,0 +1,59 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PERFDNS_COMMAND_OPTIONS_HELPER_H
+#define PERFDNS_COMMAND_OPTIONS_HELPER_H
+
+#include "../command_options.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace perfdns {
+
+/// \brief Parse a command line given as a single string.
+///
+/// The string is split at white spaces into the arguments passed to
+/// \ref CommandOptions::parse.
+///
+/// \param options The options to parse the command line into.
+/// \param cmdline The command line, including the program name.
+/// \return The result of \c CommandOptions::parse().
+inline bool
+parseCommandLine(CommandOptions& options, const std::string& cmdline) {
+    std::istringstream iss(cmdline);
+    std::vector<std::string> args;
+    std::string arg;
+    while (iss >> arg) {
+        args.push_back(arg);
+    }
+    std::vector<std::vector<char> > buffers;
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); ++i) {
+        buffers.push_back(std::vector<char>(args[i].begin(), args[i].end()));
+        buffers.back().push_back('\0');
+    }
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        argv.push_back(&buffers[i][0]);
+    }
+    argv.push_back(NULL);
+    return (options.parse(args.size(), &argv[0]));
+}
+
+} // namespace perfdns
+} // namespace bundy
+
+#endif // PERFDNS_COMMAND_OPTIONS_HELPER_H
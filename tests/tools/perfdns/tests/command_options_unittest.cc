@@ -0,0 +1,140 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "command_options_helper.h"
+
+#include <exceptions/exceptions.h>
+
+#include <dns/name.h>
+#include <dns/tsigkey.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::perfdns;
+
+namespace {
+
+TEST(CommandOptionsTest, defaults) {
+    CommandOptions opt;
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -d queries.txt"));
+    EXPECT_EQ("127.0.0.1", opt.getServer());
+    EXPECT_EQ(53, opt.getPort());
+    EXPECT_EQ("queries.txt", opt.getInputFile());
+    EXPECT_EQ(CommandOptions::FORMAT_TEXT, opt.getInputFormat());
+    EXPECT_EQ(CommandOptions::TRANSPORT_UDP, opt.getTransport());
+    EXPECT_EQ(1, opt.getThreads());
+    EXPECT_EQ(0, opt.getRate());
+    EXPECT_EQ(16, opt.getAggressivity());
+    EXPECT_EQ(100, opt.getMaxOutstanding());
+    // Without a time limit, the queries are sent once.
+    EXPECT_EQ(1, opt.getRuns());
+    EXPECT_EQ(0, opt.getTimeLimit());
+    EXPECT_EQ(2000, opt.getTimeout());
+    EXPECT_FALSE(opt.isEDNS());
+    EXPECT_FALSE(opt.isDNSSECOK());
+    EXPECT_FALSE(opt.isRecursionDesired());
+    EXPECT_EQ(static_cast<const dns::TSIGKey*>(NULL), opt.getTSIGKey());
+    EXPECT_FALSE(opt.isHistogram());
+}
+
+TEST(CommandOptionsTest, options) {
+    CommandOptions opt;
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -s ::1 -p 5300 -d q.pcap "
+                                  "-f pcap -m tcp -T 4 -Q 10000 -a 8 "
+                                  "-q 500 -l 30 -t 500 -b 1232 -D -R "
+                                  "-y key.example:c2VjcmV0 -H"));
+    EXPECT_EQ("::1", opt.getServer());
+    EXPECT_EQ(5300, opt.getPort());
+    EXPECT_EQ("q.pcap", opt.getInputFile());
+    EXPECT_EQ(CommandOptions::FORMAT_PCAP, opt.getInputFormat());
+    EXPECT_EQ(CommandOptions::TRANSPORT_TCP, opt.getTransport());
+    EXPECT_EQ(4, opt.getThreads());
+    EXPECT_EQ(10000, opt.getRate());
+    EXPECT_EQ(8, opt.getAggressivity());
+    EXPECT_EQ(500, opt.getMaxOutstanding());
+    // With a time limit, the queries are sent over and over.
+    EXPECT_EQ(0, opt.getRuns());
+    EXPECT_EQ(30, opt.getTimeLimit());
+    EXPECT_EQ(500, opt.getTimeout());
+    EXPECT_TRUE(opt.isEDNS());
+    EXPECT_EQ(1232, opt.getUDPSize());
+    EXPECT_TRUE(opt.isDNSSECOK());
+    EXPECT_TRUE(opt.isRecursionDesired());
+    ASSERT_NE(static_cast<const dns::TSIGKey*>(NULL), opt.getTSIGKey());
+    EXPECT_EQ(dns::Name("key.example"), opt.getTSIGKey()->getKeyName());
+    EXPECT_EQ(dns::TSIGKey::HMACMD5_NAME(),
+              opt.getTSIGKey()->getAlgorithmName());
+    EXPECT_TRUE(opt.isHistogram());
+
+    // Both limits.
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -d q -n 3 -l 10"));
+    EXPECT_EQ(3, opt.getRuns());
+    EXPECT_EQ(10, opt.getTimeLimit());
+
+    // The DO bit implies EDNS, as does the buffer size.
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -d q -D"));
+    EXPECT_TRUE(opt.isEDNS());
+    EXPECT_EQ(4096, opt.getUDPSize());
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -d q -e"));
+    EXPECT_TRUE(opt.isEDNS());
+    EXPECT_FALSE(opt.isDNSSECOK());
+
+    // The options are reset on each parse.
+    EXPECT_FALSE(parseCommandLine(opt, "perfdns -d q"));
+    EXPECT_FALSE(opt.isEDNS());
+    EXPECT_EQ(static_cast<const dns::TSIGKey*>(NULL), opt.getTSIGKey());
+}
+
+TEST(CommandOptionsTest, helpAndVersion) {
+    CommandOptions opt;
+    EXPECT_TRUE(parseCommandLine(opt, "perfdns -h"));
+    EXPECT_TRUE(parseCommandLine(opt, "perfdns -v"));
+}
+
+TEST(CommandOptionsTest, invalid) {
+    CommandOptions opt;
+    const char* const cmdlines[] = {
+        "perfdns",                      // no input
+        "perfdns -d q extra",
+        "perfdns -d q -x",
+        "perfdns -d q -p 0",
+        "perfdns -d q -p 65536",
+        "perfdns -d q -p port",
+        "perfdns -d q -f xml",
+        "perfdns -d q -m sctp",
+        "perfdns -d q -T 0",
+        "perfdns -d q -Q -1",
+        "perfdns -d q -a 0",
+        "perfdns -d q -q 0",
+        "perfdns -d q -q 65536",
+        "perfdns -d q -n 0",
+        "perfdns -d q -l 0",
+        "perfdns -d q -t 0",
+        "perfdns -d q -b 511",
+        "perfdns -d q -y key.example",
+        "perfdns -d q -y key.example:c2VjcmV0:hmac-foo",
+        "perfdns -d q -T 4 -Q 3",       // rate per thread would be 0
+        NULL
+    };
+    for (size_t i = 0; cmdlines[i] != NULL; ++i) {
+        SCOPED_TRACE(cmdlines[i]);
+        EXPECT_THROW(parseCommandLine(opt, cmdlines[i]),
+                     bundy::InvalidParameter);
+    }
+}
+
+}
@@ -0,0 +1,131 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "../query_builder.h"
+
+#include <util/buffer.h>
+
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <dns/tsig.h>
+#include <dns/tsigerror.h>
+#include <dns/tsigkey.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace std;
+using namespace bundy::dns;
+using namespace bundy::perfdns;
+using bundy::util::InputBuffer;
+using bundy::util::OutputBuffer;
+
+namespace {
+
+class QueryBuilderTest : public ::testing::Test {
+protected:
+    QueryBuilderTest() :
+        key_("key.example:c2VjcmV0:hmac-sha256"),
+        message_(Message::PARSE)
+    {
+        questions_.push_back(Question(Name("www.example.com"), RRClass::IN(),
+                                      RRType::A()));
+        questions_.push_back(Question(Name("example.org"), RRClass::CH(),
+                                      RRType::TXT()));
+    }
+
+    // Parse the query built to the buffer (from the given position).
+    void parse(const OutputBuffer& buffer, size_t pos = 0) {
+        message_.clear(Message::PARSE);
+        InputBuffer ibuffer(static_cast<const uint8_t*>(buffer.getData()) +
+                            pos, buffer.getLength() - pos);
+        message_.fromWire(ibuffer);
+    }
+
+    vector<Question> questions_;
+    const TSIGKey key_;
+    Message message_;
+};
+
+TEST_F(QueryBuilderTest, build) {
+    const QueryBuilder builder(questions_, false, false, 0, false, NULL);
+    EXPECT_EQ(2, builder.getQueryCount());
+
+    OutputBuffer buffer(0);
+    builder.build(1, 0x1234, buffer);
+    parse(buffer);
+    EXPECT_EQ(0x1234, message_.getQid());
+    EXPECT_EQ(Opcode::QUERY(), message_.getOpcode());
+    EXPECT_FALSE(message_.getHeaderFlag(Message::HEADERFLAG_QR));
+    EXPECT_FALSE(message_.getHeaderFlag(Message::HEADERFLAG_RD));
+    ASSERT_EQ(1, message_.getRRCount(Message::SECTION_QUESTION));
+    EXPECT_EQ(questions_[1], **message_.beginQuestion());
+    EXPECT_FALSE(message_.getEDNS());
+    EXPECT_EQ(0, message_.getRRCount(Message::SECTION_ADDITIONAL));
+
+    // Queries are appended to the buffer.
+    const size_t length = buffer.getLength();
+    builder.build(0, 0xffff, buffer);
+    parse(buffer, length);
+    EXPECT_EQ(0xffff, message_.getQid());
+    EXPECT_EQ(questions_[0], **message_.beginQuestion());
+}
+
+TEST_F(QueryBuilderTest, buildWithOptions) {
+    const QueryBuilder builder(questions_, true, true, 1232, true, NULL);
+    OutputBuffer buffer(0);
+    builder.build(0, 1, buffer);
+    parse(buffer);
+    EXPECT_TRUE(message_.getHeaderFlag(Message::HEADERFLAG_RD));
+    ASSERT_TRUE(message_.getEDNS());
+    EXPECT_EQ(1232, message_.getEDNS()->getUDPSize());
+    EXPECT_TRUE(message_.getEDNS()->getDNSSECAwareness());
+
+    const QueryBuilder builder2(questions_, false, true, 4096, false, NULL);
+    buffer.clear();
+    builder2.build(0, 1, buffer);
+    parse(buffer);
+    ASSERT_TRUE(message_.getEDNS());
+    EXPECT_EQ(4096, message_.getEDNS()->getUDPSize());
+    EXPECT_FALSE(message_.getEDNS()->getDNSSECAwareness());
+}
+
+TEST_F(QueryBuilderTest, buildWithTSIG) {
+    const QueryBuilder builder(questions_, false, true, 4096, false, &key_);
+    OutputBuffer buffer(0);
+    // Each query is signed for its ID.
+    for (uint16_t qid = 1; qid <= 2; ++qid) {
+        buffer.clear();
+        builder.build(0, qid, buffer);
+        parse(buffer);
+        EXPECT_EQ(qid, message_.getQid());
+        EXPECT_TRUE(message_.getEDNS());
+        ASSERT_TRUE(message_.getTSIGRecord() != NULL);
+        EXPECT_EQ(key_.getKeyName(), message_.getTSIGRecord()->getName());
+
+        TSIGContext ctx(key_);
+        EXPECT_EQ(TSIGError::NOERROR(),
+                  ctx.verify(message_.getTSIGRecord(), buffer.getData(),
+                             buffer.getLength()));
+    }
+}
+
+}
@@ -0,0 +1,307 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "../query_list.h"
+
+#include <exceptions/exceptions.h>
+
+#include <util/buffer.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bundy;
+using namespace bundy::dns;
+using namespace bundy::perfdns;
+using bundy::util::OutputBuffer;
+
+namespace {
+
+TEST(QueryListTest, loadTextFile) {
+    QueryList list;
+    list.load(TEST_DATA_DIR "/queries.txt", false);
+    const vector<Question>& questions = list.getQuestions();
+    ASSERT_EQ(4, questions.size());
+    EXPECT_EQ(Question(Name("www.example.com"), RRClass::IN(), RRType::A()),
+              questions[0]);
+    EXPECT_EQ(Question(Name("www.example.com"), RRClass::IN(),
+                       RRType::AAAA()), questions[1]);
+    EXPECT_EQ(Question(Name("example.com"), RRClass::IN(), RRType::MX()),
+              questions[2]);
+    EXPECT_EQ(Question(Name("nxdomain.example.com"), RRClass::IN(),
+                       RRType::TXT()), questions[3]);
+    EXPECT_EQ(0, list.getSkipped());
+
+    // Loading more appends to the list.
+    list.load(TEST_DATA_DIR "/queries.txt", false);
+    EXPECT_EQ(8, list.getQuestions().size());
+
+    EXPECT_THROW(list.load(TEST_DATA_DIR "/nonexistent", false),
+                 bundy::BadValue);
+}
+
+TEST(QueryListTest, loadTextErrors) {
+    const char* const inputs[] = {
+        "www.example.com\n",                    // no type
+        "www.example.com A extra\n",
+        "www.example.com NOSUCHTYPE\n",
+        "www..example.com A\n",
+        NULL
+    };
+    for (size_t i = 0; inputs[i] != NULL; ++i) {
+        SCOPED_TRACE(inputs[i]);
+        QueryList list;
+        istringstream iss(inputs[i]);
+        EXPECT_THROW(list.loadText(iss, "test"), bundy::BadValue);
+    }
+}
+
+// Build a pcap capture of packets.
+class PcapBuilder {
+public:
+    PcapBuilder(uint32_t linktype, bool big_endian = false) :
+        big_endian_(big_endian)
+    {
+        writeUint32(0xa1b2c3d4);
+        writeUint16(2);
+        writeUint16(4);
+        writeUint32(0);
+        writeUint32(0);
+        writeUint32(65535);
+        writeUint32(linktype);
+    }
+    void addPacket(const vector<uint8_t>& packet) {
+        writeUint32(0);
+        writeUint32(0);
+        writeUint32(packet.size());
+        writeUint32(packet.size());
+        data_.insert(data_.end(), packet.begin(), packet.end());
+    }
+    string getData() const {
+        return (string(data_.begin(), data_.end()));
+    }
+private:
+    void writeUint16(uint16_t value) {
+        if (big_endian_) {
+            data_.push_back(value >> 8);
+            data_.push_back(value & 0xff);
+        } else {
+            data_.push_back(value & 0xff);
+            data_.push_back(value >> 8);
+        }
+    }
+    void writeUint32(uint32_t value) {
+        if (big_endian_) {
+            writeUint16(value >> 16);
+            writeUint16(value & 0xffff);
+        } else {
+            writeUint16(value & 0xffff);
+            writeUint16(value >> 16);
+        }
+    }
+    const bool big_endian_;
+    vector<uint8_t> data_;
+};
+
+// A DNS message with a question.
+vector<uint8_t>
+makeDNS(const Question& question, bool response = false) {
+    OutputBuffer buffer(0);
+    buffer.writeUint16(0x1234);         // ID
+    buffer.writeUint16(response ? 0x8100 : 0x0100);
+    buffer.writeUint16(1);              // QDCOUNT
+    buffer.writeUint16(0);
+    buffer.writeUint16(0);
+    buffer.writeUint16(0);
+    question.toWire(buffer);
+    const uint8_t* data = static_cast<const uint8_t*>(buffer.getData());
+    return (vector<uint8_t>(data, data + buffer.getLength()));
+}
+
+// A UDP datagram of the payload.
+vector<uint8_t>
+makeUDP(const vector<uint8_t>& payload, uint16_t dst_port = 53) {
+    vector<uint8_t> packet;
+    packet.push_back(0xc3);             // source port 50000
+    packet.push_back(0x50);
+    packet.push_back(dst_port >> 8);
+    packet.push_back(dst_port & 0xff);
+    packet.push_back((payload.size() + 8) >> 8);
+    packet.push_back((payload.size() + 8) & 0xff);
+    packet.push_back(0);                // checksum
+    packet.push_back(0);
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return (packet);
+}
+
+// An IPv4 packet of the payload.
+vector<uint8_t>
+makeIPv4(const vector<uint8_t>& payload, uint8_t protocol = 17,
+         uint16_t fragment = 0)
+{
+    const uint8_t header[] = {
+        0x45, 0, 0, 0, 0, 0, 0, 0, 64, 0, 0, 0,
+        192, 0, 2, 1, 192, 0, 2, 53
+    };
+    vector<uint8_t> packet(header, header + sizeof(header));
+    packet[2] = (payload.size() + 20) >> 8;
+    packet[3] = (payload.size() + 20) & 0xff;
+    packet[6] = fragment >> 8;
+    packet[7] = fragment & 0xff;
+    packet[9] = protocol;
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return (packet);
+}
+
+// An IPv6 packet of the payload.
+vector<uint8_t>
+makeIPv6(const vector<uint8_t>& payload) {
+    vector<uint8_t> packet(40);
+    packet[0] = 0x60;
+    packet[4] = payload.size() >> 8;
+    packet[5] = payload.size() & 0xff;
+    packet[6] = 17;
+    packet[7] = 64;
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return (packet);
+}
+
+// An Ethernet frame of the payload, optionally with a VLAN tag.
+vector<uint8_t>
+makeEthernet(const vector<uint8_t>& payload, uint16_t ethertype,
+             bool vlan = false)
+{
+    vector<uint8_t> packet(12);
+    if (vlan) {
+        packet.push_back(0x81);
+        packet.push_back(0x00);
+        packet.push_back(0x00);
+        packet.push_back(0x0a);
+    }
+    packet.push_back(ethertype >> 8);
+    packet.push_back(ethertype & 0xff);
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    // Padding of short frames mustn't be taken as part of the query.
+    packet.resize(max<size_t>(packet.size(), 60));
+    return (packet);
+}
+
+TEST(QueryListTest, loadPcap) {
+    const Question q1(Name("www.example.com"), RRClass::IN(), RRType::A());
+    const Question q2(Name("example.org"), RRClass::CH(), RRType::TXT());
+    const Question q3(Name("a.example"), RRClass::IN(), RRType::AAAA());
+    const Question q4(Name("b.example"), RRClass::IN(), RRType::NS());
+
+    PcapBuilder builder(1);     // Ethernet
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q1))), 0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q2))), 0x0800,
+                                   true));
+    builder.addPacket(makeEthernet(makeIPv6(makeUDP(makeDNS(q3))), 0x86dd));
+    // Responses, other ports, other protocols, fragments and non-IP
+    // packets are skipped.
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4, true))),
+                                   0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4), 5353)),
+                                   0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4)), 6),
+                                   0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4)), 17,
+                                            0x2000), 0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4))), 0x0806));
+    builder.addPacket(vector<uint8_t>(10));
+    // A broken query.
+    vector<uint8_t> broken = makeDNS(q4);
+    broken.resize(broken.size() - 1);
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(broken)), 0x0800));
+    builder.addPacket(makeEthernet(makeIPv4(makeUDP(makeDNS(q4))), 0x0800));
+
+    QueryList list;
+    istringstream iss(builder.getData());
+    list.loadPcap(iss, "test");
+    const vector<Question>& questions = list.getQuestions();
+    ASSERT_EQ(4, questions.size());
+    EXPECT_EQ(q1, questions[0]);
+    EXPECT_EQ(q2, questions[1]);
+    EXPECT_EQ(q3, questions[2]);
+    EXPECT_EQ(q4, questions[3]);
+    EXPECT_EQ(7, list.getSkipped());
+}
+
+TEST(QueryListTest, loadPcapLinkTypes) {
+    const Question q(Name("www.example.com"), RRClass::IN(), RRType::A());
+    const vector<uint8_t> ip = makeIPv4(makeUDP(makeDNS(q)));
+
+    // Raw IP, in a big endian file.
+    PcapBuilder raw(101, true);
+    raw.addPacket(ip);
+    // Loopback.
+    PcapBuilder loop(0);
+    vector<uint8_t> packet(4);
+    packet.insert(packet.end(), ip.begin(), ip.end());
+    loop.addPacket(packet);
+    // Linux cooked capture.
+    PcapBuilder sll(113);
+    packet.assign(14, 0);
+    packet.push_back(0x08);
+    packet.push_back(0x00);
+    packet.insert(packet.end(), ip.begin(), ip.end());
+    sll.addPacket(packet);
+
+    const PcapBuilder* const builders[] = { &raw, &loop, &sll };
+    for (size_t i = 0; i < sizeof(builders) / sizeof(builders[0]); ++i) {
+        SCOPED_TRACE(i);
+        QueryList list;
+        istringstream iss(builders[i]->getData());
+        list.loadPcap(iss, "test");
+        ASSERT_EQ(1, list.getQuestions().size());
+        EXPECT_EQ(q, list.getQuestions()[0]);
+    }
+
+    // Unknown link types are skipped.
+    PcapBuilder unknown(147);
+    unknown.addPacket(ip);
+    QueryList list;
+    istringstream iss(unknown.getData());
+    list.loadPcap(iss, "test");
+    EXPECT_TRUE(list.getQuestions().empty());
+    EXPECT_EQ(1, list.getSkipped());
+}
+
+TEST(QueryListTest, loadPcapErrors) {
+    QueryList list;
+    istringstream text("www.example.com A\n");
+    EXPECT_THROW(list.loadPcap(text, "test"), bundy::BadValue);
+
+    const Question q(Name("www.example.com"), RRClass::IN(), RRType::A());
+    PcapBuilder builder(101);
+    builder.addPacket(makeIPv4(makeUDP(makeDNS(q))));
+    const string data = builder.getData();
+    // Truncated in the packet data, and in the record header.
+    istringstream truncated_data(data.substr(0, data.size() - 1));
+    EXPECT_THROW(list.loadPcap(truncated_data, "test"), bundy::BadValue);
+    istringstream truncated_header(data.substr(0, 24 + 8));
+    EXPECT_THROW(list.loadPcap(truncated_header, "test"), bundy::BadValue);
+}
+
+}
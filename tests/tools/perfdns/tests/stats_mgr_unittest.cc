@@ -0,0 +1,208 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "../stats_mgr.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace bundy::perfdns;
+
+namespace {
+
+TEST(LatencyHistogramTest, buckets) {
+    // Low latencies have a bucket each.
+    for (uint64_t usec = 0; usec < 64; ++usec) {
+        EXPECT_EQ(usec, LatencyHistogram::getBucket(usec));
+        EXPECT_EQ(usec, LatencyHistogram::getBucketLow(usec));
+        EXPECT_EQ(usec, LatencyHistogram::getBucketHigh(usec));
+    }
+    // The last linear bucket and the first logarithmic one, which is two
+    // microseconds wide.
+    EXPECT_EQ(63, LatencyHistogram::getBucket(63));
+    EXPECT_EQ(63, LatencyHistogram::getBucketLow(63));
+    EXPECT_EQ(63, LatencyHistogram::getBucketHigh(63));
+    EXPECT_EQ(64, LatencyHistogram::getBucket(64));
+    EXPECT_EQ(64, LatencyHistogram::getBucketLow(64));
+    EXPECT_EQ(65, LatencyHistogram::getBucketHigh(64));
+    EXPECT_EQ(64, LatencyHistogram::getBucket(65));
+    EXPECT_EQ(65, LatencyHistogram::getBucket(66));
+    EXPECT_EQ(96, LatencyHistogram::getBucket(128));
+
+    // Buckets are contiguous, each value is in its bucket, and the width
+    // of the buckets is less than about 3% of their values.
+    uint64_t next_low = 0;
+    for (size_t bucket = 0;
+         LatencyHistogram::getBucketLow(bucket) < 0xffffffffULL;
+         ++bucket) {
+        const uint64_t low = LatencyHistogram::getBucketLow(bucket);
+        const uint64_t high = LatencyHistogram::getBucketHigh(bucket);
+        EXPECT_EQ(next_low, low);
+        ASSERT_LE(low, high);
+        EXPECT_EQ(bucket, LatencyHistogram::getBucket(low));
+        EXPECT_EQ(bucket, LatencyHistogram::getBucket(high));
+        EXPECT_LE(high - low, low / 32);
+        next_low = high + 1;
+    }
+
+    // The last bucket ends at 2^32-1, and huge latencies are in it too.
+    const size_t last = LatencyHistogram::getBucket(0xffffffffULL);
+    EXPECT_EQ(0xfc000000ULL, LatencyHistogram::getBucketLow(last));
+    EXPECT_EQ(0xffffffffULL, LatencyHistogram::getBucketHigh(last));
+    EXPECT_EQ(last, LatencyHistogram::getBucket(0xfc000000ULL));
+    EXPECT_EQ(last - 1, LatencyHistogram::getBucket(0xfbffffffULL));
+    EXPECT_EQ(last, LatencyHistogram::getBucket(0x100000000ULL));
+    EXPECT_EQ(last, LatencyHistogram::getBucket(0xffffffffffULL));
+    EXPECT_EQ(0xffffffffULL + 1, next_low);
+}
+
+TEST(LatencyHistogramTest, statistics) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0, histogram.getCount());
+    EXPECT_EQ(0, histogram.getMin());
+    EXPECT_EQ(0, histogram.getMax());
+    EXPECT_EQ(0, histogram.getMean());
+    EXPECT_EQ(0, histogram.getStddev());
+    EXPECT_EQ(0, histogram.getPercentile(50));
+
+    // 1..1000 microseconds.
+    for (uint64_t usec = 1000; usec >= 1; --usec) {
+        histogram.add(usec);
+    }
+    EXPECT_EQ(1000, histogram.getCount());
+    EXPECT_EQ(1, histogram.getMin());
+    EXPECT_EQ(1000, histogram.getMax());
+    EXPECT_DOUBLE_EQ(500.5, histogram.getMean());
+    EXPECT_NEAR(288.67, histogram.getStddev(), 0.01);
+    // The percentiles are within the width of a bucket above the exact
+    // ones, and never above the maximum.
+    EXPECT_EQ(1, histogram.getPercentile(0));
+    EXPECT_EQ(10, histogram.getPercentile(1));
+    EXPECT_LE(500, histogram.getPercentile(50));
+    EXPECT_GE(500 + 16, histogram.getPercentile(50));
+    EXPECT_LE(990, histogram.getPercentile(99));
+    EXPECT_GE(990 + 32, histogram.getPercentile(99));
+    EXPECT_EQ(1000, histogram.getPercentile(100));
+}
+
+TEST(LatencyHistogramTest, merge) {
+    LatencyHistogram histogram1, histogram2, empty;
+    histogram1.add(100);
+    histogram1.add(300);
+    histogram2.add(50);
+    histogram2.add(1000);
+
+    histogram1.merge(empty);
+    EXPECT_EQ(2, histogram1.getCount());
+    EXPECT_EQ(100, histogram1.getMin());
+
+    empty.merge(histogram1);
+    EXPECT_EQ(2, empty.getCount());
+    EXPECT_EQ(100, empty.getMin());
+    EXPECT_EQ(300, empty.getMax());
+
+    histogram1.merge(histogram2);
+    EXPECT_EQ(4, histogram1.getCount());
+    EXPECT_EQ(50, histogram1.getMin());
+    EXPECT_EQ(1000, histogram1.getMax());
+    EXPECT_DOUBLE_EQ(362.5, histogram1.getMean());
+    EXPECT_EQ(50, histogram1.getPercentile(25));
+    EXPECT_EQ(1000, histogram1.getPercentile(100));
+}
+
+TEST(LatencyHistogramTest, mergeThreads) {
+    // The histograms of several threads merged give the same statistics as
+    // a single histogram counting all the latencies.
+    LatencyHistogram threads[4], single, total;
+    for (uint64_t usec = 1; usec <= 4000; ++usec) {
+        const uint64_t latency = usec * usec;
+        threads[usec % 4].add(latency);
+        single.add(latency);
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        total.merge(threads[i]);
+    }
+    EXPECT_EQ(single.getCount(), total.getCount());
+    EXPECT_EQ(single.getMin(), total.getMin());
+    EXPECT_EQ(single.getMax(), total.getMax());
+    EXPECT_DOUBLE_EQ(single.getMean(), total.getMean());
+    // The sums are added up in a different order, so they can differ in
+    // the last bits.
+    EXPECT_NEAR(single.getStddev(), total.getStddev(),
+                single.getStddev() * 1e-9);
+    const double percents[] = { 0, 1, 10, 50, 90, 99, 99.9, 100 };
+    for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); ++i) {
+        EXPECT_EQ(single.getPercentile(percents[i]),
+                  total.getPercentile(percents[i]));
+    }
+    // The latencies are spread over many buckets; check the percentiles
+    // are close to the exact ones.
+    EXPECT_LE(2000 * 2000, total.getPercentile(50));
+    EXPECT_GE(2000 * 2000 + 2000 * 2000 / 32, total.getPercentile(50));
+    EXPECT_EQ(4000 * 4000, total.getPercentile(100));
+
+    ostringstream single_text, total_text;
+    single.print(single_text);
+    total.print(total_text);
+    EXPECT_EQ(single_text.str(), total_text.str());
+}
+
+TEST(StatsMgrTest, total) {
+    StatsMgr mgr(2);
+    QueryStats& stats0 = mgr.getThreadStats(0);
+    QueryStats& stats1 = mgr.getThreadStats(1);
+    EXPECT_NE(&stats0, &stats1);
+
+    stats0.sent = 10;
+    stats0.received = 9;
+    stats0.lost = 1;
+    stats0.rcodes[0] = 8;
+    stats0.rcodes[3] = 1;
+    stats0.latency.add(1000);
+    stats1.sent = 5;
+    stats1.received = 5;
+    stats1.truncated = 2;
+    stats1.connections = 1;
+    stats1.rcodes[0] = 5;
+    stats1.latency.add(2000);
+
+    const QueryStats total = mgr.getTotal();
+    EXPECT_EQ(15, total.sent);
+    EXPECT_EQ(14, total.received);
+    EXPECT_EQ(1, total.lost);
+    EXPECT_EQ(2, total.truncated);
+    EXPECT_EQ(1, total.connections);
+    EXPECT_EQ(13, total.rcodes[0]);
+    EXPECT_EQ(1, total.rcodes[3]);
+    EXPECT_EQ(2, total.latency.getCount());
+    EXPECT_EQ(2000, total.latency.getMax());
+
+    ostringstream oss;
+    mgr.print(oss, 2, true);
+    const string output = oss.str();
+    EXPECT_NE(string::npos, output.find("Queries sent:         15\n"));
+    EXPECT_NE(string::npos, output.find("Queries completed:    14 (93.33%)"));
+    EXPECT_NE(string::npos, output.find("NOERROR 13 (92.86%), NXDOMAIN 1"));
+    EXPECT_NE(string::npos, output.find("Queries per second:   7.00"));
+    EXPECT_NE(string::npos, output.find("min/avg/max/stddev:   "
+                                        "1.000/1.500/2.000/0.500"));
+    EXPECT_NE(string::npos, output.find("Latency histogram (ms):"));
+}
+
+}
@@ -0,0 +1,326 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "command_options_helper.h"
+#include "../query_builder.h"
+#include "../query_list.h"
+#include "../stats_mgr.h"
+#include "../test_control.h"
+
+#include <exceptions/exceptions.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::perfdns;
+using bundy::util::thread::Thread;
+
+namespace {
+
+// A trivial DNS server on the loopback address.  It responds to each query
+// with its copy with the QR bit set.  Queries for nxdomain.example.com get
+// NXDOMAIN, and those for drop.example.com are not responded.  With TCP,
+// it closes the connection after the given number of responses (if not
+// 0).
+class Responder {
+public:
+    Responder(bool tcp, size_t close_after = 0) :
+        tcp_(tcp), close_after_(close_after), stop_(false), fd_(-1), port_(0)
+    {
+        fd_ = socket(AF_INET, tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (fd_ < 0 ||
+            bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), len) < 0 ||
+            getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr),
+                        &len) < 0 ||
+            (tcp && listen(fd_, 5) < 0)) {
+            bundy_throw(bundy::Unexpected, "failed to open responder socket");
+        }
+        port_ = ntohs(addr.sin_port);
+        thread_.reset(new Thread(boost::bind(&Responder::run, this)));
+    }
+    ~Responder() {
+        stop_ = true;
+        thread_->wait();
+        close(fd_);
+    }
+    uint16_t getPort() const { return (port_); }
+
+private:
+    bool waitReadable(int fd) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        while (!stop_) {
+            if (poll(&pfd, 1, 10) > 0) {
+                return (true);
+            }
+        }
+        return (false);
+    }
+
+    // Make the response to the query in place; returns false if it is
+    // to be dropped.
+    static bool respond(vector<uint8_t>& data) {
+        const string query(data.begin(), data.end());
+        if (query.find("\x04" "drop\x07" "example") != string::npos) {
+            return (false);
+        }
+        data[2] |= 0x80;
+        if (query.find("\x08" "nxdomain\x07" "example") != string::npos) {
+            data[3] = (data[3] & 0xf0) | 3;
+        }
+        return (true);
+    }
+
+    void run() {
+        if (tcp_) {
+            runTCP();
+        } else {
+            runUDP();
+        }
+    }
+
+    void runUDP() {
+        vector<uint8_t> data(65535);
+        while (waitReadable(fd_)) {
+            struct sockaddr_storage from;
+            socklen_t from_len = sizeof(from);
+            const ssize_t ret =
+                recvfrom(fd_, &data[0], data.size(), 0,
+                         reinterpret_cast<struct sockaddr*>(&from),
+                         &from_len);
+            if (ret < 12) {
+                continue;
+            }
+            vector<uint8_t> query(data.begin(), data.begin() + ret);
+            if (respond(query)) {
+                sendto(fd_, &query[0], query.size(), 0,
+                       reinterpret_cast<struct sockaddr*>(&from), from_len);
+            }
+        }
+    }
+
+    bool readAll(int fd, uint8_t* data, size_t length) {
+        while (length > 0) {
+            if (!waitReadable(fd)) {
+                return (false);
+            }
+            const ssize_t ret = recv(fd, data, length, 0);
+            if (ret <= 0) {
+                return (false);
+            }
+            data += ret;
+            length -= ret;
+        }
+        return (true);
+    }
+
+    void runTCP() {
+        while (waitReadable(fd_)) {
+            const int conn = accept(fd_, NULL, NULL);
+            if (conn < 0) {
+                continue;
+            }
+            size_t responses = 0;
+            uint8_t length_data[2];
+            while (readAll(conn, length_data, 2)) {
+                vector<uint8_t> query((length_data[0] << 8) | length_data[1]);
+                if (query.size() < 12 ||
+                    !readAll(conn, &query[0], query.size())) {
+                    break;
+                }
+                if (!respond(query)) {
+                    continue;
+                }
+                query.insert(query.begin(), length_data, length_data + 2);
+                if (send(conn, &query[0], query.size(), MSG_NOSIGNAL) !=
+                    static_cast<ssize_t>(query.size()) ||
+                    ++responses == close_after_) {
+                    break;
+                }
+            }
+            close(conn);
+        }
+    }
+
+    const bool tcp_;
+    const size_t close_after_;
+    volatile bool stop_;
+    int fd_;
+    uint16_t port_;
+    boost::scoped_ptr<Thread> thread_;
+};
+
+class TestControlTest : public ::testing::Test {
+protected:
+    // Run a test with the given queries and options.
+    void runTest(const string& queries, const Responder& responder,
+                 const string& cmdline)
+    {
+        istringstream iss(queries);
+        QueryList list;
+        list.loadText(iss, "test");
+        ASSERT_FALSE(parseCommandLine(options_, "perfdns -d test -p " +
+                                      boost::lexical_cast<string>(
+                                          responder.getPort()) + " " +
+                                      cmdline));
+        const QueryBuilder builder(list.getQuestions(), false,
+                                   options_.isEDNS(), options_.getUDPSize(),
+                                   options_.isDNSSECOK(),
+                                   options_.getTSIGKey());
+        TestControl control(options_, builder);
+        stats_.reset(new StatsMgr(options_.getThreads()));
+        duration_ = control.runTest(*stats_);
+        total_ = stats_->getTotal();
+    }
+
+    CommandOptions options_;
+    boost::scoped_ptr<StatsMgr> stats_;
+    QueryStats total_;
+    double duration_;
+};
+
+const char* const QUERIES =
+    "www.example.com A\n"
+    "www.example.com AAAA\n"
+    "nxdomain.example.com A\n"
+    "example.com MX\n";
+
+TEST_F(TestControlTest, udp) {
+    const Responder responder(false);
+    runTest(QUERIES, responder, "-n 5 -T 2 -a 3 -q 4");
+    EXPECT_EQ(20, total_.sent);
+    EXPECT_EQ(20, total_.received);
+    EXPECT_EQ(0, total_.lost);
+    EXPECT_EQ(0, total_.unexpected);
+    EXPECT_EQ(15, total_.rcodes[0]);
+    EXPECT_EQ(5, total_.rcodes[3]);
+    EXPECT_EQ(20, total_.latency.getCount());
+    EXPECT_EQ(0, total_.connections);
+    EXPECT_LT(0, total_.bytes_sent);
+    EXPECT_EQ(total_.bytes_sent, total_.bytes_received);
+    // Each thread sent its share.
+    EXPECT_EQ(10, stats_->getThreadStats(0).sent);
+    EXPECT_EQ(10, stats_->getThreadStats(1).sent);
+    EXPECT_LT(0, duration_);
+}
+
+TEST_F(TestControlTest, udpLost) {
+    const Responder responder(false);
+    runTest("www.example.com A\ndrop.example.com A\n", responder,
+            "-n 3 -t 50");
+    EXPECT_EQ(6, total_.sent);
+    EXPECT_EQ(3, total_.received);
+    EXPECT_EQ(3, total_.lost);
+    // The test waits for the last lost query.
+    EXPECT_LE(0.05, duration_);
+}
+
+TEST_F(TestControlTest, udpRate) {
+    const Responder responder(false);
+    // 20 queries at 200 per second take about 0.1 seconds.
+    runTest(QUERIES, responder, "-n 5 -Q 200 -a 1");
+    EXPECT_EQ(20, total_.received);
+    EXPECT_LE(0.09, duration_);
+}
+
+TEST_F(TestControlTest, udpTimeLimit) {
+    const Responder responder(false);
+    runTest(QUERIES, responder, "-l 1 -Q 100");
+    // About 100 queries are sent in a second.
+    EXPECT_LE(50, total_.sent);
+    EXPECT_GE(150, total_.sent);
+    EXPECT_EQ(total_.sent, total_.received);
+}
+
+TEST_F(TestControlTest, tcp) {
+    const Responder responder(true);
+    runTest(QUERIES, responder, "-m tcp -n 5 -T 2 -q 8 -e -y "
+            "key.example:c2VjcmV0");
+    EXPECT_EQ(20, total_.sent);
+    EXPECT_EQ(20, total_.received);
+    EXPECT_EQ(0, total_.lost);
+    EXPECT_EQ(15, total_.rcodes[0]);
+    EXPECT_EQ(5, total_.rcodes[3]);
+    EXPECT_EQ(2, total_.connections);
+    EXPECT_LT(40, total_.bytes_sent);
+    EXPECT_EQ(total_.bytes_sent, total_.bytes_received);
+}
+
+TEST_F(TestControlTest, tcpReconnect) {
+    // The server closes the connection after each 3 responses.  Queries
+    // pipelined on a closed connection are lost.
+    const Responder responder(true, 3);
+    runTest(QUERIES, responder, "-m tcp -n 5 -q 2 -t 50");
+    EXPECT_EQ(20, total_.sent);
+    EXPECT_LE(9, total_.received);
+    EXPECT_EQ(total_.sent, total_.received + total_.lost);
+    EXPECT_LE(4, total_.connections);
+}
+
+TEST_F(TestControlTest, noServer) {
+    // Nothing listens on the port of a closed TCP socket.
+    uint16_t port;
+    {
+        const Responder responder(true);
+        port = responder.getPort();
+    }
+    istringstream iss(QUERIES);
+    QueryList list;
+    list.loadText(iss, "test");
+    ASSERT_FALSE(parseCommandLine(options_, "perfdns -d test -m tcp -p " +
+                                  boost::lexical_cast<string>(port)));
+    const QueryBuilder builder(list.getQuestions(), false, false, 0, false,
+                               NULL);
+    TestControl control(options_, builder);
+    StatsMgr stats(1);
+    EXPECT_THROW(control.runTest(stats), bundy::Unexpected);
+}
+
+TEST_F(TestControlTest, badServer) {
+    istringstream iss(QUERIES);
+    QueryList list;
+    list.loadText(iss, "test");
+    ASSERT_FALSE(parseCommandLine(options_, "perfdns -d test -s "
+                                  "no-such-host.invalid."));
+    const QueryBuilder builder(list.getQuestions(), false, false, 0, false,
+                               NULL);
+    EXPECT_THROW(TestControl(options_, builder), bundy::BadValue);
+}
+
+}